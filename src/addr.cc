@@ -4,12 +4,20 @@
  * address processing functions, including longest prefix match
  */
 
+#include <atomic>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <string.h>
 #include <locale.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "addr.h"
+#include "lct_bin.h"
+#include "memory_report.h"
 
 #if defined(__cplusplus)
     extern "C" {
@@ -28,14 +36,124 @@
 lct_t ipv4_subnet_trie;
 lct_subnet_t *ipv4_subnet_array;
 
+/*
+ * ipv6_subnet_trie holds the parallel IPv6 trie; ipv6_subnet_array is
+ * NULL when the prefix file contains no IPv6 entries, in which case
+ * IPv6 lookups report no ASN
+ */
+lct6_t ipv6_subnet_trie;
+lct_subnet6_t *ipv6_subnet_array;
+
+/*
+ * when the compiled image is in use, addr_bin_base holds the mapping
+ * and the trie arrays point into it (see lct_bin.h)
+ */
+static const uint8_t *addr_bin_base = NULL;
+static size_t addr_bin_size = 0;
+
+/*
+ * ipv4_subnet_count holds the length of ipv4_subnet_array, which is
+ * sorted by (address, length); the front-line cache below searches it
+ */
+static uint32_t ipv4_subnet_count = 0;
+
+/*
+ * Traffic concentrates on a small set of destination prefixes (CDNs,
+ * cloud providers), so a per-thread direct-mapped cache of recent
+ * /24 -> ASN results sits in front of the trie walk; a hit costs one
+ * L1 access in place of a chain of dependent node loads.  One result
+ * may only stand in for its whole /24 when no longer-than-/24 prefix
+ * lies inside that /24, so a cache fill checks the sorted subnet
+ * array for such a prefix and is skipped when one is present.  As
+ * with the per-thread analysis cache (see analysis.cc), entries are
+ * tagged with a generation number that addr_init() and
+ * addr_finalize() advance, which invalidates every thread's cache
+ * when the trie is torn down or reloaded.
+ */
+#define ADDR_CACHE_SIZE 4096   /* number of entries; a power of two */
+
+struct addr_cache_entry {
+    uint32_t net24;   /* host-order address >> 8; UINT32_MAX when empty */
+    uint32_t asn;
+};
+
+static std::atomic<uint64_t> addr_db_generation{1};
+static thread_local struct addr_cache_entry addr_cache[ADDR_CACHE_SIZE];
+static thread_local uint64_t addr_cache_generation = 0;
+
+/*
+ * net24_is_uniform(net24) reports whether every address of the /24
+ * with prefix net24 (a host-order address >> 8) matches the same
+ * subnet, which holds exactly when no prefix longer than /24 falls
+ * inside it; such a prefix covers part of a single /24, so it is
+ * found by scanning the sorted subnet array entries whose addresses
+ * share that /24
+ */
+static bool net24_is_uniform(uint32_t net24) {
+    uint32_t lo = net24 << 8;
+    uint32_t l = 0, r = ipv4_subnet_count;
+
+    while (l < r) {
+        uint32_t mid = l + (r - l) / 2;
+        if (ipv4_subnet_array[mid].addr < lo) {
+            l = mid + 1;
+        } else {
+            r = mid;
+        }
+    }
+    for (uint32_t i = l; i < ipv4_subnet_count && (ipv4_subnet_array[i].addr >> 8) == net24; i++) {
+        if (ipv4_subnet_array[i].len > 24) {
+            return false;
+        }
+    }
+    return true;
+}
+
 uint32_t get_asn_info(char* dst_ip) {
     uint32_t ipv4_addr;
+    uint8_t ipv6_addr[16];
 
-    if (inet_pton(AF_INET, dst_ip, &ipv4_addr) != 1) {
-        return 0;
+    if (inet_pton(AF_INET, dst_ip, &ipv4_addr) == 1) {
+        return get_asn_info(ipv4_addr);
+    }
+    if (inet_pton(AF_INET6, dst_ip, ipv6_addr) == 1) {
+        return get_asn_info(ipv6_addr);
+    }
+    return 0;
+}
+
+uint32_t get_asn_info(uint32_t ipv4_addr) {
+    uint32_t haddr = ntohl(ipv4_addr);
+    uint32_t net24 = haddr >> 8;
+
+    uint64_t generation = addr_db_generation.load(std::memory_order_acquire);
+    if (addr_cache_generation != generation) {
+        memset(addr_cache, 0xff, sizeof(addr_cache));   /* all entries empty */
+        addr_cache_generation = generation;
+    }
+    struct addr_cache_entry *entry = &addr_cache[net24 & (ADDR_CACHE_SIZE - 1)];
+    if (entry->net24 == net24) {
+        return entry->asn;
+    }
+
+    lct_subnet_t *subnet = lct_find(&ipv4_subnet_trie, haddr);
+    uint32_t asn = 0;
+    if (subnet != NULL && subnet->info.type == IP_SUBNET_BGP) {
+        asn = subnet->info.bgp.asn;
     }
+    if (net24_is_uniform(net24)) {
+        entry->net24 = net24;
+        entry->asn = asn;
+    }
+    return asn;
+}
+
+uint32_t get_asn_info(const uint8_t *ipv6_addr) {
 
-    lct_subnet_t *subnet = lct_find(&ipv4_subnet_trie, ntohl(ipv4_addr));
+    if (ipv6_subnet_array == NULL) {
+        return 0;   /* no IPv6 prefixes were loaded */
+    }
+    lct_subnet6_t *subnet = lct6_find(&ipv6_subnet_trie, lct_ip6_key(ipv6_addr));
     if (subnet == NULL) {
         return 0;
     }
@@ -125,6 +243,81 @@ lct_subnet_t *lct_init_from_file(lct_t *lct, char *filename) {
   memset(lct, 0, sizeof(lct_t));
   lct_build(lct, p, num);
 
+  ipv4_subnet_count = num;
+  return p;
+
+ bail:   /* handle errors by freeing memory as needed */
+
+  free(p);
+  return NULL;
+}
+
+/*
+ * BGP6_MAX_ENTRIES is the maximum number of IPv6 subnets
+ */
+#define BGP6_MAX_ENTRIES            1000000
+
+/*
+ * lct6_init_from_file(lct, filename) initializes the IPv6 lctrie lct
+ * from the IPv6 entries of the file filename, following the same
+ * steps as lct_init_from_file().  If the file holds no IPv6 prefixes,
+ * or on error, NULL is returned and the trie is left empty.
+ */
+lct_subnet6_t *lct6_init_from_file(lct6_t *lct, char *filename) {
+  int num = 0;
+  lct_subnet6_t *p;
+  lct_subnet6_t *tmp = NULL;
+  lct_ip6_stats_t *stats = NULL;
+
+  if (!(p = (lct_subnet6_t *)calloc(sizeof(lct_subnet6_t), BGP6_MAX_ENTRIES))) {
+      return NULL;  /* could not allocate subnet input buffer */
+  }
+
+  // start with the special use subnets as a basis for any table set
+  num += init_special_subnets6(&p[num], BGP6_MAX_ENTRIES);
+
+  // read in the ASN prefixes
+  int rc;
+  if (0 >= (rc = read_prefix_table6(filename, &p[num], BGP6_MAX_ENTRIES - num))) {
+      goto bail; /* could not read prefix file, or no IPv6 entries in it */
+  }
+  num += rc;
+
+  // validate subnet prefixes against their netmasks
+  // and sort the resulting array
+  subnet6_mask(p, num);
+  qsort(p, num, sizeof(lct_subnet6_t), subnet6_cmp);
+
+  // de-duplicate subnets and shrink the buffer down to its
+  // actual size and split into prefixes and bases
+  num -= subnet6_dedup(p, num);
+  tmp = (lct_subnet6_t *)realloc(p, num * sizeof(lct_subnet6_t));
+  if (tmp != NULL) {
+      p = tmp;
+  } else {
+      goto bail;
+  }
+
+  // allocate a buffer for the IP stats
+  stats = (lct_ip6_stats_t *) calloc(num, sizeof(lct_ip6_stats_t));
+  if (!stats) {
+      goto bail; /* could not allocate prefix statistics buffer */
+  }
+
+  // count which subnets are prefixes of other subnets
+  subnet6_prefix(p, stats, num);
+  free(stats);
+
+  // actually build the trie
+  memset(lct, 0, sizeof(lct6_t));
+  if (lct6_build(lct, p, num) != 0) {
+      goto bail;
+  }
+
+  memory_report_register("addr", "IPv6 subnet array and trie",
+                         (uint64_t)num * sizeof(lct_subnet6_t)
+                         + (uint64_t)lct->ncount * sizeof(lct_node_t)
+                         + (uint64_t)lct->bcount * sizeof(uint32_t));
   return p;
 
  bail:   /* handle errors by freeing memory as needed */
@@ -133,17 +326,123 @@ lct_subnet_t *lct_init_from_file(lct_t *lct, char *filename) {
   return NULL;
 }
 
+/*
+ * addr_init_bin(bin_file_name) maps a compiled trie image (built by
+ * the lct_db_compiler tool; see lct_bin.h) and points the tries at
+ * the mapped arrays; it returns 0 on success and -1 otherwise.  The
+ * mapping is read-only and shared, so concurrent processes reference
+ * the same physical pages, and no parse or build runs at startup.
+ */
+static int addr_init_bin(const char *bin_file_name) {
+
+    int fd = open(bin_file_name, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) != 0) {
+        close(fd);
+        return -1;
+    }
+    size_t file_size = statbuf.st_size;
+    if (file_size < sizeof(struct lct_bin_hdr)) {
+        close(fd);
+        return -1;
+    }
+    uint8_t *base = (uint8_t *)mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+    const struct lct_bin_hdr *hdr = (const struct lct_bin_hdr *)base;
+    if (memcmp(hdr->magic, LCT_BIN_MAGIC, sizeof(hdr->magic)) != 0
+        || hdr->version != LCT_BIN_VERSION
+        || hdr->file_size != file_size) {
+        fprintf(stderr, "warning: %s is not a valid compiled subnet database\n", bin_file_name);
+        munmap(base, file_size);
+        return -1;
+    }
+
+    memset(&ipv4_subnet_trie, 0, sizeof(ipv4_subnet_trie));
+    ipv4_subnet_trie.ncount = hdr->node_count;
+    ipv4_subnet_trie.bcount = hdr->base_count;
+    ipv4_subnet_trie.shortest = hdr->shortest;
+    ipv4_subnet_trie.nets = (lct_subnet_t *)(base + hdr->subnets);
+    ipv4_subnet_trie.bases = (uint32_t *)(base + hdr->bases);
+    ipv4_subnet_trie.root = (lct_node_t *)(base + hdr->nodes);
+    ipv4_subnet_array = ipv4_subnet_trie.nets;
+    ipv4_subnet_count = hdr->subnet_count;
+
+    if (hdr->subnet6_count > 0) {
+        memset(&ipv6_subnet_trie, 0, sizeof(ipv6_subnet_trie));
+        ipv6_subnet_trie.ncount = hdr->node6_count;
+        ipv6_subnet_trie.bcount = hdr->base6_count;
+        ipv6_subnet_trie.shortest = hdr->shortest6;
+        ipv6_subnet_trie.nets = (lct_subnet6_t *)(base + hdr->subnets6);
+        ipv6_subnet_trie.bases = (uint32_t *)(base + hdr->bases6);
+        ipv6_subnet_trie.root = (lct_node_t *)(base + hdr->nodes6);
+        ipv6_subnet_array = ipv6_subnet_trie.nets;
+    }
+
+    addr_bin_base = base;
+    addr_bin_size = file_size;
+    memory_report_register("addr", "subnet trie compiled image (mapped, shared)", file_size);
+    return 0;
+}
+
 int addr_init(const char *resources_dir) {
 
+    /*
+     * prefer the compiled image, if one sits alongside the prefix
+     * file; otherwise parse the text form and build the tries here
+     */
+    char bin_file_name[PATH_MAX];
+    snprintf(bin_file_name, sizeof(bin_file_name), "%s.bin", resources_dir);
+    if (addr_init_bin(bin_file_name) == 0) {
+        addr_db_generation.fetch_add(1, std::memory_order_release);
+        return 0;
+    }
+
     ipv4_subnet_array = lct_init_from_file(&ipv4_subnet_trie, (char *)resources_dir);
     if (ipv4_subnet_array == NULL) {
         return -1;
     }
+
+    /*
+     * the IPv6 trie loads from the same prefix file; a file with no
+     * IPv6 entries just leaves it empty
+     */
+    ipv6_subnet_array = lct6_init_from_file(&ipv6_subnet_trie, (char *)resources_dir);
+
+    memory_report_register("addr", "IPv4 subnet array and trie",
+                           (uint64_t)ipv4_subnet_count * sizeof(lct_subnet_t)
+                           + (uint64_t)ipv4_subnet_trie.ncount * sizeof(lct_node_t)
+                           + (uint64_t)ipv4_subnet_trie.bcount * sizeof(uint32_t));
+    /* start every thread's front-line cache over on the new trie */
+    addr_db_generation.fetch_add(1, std::memory_order_release);
+
     return 0;
 }
 
 void addr_finalize() {
+    ipv4_subnet_count = 0;
+    addr_db_generation.fetch_add(1, std::memory_order_release);
+    if (addr_bin_base) {
+        /* the trie arrays live in the mapping; nothing else to free */
+        munmap((void *)addr_bin_base, addr_bin_size);
+        addr_bin_base = NULL;
+        addr_bin_size = 0;
+        ipv4_subnet_array = NULL;
+        ipv6_subnet_array = NULL;
+        return;
+    }
     free(ipv4_subnet_trie.root);
     lct_free(&ipv4_subnet_trie);
     free(ipv4_subnet_array);
+    if (ipv6_subnet_array) {
+        free(ipv6_subnet_trie.root);
+        lct6_free(&ipv6_subnet_trie);
+        free(ipv6_subnet_array);
+        ipv6_subnet_array = NULL;
+    }
 }
@@ -11,6 +11,22 @@
 
 uint32_t get_asn_info(char* dst_ip);
 
+/*
+ * get_asn_info(ipv4_addr) returns the BGP Autonomous System Number of
+ * the subnet containing ipv4_addr, which is in network byte order, as
+ * it appears in struct key (tcp.h); callers that hold the binary
+ * address should prefer this form over the char* one, which has to
+ * convert the string back to binary first.
+ */
+uint32_t get_asn_info(uint32_t ipv4_addr);
+
+/*
+ * get_asn_info(ipv6_addr) is the 128-bit form: ipv6_addr points to
+ * the 16-byte address in network byte order, as it appears in struct
+ * key.  It returns 0 if the prefix file held no IPv6 entries.
+ */
+uint32_t get_asn_info(const uint8_t *ipv6_addr);
+
 int addr_init(const char *resources_dir);
 
 void addr_finalize();
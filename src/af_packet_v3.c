@@ -19,12 +19,22 @@
 #include <sched.h>
 
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <poll.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
 #include <sys/sysinfo.h>
 #include <linux/if_packet.h>
+#include <linux/filter.h>
+#include <linux/ethtool.h>
+#include <dirent.h>
+#include <ctype.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
+#ifdef PACKET_FANOUT_EBPF
+#include <linux/bpf.h>
+#endif
 #include <net/if.h>
 #include <net/ethernet.h> /* the L2 protocols */
 
@@ -32,17 +42,41 @@
 #include <math.h>
 
 #include "af_packet_v3.h"
+#include "memory_report.h"
+#include "probe.h"
 #include "signal_handling.h"
 #include "utils.h"
 #include "rnd_pkt_drop.h"
 #include "output.h"
 #include "pkt_proc.h"
+#include "serializer.h"
+#include "hh_sketch.h"
+#include "analysis.h"
+#include "flow_snapshot.h"
 
 /*
  * The thread_storage, stats_tracking, and ring_limits structs are
  * local to this file.
  */
 
+/* The maximum number of interfaces a single process will capture from */
+#define MAX_INTERFACES 8
+
+/*
+ * Bounds for the adaptive poll() timeout.  The block retirement
+ * timeout (tp_retire_blk_tov) and frame size are fixed once the ring
+ * is mapped, so the runtime knob we can close the loop on is how long
+ * a worker sleeps in poll(); the stats thread adapts it each second
+ * from the block streak histogram.  poll() returns early when a block
+ * retires, so a long timeout costs nothing when traffic resumes --
+ * it only reduces idle wakeups -- while a short timeout under load
+ * tightens the frozen-queue recovery and output flush paths.  The
+ * maximum also bounds how long shutdown can take.
+ */
+#define AF_POLL_TIMEOUT_MIN     10  /* milliseconds */
+#define AF_POLL_TIMEOUT_START 1000
+#define AF_POLL_TIMEOUT_MAX   4000
+
 /* The struct that describes the limits on allocating ring memory */
 struct ring_limits {
   uint64_t af_desired_memory;
@@ -57,13 +91,29 @@ struct ring_limits {
 };
 
 
+/*
+ * Per-thread packet and byte counters.  Each worker increments only
+ * its own pair, and the pair sits alone on its cache line, so the
+ * per-block accounting never stores to a line that another core is
+ * reading or writing; the stats thread samples the counters
+ * asynchronously and aggregates them.
+ */
+#define CACHE_LINE_SIZE 64
+struct thread_stats {
+  uint64_t received_packets;
+  uint64_t received_bytes;
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
 /*
  * Our stats tracking function will get a pointer to a struct
  * that has the info it needs to track stats for each thread
- * and a place to store those stats
+ * and a place to store those stats.  The received_packets and
+ * received_bytes totals are aggregates of the per-thread counters,
+ * written only by the stats thread.
  */
 struct stats_tracking {
   struct thread_storage *tstor;
+  struct thread_queues *tqs;  /* The output queues, or NULL when there is no output thread */
   int num_threads;
   uint64_t received_packets;
   uint64_t received_bytes;
@@ -74,6 +124,8 @@ struct stats_tracking {
   pthread_cond_t *t_start_c;  /* The clean start condition */
   pthread_mutex_t *t_start_m; /* The clean start mutex */
   int verbosity;
+  const char *stats_json_filename;  /* stats JSON destination (--stats-json), or NULL */
+  int stats_interval;               /* seconds between stats JSON records */
 };
 
 /*
@@ -81,8 +133,11 @@ struct stats_tracking {
  * including its thread id and socket file handle
  */
 struct thread_storage {
+  struct thread_stats stats; /* This thread's counters, alone on their cache line */
   struct pkt_proc *pkt_processor;
   int tnum;                 /* Thread Number */
+  int numa_node;            /* The NUMA node owning the NIC, or -1 if unknown */
+  int busy_poll_usecs;      /* Busy-poll spin budget in usec, or 0 if disabled */
   pthread_t tid;            /* Thread ID */
   pthread_attr_t thread_attributes;
   int sockfd;               /* Socket owned by this thread */
@@ -91,8 +146,11 @@ struct thread_storage {
   struct tpacket_block_desc **block_header; /* The pointer to each block in the mmap()'d region */
   struct tpacket_req3 ring_params; /* The ring allocation params to setsockopt() */
   struct stats_tracking *statst;   /* A pointer to the struct with the stats counters */
+  struct tx_mirror *mirror;   /* TX mirror toward --mirror interface, or NULL */
   double *block_streak_hist;  /* The block streak histogram */
+  uint8_t *block_offered;     /* Per-block work-stealing bookkeeping (owner only) */
   pthread_mutex_t bstreak_m;  /* The block streak mutex */
+  volatile int poll_timeout_ms; /* Adaptive poll() timeout, set by the stats thread */
   int *t_start_p;             /* The clean start predicate */
   pthread_cond_t *t_start_c;  /* The clean start condition */
   pthread_mutex_t *t_start_m; /* The clean start mutex */
@@ -102,6 +160,507 @@ struct thread_storage {
 
 void ring_limits_init(struct ring_limits *rl, float frac);  // defined below
 
+/*
+ * == NUMA awareness ==
+ *
+ * On multi-socket sensors the RX_RING blocks and the worker threads
+ * parsing them should both live on the NUMA node that owns the NIC,
+ * or every frame crosses the inter-socket link twice.  We read the
+ * NIC's node from sysfs, bind the kernel's ring allocation to that
+ * node with set_mempolicy() around the PACKET_RX_RING setsockopt()
+ * (the ring pages are allocated by the kernel there, so an mbind() on
+ * the mapping after the fact would be too late), and pin each worker
+ * thread to a CPU of that node.
+ *
+ * The set_mempolicy() syscall is used directly so that we don't pick
+ * up a libnuma dependency.
+ */
+
+#ifndef MPOL_DEFAULT
+#define MPOL_DEFAULT 0
+#define MPOL_BIND    2
+#endif
+
+static long set_mempolicy_node(int mode, int node) {
+  if (node < 0) {
+    return syscall(__NR_set_mempolicy, MPOL_DEFAULT, NULL, 0);
+  }
+  unsigned long nodemask = 1UL << node;
+  return syscall(__NR_set_mempolicy, mode, &nodemask, sizeof(nodemask) * 8);
+}
+
+/* returns the NUMA node that owns the interface, or -1 if unknown */
+static int interface_numa_node(const char *if_name) {
+  char path[MAX_FILENAME];
+  int node = -1;
+
+  snprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node", if_name);
+  FILE *f = fopen(path, "r");
+  if (f == NULL) {
+    return -1;  /* virtual device, or no NUMA information */
+  }
+  if (fscanf(f, "%d", &node) != 1) {
+    node = -1;
+  }
+  fclose(f);
+  return node;
+}
+
+/*
+ * fills cpus[] with the CPUs of the given NUMA node, parsed from the
+ * sysfs cpulist (e.g. "0-7,16-23"); falls back to all configured CPUs
+ * when the node is unknown.  Returns the number of CPUs found.
+ */
+static int numa_node_cpus(int node, int *cpus, int max_cpus) {
+  int count = 0;
+
+  if (node >= 0) {
+    char path[MAX_FILENAME];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    FILE *f = fopen(path, "r");
+    if (f != NULL) {
+      int first, last;
+      while (fscanf(f, "%d", &first) == 1) {
+        last = first;
+        if (fscanf(f, "-%d", &last) != 1) {
+          last = first;
+        }
+        for (int cpu = first; cpu <= last && count < max_cpus; cpu++) {
+          cpus[count++] = cpu;
+        }
+        if (fgetc(f) != ',') {
+          break;
+        }
+      }
+      fclose(f);
+    }
+  }
+  if (count == 0) {
+    int num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int cpu = 0; cpu < num_cpus && count < max_cpus; cpu++) {
+      cpus[count++] = cpu;
+    }
+  }
+  return count;
+}
+
+/*
+ * == NIC queue topology ==
+ *
+ * The thread count that keeps a capture balanced is the NIC's own
+ * queue count, and the right CPU for each worker is the one already
+ * servicing a queue's IRQ; both change with every hardware generation
+ * and were hand-tuned per host.  The helpers below read them from the
+ * running system instead: the channel count comes from the
+ * ETHTOOL_GCHANNELS ioctl (falling back to counting the rx queue
+ * directories in sysfs, which virtual devices have even when they
+ * lack an ethtool driver), and the CPU serving each queue IRQ comes
+ * from /proc/interrupts and /proc/irq/N/smp_affinity_list.  No
+ * libnl/ethtool library dependency is picked up, in the same spirit
+ * as the raw set_mempolicy() call above.
+ */
+
+/* returns the interface's RX queue count, or 0 if unknown */
+static int interface_channel_count(const char *if_name) {
+  int count = 0;
+
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd >= 0) {
+    struct ethtool_channels ec;
+    struct ifreq ifr;
+    memset(&ec, 0, sizeof(ec));
+    memset(&ifr, 0, sizeof(ifr));
+    ec.cmd = ETHTOOL_GCHANNELS;
+    strncpy(ifr.ifr_name, if_name, IFNAMSIZ - 1);
+    ifr.ifr_data = (char *)&ec;
+    if (ioctl(fd, SIOCETHTOOL, &ifr) == 0) {
+      /* NICs report their RSS queues as combined channels, rx-only
+       * channels, or both */
+      count = ec.combined_count + ec.rx_count;
+    }
+    close(fd);
+  }
+  if (count == 0) {
+    char path[MAX_FILENAME];
+    snprintf(path, sizeof(path), "/sys/class/net/%s/queues", if_name);
+    DIR *d = opendir(path);
+    if (d != NULL) {
+      struct dirent *de;
+      while ((de = readdir(d)) != NULL) {
+        if (strncmp(de->d_name, "rx-", 3) == 0) {
+          count++;
+        }
+      }
+      closedir(d);
+    }
+  }
+  return count;
+}
+
+/*
+ * fills cpus[] with the CPU servicing each of the interface's queue
+ * IRQs, in /proc/interrupts order (which is queue order for every
+ * driver we have seen); returns the number found, which is 0 when
+ * the device has no per-queue IRQs (virtual devices) or the IRQ
+ * names do not carry the interface name
+ */
+static int interface_irq_cpus(const char *if_name, int *cpus, int max_cpus) {
+  FILE *f = fopen("/proc/interrupts", "r");
+  char line[4096];
+  int count = 0;
+
+  if (f == NULL) {
+    return 0;
+  }
+  size_t name_len = strlen(if_name);
+  while (fgets(line, sizeof(line), f) != NULL && count < max_cpus) {
+    /* queue IRQs are named like "eth0-TxRx-3"; require a separator
+     * after the name so that eth1 does not match eth10 */
+    char *hit = strstr(line, if_name);
+    if (hit == NULL
+        || (hit != line && (isalnum(hit[-1]) || hit[-1] == '-'))
+        || (isalnum(hit[name_len]) && hit[name_len] != '\0')) {
+      continue;
+    }
+    int irq;
+    if (sscanf(line, " %d:", &irq) != 1) {
+      continue;
+    }
+    char path[MAX_FILENAME];
+    snprintf(path, sizeof(path), "/proc/irq/%d/smp_affinity_list", irq);
+    FILE *af = fopen(path, "r");
+    if (af == NULL) {
+      continue;
+    }
+    int cpu;
+    if (fscanf(af, "%d", &cpu) == 1) {
+      cpus[count++] = cpu;
+    }
+    fclose(af);
+  }
+  fclose(f);
+  return count;
+}
+
+int af_packet_interface_thread_count(const char *capture_interface) {
+  char *iface_string = strdup(capture_interface);
+  if (iface_string == NULL) {
+    return 0;
+  }
+  int total = 0;
+  for (char *name = strtok(iface_string, ","); name != NULL; name = strtok(NULL, ",")) {
+    int channels = interface_channel_count(name);
+    if (channels == 0) {
+      total = 0;   /* unknown for one interface; let the caller fall back */
+      break;
+    }
+    total += channels;
+  }
+  free(iface_string);
+  return total;
+}
+
+#ifdef PACKET_FANOUT_EBPF
+/*
+ * == eBPF fanout steering ==
+ *
+ * PACKET_FANOUT_HASH spreads packets by the kernel's flow hash, which
+ * only sees the outer headers; tunneled traffic (VXLAN, MPLS) from a
+ * single tunnel endpoint pair all lands on one worker, and any
+ * per-flow state kept in pkt_proc (e.g. the tcp_initial_message_filter)
+ * misses continuations when the kernel rehashes.  The program below is
+ * a BPF_PROG_TYPE_SOCKET_FILTER used with PACKET_FANOUT_EBPF; it skips
+ * up to three MPLS labels, decapsulates VXLAN, and hashes the inner
+ * 5-tuple.  Addresses and each port are folded in with XOR so both
+ * directions of a flow hash identically and stay on one worker.
+ *
+ * The program is assembled by hand (as in af_xdp.c) so that no
+ * clang/libbpf toolchain is needed; if the kernel can't load it we
+ * fall back to PACKET_FANOUT_HASH.
+ *
+ * Register use: r6 = skb (implicit for LD_ABS/LD_IND), r7 = hash
+ * accumulator, r8 = L3 header offset, r9 = L4 header offset.
+ */
+static int fanout_ebpf_prog_load(void) {
+  struct bpf_insn prog[] = {
+    /*  0 */ { BPF_ALU64 | BPF_MOV | BPF_X, 6, 1, 0, 0 },        /* r6 = skb            */
+    /*  1 */ { BPF_ALU64 | BPF_MOV | BPF_K, 7, 0, 0, 0 },        /* r7 = 0              */
+    /*  2 */ { BPF_ALU64 | BPF_MOV | BPF_K, 8, 0, 0, 14 },       /* r8 = sizeof(eth)    */
+    /*  3 */ { BPF_LD | BPF_ABS | BPF_H, 0, 0, 0, 12 },          /* r0 = ethertype      */
+    /*  4 */ { BPF_JMP | BPF_JNE | BPF_K, 0, 0, 12, 0x8847 },    /* not MPLS -> vers    */
+    /* skip up to three MPLS labels; stop at the bottom-of-stack bit */
+    /*  5 */ { BPF_LD | BPF_IND | BPF_B, 0, 8, 0, 2 },
+    /*  6 */ { BPF_ALU64 | BPF_AND | BPF_K, 0, 0, 0, 1 },
+    /*  7 */ { BPF_ALU64 | BPF_ADD | BPF_K, 8, 0, 0, 4 },
+    /*  8 */ { BPF_JMP | BPF_JNE | BPF_K, 0, 0, 8, 0 },          /* BOS -> vers         */
+    /*  9 */ { BPF_LD | BPF_IND | BPF_B, 0, 8, 0, 2 },
+    /* 10 */ { BPF_ALU64 | BPF_AND | BPF_K, 0, 0, 0, 1 },
+    /* 11 */ { BPF_ALU64 | BPF_ADD | BPF_K, 8, 0, 0, 4 },
+    /* 12 */ { BPF_JMP | BPF_JNE | BPF_K, 0, 0, 4, 0 },          /* BOS -> vers         */
+    /* 13 */ { BPF_LD | BPF_IND | BPF_B, 0, 8, 0, 2 },
+    /* 14 */ { BPF_ALU64 | BPF_AND | BPF_K, 0, 0, 0, 1 },
+    /* 15 */ { BPF_ALU64 | BPF_ADD | BPF_K, 8, 0, 0, 4 },
+    /* 16 */ { BPF_JMP | BPF_JNE | BPF_K, 0, 0, 0, 0 },
+    /* vers: dispatch on the IP version nibble at the L3 offset */
+    /* 17 */ { BPF_LD | BPF_IND | BPF_B, 0, 8, 0, 0 },
+    /* 18 */ { BPF_ALU64 | BPF_RSH | BPF_K, 0, 0, 0, 4 },
+    /* 19 */ { BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 2, 4 },          /* v4 -> parse_v4      */
+    /* 20 */ { BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 38, 6 },         /* v6 -> parse_v6      */
+    /* 21 */ { BPF_JMP | BPF_JA, 0, 0, 53, 0 },                  /* -> out              */
+    /* parse_v4: r9 = L4 offset, then fold addresses and protocol    */
+    /* 22 */ { BPF_LD | BPF_IND | BPF_B, 0, 8, 0, 0 },
+    /* 23 */ { BPF_ALU64 | BPF_AND | BPF_K, 0, 0, 0, 0x0f },
+    /* 24 */ { BPF_ALU64 | BPF_LSH | BPF_K, 0, 0, 0, 2 },
+    /* 25 */ { BPF_ALU64 | BPF_MOV | BPF_X, 9, 8, 0, 0 },
+    /* 26 */ { BPF_ALU64 | BPF_ADD | BPF_X, 9, 0, 0, 0 },
+    /* 27 */ { BPF_LD | BPF_IND | BPF_W, 0, 8, 0, 12 },          /* src addr            */
+    /* 28 */ { BPF_ALU64 | BPF_XOR | BPF_X, 7, 0, 0, 0 },
+    /* 29 */ { BPF_LD | BPF_IND | BPF_W, 0, 8, 0, 16 },          /* dst addr            */
+    /* 30 */ { BPF_ALU64 | BPF_XOR | BPF_X, 7, 0, 0, 0 },
+    /* 31 */ { BPF_LD | BPF_IND | BPF_B, 0, 8, 0, 9 },           /* protocol            */
+    /* 32 */ { BPF_ALU64 | BPF_XOR | BPF_X, 7, 0, 0, 0 },
+    /* 33 */ { BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 6, 17 },         /* UDP -> udp_check    */
+    /* 34 */ { BPF_JMP | BPF_JNE | BPF_K, 0, 0, 40, 6 },         /* not TCP -> out      */
+    /* ports: fold each port separately, so the hash is symmetric    */
+    /* 35 */ { BPF_LD | BPF_IND | BPF_H, 0, 9, 0, 0 },
+    /* 36 */ { BPF_ALU64 | BPF_XOR | BPF_X, 7, 0, 0, 0 },
+    /* 37 */ { BPF_LD | BPF_IND | BPF_H, 0, 9, 0, 2 },
+    /* 38 */ { BPF_ALU64 | BPF_XOR | BPF_X, 7, 0, 0, 0 },
+    /* 39 */ { BPF_JMP | BPF_JA, 0, 0, 35, 0 },                  /* -> out              */
+    /* udp_check: VXLAN (dst port 4789) means an inner frame follows */
+    /* 40 */ { BPF_LD | BPF_IND | BPF_H, 0, 9, 0, 2 },
+    /* 41 */ { BPF_JMP | BPF_JNE | BPF_K, 0, 0, -7, 4789 },      /* plain UDP -> ports  */
+    /* vxlan: inner L3 is past the VXLAN header and inner Ethernet   */
+    /* 42 */ { BPF_ALU64 | BPF_MOV | BPF_X, 8, 9, 0, 0 },
+    /* 43 */ { BPF_ALU64 | BPF_ADD | BPF_K, 8, 0, 0, 22 },
+    /* 44 */ { BPF_LD | BPF_IND | BPF_B, 0, 8, 0, 0 },
+    /* 45 */ { BPF_ALU64 | BPF_RSH | BPF_K, 0, 0, 0, 4 },
+    /* 46 */ { BPF_JMP | BPF_JNE | BPF_K, 0, 0, 28, 4 },         /* not inner v4 -> out */
+    /* 47 */ { BPF_LD | BPF_IND | BPF_W, 0, 8, 0, 12 },
+    /* 48 */ { BPF_ALU64 | BPF_XOR | BPF_X, 7, 0, 0, 0 },
+    /* 49 */ { BPF_LD | BPF_IND | BPF_W, 0, 8, 0, 16 },
+    /* 50 */ { BPF_ALU64 | BPF_XOR | BPF_X, 7, 0, 0, 0 },
+    /* 51 */ { BPF_LD | BPF_IND | BPF_B, 0, 8, 0, 9 },
+    /* 52 */ { BPF_ALU64 | BPF_XOR | BPF_X, 7, 0, 0, 0 },
+    /* 53 */ { BPF_LD | BPF_IND | BPF_B, 0, 8, 0, 0 },
+    /* 54 */ { BPF_ALU64 | BPF_AND | BPF_K, 0, 0, 0, 0x0f },
+    /* 55 */ { BPF_ALU64 | BPF_LSH | BPF_K, 0, 0, 0, 2 },
+    /* 56 */ { BPF_ALU64 | BPF_MOV | BPF_X, 9, 8, 0, 0 },
+    /* 57 */ { BPF_ALU64 | BPF_ADD | BPF_X, 9, 0, 0, 0 },
+    /* 58 */ { BPF_JMP | BPF_JA, 0, 0, -24, 0 },                 /* -> ports            */
+    /* parse_v6: fold half of each address, next header, and ports   */
+    /* 59 */ { BPF_LD | BPF_IND | BPF_W, 0, 8, 0, 8 },
+    /* 60 */ { BPF_ALU64 | BPF_XOR | BPF_X, 7, 0, 0, 0 },
+    /* 61 */ { BPF_LD | BPF_IND | BPF_W, 0, 8, 0, 20 },
+    /* 62 */ { BPF_ALU64 | BPF_XOR | BPF_X, 7, 0, 0, 0 },
+    /* 63 */ { BPF_LD | BPF_IND | BPF_W, 0, 8, 0, 24 },
+    /* 64 */ { BPF_ALU64 | BPF_XOR | BPF_X, 7, 0, 0, 0 },
+    /* 65 */ { BPF_LD | BPF_IND | BPF_W, 0, 8, 0, 36 },
+    /* 66 */ { BPF_ALU64 | BPF_XOR | BPF_X, 7, 0, 0, 0 },
+    /* 67 */ { BPF_LD | BPF_IND | BPF_B, 0, 8, 0, 6 },
+    /* 68 */ { BPF_ALU64 | BPF_XOR | BPF_X, 7, 0, 0, 0 },
+    /* 69 */ { BPF_ALU64 | BPF_MOV | BPF_X, 9, 8, 0, 0 },
+    /* 70 */ { BPF_ALU64 | BPF_ADD | BPF_K, 9, 0, 0, 40 },
+    /* 71 */ { BPF_LD | BPF_IND | BPF_H, 0, 9, 0, 0 },
+    /* 72 */ { BPF_ALU64 | BPF_XOR | BPF_X, 7, 0, 0, 0 },
+    /* 73 */ { BPF_LD | BPF_IND | BPF_H, 0, 9, 0, 2 },
+    /* 74 */ { BPF_ALU64 | BPF_XOR | BPF_X, 7, 0, 0, 0 },
+    /* out: mix the folded tuple so the low bits used by the modulo
+     * in the fanout demux are influenced by every input bit */
+    /* 75 */ { BPF_ALU64 | BPF_MOV | BPF_X, 0, 7, 0, 0 },
+    /* 76 */ { BPF_ALU64 | BPF_MUL | BPF_K, 0, 0, 0, 0x61C88647 },
+    /* 77 */ { BPF_ALU64 | BPF_RSH | BPF_K, 0, 0, 0, 17 },
+    /* 78 */ { BPF_JMP | BPF_EXIT, 0, 0, 0, 0 },
+  };
+  char license[] = "GPL";
+
+  union bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.prog_type = BPF_PROG_TYPE_SOCKET_FILTER;
+  attr.insns = (uint64_t)(uintptr_t)prog;
+  attr.insn_cnt = sizeof(prog) / sizeof(prog[0]);
+  attr.license = (uint64_t)(uintptr_t)license;
+
+  return syscall(__NR_bpf, BPF_PROG_LOAD, &attr, sizeof(attr));
+}
+#endif /* PACKET_FANOUT_EBPF */
+
+/*
+ * == Kernel prefilter ==
+ *
+ * When --select names only some protocols, every non-matching packet
+ * still crosses the ring and is rejected in userspace by
+ * packet_filter_apply().  The functions below generate a classic BPF
+ * program from the select string and attach it with SO_ATTACH_FILTER,
+ * so traffic that can't possibly match is dropped before it consumes
+ * ring memory.  The prefilter is deliberately coarse -- it only
+ * narrows by transport protocol and (when that is safe) by UDP port --
+ * and always passes a superset of what the userspace filter accepts.
+ */
+
+#define PREFILTER_MAX_INSNS 64
+
+enum prefilter_label {
+  label_next = 0,    /* fall through to the following instruction */
+  label_accept = 1,
+  label_drop = 2
+};
+
+struct prefilter_builder {
+  struct sock_filter insns[PREFILTER_MAX_INSNS];
+  int len;
+  /* jumps to accept/drop can't be resolved until the program is
+   * complete; each patch records (insn index << 2) | field, where
+   * field 0 = jt, 1 = jf, 2 = k (for BPF_JA) */
+  int patches[PREFILTER_MAX_INSNS];
+  int num_patches;
+  enum prefilter_label patch_labels[PREFILTER_MAX_INSNS];
+};
+
+static void prefilter_emit(struct prefilter_builder *b, uint16_t code, uint32_t k,
+                           enum prefilter_label jt, enum prefilter_label jf) {
+  if (b->len >= PREFILTER_MAX_INSNS) {
+    return;  /* can't happen with the fixed-shape programs below */
+  }
+  struct sock_filter *insn = &(b->insns[b->len]);
+  insn->code = code;
+  insn->k = k;
+  insn->jt = 0;
+  insn->jf = 0;
+  if (BPF_CLASS(code) == BPF_JMP && BPF_OP(code) == BPF_JA) {
+    if (jt != label_next) {
+      b->patch_labels[b->num_patches] = jt;
+      b->patches[b->num_patches++] = (b->len << 2) | 2;
+    }
+  } else if (BPF_CLASS(code) == BPF_JMP) {
+    if (jt != label_next) {
+      b->patch_labels[b->num_patches] = jt;
+      b->patches[b->num_patches++] = (b->len << 2) | 0;
+    }
+    if (jf != label_next) {
+      b->patch_labels[b->num_patches] = jf;
+      b->patches[b->num_patches++] = (b->len << 2) | 1;
+    }
+  }
+  b->len++;
+}
+
+/* emit UDP port checks: accept if either port is DNS or DHCP */
+static void prefilter_emit_port_checks(struct prefilter_builder *b, uint32_t sport_off, uint32_t dport_off,
+                                       bool want_dns, bool want_dhcp, int ldx_ip_hlen) {
+  if (ldx_ip_hlen) {
+    /* X = IPv4 header length, so the ports are at [x + offset] */
+    prefilter_emit(b, BPF_LDX | BPF_MSH | BPF_B, 14, label_next, label_next);
+  }
+  uint16_t mode = ldx_ip_hlen ? (BPF_LD | BPF_H | BPF_IND) : (BPF_LD | BPF_H | BPF_ABS);
+  for (int port_off = 0; port_off < 2; port_off++) {
+    prefilter_emit(b, mode, port_off ? dport_off : sport_off, label_next, label_next);
+    if (want_dns) {
+      prefilter_emit(b, BPF_JMP | BPF_JEQ | BPF_K, 53, label_accept, label_next);
+    }
+    if (want_dhcp) {
+      prefilter_emit(b, BPF_JMP | BPF_JEQ | BPF_K, 67, label_accept, label_next);
+      prefilter_emit(b, BPF_JMP | BPF_JEQ | BPF_K, 68, label_accept, label_next);
+    }
+  }
+  prefilter_emit(b, BPF_JMP | BPF_JA, 0, label_drop, label_next);
+}
+
+/*
+ * builds the prefilter for one address family starting at the current
+ * instruction; proto_off is the offset of the protocol/next-header
+ * byte and port_base is nonzero for IPv6, where the transport header
+ * is at a fixed offset (extension headers just get accepted)
+ */
+static void prefilter_emit_l4_checks(struct prefilter_builder *b, uint32_t proto_off, int fixed_l4_off,
+                                     bool accept_tcp, bool accept_all_udp, bool want_dns, bool want_dhcp) {
+  prefilter_emit(b, BPF_LD | BPF_B | BPF_ABS, proto_off, label_next, label_next);
+  if (accept_tcp) {
+    prefilter_emit(b, BPF_JMP | BPF_JEQ | BPF_K, 6, label_accept, label_next);
+  }
+  if (accept_all_udp) {
+    prefilter_emit(b, BPF_JMP | BPF_JEQ | BPF_K, 17, label_accept, label_drop);
+  } else if (want_dns || want_dhcp) {
+    prefilter_emit(b, BPF_JMP | BPF_JEQ | BPF_K, 17, label_next, label_drop);
+    if (fixed_l4_off) {
+      prefilter_emit_port_checks(b, fixed_l4_off, fixed_l4_off + 2, want_dns, want_dhcp, 0);
+    } else {
+      prefilter_emit_port_checks(b, 14, 16, want_dns, want_dhcp, 1);
+    }
+  } else {
+    prefilter_emit(b, BPF_JMP | BPF_JA, 0, label_drop, label_next);
+  }
+}
+
+/*
+ * generates and attaches the kernel prefilter corresponding to a
+ * select string; returns 0 on success (including the cases where no
+ * prefilter is applicable) and -1 on setsockopt() failure
+ */
+static int attach_kernel_prefilter(int sockfd, const char *filter_config) {
+
+  if (filter_config == NULL || strstr(filter_config, "all")) {
+    return 0;   /* everything is selected; a prefilter can't help */
+  }
+
+  bool accept_tcp = strstr(filter_config, "tcp") || strstr(filter_config, "tls")
+    || strstr(filter_config, "http") || strstr(filter_config, "ssh");
+  bool want_dns = strstr(filter_config, "dns") != NULL;
+  bool want_dhcp = strstr(filter_config, "dhcp") != NULL;
+  bool accept_all_udp = strstr(filter_config, "wireguard") != NULL;
+
+  struct prefilter_builder b;
+  memset(&b, 0, sizeof(b));
+
+  /* dispatch on the ethertype */
+  prefilter_emit(&b, BPF_LD | BPF_H | BPF_ABS, 12, label_next, label_next);
+  int v4_jump = b.len;
+  prefilter_emit(&b, BPF_JMP | BPF_JEQ | BPF_K, 0x0800, label_next, label_next);  /* patched below */
+  prefilter_emit(&b, BPF_JMP | BPF_JEQ | BPF_K, 0x86dd, label_next, label_drop);
+
+  /* IPv6: protocol byte at 20, transport header at 54 */
+  int v6_start = b.len;
+  prefilter_emit_l4_checks(&b, 14 + 6, 14 + 40, accept_tcp, accept_all_udp, want_dns, want_dhcp);
+
+  /* IPv4: protocol byte at 23, variable header length */
+  b.insns[v4_jump].jt = b.len - v4_jump - 1;
+  prefilter_emit_l4_checks(&b, 14 + 9, 0, accept_tcp, accept_all_udp, want_dns, want_dhcp);
+
+  /* the IPv6 branch above needs to skip over the v4 code; rewrite its
+   * entry jump: the v6 block was emitted right after the dispatch, so
+   * nothing to do -- the ethertype checks fall through into it */
+  (void)v6_start;
+
+  int drop_idx = b.len;
+  prefilter_emit(&b, BPF_RET | BPF_K, 0, label_next, label_next);
+  int accept_idx = b.len;
+  prefilter_emit(&b, BPF_RET | BPF_K, 0xffffffff, label_next, label_next);
+
+  /* resolve the accept/drop jumps */
+  for (int i = 0; i < b.num_patches; i++) {
+    int idx = b.patches[i] >> 2;
+    int field = b.patches[i] & 3;
+    int target = (b.patch_labels[i] == label_accept) ? accept_idx : drop_idx;
+    uint8_t off = target - idx - 1;
+    if (field == 0) {
+      b.insns[idx].jt = off;
+    } else if (field == 1) {
+      b.insns[idx].jf = off;
+    } else {
+      b.insns[idx].k = off;
+    }
+  }
+
+  struct sock_fprog fprog;
+  fprog.len = b.len;
+  fprog.filter = b.insns;
+  if (setsockopt(sockfd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) != 0) {
+    perror("error: could not attach kernel prefilter");
+    return -1;
+  }
+  return 0;
+}
+
 /*
  * == Signal handling ==
  *
@@ -146,14 +705,171 @@ void af_packet_stats(int sockfd, struct stats_tracking *statst) {
   }
 }
 
+/*
+ * == TX mirroring (--mirror) ==
+ *
+ * Each worker owns an AF_PACKET socket with an mmap()'d
+ * PACKET_TX_RING bound to the egress interface, and forwards the
+ * packets that match the packet filter to it: one memcpy() from the
+ * RX frame into a TX frame, within the capture thread, and one
+ * send() kick per ring block.  A downstream analysis appliance then
+ * sees exactly the fingerprint-bearing packets, with no second tap.
+ * The TX ring is per thread, so no locking; a full TX ring (the
+ * egress link is slower than the selected traffic) drops the mirror
+ * copy and is counted, but never blocks capture.  The TX ring uses
+ * the fixed-frame TPACKET_V2 format, which is the variant the kernel
+ * supports for transmit.
+ */
+
+#define TX_MIRROR_BLOCK_SIZE  (1 << 20)
+#define TX_MIRROR_BLOCK_NR    4
+#define TX_MIRROR_FRAME_SIZE  2048
+#define TX_MIRROR_FRAME_COUNT (TX_MIRROR_BLOCK_SIZE / TX_MIRROR_FRAME_SIZE * TX_MIRROR_BLOCK_NR)
+
+struct tx_mirror {
+  int fd;                    /* TX socket; never receives (bound with protocol 0) */
+  uint8_t *ring;             /* the mmap()'d PACKET_TX_RING */
+  size_t ring_size;
+  unsigned int frame_idx;    /* next TX frame to fill */
+  unsigned int pending;      /* frames marked since the last send() kick */
+  struct packet_filter pf;   /* the match decision; same config as --select */
+  uint64_t mirrored;         /* packets copied into the TX ring */
+  uint64_t ring_full;        /* matching packets dropped at a full TX ring */
+  uint64_t oversize;         /* matching packets larger than a TX frame */
+};
+
+static struct tx_mirror *tx_mirror_create(const char *if_name, const char *filter_config, int tnum) {
+  struct tx_mirror *m = (struct tx_mirror *)calloc(1, sizeof(struct tx_mirror));
+  if (m == NULL) {
+    return NULL;
+  }
+  if (packet_filter_init(&m->pf, filter_config) != status_ok) {
+    fprintf(stderr, "error: could not configure mirror packet filter for thread %d\n", tnum);
+    free(m);
+    return NULL;
+  }
+  m->fd = socket(AF_PACKET, SOCK_RAW, 0);   /* protocol 0: transmit only */
+  if (m->fd == -1) {
+    fprintf(stderr, "%s: could not create mirror socket for thread %d\n", strerror(errno), tnum);
+    free(m);
+    return NULL;
+  }
+  int version = TPACKET_V2;
+  int discard = 1;
+  int interface_number;
+  struct tpacket_req req;
+  struct sockaddr_ll bind_address;
+  if (setsockopt(m->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0) {
+    perror("could not set mirror socket to tpacket_v2 version");
+    goto fail;
+  }
+  /* a frame the driver rejects is discarded and counted by the
+   * kernel, instead of wedging the ring behind it */
+  if (setsockopt(m->fd, SOL_PACKET, PACKET_LOSS, &discard, sizeof(discard)) != 0) {
+    perror("could not set PACKET_LOSS on mirror socket");
+    goto fail;
+  }
+  memset(&req, 0, sizeof(req));
+  req.tp_block_size = TX_MIRROR_BLOCK_SIZE;
+  req.tp_block_nr = TX_MIRROR_BLOCK_NR;
+  req.tp_frame_size = TX_MIRROR_FRAME_SIZE;
+  req.tp_frame_nr = TX_MIRROR_FRAME_COUNT;
+  if (setsockopt(m->fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) != 0) {
+    perror("could not allocate PACKET_TX_RING for mirror socket");
+    goto fail;
+  }
+  m->ring_size = (size_t)req.tp_block_size * req.tp_block_nr;
+  m->ring = (uint8_t *)mmap(NULL, m->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, m->fd, 0);
+  if (m->ring == MAP_FAILED) {
+    perror("could not mmap PACKET_TX_RING for mirror socket");
+    goto fail;
+  }
+  interface_number = if_nametoindex(if_name);
+  if (interface_number == 0) {
+    fprintf(stderr, "Can't get interface number by mirror interface name (%s) for thread %d\n", if_name, tnum);
+    munmap(m->ring, m->ring_size);
+    goto fail;
+  }
+  memset(&bind_address, 0, sizeof(bind_address));
+  bind_address.sll_family = AF_PACKET;
+  bind_address.sll_protocol = 0;
+  bind_address.sll_ifindex = interface_number;
+  if (bind(m->fd, (struct sockaddr *)&bind_address, sizeof(bind_address)) != 0) {
+    fprintf(stderr, "%s: could not bind mirror socket to interface %s\n", strerror(errno), if_name);
+    munmap(m->ring, m->ring_size);
+    goto fail;
+  }
+  return m;
+
+ fail:
+  close(m->fd);
+  free(m);
+  return NULL;
+}
+
+static inline void tx_mirror_apply(struct tx_mirror *m, uint8_t *eth, size_t len) {
+  if (packet_filter_apply(&m->pf, eth, len) == false) {
+    return;
+  }
+  if (len > TX_MIRROR_FRAME_SIZE - TPACKET2_HDRLEN) {
+    m->oversize++;
+    return;
+  }
+  struct tpacket2_hdr *hdr = (struct tpacket2_hdr *)(m->ring + (size_t)m->frame_idx * TX_MIRROR_FRAME_SIZE);
+  if (hdr->tp_status != TP_STATUS_AVAILABLE) {
+    m->ring_full++;    /* the mirror never blocks capture */
+    return;
+  }
+  memcpy((uint8_t *)hdr + TPACKET2_HDRLEN - sizeof(struct sockaddr_ll), eth, len);
+  hdr->tp_len = len;
+  hdr->tp_status = TP_STATUS_SEND_REQUEST;
+  m->frame_idx = (m->frame_idx + 1) % TX_MIRROR_FRAME_COUNT;
+  m->pending++;
+  m->mirrored++;
+}
+
+/* hands the marked frames to the driver; called once per ring block */
+static inline void tx_mirror_flush(struct tx_mirror *m) {
+  if (m->pending == 0) {
+    return;
+  }
+  if (send(m->fd, NULL, 0, MSG_DONTWAIT) == -1 && errno != EAGAIN && errno != ENOBUFS) {
+    /* per-frame transmit errors are absorbed by PACKET_LOSS above;
+     * anything else here (link down, say) costs the marked frames,
+     * which the kernel will reclaim, and capture continues */
+  }
+  m->pending = 0;
+}
+
+static void tx_mirror_free(struct tx_mirror *m) {
+  if (m == NULL) {
+    return;
+  }
+  munmap(m->ring, m->ring_size);
+  close(m->fd);
+  delete m->pf.tcp_init_msg_filter;
+  free(m);
+}
+
 void process_all_packets_in_block(struct tpacket_block_desc *block_hdr,
-                                  struct stats_tracking *statst,
-                                  struct pkt_proc *pkt_processor) {
+                                  struct thread_stats *tstats,
+                                  struct pkt_proc *pkt_processor,
+                                  struct tx_mirror *mirror) {
   int num_pkts = block_hdr->hdr.bh1.num_pkts, i;
   unsigned long byte_count = 0;
   struct tpacket3_hdr *pkt_hdr;
-  //struct timespec ts;
-  struct packet_info pi;
+
+  /*
+   * the block's frames are gathered into descriptor arrays and handed
+   * to apply_block(), so that the processor's virtual dispatch is
+   * paid once per batch rather than once per packet; the batch size
+   * bounds the stack arrays, and a block holding more frames than
+   * that is simply applied in more than one batch
+   */
+  enum { pkt_batch_max = 256 };
+  struct packet_info pi[pkt_batch_max];
+  uint8_t *eth[pkt_batch_max];
+  size_t batch = 0;
 
   pkt_hdr = (struct tpacket3_hdr *) ((uint8_t *) block_hdr + block_hdr->hdr.bh1.offset_to_first_pkt);
   for (i = 0; i < num_pkts; ++i) {
@@ -166,23 +882,190 @@ void process_all_packets_in_block(struct tpacket_block_desc *block_hdr,
       byte_count += pkt_hdr->tp_snaplen;
 
     /* Grab the times */
-    pi.ts.tv_sec = pkt_hdr->tp_sec;
-    pi.ts.tv_nsec = pkt_hdr->tp_nsec;
+    pi[batch].ts.tv_sec = pkt_hdr->tp_sec;
+    pi[batch].ts.tv_nsec = pkt_hdr->tp_nsec;
 
-    pi.caplen = pkt_hdr->tp_snaplen;
-    pi.len = pkt_hdr->tp_snaplen;
+    pi[batch].caplen = pkt_hdr->tp_snaplen;
+    pi[batch].len = pkt_hdr->tp_snaplen;
 
-    uint8_t *eth = (uint8_t *)pkt_hdr + pkt_hdr->tp_mac;
-    pkt_processor->apply(&pi, eth);
+    eth[batch] = (uint8_t *)pkt_hdr + pkt_hdr->tp_mac;
+    if (mirror) {
+        tx_mirror_apply(mirror, eth[batch], pi[batch].caplen);
+    }
+    batch++;
+    if (batch == pkt_batch_max) {
+        mercury_probe1(pkt_apply_entry, batch);
+        pkt_processor->apply_block(pi, eth, batch);
+        mercury_probe1(pkt_apply_exit, batch);
+        batch = 0;
+    }
 
     pkt_hdr = (struct tpacket3_hdr *) ((uint8_t *)pkt_hdr + pkt_hdr->tp_next_offset);
   }
+  if (batch) {
+      mercury_probe1(pkt_apply_entry, batch);
+      pkt_processor->apply_block(pi, eth, batch);
+      mercury_probe1(pkt_apply_exit, batch);
+  }
+  if (mirror) {
+      tx_mirror_flush(mirror);   /* one send() kick covers the whole block */
+  }
 
-  /* Atomic operations
-   * https://gcc.gnu.org/onlinedocs/gcc-4.1.0/gcc/Atomic-Builtins.html
+  /* These counters belong to this thread alone, so no atomic
+   * operation (and no cross-core cache line transfer) is needed
    */
-  __sync_add_and_fetch(&(statst->received_packets), num_pkts);
-  __sync_add_and_fetch(&(statst->received_bytes), byte_count);
+  tstats->received_packets += num_pkts;
+  tstats->received_bytes += byte_count;
+}
+
+/*
+ * Work stealing across the capture workers.  PACKET_FANOUT_HASH
+ * assigns flows to threads statically, and one elephant flow (or a
+ * tunnel whose outer headers hash identically) can pin a single
+ * thread at 100% while the others idle in poll().  When a worker
+ * finds a deep backlog of returned blocks behind the one it is
+ * processing, it offers the excess blocks on a shared deque; a worker
+ * whose own ring is empty claims one and parses it with its own
+ * packet processor, so the stolen work lands in the thief's output
+ * queue and per-thread state, and every ring stays single-consumer.
+ *
+ * The owner keeps release order: when it reaches an offered block it
+ * withdraws the offer if no one claimed it, or waits for the thief to
+ * finish, before handing the block back to the kernel -- a stolen
+ * block's frames stay mapped for as long as the thief needs them.
+ * Stealing is rare (it only happens when the load is already
+ * lopsided), so a mutex-protected array is plenty.
+ */
+#define STEAL_DEQUE_SIZE 64
+#define STEAL_FILL_THRESHOLD 4   /* pending blocks kept for the owner before offering the rest */
+
+enum steal_state {
+    steal_state_empty = 0,
+    steal_state_offered,
+    steal_state_claimed,
+    steal_state_done
+};
+
+struct steal_entry {
+    struct tpacket_block_desc *block;
+    volatile enum steal_state state;
+};
+
+static struct {
+    pthread_mutex_t lock;
+    struct steal_entry entry[STEAL_DEQUE_SIZE];
+    volatile int offers;     /* offered entries, checked without the lock  */
+    uint64_t stolen;         /* blocks parsed by a thief (final summary)   */
+    int enabled;             /* multi-worker capture only                  */
+} steal_deque = { PTHREAD_MUTEX_INITIALIZER, {}, 0, 0, 0 };
+
+/*
+ * steal_offer_excess() counts the run of kernel-returned blocks
+ * behind the current one and offers everything beyond the threshold;
+ * block_offered is the owner's bookkeeping, so a block is never
+ * offered twice
+ */
+static void steal_offer_excess(struct tpacket_block_desc **block_header,
+                               uint8_t *block_offered,
+                               unsigned int cb,
+                               uint32_t thread_block_count) {
+    unsigned int fill = 0;
+    while (fill + 1 < thread_block_count) {
+        unsigned int idx = (cb + fill + 1) % thread_block_count;
+        if ((block_header[idx]->hdr.bh1.block_status & TP_STATUS_USER) == 0) {
+            break;
+        }
+        fill++;
+    }
+    if (fill <= STEAL_FILL_THRESHOLD) {
+        return;    /* a backlog the owner can clear on its own */
+    }
+    pthread_mutex_lock(&steal_deque.lock);
+    for (unsigned int k = STEAL_FILL_THRESHOLD + 1; k <= fill; k++) {
+        unsigned int idx = (cb + k) % thread_block_count;
+        if (block_offered[idx]) {
+            continue;
+        }
+        int slot;
+        for (slot = 0; slot < STEAL_DEQUE_SIZE; slot++) {
+            if (steal_deque.entry[slot].state == steal_state_empty) {
+                break;
+            }
+        }
+        if (slot == STEAL_DEQUE_SIZE) {
+            break;     /* the deque is full; the rest stays with the owner */
+        }
+        steal_deque.entry[slot].block = block_header[idx];
+        steal_deque.entry[slot].state = steal_state_offered;
+        steal_deque.offers++;
+        block_offered[idx] = 1;
+    }
+    pthread_mutex_unlock(&steal_deque.lock);
+}
+
+/*
+ * steal_try() claims one offered block and parses it with the
+ * caller's own processor and counters (and its own TX mirror, when
+ * mirroring); returns 1 if a block was stolen.  Called by a worker
+ * whose own ring is empty.
+ */
+static int steal_try(struct thread_stats *tstats, struct pkt_proc *pkt_processor, struct tx_mirror *mirror) {
+    struct steal_entry *e = NULL;
+
+    if (steal_deque.offers == 0) {
+        return 0;      /* unlocked check; offers only matter when the load is lopsided */
+    }
+    pthread_mutex_lock(&steal_deque.lock);
+    for (int slot = 0; slot < STEAL_DEQUE_SIZE; slot++) {
+        if (steal_deque.entry[slot].state == steal_state_offered) {
+            e = &steal_deque.entry[slot];
+            e->state = steal_state_claimed;
+            steal_deque.offers--;
+            steal_deque.stolen++;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&steal_deque.lock);
+    if (e == NULL) {
+        return 0;
+    }
+    process_all_packets_in_block(e->block, tstats, pkt_processor, mirror);
+    pkt_processor->block_boundary();   /* the frames stay mapped until the owner sees done */
+    e->state = steal_state_done;
+    return 1;
+}
+
+/*
+ * steal_resolve() is called by the owner when it reaches a block it
+ * offered: an unclaimed offer is withdrawn (and the owner processes
+ * the block itself, so returns 0), a claimed one is waited out
+ * (returns 1, and the owner just releases the block)
+ */
+static int steal_resolve(struct tpacket_block_desc *block) {
+    struct steal_entry *e = NULL;
+
+    pthread_mutex_lock(&steal_deque.lock);
+    for (int slot = 0; slot < STEAL_DEQUE_SIZE; slot++) {
+        if (steal_deque.entry[slot].state != steal_state_empty
+            && steal_deque.entry[slot].block == block) {
+            e = &steal_deque.entry[slot];
+            if (e->state == steal_state_offered) {
+                e->state = steal_state_empty;   /* withdrawn; the owner takes it back */
+                steal_deque.offers--;
+                e = NULL;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&steal_deque.lock);
+    if (e == NULL) {
+        return 0;
+    }
+    while (e->state != steal_state_done && sig_close_workers == 0) {
+        usleep(5);    /* the thief is mid-block; this is rare and brief */
+    }
+    e->state = steal_state_empty;
+    return 1;
 }
 
 void check_socket_drops(int duration, uint64_t sdps, uint64_t sfps, int *socket_drops, int *zero_drops) {
@@ -207,10 +1090,96 @@ void check_socket_drops(int duration, uint64_t sdps, uint64_t sfps, int *socket_
     }
 }
 
+/*
+ * check_filter_threshold() closes a second adaptation loop for
+ * --adaptive captures: the packet filter's byte threshold (see
+ * packet_filter_apply()) doubles while the kernel is dropping packets
+ * or a ring is more than half full, so that only the packets whose
+ * extractions carry the most metadata are written while the capture
+ * is behind, and it halves back toward its static minimum after a
+ * minute of quiet, restoring full-fidelity filtering.  This replaces
+ * the per-site hand tuning of packet_filter_threshold, which was
+ * stale whenever the traffic changed.  The threshold is a single
+ * aligned store; the workers read it racily, which only makes a
+ * change take effect a packet late.
+ */
+#define FILTER_THRESHOLD_MIN 7    /* the static default; TCP SYN extractions pass  */
+#define FILTER_THRESHOLD_MAX 112  /* TLS hellos and HTTP headers still pass        */
+
+void check_filter_threshold(uint64_t sdps, double worst_rusage, int *quiet_seconds) {
+    unsigned int t = packet_filter_threshold;
+    if (sdps > 0 || worst_rusage > 0.5) {
+        *quiet_seconds = 0;
+        if (t * 2 <= FILTER_THRESHOLD_MAX) {
+            packet_filter_threshold = t * 2;
+            fprintf(stderr, "  Packet filter threshold Increased to %u bytes\n", t * 2);
+        }
+    } else if (t > FILTER_THRESHOLD_MIN) {
+        (*quiet_seconds)++;
+        if (*quiet_seconds >= 60) {
+            *quiet_seconds = 0;
+            unsigned int nt = (t / 2 > FILTER_THRESHOLD_MIN) ? t / 2 : FILTER_THRESHOLD_MIN;
+            packet_filter_threshold = nt;
+            fprintf(stderr, "  Packet filter threshold Decreased to %u bytes\n", nt);
+        }
+    }
+}
+
+/*
+ * struct queue_totals holds the output-queue telemetry summed across
+ * all queues by output_queue_totals(); each loss point in the
+ * pipeline has its own counter here, so that a drop can be attributed
+ * to the resource that caused it (see the reconciliation table in the
+ * final report).  The counters are written only by their producers
+ * and read without locks, so the totals are approximate, which is
+ * fine for telemetry.
+ */
+struct queue_totals {
+    uint64_t drops;           /* records lost at full output queues */
+    uint64_t filtered;        /* packets that produced no record, by filter policy */
+    uint64_t truncated;       /* records abandoned at the record size cap */
+    uint64_t stall_usec;      /* microseconds producers spent stalled on full queues */
+    int depth_hwm;            /* worst queue depth high-watermark, in bytes */
+    uint64_t records_written; /* records retired to the output destination */
+};
+
+void output_queue_totals(struct thread_queues *tqs, struct queue_totals *qt) {
+    memset(qt, 0, sizeof(*qt));
+    if (tqs == NULL) {
+       return;
+    }
+    for (int q = 0; q < tqs->qnum; q++) {
+       qt->drops += tqs->queue[q].enqueue_drops;
+       qt->filtered += tqs->queue[q].filtered;
+       qt->truncated += tqs->queue[q].truncated;
+       qt->stall_usec += tqs->queue[q].stall_usec;
+       if (tqs->queue[q].depth_hwm > qt->depth_hwm) {
+          qt->depth_hwm = tqs->queue[q].depth_hwm;
+       }
+    }
+    qt->records_written = tqs->records_written;
+}
+
+/*
+ * the stats_tracking struct of the running capture, kept so that the
+ * runtime control socket (control.c) can retune the stats JSON
+ * interval without a restart; the stats thread re-reads the interval
+ * each time it emits a record, so a new value takes effect when the
+ * current interval expires
+ */
+static struct stats_tracking *stats_tracking_live = NULL;
+
+void af_packet_stats_set_interval(int seconds) {
+    struct stats_tracking *statst = stats_tracking_live;
+    if (statst != NULL && seconds > 0) {
+        statst->stats_interval = seconds;
+    }
+}
+
 void *stats_thread_func(void *statst_arg) {
 
     struct stats_tracking *statst = (struct stats_tracking *)statst_arg;
-    int duration = 0, socket_drops = 0, zero_drops = 0;
+    int duration = 0, socket_drops = 0, zero_drops = 0, quiet_seconds = 0;
 
   /* The stats thread is one of the first to get started and it has to wait
    * for the other threads otherwise we'll be tracking bogus stats
@@ -244,12 +1213,43 @@ void *stats_thread_func(void *statst_arg) {
    */
   enable_all_signals();
 
+  /* per-protocol parse-cost sampling is only worth its (small) cost
+   * when the periodic report that uses it will be printed */
+  extractor_stats_set_cycle_sampling(statst->verbosity != 0
+                                     || statst->stats_json_filename != NULL);
+
+  /* heavy-hitter telemetry (see hh_sketch.h) is only collected when
+   * the periodic JSON report that carries it will be written */
+  hh_sketch_set_enabled(statst->stats_json_filename != NULL);
+  struct extractor_protocol_stats proto_before, proto_now;
+  struct latency_histogram latency_before;
+  memset(&latency_before, 0, sizeof(latency_before));
+
+  /* the machine-readable stats channel (--stats-json); opened here,
+   * after the clean start condition, so that the file is created
+   * after privileges have been dropped */
+  FILE *stats_json_file = NULL;
+  int stats_json_countdown = statst->stats_interval;
+  if (statst->stats_json_filename != NULL) {
+    stats_json_file = fopen(statst->stats_json_filename, "a");
+    if (stats_json_file == NULL) {
+      fprintf(stderr, "warning: could not open stats JSON file %s (%s)\n",
+              statst->stats_json_filename, strerror(errno));
+    }
+  }
+
   while (sig_close_flag == 0) {
     uint64_t packets_before = statst->received_packets;
     uint64_t bytes_before = statst->received_bytes;
+    extractor_stats_sum(&proto_before);
+    if (statst->tqs != NULL) {
+      latency_before = statst->tqs->latency;   /* single writer; a plain copy suffices */
+    }
     uint64_t socket_packets_before = statst->socket_packets;
     uint64_t socket_drops_before = statst->socket_drops;
     uint64_t socket_freezes_before = statst->socket_freezes;
+    struct queue_totals qt_before;
+    output_queue_totals(statst->tqs, &qt_before);
 
     (void)time_elapsed(&ts); /* Fills out the struct for us */
 
@@ -269,9 +1269,16 @@ void *stats_thread_func(void *statst_arg) {
     double tot_rusage = 0;   /* Sum of all threads rusage */
     double worst_rusage = 0; /* Worst average rbuffer usage */
     double worst_i_rusage = 0; /* Worst instantaneous rbuffer usage */
+    uint64_t tot_packets = 0;   /* Sum of the per-thread counters */
+    uint64_t tot_bytes = 0;
     for (int thread = 0; thread < statst->num_threads; thread++) {
       af_packet_stats(statst->tstor[thread].sockfd, statst);
 
+      /* Sample this thread's counters; each has a single writer so a
+       * plain read suffices */
+      tot_packets += statst->tstor[thread].stats.received_packets;
+      tot_bytes += statst->tstor[thread].stats.received_bytes;
+
       int thread_block_count = statst->tstor[thread].ring_params.tp_block_nr;
       double *bstreak_hist = statst->tstor[thread].block_streak_hist;
 
@@ -316,6 +1323,27 @@ void *stats_thread_func(void *statst_arg) {
 	exit(255);
       }
 
+      /* Close the loop on the streak histogram: under load (the
+       * average streak is at least one block) halve the thread's
+       * poll timeout so it reacts quickly, and when idle double it
+       * to cut wakeups.  Multiplicative moves track our strongly
+       * diurnal traffic without a static tuning that is wrong for
+       * half the day.
+       */
+      int tmo = statst->tstor[thread].poll_timeout_ms;
+      if (rusage * thread_block_count >= 1.0) {
+	tmo /= 2;
+	if (tmo < AF_POLL_TIMEOUT_MIN) {
+	  tmo = AF_POLL_TIMEOUT_MIN;
+	}
+      } else {
+	tmo *= 2;
+	if (tmo > AF_POLL_TIMEOUT_MAX) {
+	  tmo = AF_POLL_TIMEOUT_MAX;
+	}
+      }
+      statst->tstor[thread].poll_timeout_ms = tmo;
+
       //fprintf(stderr, "[thread %d] Got ring usage of %4f\n", thread, rusage);
       tot_rusage += rusage;
       if (rusage > worst_rusage) {
@@ -323,6 +1351,10 @@ void *stats_thread_func(void *statst_arg) {
       }
     }
 
+    /* Publish the aggregated counters */
+    statst->received_packets = tot_packets;
+    statst->received_bytes = tot_bytes;
+
     /* The per-second stats scaled by the time delta */
     double pps  = (statst->received_packets - packets_before) / time_d;      /* packets */
     double byps  = (statst->received_bytes - bytes_before) / time_d;         /* bytes */
@@ -332,6 +1364,13 @@ void *stats_thread_func(void *statst_arg) {
     uint64_t sdps = statst->socket_drops - socket_drops_before;
     uint64_t sfps = statst->socket_freezes - socket_freezes_before;
 
+    /* The output-queue stats, kept distinct from the kernel ring
+     * stats so drops can be attributed to the right resource */
+    struct queue_totals qt;
+    output_queue_totals(statst->tqs, &qt);
+    uint64_t qdps = qt.drops - qt_before.drops;                 /* records dropped at full output queues */
+    uint64_t qsms = (qt.stall_usec - qt_before.stall_usec) / 1000;  /* ms spent stalled waiting on full queues */
+
     /* Compute the estimated Ethernet rate which accounts for the
      * "extra" per-packet data including the:
      * interpacket gap (12 bytes)
@@ -376,21 +1415,119 @@ void *stats_thread_func(void *statst_arg) {
                 "%7.03f%s Packets/s; Data Rate %7.03f%s bytes/s; "
                 "Ethernet Rate (est.) %7.03f%s bits/s; "
                 "Socket Packets %7.03f%s; Socket Drops %" PRIu64 " (packets); Socket Freezes %" PRIu64 "; "
+                "Output Queue Drops %" PRIu64 " (records); Output Stall %" PRIu64 " ms; Worst queue hwm %4.1f%%; "
                 "All threads avg. rbuf %4.1f%%; Worst thread avg. rbuf %4.1f%%; Worst instantaneous rbuf %4.1f%%\n",
                 r_pps, r_pps_s, r_byps, r_byps_s,
                 r_ebips, r_ebips_s,
                 r_spps, r_spps_s, sdps, sfps,
+                qdps, qsms, ((double)qt.depth_hwm / LLQ_BUF_SIZE) * 100.0,
                 (tot_rusage / (statst->num_threads)) * 100.0, worst_rusage * 100.0,
                 worst_i_rusage * 100.0);
+
+        /* capture-to-write latency percentiles over this interval,
+         * from the output thread's histogram */
+        if (statst->tqs != NULL) {
+            const struct latency_histogram *latency_now = &statst->tqs->latency;
+            fprintf(stderr,
+                    "Output Latency: p50 %.3f ms; p99 %.3f ms; p999 %.3f ms\n",
+                    latency_histogram_percentile(latency_now, &latency_before, 0.50) / 1e6,
+                    latency_histogram_percentile(latency_now, &latency_before, 0.99) / 1e6,
+                    latency_histogram_percentile(latency_now, &latency_before, 0.999) / 1e6);
+        }
+
+        /* the per-protocol counters merged from the worker threads,
+         * reported only for the protocols seen in this interval; the
+         * average parse cost comes from the sampled packets */
+        extractor_stats_sum(&proto_now);
+        fprintf(stderr, "Protocols:");
+        for (int type = 0; type < EXTRACTOR_STATS_NUM_MSG_TYPES; type++) {
+            uint64_t proto_packets = proto_now.packets[type] - proto_before.packets[type];
+            if (proto_packets == 0) {
+                continue;
+            }
+            uint64_t proto_bytes = proto_now.bytes[type] - proto_before.bytes[type];
+            uint64_t sampled_packets = proto_now.sampled_packets[type] - proto_before.sampled_packets[type];
+            uint64_t sampled_cycles = proto_now.sampled_cycles[type] - proto_before.sampled_cycles[type];
+            fprintf(stderr, " %s %" PRIu64 " packets, %" PRIu64 " bytes",
+                    msg_type_string((enum msg_type)type), proto_packets, proto_bytes);
+            if (sampled_packets > 0 && sampled_cycles > 0) {
+                fprintf(stderr, ", %" PRIu64 " cycles/packet", sampled_cycles / sampled_packets);
+            }
+            fprintf(stderr, ";");
+        }
+        fprintf(stderr, "\n");
+    }
+
+    /* the machine-readable counterpart of the report above: one
+     * cumulative JSON record per interval (--stats-json), so fleet
+     * telemetry can ingest the counters without parsing the
+     * human-readable text */
+    if (stats_json_file != NULL && --stats_json_countdown == 0) {
+      stats_json_countdown = statst->stats_interval;
+      extractor_stats_sum(&proto_now);
+      fprintf(stats_json_file,
+              "{\"mercury_stats\":{\"time\":%ld"
+              ",\"received_packets\":%" PRIu64 ",\"received_bytes\":%" PRIu64
+              ",\"socket_packets\":%" PRIu64 ",\"socket_drops\":%" PRIu64
+              ",\"socket_freezes\":%" PRIu64,
+              (long)time(NULL),
+              statst->received_packets, statst->received_bytes,
+              statst->socket_packets, statst->socket_drops, statst->socket_freezes);
+      if (statst->tqs != NULL) {
+        fprintf(stats_json_file,
+                ",\"queue_drops\":%" PRIu64 ",\"filtered_packets\":%" PRIu64
+                ",\"truncated_records\":%" PRIu64 ",\"records_written\":%" PRIu64
+                ",\"queue_stall_usec\":%" PRIu64
+                ",\"queue_depth_hwm_pct\":%.1f,\"file_rotations\":%" PRIu64
+                ",\"latency_ns\":{\"p50\":%" PRIu64 ",\"p99\":%" PRIu64 ",\"p999\":%" PRIu64 "}",
+                qt.drops, qt.filtered, qt.truncated, qt.records_written,
+                qt.stall_usec,
+                ((double)qt.depth_hwm / LLQ_BUF_SIZE) * 100.0,
+                statst->tqs->rotations,
+                latency_histogram_percentile(&statst->tqs->latency, NULL, 0.50),
+                latency_histogram_percentile(&statst->tqs->latency, NULL, 0.99),
+                latency_histogram_percentile(&statst->tqs->latency, NULL, 0.999));
+      }
+      fprintf(stats_json_file, ",\"protocols\":{");
+      const char *sep = "";
+      for (int type = 0; type < EXTRACTOR_STATS_NUM_MSG_TYPES; type++) {
+        if (proto_now.packets[type] == 0) {
+          continue;
+        }
+        fprintf(stats_json_file, "%s\"%s\":{\"packets\":%" PRIu64 ",\"bytes\":%" PRIu64,
+                sep, msg_type_string((enum msg_type)type),
+                proto_now.packets[type], proto_now.bytes[type]);
+        if (proto_now.sampled_packets[type] > 0) {
+          fprintf(stats_json_file, ",\"cycles_per_packet\":%" PRIu64,
+                  proto_now.sampled_cycles[type] / proto_now.sampled_packets[type]);
+        }
+        fprintf(stats_json_file, "}");
+        sep = ",";
+      }
+      fprintf(stats_json_file, "}");
+      hh_sketch_report_json(stats_json_file);
+      fprintf(stats_json_file, "}}\n");
+      fflush(stats_json_file);
+    }
+
+    /* a memory accounting report was requested with SIGUSR1 */
+    if (sig_memory_report_flag) {
+      sig_memory_report_flag = 0;
+      memory_report_print(stderr);
     }
 
     duration++;
     if (get_percent_accept() > 0) {
         /* check socket drops and update accept percentage only when percent accept > 0 */
         check_socket_drops(duration, sdps, sfps, &socket_drops, &zero_drops);
+        check_filter_threshold(sdps, worst_rusage, &quiet_seconds);
     }
   }
 
+  if (stats_json_file != NULL) {
+    fclose(stats_json_file);
+  }
+
   return NULL;
 }
 
@@ -404,7 +1541,7 @@ void *stats_thread_func(void *statst_arg) {
  *  https://www.kernel.org/doc/Documentation/networking/packet_mmap.txt
  */
 
-int create_dedicated_socket(struct thread_storage *thread_stor, int fanout_arg) {
+int create_dedicated_socket(struct thread_storage *thread_stor, int fanout_arg, const char *filter_config) {
   int err;
   int sockfd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
   if (sockfd == -1) {
@@ -448,28 +1585,116 @@ int create_dedicated_socket(struct thread_storage *thread_stor, int fanout_arg)
   }
 
   /*
-   * set up RX_RING
+   * ask the NIC to timestamp received packets in hardware, and the
+   * ring to carry those stamps in tpacket3_hdr's tp_sec/tp_nsec, so
+   * that the packet_info.ts handed to the packet processors (and the
+   * JSON time field) comes from the NIC clock instead of the kernel's.
+   * NICs without receive timestamping make the ioctl fail, and the
+   * kernel then falls back to its own stamps, so failure here is only
+   * worth a warning.
+   */
+#ifdef SOF_TIMESTAMPING_RAW_HARDWARE
+  struct hwtstamp_config hwts_config;
+  memset(&hwts_config, 0, sizeof(hwts_config));
+  hwts_config.tx_type = HWTSTAMP_TX_OFF;
+  hwts_config.rx_filter = HWTSTAMP_FILTER_ALL;
+  struct ifreq hwts_ifr;
+  memset(&hwts_ifr, 0, sizeof(hwts_ifr));
+  strncpy(hwts_ifr.ifr_name, thread_stor->if_name, sizeof(hwts_ifr.ifr_name) - 1);
+  hwts_ifr.ifr_data = (char *)&hwts_config;
+  if (ioctl(sockfd, SIOCSHWTSTAMP, &hwts_ifr) != 0) {
+    fprintf(stderr, "warning: interface %s cannot timestamp packets in hardware; using kernel timestamps\n",
+            thread_stor->if_name);
+  } else {
+    int tstamp_req = SOF_TIMESTAMPING_RAW_HARDWARE;
+    err = setsockopt(sockfd, SOL_PACKET, PACKET_TIMESTAMP, &tstamp_req, sizeof(tstamp_req));
+    if (err) {
+      fprintf(stderr, "warning: could not enable hardware timestamps for thread %d\n", thread_stor->tnum);
+    }
+  }
+#endif
+
+  /*
+   * in busy-poll mode, ask the kernel to busy-poll the device queue
+   * for the same budget whenever we do end up blocking in poll();
+   * SO_BUSY_POLL may be unsupported or restricted, so failure here
+   * just costs latency and is not fatal
+   */
+#ifdef SO_BUSY_POLL
+  if (thread_stor->busy_poll_usecs > 0) {
+    err = setsockopt(sockfd, SOL_SOCKET, SO_BUSY_POLL,
+                     &(thread_stor->busy_poll_usecs), sizeof(thread_stor->busy_poll_usecs));
+    if (err) {
+      fprintf(stderr, "warning: could not enable SO_BUSY_POLL for thread %d\n", thread_stor->tnum);
+    }
+  }
+#endif
+
+  /*
+   * attach the kernel prefilter (if the protocol selection allows
+   * one) before the RX_RING exists, so that filtered-out traffic
+   * never occupies a ring block
+   */
+  if (attach_kernel_prefilter(sockfd, filter_config) != 0) {
+    return -1;
+  }
+
+  /*
+   * set up RX_RING; the kernel allocates the ring blocks during this
+   * setsockopt(), so bind the allocation to the NIC's NUMA node here
    */
   fprintf(stderr, "Requesting PACKET_RX_RING with %u bytes (%d blocks of size %d) for thread %d\n",
 	  thread_stor->ring_params.tp_block_size * thread_stor->ring_params.tp_block_nr,
 	  thread_stor->ring_params.tp_block_nr, thread_stor->ring_params.tp_block_size, thread_stor->tnum);
+  if (thread_stor->numa_node >= 0) {
+    if (set_mempolicy_node(MPOL_BIND, thread_stor->numa_node) != 0) {
+      fprintf(stderr, "warning: could not bind ring allocation to NUMA node %d for thread %d\n",
+              thread_stor->numa_node, thread_stor->tnum);
+    }
+  }
   err = setsockopt(sockfd, SOL_PACKET, PACKET_RX_RING, (void*)&(thread_stor->ring_params), sizeof(thread_stor->ring_params));
+  if (thread_stor->numa_node >= 0) {
+    set_mempolicy_node(MPOL_DEFAULT, -1);  /* restore the default policy */
+  }
   if (err == -1) {
     perror("could not enable RX_RING for AF_PACKET socket");
     return -1;
   }
 
   /*
-   * each thread has its own mmaped buffer
+   * each thread has its own mmaped buffer.  A packet socket's ring
+   * pages are allocated by the kernel, so the mapping can't be
+   * hugetlb-backed (MAP_HUGETLB fails on a socket fd); instead we ask
+   * for huge page table entries with MADV_HUGEPAGE where available,
+   * and use MAP_LOCKED | MAP_POPULATE so every page is faulted in and
+   * pinned at startup rather than during the first traffic burst
    */
-  uint8_t *mapped_buffer = (uint8_t*)mmap(NULL, thread_stor->ring_params.tp_block_size * thread_stor->ring_params.tp_block_nr,
-					  PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED,
+  size_t ring_size = (size_t)thread_stor->ring_params.tp_block_size * thread_stor->ring_params.tp_block_nr;
+  uint8_t *mapped_buffer = (uint8_t*)mmap(NULL, ring_size,
+					  PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED | MAP_POPULATE,
 					  sockfd, 0);
   if (mapped_buffer == MAP_FAILED) {
     fprintf(stderr, "%s: mmap failed for thread %d\n", strerror(errno), thread_stor->tnum);
     return -1;
   }
 
+#ifdef MADV_HUGEPAGE
+  /* best effort; the ring blocks are already physically contiguous,
+   * so a kernel that honors this collapses them into huge PTEs and
+   * takes the dTLB-miss tax out of the capture loop */
+  madvise(mapped_buffer, ring_size, MADV_HUGEPAGE);
+#endif
+
+  /* prefault: touch one byte per page so that no first-touch fault
+   * (or TLB fill from an unwarmed page table) lands in the capture
+   * loop; MAP_POPULATE should have done this already, but the cost of
+   * making sure is trivial at startup */
+  volatile uint8_t prefault_sink = 0;
+  for (size_t offset = 0; offset < ring_size; offset += 4096) {
+    prefault_sink += mapped_buffer[offset];
+  }
+  (void)prefault_sink;
+
   /* Now store this mmap()'d region in the thread storage */
   thread_stor->mapped_buffer = mapped_buffer;
 
@@ -565,10 +1790,11 @@ int af_packet_rx_ring_fanout_capture(struct thread_storage *thread_stor) {
    */
   int sockfd = thread_stor->sockfd;
   struct tpacket_block_desc **block_header = thread_stor->block_header;
-  struct stats_tracking *statst = thread_stor->statst;
+  struct thread_stats *tstats = &(thread_stor->stats);
   double *block_streak_hist = thread_stor->block_streak_hist;
   pthread_mutex_t *bstreak_m = &(thread_stor->bstreak_m);
   struct pkt_proc *pkt_processor = thread_stor->pkt_processor;
+  int busy_poll_usecs = thread_stor->busy_poll_usecs;
 
   /* We got the clean start all clear so we can get started but
    * while we were waiting our socket was filling up with packets
@@ -709,10 +1935,40 @@ int af_packet_rx_ring_fanout_capture(struct thread_storage *thread_stor) {
 	}
       }
 
+      /* Our own ring is empty; before sleeping, try to steal a
+       * backlogged block from an overloaded worker
+       */
+      if (steal_deque.enabled && steal_try(tstats, pkt_processor, thread_stor->mirror)) {
+	continue;
+      }
+
+      /* In busy-poll mode, spin on the block status for the spin
+       * budget before sleeping in poll(); a block retired by the
+       * kernel during the spin is picked up within a few cycles
+       * instead of after a scheduler wakeup
+       */
+      if (busy_poll_usecs > 0) {
+	int block_ready = 0;
+	struct timespec spin_start, spin_now;
+	clock_gettime(CLOCK_MONOTONIC, &spin_start);
+	do {
+	  if ((block_header[cb]->hdr.bh1.block_status & TP_STATUS_USER) != 0) {
+	    block_ready = 1;
+	    break;
+	  }
+	  clock_gettime(CLOCK_MONOTONIC, &spin_now);
+	} while (((spin_now.tv_sec - spin_start.tv_sec) * 1000000000L
+		  + (spin_now.tv_nsec - spin_start.tv_nsec)) < (long)busy_poll_usecs * 1000
+		 && sig_close_workers == 0);
+	if (block_ready || sig_close_workers != 0) {
+	  continue; /* Restart the cb status check without sleeping */
+	}
+      }
+
       /* Now that we've done the housekeeping, poll the kernel for
        * when data has been returned to us
        */
-      polret = poll(&psockfd, 1, 1000); /* Let poll wait up to a second */
+      polret = poll(&psockfd, 1, thread_stor->poll_timeout_ms); /* Adaptive timeout (see the stats thread) */
       if (polret < 0) {
 	perror("poll returned error");
       } else if (polret == 0) {
@@ -730,14 +1986,45 @@ int af_packet_rx_ring_fanout_capture(struct thread_storage *thread_stor) {
        */
       bstreak++; /* We've gotten another block */
 
+      if (steal_deque.enabled) {
+	/* offer any deep backlog queued behind this block for stealing */
+	steal_offer_excess(block_header, thread_stor->block_offered, cb, thread_block_count);
+
+	if (thread_stor->block_offered[cb]) {
+	  thread_stor->block_offered[cb] = 0;
+	  if (steal_resolve(block_header[cb])) {
+	    /* a thief parsed this block into its own queues; just
+	     * release it and move on */
+	    pstreak = 0;
+	    haveflushed = 0;
+	    mercury_probe3(block_retire, thread_stor->tnum,
+			   block_header[cb]->hdr.bh1.num_pkts,
+			   block_header[cb]->hdr.bh1.blk_len);
+	    block_header[cb]->hdr.bh1.block_status = TP_STATUS_KERNEL;
+	    cb += 1;
+	    cb %= thread_block_count;
+	    continue;
+	  }
+	  /* the offer was withdrawn in time; process it ourselves */
+	}
+      }
+
       /* We found data, process it! */
-      process_all_packets_in_block(block_header[cb], statst, pkt_processor);
+      process_all_packets_in_block(block_header[cb], tstats, pkt_processor, thread_stor->mirror);
+
+      /* Let the processor write out any references it holds into the
+       * mapped block (see the ring pcap writers) before the block is
+       * returned to the kernel below */
+      pkt_processor->block_boundary();
 
       /* Reset our accounting */
       pstreak = 0; /* Reset the poll streak tracking */
       haveflushed = 0; /* We now have the chance to opportunistically flush again */
 
       /* return this block to the kernel */
+      mercury_probe3(block_retire, thread_stor->tnum,
+                     block_header[cb]->hdr.bh1.num_pkts,
+                     block_header[cb]->hdr.bh1.blk_len);
       block_header[cb]->hdr.bh1.block_status = TP_STATUS_KERNEL;
 
       cb += 1; /* Advanced our current block pointer */
@@ -760,6 +2047,10 @@ void *packet_capture_thread_func(void *arg)  {
    */
   disable_all_signals();
 
+  /* resolve analysis lookups through this node's database replica,
+   * when --numa-replicate-db built one */
+  analysis_set_thread_node(thread_stor->numa_node);
+
   /* now process the packets */
   if (af_packet_rx_ring_fanout_capture(thread_stor) < 0) {
     fprintf(stdout, "error: could not perform packet capture\n");
@@ -774,9 +2065,64 @@ enum status bind_and_dispatch(struct mercury_config *cfg,
   struct ring_limits rl;
   ring_limits_init(&rl, cfg->buffer_fraction);
 
+  /* a latency-critical busy-polling instance should not sit on a
+   * partially-filled block for the usual retirement timeout; retire
+   * blocks as fast as the kernel allows so the spin loop sees them
+   */
+  if (cfg->busy_poll_usecs > 0) {
+    rl.af_blocktimeout = 1;
+  }
+
   int err;
   int num_threads = cfg->num_threads;
-  int fanout_arg = ((getpid() & 0xffff) | (rl.af_fanout_type << 16));
+
+#ifdef PACKET_FANOUT_EBPF
+  /* prefer eBPF flow steering, which keeps tunneled flows core-local;
+   * fall back to the kernel hash if the program can't be loaded */
+  int fanout_prog_fd = fanout_ebpf_prog_load();
+  if (fanout_prog_fd >= 0) {
+    rl.af_fanout_type = PACKET_FANOUT_EBPF;
+  } else {
+    fprintf(stderr, "Notice: could not load eBPF fanout steering program; using PACKET_FANOUT_HASH\n");
+  }
+#endif
+  /* parse the capture interface as a comma-separated list, so that
+   * one process can open rings on several interfaces and share the
+   * read-only analysis and subnet data across all of the workers */
+  char *iface_string = strdup(cfg->capture_interface);
+  if (iface_string == NULL) {
+    perror("could not allocate memory for the interface list\n");
+    exit(255);
+  }
+  const char *iface_name[MAX_INTERFACES];
+  int num_ifaces = 0;
+  for (char *name = strtok(iface_string, ","); name != NULL; name = strtok(NULL, ",")) {
+    if (num_ifaces == MAX_INTERFACES) {
+      fprintf(stderr, "error: at most %d capture interfaces are supported\n", MAX_INTERFACES);
+      exit(255);
+    }
+    iface_name[num_ifaces++] = name;
+  }
+  if (num_ifaces == 0) {
+    fprintf(stderr, "error: no capture interface in \"%s\"\n", cfg->capture_interface);
+    exit(255);
+  }
+  if (num_threads < num_ifaces) {
+    /* mercury.c raises the thread count (and the output queue count)
+     * to cover the interface list, so this should never happen */
+    fprintf(stderr, "error: %d thread(s) cannot cover %d interfaces\n", num_threads, num_ifaces);
+    exit(255);
+  }
+
+  /* each interface gets its own fanout group; group ids only need to
+   * be distinct within this host, so derive them from the pid, unless
+   * a group id was pinned with --fanout-group, in which case a
+   * handoff peer can join the very same group */
+  int fanout_base = cfg->fanout_group ? cfg->fanout_group : getpid();
+  int fanout_arg[MAX_INTERFACES];
+  for (int i = 0; i < num_ifaces; i++) {
+    fanout_arg[i] = (((fanout_base + i) & 0xffff) | (rl.af_fanout_type << 16));
+  }
 
   /* We need all our threads to get a clean start at the same time or
    * else some threads will start working before other threads are ready
@@ -789,6 +2135,9 @@ enum status bind_and_dispatch(struct mercury_config *cfg,
   pthread_cond_t t_start_c  = PTHREAD_COND_INITIALIZER;
   pthread_mutex_t t_start_m = PTHREAD_MUTEX_INITIALIZER;
 
+  /* work stealing only helps when there is another worker to steal from */
+  steal_deque.enabled = (num_threads > 1);
+
   struct stats_tracking statst;
   memset(&statst, 0, sizeof(statst));
   statst.num_threads = num_threads;
@@ -796,13 +2145,21 @@ enum status bind_and_dispatch(struct mercury_config *cfg,
   statst.t_start_c = &t_start_c;
   statst.t_start_m = &t_start_m;
   statst.verbosity = cfg->verbosity;
+  statst.stats_json_filename = cfg->stats_json;
+  statst.stats_interval = cfg->stats_interval > 0 ? cfg->stats_interval : 1;
+  stats_tracking_live = &statst;  /* for af_packet_stats_set_interval() */
 
   struct thread_storage *tstor;  // Holds the array of struct thread_storage, one for each thread
-  tstor = (struct thread_storage *)malloc(num_threads * sizeof(struct thread_storage));
-  if (!tstor) {
+  /* the array must be cache-line aligned so that each thread's
+   * counter block really does get a line of its own */
+  err = posix_memalign((void **)&tstor, CACHE_LINE_SIZE, num_threads * sizeof(struct thread_storage));
+  if (err != 0) {
     perror("could not allocate memory for strocut thread_storage array\n");
+    exit(255);
   }
   statst.tstor = tstor; // The stats thread needs to know how to access the socket for each packet worker
+  int no_output_queues = cfg->separate_files || pkt_proc_uses_ring_pcap_writer(cfg);
+  statst.tqs = no_output_queues ? NULL : &out_ctx->qs; // ...and the output queues, to report backpressure
 
   /* Now that we know how many threads we will have, we need
    * to figure out what our ring parameters will be */
@@ -848,18 +2205,67 @@ enum status bind_and_dispatch(struct mercury_config *cfg,
   thread_ring_req.tp_frame_nr = (thread_ring_blocksize * thread_ring_blockcount) / rl.af_framesize;
   thread_ring_req.tp_retire_blk_tov = rl.af_blocktimeout;
   thread_ring_req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
-  
-  /* Get all the thread storage ready and allocate the sockets */
+
+  /* find the NUMA node owning each NIC, so that each thread's ring is
+   * allocated there and each worker is pinned to one of its CPUs */
+  int numa_node[MAX_INTERFACES];
+  int node_cpus[MAX_INTERFACES][1024];
+  int num_node_cpus[MAX_INTERFACES];
+  for (int i = 0; i < num_ifaces; i++) {
+    numa_node[i] = interface_numa_node(iface_name[i]);
+    num_node_cpus[i] = numa_node_cpus(numa_node[i], node_cpus[i], 1024);
+    if (numa_node[i] >= 0) {
+      fprintf(stderr, "Interface %s is on NUMA node %d (%d CPUs)\n",
+              iface_name[i], numa_node[i], num_node_cpus[i]);
+    }
+  }
+
+  /* discover each NIC's queue topology and report it, so that a
+   * mismatch between the thread count and the queue count is visible
+   * at startup rather than found in the drop counters; when the
+   * per-queue IRQ map is known, the workers are pinned to the CPUs
+   * servicing those IRQs (one per queue, in queue order) instead of
+   * to arbitrary CPUs of the NIC's node, so a frame is parsed on the
+   * core whose cache the kernel just filled with it */
+  int irq_cpus[MAX_INTERFACES][1024];
+  int num_irq_cpus[MAX_INTERFACES];
+  for (int i = 0; i < num_ifaces; i++) {
+    int channels = interface_channel_count(iface_name[i]);
+    num_irq_cpus[i] = interface_irq_cpus(iface_name[i], irq_cpus[i], 1024);
+    if (channels > 0) {
+      int threads_here = num_threads / num_ifaces + (i < num_threads % num_ifaces ? 1 : 0);
+      fprintf(stderr, "Interface %s has %d RX queue(s), %d queue IRQ(s) mapped; %d capture thread(s)%s\n",
+              iface_name[i], channels, num_irq_cpus[i], threads_here,
+              threads_here == channels ? "" : " (use --threads auto to match the queue count)");
+    }
+  }
+
+  /* with --numa-replicate-db, each node hosting workers gets its own
+   * copy of the analysis database (see analysis_replicate_on_node(),
+   * analysis.h), so scoring never pays remote-memory latency for the
+   * hot lookup structures; each worker selects its node's copy below */
+  if (cfg->numa_replicate_db && cfg->analysis) {
+    for (int i = 0; i < num_ifaces; i++) {
+      int already_done = 0;
+      for (int j = 0; j < i; j++) {
+        if (numa_node[j] == numa_node[i]) {
+          already_done = 1;
+        }
+      }
+      if (numa_node[i] >= 0 && !already_done) {
+        if (analysis_replicate_on_node(numa_node[i]) == 0) {
+          fprintf(stderr, "Replicated analysis database on NUMA node %d\n", numa_node[i]);
+        } else {
+          fprintf(stderr, "warning: could not replicate analysis database on NUMA node %d\n", numa_node[i]);
+        }
+      }
+    }
+  }
+
+  /* Get all the thread storage ready and allocate the sockets;
+   * threads are dealt out to the interfaces round-robin */
   for (int thread = 0; thread < num_threads; thread++) {
-    /* Init the thread storage for this thread */
-      tstor[thread].tnum = thread;
-      tstor[thread].tid = 0;
-      tstor[thread].sockfd = -1;
-      tstor[thread].if_name = cfg->capture_interface;
-      tstor[thread].statst = &statst;
-      tstor[thread].t_start_p = &t_start_p;
-      tstor[thread].t_start_c = &t_start_c;
-      tstor[thread].t_start_m = &t_start_m;
+    int ifnum = thread % num_ifaces;
 
     err = pthread_attr_init(&(tstor[thread].thread_attributes));
     if (err) {
@@ -880,28 +2286,98 @@ enum status bind_and_dispatch(struct mercury_config *cfg,
       exit(255);
     }
 
+    tstor[thread].stats.received_packets = 0;
+    tstor[thread].stats.received_bytes = 0;
     tstor[thread].tnum = thread;
+    tstor[thread].numa_node = numa_node[ifnum];
+    tstor[thread].busy_poll_usecs = cfg->busy_poll_usecs;
     tstor[thread].tid = 0;
     tstor[thread].sockfd = -1;
-    tstor[thread].if_name = cfg->capture_interface;
+    tstor[thread].if_name = iface_name[ifnum];
     tstor[thread].statst = &statst;
     tstor[thread].t_start_p = &t_start_p;
     tstor[thread].t_start_c = &t_start_c;
     tstor[thread].t_start_m = &t_start_m;
+    tstor[thread].poll_timeout_ms = AF_POLL_TIMEOUT_START;
 
     tstor[thread].block_streak_hist = (double *)calloc(thread_ring_blockcount + 1, sizeof(double));
     if (!(tstor[thread].block_streak_hist)) {
       perror("could not allocate memory for thread stats block streak histogram\n");
     }
 
+    tstor[thread].block_offered = (uint8_t *)calloc(thread_ring_blockcount, sizeof(uint8_t));
+    if (!(tstor[thread].block_offered)) {
+      perror("could not allocate memory for work stealing block bookkeeping\n");
+    }
+
     memcpy(&(tstor[thread].ring_params), &thread_ring_req, sizeof(thread_ring_req));
 
-    err = create_dedicated_socket(&(tstor[thread]), fanout_arg);
+    err = create_dedicated_socket(&(tstor[thread]), fanout_arg[ifnum],
+                                  cfg->filter ? cfg->packet_filter_cfg : NULL);
 
     if (err != 0) {
       fprintf(stderr, "error creating dedicated socket for thread %d\n", thread);
       exit(255);
     }
+
+    /* the TX mirror socket also needs root (or CAP_NET_RAW), so it is
+     * created here, before the privilege drop below */
+    tstor[thread].mirror = NULL;
+    if (cfg->mirror_interface) {
+      tstor[thread].mirror = tx_mirror_create(cfg->mirror_interface, cfg->packet_filter_cfg, thread);
+      if (tstor[thread].mirror == NULL) {
+        fprintf(stderr, "error creating TX mirror socket for thread %d\n", thread);
+        exit(255);
+      }
+    }
+  }
+
+  /* every thread's ring has the same geometry, so the footprint is
+   * one ring size times the thread count */
+  memory_report_register("af_packet", "TPACKETv3 RX_RING (all threads)",
+                         (uint64_t)thread_ring_req.tp_block_size * thread_ring_req.tp_block_nr * num_threads);
+  if (cfg->mirror_interface) {
+    memory_report_register("af_packet", "PACKET_TX_RING mirror (all threads)",
+                           (uint64_t)TX_MIRROR_BLOCK_SIZE * TX_MIRROR_BLOCK_NR * num_threads);
+  }
+
+  /* the big allocations are all in place now; show where the memory
+   * budget went (kill -USR1 reprints this at runtime) */
+  memory_report_print(stderr);
+
+#ifdef PACKET_FANOUT_EBPF
+  /* all sockets have joined their fanout groups; install the steering
+   * program (one setsockopt() on any member configures its group, and
+   * thread i holds the first socket of interface i's group) */
+  if (fanout_prog_fd >= 0) {
+    for (int i = 0; i < num_ifaces; i++) {
+      err = setsockopt(tstor[i].sockfd, SOL_PACKET, PACKET_FANOUT_DATA, &fanout_prog_fd, sizeof(fanout_prog_fd));
+      if (err) {
+        perror("error: could not attach eBPF steering program to fanout group");
+        exit(255);
+      }
+    }
+    close(fanout_prog_fd);  /* each fanout group holds its own reference */
+  }
+#endif
+
+  /*
+   * hot upgrade (--handoff): every capture socket above has joined
+   * the fanout group of the process being replaced, so the kernel is
+   * already load-balancing packets between the two processes; signal
+   * the old process to drain its queues and exit.  The packets it has
+   * consumed are flushed by its graceful shutdown, and once its
+   * sockets leave the group, everything is delivered here, so no
+   * packet is lost across the upgrade.  The signal is sent while this
+   * process still holds its privileges, since the old process may be
+   * running as root.
+   */
+  if (cfg->handoff_pid) {
+    if (kill((pid_t)cfg->handoff_pid, SIGTERM) == 0) {
+      fprintf(stderr, "handoff: signaled process %d to drain and exit\n", cfg->handoff_pid);
+    } else {
+      perror("warning: could not signal the handoff process");
+    }
   }
 
   /* drop privileges from root to normal user */
@@ -914,16 +2390,41 @@ enum status bind_and_dispatch(struct mercury_config *cfg,
       fprintf(stderr, "dropped root privileges\n");
   }
 
+  /*
+   * two-stage pipeline (--serialize-threads): the capture workers
+   * forward raw frames into per-worker parse queues, and a separately
+   * sized pool of serializer threads parses them into JSON records on
+   * the output queues, so that a serialization-heavy packet (a
+   * certificate chain, say) never stalls ring consumption
+   */
+  struct serializer_pool serializer_pool;
+  bool two_stage = (cfg->serialize_threads > 0) && !no_output_queues;
+  if (two_stage) {
+      if (serializer_pool_init(&serializer_pool, cfg->serialize_threads,
+                               num_threads, &out_ctx->qs) != status_ok) {
+          return status_err;
+      }
+  }
+
   /*
    * initialze frame handlers
    */
   for (int thread = 0; thread < num_threads; thread++) {
 
-      tstor[thread].pkt_processor = pkt_proc_new_from_config(cfg, thread, &out_ctx->qs.queue[thread]);
+      if (two_stage) {
+          tstor[thread].pkt_processor =
+              new pkt_proc_block<pkt_proc_packet_forwarder_llq>(&serializer_pool.parse_queues.queue[thread]);
+      } else {
+          tstor[thread].pkt_processor = pkt_proc_new_from_config(cfg, thread,
+                                                                 no_output_queues ? NULL : &out_ctx->qs.queue[thread]);
+      }
       if (tstor[thread].pkt_processor == NULL) {
           printf("error: could not initialize frame handler\n");
           return status_err;
       }
+      /* warm restart: re-seed the worker's TCP initial-message-filter
+       * table from the flow snapshot, if one was loaded */
+      flow_snapshot_restore_filter(tstor[thread].pkt_processor->filter());
   }
 
   /* Start up the threads */
@@ -941,6 +2442,28 @@ enum status bind_and_dispatch(struct mercury_config *cfg,
       exit(255);
     }
 
+    /* pin the worker to the CPU servicing its queue's IRQ when the
+     * map is known, and otherwise to one CPU of its NIC's NUMA node,
+     * so that the block parse never pulls ring memory across the
+     * interconnect */
+    int ifnum = thread % num_ifaces;
+    int tix = thread / num_ifaces;   /* this thread's index on its interface */
+    int cpu;
+    if (num_irq_cpus[ifnum] > 0) {
+      cpu = irq_cpus[ifnum][tix % num_irq_cpus[ifnum]];
+      fprintf(stderr, "Thread %d pinned to CPU %d, servicing %s queue %d's IRQ\n",
+              thread, cpu, iface_name[ifnum], tix % num_irq_cpus[ifnum]);
+    } else {
+      cpu = node_cpus[ifnum][tix % num_node_cpus[ifnum]];
+    }
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    err = pthread_attr_setaffinity_np(&thread_attributes, sizeof(cpuset), &cpuset);
+    if (err) {
+      fprintf(stderr, "%s: error setting CPU affinity for thread %d\n", strerror(err), thread);
+    }
+
     err = pthread_create(&(tstor[thread].tid), &thread_attributes, packet_capture_thread_func, &(tstor[thread]));
     if (err) {
       fprintf(stderr, "%s: error creating af_packet capture thread %d\n", strerror(err), thread);
@@ -968,6 +2491,7 @@ enum status bind_and_dispatch(struct mercury_config *cfg,
 
   /* Wait for the stats thread to close (which only happens on a sigint/sigterm) */
   pthread_join(stats_thread, NULL);
+  stats_tracking_live = NULL;
 
   /* stats tracking closed, let the packet processing workers know */
   sig_close_workers = 1;
@@ -977,15 +2501,50 @@ enum status bind_and_dispatch(struct mercury_config *cfg,
     pthread_join(tstor[thread].tid, NULL);
   }
 
+  /* with the workers joined, their filter flow tables are quiescent;
+   * contribute them to the flow snapshot (the workers' deduplication
+   * tables contributed themselves at thread exit) */
+  for (int thread = 0; thread < num_threads; thread++) {
+    flow_snapshot_note_filter(tstor[thread].pkt_processor->filter());
+  }
+
+  /* with the workers gone, the serializers drain the parse queues,
+   * flush any aggregated records, and exit */
+  if (two_stage) {
+    serializer_pool_stop(&serializer_pool);
+  }
+
+  /* aggregate the final per-thread counts; the stats thread's last
+   * sample may be up to a second stale */
+  statst.received_packets = 0;
+  statst.received_bytes = 0;
+  for (int thread = 0; thread < num_threads; thread++) {
+    statst.received_packets += tstor[thread].stats.received_packets;
+    statst.received_bytes += tstor[thread].stats.received_bytes;
+  }
+
+  /* sum the per-thread mirror counters before the mirrors are freed */
+  uint64_t mirrored = 0, mirror_ring_full = 0, mirror_oversize = 0;
+  for (int thread = 0; thread < num_threads; thread++) {
+    if (tstor[thread].mirror) {
+      mirrored += tstor[thread].mirror->mirrored;
+      mirror_ring_full += tstor[thread].mirror->ring_full;
+      mirror_oversize += tstor[thread].mirror->oversize;
+    }
+  }
+
   /* free up resources */
   for (int thread = 0; thread < num_threads; thread++) {
     free(tstor[thread].block_header);
     munmap(tstor[thread].mapped_buffer, tstor[thread].ring_params.tp_block_size * tstor[thread].ring_params.tp_block_nr);
     free(tstor[thread].block_streak_hist);
+    free(tstor[thread].block_offered);
     close(tstor[thread].sockfd);
+    tx_mirror_free(tstor[thread].mirror);
     delete tstor[thread].pkt_processor;
   }
   free(tstor);
+  free(iface_string);
 
   fprintf(stderr, "--\n"
 	  "%" PRIu64 " packets captured\n"
@@ -995,6 +2554,78 @@ enum status bind_and_dispatch(struct mercury_config *cfg,
 	  "%" PRIu64 " socket queue freezes\n",
 	  statst.received_packets, statst.received_bytes, statst.socket_packets, statst.socket_drops, statst.socket_freezes);
 
+  if (steal_deque.enabled) {
+    fprintf(stderr, "%" PRIu64 " ring blocks processed by work stealing\n", steal_deque.stolen);
+  }
+
+  if (cfg->mirror_interface) {
+    fprintf(stderr,
+	    "%" PRIu64 " packets mirrored to %s\n"
+	    "%" PRIu64 " mirror packets dropped (TX ring full)\n"
+	    "%" PRIu64 " mirror packets dropped (frame oversize)\n",
+	    mirrored, cfg->mirror_interface, mirror_ring_full, mirror_oversize);
+  }
+
+  /* the final per-protocol totals, merged from the worker threads */
+  struct extractor_protocol_stats proto_totals;
+  extractor_stats_sum(&proto_totals);
+  for (int type = 0; type < EXTRACTOR_STATS_NUM_MSG_TYPES; type++) {
+    if (proto_totals.packets[type] > 0) {
+      fprintf(stderr, "%" PRIu64 " %s packets parsed (%" PRIu64 " bytes)\n",
+	      proto_totals.packets[type], msg_type_string((enum msg_type)type), proto_totals.bytes[type]);
+    }
+  }
+
+  if (statst.tqs != NULL) {
+    struct queue_totals qt;
+    output_queue_totals(statst.tqs, &qt);
+    if (two_stage) {
+      /* fold the parse-queue losses into the totals: every received
+       * packet was either lost at its parse queue or handed to a
+       * serializer, so the reconciled table below still balances */
+      struct queue_totals pqt;
+      output_queue_totals(&serializer_pool.parse_queues, &pqt);
+      qt.drops += pqt.drops;
+      qt.truncated += pqt.truncated;
+      qt.stall_usec += pqt.stall_usec;
+      serializer_pool_free(&serializer_pool);
+    }
+    fprintf(stderr,
+	    "%" PRIu64 " ms spent stalled on full output queues\n"
+	    "%.1f%% worst output queue depth high-watermark\n",
+	    qt.stall_usec / 1000, ((double)qt.depth_hwm / LLQ_BUF_SIZE) * 100.0);
+    fprintf(stderr,
+	    "%.3f/%.3f/%.3f ms capture-to-write latency (p50/p99/p999)\n",
+	    latency_histogram_percentile(&statst.tqs->latency, NULL, 0.50) / 1e6,
+	    latency_histogram_percentile(&statst.tqs->latency, NULL, 0.99) / 1e6,
+	    latency_histogram_percentile(&statst.tqs->latency, NULL, 0.999) / 1e6);
+
+    /* the reconciled drop-cause table: every packet delivered to the
+     * socket is accounted for by exactly one row, so that received =
+     * written + sum(drop causes) always balances.  Records sitting in
+     * the output queues when this prints are written during the final
+     * flush, and appear as the residual row.  Flow aggregation merges
+     * records, so the residual can be negative (as records, not
+     * packets) when it is enabled. */
+    int64_t residual = (int64_t)(statst.received_packets - qt.filtered - qt.drops - qt.truncated)
+        - (int64_t)qt.records_written;
+    fprintf(stderr,
+	    "--\n"
+	    "drop causes, reconciled:\n"
+	    "  %12" PRIu64 " packets seen by socket\n"
+	    "- %12" PRIu64 " packets dropped in the kernel ring\n"
+	    "= %12" PRIu64 " packets received by worker threads\n"
+	    "- %12" PRIu64 " packets that produced no record (filter policy)\n"
+	    "- %12" PRIu64 " records dropped at full output queues\n"
+	    "- %12" PRIu64 " records abandoned at the record size cap\n"
+	    "- %12" PRId64 " records still queued or held at shutdown\n"
+	    "= %12" PRIu64 " records written\n",
+	    statst.socket_packets, statst.socket_drops,
+	    statst.received_packets,
+	    qt.filtered, qt.drops, qt.truncated,
+	    residual, qt.records_written);
+  }
+
   return status_ok;
 }
 
@@ -14,4 +14,19 @@
 enum status bind_and_dispatch(struct mercury_config *cfg,
 			      struct output_file *out_ctx);
 
+/*
+ * af_packet_stats_set_interval() changes the interval between stats
+ * JSON records (--stats-interval) on a running capture; it is a no-op
+ * when no capture is running or seconds is not positive
+ */
+void af_packet_stats_set_interval(int seconds);
+
+/*
+ * af_packet_interface_thread_count() returns the total RX queue count
+ * of the interfaces in the comma-separated list passed as input (the
+ * thread count that --threads auto resolves to), or 0 when any of
+ * their queue counts cannot be determined
+ */
+int af_packet_interface_thread_count(const char *capture_interface);
+
 #endif /* AF_PACKET_V3 */
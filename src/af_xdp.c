@@ -0,0 +1,576 @@
+/*
+ * af_xdp.c
+ *
+ * interface to AF_XDP/XSK sockets for zero-copy packet capture; this
+ * is an alternative to the AF_PACKET/TPACKETv3 interface in
+ * af_packet_v3.c, for NICs and drivers that support XDP.  Reference
+ * docs:
+ *
+ *  https://www.kernel.org/doc/html/latest/networking/af_xdp.html
+ *
+ * Copyright (c) 2019 Cisco Systems, Inc. All rights reserved.
+ * License at https://github.com/cisco/mercury/blob/master/LICENSE
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <errno.h>
+#include <pthread.h>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <net/if.h>
+#include <linux/if_xdp.h>
+#include <linux/if_link.h>
+#include <linux/bpf.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <time.h>
+
+#include "af_xdp.h"
+#include "signal_handling.h"
+#include "utils.h"
+#include "output.h"
+#include "pkt_proc.h"
+
+/*
+ * Each worker thread owns one XSK socket bound to one NIC queue, with
+ * a private UMEM.  The frame count and size below give 8 MiB of
+ * packet buffer per thread; the fill and rx rings each hold half of
+ * the frames, so the kernel and userspace can never starve each
+ * other.
+ */
+#define XSK_NUM_FRAMES  4096
+#define XSK_FRAME_SIZE  2048    /* must be a power of two (kernel requirement) */
+#define XSK_RING_SIZE   (XSK_NUM_FRAMES / 2)
+
+extern int sig_close_flag; /* watched by the stats thread, defined in signal_handling.c */
+static int xsk_close_workers = 0;
+
+/*
+ * mapped view of one single-producer/single-consumer XSK ring; the
+ * producer and consumer pointers live in the kernel-shared mapping
+ */
+struct xsk_ring {
+  volatile uint32_t *producer;
+  volatile uint32_t *consumer;
+  void *desc;           /* array of struct xdp_desc (rx) or uint64_t (fill) */
+  uint32_t size;        /* number of entries; power of two */
+  void *map;            /* base of the mmap()'d region, for munmap() */
+  size_t map_size;
+};
+
+struct xsk_thread_storage {
+  struct pkt_proc *pkt_processor;
+  int tnum;                /* thread number == NIC queue id */
+  pthread_t tid;
+  int sockfd;              /* the AF_XDP socket */
+  const char *if_name;
+  uint8_t *umem_area;      /* the packet buffer frames */
+  struct xsk_ring rx;
+  struct xsk_ring fill;
+  uint64_t received_packets;
+  uint64_t received_bytes;
+  int *t_start_p;             /* the clean start predicate */
+  pthread_cond_t *t_start_c;  /* the clean start condition */
+  pthread_mutex_t *t_start_m; /* the clean start mutex */
+};
+
+static int sys_bpf(enum bpf_cmd cmd, union bpf_attr *attr, unsigned int size) {
+  return syscall(__NR_bpf, cmd, attr, size);
+}
+
+/*
+ * create the XSKMAP that the XDP program uses to steer each frame to
+ * the XSK socket bound to the queue the frame arrived on
+ */
+static int xsk_map_create(int num_queues) {
+  union bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.map_type = BPF_MAP_TYPE_XSKMAP;
+  attr.key_size = sizeof(int);
+  attr.value_size = sizeof(int);
+  attr.max_entries = num_queues;
+
+  int map_fd = sys_bpf(BPF_MAP_CREATE, &attr, sizeof(attr));
+  if (map_fd < 0) {
+    perror("error: could not create XSKMAP");
+  }
+  return map_fd;
+}
+
+static int xsk_map_update(int map_fd, int queue_id, int sockfd) {
+  union bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.map_fd = map_fd;
+  attr.key = (uint64_t)(uintptr_t)&queue_id;
+  attr.value = (uint64_t)(uintptr_t)&sockfd;
+
+  int err = sys_bpf(BPF_MAP_UPDATE_ELEM, &attr, sizeof(attr));
+  if (err) {
+    fprintf(stderr, "%s: could not insert socket for queue %d into XSKMAP\n", strerror(errno), queue_id);
+  }
+  return err;
+}
+
+/*
+ * load a minimal XDP program equivalent to
+ *
+ *    int xdp_sock_prog(struct xdp_md *ctx) {
+ *        return bpf_redirect_map(&xsks_map, ctx->rx_queue_index, XDP_PASS);
+ *    }
+ *
+ * assembled by hand so that we don't need a clang/libbpf toolchain at
+ * build or run time
+ */
+static int xdp_prog_load(int map_fd) {
+  struct bpf_insn prog[] = {
+    /* r2 = *(u32 *)(r1 + offsetof(struct xdp_md, rx_queue_index)) */
+    { BPF_LDX | BPF_MEM | BPF_W, 2, 1, 16, 0 },
+    /* r1 = xsks_map (64-bit immediate load of the map fd) */
+    { BPF_LD | BPF_DW | BPF_IMM, 1, BPF_PSEUDO_MAP_FD, 0, map_fd },
+    { 0, 0, 0, 0, 0 },
+    /* r3 = XDP_PASS (returned for queues with no socket in the map) */
+    { BPF_ALU64 | BPF_MOV | BPF_K, 3, 0, 0, XDP_PASS },
+    /* call bpf_redirect_map() */
+    { BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map },
+    { BPF_JMP | BPF_EXIT, 0, 0, 0, 0 },
+  };
+  char license[] = "GPL";
+
+  union bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.prog_type = BPF_PROG_TYPE_XDP;
+  attr.insns = (uint64_t)(uintptr_t)prog;
+  attr.insn_cnt = sizeof(prog) / sizeof(prog[0]);
+  attr.license = (uint64_t)(uintptr_t)license;
+
+  int prog_fd = sys_bpf(BPF_PROG_LOAD, &attr, sizeof(attr));
+  if (prog_fd < 0) {
+    perror("error: could not load XDP steering program");
+  }
+  return prog_fd;
+}
+
+/*
+ * attach (prog_fd >= 0) or detach (prog_fd == -1) the XDP program on
+ * an interface, via an RTM_SETLINK netlink message with a nested
+ * IFLA_XDP attribute
+ */
+static int xdp_prog_attach(int ifindex, int prog_fd) {
+  struct {
+    struct nlmsghdr nh;
+    struct ifinfomsg ifinfo;
+    char attrbuf[64];
+  } req;
+
+  int nl_fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+  if (nl_fd < 0) {
+    perror("error: could not open netlink socket for XDP attach");
+    return -1;
+  }
+
+  memset(&req, 0, sizeof(req));
+  req.nh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+  req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+  req.nh.nlmsg_type = RTM_SETLINK;
+  req.ifinfo.ifi_family = AF_UNSPEC;
+  req.ifinfo.ifi_index = ifindex;
+
+  /* nested attribute: IFLA_XDP { IFLA_XDP_FD, IFLA_XDP_FLAGS } */
+  struct rtattr *xdp_attr = (struct rtattr *)(((char *)&req) + NLMSG_ALIGN(req.nh.nlmsg_len));
+  xdp_attr->rta_type = IFLA_XDP | NLA_F_NESTED;
+  struct rtattr *fd_attr = (struct rtattr *)((char *)xdp_attr + RTA_ALIGN(RTA_LENGTH(0)));
+  fd_attr->rta_type = IFLA_XDP_FD;
+  fd_attr->rta_len = RTA_LENGTH(sizeof(int));
+  memcpy(RTA_DATA(fd_attr), &prog_fd, sizeof(int));
+  struct rtattr *flags_attr = (struct rtattr *)((char *)fd_attr + RTA_ALIGN(fd_attr->rta_len));
+  flags_attr->rta_type = IFLA_XDP_FLAGS;
+  flags_attr->rta_len = RTA_LENGTH(sizeof(uint32_t));
+  uint32_t flags = (prog_fd >= 0) ? XDP_FLAGS_UPDATE_IF_NOEXIST : 0;
+  memcpy(RTA_DATA(flags_attr), &flags, sizeof(uint32_t));
+  xdp_attr->rta_len = RTA_ALIGN(RTA_LENGTH(0)) + RTA_ALIGN(fd_attr->rta_len) + RTA_ALIGN(flags_attr->rta_len);
+  req.nh.nlmsg_len = NLMSG_ALIGN(req.nh.nlmsg_len) + RTA_ALIGN(xdp_attr->rta_len);
+
+  if (send(nl_fd, &req, req.nh.nlmsg_len, 0) < 0) {
+    perror("error: could not send XDP attach netlink message");
+    close(nl_fd);
+    return -1;
+  }
+
+  /* wait for the netlink ACK, which carries the attach error code */
+  char resp[1024];
+  ssize_t len = recv(nl_fd, resp, sizeof(resp), 0);
+  close(nl_fd);
+  if (len < 0) {
+    perror("error: could not read XDP attach netlink response");
+    return -1;
+  }
+  for (struct nlmsghdr *nh = (struct nlmsghdr *)resp; NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+    if (nh->nlmsg_type == NLMSG_ERROR) {
+      struct nlmsgerr *nl_err = (struct nlmsgerr *)NLMSG_DATA(nh);
+      if (nl_err->error != 0) {
+        fprintf(stderr, "%s: kernel rejected XDP program attach\n", strerror(-nl_err->error));
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+/*
+ * create and bind the XSK socket for one thread: register the UMEM,
+ * size and map the fill and rx rings, prime the fill ring with every
+ * frame, and bind to (interface, queue); zero-copy mode is tried
+ * first and copy mode is the fallback, so this works on every driver
+ */
+static int xsk_socket_create(struct xsk_thread_storage *ts, int ifindex) {
+  int err;
+  int sockfd = socket(AF_XDP, SOCK_RAW, 0);
+  if (sockfd == -1) {
+    fprintf(stderr, "%s: could not create AF_XDP socket for thread %d\n", strerror(errno), ts->tnum);
+    return -1;
+  }
+  ts->sockfd = sockfd;
+
+  size_t umem_len = (size_t)XSK_NUM_FRAMES * XSK_FRAME_SIZE;
+  ts->umem_area = (uint8_t *)mmap(NULL, umem_len, PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ts->umem_area == MAP_FAILED) {
+    fprintf(stderr, "%s: could not allocate UMEM for thread %d\n", strerror(errno), ts->tnum);
+    return -1;
+  }
+
+  struct xdp_umem_reg umem_reg;
+  memset(&umem_reg, 0, sizeof(umem_reg));
+  umem_reg.addr = (uint64_t)(uintptr_t)ts->umem_area;
+  umem_reg.len = umem_len;
+  umem_reg.chunk_size = XSK_FRAME_SIZE;
+  umem_reg.headroom = 0;
+  err = setsockopt(sockfd, SOL_XDP, XDP_UMEM_REG, &umem_reg, sizeof(umem_reg));
+  if (err) {
+    perror("error: could not register UMEM for AF_XDP socket");
+    return -1;
+  }
+
+  int ring_size = XSK_RING_SIZE;
+  if (setsockopt(sockfd, SOL_XDP, XDP_UMEM_FILL_RING, &ring_size, sizeof(ring_size)) ||
+      setsockopt(sockfd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ring_size, sizeof(ring_size)) ||
+      setsockopt(sockfd, SOL_XDP, XDP_RX_RING, &ring_size, sizeof(ring_size))) {
+    perror("error: could not size AF_XDP rings");
+    return -1;
+  }
+
+  struct xdp_mmap_offsets off;
+  socklen_t optlen = sizeof(off);
+  err = getsockopt(sockfd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen);
+  if (err) {
+    perror("error: could not get AF_XDP mmap offsets");
+    return -1;
+  }
+
+  ts->fill.size = ring_size;
+  ts->fill.map_size = off.fr.desc + ring_size * sizeof(uint64_t);
+  ts->fill.map = mmap(NULL, ts->fill.map_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, sockfd, XDP_UMEM_PGOFF_FILL_RING);
+  if (ts->fill.map == MAP_FAILED) {
+    fprintf(stderr, "%s: could not map fill ring for thread %d\n", strerror(errno), ts->tnum);
+    return -1;
+  }
+  ts->fill.producer = (volatile uint32_t *)((char *)ts->fill.map + off.fr.producer);
+  ts->fill.consumer = (volatile uint32_t *)((char *)ts->fill.map + off.fr.consumer);
+  ts->fill.desc = (char *)ts->fill.map + off.fr.desc;
+
+  ts->rx.size = ring_size;
+  ts->rx.map_size = off.rx.desc + ring_size * sizeof(struct xdp_desc);
+  ts->rx.map = mmap(NULL, ts->rx.map_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, sockfd, XDP_PGOFF_RX_RING);
+  if (ts->rx.map == MAP_FAILED) {
+    fprintf(stderr, "%s: could not map rx ring for thread %d\n", strerror(errno), ts->tnum);
+    return -1;
+  }
+  ts->rx.producer = (volatile uint32_t *)((char *)ts->rx.map + off.rx.producer);
+  ts->rx.consumer = (volatile uint32_t *)((char *)ts->rx.map + off.rx.consumer);
+  ts->rx.desc = (char *)ts->rx.map + off.rx.desc;
+
+  /* give the kernel every frame to receive into */
+  uint64_t *fill_addrs = (uint64_t *)ts->fill.desc;
+  for (int i = 0; i < ring_size; i++) {
+    fill_addrs[i] = (uint64_t)i * XSK_FRAME_SIZE;
+  }
+  __atomic_store_n(ts->fill.producer, ring_size, __ATOMIC_RELEASE);
+
+  struct sockaddr_xdp sxdp;
+  memset(&sxdp, 0, sizeof(sxdp));
+  sxdp.sxdp_family = AF_XDP;
+  sxdp.sxdp_ifindex = ifindex;
+  sxdp.sxdp_queue_id = ts->tnum;
+  sxdp.sxdp_flags = XDP_ZEROCOPY;
+  err = bind(sockfd, (struct sockaddr *)&sxdp, sizeof(sxdp));
+  if (err) {
+    /* the driver doesn't do zero-copy XSK; fall back to copy mode,
+     * which still avoids the skb path */
+    sxdp.sxdp_flags = XDP_COPY;
+    err = bind(sockfd, (struct sockaddr *)&sxdp, sizeof(sxdp));
+    if (err) {
+      fprintf(stderr, "%s: could not bind AF_XDP socket to %s queue %d\n", strerror(errno), ts->if_name, ts->tnum);
+      return -1;
+    }
+    fprintf(stderr, "Notice: zero-copy not supported on %s queue %d; using XDP copy mode\n", ts->if_name, ts->tnum);
+  }
+
+  return 0;
+}
+
+/*
+ * the rx loop: consume descriptors from the rx ring, hand each UMEM
+ * frame to the packet processor in place, then recycle the frame
+ * address back into the fill ring
+ */
+static int xsk_rx_loop(struct xsk_thread_storage *ts) {
+  int err;
+
+  /* wait for the clean start condition, as in af_packet_rx_ring_fanout_capture() */
+  err = pthread_mutex_lock(ts->t_start_m);
+  if (err != 0) {
+    fprintf(stderr, "%s: error locking clean start mutex for thread %lu\n", strerror(err), ts->tid);
+    exit(255);
+  }
+  while (*(ts->t_start_p) != 1) {
+    err = pthread_cond_wait(ts->t_start_c, ts->t_start_m);
+    if (err != 0) {
+      fprintf(stderr, "%s: error waiting on clean start condition for thread %lu\n", strerror(err), ts->tid);
+      exit(255);
+    }
+  }
+  err = pthread_mutex_unlock(ts->t_start_m);
+  if (err != 0) {
+    fprintf(stderr, "%s: error unlocking clean start mutex for thread %lu\n", strerror(err), ts->tid);
+    exit(255);
+  }
+
+  fprintf(stderr, "Thread %d with thread id %lu started on %s queue %d...\n",
+          ts->tnum, ts->tid, ts->if_name, ts->tnum);
+
+  struct pollfd psockfd;
+  memset(&psockfd, 0, sizeof(psockfd));
+  psockfd.fd = ts->sockfd;
+  psockfd.events = POLLIN | POLLERR;
+
+  struct pkt_proc *pkt_processor = ts->pkt_processor;
+  struct xdp_desc *rx_descs = (struct xdp_desc *)ts->rx.desc;
+  uint64_t *fill_addrs = (uint64_t *)ts->fill.desc;
+  uint32_t rx_mask = ts->rx.size - 1;
+  uint32_t fill_mask = ts->fill.size - 1;
+  uint32_t rx_cons = *ts->rx.consumer;
+  uint32_t fill_prod = *ts->fill.producer;
+
+  struct packet_info pi;
+
+  while (xsk_close_workers == 0) {
+    uint32_t rx_prod = __atomic_load_n(ts->rx.producer, __ATOMIC_ACQUIRE);
+    if (rx_cons == rx_prod) {
+      /* no packets waiting; flush our output and sleep in poll() */
+      pkt_processor->flush();
+      int polret = poll(&psockfd, 1, 1000);
+      if (polret < 0 && errno != EINTR) {
+        perror("poll returned error");
+      }
+      continue;
+    }
+
+    /* the AF_XDP rx path has no per-packet timestamps; one
+     * clock_gettime() per batch is the best available resolution
+     */
+    if (clock_gettime(CLOCK_REALTIME, &pi.ts) != 0) {
+      perror("Unable to get packet timestamp");
+    }
+
+    uint64_t batch_bytes = 0;
+    uint32_t batch = 0;
+    while (rx_cons != rx_prod) {
+      struct xdp_desc *desc = &rx_descs[rx_cons & rx_mask];
+
+      pi.caplen = desc->len;
+      pi.len = desc->len;
+      batch_bytes += desc->len;
+      pkt_processor->apply(&pi, ts->umem_area + desc->addr);
+
+      /* recycle the frame back to the kernel */
+      fill_addrs[fill_prod & fill_mask] = desc->addr & ~((uint64_t)XSK_FRAME_SIZE - 1);
+      fill_prod++;
+
+      rx_cons++;
+      batch++;
+    }
+    __atomic_store_n(ts->rx.consumer, rx_cons, __ATOMIC_RELEASE);
+    __atomic_store_n(ts->fill.producer, fill_prod, __ATOMIC_RELEASE);
+
+    __sync_add_and_fetch(&(ts->received_packets), batch);
+    __sync_add_and_fetch(&(ts->received_bytes), batch_bytes);
+  }
+
+  fprintf(stderr, "Thread %d with thread id %lu exiting...\n", ts->tnum, ts->tid);
+  return 0;
+}
+
+static void *xsk_capture_thread_func(void *arg) {
+  struct xsk_thread_storage *ts = (struct xsk_thread_storage *)arg;
+
+  disable_all_signals();
+
+  if (xsk_rx_loop(ts) < 0) {
+    fprintf(stdout, "error: could not perform XSK packet capture\n");
+    exit(255);
+  }
+  return NULL;
+}
+
+enum status af_xdp_bind_and_dispatch(struct mercury_config *cfg,
+                                     struct output_file *out_ctx) {
+  int err;
+  int num_threads = cfg->num_threads;
+
+  int ifindex = if_nametoindex(cfg->capture_interface);
+  if (ifindex == 0) {
+    fprintf(stderr, "Can't get interface number by interface name (%s)\n", cfg->capture_interface);
+    return status_err;
+  }
+
+  int map_fd = xsk_map_create(num_threads);
+  if (map_fd < 0) {
+    return status_err;
+  }
+  int prog_fd = xdp_prog_load(map_fd);
+  if (prog_fd < 0) {
+    return status_err;
+  }
+
+  int t_start_p = 0;
+  pthread_cond_t t_start_c  = PTHREAD_COND_INITIALIZER;
+  pthread_mutex_t t_start_m = PTHREAD_MUTEX_INITIALIZER;
+
+  struct xsk_thread_storage *tstor;
+  tstor = (struct xsk_thread_storage *)calloc(num_threads, sizeof(struct xsk_thread_storage));
+  if (!tstor) {
+    perror("could not allocate memory for struct xsk_thread_storage array\n");
+    return status_err;
+  }
+
+  for (int thread = 0; thread < num_threads; thread++) {
+    tstor[thread].tnum = thread;
+    tstor[thread].tid = 0;
+    tstor[thread].sockfd = -1;
+    tstor[thread].if_name = cfg->capture_interface;
+    tstor[thread].t_start_p = &t_start_p;
+    tstor[thread].t_start_c = &t_start_c;
+    tstor[thread].t_start_m = &t_start_m;
+
+    err = xsk_socket_create(&tstor[thread], ifindex);
+    if (err != 0) {
+      fprintf(stderr, "error creating XSK socket for thread %d\n", thread);
+      exit(255);
+    }
+    if (xsk_map_update(map_fd, thread, tstor[thread].sockfd) != 0) {
+      exit(255);
+    }
+  }
+
+  /* the sockets are all in the map; start steering frames to them */
+  if (xdp_prog_attach(ifindex, prog_fd) != 0) {
+    return status_err;
+  }
+
+  /* drop privileges from root to normal user */
+  if (drop_root_privileges(cfg->user, cfg->working_dir) != status_ok) {
+    return status_err;
+  }
+  if (cfg->user) {
+    fprintf(stderr, "running as user %s\n", cfg->user);
+  } else {
+    fprintf(stderr, "dropped root privileges\n");
+  }
+
+  /*
+   * initialize frame handlers
+   */
+  for (int thread = 0; thread < num_threads; thread++) {
+    tstor[thread].pkt_processor = pkt_proc_new_from_config(cfg, thread,
+                                                           cfg->separate_files ? NULL : &out_ctx->qs.queue[thread]);
+    if (tstor[thread].pkt_processor == NULL) {
+      printf("error: could not initialize frame handler\n");
+      return status_err;
+    }
+  }
+
+  for (int thread = 0; thread < num_threads; thread++) {
+    err = pthread_create(&(tstor[thread].tid), NULL, xsk_capture_thread_func, &(tstor[thread]));
+    if (err) {
+      fprintf(stderr, "%s: error creating af_xdp capture thread %d\n", strerror(err), thread);
+      exit(255);
+    }
+  }
+
+  /* wake up output thread so it's polling the queues waiting for data */
+  out_ctx->t_output_p = 1;
+  err = pthread_cond_broadcast(&(out_ctx->t_output_c));
+  if (err != 0) {
+    printf("%s: error broadcasting all clear on output start condition\n", strerror(err));
+    exit(255);
+  }
+
+  /* release the workers */
+  t_start_p = 1;
+  err = pthread_cond_broadcast(&t_start_c);
+  if (err != 0) {
+    printf("%s: error broadcasting all clear on clean start condition\n", strerror(err));
+    exit(255);
+  }
+
+  enable_all_signals();
+  while (sig_close_flag == 0) {
+    sleep(1);
+    if (cfg->verbosity) {
+      uint64_t packets = 0, bytes = 0;
+      for (int thread = 0; thread < num_threads; thread++) {
+        packets += tstor[thread].received_packets;
+        bytes += tstor[thread].received_bytes;
+      }
+      fprintf(stderr, "Stats: %" PRIu64 " packets, %" PRIu64 " bytes received\n", packets, bytes);
+    }
+  }
+
+  /* shut down the workers, then remove the XDP program */
+  xsk_close_workers = 1;
+  for (int thread = 0; thread < num_threads; thread++) {
+    pthread_join(tstor[thread].tid, NULL);
+  }
+  xdp_prog_attach(ifindex, -1);
+
+  uint64_t total_packets = 0, total_bytes = 0;
+  for (int thread = 0; thread < num_threads; thread++) {
+    total_packets += tstor[thread].received_packets;
+    total_bytes += tstor[thread].received_bytes;
+    munmap(tstor[thread].rx.map, tstor[thread].rx.map_size);
+    munmap(tstor[thread].fill.map, tstor[thread].fill.map_size);
+    munmap(tstor[thread].umem_area, (size_t)XSK_NUM_FRAMES * XSK_FRAME_SIZE);
+    close(tstor[thread].sockfd);
+    delete tstor[thread].pkt_processor;
+  }
+  free(tstor);
+  close(prog_fd);
+  close(map_fd);
+
+  fprintf(stderr, "--\n"
+          "%" PRIu64 " packets captured\n"
+          "%" PRIu64 " bytes captured\n",
+          total_packets, total_bytes);
+
+  return status_ok;
+}
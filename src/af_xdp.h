@@ -0,0 +1,26 @@
+/*
+ * af_xdp.h
+ *
+ * interface to AF_XDP/XSK zero-copy packet capture
+ *
+ * Copyright (c) 2019 Cisco Systems, Inc. All rights reserved.
+ * License at https://github.com/cisco/mercury/blob/master/LICENSE
+ */
+
+#ifndef AF_XDP_H
+#define AF_XDP_H
+
+#include "mercury.h"
+#include "output.h"
+
+/*
+ * af_xdp_bind_and_dispatch() is the AF_XDP analogue of
+ * bind_and_dispatch() in af_packet_v3.c; it binds one XSK socket per
+ * worker thread to successive NIC queues, loads a minimal XDP program
+ * that redirects every frame into an XSKMAP, and feeds UMEM frames
+ * directly to each thread's pkt_proc::apply() without any copies.
+ */
+enum status af_xdp_bind_and_dispatch(struct mercury_config *cfg,
+                                     struct output_file *out_ctx);
+
+#endif /* AF_XDP_H */
@@ -7,43 +7,414 @@
 
 
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <sys/syscall.h>
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <math.h>
 #include <unordered_map>
 #include <zlib.h>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <thread>
 
 #include "analysis.h"
+#include "arena.h"
+#include "intern.h"
+#include "memory_report.h"
 #include "utils.h"
 #include "tls.h"
+#include "fp_db_bin.h"
 
 #include "rapidjson/document.h"
 #include "rapidjson/stringbuffer.h"
 
-rapidjson::Document fp_db;
+/*
+ * analysis_database holds one loaded generation of the fingerprint
+ * database; all of its members are immutable once database_load()
+ * returns.  Either the compiled form is mapped (bin_base is set and
+ * lookups go directly against the mapped file) or the JSON form is
+ * parsed into fp_db_records:
+ *
+ *    fp_db_records holds one document per line of the resource file;
+ *    the records are independent of one another, so the load parses
+ *    them across a pool of worker threads, each writing only its own
+ *    stripe of the vector.
+ *
+ *    fp_db_index maps a fingerprint string to its record; the
+ *    records are hashed once at load time and every per-flow lookup
+ *    is O(1).
+ *
+ *    sni_class_index is an inverted index over
+ *    classes_hostname_sni, built at load time when the database
+ *    carries extended metadata: for each fingerprint record it maps
+ *    a server name to the processes that list it, as (process index,
+ *    count) pairs in process order.  Scoring resolves the flow's
+ *    server name with a single lookup and walks the match list
+ *    alongside the process iteration, so SNI classification does not
+ *    search one class map per candidate process.
+ */
+typedef std::vector<std::pair<uint32_t, uint64_t>> sni_match_list;
+
+/*
+ * node of the BK-tree used for approximate fingerprint matching (see
+ * database_approx_match()); fp points at string storage owned by the
+ * enclosing generation (a parsed document or the mapped file), and
+ * children maps an edit distance to the index of the subtree whose
+ * root lies at that distance
+ */
+struct fp_bk_node {
+    const char *fp;
+    std::vector<std::string> tokens;
+    std::unordered_map<unsigned int, uint32_t> children;
+};
+
+struct analysis_database {
+    std::vector<rapidjson::Document> fp_db_records;
+    std::unordered_map<std::string, const rapidjson::Value *> fp_db_index;
+    std::unordered_map<const rapidjson::Value *, std::unordered_map<std::string, sni_match_list>> sni_class_index;
+    const uint8_t *bin_base = NULL;   /* compiled form, mapped read-only (see fp_db_bin.h) */
+    size_t bin_size = 0;
+    std::vector<uint64_t> fp_bloom;   /* Bloom filter over the fingerprint strings */
+    uint64_t fp_bloom_mask = 0;       /* number of filter bits, minus one */
+    std::vector<struct fp_bk_node> fp_bk_tree;  /* BK-tree for approximate matching; node 0 is the root */
+    bool malware_db = true;
+    bool extended_fp_metadata = true;
+};
+
+/*
+ * the live database generation, published with read-copy-update
+ * semantics: worker threads load the pointer once per flow and never
+ * take a lock, and a reload builds the replacement generation
+ * entirely off to the side before swapping it in (see
+ * database_reload()).  db_generation counts successful loads, so
+ * that per-thread result caches can notice a swap; db_retired holds
+ * the generation displaced by the most recent reload, which is freed
+ * only by the following reload, after any reader that might still
+ * hold it has long since finished its flow.
+ */
+static std::atomic<struct analysis_database *> db_live{NULL};
+static struct analysis_database *db_retired = NULL;
+static std::atomic<uint64_t> db_generation{0};
+
+/*
+ * == NUMA-local database replicas ==
+ *
+ * On a multi-socket sensor the generation above lives on whichever
+ * node first touched its pages, and every worker on the other node
+ * pays remote-memory latency for the Bloom filter, index, BK-tree,
+ * and classifier probes of every flow it scores.
+ * analysis_replicate_on_node() loads an additional copy of the
+ * database with its allocations bound to one node, and
+ * analysis_set_thread_node() records which node the calling worker
+ * lives on; the lookup path then resolves through the node-local
+ * copy.  Each replica carries the generation it was built from, so a
+ * reload -- which rebuilds the replicas after swapping in the new
+ * generation -- can never leave a reader on stale data: a worker
+ * whose replica lags simply falls back to the live (possibly remote)
+ * generation until the rebuild lands.  The compiled image, when in
+ * use, is a read-only file mapping whose pages stay in the shared
+ * page cache; the replicas duplicate the heap-resident structures
+ * built around it.
+ *
+ * As in af_packet_v3.c, the set_mempolicy() syscall is used directly
+ * so that we don't pick up a libnuma dependency.
+ */
+
+#define MAX_NUMA_NODES 8
+
+static std::atomic<struct analysis_database *> db_replica[MAX_NUMA_NODES];
+static struct analysis_database *db_replica_retired[MAX_NUMA_NODES];
+static std::atomic<uint64_t> db_replica_generation[MAX_NUMA_NODES];
+static bool db_replica_wanted[MAX_NUMA_NODES];
+
+static thread_local int db_thread_node = -1;
+
+#ifndef MPOL_DEFAULT
+#define MPOL_DEFAULT 0
+#define MPOL_BIND    2
+#endif
+
+static long database_bind_mempolicy(int mode, int node) {
+    if (node < 0) {
+        return syscall(__NR_set_mempolicy, MPOL_DEFAULT, NULL, 0);
+    }
+    unsigned long nodemask = 1UL << node;
+    return syscall(__NR_set_mempolicy, mode, &nodemask, sizeof(nodemask) * 8);
+}
+
+/*
+ * the database the calling thread should read: its node-local
+ * replica, when one exists at the live generation, and the live
+ * generation itself otherwise
+ */
+static const struct analysis_database *database_for_thread() {
+    int node = db_thread_node;
+    if (node >= 0) {
+        const struct analysis_database *r = db_replica[node].load(std::memory_order_acquire);
+        if (r != NULL
+            && db_replica_generation[node].load(std::memory_order_acquire)
+               == db_generation.load(std::memory_order_acquire)) {
+            return r;
+        }
+    }
+    return db_live.load(std::memory_order_acquire);
+}
+
+extern int sig_reload_flag; /* Set by SIGHUP, defined in signal_handling.c */
 
 #define MAX_FP_STR_LEN 4096
 #define MAX_SNI_LEN     257
 
-//pthread_mutex_t lock_fp_cache;
-//std::unordered_map<std::string,char*> fp_cache;
+/*
+ * cache of completed analysis results, keyed on the fingerprint
+ * string and the destination context (server name, address, and
+ * port).  Traffic is repetitive enough that most flows repeat a
+ * recently seen combination, so the cache short-circuits the Bayes
+ * scoring and the process iteration entirely.  Each thread has its
+ * own direct-mapped table (each slot holds the most recent result
+ * that hashed to it), so no locking is needed; a result_len of zero
+ * records that the fingerprint has no database entry, which saves
+ * repeated failed lookups.  Cached results belong to the database
+ * generation they were computed from, so each thread tracks the
+ * generation it last saw and drops its table when a reload has
+ * swapped the database underneath it.
+ */
+#define ANALYSIS_CACHE_NUM_ENTRIES 256
+#define ANALYSIS_CACHE_MAX_RESULT_LEN 512
+
+struct analysis_cache_entry {
+    uint64_t hash;
+    uint16_t result_len;
+    bool valid;
+    char result[ANALYSIS_CACHE_MAX_RESULT_LEN];
+};
+
+static thread_local struct analysis_cache_entry analysis_cache[ANALYSIS_CACHE_NUM_ENTRIES];
+static thread_local uint64_t analysis_cache_generation = 0;
+
+/*
+ * per-thread pool for the result buffers that perform_analysis()
+ * hands back to its callers (see arena.h); a buffer is released back
+ * to the pool once the result has been written and cached, so
+ * steady-state scoring allocates nothing from the global heap
+ */
+static thread_local struct slab_pool<MAX_FP_STR_LEN> analysis_result_pool;
+
+/*
+ * per-thread interning pool (see intern.h) for the fingerprint and
+ * server-name strings of the flows this thread scores.  Each distinct
+ * string is copied and hashed once; the stored hashes build the
+ * analysis cache key below without another pass over the bytes, and
+ * the interned fingerprint's memo slot records which database record
+ * it resolved to, so the Bloom filter, index, and BK-tree are
+ * consulted once per distinct fingerprint per database generation
+ * rather than once per flow
+ */
+static thread_local struct string_intern_table analysis_intern;
+
+/*
+ * memo value recording that a fingerprint resolved to no database
+ * record in the tagged generation, so the failed lookup -- including
+ * the BK-tree search for a near match -- is not repeated
+ */
+static const char fp_match_none[1] = { '\0' };
+
+static uint64_t analysis_fnv1a_64(uint64_t hash, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 0x00000100000001b3;
+    }
+    return hash;
+}
+
+/*
+ * Bloom filter over the fingerprint strings of a database
+ * generation.  Most fingerprints on a typical link are not in the
+ * database at all, so perform_analysis() consults the filter before
+ * the main lookup: a definite miss is rejected after at most two
+ * cache-line touches, with no index probe and no record traversal.
+ * The filter uses two bit positions derived from one FNV-1a hash and
+ * is sized at sixteen bits per fingerprint, rounded up to a power of
+ * two, which keeps the false-positive rate under two percent; a
+ * false positive only means that the main lookup runs and misses.
+ */
+static void bloom_size(struct analysis_database *db, size_t num_strings) {
+    size_t bits = 64;
+    while (bits < num_strings * 16) {
+        bits *= 2;
+    }
+    db->fp_bloom.assign(bits / 64, 0);
+    db->fp_bloom_mask = bits - 1;
+}
+
+static void bloom_insert(struct analysis_database *db, const char *s) {
+    uint64_t h = analysis_fnv1a_64(0xcbf29ce484222325, (const uint8_t *)s, strlen(s));
+    uint64_t b1 = h & db->fp_bloom_mask;
+    uint64_t b2 = ((h >> 33) | (h << 31)) & db->fp_bloom_mask;
+    db->fp_bloom[b1 >> 6] |= (uint64_t)1 << (b1 & 63);
+    db->fp_bloom[b2 >> 6] |= (uint64_t)1 << (b2 & 63);
+}
+
+static bool bloom_contains(const struct analysis_database *db, const char *s) {
+    uint64_t h = analysis_fnv1a_64(0xcbf29ce484222325, (const uint8_t *)s, strlen(s));
+    uint64_t b1 = h & db->fp_bloom_mask;
+    uint64_t b2 = ((h >> 33) | (h << 31)) & db->fp_bloom_mask;
+    return (db->fp_bloom[b1 >> 6] & ((uint64_t)1 << (b1 & 63)))
+        && (db->fp_bloom[b2 >> 6] & ((uint64_t)1 << (b2 & 63)));
+}
+
+/*
+ * approximate fingerprint matching.  A new client release typically
+ * shifts one cipher suite or extension, so its fingerprint lands one
+ * or two tokens away from a database entry rather than in it; on an
+ * exact miss, perform_analysis() looks for the nearest database
+ * fingerprint within a small edit radius and scores against that
+ * record instead of giving up.  The fingerprint string is split into
+ * its innermost parenthesized groups (a version, a cipher-suite
+ * list, or one extension each form a token), the distance between
+ * two fingerprints is the edit distance over those token sequences,
+ * and the database fingerprints are held in a BK-tree, which the
+ * triangle inequality keeps sublinear to search.
+ */
+#define FP_APPROX_RADIUS 2
+static std::vector<std::string> fp_tokenize(const char *fp_str) {
+    std::vector<std::string> tokens;
+    const char *open = NULL;
+    bool inner = false;
+    for (const char *c = fp_str; *c != '\0'; c++) {
+        if (*c == '(') {
+            open = c;
+            inner = true;
+        } else if (*c == ')') {
+            if (inner && open) {
+                tokens.push_back(std::string(open + 1, c));
+            }
+            inner = false;
+        }
+    }
+    return tokens;
+}
+
+static unsigned int fp_token_edit_distance(const std::vector<std::string> &a,
+                                           const std::vector<std::string> &b) {
+    size_t la = a.size(), lb = b.size();
+    std::vector<unsigned int> row(lb + 1);
+    for (size_t j = 0; j <= lb; j++) {
+        row[j] = j;
+    }
+    for (size_t i = 1; i <= la; i++) {
+        unsigned int diag = row[0];
+        row[0] = i;
+        for (size_t j = 1; j <= lb; j++) {
+            unsigned int tmp = row[j];
+            unsigned int subst = diag + (a[i-1] == b[j-1] ? 0 : 1);
+            row[j] = std::min(std::min(row[j] + 1, row[j-1] + 1), subst);
+            diag = tmp;
+        }
+    }
+    return row[lb];
+}
+
+static void bk_insert(struct analysis_database *db, const char *fp) {
+    struct fp_bk_node node;
+    node.fp = fp;
+    node.tokens = fp_tokenize(fp);
+    if (db->fp_bk_tree.empty()) {
+        db->fp_bk_tree.push_back(std::move(node));
+        return;
+    }
+    uint32_t cur = 0;
+    for (;;) {
+        unsigned int d = fp_token_edit_distance(node.tokens, db->fp_bk_tree[cur].tokens);
+        if (d == 0) {
+            return;   /* duplicate fingerprint */
+        }
+        auto child = db->fp_bk_tree[cur].children.find(d);
+        if (child == db->fp_bk_tree[cur].children.end()) {
+            db->fp_bk_tree[cur].children[d] = db->fp_bk_tree.size();
+            db->fp_bk_tree.push_back(std::move(node));
+            return;
+        }
+        cur = child->second;
+    }
+}
 
-std::unordered_map<uint16_t, std::string> port_mapping = {{443, "https"},  {448,"database"}, {465,"email"},
-                                                          {563,"nntp"},    {585,"email"},    {614,"shell"},
-                                                          {636,"ldap"},    {989,"ftp"},      {990,"ftp"},
-                                                          {991,"nas"},     {992,"telnet"},   {993,"email"},
-                                                          {994,"irc"},     {995,"email"},    {1443,"alt-https"},
-                                                          {2376,"docker"}, {8001,"tor"},     {8443,"alt-https"},
-                                                          {9000,"tor"},    {9001,"tor"},     {9002,"tor"},
-                                                          {9101,"tor"}};
+/*
+ * database_approx_match(db, fp_str) returns the database fingerprint
+ * nearest to fp_str within FP_APPROX_RADIUS token edits, or NULL if
+ * there is none; ties go to the candidate found first, which is
+ * deterministic for a given database
+ */
+static const char *database_approx_match(const struct analysis_database *db, const char *fp_str) {
+    if (db->fp_bk_tree.empty()) {
+        return NULL;
+    }
+    std::vector<std::string> tokens = fp_tokenize(fp_str);
+    unsigned int best_d = FP_APPROX_RADIUS + 1;
+    const char *best = NULL;
+    std::vector<uint32_t> stack;
+    stack.push_back(0);
+    while (!stack.empty()) {
+        const struct fp_bk_node &node = db->fp_bk_tree[stack.back()];
+        stack.pop_back();
+        unsigned int d = fp_token_edit_distance(tokens, node.tokens);
+        if (d < best_d) {
+            best_d = d;
+            best = node.fp;
+            if (best_d == 0) {
+                break;
+            }
+        }
+        /* a subtree at child distance k holds only fingerprints at
+         * distance >= |d - k| from the query, so anything further
+         * than the improvement bound is pruned */
+        unsigned int limit = best_d - 1;
+        unsigned int lo = (d > limit) ? d - limit : 0;
+        for (auto &child : node.children) {
+            if (child.first >= lo && child.first <= d + limit) {
+                stack.push_back(child.second);
+            }
+        }
+    }
+    return best;
+}
 
-bool MALWARE_DB = true;
-bool EXTENDED_FP_METADATA = true;
+/*
+ * map from destination port to application name, held as a flat
+ * array indexed by the port number; get_port_app() runs once per
+ * analyzed flow, so the lookup is a single load with no hashing and
+ * no string construction
+ */
+struct port_app_table {
+    const char *app[65536];
+
+    port_app_table() {
+        static const struct { uint16_t port; const char *app; } mapping[] = {
+            {443, "https"},  {448,"database"}, {465,"email"},
+            {563,"nntp"},    {585,"email"},    {614,"shell"},
+            {636,"ldap"},    {989,"ftp"},      {990,"ftp"},
+            {991,"nas"},     {992,"telnet"},   {993,"email"},
+            {994,"irc"},     {995,"email"},    {1443,"alt-https"},
+            {2376,"docker"}, {8001,"tor"},     {8443,"alt-https"},
+            {9000,"tor"},    {9001,"tor"},     {9002,"tor"},
+            {9101,"tor"}
+        };
+        for (unsigned int i = 0; i < 65536; i++) {
+            app[i] = "unknown";
+        }
+        for (unsigned int i = 0; i < sizeof(mapping)/sizeof(mapping[0]); i++) {
+            app[mapping[i].port] = mapping[i].app;
+        }
+    }
+};
 
+static const struct port_app_table port_mapping;
 
 int gzgetline(gzFile f, std::vector<char>& v) {
     v = std::vector<char>(256);
@@ -66,39 +437,228 @@ int gzgetline(gzFile f, std::vector<char>& v) {
 }
 
 
-int database_init(const char *resource_file) {
-    fp_db.SetObject();
-    rapidjson::Document::AllocatorType& allocator = fp_db.GetAllocator();
+/*
+ * worker for database_init(): parses every num_workers-th line into
+ * its own document; the stripes are disjoint, so the workers share
+ * nothing.  The malware and extended-metadata determinations are
+ * made per worker and combined after the join.
+ */
+static void database_parse_lines(struct analysis_database *db,
+                                 const std::vector<std::string> *lines,
+                                 unsigned int worker,
+                                 unsigned int num_workers,
+                                 bool *malware_db,
+                                 bool *extended_fp_metadata,
+                                 bool *parse_ok) {
+    *malware_db = true;
+    *extended_fp_metadata = true;
+    *parse_ok = true;
+
+    for (size_t i = worker; i < lines->size(); i += num_workers) {
+        rapidjson::Document &fp = db->fp_db_records[i];
+        fp.Parse((*lines)[i].c_str());
+        if (fp.HasParseError() || !fp.IsObject()
+            || !fp.HasMember("str_repr") || !fp.HasMember("process_info")) {
+            *parse_ok = false;
+            return;
+        }
+
+        rapidjson::Value::ConstMemberIterator itr = fp["process_info"][0].FindMember("malware");
+        if (itr == fp["process_info"][0].MemberEnd()) {
+            *malware_db = false;
+        }
+
+        itr = fp["process_info"][0].FindMember("classes_hostname_sni");
+        if (itr == fp["process_info"][0].MemberEnd()) {
+            *extended_fp_metadata = false;
+        }
+    }
+}
+
+int database_init(const char *resource_file, struct analysis_database *db) {
 
     gzFile in_file = gzopen(resource_file, "r");
     if (in_file == NULL) {
         return -1;
     }
+
+    /*
+     * gzip decompression is inherently sequential, so the lines are
+     * read on this thread and the parsing, which dominates the load,
+     * is spread across the worker pool
+     */
+    std::vector<std::string> lines;
     std::vector<char> line;
+    uint64_t text_bytes = 0;
     while (gzgetline(in_file, line)) {
-        std::string line_str(line.begin(), line.end());
-        rapidjson::Document fp(&allocator);
-        fp.Parse(line_str.c_str());
+        lines.push_back(std::string(line.begin(), line.end()));
+        text_bytes += line.size();
+    }
+    gzclose(in_file);
 
-        rapidjson::Value::ConstMemberIterator itr = fp["process_info"][0].FindMember("malware");
-        if (itr == fp["process_info"][0].MemberEnd()) {
-            MALWARE_DB = false;
+    unsigned int num_workers = std::thread::hardware_concurrency();
+    if (num_workers < 1) {
+        num_workers = 1;
+    }
+    if (num_workers > lines.size()) {
+        num_workers = lines.size() ? lines.size() : 1;
+    }
+
+    db->fp_db_records.clear();
+    db->fp_db_records.resize(lines.size());
+
+    struct worker_flags {
+        bool malware_db;
+        bool extended_fp_metadata;
+        bool parse_ok;
+    };
+    std::vector<struct worker_flags> flags(num_workers);
+    std::vector<std::thread> workers;
+    for (unsigned int w = 1; w < num_workers; w++) {
+        workers.push_back(std::thread(database_parse_lines, db, &lines, w, num_workers,
+                                      &flags[w].malware_db, &flags[w].extended_fp_metadata, &flags[w].parse_ok));
+    }
+    database_parse_lines(db, &lines, 0, num_workers,
+                         &flags[0].malware_db, &flags[0].extended_fp_metadata, &flags[0].parse_ok);
+    for (auto &t : workers) {
+        t.join();
+    }
+
+    db->malware_db = true;
+    db->extended_fp_metadata = true;
+    for (unsigned int w = 0; w < num_workers; w++) {
+        if (flags[w].parse_ok == false) {
+            db->fp_db_records.clear();
+            return -1;   /* malformed database line */
         }
+        db->malware_db = db->malware_db && flags[w].malware_db;
+        db->extended_fp_metadata = db->extended_fp_metadata && flags[w].extended_fp_metadata;
+    }
 
-        itr = fp["process_info"][0].FindMember("classes_hostname_sni");
-        if (itr == fp["process_info"][0].MemberEnd()) {
-            EXTENDED_FP_METADATA = false;
+    db->fp_db_index.reserve(db->fp_db_records.size());
+    bloom_size(db, db->fp_db_records.size());
+    db->fp_bk_tree.reserve(db->fp_db_records.size());
+    for (rapidjson::Document &fp : db->fp_db_records) {
+        db->fp_db_index[fp["str_repr"].GetString()] = &fp;
+        bloom_insert(db, fp["str_repr"].GetString());
+        bk_insert(db, fp["str_repr"].GetString());
+    }
+
+    if (db->extended_fp_metadata) {
+        for (rapidjson::Document &fp : db->fp_db_records) {
+            const rapidjson::Value &procs = fp["process_info"];
+            std::unordered_map<std::string, sni_match_list> &index = db->sni_class_index[&fp];
+            for (rapidjson::SizeType i = 0; i < procs.Size(); i++) {
+                rapidjson::Value::ConstMemberIterator sni_itr = procs[i].FindMember("classes_hostname_sni");
+                if (sni_itr == procs[i].MemberEnd()) {
+                    continue;
+                }
+                for (rapidjson::Value::ConstMemberIterator m = sni_itr->value.MemberBegin(); m != sni_itr->value.MemberEnd(); ++m) {
+                    index[m->name.GetString()].push_back({i, (uint64_t)m->value.GetInt64()});
+                }
+            }
         }
+    }
+
+    /* the parsed documents occupy a small multiple of the JSON text
+     * they came from, so the text size is registered as a lower
+     * bound; the compiled form reports its exact mapped size instead */
+    memory_report_register("analysis", "fingerprint_db JSON (parsed; heap use exceeds this)", text_bytes);
+    memory_report_register("analysis", "fingerprint bloom filter and BK-tree",
+                           db->fp_bloom.size() * sizeof(uint64_t)
+                           + db->fp_bk_tree.capacity() * sizeof(struct fp_bk_node));
 
-        fp_db.AddMember(fp["str_repr"], fp, allocator);
+    return 0;  /* success */
+}
+
+int database_init_bin(const char *resource_file, struct analysis_database *db) {
+
+    int fd = open(resource_file, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) != 0 || statbuf.st_size < (off_t)sizeof(struct fp_db_bin_hdr)) {
+        close(fd);
+        return -1;
+    }
+    /*
+     * the mapping is read-only and MAP_SHARED, so all mercury
+     * processes on the host (one per interface, say) reference the
+     * same physical pages through the page cache: N processes
+     * consume one copy of the database
+     */
+    void *addr = mmap(NULL, statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return -1;
+    }
+
+    const struct fp_db_bin_hdr *hdr = (const struct fp_db_bin_hdr *)addr;
+    if (memcmp(hdr->magic, FP_DB_BIN_MAGIC, sizeof(hdr->magic)) != 0
+        || hdr->version != FP_DB_BIN_VERSION
+        || hdr->file_size != (uint64_t)statbuf.st_size) {
+        munmap(addr, statbuf.st_size);
+        return -1;
     }
-    gzclose(in_file);
+
+    db->bin_base = (const uint8_t *)addr;
+    db->bin_size = statbuf.st_size;
+    db->malware_db = hdr->flags & FP_DB_BIN_FLAG_MALWARE;
+    db->extended_fp_metadata = hdr->flags & FP_DB_BIN_FLAG_EXTENDED;
+
+    const struct fp_db_bin_index *index = (const struct fp_db_bin_index *)(db->bin_base + hdr->index_offset);
+    bloom_size(db, hdr->fp_count);
+    db->fp_bk_tree.reserve(hdr->fp_count);
+    for (uint32_t i = 0; i < hdr->fp_count; i++) {
+        bloom_insert(db, fp_db_bin_string(db->bin_base, index[i].fp_str));
+        bk_insert(db, fp_db_bin_string(db->bin_base, index[i].fp_str));
+    }
+
+    memory_report_register("analysis", "fingerprint_db compiled image (mapped, shared)", db->bin_size);
+    memory_report_register("analysis", "fingerprint bloom filter and BK-tree",
+                           db->fp_bloom.size() * sizeof(uint64_t)
+                           + db->fp_bk_tree.capacity() * sizeof(struct fp_bk_node));
 
     return 0;  /* success */
 }
 
-void database_finalize() {
-    fp_db.SetObject();
+static void database_free(struct analysis_database *db) {
+    if (db == NULL) {
+        return;
+    }
+    if (db->bin_base) {
+        munmap((void *)db->bin_base, db->bin_size);
+    }
+    delete db;
+}
+
+/*
+ * database_load() builds a complete database generation from the
+ * resource directory, preferring the compiled form, which is mapped
+ * rather than parsed; it returns NULL if neither form could be
+ * loaded.  It touches no global state, so it is safe to run while
+ * worker threads are scoring flows against the live generation.
+ */
+static struct analysis_database *database_load(const char *resource_dir, int verbosity) {
+    struct analysis_database *db = new struct analysis_database;
+    char resource_file_name[PATH_MAX];
+
+    strncpy(resource_file_name, resource_dir, PATH_MAX-1);
+    strncat(resource_file_name, "/fingerprint_db.bin", PATH_MAX-1);
+    if (database_init_bin(resource_file_name, db) == 0) {
+        return db;
+    }
+    strncpy(resource_file_name, resource_dir, PATH_MAX-1);
+    strncat(resource_file_name, "/fingerprint_db.json.gz", PATH_MAX-1);
+    if (database_init(resource_file_name, db) == 0) {
+        return db;
+    }
+    if (verbosity > 0) {
+        fprintf(stderr, "warning: could not open file '%s'\n", resource_file_name);
+    }
+    database_free(db);
+    return NULL;
 }
 
 
@@ -106,13 +666,119 @@ void database_finalize() {
 #define DEFAULT_RESOURCE_DIR "/usr/local/share/mercury"
 #endif
 
-int analysis_init(int verbosity, const char *resource_dir) {
+/* resource directory in use, kept for database reloads */
+static char db_resource_dir[PATH_MAX];
+
+/*
+ * database_reload() builds a replacement database generation off to
+ * the side and publishes it with a single pointer swap; worker
+ * threads calling write_analysis_from_extractor_and_flow_key()
+ * never block, and a failed load leaves the live generation in
+ * place.  The generation displaced by the previous reload is freed
+ * here, one full reload interval later, by which time any reader
+ * that loaded its pointer has long since finished the flow it was
+ * scoring.  A mutex serializes the SIGHUP watcher below and the
+ * runtime control socket (control.c), either of which may request a
+ * reload; resource_dir, if non-NULL, replaces the directory used for
+ * this and later reloads.
+ */
+static pthread_mutex_t db_reload_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * database_replicate_node() builds the given node's replica of the
+ * current generation, with db_reload_mutex held; the replica
+ * displaced by a rebuild is retired and freed one rebuild later,
+ * exactly as db_retired is for the live generation
+ */
+static void database_replicate_node(int node) {
+    if (database_bind_mempolicy(MPOL_BIND, node) != 0) {
+        fprintf(stderr, "warning: could not bind database replica allocation to NUMA node %d\n", node);
+    }
+    struct analysis_database *copy = database_load(db_resource_dir, 0);
+    database_bind_mempolicy(MPOL_DEFAULT, -1);
+    if (copy == NULL) {
+        fprintf(stderr, "warning: could not build database replica for NUMA node %d\n", node);
+        return;
+    }
+    db_replica_generation[node].store(db_generation.load(std::memory_order_acquire), std::memory_order_release);
+    struct analysis_database *old = db_replica[node].exchange(copy, std::memory_order_acq_rel);
+    database_free(db_replica_retired[node]);
+    db_replica_retired[node] = old;
+}
+
+static int database_reload(const char *resource_dir) {
+    pthread_mutex_lock(&db_reload_mutex);
+    if (resource_dir != NULL) {
+        strncpy(db_resource_dir, resource_dir, PATH_MAX-1);
+    }
+    struct analysis_database *fresh = database_load(db_resource_dir, 1);
+    if (fresh == NULL) {
+        fprintf(stderr, "warning: could not reload fingerprint database from '%s', keeping current database\n", db_resource_dir);
+        pthread_mutex_unlock(&db_reload_mutex);
+        return -1;
+    }
+    struct analysis_database *old = db_live.exchange(fresh, std::memory_order_acq_rel);
+    db_generation.fetch_add(1, std::memory_order_release);
+    database_free(db_retired);
+    db_retired = old;
+    for (int node = 0; node < MAX_NUMA_NODES; node++) {
+        if (db_replica_wanted[node]) {
+            database_replicate_node(node);
+        }
+    }
+    fprintf(stderr, "reloaded fingerprint database from '%s'\n", db_resource_dir);
+    pthread_mutex_unlock(&db_reload_mutex);
+    return 0;
+}
+
+int analysis_reload(const char *resource_dir) {
+    if (db_live.load(std::memory_order_acquire) == NULL) {
+        fprintf(stderr, "warning: analysis module not initialized; nothing to reload\n");
+        return -1;
+    }
+    return database_reload(resource_dir);
+}
 
-//    if (pthread_mutex_init(&lock_fp_cache, NULL) != 0) {
-//       printf("\n mutex init has failed\n");
-//        return -1;
-//    }
-//    fp_cache = {};
+int analysis_replicate_on_node(int numa_node) {
+    if (numa_node < 0 || numa_node >= MAX_NUMA_NODES) {
+        return -1;
+    }
+    if (db_live.load(std::memory_order_acquire) == NULL) {
+        return -1;   /* the analysis module is not initialized */
+    }
+    pthread_mutex_lock(&db_reload_mutex);
+    db_replica_wanted[numa_node] = true;    /* rebuilt by every later reload */
+    database_replicate_node(numa_node);
+    int retcode = db_replica[numa_node].load(std::memory_order_acquire) == NULL ? -1 : 0;
+    pthread_mutex_unlock(&db_reload_mutex);
+    return retcode;
+}
+
+void analysis_set_thread_node(int numa_node) {
+    if (numa_node >= 0 && numa_node < MAX_NUMA_NODES) {
+        db_thread_node = numa_node;
+    }
+}
+
+/*
+ * the reload thread waits for SIGHUP (which sets sig_reload_flag;
+ * see signal_handling.c) and runs the reload itself, keeping the
+ * load off both signal context and the packet-processing threads
+ */
+static std::thread db_reload_thread;
+static std::atomic<bool> db_reload_stop{false};
+
+static void database_reload_watcher() {
+    while (db_reload_stop.load(std::memory_order_relaxed) == false) {
+        sleep(1);
+        if (sig_reload_flag) {
+            sig_reload_flag = 0;
+            database_reload(NULL);
+        }
+    }
+}
+
+int analysis_init(int verbosity, const char *resource_dir) {
 
     const char *resource_dir_list[] =
       {
@@ -126,27 +792,39 @@ int analysis_init(int verbosity, const char *resource_dir) {
         resource_dir_list[1] = NULL;          // fail otherwise
     }
 
-    char resource_file_name[PATH_MAX];
-
     unsigned int index = 0;
     while (resource_dir_list[index] != NULL) {
-        strncpy(resource_file_name, resource_dir_list[index], PATH_MAX-1);
-        strncat(resource_file_name, "/pyasn.db", PATH_MAX-1);
-        int retcode = addr_init(resource_file_name);
-
-        if (retcode == 0) {
-            strncpy(resource_file_name, resource_dir_list[index], PATH_MAX-1);
-            strncat(resource_file_name, "/fingerprint_db.json.gz", PATH_MAX-1);
-            retcode = database_init(resource_file_name);
-            if (retcode == 0) {
-                if (verbosity > 0) {
-                    fprintf(stderr, "initialized analysis module with resource directory %s\n", resource_dir_list[index]);
-                }
-                return 0;
+        char addr_file_name[PATH_MAX];
+        strncpy(addr_file_name, resource_dir_list[index], PATH_MAX-1);
+        strncat(addr_file_name, "/pyasn.db", PATH_MAX-1);
+
+        /*
+         * the BGP/ASN subnet data and the fingerprint database are
+         * independent of each other, so they load concurrently
+         */
+        int addr_retcode = -1;
+        std::thread addr_loader([&addr_retcode, &addr_file_name]() {
+            addr_retcode = addr_init(addr_file_name);
+        });
+
+        struct analysis_database *db = database_load(resource_dir_list[index], verbosity);
+        addr_loader.join();
+
+        if (addr_retcode == 0 && db != NULL) {
+            strncpy(db_resource_dir, resource_dir_list[index], PATH_MAX-1);
+            db_live.store(db, std::memory_order_release);
+            db_generation.fetch_add(1, std::memory_order_release);
+            db_reload_thread = std::thread(database_reload_watcher);
+            if (verbosity > 0) {
+                fprintf(stderr, "initialized analysis module with resource directory %s\n", resource_dir_list[index]);
             }
+            return 0;
         }
+        database_free(db);
         if (verbosity > 0) {
-            fprintf(stderr, "warning: could not open file '%s'\n", resource_file_name);
+            if (addr_retcode != 0) {
+                fprintf(stderr, "warning: could not open file '%s'\n", addr_file_name);
+            }
             fprintf(stderr, "warning: could not initialize analysis module with resource directory '%s', trying next in list\n", resource_dir_list[index]);
         }
 
@@ -159,8 +837,14 @@ int analysis_init(int verbosity, const char *resource_dir) {
 
 int analysis_finalize() {
 
+    if (db_reload_thread.joinable()) {
+        db_reload_stop.store(true, std::memory_order_relaxed);
+        db_reload_thread.join();
+    }
     addr_finalize();
-    database_finalize();
+    database_free(db_live.exchange(NULL, std::memory_order_acq_rel));
+    database_free(db_retired);
+    db_retired = NULL;
 //    cache_finalize();
 
     return 1;
@@ -225,62 +909,345 @@ uint16_t flow_key_get_dst_port(const struct key &key) {
 }
 
 
-std::string get_port_app(uint16_t dst_port) {
-    auto it = port_mapping.find(dst_port);
-    if (it != port_mapping.end()) {
-        return it->second;
+const char *get_port_app(uint16_t dst_port) {
+    return port_mapping.app[dst_port];
+}
+
+/*
+ * get_domain_name() copies the last two labels of server_name
+ * ("sni.example.com" yields "example.com") into dst, which must hold
+ * at least dst_len bytes; a name with a single dot yields the dot and
+ * the final label, and a name with no dot yields the empty string.
+ * It runs once per scored flow, so it works with plain pointer
+ * arithmetic and allocates nothing.
+ */
+static const char *get_domain_name(const char *server_name, char *dst, size_t dst_len) {
+    const char *last_dot = strrchr(server_name, '.');
+    if (last_dot == NULL) {
+        dst[0] = '\0';
+        return dst;
+    }
+    const char *start = last_dot;            /* single dot: keep the dot itself */
+    for (const char *p = last_dot; p > server_name; ) {
+        p--;
+        if (*p == '.') {
+            start = p + 1;                   /* two or more dots: last two labels */
+            break;
+        }
+    }
+    strncpy(dst, start, dst_len - 1);
+    dst[dst_len - 1] = '\0';
+    return dst;
+}
+
+/*
+ * analysis_get_asn(dst_addr, dst_ip) resolves the destination ASN,
+ * using the binary IPv4 address when the caller has one, and falling
+ * back to the address string (which may be IPv6) otherwise
+ */
+static uint32_t analysis_get_asn(uint32_t dst_addr, char *dst_ip) {
+    if (dst_addr != 0) {
+        return get_asn_info(dst_addr);
+    }
+    return get_asn_info(dst_ip);
+}
+
+#ifndef USE_QUANTIZED_SCORING
+
+/*
+ * perform_analysis_bin() is the compiled-database counterpart of
+ * perform_analysis(); the scoring is identical, but the fingerprint
+ * record and its class maps are read straight out of the mapped file
+ */
+static int perform_analysis_bin(const struct analysis_database *db, char **result, size_t max_bytes, const char *fp_str, char *server_name, char *dst_ip, uint32_t dst_addr, uint16_t dst_port) {
+    const struct fp_db_bin_hdr *hdr = (const struct fp_db_bin_hdr *)db->bin_base;
+    const struct fp_db_bin_record *record = fp_db_bin_find(db->bin_base, hdr, fp_str);
+    if (record == NULL) {
+        return -1;
+    }
+
+    uint32_t asn_int = analysis_get_asn(dst_addr, dst_ip);
+    char asn[16];
+    snprintf(asn, sizeof(asn), "%" PRIu32, asn_int);
+    const char *port_app = get_port_app(dst_port);
+    char domain[MAX_SNI_LEN];
+    get_domain_name(server_name, domain, sizeof(domain));
+
+    uint64_t fp_tc = record->total_count;
+    uint64_t tmp_value;
+    long double prob_process_given_fp, score;
+    long double max_score = -1.0;
+    long double sec_score = -1.0;
+    long double score_sum = 0.0;
+    long double malware_prob = 0.0;
+    const char *max_proc = "";
+    const char *sec_proc = "";
+    bool max_mal = false;
+    bool sec_mal = false;
+
+    long double base_prior;
+    long double proc_prior = log(.1);
+
+    const struct fp_db_bin_process *procs = fp_db_bin_record_procs(db->bin_base, record);
+    for (uint32_t i = 0; i < record->num_procs; i++) {
+        const struct fp_db_bin_process *proc = &procs[i];
+        bool malware = proc->flags & FP_DB_BIN_PROC_MALWARE;
+        prob_process_given_fp = (long double)proc->count/fp_tc;
+
+        base_prior = log(1.0/fp_tc);
+        if ((proc->flags & FP_DB_BIN_PROC_DOMAIN_MEAN) && proc->domain_mean < 0.5) {
+            base_prior = log(.1/fp_tc);
+        }
+
+        score = log(prob_process_given_fp);
+        score = fmax(score, proc_prior);
+
+        if (fp_db_bin_class_lookup(db->bin_base, &proc->classes[fp_db_bin_class_ip_as], asn, &tmp_value)) {
+            score += log((long double)tmp_value/fp_tc)*0.13924;
+        } else {
+            score += base_prior*0.13924;
+        }
+
+        if (fp_db_bin_class_lookup(db->bin_base, &proc->classes[fp_db_bin_class_hostname_domains], domain, &tmp_value)) {
+            score += log((long double)tmp_value/fp_tc)*0.15590;
+        } else {
+            score += base_prior*0.15590;
+        }
+
+        if (fp_db_bin_class_lookup(db->bin_base, &proc->classes[fp_db_bin_class_port_applications], port_app, &tmp_value)) {
+            score += log((long double)tmp_value/fp_tc)*0.00528;
+        } else {
+            score += base_prior*0.00528;
+        }
+
+        if (db->extended_fp_metadata) {
+            if (fp_db_bin_class_lookup(db->bin_base, &proc->classes[fp_db_bin_class_ip_ip], dst_ip, &tmp_value)) {
+                score += log((long double)tmp_value/fp_tc)*0.56735;
+            } else {
+                score += base_prior*0.56735;
+            }
+
+            if (fp_db_bin_class_lookup(db->bin_base, &proc->classes[fp_db_bin_class_hostname_sni], server_name, &tmp_value)) {
+                score += log((long double)tmp_value/fp_tc)*0.96941;
+            } else {
+                score += base_prior*0.96941;
+            }
+        }
+
+        score = exp(score);
+        score_sum += score;
+
+        if (db->malware_db) {
+            if (malware && score > 0.0) {
+                malware_prob += score;
+            }
+
+            if (score > max_score) {
+                sec_score = max_score;
+                sec_proc = max_proc;
+                sec_mal = max_mal;
+                max_score = score;
+                max_proc = fp_db_bin_string(db->bin_base, proc->name);
+                max_mal = malware;
+            } else if (score > sec_score) {
+                sec_score = score;
+                sec_proc = fp_db_bin_string(db->bin_base, proc->name);
+                sec_mal = malware;
+            }
+        } else {
+            if (score > max_score) {
+                max_score = score;
+                max_proc = fp_db_bin_string(db->bin_base, proc->name);
+            }
+        }
+
+    }
+
+    if (db->malware_db && strcmp(max_proc, "Generic DMZ Traffic") == 0 && sec_mal == false) {
+        max_proc = sec_proc;
+        max_score = sec_score;
+        max_mal = sec_mal;
+    }
+
+    if (score_sum > 0.0) {
+        max_score /= score_sum;
+        if (db->malware_db) {
+            malware_prob /= score_sum;
+        }
+    }
+
+    *result = (char*)analysis_result_pool.alloc();
+    if (*result == NULL) {
+        return -1;
+    }
+    if (db->malware_db) {
+        snprintf(*result, max_bytes, "\"analysis\":{\"process\":\"%s\",\"score\":%Lf,\"malware\":%d,\"p_malware\":%Lf}", max_proc, max_score, max_mal, malware_prob);
+    } else {
+        snprintf(*result, max_bytes, "\"analysis\":{\"process\":\"%s\",\"score\":%Lf}", max_proc, max_score);
     }
 
-    return "unknown";
+    return 0;
 }
 
-std::string get_domain_name(char* server_name) {
-    std::string r_server_name(server_name);
-    std::reverse(r_server_name.begin(), r_server_name.end());
+#else /* USE_QUANTIZED_SCORING */
+
+/*
+ * quantized scoring over the compiled database (build with "make
+ * use_quantized_scoring=yes"): each process score accumulates the
+ * 16-bit fixed-point log-likelihoods precomputed by fp_db_compiler
+ * into an int32, with no logarithms taken on the packet path; a
+ * score is converted to floating point once per process, for the
+ * normalization and the reported result.  Scores agree with the
+ * floating-point path to within the quantization step (2^-10 in
+ * natural-log space).
+ */
+static int perform_analysis_bin(const struct analysis_database *db, char **result, size_t max_bytes, const char *fp_str, char *server_name, char *dst_ip, uint32_t dst_addr, uint16_t dst_port) {
+    const struct fp_db_bin_hdr *hdr = (const struct fp_db_bin_hdr *)db->bin_base;
+    const struct fp_db_bin_record *record = fp_db_bin_find(db->bin_base, hdr, fp_str);
+    if (record == NULL) {
+        return -1;
+    }
+
+    uint32_t asn_int = analysis_get_asn(dst_addr, dst_ip);
+    char asn[16];
+    snprintf(asn, sizeof(asn), "%" PRIu32, asn_int);
+    const char *port_app = get_port_app(dst_port);
+    char domain[MAX_SNI_LEN];
+    get_domain_name(server_name, domain, sizeof(domain));
+
+    const char *class_key[fp_db_bin_num_classes] = {
+        asn, domain, port_app, dst_ip, server_name
+    };
+    unsigned int num_classes = db->extended_fp_metadata ? fp_db_bin_num_classes : 3;
+
+    long double max_score = -1.0;
+    long double sec_score = -1.0;
+    long double score_sum = 0.0;
+    long double malware_prob = 0.0;
+    const char *max_proc = "";
+    const char *sec_proc = "";
+    bool max_mal = false;
+    bool sec_mal = false;
+
+    const struct fp_db_bin_process *procs = fp_db_bin_record_procs(db->bin_base, record);
+    for (uint32_t i = 0; i < record->num_procs; i++) {
+        const struct fp_db_bin_process *proc = &procs[i];
+        bool malware = proc->flags & FP_DB_BIN_PROC_MALWARE;
+
+        int32_t q = proc->q_proc;
+        for (unsigned int c = 0; c < num_classes; c++) {
+            const struct fp_db_bin_class_entry *entry =
+                fp_db_bin_class_find(db->bin_base, &proc->classes[c], class_key[c]);
+            q += entry ? entry->q_value : proc->q_miss[c];
+        }
+
+        long double score = exp((long double)q / FP_DB_BIN_Q_SCALE);
+        score_sum += score;
+
+        if (db->malware_db) {
+            if (malware && score > 0.0) {
+                malware_prob += score;
+            }
+
+            if (score > max_score) {
+                sec_score = max_score;
+                sec_proc = max_proc;
+                sec_mal = max_mal;
+                max_score = score;
+                max_proc = fp_db_bin_string(db->bin_base, proc->name);
+                max_mal = malware;
+            } else if (score > sec_score) {
+                sec_score = score;
+                sec_proc = fp_db_bin_string(db->bin_base, proc->name);
+                sec_mal = malware;
+            }
+        } else {
+            if (score > max_score) {
+                max_score = score;
+                max_proc = fp_db_bin_string(db->bin_base, proc->name);
+            }
+        }
+
+    }
+
+    if (db->malware_db && strcmp(max_proc, "Generic DMZ Traffic") == 0 && sec_mal == false) {
+        max_proc = sec_proc;
+        max_score = sec_score;
+        max_mal = sec_mal;
+    }
 
-    size_t pos = 0;
-    uint8_t n = 2;
-    std::string token;
-    std::string out_domain;
-    std::stringstream domain;
-    while (((pos = r_server_name.find(".")) != std::string::npos) && (n > 0)) {
-        token = r_server_name.substr(0, pos);
-        domain << token;
-        if (n > 1) {
-            domain << ".";
+    if (score_sum > 0.0) {
+        max_score /= score_sum;
+        if (db->malware_db) {
+            malware_prob /= score_sum;
         }
-        r_server_name.erase(0, pos + 1);
-        n -= 1;
     }
 
-    out_domain = domain.str();
-    std::reverse(out_domain.begin(), out_domain.end());
+    *result = (char*)analysis_result_pool.alloc();
+    if (*result == NULL) {
+        return -1;
+    }
+    if (db->malware_db) {
+        snprintf(*result, max_bytes, "\"analysis\":{\"process\":\"%s\",\"score\":%Lf,\"malware\":%d,\"p_malware\":%Lf}", max_proc, max_score, max_mal, malware_prob);
+    } else {
+        snprintf(*result, max_bytes, "\"analysis\":{\"process\":\"%s\",\"score\":%Lf}", max_proc, max_score);
+    }
+
+    return 0;
+}
 
-    return out_domain;
+#endif /* USE_QUANTIZED_SCORING */
+
+/* database_contains_fp(db, fp) reports whether fp has an exact record */
+static bool database_contains_fp(const struct analysis_database *db, const char *fp) {
+    if (db->bin_base) {
+        const struct fp_db_bin_hdr *hdr = (const struct fp_db_bin_hdr *)db->bin_base;
+        return fp_db_bin_find(db->bin_base, hdr, fp) != NULL;
+    }
+    return db->fp_db_index.find(fp) != db->fp_db_index.end();
 }
 
-// #include <iostream> // for debugging
-// #include "rapidjson/writer.h"
-// print out fp_db for debugging
-// rapidjson::StringBuffer buffer;
-// rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-// fp_db.Accept(writer);
-// std::cerr << buffer.GetString() << std::endl;
+/*
+ * database_resolve_fp(db, fp_str) returns the database fingerprint to
+ * score fp_str against: fp_str itself when it has an exact record,
+ * and otherwise -- an exact miss means the Bloom filter said no, or
+ * turned out to be a false positive -- the nearest fingerprint within
+ * the edit radius, so that a client release that shifted a token or
+ * two keeps its process attribution.  Returns NULL when there is
+ * neither.  The returned pointer is fp_str itself or a string owned
+ * by db, so a caller memoizing it must key the memo to the database
+ * generation (see write_analysis_from_extractor_and_flow_key())
+ */
+static const char *database_resolve_fp(const struct analysis_database *db, const char *fp_str) {
+    if (bloom_contains(db, fp_str) && database_contains_fp(db, fp_str)) {
+        return fp_str;
+    }
+    return database_approx_match(db, fp_str);
+}
 
-int perform_analysis(char **result, size_t max_bytes, char *fp_str, char *server_name, char *dst_ip, uint16_t dst_port) {
-    rapidjson::Value::ConstMemberIterator matcher = fp_db.FindMember(fp_str);
-    if (matcher == fp_db.MemberEnd()) {
+/*
+ * perform_analysis() scores a flow against the database fingerprint
+ * fp_match, which the caller has already resolved with
+ * database_resolve_fp()
+ */
+int perform_analysis(const struct analysis_database *db, char **result, size_t max_bytes, const char *fp_match, char *server_name, char *dst_ip, uint32_t dst_addr, uint16_t dst_port) {
+    if (db->bin_base) {
+        return perform_analysis_bin(db, result, max_bytes, fp_match, server_name, dst_ip, dst_addr, dst_port);
+    }
+    auto matcher = db->fp_db_index.find(fp_match);
+    if (matcher == db->fp_db_index.end()) {
 
         return -1;
     }
-    rapidjson::Value& fp = fp_db[fp_str];
+    const rapidjson::Value& fp = *matcher->second;
 
-    uint32_t asn_int = get_asn_info(dst_ip);
-    std::string asn = std::to_string(asn_int);
-    std::string port_app = get_port_app(dst_port);
-    std::string domain = get_domain_name(server_name);
-    std::string server_name_str(server_name);
-    std::string dst_ip_str(dst_ip);
+    uint32_t asn_int = analysis_get_asn(dst_addr, dst_ip);
+    char asn[16];
+    snprintf(asn, sizeof(asn), "%" PRIu32, asn_int);
+    const char *port_app = get_port_app(dst_port);
+    char domain[MAX_SNI_LEN];
+    get_domain_name(server_name, domain, sizeof(domain));
+    std::string server_name_str(server_name);   /* key for the sni_class_index lookup below */
 
     uint32_t fp_tc, p_count, tmp_value;
     long double prob_process_given_fp, score;
@@ -289,7 +1256,8 @@ int perform_analysis(char **result, size_t max_bytes, char *fp_str, char *server
     long double score_sum = 0.0;
     long double malware_prob = 0.0;
     rapidjson::Value equiv_class;
-    std::string max_proc, sec_proc;
+    const char *max_proc = "";
+    const char *sec_proc = "";
     bool max_mal = false;
     bool sec_mal = false;
 
@@ -300,6 +1268,19 @@ int perform_analysis(char **result, size_t max_bytes, char *fp_str, char *server
     long double proc_prior = log(.1);
     rapidjson::Value::ConstMemberIterator itr;
 
+    /* one lookup classifies the server name for every candidate process */
+    const sni_match_list *sni_matches = NULL;
+    size_t sni_cursor = 0;
+    if (db->extended_fp_metadata) {
+        auto record = db->sni_class_index.find(&fp);
+        if (record != db->sni_class_index.end()) {
+            auto match = record->second.find(server_name_str);
+            if (match != record->second.end()) {
+                sni_matches = &match->second;
+            }
+        }
+    }
+
     const rapidjson::Value& procs = fp["process_info"];
     for (rapidjson::SizeType i = 0; i < procs.Size(); i++) {
         p_count = procs[i]["count"].GetInt();
@@ -314,42 +1295,44 @@ int perform_analysis(char **result, size_t max_bytes, char *fp_str, char *server
         score = log(prob_process_given_fp);
         score = fmax(score, proc_prior);
 
-        itr = procs[i]["classes_ip_as"].FindMember(asn.c_str());
+        itr = procs[i]["classes_ip_as"].FindMember(asn);
         if (itr != procs[i]["classes_ip_as"].MemberEnd()) {
-            tmp_value = procs[i]["classes_ip_as"][asn.c_str()].GetInt();
+            tmp_value = procs[i]["classes_ip_as"][asn].GetInt();
             score += log((long double)tmp_value/fp_tc)*0.13924;
         } else {
             score += base_prior*0.13924;
         }
 
-        itr = procs[i]["classes_hostname_domains"].FindMember(domain.c_str());
+        itr = procs[i]["classes_hostname_domains"].FindMember(domain);
         if (itr != procs[i]["classes_hostname_domains"].MemberEnd()) {
-            tmp_value = procs[i]["classes_hostname_domains"][domain.c_str()].GetInt();
+            tmp_value = procs[i]["classes_hostname_domains"][domain].GetInt();
             score += log((long double)tmp_value/fp_tc)*0.15590;
         } else {
             score += base_prior*0.15590;
         }
 
-        itr = procs[i]["classes_port_applications"].FindMember(port_app.c_str());
+        itr = procs[i]["classes_port_applications"].FindMember(port_app);
         if (itr != procs[i]["classes_port_applications"].MemberEnd()) {
-            tmp_value = procs[i]["classes_port_applications"][port_app.c_str()].GetInt();
+            tmp_value = procs[i]["classes_port_applications"][port_app].GetInt();
             score += log((long double)tmp_value/fp_tc)*0.00528;
         } else {
             score += base_prior*0.00528;
         }
 
-        if (EXTENDED_FP_METADATA) {
-            itr = procs[i]["classes_ip_ip"].FindMember(dst_ip_str.c_str());
+        if (db->extended_fp_metadata) {
+            itr = procs[i]["classes_ip_ip"].FindMember(dst_ip);
             if (itr != procs[i]["classes_ip_ip"].MemberEnd()) {
-                tmp_value = procs[i]["classes_ip_ip"][dst_ip_str.c_str()].GetInt();
+                tmp_value = procs[i]["classes_ip_ip"][dst_ip].GetInt();
                 score += log((long double)tmp_value/fp_tc)*0.56735;
             } else {
                 score += base_prior*0.56735;
             }
 
-            itr = procs[i]["classes_hostname_sni"].FindMember(server_name_str.c_str());
-            if (itr != procs[i]["classes_hostname_sni"].MemberEnd()) {
-                tmp_value = procs[i]["classes_hostname_sni"][server_name_str.c_str()].GetInt();
+            while (sni_matches && sni_cursor < sni_matches->size() && (*sni_matches)[sni_cursor].first < i) {
+                sni_cursor++;
+            }
+            if (sni_matches && sni_cursor < sni_matches->size() && (*sni_matches)[sni_cursor].first == i) {
+                tmp_value = (*sni_matches)[sni_cursor].second;
                 score += log((long double)tmp_value/fp_tc)*0.96941;
             } else {
                 score += base_prior*0.96941;
@@ -359,7 +1342,7 @@ int perform_analysis(char **result, size_t max_bytes, char *fp_str, char *server
         score = exp(score);
         score_sum += score;
 
-        if (MALWARE_DB) {
+        if (db->malware_db) {
             if (procs[i]["malware"].GetBool() == true && score > 0.0) {
                 malware_prob += score;
             }
@@ -385,7 +1368,7 @@ int perform_analysis(char **result, size_t max_bytes, char *fp_str, char *server
 
     }
 
-    if (MALWARE_DB && max_proc == "Generic DMZ Traffic" && sec_mal == false) {
+    if (db->malware_db && strcmp(max_proc, "Generic DMZ Traffic") == 0 && sec_mal == false) {
         max_proc = sec_proc;
         max_score = sec_score;
         max_mal = sec_mal;
@@ -393,16 +1376,19 @@ int perform_analysis(char **result, size_t max_bytes, char *fp_str, char *server
 
     if (score_sum > 0.0) {
         max_score /= score_sum;
-        if (MALWARE_DB) {
+        if (db->malware_db) {
             malware_prob /= score_sum;
         }
     }
 
-    *result = (char*)calloc(max_bytes, sizeof(char));
-    if (MALWARE_DB) {
-        snprintf(*result, max_bytes, "\"analysis\":{\"process\":\"%s\",\"score\":%Lf,\"malware\":%d,\"p_malware\":%Lf}", max_proc.c_str(), max_score, max_mal, malware_prob);
+    *result = (char*)analysis_result_pool.alloc();
+    if (*result == NULL) {
+        return -1;
+    }
+    if (db->malware_db) {
+        snprintf(*result, max_bytes, "\"analysis\":{\"process\":\"%s\",\"score\":%Lf,\"malware\":%d,\"p_malware\":%Lf}", max_proc, max_score, max_mal, malware_prob);
     } else {
-        snprintf(*result, max_bytes, "\"analysis\":{\"process\":\"%s\",\"score\":%Lf}", max_proc.c_str(), max_score);
+        snprintf(*result, max_bytes, "\"analysis\":{\"process\":\"%s\",\"score\":%Lf}", max_proc, max_score);
     }
 
     return 0;
@@ -413,8 +1399,27 @@ void write_analysis_from_extractor_and_flow_key(struct buffer_stream &buf,
                                                 const struct key &key) {
     char* results;
 
+    /*
+     * one acquire load pins this flow to the current database
+     * generation (through this thread's NUMA-node replica, when one
+     * exists); a concurrent reload retires the old generation
+     * without ever making a reader block or fail
+     */
+    const struct analysis_database *db = database_for_thread();
+    if (db == NULL) {
+        return;
+    }
+    uint64_t generation = db_generation.load(std::memory_order_acquire);
+    if (generation != analysis_cache_generation) {
+        for (unsigned int i = 0; i < ANALYSIS_CACHE_NUM_ENTRIES; i++) {
+            analysis_cache[i].valid = false;
+        }
+        analysis_cache_generation = generation;
+    }
+
     int ret_value;
     uint16_t dst_port = flow_key_get_dst_port(key);
+    uint32_t dst_addr = (key.ip_vers == 4) ? key.addr.ipv4.dst : 0;
     char dst_ip_str[MAX_DST_ADDR_LEN];
     flow_key_sprintf_dst_addr(key, dst_ip_str);
 
@@ -431,8 +1436,72 @@ void write_analysis_from_extractor_and_flow_key(struct buffer_stream &buf,
     sn.strncpy(sn_str, MAX_SNI_LEN);
     // fprintf(stderr, "server_name: '%.*s'\tcopy: '%s'\n", (int)sn.length(), sn.data, sn_str);
 
-    ret_value = perform_analysis(&results, MAX_FP_STR_LEN, fp_str, sn_str, dst_ip_str, dst_port);
+    /*
+     * intern the fingerprint and server name (see intern.h); on the
+     * rare allocation failure the stack copies are hashed directly,
+     * exactly as before interning existed
+     */
+    struct interned_string *ifp = analysis_intern.intern(fp_str, strlen(fp_str));
+    struct interned_string *isn = analysis_intern.intern(sn_str, strlen(sn_str));
+
+    uint64_t h = 0xcbf29ce484222325;   /* FNV-1a over the cache key */
+    if (ifp != NULL && isn != NULL) {
+        /* each distinct string was hashed when first interned, so the
+         * cache key costs two multiplies instead of a pass over the
+         * fingerprint bytes */
+        h ^= ifp->hash;
+        h *= 0x00000100000001b3;
+        h ^= isn->hash;
+        h *= 0x00000100000001b3;
+    } else {
+        h = analysis_fnv1a_64(h, (const uint8_t *)fp_str, strlen(fp_str) + 1);
+        h = analysis_fnv1a_64(h, (const uint8_t *)sn_str, strlen(sn_str) + 1);
+    }
+    h = analysis_fnv1a_64(h, (const uint8_t *)dst_ip_str, strlen(dst_ip_str) + 1);
+    h = analysis_fnv1a_64(h, (const uint8_t *)&dst_port, sizeof(dst_port));
+    struct analysis_cache_entry *entry = &analysis_cache[h & (ANALYSIS_CACHE_NUM_ENTRIES - 1)];
+    if (entry->valid && entry->hash == h) {
+        if (entry->result_len > 0) {
+            buf.write_char(',');
+            buf.memcpy(entry->result, entry->result_len);
+        }
+        return;   /* result_len == 0: fingerprint known to have no record */
+    }
+
+    /*
+     * resolve the fingerprint to its database record, through the
+     * interned fingerprint's memo when it was already resolved
+     * against this generation; a repeated fingerprint headed to a new
+     * destination skips the Bloom filter, index, and BK-tree probes
+     */
+    const char *fp_match;
+    if (ifp != NULL && ifp->note != NULL && ifp->note_tag == generation) {
+        fp_match = (const char *)ifp->note;
+    } else {
+        fp_match = database_resolve_fp(db, fp_str);
+        if (ifp != NULL) {
+            if (fp_match == fp_str) {
+                ifp->note = ifp->chars;   /* exact match: the interned copy is the stable one */
+            } else if (fp_match != NULL) {
+                ifp->note = fp_match;     /* near match: a string owned by this generation */
+            } else {
+                ifp->note = fp_match_none;
+            }
+            ifp->note_tag = generation;
+        }
+    }
+    if (fp_match == fp_match_none) {
+        fp_match = NULL;
+    }
+    if (fp_match != NULL) {
+        ret_value = perform_analysis(db, &results, MAX_FP_STR_LEN, fp_match, sn_str, dst_ip_str, dst_addr, dst_port);
+    } else {
+        ret_value = -1;
+    }
     if (ret_value == -1) {
+        entry->hash = h;
+        entry->result_len = 0;
+        entry->valid = true;
         return;
     }
     // fprintf(stderr, "analysis: %s\n", results);
@@ -440,7 +1509,46 @@ void write_analysis_from_extractor_and_flow_key(struct buffer_stream &buf,
     buf.write_char(',');
     buf.strncpy(results);
 
-    free(results);
+    size_t result_len = strlen(results);
+    if (result_len <= ANALYSIS_CACHE_MAX_RESULT_LEN) {
+        entry->hash = h;
+        entry->result_len = result_len;
+        memcpy(entry->result, results, result_len);
+        entry->valid = true;
+    }
+
+    analysis_result_pool.release(results);
+
+}
 
+/*
+ * perform_analysis_from_strings() runs the analysis engine against
+ * fields recovered from stored mercury JSON output, rather than from
+ * a live packet; it is used by the reanalyze batch tool (reanalyze.cc)
+ * to rescore previously captured flows against the current database
+ */
+int perform_analysis_from_strings(char **result, size_t max_bytes, char *fp_str, char *server_name, char *dst_ip, uint16_t dst_port) {
+    const struct analysis_database *db = database_for_thread();
+    if (db == NULL) {
+        return -1;
+    }
+    uint32_t dst_addr = 0;
+    if (inet_pton(AF_INET, dst_ip, &dst_addr) != 1) {
+        dst_addr = 0;
+    }
+    const char *fp_match = database_resolve_fp(db, fp_str);
+    if (fp_match == NULL) {
+        return -1;
+    }
+    /* the pooled buffer stays on this thread; the caller gets a
+     * malloc()ed copy it can free(), as the contract promises */
+    char *pooled = NULL;
+    int ret_value = perform_analysis(db, &pooled, max_bytes, fp_match, server_name, dst_ip, dst_addr, dst_port);
+    if (ret_value != 0) {
+        return ret_value;
+    }
+    *result = strdup(pooled);
+    analysis_result_pool.release(pooled);
+    return *result != NULL ? 0 : -1;
 }
 
@@ -16,11 +16,47 @@
 
 int analysis_init(int verbosity, const char *resource_dir);
 
+/*
+ * analysis_reload() rebuilds the fingerprint database and publishes
+ * it with an atomic pointer swap, without blocking the worker
+ * threads.  If resource_dir is non-NULL, it replaces the resource
+ * directory used for this and later reloads; if NULL, the current
+ * directory is re-read (as with SIGHUP).  It returns 0 on success and
+ * -1 otherwise; a failed load leaves the live database in place.
+ */
+int analysis_reload(const char *resource_dir);
+
+/*
+ * analysis_replicate_on_node() builds a copy of the current
+ * fingerprint database with its memory bound to the given NUMA node,
+ * so that worker threads on that node never pay remote-memory latency
+ * for the hot lookup structures; the capture setup calls it once per
+ * node that hosts workers, before the workers start.  Each worker
+ * then calls analysis_set_thread_node() with its own node, and the
+ * analysis lookup path resolves through the node-local copy.  A
+ * database reload rebuilds the copies.  Returns 0 on success and -1
+ * otherwise; without a replica, lookups use the live database, so a
+ * failure costs only latency.
+ */
+int analysis_replicate_on_node(int numa_node);
+
+void analysis_set_thread_node(int numa_node);
+
 int analysis_finalize();
 
 void write_analysis_from_extractor_and_flow_key(struct buffer_stream &buf,
                                                 const struct tls_client_hello &hello,
                                                 const struct key &key);
 
+/*
+ * perform_analysis_from_strings() analyzes a flow given its
+ * fingerprint, server name, destination address, and destination port
+ * as NUL-terminated strings, setting *result to a malloc()ed analysis
+ * JSON fragment; it returns 0 on success and -1 otherwise (the caller
+ * owns *result only on success).  It is used by the reanalyze tool to
+ * rescore stored mercury output.
+ */
+int perform_analysis_from_strings(char **result, size_t max_bytes, char *fp_str, char *server_name, char *dst_ip, uint16_t dst_port);
+
 
 #endif /* ANALYSIS_H */
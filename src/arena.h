@@ -0,0 +1,123 @@
+/*
+ * arena.h
+ *
+ * A per-thread bump allocator for per-packet serialization state.
+ * Temporary containers built while writing a JSON record (header name
+ * lists in http.cc, lowercased header names, and similar) allocate
+ * from the arena instead of the global heap, and the whole arena is
+ * reset with one store at the start of the next packet, so the
+ * steady-state parse-and-serialize path performs no malloc()/free()
+ * calls.
+ *
+ * The arena is thread_local: each worker gets its own, with no
+ * locking.  If a packet somehow needs more than the arena holds, the
+ * overflow falls back to malloc(), and release() frees exactly those
+ * overflow blocks, so correctness never depends on the arena size.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#define PKT_ARENA_SIZE (64 * 1024) /* bytes per thread; a packet record is at most LLQ_MSG_SIZE */
+
+struct pkt_arena {
+    size_t used = 0;
+    char buf[PKT_ARENA_SIZE];
+
+    void *alloc(size_t n) {
+        n = (n + 15) & ~(size_t)15;   /* keep allocations 16-byte aligned */
+        if (used + n > sizeof(buf)) {
+            return malloc(n);         /* rare overflow; freed in release() */
+        }
+        void *p = buf + used;
+        used += n;
+        return p;
+    }
+
+    void release(void *p) {
+        if ((p < (void *)buf) || (p >= (void *)(buf + sizeof(buf)))) {
+            free(p);   /* an overflow block; arena blocks are reclaimed by reset() */
+        }
+    }
+
+    void reset() {
+        used = 0;
+    }
+};
+
+extern thread_local struct pkt_arena packet_arena; /* defined in json_file_io.c */
+
+/*
+ * arena_allocator makes the per-thread arena usable by standard
+ * containers (std::list, std::basic_string, ...); deallocation is a
+ * no-op except for overflow blocks
+ */
+template <typename T>
+struct arena_allocator {
+    typedef T value_type;
+
+    arena_allocator() = default;
+    template <typename U> arena_allocator(const arena_allocator<U> &) {}
+
+    T *allocate(size_t n) {
+        return (T *)packet_arena.alloc(n * sizeof(T));
+    }
+    void deallocate(T *p, size_t) {
+        packet_arena.release(p);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const arena_allocator<T> &, const arena_allocator<U> &) { return true; }
+
+template <typename T, typename U>
+bool operator!=(const arena_allocator<T> &, const arena_allocator<U> &) { return false; }
+
+/*
+ * slab_pool is a pool of fixed-size blocks for allocations that
+ * outlive the packet arena above (analysis result buffers, for
+ * example).  Blocks are carved from slabs of SLAB_BLOCKS_PER_SLAB
+ * blocks and recycled through a free list, so the steady state
+ * performs no malloc()/free() calls and no allocation-size
+ * bookkeeping; the pool only grows when every block it has carved is
+ * simultaneously live.  Declare an instance thread_local and it needs
+ * no locking; like the arena, its slabs are deliberately never
+ * returned to the heap.
+ */
+#define SLAB_BLOCKS_PER_SLAB 32
+
+template <size_t block_size>
+struct slab_pool {
+    static_assert(block_size >= sizeof(void *), "a free block must hold the free-list link");
+
+    struct slab_block {
+        struct slab_block *next;
+    };
+    struct slab_block *free_list = nullptr;
+
+    void *alloc() {
+        if (free_list == nullptr) {
+            char *slab = (char *)malloc(SLAB_BLOCKS_PER_SLAB * block_size);
+            if (slab == nullptr) {
+                return nullptr;
+            }
+            for (size_t i = 0; i < SLAB_BLOCKS_PER_SLAB; i++) {
+                release(slab + i * block_size);
+            }
+        }
+        struct slab_block *b = free_list;
+        free_list = b->next;
+        return b;
+    }
+
+    void release(void *p) {
+        struct slab_block *b = (struct slab_block *)p;
+        b->next = free_list;
+        free_list = b;
+    }
+};
+
+#endif /* ARENA_H */
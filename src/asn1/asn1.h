@@ -501,23 +501,50 @@ void raw_string_print_as_oid(struct buffer_stream &buf, const uint8_t *raw, size
     }
 }
 
+/*
+ * oid_ph_lookup(p) maps the raw DER-encoded OID in p onto its entry
+ * in the perfect-hash table generated at the end of oid.h, or NULL if
+ * the OID is not in the table; a lookup is two FNV-1a passes over the
+ * raw bytes and one table probe, with no decoding and no allocation
+ */
+static inline uint32_t oid_ph_hash(uint32_t seed, const uint8_t *data, size_t length) {
+    uint32_t h = seed ^ 0x811c9dc5;
+    for (size_t i = 0; i < length; i++) {
+        h = (h ^ data[i]) * 0x01000193;
+    }
+    return h;
+}
+
+static const struct oid_ph_entry *oid_ph_lookup(const struct datum *p) {
+    if (p->is_not_readable()) {
+        return NULL;
+    }
+    const uint8_t *data = p->data;
+    size_t length = p->data_end - p->data;
+    uint32_t bucket = oid_ph_hash(0, data, length) & (OID_PH_BUCKET_COUNT - 1);
+    uint32_t slot = oid_ph_hash(oid_ph_displace[bucket], data, length) & (OID_PH_TABLE_LENGTH - 1);
+    const struct oid_ph_entry *entry = &oid_ph_table[slot];
+    if (entry->bytes == NULL || entry->length != length || memcmp(entry->bytes, data, length) != 0) {
+        return NULL;
+    }
+    return entry;
+}
+
 static const char *oid_empty_string = "";
 const char *parser_get_oid_string(const struct datum *p) {
-    std::basic_string<uint8_t> s = p->get_bytestring();
-    auto pair = oid_dict.find(s);
-    if (pair == oid_dict.end()) {
+    const struct oid_ph_entry *entry = oid_ph_lookup(p);
+    if (entry == NULL) {
         return oid_empty_string;
     }
-    return pair->second.c_str();
+    return entry->name;
 }
 
 enum oid parser_get_oid_enum(const struct datum *p) {
-    std::basic_string<uint8_t> s = p->get_bytestring();
-    auto pair = oid_to_enum.find(s);
-    if (pair == oid_to_enum.end()) {
+    const struct oid_ph_entry *entry = oid_ph_lookup(p);
+    if (entry == NULL) {
         return oid::unknown;
     }
-    return pair->second;
+    return entry->id;
 }
 
 /*
@@ -526,6 +553,7 @@ enum oid parser_get_oid_enum(const struct datum *p) {
 
 struct json_object_asn1 : public json_object {
     explicit json_object_asn1(struct buffer_stream *buf) : json_object(buf) {}
+    explicit json_object_asn1(struct buffer_stream *buf, const char *name) : json_object(buf, name) {}
     json_object_asn1(struct json_object &object, const char *name) : json_object(object, name) {
         //fprintf(stderr, "json_object_asn1 constructor\n");
     }
@@ -983,18 +1011,11 @@ struct tlv {
         return tag & 0x20;
     }
 
-    // is_der_format(data, length) is a spot-check to provide
-    // early detection of malformed input, not a complete check
+    // is_der_format(data, length) checks that the data is a
+    // well-formed DER-encoded TLV tree whose outermost element is a
+    // SEQUENCE; it is defined after struct tlv_traversal, below
     //
-    static bool is_der_format(const void *data, size_t length) {
-        uint8_t *d = (uint8_t *)data;
-        struct datum p{d, d + length};
-        struct tlv test(&p, tlv::SEQUENCE);
-        if (test.is_null() || test.length > (length - 2)) {
-            return false;
-        }
-        return true;
-    }
+    static bool is_der_format(const void *data, size_t length);
 
     int time_cmp(const struct tlv &t) const {
         ssize_t l1 = value.data_end - value.data;
@@ -1420,4 +1441,72 @@ struct tlv {
 
 };
 
+/*
+ * struct tlv_traversal visits every element of a DER-encoded TLV tree
+ * in depth-first order without recursion: a constructed element is
+ * descended into by pushing its value onto an explicit fixed-size
+ * frame array, so the whole traversal runs as a single loop with
+ * constant stack usage.  Nesting deeper than max_depth is rejected as
+ * soon as it is encountered, so pathologically nested input cannot
+ * consume time or stack before being turned away.
+ *
+ * Call next() until it returns false, inspecting the member 'element'
+ * after each call that returns true; then call well_formed() to learn
+ * whether the input was acceptable DER.
+ */
+struct tlv_traversal {
+    static const ssize_t max_depth = 32;  // deeper than any well-formed certificate
+
+    struct datum frame[max_depth];
+    ssize_t depth;
+    struct tlv element;       // the element most recently advanced to
+    bool malformed;
+    bool too_deep;
+
+    explicit tlv_traversal(const struct datum &d) : depth{1}, element{}, malformed{false}, too_deep{false} {
+        frame[0] = d;
+    }
+
+    bool next() {
+        while (depth > 0 && frame[depth-1].is_not_readable()) {
+            depth--;          // done with this constructed element
+        }
+        if (depth == 0) {
+            return false;     // traversal complete
+        }
+        element = tlv{};
+        element.parse(&frame[depth-1]);
+        if (!element.is_complete()) {
+            malformed = true;
+            return false;
+        }
+        if (element.is_constructed() && element.length > 0) {
+            if (depth == max_depth) {
+                too_deep = true;
+                return false;
+            }
+            frame[depth++] = element.value;
+        }
+        return true;
+    }
+
+    bool well_formed() const {
+        return !malformed && !too_deep;
+    }
+};
+
+bool tlv::is_der_format(const void *data, size_t length) {
+    uint8_t *d = (uint8_t *)data;
+    struct datum p{d, d + length};
+    struct tlv test(&p, tlv::SEQUENCE);
+    if (test.is_null() || test.length > (length - 2)) {
+        return false;
+    }
+    struct tlv_traversal traversal{test.value};
+    while (traversal.next()) {
+        ;
+    }
+    return traversal.well_formed();
+}
+
 #endif /* ASN1_H */
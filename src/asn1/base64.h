@@ -25,6 +25,130 @@
 static const unsigned char base64_table[65] =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_SIMD_BASE64 1
+#include <immintrin.h>
+
+/*
+ * Vectorized base64, both directions, following the approach of Mula
+ * and Lemire ("Faster Base64 Encoding and Decoding Using AVX2
+ * Instructions").  Each encode step turns 24 input bytes into a full
+ * 32-byte vector of output characters; each decode step turns 32
+ * characters into 24 bytes.  The AVX2 paths are compiled via target
+ * attributes and selected at runtime, so a generic build still gets
+ * them, and the scalar loops below remain as the fallback and handle
+ * the tails.
+ */
+
+/* returns true when the AVX2 kernels are usable; probed only once */
+static inline bool base64_simd_avx2() {
+    static int level = -1;
+    if (level < 0) {
+        level = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return level == 1;
+}
+
+/*
+ * base64_encode_avx2_block(in, out) reads a 32-byte vector from in,
+ * encodes its first 24 bytes, and writes exactly 32 characters of
+ * output; the caller must ensure that all 32 input bytes are readable
+ */
+__attribute__((target("avx2")))
+static inline void base64_encode_avx2_block(const unsigned char *in, unsigned char *out) {
+    __m256i data = _mm256_loadu_si256((const __m256i *)in);
+
+    /* place the two twelve-byte halves of the payload into separate
+     * lanes, each preceded by four don't-care bytes, so that the
+     * in-lane shuffle below can use the same indices for both */
+    data = _mm256_permutevar8x32_epi32(data, _mm256_setr_epi32(0, 0, 1, 2, 3, 3, 4, 5));
+
+    /* spread each three-byte group over four bytes, duplicating the
+     * middle byte, so that the mask-and-multiply steps can slice out
+     * the four six-bit fields */
+    const __m256i t = _mm256_shuffle_epi8(data, _mm256_set_epi8(
+        14, 15, 13, 14, 11, 12, 10, 11,  8,  9,  7,  8,  5,  6,  4,  5,
+        14, 15, 13, 14, 11, 12, 10, 11,  8,  9,  7,  8,  5,  6,  4,  5));
+    const __m256i t0 = _mm256_and_si256(t, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(t, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    const __m256i indices = _mm256_or_si256(t1, t3);
+
+    /* map each six-bit index to its alphabet character by adding a
+     * per-range offset; the lut is indexed by the saturating
+     * subtraction, which collapses each alphabet range to one slot */
+    const __m256i lut = _mm256_setr_epi8(
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+    __m256i offset_idx = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    const __m256i gt25 = _mm256_cmpgt_epi8(indices, _mm256_set1_epi8(25));
+    offset_idx = _mm256_sub_epi8(offset_idx, gt25);
+    const __m256i chars = _mm256_add_epi8(indices, _mm256_shuffle_epi8(lut, offset_idx));
+
+    _mm256_storeu_si256((__m256i *)out, chars);
+}
+
+/*
+ * base64_decode_avx2_block(in, out) decodes 32 characters into 24
+ * bytes, storing a full 32-byte vector whose last eight bytes are
+ * scratch; the caller must ensure that the store has that much room.
+ * Returns false, without storing, if any of the 32 characters is
+ * outside the standard alphabet, in which case the caller should fall
+ * back to the scalar loop for its error handling.
+ */
+__attribute__((target("avx2")))
+static inline bool base64_decode_avx2_block(const unsigned char *in, unsigned char *out) {
+    const __m256i lut_lo = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m256i lut_hi = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+
+    __m256i str = _mm256_loadu_si256((const __m256i *)in);
+
+    /* classify each character by its nibbles: lut_lo and lut_hi hold
+     * bitmasks whose intersection is nonzero exactly for bytes
+     * outside the alphabet */
+    const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+    const __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+    const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    if (!_mm256_testz_si256(lo, hi)) {
+        return false;
+    }
+
+    /* shift each character into its six-bit value by adding a
+     * per-range offset; '/' shares a high nibble with '+', so the
+     * comparison nudges its lookup index down by one */
+    const __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+    const __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+    str = _mm256_add_epi8(str, roll);
+
+    /* two multiply-adds pack each group of four six-bit values into
+     * three bytes, and the shuffles compact the payload to the front */
+    const __m256i merged = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+    __m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+    packed = _mm256_shuffle_epi8(packed, _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 0, 0));
+
+    _mm256_storeu_si256((__m256i *)out, packed);
+    return true;
+}
+
+#endif /* __x86_64__ || __i386__ */
+
 /**
 * base64_encode - Base64 encode
 * @src: Data to be encoded
@@ -52,6 +176,19 @@ std::string base64_encode(const unsigned char *src, size_t len)
     end = src + len;
     in = src;
     pos = out;
+
+#ifdef HAVE_SIMD_BASE64
+    if (base64_simd_avx2()) {
+        /* each step reads a full 32-byte vector but consumes only its
+         * first 24 bytes, so it stops while 32 input bytes remain */
+        while (end - in >= 32) {
+            base64_encode_avx2_block(in, pos);
+            in += 24;
+            pos += 32;
+        }
+    }
+#endif
+
     while (end - in >= 3) {
         *pos++ = base64_table[in[0] >> 2];
         *pos++ = base64_table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
@@ -103,8 +240,25 @@ std::string b64decode(const void* data, const size_t len) {
     int pad = len > 0 && (len % 4 || p[len - 1] == '=');
     const size_t L = ((len + 3) / 4 - pad) * 4;
     std::string str(L / 4 * 3 + pad, '\0');
+    size_t i = 0, j = 0;
+
+#ifdef HAVE_SIMD_BASE64
+    if (base64_simd_avx2()) {
+        /* each step stores 32 bytes but produces only 24, so both the
+         * load and the store need slack beyond the bytes it uses; a
+         * non-alphabet character drops us back to the scalar loop,
+         * which maps such bytes through index[] as before */
+        while (i + 32 <= L && j + 32 <= str.size()) {
+            if (!base64_decode_avx2_block(p + i, (unsigned char *)&str[j])) {
+                break;
+            }
+            i += 32;
+            j += 24;
+        }
+    }
+#endif
 
-    for (size_t i = 0, j = 0; i < L; i += 4)  {
+    for (; i < L; i += 4)  {
         int n = index[p[i]] << 18 | index[p[i + 1]] << 12 | index[p[i + 2]] << 6 | index[p[i + 3]];
         str[j++] = n >> 16;
         str[j++] = n >> 8 & 0xFF;
@@ -165,8 +319,25 @@ int decode(void *outbuf, const size_t outlen, const void* data, const size_t len
         fprintf(stderr, "error: base64 decode needs %zu bytes, only has room for %zu\n", str_size, outlen);
         return 0;  // not enough room for output
     }
-    size_t i, j;
-    for (i = 0, j = 0; i < L; i += 4)  {
+    size_t i = 0, j = 0;
+
+#ifdef HAVE_SIMD_BASE64
+    if (base64_simd_avx2()) {
+        /* the vector kernel accepts only the standard alphabet, a
+         * strict subset of what invalid[] allows, so on a rejected
+         * block the scalar loop below rechecks it and produces the
+         * usual error offset */
+        while (i + 32 <= L && j + 32 <= outlen) {
+            if (!base64_decode_avx2_block(p + i, str + j)) {
+                break;
+            }
+            i += 32;
+            j += 24;
+        }
+    }
+#endif
+
+    for (; i < L; i += 4)  {
         if (invalid[p[i]] | invalid[p[i+1]] | invalid[p[i+2]] | invalid[p[i+3]]) {
             return -(i+1);
         }
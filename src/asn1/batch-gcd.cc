@@ -1,67 +1,320 @@
 /*
  * batch-gcd.cc
+ *
+ * batch GCD over a set of RSA moduli, following the product
+ * tree / remainder tree construction: the product tree multiplies the
+ * moduli pairwise up to their overall product P, the remainder tree
+ * brings P back down as P mod n^2 for each modulus n, and a modulus
+ * shares a factor with some other modulus exactly when
+ * gcd(n, (P mod n^2)/n) != 1.  The pairwise operations at each tree
+ * level are independent, and are spread across hardware threads.
+ *
+ * reads one hexadecimal modulus per line from the file named on the
+ * command line (or from stdin), and reports each modulus with a
+ * common factor, along with the factor
  */
 
-
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <functional>
 #include <iostream>
-#include <list>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
-int main(int argc, char *argv[]) {
-    using namespace std;
-    list<uint64_t> moduli{ 3*5, 5*7, 7*11, 11*13, 13*17, 17*19, 19*23, 23*29 };
-    // list<uint64_t> *tmp = &moduli;
-    list<list<uint64_t> *> product_tree;
-
-    for (auto it = moduli.begin(); it != moduli.end(); ) {
-        uint64_t y = *it++;
-        uint64_t z = *it++;
-        cout << y << '\t' << z << '\n';
-    }
-
-    // create product tree
-    list<uint64_t>::iterator product;
-    product_tree.push_back(&moduli);
-    auto last_level = &moduli;
-    while (1) {
-        auto tmp = new list<uint64_t>;
-        product_tree.push_back(tmp);
-        for (auto it = last_level->begin(); it != last_level->end(); ) {
-            auto first = it++;
-            auto second = it++;
-            tmp->push_back(*first * *second);
-        }
-
-        bool first = true;
-        cout << "[";
-        for (auto it = tmp->begin(); it != tmp->end(); ) {
-            if (first) {
-                first = false;
+/*
+ * bignum is a minimal unsigned arbitrary-precision integer (a
+ * little-endian vector of 32-bit limbs) that provides just the
+ * operations batch GCD needs: multiplication, division with
+ * remainder, and comparison.  It keeps this tool free of external
+ * library dependencies; it is not meant for general use.
+ */
+struct bignum {
+    std::vector<uint32_t> limbs;   // little-endian; no leading zero limbs
+
+    bignum() {}
+    explicit bignum(uint32_t x) {
+        if (x != 0) {
+            limbs.push_back(x);
+        }
+    }
+
+    bool is_zero() const { return limbs.empty(); }
+
+    void trim() {
+        while (!limbs.empty() && limbs.back() == 0) {
+            limbs.pop_back();
+        }
+    }
+
+    size_t bit_length() const {
+        if (limbs.empty()) {
+            return 0;
+        }
+        size_t bits = 32 * (limbs.size() - 1);
+        uint32_t top = limbs.back();
+        while (top) {
+            bits++;
+            top >>= 1;
+        }
+        return bits;
+    }
+
+    bool get_bit(size_t i) const {
+        return (limbs[i / 32] >> (i % 32)) & 1;
+    }
+
+    void set_bit(size_t i) {
+        if (limbs.size() <= i / 32) {
+            limbs.resize(i / 32 + 1, 0);
+        }
+        limbs[i / 32] |= ((uint32_t)1 << (i % 32));
+    }
+
+    static int compare(const bignum &a, const bignum &b) {
+        if (a.limbs.size() != b.limbs.size()) {
+            return a.limbs.size() < b.limbs.size() ? -1 : 1;
+        }
+        for (size_t i = a.limbs.size(); i > 0; i--) {
+            if (a.limbs[i-1] != b.limbs[i-1]) {
+                return a.limbs[i-1] < b.limbs[i-1] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    // shift left by one bit, then add b (b is 0 or 1); used by the
+    // bit-serial division loop
+    //
+    void shift_in_bit(bool b) {
+        uint32_t carry = b ? 1 : 0;
+        for (size_t i = 0; i < limbs.size(); i++) {
+            uint32_t next_carry = limbs[i] >> 31;
+            limbs[i] = (limbs[i] << 1) | carry;
+            carry = next_carry;
+        }
+        if (carry) {
+            limbs.push_back(carry);
+        }
+    }
+
+    void subtract(const bignum &b) {   // requires *this >= b
+        int64_t borrow = 0;
+        for (size_t i = 0; i < limbs.size(); i++) {
+            int64_t diff = (int64_t)limbs[i] - (i < b.limbs.size() ? b.limbs[i] : 0) - borrow;
+            borrow = 0;
+            if (diff < 0) {
+                diff += ((int64_t)1 << 32);
+                borrow = 1;
+            }
+            limbs[i] = (uint32_t)diff;
+        }
+        trim();
+    }
+
+    static bignum multiply(const bignum &a, const bignum &b) {
+        bignum product;
+        if (a.is_zero() || b.is_zero()) {
+            return product;
+        }
+        product.limbs.assign(a.limbs.size() + b.limbs.size(), 0);
+        for (size_t i = 0; i < a.limbs.size(); i++) {
+            uint64_t carry = 0;
+            for (size_t j = 0; j < b.limbs.size(); j++) {
+                uint64_t tmp = (uint64_t)a.limbs[i] * b.limbs[j] + product.limbs[i+j] + carry;
+                product.limbs[i+j] = (uint32_t)tmp;
+                carry = tmp >> 32;
+            }
+            product.limbs[i + b.limbs.size()] = (uint32_t)carry;
+        }
+        product.trim();
+        return product;
+    }
+
+    // divide(a, b, q, r) sets q and r so that a == q*b + r, with r < b
+    //
+    static void divide(const bignum &a, const bignum &b, bignum &q, bignum &r) {
+        q = bignum();
+        r = bignum();
+        for (size_t i = a.bit_length(); i > 0; i--) {
+            r.shift_in_bit(a.get_bit(i-1));
+            if (compare(r, b) >= 0) {
+                r.subtract(b);
+                q.set_bit(i-1);
+            }
+        }
+    }
+
+    static bignum gcd(bignum a, bignum b) {
+        while (!b.is_zero()) {
+            bignum q, r;
+            divide(a, b, q, r);
+            a = b;
+            b = r;
+        }
+        return a;
+    }
+
+    static bignum from_hex(const std::string &s) {
+        bignum x;
+        for (char c : s) {
+            uint32_t nibble;
+            if (c >= '0' && c <= '9') {
+                nibble = c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                nibble = c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                nibble = c - 'A' + 10;
             } else {
-                cout << ',';
+                throw "error: non-hexadecimal character in modulus";
+            }
+            for (int i = 0; i < 4; i++) {
+                x.shift_in_bit(0);
+            }
+            if (nibble) {
+                if (x.limbs.empty()) {
+                    x.limbs.push_back(nibble);
+                } else {
+                    x.limbs[0] |= nibble;
+                }
             }
-            uint64_t y = *it++;
-            cout << y;
         }
-        cout << "]" << '\n';
+        x.trim();
+        return x;
+    }
 
-        if (tmp->size() == 1) {
-            product = tmp->begin();
-            break;
+    std::string to_hex() const {
+        if (limbs.empty()) {
+            return "0";
+        }
+        std::ostringstream s;
+        s << std::hex << limbs.back();
+        for (size_t i = limbs.size() - 1; i > 0; i--) {
+            char tmp[9];
+            snprintf(tmp, sizeof(tmp), "%08x", limbs[i-1]);
+            s << tmp;
         }
+        return s.str();
+    }
+};
+
+/*
+ * for_each_parallel(count, f) invokes f(i) for each i in [0, count),
+ * spread across the hardware threads; the calls must be independent,
+ * which they are for the pairwise operations at each tree level
+ */
+static void for_each_parallel(size_t count, const std::function<void(size_t)> &f) {
+    size_t num_threads = std::thread::hardware_concurrency();
+    if (num_threads == 0) {
+        num_threads = 1;
+    }
+    if (num_threads > count) {
+        num_threads = count;
+    }
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; t++) {
+        threads.push_back(std::thread([t, num_threads, count, &f]() {
+            for (size_t i = t; i < count; i += num_threads) {
+                f(i);
+            }
+        }));
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    using namespace std;
 
-        last_level = tmp;
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [<file>]\n", argv[0]);
+        fprintf(stderr, "reads one hexadecimal RSA modulus per line from <file> (default: stdin),\n");
+        fprintf(stderr, "and reports each modulus that shares a factor with another one\n");
+        exit(EXIT_FAILURE);
     }
 
-    cout << "product: " << *product << '\n';
+    ifstream file;
+    if (argc == 2) {
+        file.open(argv[1]);
+        if (!file.is_open()) {
+            fprintf(stderr, "error: could not open file %s\n", argv[1]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    istream &input = (argc == 2) ? file : cin;
 
-    // create remainder tree
+    vector<bignum> moduli;
+    string line;
+    while (getline(input, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        moduli.push_back(bignum::from_hex(line));
+    }
+    if (moduli.size() < 2) {
+        fprintf(stderr, "error: need at least two moduli\n");
+        exit(EXIT_FAILURE);
+    }
 
-    // TBD
+    // create product tree; level zero holds the moduli, and each
+    // level above it the pairwise products of the one below, with an
+    // odd element carried up unchanged, so the top level is the
+    // product of all of the moduli
+    //
+    vector<vector<bignum>> product_tree;
+    product_tree.push_back(moduli);
+    while (product_tree.back().size() > 1) {
+        const vector<bignum> &last_level = product_tree.back();
+        vector<bignum> level((last_level.size() + 1) / 2);
+        for_each_parallel(last_level.size() / 2, [&last_level, &level](size_t i) {
+            level[i] = bignum::multiply(last_level[2*i], last_level[2*i + 1]);
+        });
+        if (last_level.size() & 1) {
+            level.back() = last_level.back();
+        }
+        product_tree.push_back(level);
+    }
+
+    // create remainder tree; descending from the product P at the
+    // top, each node's remainder is the one above it reduced mod the
+    // square of the node's product, so at the bottom we hold
+    // P mod n^2 for each modulus n
+    //
+    vector<bignum> remainders = product_tree.back();
+    for (size_t l = product_tree.size() - 1; l > 0; l--) {
+        const vector<bignum> &level = product_tree[l-1];
+        vector<bignum> next(level.size());
+        for_each_parallel(level.size(), [&level, &remainders, &next](size_t i) {
+            bignum q, r;
+            bignum::divide(remainders[i/2], bignum::multiply(level[i], level[i]), q, r);
+            next[i] = r;
+        });
+        remainders = next;
+    }
 
-    // report on common factors
+    // report on common factors: gcd(n, (P mod n^2)/n) is nontrivial
+    // exactly when n shares a factor with some other modulus; a gcd
+    // equal to n itself means n appears more than once in the input
+    //
+    vector<bignum> factors(moduli.size());
+    for_each_parallel(moduli.size(), [&moduli, &remainders, &factors](size_t i) {
+        bignum q, r;
+        bignum::divide(remainders[i], moduli[i], q, r);
+        factors[i] = bignum::gcd(moduli[i], q);
+    });
+    for (size_t i = 0; i < moduli.size(); i++) {
+        if (bignum::compare(factors[i], bignum(1)) != 0) {
+            if (bignum::compare(factors[i], moduli[i]) == 0) {
+                cout << "modulus " << moduli[i].to_hex() << " is repeated in the input\n";
+            } else {
+                cout << "modulus " << moduli[i].to_hex() << " has factor " << factors[i].to_hex() << '\n';
+            }
+        }
+    }
 
-    // TBD
-    
     return 0;
 }
@@ -4,6 +4,9 @@
 
 #ifndef BYTESTRING_H
 
+#include <cstdint>
+#include <string>
+
 // tell the C++ STL how to hash a basic string of uint8_t values, by
 // creating a specialized struct hash<> template for that type
 //
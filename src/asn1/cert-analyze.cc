@@ -7,10 +7,16 @@
 #include <stdio.h>
 #include <string.h>
 #include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <string>
 #include <unordered_map>
 #include <string>
 #include <list>
+#include <thread>
+#include <vector>
 
 #include "x509.h"
 #include "base64.h"
@@ -335,7 +341,129 @@ struct der_file_writer {
 };
 
 // std::unordered_map<std::string, std::string> cert_dict;
-//#include <thread>
+
+/*
+ * streaming batch mode: the input corpus (one base64 certificate per
+ * line) is mapped into memory and processed in batches; each batch is
+ * split on line boundaries into one chunk per thread, each thread
+ * parses and serializes its chunk into its own output buffer, and the
+ * buffers are written to stdout in input order, so the output is the
+ * same as that of the sequential mode
+ */
+
+static const size_t batch_chunk_len = 16 * 1024 * 1024;  // target chunk size per thread
+
+void batch_process_chunk(const char *data,
+                         const char *data_end,
+                         const char *filter,
+                         const std::list<struct x509_cert> &trusted_certs,
+                         std::string &output) {
+    uint8_t cert_buf[256 * 1024];
+    char buffer[256 * 1024];
+
+    const char *line = data;
+    while (line < data_end) {
+        const char *eol = (const char *)memchr(line, '\n', data_end - line);
+        size_t line_len = eol ? (size_t)(eol - line) : (size_t)(data_end - line);
+        const char *next = eol ? eol + 1 : data_end;
+        if (line_len == 0) {
+            line = next;
+            continue;
+        }
+        ssize_t cert_len = base64::decode(cert_buf, sizeof(cert_buf), line, line_len);
+        if (cert_len <= 0) {
+            fprintf(stderr, "error: base64 decoding failure around character %zd\n", -cert_len);
+            line = next;
+            continue;
+        }
+        struct buffer_stream buf(buffer, sizeof(buffer));
+        struct x509_cert c;
+        try {
+            c.parse(cert_buf, cert_len, true);  // lazy; the filter checks decode only the fields they use
+            if ((filter == NULL)
+                || c.is_not_currently_valid()
+                || c.subject_key_is_weak()
+                || c.signature_is_weak()
+                || c.is_nonconformant()
+                || c.is_self_issued()
+                || !c.is_trusted(trusted_certs)) {
+                c.print_as_json(buf, trusted_certs, NULL);
+                output.append(buf.dstr, buf.doff);
+                output.push_back('\n');
+            }
+        } catch (const char *s) {
+            fprintf(stderr, "caught exception: %s\n", s);
+        }
+        line = next;
+    }
+}
+
+int batch_analyze(const char *infile,
+                  unsigned int num_threads,
+                  const char *filter,
+                  const std::list<struct x509_cert> &trusted_certs) {
+
+    int fd = open(infile, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "error: could not open file %s (%s)\n", infile, strerror(errno));
+        return -1;
+    }
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) < 0) {
+        fprintf(stderr, "error: could not stat file %s (%s)\n", infile, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    size_t file_length = statbuf.st_size;
+    if (file_length == 0) {
+        close(fd);
+        return 0;
+    }
+    const char *data = (const char *)mmap(NULL, file_length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "error: could not mmap file %s (%s)\n", infile, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    const char *data_end = data + file_length;
+
+    std::vector<std::string> outputs(num_threads);
+    const char *batch = data;
+    while (batch < data_end) {
+
+        // split this batch on record (line) boundaries, one chunk per
+        // thread; the last chunk of the file may fall short
+        //
+        std::vector<const char *> bounds;
+        bounds.push_back(batch);
+        for (unsigned int t = 0; t < num_threads && bounds.back() < data_end; t++) {
+            const char *b = bounds.back() + batch_chunk_len;
+            if (b >= data_end) {
+                b = data_end;
+            } else {
+                const char *eol = (const char *)memchr(b, '\n', data_end - b);
+                b = eol ? eol + 1 : data_end;
+            }
+            bounds.push_back(b);
+        }
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t + 1 < bounds.size(); t++) {
+            outputs[t].clear();
+            threads.push_back(std::thread(batch_process_chunk, bounds[t], bounds[t+1],
+                                          filter, std::ref(trusted_certs), std::ref(outputs[t])));
+        }
+        for (size_t t = 0; t < threads.size(); t++) {
+            threads[t].join();    // merge per-thread output buffers in input order
+            fwrite(outputs[t].data(), 1, outputs[t].size(), stdout);
+        }
+        batch = bounds.back();
+    }
+
+    munmap((void *)data, file_length);
+    close(fd);
+    return 0;
+}
 
 void usage(const char *progname) {
     const char *help_message =
@@ -356,6 +484,8 @@ void usage(const char *progname) {
         "   --key-group      identify duplicate keys with key_group number\n"
         "   --trunc-test     parse every possible truncation of certificates\n"
         "OTHER\n"
+        "   --threads <num>  parse/serialize across <num> threads (0 selects one\n"
+        "                    per core); needs --input with base64 format\n"
         "   --trust <roots>  trust certificates in <roots>\n"
         "   --help           print this message\n";
 
@@ -375,6 +505,7 @@ int main(int argc, char *argv[]) {
     bool input_is_der = false;
     bool key_group = false;
     bool trunc_test = false;
+    unsigned int num_threads = 1;
     //const char *outfile = NULL;
 
     // parse arguments
@@ -393,6 +524,7 @@ int main(int argc, char *argv[]) {
              case_key_group,
              case_trunc_test,
              case_trust,
+             case_threads,
              case_help,
         };
         static struct option long_options[] = {
@@ -407,6 +539,7 @@ int main(int argc, char *argv[]) {
              {"key-group",      no_argument,       NULL,  case_key_group     },
              {"trunc-test",     no_argument,       NULL,  case_trunc_test    },
              {"trust",          required_argument, NULL,  case_trust         },
+             {"threads",        required_argument, NULL,  case_threads       },
              {"help",           no_argument,       NULL,  case_help          },
              {0,                0,                 0,     0                  }
         };
@@ -496,6 +629,19 @@ int main(int argc, char *argv[]) {
             }
             trust = optarg;
             break;
+        case case_threads:
+            if (!optarg) {
+                fprintf(stderr, "error: option 'threads' needs an argument\n");
+                usage(argv[0]);
+            }
+            num_threads = atoi(optarg);
+            if (num_threads == 0) {
+                num_threads = std::thread::hardware_concurrency();
+                if (num_threads == 0) {
+                    num_threads = 1;
+                }
+            }
+            break;
         case case_help:
             if (optarg) {
                 fprintf(stderr, "error: option 'help' does not accept an argument\n");
@@ -524,6 +670,37 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "warning: filter cannot be applied to certificate prefix\n");
     }
 
+    std::list<struct x509_cert> trusted_certs;
+    uint8_t trusted_cert_buf[256 * 1024];
+    uint8_t *cb = trusted_cert_buf;
+    size_t cb_len = sizeof(trusted_cert_buf);
+    if (trust) {
+        struct file_reader *reader = new pem_file_reader(trust);
+        reader->get_cert_list(trusted_certs, cb, cb_len);
+        // for (auto &c : trusted_certs) {
+        //    c.print_as_json(stdout);
+        // }
+    }
+
+    if (num_threads > 1) {
+        if (infile == NULL) {
+            fprintf(stderr, "error: option 'threads' requires '--input'\n");
+            usage(argv[0]);
+        }
+        if (input_is_pem || input_is_json || input_is_der) {
+            fprintf(stderr, "error: option 'threads' works only with base64 input\n");
+            usage(argv[0]);
+        }
+        if (prefix || prefix_as_hex || key_group || trunc_test || logfile) {
+            fprintf(stderr, "error: option 'threads' cannot be combined with 'prefix', 'prefix-as-hex', 'key-group', 'trunc-test', or 'log-malformed'\n");
+            usage(argv[0]);
+        }
+        if (batch_analyze(infile, num_threads, filter, trusted_certs) < 0) {
+            exit(EXIT_FAILURE);
+        }
+        exit(EXIT_SUCCESS);
+    }
+
     struct file_reader *reader = NULL;
     if (input_is_pem) {
         reader = new pem_file_reader(infile);
@@ -541,18 +718,6 @@ int main(int argc, char *argv[]) {
         kg = &key_group_dict;
     }
 
-    std::list<struct x509_cert> trusted_certs;
-    uint8_t trusted_cert_buf[256 * 1024];
-    uint8_t *cb = trusted_cert_buf;
-    size_t cb_len = sizeof(trusted_cert_buf);
-    if (trust) {
-        struct file_reader *reader = new pem_file_reader(trust);
-        reader->get_cert_list(trusted_certs, cb, cb_len);
-        // for (auto &c : trusted_certs) {
-        //    c.print_as_json(stdout);
-        // }
-    }
-
     unsigned int log_index = 0;
     uint8_t cert_buf[256 * 1024];
     ssize_t cert_len = 1;
@@ -594,7 +759,7 @@ int main(int argc, char *argv[]) {
 
                 } else {
 
-                    c.parse(cert_buf, cert_len);
+                    c.parse(cert_buf, cert_len, true);  // lazy; the filter checks decode only the fields they use
                     if ((filter == NULL)
                         || c.is_not_currently_valid()
                         || c.subject_key_is_weak()
@@ -1778,3 +1778,1058 @@ std::unordered_map<std::basic_string<uint8_t>, enum oid> oid_to_enum = {
 	{ {0x60,0x86,0x48,0x01,0x86,0xfd,0x6d,0x01,0x07,0x17,0x03}, Go_Daddy_EV_CPS },
 	{ {0x60,0x86,0x48,0x01,0x86,0xfd,0x6e,0x01,0x07,0x17,0x03}, Starfield_Technologies_EV_CPS },
 };
+
+/*
+ * perfect hash over the raw DER encodings of the OIDs above,
+ * built with the compress-hash-displace construction: the first
+ * hash picks a bucket, whose displacement value seeds the hash
+ * that picks the slot, so a lookup is two hashes of the raw bytes
+ * and a single table probe, with no per-component decoding
+ */
+#define OID_PH_BUCKET_COUNT 128
+#define OID_PH_TABLE_LENGTH 1024
+
+static const uint32_t oid_ph_displace[OID_PH_BUCKET_COUNT] = {
+	4,1,2,5,13,1,2,2,2,2,4,11,2,8,5,1,
+	1,6,2,7,3,7,11,1,1,0,18,4,3,7,5,4,
+	8,19,3,1,1,4,2,1,6,5,1,5,1,1,3,2,
+	5,4,12,2,13,2,13,4,4,1,18,1,13,2,2,0,
+	8,27,3,23,16,4,2,3,17,4,4,14,1,6,9,3,
+	3,12,11,1,3,1,13,1,14,5,7,1,12,9,8,1,
+	4,31,1,9,4,18,4,18,3,7,2,4,2,30,3,6,
+	3,1,2,2,1,7,1,1,7,20,3,6,11,5,2,12,
+};
+
+struct oid_ph_entry {
+    const uint8_t *bytes;    /* raw DER encoding, or NULL in an empty slot */
+    uint8_t length;
+    enum oid id;
+    const char *name;
+};
+
+static const struct oid_ph_entry oid_ph_table[OID_PH_TABLE_LENGTH] = {
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x03\x0c", 10, szOID_KP_DOCUMENT_SIGNING, "szOID_KP_DOCUMENT_SIGNING" },
+	{ (const uint8_t *)"\x55\x1d\x07", 3, DeprecatedSubjectAltName, "DeprecatedSubjectAltName" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x64", 7, Block_Cipher, "Block_Cipher" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x86\xfd\x6d\x01\x07\x17\x03", 11, Go_Daddy_EV_CPS, "Go_Daddy_EV_CPS" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x05", 9, pkcs_9_at_signingTime, "pkcs-9-at-signingTime" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x0a", 8, id_cmc_decryptedPOP, "id-cmc-decryptedPOP" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x01", 7, id_pe, "id-pe" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x81\xb5\x37\x02", 9, StartCom_Certification_Authority_EV_CPS, "StartCom_Certification_Authority_EV_CPS" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a", 1, ISO, "ISO" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x03\x0e", 10, szOID_KP_MOBILE_DEVICE_SOFTWARE, "szOID_KP_MOBILE_DEVICE_SOFTWARE" },
+	{ (const uint8_t *)"\x55\x1d\x10", 3, id_ce_privateKeyUsagePeriod, "id-ce-privateKeyUsagePeriod" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x31", 3, distinguished_name, "distinguished_name" },
+	{ (const uint8_t *)"\x2b\x65\x6e", 3, id_X25519, "id-X25519" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x14\x03", 9, szOID_CERT_MANIFOLD, "szOID_CERT_MANIFOLD" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x24\x03\x03\x02\x08", 6, ecStdCurvesAndGeneration, "ecStdCurvesAndGeneration" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x01", 8, email_address, "email_address" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x3c\x02\x01\x03", 11, jurisdiction_of_incorporation_country_name, "jurisdiction_of_incorporation_country_name" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x03\x03", 8, id_kp_codeSigning, "id-kp-codeSigning" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x03\x07", 8, id_kp_ipsecUser, "id-kp-ipsecUser" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x25", 8, id_cmc_responseBody, "id-cmc-responseBody" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x81\x04", 3, certicom_arc, "certicom-arc" },
+	{ (const uint8_t *)"\x2a\x86\x48\x04\x03\x02", 6, ecdsa_with_SHA256_1_, "ecdsa-with-SHA256[1]" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x0d", 9, szOID_ARCHIVED_KEY_ATTR, "szOID_ARCHIVED_KEY_ATTR" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x0b\x02", 8, id_qcs_pkixQCSyntax_v2, "id-qcs-pkixQCSyntax-v2" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x30\x05", 8, id_ad_caRepository, "id-ad-caRepository" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x03\x05", 10, szOID_WHQL_CRYPTO, "szOID_WHQL_CRYPTO" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x03\x01", 9, id_dsa_with_sha224, "id-dsa-with-sha224" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x01\x02\x01", 9, Crypto_ID, "Crypto_ID" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x08\x01", 10, szOID_REMOVE_CERTIFICATE, "szOID_REMOVE_CERTIFICATE" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x65", 2, id_edwards_curve_algs, "id-edwards-curve-algs" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x26", 7, sect571k1_1_, "sect571k1[1]" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x01\x02", 8, prime192v2, "prime192v2" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x01", 8, id_cmc_statusInfo, "id-cmc-statusInfo" },
+	{ (const uint8_t *)"\x60\x85\x74\x01\x59\x01\x02\x01\x01", 9, SwissSign_EV_CPS, "SwissSign_EV_CPS" },
+	{ (const uint8_t *)"\x60\x86\x18\x01\x02\x01\x01\x05\x07\x01\x09", 11, Kamu_Sertifikasyon_Merkezi_EV_CPS, "Kamu_Sertifikasyon_Merkezi_EV_CPS" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x11", 9, szOID_ISSUED_CERT_HASH, "szOID_ISSUED_CERT_HASH" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x03\x06", 8, id_kp_ipsecTunnel, "id-kp-ipsecTunnel" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x09", 9, szOID_RDN_DUMMY_SIGNER, "szOID_RDN_DUMMY_SIGNER" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x1b\x02", 10, pkcs_9_mr_signingTimeMatch, "pkcs-9-mr-signingTimeMatch" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x65\x71", 3, id_Ed448, "id-Ed448" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x81\x04\x01\x0c", 5, id_ecDH, "id-ecDH" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x02\x0e", 9, id_hmacWithSHA3_256, "id-hmacWithSHA3-256" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x09", 8, id_cmc_encryptedPOP, "id-cmc-encryptedPOP" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x02\x01\x01\x16", 9, id_keyExchangeAlgorithm, "id-keyExchangeAlgorithm" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x0a\x01", 10, szOID_CMC_ADD_ATTRIBUTES, "szOID_CMC_ADD_ATTRIBUTES" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x01\x16", 10, SPC_COMMERCIAL_SP_KEY_PURPOSE_OBJID, "SPC_COMMERCIAL_SP_KEY_PURPOSE_OBJID" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x16", 9, szOID_CERTSRV_CROSSCA_VERSION, "szOID_CERTSRV_CROSSCA_VERSION" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x27", 7, sect571r1_1_, "sect571r1[1]" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x11", 7, sect283r1_1_, "sect283r1[1]" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x82\x2d", 8, SM2_Elliptic_Curve_Cryptography, "SM2_Elliptic_Curve_Cryptography" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x13", 8, id_cmc_responseInfo, "id-cmc-responseInfo" },
+	{ (const uint8_t *)"\x52\x86\x48\xce\x38\x02\x01", 7, id_holdinstruction_none, "id-holdinstruction-none" },
+	{ (const uint8_t *)"\x2b\x0e\x03\x02\x1a", 5, id_sha1, "id-sha1" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x83\x75", 8, SM2_Signing_with_SM3, "SM2_Signing_with_SM3" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x19", 8, id_cmc_statusInfoV2, "id-cmc-statusInfoV2" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x01\x08", 8, brainpoolP256t1, "brainpoolP256t1" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x08\x09", 8, id_on_SmtpUTF8Mailbox, "id-on-SmtpUTF8Mailbox" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x09\x01", 8, pkcs_9_at_dateOfBirth, "pkcs-9-at-dateOfBirth" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x01\x0b", 10, SPC_STATEMENT_TYPE_OBJID, "SPC_STATEMENT_TYPE_OBJID" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x0b\x09", 10, OID_CERT_PROP_ID_METAEKUS, "OID_CERT_PROP_ID_METAEKUS" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x30\x01\x02", 9, id_pkix_ocsp_nonce, "id-pkix-ocsp-nonce" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x0f", 3, business_category, "business_category" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x0e", 9, pkcs_9_at_extensionRequest, "pkcs-9-at-extensionRequest" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x65\x6f", 3, id_X448, "id-X448" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x10", 8, id_cmc_getCRL, "id-cmc-getCRL" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x86\xf8\x45\x01\x07\x30\x01", 11, Thawte_EV_CPS, "Thawte_EV_CPS" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x85\x03\x07\x01\x01\x03\x02", 8, id_tc26_signwithdigest_gost3410_12_256, "id-tc26-signwithdigest-gost3410-12-256" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x22", 7, secp384r1_1_, "secp384r1[1]" },
+	{ (const uint8_t *)"\x55\x04\x2a", 3, given_name, "given_name" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x03\x0e", 9, id_rsassa_pkcs1_v1_5_with_sha3_256, "id-rsassa-pkcs1-v1_5-with-sha3-256" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x22", 8, id_cmc_identityProofV2, "id-cmc-identityProofV2" },
+	{ (const uint8_t *)"\x52\x86\x48\xce\x38\x02", 6, holdInstruction, "holdInstruction" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0c\x01\x02", 10, szOID_CATALOG_LIST_MEMBER, "szOID_CATALOG_LIST_MEMBER" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x01\x0d", 8, brainpoolP512r1, "brainpoolP512r1" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x01", 7, primeCurve, "primeCurve" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x06\x20", 8, id_ecdsa_with_shake128, "id-ecdsa-with-shake128" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x05", 3, serial_number, "serial_number" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x12\x06", 9, szOID_PKIX_MS_LICENSE_SERVER_INFO, "szOID_PKIX_MS_LICENSE_SERVER_INFO" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x14\x02\x01", 10, szOID_ENROLLMENT_AGENT, "szOID_ENROLLMENT_AGENT" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x0b", 7, id_qcs, "id-qcs" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x10\x02", 10, id_aa, "id-aa" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x12", 8, id_cmc_regInfo, "id-cmc-regInfo" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x2c\x00\x03", 10, szOID_PEERNET_CLASSIFIER, "szOID_PEERNET_CLASSIFIER" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x04", 8, c2pnb176w1, "c2pnb176w1" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x1c", 3, preferred_delivery_method, "preferred_delivery_method" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07", 6, id_pkix, "id-pkix" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x81\x49", 8, ZUC_Stream_Cipher, "ZUC_Stream_Cipher" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x1d\x23", 3, id_ce_authorityKeyIdentifier, "id-ce-authorityKeyIdentifier" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x06\x02", 8, id_alg_noSignature, "id-alg-noSignature" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x30\x01\x01", 9, id_pkix_ocsp_basic, "id-pkix-ocsp-basic" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01", 6, Cryptographic_Algorithm, "Cryptographic_Algorithm" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x30\x01\x05", 9, id_pkix_ocsp_nocheck, "id-pkix-ocsp-nocheck" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x10", 9, smime, "smime" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x04\x03\x01", 8, ecdsa_with_SHA224, "ecdsa-with-SHA224" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x81\x87\x2e\x0a\x08\x0c\x01\x02", 13, Camerfirma_EV_CPS_1_, "Camerfirma_EV_CPS[1]" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x04\x03", 7, Certificate_Authority, "Certificate_Authority" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x01\x0f", 9, sha512_224WithRSAEncryption, "sha512-224WithRSAEncryption" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x1d\x2e", 3, id_ce_freshestCRL, "id-ce-freshestCRL" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x2c\x03\x03", 10, szOID_PEERNET_GROUPING_ROLES, "szOID_PEERNET_GROUPING_ROLES" },
+	{ (const uint8_t *)"\x55\x04\x20", 3, owner, "owner" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x0f", 8, id_cmc_getCert, "id-cmc-getCert" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x02\x13", 9, id_KmacWithSHAKE128, "id-KmacWithSHAKE128" },
+	{ (const uint8_t *)"\x2b\x81\x04\x00\x25", 5, sect409r1, "sect409r1" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0c\x02\x01", 10, CAT_NAMEVALUE_OBJID, "CAT_NAMEVALUE_OBJID" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x66", 7, SM1_Block_Cipher, "SM1_Block_Cipher" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x05", 7, Testing_Class, "Testing_Class" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x83\x11\x02", 9, SM3_Hash_With_Key, "SM3_Hash_With_Key" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x15", 9, pkcs_9_at_localKeyId, "pkcs-9-at-localKeyId" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x01\x15", 10, SPC_INDIVIDUAL_SP_KEY_PURPOSE_OBJID, "SPC_INDIVIDUAL_SP_KEY_PURPOSE_OBJID" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x07", 8, id_cmc_recipientNonce, "id-cmc-recipientNonce" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x0a", 9, szOID_APPLICATION_CERT_POLICIES, "szOID_APPLICATION_CERT_POLICIES" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x01\x19", 10, SPC_CAB_DATA_OBJID, "SPC_CAB_DATA_OBJID" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x8f\x09\x02\x04", 10, AffirmTrust_EV_CPS_3_, "AffirmTrust_EV_CPS[3]" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x02", 7, Device_Class, "Device_Class" },
+	{ (const uint8_t *)"\x55\x1d\x15", 3, id_ce_reasonCode, "id-ce-reasonCode" },
+	{ (const uint8_t *)"\x2b\x81\x04\x00", 4, ellipticCurve_2_, "ellipticCurve[2]" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x32", 3, unique_member, "unique_member" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x9b\x51\x02", 9, WoSign_EV_CPS, "WoSign_EV_CPS" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x01\x0a", 8, brainpoolP320t1, "brainpoolP320t1" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\xf3\x39\x06\x01\x01", 10, Izenpe_EV_CPS, "Izenpe_EV_CPS" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x0e", 9, szOID_CRL_SELF_CDP, "szOID_CRL_SELF_CDP" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x01\x09", 8, brainpoolP320r1, "brainpoolP320r1" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x02\x03", 10, szOID_TRUSTED_SERVER_AUTH_CA_LIST, "szOID_TRUSTED_SERVER_AUTH_CA_LIST" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x03\x04\x01", 11, szOID_EFS_RECOVERY, "szOID_EFS_RECOVERY" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x06", 9, pkcs_9_at_counterSignature, "pkcs-9-at-counterSignature" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x01\x1e", 10, SPC_SIPINFO_OBJID, "SPC_SIPINFO_OBJID" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x01\x02\x03\x02", 9, tpBasis, "tpBasis" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x03\x03", 10, szOID_SERVER_GATED_CRYPTO, "szOID_SERVER_GATED_CRYPTO" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3e\x02\x01", 7, dhpublicnumber, "dhpublicnumber" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x1d\x12", 3, id_ce_issuerAltName, "id-ce-issuerAltName" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x83\x11\x01", 9, SM3_Hash_Without_Key, "SM3_Hash_Without_Key" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x08", 9, szOID_ENTERPRISE_OID_ROOT, "szOID_ENTERPRISE_OID_ROOT" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x01\x01", 9, rsaEncryption, "rsaEncryption" },
+	{ (const uint8_t *)"\x55\x1d", 2, id_ce, "id-ce" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x2c\x01\x04", 10, szOID_PEERNET_PNRP_ID, "szOID_PEERNET_PNRP_ID" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x01\x07", 8, prime256v1, "prime256v1" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x01\x04\x02", 9, SM2_Cryptographic_Message_Syntax, "SM2_Cryptographic_Message_Syntax" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x1f\x01", 9, szOID_PRODUCT_UPDATE, "szOID_PRODUCT_UPDATE" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x0b", 8, c2tnb239v1, "c2tnb239v1" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x02", 7, sect163r1, "sect163r1" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x0e", 3, search_guide, "search_guide" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\xa5\x34\x02\x81\x4a\x01", 11, D_TRUST_EV_CPS, "D-TRUST_EV_CPS" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x1d\x0e", 3, id_ce_subjectKeyIdentifier, "id-ce-subjectKeyIdentifier" },
+	{ (const uint8_t *)"\x55\x1d\x17", 3, id_ce_instructionCode, "id-ce-instructionCode" },
+	{ (const uint8_t *)"\x2a\x28\x00\x11\x01\x16", 6, A_Trust_EV_CPS, "A-Trust_EV_CPS" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x23", 3, user_password, "user_password" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x12", 3, post_office_box, "post_office_box" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x01\x04\x01", 9, SM2_Specificate, "SM2_Specificate" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x0b\x14", 10, OID_CERT_KEY_IDENTIFIER_PROP_ID, "OID_CERT_KEY_IDENTIFIER_PROP_ID" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x30\x03", 8, id_ad_timeStamping, "id-ad-timeStamping" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x19\x05", 10, pkcs_9_at_pkcs7PDU, "pkcs-9-at-pkcs7PDU" },
+	{ (const uint8_t *)"\x55\x04\x22", 3, see_also, "see_also" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\xb2\x31\x01\x02\x01\x05\x01", 12, Comodo_Group_EV_CPS, "Comodo_Group_EV_CPS" },
+	{ (const uint8_t *)"\x2b\x81\x04\x00\x21", 5, secp224r1, "secp224r1" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x07\x01", 10, szOID_KEYID_RDN, "szOID_KEYID_RDN" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x3c\x02\x01\x02", 11, jurisdiction_of_incorporation_state_or_province_name, "jurisdiction_of_incorporation_state_or_province_name" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x0e\x03\x02\x1d", 5, sha_1WithRSAEncryption, "sha-1WithRSAEncryption" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x01\x01\x02", 9, SM4_Standard, "SM4_Standard" },
+	{ (const uint8_t *)"\x55\x1d\x20\x00", 4, anyPolicy, "anyPolicy" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x18\x01", 10, pkcs_9_oc_pkcsEntity, "pkcs-9-oc-pkcsEntity" },
+	{ (const uint8_t *)"\x2b\x81\x04\x00\x10", 5, sect283k1, "sect283k1" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\xbe\x58\x00\x02\x64\x01\x02", 12, QuoVadis_EV_CPS, "QuoVadis_EV_CPS" },
+	{ (const uint8_t *)"\x55\x1d\x1c", 3, id_ce_issuingDistributionPoint, "id-ce-issuingDistributionPoint" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x06", 8, id_cmc_senderNonce, "id-cmc-senderNonce" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x86\xf8\x42\x03\x01\x81\x58", 11, pkcs_9_at_userPKCS12, "pkcs-9-at-userPKCS12" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x01\x0e", 10, SPC_CERT_EXTENSIONS_OBJID, "SPC_CERT_EXTENSIONS_OBJID" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x0e", 8, c2onb239v4, "c2onb239v4" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x03", 9, pkcs_9_at_contentType, "pkcs-9-at-contentType" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x02\x03", 9, id_sha512, "id-sha512" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x3c\x02\x01\x01", 11, jurisdiction_of_incorporation_locality_name, "jurisdiction_of_incorporation_locality_name" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x38\x04\x03", 7, id_dsa_with_sha1, "id-dsa-with-sha1" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x86\xfd\x6e\x01\x07\x17\x03", 11, Starfield_Technologies_EV_CPS, "Starfield_Technologies_EV_CPS" },
+	{ (const uint8_t *)"\x55\x1d\x14", 3, id_ce_cRLNumber, "id-ce-cRLNumber" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x1b", 7, sect233r1_1_, "sect233r1[1]" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x14", 9, szOID_REQUEST_CLIENT_INFO, "szOID_REQUEST_CLIENT_INFO" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x1a\x02", 10, pkcs_9_sx_signingTime, "pkcs-9-sx-signingTime" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x1a", 8, id_cmc_trustedAnchors, "id-cmc-trustedAnchors" },
+	{ (const uint8_t *)"\x55\x04\x2f", 3, enhanced_search_guide, "enhanced_search_guide" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x04", 6, id_ecSigType, "id-ecSigType" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x05", 7, id_md5, "id-md5" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x21", 7, secp224r1_1_, "secp224r1[1]" },
+	{ (const uint8_t *)"\x2b\x81\x04\x00\x23", 5, secp521r1, "secp521r1" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x81\x48", 8, Stream_Cipher, "Stream_Cipher" },
+	{ (const uint8_t *)"\x55\x04\x1f", 3, member, "member" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x01\x01", 8, prime192v1, "prime192v1" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x03\x07", 10, szOID_OEM_WHQL_CRYPTO, "szOID_OEM_WHQL_CRYPTO" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x01\x07", 9, id_RSAES_OAEP, "id-RSAES-OAEP" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x86\xfd\x6c\x02\x01", 9, DigiCert_EV_CPS, "DigiCert_EV_CPS" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x02\x02", 8, md2, "md2" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x01\x0b", 8, id_pe_subjectInfoAccess, "id-pe-subjectInfoAccess" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x0d", 3, description, "description" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x01\x01", 8, Algorithm_Class, "Algorithm_Class" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x01", 9, szOID_CERTSRV_CA_VERSION, "szOID_CERTSRV_CA_VERSION" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x14\x01", 8, id_logo_loyalty, "id-logo-loyalty" },
+	{ (const uint8_t *)"\x2b\x81\x04\x00\x0f", 5, sect163r2, "sect163r2" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x0b", 8, id_cmc_lraPOPWitness, "id-cmc-lraPOPWitness" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x01\x0c", 9, sha384WithRSAEncryption, "sha384WithRSAEncryption" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x86\xf8\x42\x01\x04", 9, CaRevocationURL, "CaRevocationURL" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x86\x0e\x01\x02\x01\x08\x01", 12, Network_Solutions__EV_CPS, "Network_Solutions__EV_CPS" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x2c", 3, generation_qualifier, "generation_qualifier" },
+	{ (const uint8_t *)"\x2b\x81\x04\x00\x26", 5, sect571k1, "sect571k1" },
+	{ (const uint8_t *)"\x2a\x81\x1c\x86\xef\x3a\x01\x01\x03", 9, SHECA_EV_CPS, "SHECA_EV_CPS" },
+	{ (const uint8_t *)"\x55\x1d\x1d", 3, id_ce_certificateIssuer, "id-ce-certificateIssuer" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x03\x0a", 9, id_ecdsa_with_sha3_256, "id-ecdsa-with-sha3-256" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x82\x2e\x02", 9, SM9_2_Key_Exchange_Protocol, "SM9-2_Key_Exchange_Protocol" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x86\xfb\x7b\x83\x74\x09", 10, Wells_Fargo_EV_CPS, "Wells_Fargo_EV_CPS" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x05\x02", 10, szOID_DRM_INDIVIDUALIZATION, "szOID_DRM_INDIVIDUALIZATION" },
+	{ (const uint8_t *)"\x2b\x0e\x03\x02\x0f", 5, id_sha_with_rsa_signature, "id-sha-with-rsa-signature" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x3c\x01\x01", 10, OID_ROOT_PROGRAM_FLAGS_BITSTRING, "OID_ROOT_PROGRAM_FLAGS_BITSTRING" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x11\x01", 9, szOID_LOCAL_MACHINE_KEYSET, "szOID_LOCAL_MACHINE_KEYSET" },
+	{ (const uint8_t *)"\x2a\x85\x03\x07\x01\x01\x01\x01", 8, id_tc26_gost3410_12_256, "id-tc26-gost3410-12-256" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x01\x04", 8, Security_Mechanism, "Security_Mechanism" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x2c\x01", 9, szOID_PEERNET_PNRP, "szOID_PEERNET_PNRP" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x01\x0b", 8, brainpoolP384r1, "brainpoolP384r1" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x58\x01", 9, szOID_CAPICOM_VERSION, "szOID_CAPICOM_VERSION" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x8f\x09\x02\x01", 10, AffirmTrust_EV_CPS, "AffirmTrust_EV_CPS" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x0c\x03", 8, id_cct_PKIResponse, "id-cct-PKIResponse" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0d\x02\x02", 10, szOID_ENROLLMENT_CSP_PROVIDER, "szOID_ENROLLMENT_CSP_PROVIDER" },
+	{ (const uint8_t *)"\x55\x04\x21", 3, role_occupant, "role_occupant" },
+	{ (const uint8_t *)"\x09\x92\x26\x89\x93\xf2\x2c\x64\x01\x01", 10, user_id, "user_id" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x1d\x21", 3, id_ce_policyMappings, "id-ce-policyMappings" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x12\x01", 9, szOID_PKIX_LICENSE_INFO, "szOID_PKIX_LICENSE_INFO" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x03\x02\x01", 10, SPC_TIME_STAMP_REQUEST_OBJID, "SPC_TIME_STAMP_REQUEST_OBJID" },
+	{ (const uint8_t *)"\x55\x04\x18", 3, x121_address, "x121_address" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x23", 7, secp521r1_1_, "secp521r1[1]" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x0f", 9, pkcs_9_at_smimeCapabilities, "pkcs-9-at-smimeCapabilities" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x03\x02", 10, szOID_KP_TIME_STAMP_SIGNING, "szOID_KP_TIME_STAMP_SIGNING" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x01\x09", 9, id_pSpecified, "id-pSpecified" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x2c\x03\x01", 10, szOID_PEERNET_GROUPING_PEERNAME, "szOID_PEERNET_GROUPING_PEERNAME" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x06\x01", 10, szOID_LICENSES, "szOID_LICENSES" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x02\x02", 9, id_sha384, "id-sha384" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x03", 7, Service_Class, "Service_Class" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x30\x02", 8, id_ad_caIssuers, "id-ad-caIssuers" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x2c\x01\x03", 10, szOID_PEERNET_PNRP_PAYLOAD, "szOID_PEERNET_PNRP_PAYLOAD" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x05\x01", 10, szOID_DRM, "szOID_DRM" },
+	{ (const uint8_t *)"\x55\x04\x1a", 3, registered_address, "registered_address" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x2c\x00\x04", 10, szOID_PEERNET_CERT_VERSION, "szOID_PEERNET_CERT_VERSION" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x67", 7, SSF33_Block_Cipher, "SSF33_Block_Cipher" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x01\x1b", 10, SPC_FINANCIAL_CRITERIA_OBJID, "SPC_FINANCIAL_CRITERIA_OBJID" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x81\x1f\x01\x11\x01", 6, Actalis_EV_CPS, "Actalis_EV_CPS" },
+	{ (const uint8_t *)"\x55\x1d\x13", 3, id_ce_basicConstraints, "id-ce-basicConstraints" },
+	{ (const uint8_t *)"\x2a\x85\x03\x07\x01\x01\x02\x02", 8, id_tc26_digest_gost3411_12_256, "id-tc26-digest-gost3411-12-256" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x83\x74", 8, Digest_Signing, "Digest_Signing" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x03\x09", 9, id_ecdsa_with_sha3_224, "id-ecdsa-with-sha3-224" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x0d", 8, c2tnb239v3, "c2tnb239v3" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x03\x0f", 9, id_rsassa_pkcs1_v1_5_with_sha3_384, "id-rsassa-pkcs1-v1_5-with-sha3-384" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x0b\x69", 10, OID_CERT_PROP_ID_PREFIX_105, "OID_CERT_PROP_ID_PREFIX_105" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x01\x04", 9, md5WithRSAEncryption, "md5WithRSAEncryption" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x09\x03", 8, pkcs_9_at_gender, "pkcs-9-at-gender" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x03\x1c", 8, id_kp_cmcRA, "id-kp-cmcRA" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x0b\x0b", 10, CERT_FRIENDLY_NAME_PROP_ID, "CERT_FRIENDLY_NAME_PROP_ID" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06", 6, Standard_Class, "Standard_Class" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x0b\x1d", 10, OID_CERT_SUBJECT_NAME_MD5_HASH_PROP_ID, "OID_CERT_SUBJECT_NAME_MD5_HASH_PROP_ID" },
+	{ (const uint8_t *)"\x55\x1d\x0f", 3, key_usage, "key_usage" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x30\x0c", 8, id_ad_cmc, "id-ad-cmc" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x33", 3, house_identifier, "house_identifier" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x30\x01", 8, id_ad_ocsp, "id-ad-ocsp" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x01\x0b", 9, sha256WithRSAEncryption, "sha256WithRSAEncryption" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x08", 3, state_or_province_name, "state_or_province_name" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x18", 9, pkcs_9_oc, "pkcs-9-oc" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x01\x10", 9, sha512_256WithRSAEncryption, "sha512-256WithRSAEncryption" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x15", 3, telex_number, "telex_number" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x81\xb5\x37\x01\x01\x01", 11, StartCom_Certification_Authority_EV_CPS_1_, "StartCom_Certification_Authority_EV_CPS[1]" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x02", 8, c2pnb163v2, "c2pnb163v2" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x03", 8, id_cmc_identityProof, "id-cmc-identityProof" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x38\x04\x01", 7, id_dsa, "id-dsa" },
+	{ (const uint8_t *)"\x55\x1d\x11", 3, subject_alt_name, "subject_alt_name" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x83\x11", 8, SM3_Hash_Algorithm, "SM3_Hash_Algorithm" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x81\x04\x00\x11", 5, sect283r1, "sect283r1" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x01\x1d", 10, SPC_HASH_INFO_OBJID, "SPC_HASH_INFO_OBJID" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x04\x01", 7, ecdsa_with_SHA1, "ecdsa-with-SHA1" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x13", 8, c2pnb368w1, "c2pnb368w1" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x02\x14", 9, id_KmacWithSHAKE256, "id-KmacWithSHAKE256" },
+	{ (const uint8_t *)"\x2a\x85\x03\x07\x01\x01\x01\x02", 8, id_tc26_gost3410_12_512, "id-tc26-gost3410-12-512" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x0a", 3, organization_name, "organization_name" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x08", 7, id_on, "id-on" },
+	{ (const uint8_t *)"\x55\x1d\x25\x00", 4, anyExtendedKeyUsage, "anyExtendedKeyUsage" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x83\x78", 8, RSA_Signing_with_SM3, "RSA_Signing_with_SM3" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x19", 9, pkcs_9_at, "pkcs-9-at" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x21", 8, id_cmc_popLinkWitnessV2, "id-cmc-popLinkWitnessV2" },
+	{ (const uint8_t *)"\x55\x04\x03", 3, common_name, "common_name" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x09\x04", 8, pkcs_9_at_countryOfCitizenship, "pkcs-9-at-countryOfCitizenship" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x04\x00\x8f\x7a\x01\x05", 6, ETSI_EV_CPS, "ETSI_EV_CPS" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x03\x02", 8, id_kp_clientAuth, "id-kp-clientAuth" },
+	{ (const uint8_t *)"\x2a\x85\x03\x07\x01\x01\x03\x03", 8, id_tc26_signwithdigest_gost3410_12_512, "id-tc26-signwithdigest-gost3410-12-512" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x0c\x01", 10, szOID_ANY_APPLICATION_POLICY, "szOID_ANY_APPLICATION_POLICY" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03", 6, ellipticCurve, "ellipticCurve" },
+	{ (const uint8_t *)"\x55\x1d\x24", 3, id_ce_policyConstraints, "id-ce-policyConstraints" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x03\x06", 10, szOID_NT5_CRYPTO, "szOID_NT5_CRYPTO" },
+	{ (const uint8_t *)"\x55\x04\x2e", 3, dn_qualifier, "dn_qualifier" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x30\x01\x07", 9, id_pkix_ocsp_service_locator, "id-pkix-ocsp-service-locator" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x0d", 9, pkcs_9_at_signingDescription, "pkcs-9-at-signingDescription" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x09", 7, ietf_at, "ietf-at" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x30\x01\x03", 9, id_pkix_ocsp_crl, "id-pkix-ocsp-crl" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x82\x2e", 8, SM9_Identity_Based_Cryptography, "SM9_Identity-Based_Cryptography" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x01\x05", 8, prime239v2, "prime239v2" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x04\x03\x03", 8, ecdsa_with_SHA384, "ecdsa-with-SHA384" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x04", 8, id_cmc_dataReturn, "id-cmc-dataReturn" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x03\x04", 10, szOID_EFS_CRYPTO, "szOID_EFS_CRYPTO" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x14\x02", 9, szOID_ENROLL_CERTTYPE_EXTENSION, "szOID_ENROLL_CERTTYPE_EXTENSION" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x01\x03", 8, id_pe_qcStatements, "id-pe-qcStatements" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x04", 9, pkcs_9_at_messageDigest, "pkcs-9-at-messageDigest" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x25", 7, sect409r1_1_, "sect409r1[1]" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x08", 8, c2onb191v4, "c2onb191v4" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x1b", 3, destination_indicator, "destination_indicator" },
+	{ (const uint8_t *)"\x55\x04\x14", 3, telephone_number, "telephone_number" },
+	{ (const uint8_t *)"\x2a\x81\x1c\x81\x45", 5, OSCCA, "OSCCA" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x68", 7, SM4_Block_Cipher, "SM4_Block_Cipher" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x02\x0d", 9, id_hmacWithSHA3_224, "id-hmacWithSHA3-224" },
+	{ (const uint8_t *)"\x2b\x81\x04\x00\x1b", 5, sect233r1, "sect233r1" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x01\x02", 9, md2WithRSAEncryption, "md2WithRSAEncryption" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x10", 7, sect283k1_1_, "sect283k1[1]" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0d\x01", 9, szOID_RENEWAL_CERTIFICATE, "szOID_RENEWAL_CERTIFICATE" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x18", 8, id_cmc_confirmCertAcceptance, "id-cmc-confirmCertAcceptance" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x05\x01", 8, Random_Testing_Class, "Random_Testing_Class" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x01", 9, OID_CTL, "OID_CTL" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x03\x03\x01", 11, szOID_SERIALIZED, "szOID_SERIALIZED" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\xbd\x47\x0d\x18\x01", 10, T_Systems_EV_CPS, "T-Systems_EV_CPS" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x14", 8, c2tnb431r1, "c2tnb431r1" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x1f", 8, id_cmc_modCertTemplate, "id-cmc-modCertTemplate" },
+	{ (const uint8_t *)"\x2a\x83\x08\x8c\x9b\x1b\x64\x85\x51\x01", 10, SECOM_Trust_Systems_EV_CPS, "SECOM_Trust_Systems_EV_CPS" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x01\x02", 8, id_pe_biometricInfo, "id-pe-biometricInfo" },
+	{ (const uint8_t *)"\x55\x04\x17", 3, facsimile_telephone_number, "facsimile_telephone_number" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x1d", 8, id_cmc_batchResponses, "id-cmc-batchResponses" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x03\x09", 10, OID_ROOT_LIST_SIGNER, "OID_ROOT_LIST_SIGNER" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x17", 9, crlTypes, "crlTypes" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x01\x0f", 10, SPC_PE_IMAGE_DATA_OBJID, "SPC_PE_IMAGE_DATA_OBJID" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x01\x03", 8, Operation_Modes, "Operation_Modes" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x30\x01\x08", 9, id_pkix_ocsp_pref_sig_algs, "id-pkix-ocsp-pref-sig-algs" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x12\x07", 9, szOID_PKIS_PRODUCT_SPECIFIC_OID, "szOID_PKIS_PRODUCT_SPECIFIC_OID" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x2c\x00\x01", 10, szOID_PEERNET_CERT_TYPE, "szOID_PEERNET_CERT_TYPE" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x03\x0b", 10, szOID_KP_KEY_RECOVERY, "szOID_KP_KEY_RECOVERY" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x30\x01\x06", 9, id_pkix_ocsp_archive_cutoff, "id-pkix-ocsp-archive-cutoff" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x86\xf8\x42\x01\x03", 9, RevocationURL, "RevocationURL" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x01\x02\x03", 8, id_characteristic_two_basis, "id-characteristic-two-basis" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x1d\x1b", 3, id_ce_deltaCRLIndicator, "id-ce-deltaCRLIndicator" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x86\xfd\x64\x01\x01\x02\x04\x01", 12, Trustwave_EV_CPS, "Trustwave_EV_CPS" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x01\x01", 10, szOID_SORTED_CTL, "szOID_SORTED_CTL" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x0b\x53", 10, CERT_ROOT_PROGRAM_CERT_POLICIES_PROP_ID, "CERT_ROOT_PROGRAM_CERT_POLICIES_PROP_ID" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x01\x13", 10, SPC_STRUCTURED_STORAGE_DATA_OBJID, "SPC_STRUCTURED_STORAGE_DATA_OBJID" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x01", 7, Fundatation_Class, "Fundatation_Class" },
+	{ (const uint8_t *)"\x2b\x81\x04\x00\x24", 5, sect409k1, "sect409k1" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x03", 9, szOID_CRL_VIRTUAL_BASE, "szOID_CRL_VIRTUAL_BASE" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x24\x03\x03\x02\x08\x01", 7, ellipticCurve_1_, "ellipticCurve[1]" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x01\x08", 9, id_mgf1, "id-mgf1" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x19\x01", 9, szOID_NTDS_REPLICATION, "szOID_NTDS_REPLICATION" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x02\x0b", 9, id_shake128, "id-shake128" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x03\x01", 8, id_kp_serverAuth, "id-kp-serverAuth" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x82\x2e\x01", 9, SM9_1_Digital_Signature_Algorithm, "SM9-1_Digital_Signature_Algorithm" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x1f", 7, secp192k1, "secp192k1" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x01\x1c", 10, SPC_LINK_OBJID, "SPC_LINK_OBJID" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x01\x0c", 8, brainpoolP384t1, "brainpoolP384t1" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x12", 8, c2tnb359v1, "c2tnb359v1" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x54\x01\x01", 10, driveEncryption, "driveEncryption" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x02\x02", 8, id_qt_unotice, "id-qt-unotice" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x02\x01", 7, id_ecPublicKey, "id-ecPublicKey" },
+	{ (const uint8_t *)"\x60\x84\x10\x01\x87\x6b\x01\x02\x07", 9, Logius_PKIoverheid_EV_CPS, "Logius_PKIoverheid_EV_CPS" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x12\x08", 9, szOID_PKIS_TLSERVER_SPK_OID, "szOID_PKIS_TLSERVER_SPK_OID" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x01\x0a", 10, SPC_SP_AGENCY_INFO_OBJID, "SPC_SP_AGENCY_INFO_OBJID" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x16", 9, certTypes, "certTypes" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x06", 9, szOID_KP_KEY_RECOVERY_AGENT, "szOID_KP_KEY_RECOVERY_AGENT" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x07", 9, szOID_MICROSOFT_RDN_PREFIX, "szOID_MICROSOFT_RDN_PREFIX" },
+	{ (const uint8_t *)"\x55\x04\x2d", 3, x500_unique_identifier, "x500_unique_identifier" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x01\x01\x03", 9, SM2_Standard, "SM2_Standard" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x03\x0c", 9, id_ecdsa_with_sha3_512, "id-ecdsa-with-sha3-512" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x30\x01\x09", 9, id_pkix_ocsp_extended_revoke, "id-pkix-ocsp-extended-revoke" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x86\xfa\x6c\x0a\x01\x02", 10, Entrust_EV_CPS, "Entrust_EV_CPS" },
+	{ (const uint8_t *)"\x2b\x81\x04\x01\x0d", 5, id_ecMQV, "id-ecMQV" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x02", 9, szOID_CERTSRV_PREVIOUS_CERT_HASH, "szOID_CERTSRV_PREVIOUS_CERT_HASH" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x01\x01", 7, prime_field, "prime-field" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x2c\x01\x02", 10, szOID_PEERNET_PNRP_FLAGS, "szOID_PEERNET_PNRP_FLAGS" },
+	{ (const uint8_t *)"\x09\x92\x26\x89\x93\xf2\x2c\x64\x01\x19", 10, domain_component, "domain_component" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x02\x01", 9, id_sha256, "id-sha256" },
+	{ (const uint8_t *)"\x60\x84\x42\x01\x1a\x01\x03\x03", 8, Buypass_EV_CPS, "Buypass_EV_CPS" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x1e\x01", 9, szOID_IIS_VIRTUAL_SERVER, "szOID_IIS_VIRTUAL_SERVER" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x10", 9, szOID_ARCHIVED_KEY_CERT_HASH, "szOID_ARCHIVED_KEY_CERT_HASH" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\xd6\x79\x02\x04\x02", 10, id_ce_SignedCertificateTimestampList, "id-ce-SignedCertificateTimestampList" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09", 8, pkcs_9, "pkcs-9" },
+	{ (const uint8_t *)"\x55\x04\x0b", 3, organizational_unit_name, "organizational_unit_name" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x01\x0e", 9, sha224WithRSAEncryption, "sha224WithRSAEncryption" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x01\x01", 8, id_pe_authorityInfoAccess, "id-pe-authorityInfoAccess" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x05", 8, c2tnb191v1, "c2tnb191v1" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x03", 8, sigAlgs, "sigAlgs" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x03\x1b", 8, id_kp_cmcCA, "id-kp-cmcCA" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x18\x02", 10, pkcs_9_oc_naturalPerson, "pkcs-9-oc-naturalPerson" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x82\x2e\x03", 9, SM9_3_Public_Key_Encryptio, "SM9-3_Public_Key_Encryptio" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x03\x05", 8, id_kp_ipsecEndSystem, "id-kp-ipsecEndSystem" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x03\x0d", 9, id_rsassa_pkcs1_v1_5_with_sha3_224, "id-rsassa-pkcs1-v1_5-with-sha3-224" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x86\xfd\x6c\x01\x03\x00\x02", 11, DigiCert_EV_CPS_1_, "DigiCert_EV_CPS[1]" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x01\x01\x04", 9, SM3_Standard, "SM3_Standard" },
+	{ (const uint8_t *)"\x55\x1d\x1f", 3, id_ce_cRLDistributionPoints, "id-ce-cRLDistributionPoints" },
+	{ (const uint8_t *)"\x55\x1d\x09", 3, id_ce_subjectDirectoryAttributes, "id-ce-subjectDirectoryAttributes" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x09\x02", 8, pkcs_9_at_placeOfBirth, "pkcs-9-at-placeOfBirth" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x82\x2c", 8, Public_Key_Cryptography, "Public_Key_Cryptography" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x86\xf8\x42\x01\x0c", 9, SSLServerName, "SSLServerName" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x01\x03", 8, prime192v3, "prime192v3" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x15", 9, szOID_ENCRYPTED_KEY_HASH, "szOID_ENCRYPTED_KEY_HASH" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x58\x03", 9, szOID_CAPICOM_ENCRYPTED_DATA, "szOID_CAPICOM_ENCRYPTED_DATA" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x86\xf8\x42\x01\x01", 9, NetscapeCertType, "NetscapeCertType" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x82\x2d\x03", 9, SM2_3_Public_Key_Encryption, "SM2-3_Public_Key_Encryption" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x0f", 7, sect163r2_1_, "sect163r2[1]" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0c\x02\x02", 10, CAT_MEMBERINFO_OBJID, "CAT_MEMBERINFO_OBJID" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x86\xf8\x42\x01", 8, NetscapeCertificateExtension, "NetscapeCertificateExtension" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x13", 9, szOID_DS_EMAIL_REPLICATION, "szOID_DS_EMAIL_REPLICATION" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x04\x01", 10, szOID_YESNO_TRUST_ATTR, "szOID_YESNO_TRUST_ATTR" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x03\x02", 9, id_dsa_with_sha256, "id-dsa-with-sha256" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x01\x1a", 10, SPC_MINIMAL_CRITERIA_OBJID, "SPC_MINIMAL_CRITERIA_OBJID" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x2b", 3, initials, "initials" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x58\x03\x01", 10, szOID_CAPICOM_ENCRYPTED_CONTENT, "szOID_CAPICOM_ENCRYPTED_CONTENT" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x20", 8, id_cmc_controlProcessed, "id-cmc-controlProcessed" },
+	{ (const uint8_t *)"\x55\x04\x29", 3, name, "name" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04", 2, id_at, "id-at" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x03\x09", 8, id_kp_OCSPSigning, "id-kp-OCSPSigning" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x15", 8, id_cmc_queryPending, "id-cmc-queryPending" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x82\x2d\x02", 9, SM2_2_Key_Exchange_Protocol, "SM2-2_Key_Exchange_Protocol" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x03\x01", 10, szOID_KP_CTL_USAGE_SIGNING, "szOID_KP_CTL_USAGE_SIGNING" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x02\x05", 8, md5, "md5" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x02", 9, pkcs_9_at_unstructuredName, "pkcs-9-at-unstructuredName" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x1a", 9, pkcs_9_sx, "pkcs-9-sx" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x0a", 7, secp256k1, "secp256k1" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x01\x04", 8, prime239v1, "prime239v1" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x85\x74\x01\x53\x15\x00", 7, Swisscom_EV_CPS, "Swisscom_EV_CPS" },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x83\x10", 8, Hash_Algorithm, "Hash_Algorithm" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x06", 8, c2tnb191v2, "c2tnb191v2" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x19\x01", 10, pkcs_9_at_pkcs15Token, "pkcs-9-at-pkcs15Token" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x19\x04", 10, pkcs_9_at_sequenceNumber, "pkcs-9-at-sequenceNumber" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x01", 6, id_fieldType, "id-fieldType" },
+	{ (const uint8_t *)"\x55\x1d\x22", 3, DeprecatedpolicyConstraints, "DeprecatedpolicyConstraints" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x86\x18\x03\x00\x04\x01\x01\x04", 9, E_Tugra_EV_CPS, "E-Tugra_EV_CPS" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x8f\x09\x02\x03", 10, AffirmTrust_EV_CPS_2_, "AffirmTrust_EV_CPS[2]" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x1b", 8, id_cmc_authData, "id-cmc-authData" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x2c\x03\x05", 10, szOID_PEERNET_GROUPING_CLASSIFIERS, "szOID_PEERNET_GROUPING_CLASSIFIERS" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x1a\x01", 10, pkcs_9_sx_pkcs9String, "pkcs-9-sx-pkcs9String" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x58\x02", 9, szOID_CAPICOM_ATTRIBUTE, "szOID_CAPICOM_ATTRIBUTE" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x0f", 9, szOID_REQUIRE_CERT_CHAIN_POLICY, "szOID_REQUIRE_CERT_CHAIN_POLICY" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x0a", 8, c2pnb208w1, "c2pnb208w1" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x19", 3, international_isdn_number, "international_isdn_number" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x01\x14", 10, SPC_JAVA_CLASS_DATA_OBJID, "SPC_JAVA_CLASS_DATA_OBJID" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x02\x04", 9, id_sha224, "id-sha224" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x2c\x01\x01", 10, szOID_PEERNET_PNRP_ADDRESS, "szOID_PEERNET_PNRP_ADDRESS" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07", 7, id_cmc, "id-cmc" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x20", 7, secp224k1, "secp224k1" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x0b", 9, szOID_APPLICATION_POLICY_MAPPINGS, "szOID_APPLICATION_POLICY_MAPPINGS" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x01\x06", 8, prime239v3, "prime239v3" },
+	{ (const uint8_t *)"\x2a\x85\x03\x07\x01\x01\x02\x03", 8, id_tc26_digest_gost3411_12_512, "id-tc26-digest-gost3411-12-512" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0d\x02\x01", 10, szOID_ENROLLMENT_NAME_VALUE_PAIR, "szOID_ENROLLMENT_NAME_VALUE_PAIR" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x14\x02", 8, id_logo_background, "id-logo-background" },
+	{ (const uint8_t *)"\x60\x84\x10\x01\x87\x69\x01\x01\x01\x0c\x06\x01\x01\x01", 14, DigiNotar_EV_CPS, "DigiNotar_EV_CPS" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x58\x02\x02", 10, szOID_CAPICOM_DOCUMENT_DESCRIPTION, "szOID_CAPICOM_DOCUMENT_DESCRIPTION" },
+	{ (const uint8_t *)"\x2b\x81\x04\x00\x1a", 5, sect233k1, "sect233k1" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x0c", 3, title, "title" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x58\x02\x01", 10, szOID_CAPICOM_DOCUMENT_NAME, "szOID_CAPICOM_DOCUMENT_NAME" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x01\x05", 9, sha1WithRSAEncryption, "sha1WithRSAEncryption" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x01\x0c", 8, id_pe_logotype, "id-pe-logotype" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x09\x05", 8, pkcs_9_at_countryOfResidence, "pkcs-9-at-countryOfResidence" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x30\x01\x04", 9, id_pkix_ocsp_response, "id-pkix-ocsp-response" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x2c\x02", 9, szOID_PEERNET_IDENTITY, "szOID_PEERNET_IDENTITY" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x12\x03", 9, szOID_PKIX_MANUFACTURER_MS_SPECIFIC, "szOID_PKIX_MANUFACTURER_MS_SPECIFIC" },
+	{ (const uint8_t *)"\x55\x1d\x25", 3, ext_key_usage, "ext_key_usage" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x04\x03\x04", 8, ecdsa_with_SHA512, "ecdsa-with-SHA512" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x10\x02\x22", 11, id_aa_cmc_unsignedData, "id-aa-cmc-unsignedData" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x2c\x00\x02", 10, szOID_PEERNET_PEERNAME, "szOID_PEERNET_PEERNAME" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0c\x01\x01", 10, szOID_CATALOG_LIST, "szOID_CATALOG_LIST" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\xd6\x79\x02\x04\x05", 10, id_ad_ocsp_SignedCertificateTimestampList, "id-ad-ocsp-SignedCertificateTimestampList" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x02", 8, hashAlgs, "hashAlgs" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x06", 7, Management_Class, "Management_Class" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x03", 8, c2pnb163v3, "c2pnb163v3" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x08", 9, pkcs_9_at_unstructuredAddress, "pkcs-9-at-unstructuredAddress" },
+	{ (const uint8_t *)"\x55\x1d\x01", 3, DeprecatedAuthorityKeyIdentifier, "DeprecatedAuthorityKeyIdentifier" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x01\x02\x03\x01", 9, gnBasis, "gnBasis" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x03\x0b", 9, id_ecdsa_with_sha3_384, "id-ecdsa-with-sha3-384" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x01\x0e", 8, brainpoolP512t1, "brainpoolP512t1" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x02\x0c", 9, id_shake256, "id-shake256" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x1d\x20", 3, id_ce_certificatePolicies, "id-ce-certificatePolicies" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x08", 8, id_cmc_addExtensions, "id-cmc-addExtensions" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x01\x0c", 10, SPC_SP_OPUS_INFO_OBJID, "SPC_SP_OPUS_INFO_OBJID" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x14", 9, pkcs_9_at_friendlyName, "pkcs-9-at-friendlyName" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x02\x10", 9, id_hmacWithSHA3_512, "id-hmacWithSHA3-512" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x04", 9, szOID_CRL_NEXT_PUBLISH, "szOID_CRL_NEXT_PUBLISH" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x13", 3, physical_delivery_office_name, "physical_delivery_office_name" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x01\x01\x01", 9, ZUC_Standard, "ZUC_Standard" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x05", 8, id_cmc_transactionId, "id-cmc-transactionId" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x03\x10", 9, id_rsassa_pkcs1_v1_5_with_sha3_512, "id-rsassa-pkcs1-v1_5-with-sha3-512" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x1b", 9, pkcs_9_mr, "pkcs-9-mr" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x30", 7, id_ad, "id-ad" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x03\x04", 8, id_kp_emailProtection, "id-kp-emailProtection" },
+	{ (const uint8_t *)"\x55\x04\x06", 3, country_name, "country_name" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x14\x01", 9, szOID_AUTO_ENROLL_CTL_USAGE, "szOID_AUTO_ENROLL_CTL_USAGE" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x81\xad\x5a\x02\x05\x02\x03\x01", 13, OpenTrust_DocuSign_France_EV_CPS, "OpenTrust_DocuSign_France_EV_CPS" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x0f", 8, c2onb239v5, "c2onb239v5" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x10", 3, postal_address, "postal_address" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d", 5, ansi_X9_62, "ansi-X9-62" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x01\x02", 8, ID_Class, "ID_Class" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x0c\x02", 8, id_cct_PKIData, "id-cct-PKIData" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x07", 3, locality_name, "locality_name" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x03\x08", 8, id_kp_timeStamping, "id-kp-timeStamping" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x03\x0a", 10, szOID_KP_QUALIFIED_SUBORDINATION, "szOID_KP_QUALIFIED_SUBORDINATION" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x01\x04", 10, SPC_INDIRECT_DATA_OBJID, "SPC_INDIRECT_DATA_OBJID" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x04\x00\x8f\x7a\x01\x04", 6, ETSI_EV_CPS_1_, "ETSI_EV_CPS[1]" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x01\x02\x03\x03", 9, ppBasis, "ppBasis" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x23", 8, id_cmc_raIdentityWitness, "id-cmc-raIdentityWitness" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x06\x02", 10, szOID_LICENSE_SERVER, "szOID_LICENSE_SERVER" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x07", 9, pkcs_9_at_challengePassword, "pkcs-9-at-challengePassword" },
+	{ (const uint8_t *)"\x2b\x65\x70", 3, id_Ed25519, "id-Ed25519" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x1a", 7, sect233k1_1_, "sect233k1[1]" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x03\x0d", 10, szOID_KP_LIFETIME_SIGNING, "szOID_KP_LIFETIME_SIGNING" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x86\xf8\x42\x01\x0d", 9, NetscapeCertificateComment, "NetscapeCertificateComment" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x02\x01", 10, szOID_TRUSTED_CODESIGNING_CA_LIST, "szOID_TRUSTED_CODESIGNING_CA_LIST" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x02", 8, id_cmc_identification, "id-cmc-identification" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x52\x86\x48\xce\x38\x02\x03", 7, id_holdinstruction_reject, "id-holdinstruction-reject" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x11", 3, postal_code, "postal_code" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x02", 9, szOID_NEXT_UPDATE_LOCATION, "szOID_NEXT_UPDATE_LOCATION" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x02\x01", 8, id_qt_cps, "id-qt-cps" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x16", 3, teletex_terminal_identifier, "teletex_terminal_identifier" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x02", 6, id_publicKeyType, "id-publicKeyType" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x06\x21", 8, id_ecdsa_with_shake256, "id-ecdsa-with-shake256" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x09", 9, pkcs_9_at_extendedCertificateAttributes, "pkcs-9-at-extendedCertificateAttributes" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x10\x04", 9, szOID_MICROSOFT_Encryption_Key_Preference, "szOID_MICROSOFT_Encryption_Key_Preference" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00", 7, c_TwoCurve, "c-TwoCurve" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0d\x02\x03", 10, szOID_OS_VERSION, "szOID_OS_VERSION" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x0b", 9, szOID_CERT_PROP_ID_PREFIX, "szOID_CERT_PROP_ID_PREFIX" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x86\xf8\x45\x01\x07\x17\x06", 11, Symantec_EV_CPS, "Symantec_EV_CPS" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x8f\x09\x02\x02", 10, AffirmTrust_EV_CPS_1_, "AffirmTrust_EV_CPS[1]" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x11", 8, id_cmc_revokeRequest, "id-cmc-revokeRequest" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x58", 8, szOID_CAPICOM, "szOID_CAPICOM" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x0c", 9, szOID_APPLICATION_POLICY_CONSTRAINTS, "szOID_APPLICATION_POLICY_CONSTRAINTS" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x14\x02\x03", 10, szOID_NT_PRINCIPAL_NAME, "szOID_NT_PRINCIPAL_NAME" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x2c\x02\x02", 10, szOID_PEERNET_IDENTITY_FLAGS, "szOID_PEERNET_IDENTITY_FLAGS" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x14\x02\x02", 10, szOID_KP_SMARTCARD_LOGON, "szOID_KP_SMARTCARD_LOGON" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x1b\x01", 10, pkcs_9_mr_caseIgnoreMatch, "pkcs-9-mr-caseIgnoreMatch" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x09", 8, c2onb191v5, "c2onb191v5" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x52\x86\x48\xce\x38\x02\x02", 7, id_holdinstruction_callissuer, "id-holdinstruction-callissuer" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x81\x87\x2e\x0a\x0e\x02\x01\x02", 13, Camerfirma_EV_CPS, "Camerfirma_EV_CPS" },
+	{ (const uint8_t *)"\x55\x1d\x18", 3, id_ce_invalidityDate, "id-ce-invalidityDate" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x19\x03", 10, pkcs_9_at_randomNonce, "pkcs-9-at-randomNonce" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x19\x02", 10, pkcs_9_at_encryptedPrivateKeyInfo, "pkcs-9-at-encryptedPrivateKeyInfo" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x81\x04\x00\x27", 5, sect571r1, "sect571r1" },
+	{ (const uint8_t *)"\x2a\x81\x1c", 3, China, "China" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x12\x02", 9, szOID_PKIX_MANUFACTURER, "szOID_PKIX_MANUFACTURER" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x1e", 8, id_cmc_publishCert, "id-cmc-publishCert" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55", 5, GM_Standard_Committee, "GM_Standard_Committee" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x24", 8, id_cmc_changeSubjectName, "id-cmc-changeSubjectName" },
+	{ (const uint8_t *)"\x2b\x81\x04\x00\x22", 5, secp384r1, "secp384r1" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x00", 9, pkcs_9_mo, "pkcs-9-mo" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x03\x08", 10, szOID_EMBEDDED_NT_CRYPTO, "szOID_EMBEDDED_NT_CRYPTO" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x03", 7, id_kp, "id-kp" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x03", 7, sect239k1, "sect239k1" },
+	{ (const uint8_t *)"\x55\x04\x09", 3, street, "street" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x24", 7, sect409k1_1_, "sect409k1[1]" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x2c\x03\x02", 10, szOID_PEERNET_GROUPING_FLAGS, "szOID_PEERNET_GROUPING_FLAGS" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x12\x04", 9, szOID_PKIX_HYDRA_CERT_VERSION, "szOID_PKIX_HYDRA_CERT_VERSION" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x0c", 8, c2tnb239v2, "c2tnb239v2" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x16", 8, id_cmc_popLinkRandom, "id-cmc-popLinkRandom" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x11", 8, c2pnb304w1, "c2pnb304w1" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x01\x82\x2d\x01", 9, SM2_1_Digital_Siganture_Algorithm, "SM2-1_Digital_Siganture_Algorithm" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x0b\x01", 8, id_qcs_pkixQCSyntax_v1, "id-qcs-pkixQCSyntax-v1" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x1c", 8, id_cmc_batchRequests, "id-cmc-batchRequests" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x41", 3, pseudonym, "pseudonym" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x01\x12", 10, SPC_RAW_FILE_DATA_OBJID, "SPC_RAW_FILE_DATA_OBJID" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x10", 8, c2pnb272w1, "c2pnb272w1" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x05", 9, szOID_KP_CA_EXCHANGE, "szOID_KP_CA_EXCHANGE" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x06\x1f", 8, id_RSASSA_PSS_SHAKE256, "id-RSASSA-PSS-SHAKE256" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x15\x07", 9, szOID_CERTIFICATE_TEMPLATE, "szOID_CERTIFICATE_TEMPLATE" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x12\x05", 9, szOID_PKIX_LICENSED_PRODUCT_INFO, "szOID_PKIX_LICENSED_PRODUCT_INFO" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x55\x04\x04", 3, surname, "surname" },
+	{ (const uint8_t *)"\x55\x1d\x1e", 3, id_ce_nameConstraints, "id-ce-nameConstraints" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\xa0\x32\x01\x01", 9, GlobalSign_EV_CPS, "GlobalSign_EV_CPS" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x08\x07", 8, id_on_dnsSRV, "id-on-dnsSRV" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x0b\x62", 10, OID_CERT_PROP_ID_PREFIX_98, "OID_CERT_PROP_ID_PREFIX_98" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x02\x02\x02", 10, szOID_TRUSTED_CLIENT_AUTH_CA_LIST, "szOID_TRUSTED_CLIENT_AUTH_CA_LIST" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x01\x0d", 9, sha512WithRSAEncryption, "sha512WithRSAEncryption" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x06\x1e", 8, id_RSASSA_PSS_SHAKE128, "id-RSASSA-PSS-SHAKE128" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\xb1\x3e\x01\x64\x01", 10, Verizon_Business_EV_CPS, "Verizon_Business_EV_CPS" },
+	{ (const uint8_t *)"\x60\x86\x48\x01\x65\x03\x04\x02\x0f", 9, id_hmacWithSHA3_384, "id-hmacWithSHA3-384" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x81\x04\x00\x01", 5, sect163k1, "sect163k1" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x07", 8, c2tnb191v3, "c2tnb191v3" },
+	{ (const uint8_t *)"\x55\x1d\x36", 3, id_ce_inhibitAnyPolicy, "id-ce-inhibitAnyPolicy" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x0c", 7, id_cct, "id-cct" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x02", 7, id_qt, "id-qt" },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x07\x17", 8, id_cmc_popLinkWitness, "id-cmc-popLinkWitness" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\xf0\x22\x01\x06", 9, GeoTrust_EV_CPS, "GeoTrust_EV_CPS" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x01\x0a", 9, id_RSASSA_PSS, "id-RSASSA-PSS" },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x05\x05\x07\x14", 7, id_logo, "id-logo" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\xe6\x79\x0a\x01\x03\x0a", 11, Firmaprofesional_EV_CPS, "Firmaprofesional_EV_CPS" },
+	{ (const uint8_t *)"\x2a\x86\x48\x86\xf7\x0d\x01\x09\x01", 9, emailAddress, "emailAddress" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2a\x81\x1c\xcf\x55\x06\x04", 7, Infrastructure, "Infrastructure" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x03\x00\x01", 8, c2pnb163v1, "c2pnb163v1" },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x0a\x09\x01", 10, szOID_CROSS_CERT_DIST_POINTS, "szOID_CROSS_CERT_DIST_POINTS" },
+	{ NULL, 0, unknown, NULL },
+	{ NULL, 0, unknown, NULL },
+	{ (const uint8_t *)"\x2b\x06\x01\x04\x01\x82\x37\x2c\x03", 9, szOID_PEERNET_GROUPING, "szOID_PEERNET_GROUPING" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x04\x03\x02", 8, ecdsa_with_SHA256, "ecdsa-with-SHA256" },
+	{ (const uint8_t *)"\x2a\x86\x48\xce\x3d\x01\x02", 7, characteristic_two_field, "characteristic-two-field" },
+	{ NULL, 0, unknown, NULL },
+};
@@ -237,8 +237,8 @@ struct oid_set {
     std::unordered_map<std::string, std::string> synonym;
     std::multiset<std::string> keywords;
 
-    void dump_oid_dict_sorted();
     void dump_oid_enum_dict_sorted();
+    void dump_perfect_hash();
     void verify_oid_dict();
     std::vector<uint32_t> get_vector_from_keyword(const std::string &keyword) {
         auto x = oid_dict.find(keyword);
@@ -527,24 +527,6 @@ void parse_asn1_file(const char *filename) {
 
 }
 
-void oid_set::dump_oid_dict_sorted() {
-    using namespace std;
-
-    struct pair_cmp {
-        inline bool operator() (const pair<string, vector<uint32_t>> &s1, const pair<string, vector<uint32_t>> &s2) {
-            return (s1.second < s2.second);
-        }
-    };
-    vector<pair<string, vector<uint32_t>>> ordered_dict(oid_dict.begin(), oid_dict.end());
-    sort(ordered_dict.begin(), ordered_dict.end(), pair_cmp());
-
-    cout << "std::unordered_map<std::basic_string<uint8_t>, std::string> oid_dict = {\n";
-    for (pair <string, vector<uint32_t>> x : ordered_dict) {
-        cout << "\t{ " << oid_to_hex_array(x.second) << ", \"" <<  x.first << "\" },\n";
-    }
-    cout << "};\n";
-}
-
 void oid_set::dump_oid_enum_dict_sorted() {
     using namespace std;
 
@@ -556,12 +538,13 @@ void oid_set::dump_oid_enum_dict_sorted() {
     vector<pair<string, vector<uint32_t>>> ordered_dict(oid_dict.begin(), oid_dict.end());
     sort(ordered_dict.begin(), ordered_dict.end(), pair_cmp());
 
-    cout << "std::unordered_map<std::basic_string<uint8_t>, std::string> oid_dict = {\n";
-    for (pair <string, vector<uint32_t>> x : ordered_dict) {
-        cout << "\t{ " << oid_to_hex_array(x.second) << ", \"" <<  x.first << "\" },\n";
-    }
-    cout << "};\n";
-
+    /*
+     * only the enum and the perfect hash are emitted; the
+     * unordered_map dictionaries that used to precede them had no
+     * remaining readers (lookups go through oid_ph_lookup(), asn1.h)
+     * but were still heap-constructed at static initialization time
+     * in every process, whether or not --certs-json was in use
+     */
     cout << "enum oid {\n";
     unsigned int oid_num = 0;
     cout << "\t" << "unknown" << " = " <<  oid_num++ << ",\n";
@@ -586,13 +569,139 @@ void oid_set::dump_oid_enum_dict_sorted() {
     }
     cout << "};\n";
 
-    cout << "std::unordered_map<std::basic_string<uint8_t>, enum oid> oid_to_enum = {\n";
-    for (pair <string, vector<uint32_t>> x : ordered_dict) {
+}
+
+/*
+ * dump_perfect_hash() emits a perfect hash over the raw DER encodings
+ * of the OIDs in the dictionary, built with the compress-hash-displace
+ * construction: a first (unseeded) hash assigns each OID to a bucket,
+ * and for each bucket we search for a displacement value that, used as
+ * the seed of a second hash, places every OID in the bucket into an
+ * empty slot of the entry table.  A lookup is then two hashes of the
+ * raw bytes and a single table probe; see oid_ph_lookup() in asn1.h
+ */
+
+static uint32_t oid_ph_hash(uint32_t seed, const std::vector<uint8_t> &data) {
+    uint32_t h = seed ^ 0x811c9dc5;
+    for (uint8_t x : data) {
+        h = (h ^ x) * 0x01000193;
+    }
+    return h;
+}
+
+void oid_set::dump_perfect_hash() {
+    using namespace std;
+
+    struct pair_cmp {
+        inline bool operator() (const pair<string, vector<uint32_t>> &s1, const pair<string, vector<uint32_t>> &s2) {
+            return (s1.second < s2.second);
+        }
+    };
+    vector<pair<string, vector<uint32_t>>> ordered_dict(oid_dict.begin(), oid_dict.end());
+    sort(ordered_dict.begin(), ordered_dict.end(), pair_cmp());
+
+    constexpr uint32_t bucket_count = 128;
+    constexpr uint32_t table_length = 1024;
+
+    vector<vector<uint8_t>> raw;       // DER encoding of each OID
+    for (pair <string, vector<uint32_t>> &x : ordered_dict) {
+        raw.push_back(oid_to_raw_string(x.second));
+    }
+
+    vector<vector<size_t>> buckets(bucket_count);
+    for (size_t i = 0; i < raw.size(); i++) {
+        buckets[oid_ph_hash(0, raw[i]) & (bucket_count-1)].push_back(i);
+    }
+
+    // process buckets largest first, so that the crowded ones get
+    // first pick of the empty slots
+    //
+    vector<size_t> bucket_order(bucket_count);
+    for (size_t b = 0; b < bucket_count; b++) {
+        bucket_order[b] = b;
+    }
+    sort(bucket_order.begin(), bucket_order.end(),
+         [&buckets](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+    vector<uint32_t> displace(bucket_count, 0);
+    vector<ssize_t> table(table_length, -1);
+    for (size_t b : bucket_order) {
+        if (buckets[b].empty()) {
+            continue;
+        }
+        for (uint32_t d = 1; ; d++) {
+            if (d > (1 << 20)) {
+                cerr << "error: could not find a displacement for bucket " << b << "\n";
+                throw "perfect hash construction failure";
+            }
+            vector<uint32_t> slots;
+            for (size_t i : buckets[b]) {
+                slots.push_back(oid_ph_hash(d, raw[i]) & (table_length-1));
+            }
+            vector<uint32_t> sorted_slots(slots);
+            sort(sorted_slots.begin(), sorted_slots.end());
+            bool ok = (adjacent_find(sorted_slots.begin(), sorted_slots.end()) == sorted_slots.end());
+            for (uint32_t s : slots) {
+                ok = ok && (table[s] == -1);
+            }
+            if (ok) {
+                for (size_t j = 0; j < slots.size(); j++) {
+                    table[slots[j]] = buckets[b][j];
+                }
+                displace[b] = d;
+                break;
+            }
+        }
+    }
+
+    cout << "\n"
+        "/*\n"
+        " * perfect hash over the raw DER encodings of the OIDs above,\n"
+        " * built with the compress-hash-displace construction: the first\n"
+        " * hash picks a bucket, whose displacement value seeds the hash\n"
+        " * that picks the slot, so a lookup is two hashes of the raw bytes\n"
+        " * and a single table probe, with no per-component decoding\n"
+        " */\n";
+    cout << "#define OID_PH_BUCKET_COUNT " << bucket_count << "\n";
+    cout << "#define OID_PH_TABLE_LENGTH " << table_length << "\n\n";
+
+    cout << "static const uint32_t oid_ph_displace[OID_PH_BUCKET_COUNT] = {\n";
+    for (size_t b = 0; b < bucket_count; b++) {
+        if ((b % 16) == 0) {
+            cout << "\t";
+        }
+        cout << displace[b] << ",";
+        if ((b % 16) == 15) {
+            cout << "\n";
+        }
+    }
+    cout << "};\n\n";
+
+    cout << "struct oid_ph_entry {\n"
+        "    const uint8_t *bytes;    /* raw DER encoding, or NULL in an empty slot */\n"
+        "    uint8_t length;\n"
+        "    enum oid id;\n"
+        "    const char *name;\n"
+        "};\n\n";
+
+    cout << "static const struct oid_ph_entry oid_ph_table[OID_PH_TABLE_LENGTH] = {\n";
+    char hex[8];
+    for (size_t s = 0; s < table_length; s++) {
+        if (table[s] == -1) {
+            cout << "\t{ NULL, 0, unknown, NULL },\n";
+            continue;
+        }
+        pair<string, vector<uint32_t>> &x = ordered_dict[table[s]];
         std::string tmp_string(x.first);
         std::replace(tmp_string.begin(), tmp_string.end(), '-', '_');
         std::replace(tmp_string.begin(), tmp_string.end(), '[', '_');
         std::replace(tmp_string.begin(), tmp_string.end(), ']', '_');
-        cout << "\t{ " << oid_to_hex_array(x.second) << ", " <<  tmp_string << " },\n";
+        cout << "\t{ (const uint8_t *)\"";
+        for (uint8_t byte : raw[table[s]]) {
+            snprintf(hex, sizeof(hex), "\\x%02x", byte);
+            cout << hex;
+        }
+        cout << "\", " << raw[table[s]].size() << ", " << tmp_string << ", \"" << x.first << "\" },\n";
     }
     cout << "};\n";
 }
@@ -722,6 +831,7 @@ int main(int argc, char *argv[]) {
 
     oid_set.remove_nonterminals();
     oid_set.dump_oid_enum_dict_sorted();
+    oid_set.dump_perfect_hash();
     // oid_set.verify_oid_dict();
 
     //    for (auto &x : oid_set.keyword_dict) {
@@ -8,6 +8,7 @@
 
 #include <stdio.h>
 #include <unordered_set>
+#include <unordered_map>
 #include <list>
 #include "bytestring.h"
 #include "oid.h"    // oid dictionary
@@ -779,8 +780,14 @@ struct validity {
     validity() : sequence{}, notBefore{}, notAfter{} {
         //        parse(p);
     }
-    void parse(struct datum *p) {
+    void parse(struct datum *p, bool lazy=false) {
         sequence.parse(p, tlv::SEQUENCE, "validity.sequence");
+        if (lazy) {
+            return;  // the extent is recorded; decode_fields() decodes it on demand
+        }
+        decode_fields();
+    }
+    void decode_fields() {
         notBefore.parse(&sequence.value, 0, "validity.notBefore"); // tlv::UTCTime or tlv::GeneralizedTime
         notAfter.parse(&sequence.value, 0, "validity.notAfter");   // tlv::UTCTime or tlv::GeneralizedTime
     }
@@ -1277,8 +1284,14 @@ struct algorithm_identifier {
     explicit algorithm_identifier(struct datum *p) : sequence{}, algorithm{}, parameters{} {
         parse(p);
     }
-    void parse(struct datum *p) {
+    void parse(struct datum *p, bool lazy=false) {
         sequence.parse(p, tlv::SEQUENCE);
+        if (lazy) {
+            return;  // the extent is recorded; decode_fields() decodes it on demand
+        }
+        decode_fields();
+    }
+    void decode_fields() {
         algorithm.parse(&sequence.value, tlv::OBJECT_IDENTIFIER);
         if (sequence.value.is_not_empty()) {
             null.parse(&sequence.value, tlv::NULL_TAG);
@@ -1343,15 +1356,19 @@ struct subject_public_key_info {
     struct tlv subject_public_key;
     bool complete;
 
-    subject_public_key_info() : sequence{}, algorithm{}, subject_public_key{} {}
+    subject_public_key_info() : sequence{}, algorithm{}, subject_public_key{}, complete{false} {}
     explicit subject_public_key_info(struct datum *p) : sequence{}, algorithm{}, subject_public_key{}, complete{false} {
         parse(p);
     }
-    void parse(struct datum *p) {
+    void parse(struct datum *p, bool lazy=false) {
         sequence.parse(p);
-        if (sequence.is_complete()) {
-            complete = true;
+        complete = sequence.is_complete();
+        if (lazy) {
+            return;  // the extent is recorded; decode_fields() decodes it on demand
         }
+        decode_fields();
+    }
+    void decode_fields() {
         algorithm.parse(&sequence.value);
         subject_public_key.parse(&sequence.value, tlv::BIT_STRING);
         if (!subject_public_key.is_complete()) {
@@ -1483,6 +1500,7 @@ struct x509_cert {
     struct tlv extensions;
     struct algorithm_identifier signature_algorithm;
     struct tlv signature;
+    bool lazy;                 /* fields are decoded on demand; see get_*() */
 
     x509_cert()
         : certificate{},
@@ -1498,9 +1516,21 @@ struct x509_cert {
           explicitly_tagged_extensions{},
           extensions{},
           signature_algorithm{},
-          signature{} {   }
-
-    void parse(const void *buffer, unsigned int len) {
+          signature{},
+          lazy{false} {   }
+
+    /*
+     * parse(buffer, len, lazy_parse) walks the TLV structure of the
+     * certificate and records where each top-level field lies.  In
+     * the (default) eager mode, the validity, algorithm identifier,
+     * and subject public key structures are decoded during the walk;
+     * in lazy mode only their extents are recorded, and the get_*()
+     * accessors below decode them on demand.  Names and extensions
+     * are decoded at output time in either mode.
+     */
+    void parse(const void *buffer, unsigned int len, bool lazy_parse=false) {
+
+        lazy = lazy_parse;
 
         struct datum p;
         parser_init(&p, (const unsigned char *)buffer, len);
@@ -1527,19 +1557,19 @@ struct x509_cert {
             serial_number.parse(&tbs_certificate.value, tlv::INTEGER, "serial number");
         }
 
-        signature_identifier.parse(&tbs_certificate.value);
+        signature_identifier.parse(&tbs_certificate.value, lazy);
 
         // parse issuer
         issuer.parse(&tbs_certificate.value, "issuer");
 
         // parse validity
-        validity.parse(&tbs_certificate.value);
+        validity.parse(&tbs_certificate.value, lazy);
 
         // parse subject
         subject.parse(&tbs_certificate.value, "subject");
 
         // parse subjectPublicKeyInfo
-        subjectPublicKeyInfo.parse(&tbs_certificate.value);
+        subjectPublicKeyInfo.parse(&tbs_certificate.value, lazy);
 
         if (tbs_certificate.value.is_not_empty() == false) {
             return;    // optional extensions are not present
@@ -1563,11 +1593,39 @@ struct x509_cert {
             //            tmp_tlv.fprint_tlv(stderr, "tbs_certificate trailing data");
         }
 
-        signature_algorithm.parse(&certificate.value);
+        signature_algorithm.parse(&certificate.value, lazy);
         signature.parse(&certificate.value, tlv::BIT_STRING, "signature");
 
     }
 
+    /*
+     * in lazy mode, the get_*() accessors decode a copy of the
+     * recorded extent on demand; they are what the JSON writers and
+     * the violation checks use, so that a field's decoding cost is
+     * paid only when some output actually wants it.  In eager mode
+     * the copies are already decoded.
+     */
+    struct algorithm_identifier get_signature_identifier() const {
+        struct algorithm_identifier a = signature_identifier;
+        if (lazy) { a.decode_fields(); }
+        return a;
+    }
+    struct validity get_validity() const {
+        struct validity v = validity;
+        if (lazy) { v.decode_fields(); }
+        return v;
+    }
+    struct subject_public_key_info get_subject_public_key_info() const {
+        struct subject_public_key_info s = subjectPublicKeyInfo;
+        if (lazy) { s.decode_fields(); }
+        return s;
+    }
+    struct algorithm_identifier get_signature_algorithm() const {
+        struct algorithm_identifier a = signature_algorithm;
+        if (lazy) { a.decode_fields(); }
+        return a;
+    }
+
     std::string get_json_string() const {
         char buffer[8192*8];
         struct buffer_stream buf(buffer, sizeof(buffer));
@@ -1595,19 +1653,19 @@ struct x509_cert {
             serial_number.print_as_json_hex(o, "serial_number");
         }
         if (!signature_identifier.sequence.is_null()) {
-            signature_identifier.print_as_json(o, "signature_identifier");
+            get_signature_identifier().print_as_json(o, "signature_identifier");
         }
         if (!issuer.RDNsequence.is_null()) {
             issuer.print_as_json(o, "issuer");
         }
         if (!validity.sequence.is_null()) {
-            validity.print_as_json(o);
+            get_validity().print_as_json(o);
         }
         if (!subject.RDNsequence.is_null()) {
             subject.print_as_json(o, "subject");
         }
         if (!subjectPublicKeyInfo.sequence.is_null()) {
-            subjectPublicKeyInfo.print_as_json(o, "subject_public_key_info");
+            get_subject_public_key_info().print_as_json(o, "subject_public_key_info");
         }
 
         if (!extensions.is_null()) {
@@ -1623,11 +1681,11 @@ struct x509_cert {
         }
 
         if (!signature_algorithm.sequence.is_null()) {
-            signature_algorithm.print_as_json(o, "signature_algorithm");
+            get_signature_algorithm().print_as_json(o, "signature_algorithm");
         }
         if (!signature.value.is_not_readable()) {
 
-            enum oid alg_oid = signature_algorithm.type();
+            enum oid alg_oid = get_signature_algorithm().type();
             if (ecdsa_algorithms.find(alg_oid) != ecdsa_algorithms.end()) {
                 struct tlv tmp_sig = signature;
                 tmp_sig.remove_bitstring_encoding();
@@ -1646,7 +1704,7 @@ struct x509_cert {
     }
 
     unsigned int bits_in_signature() const {
-        enum oid alg_oid = signature_algorithm.type();
+        enum oid alg_oid = get_signature_algorithm().type();
         if (ecdsa_algorithms.find(alg_oid) != ecdsa_algorithms.end()) {
             struct tlv tmp_sig = signature;
             tmp_sig.remove_bitstring_encoding();
@@ -1668,13 +1726,14 @@ struct x509_cert {
     }
 
     bool subject_key_is_weak() const {
-        if (subjectPublicKeyInfo.complete == false) {
+        struct subject_public_key_info spki = get_subject_public_key_info();
+        if (spki.complete == false) {
             return false;  // missing data
         }
 
-        enum oid alg_type = subjectPublicKeyInfo.algorithm.type();
+        enum oid alg_type = spki.algorithm.type();
         if (alg_type == rsaEncryption) {
-            struct tlv tmp_key = subjectPublicKeyInfo.subject_public_key;  // make copy to leave original intact
+            struct tlv tmp_key = spki.subject_public_key;  // make copy to leave original intact
             tmp_key.remove_bitstring_encoding();
             struct rsa_public_key pub_key(&tmp_key.value);
             if (pub_key.bits_in_modulus() < 2048) {
@@ -1684,7 +1743,7 @@ struct x509_cert {
                 return true;
             }
         } else if (alg_type == id_ecPublicKey) {
-            enum oid parameters = subjectPublicKeyInfo.algorithm.get_parameters();
+            enum oid parameters = spki.algorithm.get_parameters();
             std::unordered_set<unsigned int> strong_ec_parameters {
                 oid::prime256v1, // oid::secp256r1
                 oid::secp384r1,
@@ -1694,7 +1753,7 @@ struct x509_cert {
                 return true;
             }
         } else if (alg_type == id_dsa) {
-            if (subjectPublicKeyInfo.subject_public_key.value.bits_in_data() < 2048) {
+            if (spki.subject_public_key.value.bits_in_data() < 2048) {
                 return true;
             }
         } else if (alg_type == id_Ed25519) {
@@ -1708,8 +1767,9 @@ struct x509_cert {
     }
 
     bool signature_is_weak(bool unsigned_is_weak=false) const {
+        struct algorithm_identifier sig_alg = get_signature_algorithm();
 
-        if (signature_algorithm.parameters.is_truncated()) {
+        if (sig_alg.parameters.is_truncated()) {
             fprintf(stdout, "truncated signature_algorithm\n");
             return false;   // missing data
         }
@@ -1720,7 +1780,7 @@ struct x509_cert {
                 { oid::ecdsa_with_SHA1, 256 }
             };
 
-            enum oid alg_oid = signature_algorithm.type();
+            enum oid alg_oid = sig_alg.type();
             std::unordered_map<unsigned int, unsigned int>::const_iterator ecdsa_alg = strong_ecdsa_algs.find(alg_oid);
             if (ecdsa_alg != strong_ecdsa_algs.end()) {
 
@@ -1777,14 +1837,16 @@ struct x509_cert {
     }
 
     bool is_nonconformant() const {
-        if (signature_algorithm.algorithm.is_null() || signature_identifier.algorithm.is_null()) {
+        struct algorithm_identifier sig_alg = get_signature_algorithm();
+        struct algorithm_identifier sig_id = get_signature_identifier();
+        if (sig_alg.algorithm.is_null() || sig_id.algorithm.is_null()) {
             return false;  // missing data
         }
-        if (signature_algorithm.algorithm.is_truncated() || signature_identifier.algorithm.is_truncated()) {
+        if (sig_alg.algorithm.is_truncated() || sig_id.algorithm.is_truncated()) {
             return false;  // missing data
         }
-        enum oid sig_alg_type = signature_algorithm.type();
-        enum oid tbs_sig_alg_type = signature_identifier.type();
+        enum oid sig_alg_type = sig_alg.type();
+        enum oid tbs_sig_alg_type = sig_id.type();
         if (sig_alg_type != tbs_sig_alg_type) {
             if (sig_alg_type == oid::unknown) {
                 return false;  // assume missing data (TBD: ?)
@@ -1803,7 +1865,7 @@ struct x509_cert {
             return true;  // error: can't get current time
         }
 
-        return !validity.contains(time_str, sizeof(time_str));
+        return !get_validity().contains(time_str, sizeof(time_str));
     }
 
     bool is_trusted(const std::list<struct x509_cert> &trusted_certs) const {
@@ -1820,7 +1882,7 @@ struct x509_cert {
 
     void report_key_group(struct json_object_asn1 &o, struct dictionary *d) const {
         if (d) {
-            std::basic_string<uint8_t> s = subjectPublicKeyInfo.subject_public_key.value.get_bytestring();
+            std::basic_string<uint8_t> s = get_subject_public_key_info().subject_public_key.value.get_bytestring();
             unsigned int g = d->get(s);
             o.print_key_uint("key_group", g);
         }
@@ -1869,19 +1931,19 @@ struct x509_cert {
             serial_number.print_as_json_hex(o, "serial_number");
         }
         if (!signature_identifier.sequence.is_null()) {
-            signature_identifier.print_as_json(o, "signature_identifier");
+            get_signature_identifier().print_as_json(o, "signature_identifier");
         }
         if (!issuer.RDNsequence.is_null()) {
             issuer.print_as_json(o, "issuer");
         }
         if (!validity.sequence.is_null()) {
-            validity.print_as_json(o);
+            get_validity().print_as_json(o);
         }
         if (!subject.RDNsequence.is_null()) {
             subject.print_as_json(o, "subject");
         }
         if (!subjectPublicKeyInfo.sequence.is_null()) {
-            subjectPublicKeyInfo.print_as_json(o, "subject_public_key_info");
+            get_subject_public_key_info().print_as_json(o, "subject_public_key_info");
         }
 
         if (!extensions.is_null()) {
@@ -1897,11 +1959,11 @@ struct x509_cert {
         }
 
         if (!signature_algorithm.sequence.is_null()) {
-            signature_algorithm.print_as_json(o, "signature_algorithm");
+            get_signature_algorithm().print_as_json(o, "signature_algorithm");
         }
         if (!signature.is_null()) {
 
-            enum oid alg_oid = signature_algorithm.type();
+            enum oid alg_oid = get_signature_algorithm().type();
             if (ecdsa_algorithms.find(alg_oid) != ecdsa_algorithms.end()) {
                 struct tlv tmp_sig = signature;
                 tmp_sig.remove_bitstring_encoding();
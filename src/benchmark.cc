@@ -0,0 +1,170 @@
+/*
+ * benchmark.cc
+ *
+ * parser microbenchmark: feeds canned packets from pcap files through
+ * the same packet filter / extractor path that the live capture path
+ * uses, in a tight loop, and reports ns/packet and cycles/byte for
+ * each protocol observed in each file, as JSON records suitable for
+ * automated comparison
+ *
+ * usage: benchmark [--loops <num>] <file> [<file2> ... ]
+ *
+ * The packets of each input file are loaded into memory, classified
+ * by message type with one pass through the extractor, and then each
+ * protocol's packets are run through packet_filter_extract() for the
+ * requested number of iterations (default 1000) under the monotonic
+ * clock and the timestamp counter.
+ *
+ * build with "make benchmark"
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "extractor.h"
+#include "pcap_file_io.h"
+#include "pkt_proc.h"
+
+/*
+ * cycle counter; reads the timestamp counter on x86, and reports
+ * zero cycles/byte on other architectures
+ */
+#if defined(__x86_64__) || defined(__i386__)
+static inline uint64_t read_cycle_counter() {
+    return __builtin_ia32_rdtsc();
+}
+#else
+static inline uint64_t read_cycle_counter() {
+    return 0;
+}
+#endif
+
+static inline uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* a packet loaded from a pcap file, stored in the corpus buffer */
+struct benchmark_packet {
+    size_t offset;
+    size_t length;
+};
+
+/*
+ * benchmark_file(filename, loops) loads the packets of a pcap file,
+ * classifies each by message type, and reports one JSON record per
+ * message type with the packet rate and byte rate of the extractor
+ * over those packets
+ */
+static int benchmark_file(const char *filename, unsigned int loops) {
+
+    struct pcap_file f;
+    if (pcap_file_open(&f, filename, io_direction_reader, 0) != status_ok) {
+        fprintf(stderr, "error: could not open pcap file %s\n", filename);
+        return -1;
+    }
+
+    std::vector<uint8_t> corpus;
+    std::vector<struct benchmark_packet> packets;
+    uint8_t packet_data[65536];
+    struct pcap_pkthdr pkthdr;
+    while (pcap_file_read_packet(&f, &pkthdr, packet_data) == status_ok) {
+        struct benchmark_packet p;
+        p.offset = corpus.size();
+        p.length = pkthdr.caplen;
+        corpus.insert(corpus.end(), packet_data, packet_data + pkthdr.caplen);
+        packets.push_back(p);
+    }
+    pcap_file_close(&f);
+
+    struct packet_filter pf;
+    if (packet_filter_init(&pf, NULL) != status_ok) {
+        fprintf(stderr, "error: could not initialize packet filter\n");
+        return -1;
+    }
+
+    /* classify each packet by message type, using one pass through
+     * the extractor; the map key keeps the output ordered by type */
+    std::map<enum msg_type, std::vector<size_t>> protocols;
+    struct key k;
+    for (size_t i = 0; i < packets.size(); i++) {
+        packet_filter_extract(&pf, &k, corpus.data() + packets[i].offset, packets[i].length);
+        protocols[pf.x.msg_type].push_back(i);
+    }
+
+    for (const auto &protocol : protocols) {
+        const std::vector<size_t> &index = protocol.second;
+
+        size_t bytes = 0;
+        for (size_t i : index) {
+            bytes += packets[i].length;
+        }
+
+        /* one untimed pass to warm caches and branch predictors */
+        volatile size_t sink = 0;
+        for (size_t i : index) {
+            sink += packet_filter_extract(&pf, &k, corpus.data() + packets[i].offset, packets[i].length);
+        }
+
+        uint64_t start_ns = monotonic_ns();
+        uint64_t start_cycles = read_cycle_counter();
+        for (unsigned int loop = 0; loop < loops; loop++) {
+            for (size_t i : index) {
+                sink += packet_filter_extract(&pf, &k, corpus.data() + packets[i].offset, packets[i].length);
+            }
+        }
+        uint64_t cycles = read_cycle_counter() - start_cycles;
+        uint64_t ns = monotonic_ns() - start_ns;
+
+        uint64_t packets_processed = (uint64_t)index.size() * loops;
+        uint64_t bytes_processed = (uint64_t)bytes * loops;
+        fprintf(stdout,
+                "{\"benchmark\":{\"file\":\"%s\",\"protocol\":\"%s\",\"packets\":%zu,\"bytes\":%zu,"
+                "\"iterations\":%u,\"ns_per_packet\":%.2f,\"cycles_per_byte\":%.3f}}\n",
+                filename,
+                msg_type_string(protocol.first),
+                index.size(),
+                bytes,
+                loops,
+                packets_processed ? (double)ns / packets_processed : 0.0,
+                bytes_processed ? (double)cycles / bytes_processed : 0.0);
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+
+    unsigned int loops = 1000;
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "--loops") == 0) {
+        if (arg + 1 >= argc) {
+            fprintf(stderr, "error: option 'loops' needs an argument\n");
+            return EXIT_FAILURE;
+        }
+        loops = atoi(argv[arg+1]);
+        if (loops == 0) {
+            fprintf(stderr, "error: option 'loops' needs a positive argument\n");
+            return EXIT_FAILURE;
+        }
+        arg += 2;
+    }
+    if (arg >= argc) {
+        fprintf(stderr, "usage: %s [--loops <num>] <file> [<file2> ... ]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int retval = EXIT_SUCCESS;
+    for (; arg < argc; arg++) {
+        if (benchmark_file(argv[arg], loops) < 0) {
+            retval = EXIT_FAILURE;
+        }
+    }
+    return retval;
+}
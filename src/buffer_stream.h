@@ -160,6 +160,71 @@ static char hex_table[] = {'0', '1', '2', '3',
                            '8', '9', 'a', 'b',
                            'c', 'd', 'e', 'f'};
 
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_SIMD_HEX 1
+#include <immintrin.h>
+
+/*
+ * Vectorized nibble-to-hex conversion, using pshufb as a sixteen-way
+ * table lookup into "0123456789abcdef": each iteration splits 16
+ * (SSSE3) or 32 (AVX2) input bytes into high and low nibbles, looks
+ * both up in one shuffle each, and interleaves the results.  The
+ * variant is chosen at runtime, so a generic build still gets it.
+ */
+
+__attribute__((target("ssse3")))
+static inline void hex_encode_ssse3(const uint8_t *data, unsigned int blocks, char *out) {
+    const __m128i table = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                        '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+
+    for (unsigned int b = 0; b < blocks; b++) {
+        __m128i in = _mm_loadu_si128((const __m128i *)(data + b * 16));
+        __m128i hi = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(in, 4), nibble));
+        __m128i lo = _mm_shuffle_epi8(table, _mm_and_si128(in, nibble));
+        _mm_storeu_si128((__m128i *)(out + b * 32),      _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i *)(out + b * 32 + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+}
+
+__attribute__((target("avx2")))
+static inline void hex_encode_avx2(const uint8_t *data, unsigned int blocks, char *out) {
+    const __m256i table = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                           '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+                                           '0', '1', '2', '3', '4', '5', '6', '7',
+                                           '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+
+    for (unsigned int b = 0; b < blocks; b++) {
+        __m256i in = _mm256_loadu_si256((const __m256i *)(data + b * 32));
+        __m256i hi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(in, 4), nibble));
+        __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(in, nibble));
+        /* the unpacks interleave within each 128-bit lane, so a
+         * cross-lane permute restores the byte order */
+        __m256i t0 = _mm256_unpacklo_epi8(hi, lo);
+        __m256i t1 = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256((__m256i *)(out + b * 64),      _mm256_permute2x128_si256(t0, t1, 0x20));
+        _mm256_storeu_si256((__m256i *)(out + b * 64 + 32), _mm256_permute2x128_si256(t0, t1, 0x31));
+    }
+}
+
+/* returns 2 for AVX2, 1 for SSSE3, 0 for scalar; probed only once */
+static inline int hex_encode_simd_level() {
+    static int level = -1;
+    if (level < 0) {
+        if (__builtin_cpu_supports("avx2")) {
+            level = 2;
+        } else if (__builtin_cpu_supports("ssse3")) {
+            level = 1;
+        } else {
+            level = 0;
+        }
+    }
+    return level;
+}
+
+#endif /* __x86_64__ || __i386__ */
+
 static inline int append_raw_as_hex(char *dstr, int *doff, int dlen, int *trunc,
                                     const uint8_t *data, unsigned int len) {
 
@@ -169,24 +234,37 @@ static inline int append_raw_as_hex(char *dstr, int *doff, int dlen, int *trunc,
 
     int r = 0;
     char outb[256]; /* A local buffer of up to 256 hex chars at a time */
-    int oi = 0;    /* The index into the output buffer */
-
-    for (unsigned int i = 0; (i < len) && (*trunc == 0); i++) {
-        outb[oi]     = hex_table[(data[i] & 0xf0) >> 4];
-        outb[oi + 1] = hex_table[data[i] & 0x0f];
+    unsigned int i = 0;
+#ifdef HAVE_SIMD_HEX
+    int level = hex_encode_simd_level();
+#endif
 
-        if (oi < 254) {
+    while ((i < len) && (*trunc == 0)) {
+        unsigned int chunk = len - i;   /* input bytes converted this round */
+        if (chunk > 128) {
+            chunk = 128;
+        }
+        unsigned int j = 0;   /* input bytes already converted */
+        unsigned int oi = 0;  /* The index into the output buffer */
+
+#ifdef HAVE_SIMD_HEX
+        if (level == 2) {
+            hex_encode_avx2(data + i, chunk / 32, outb);
+            j = (chunk / 32) * 32;
+        } else if (level == 1) {
+            hex_encode_ssse3(data + i, chunk / 16, outb);
+            j = (chunk / 16) * 16;
+        }
+        oi = j * 2;
+#endif
+        for ( ; j < chunk; j++) {
+            outb[oi]     = hex_table[(data[i + j] & 0xf0) >> 4];
+            outb[oi + 1] = hex_table[data[i + j] & 0x0f];
             oi += 2;
-        } else {
-            r += append_memcpy(dstr, doff, dlen, trunc,
-                               outb, 256);
-            oi = 0;
         }
-    }
-
-    if (oi > 0) {
         r += append_memcpy(dstr, doff, dlen, trunc,
                            outb, oi);
+        i += chunk;
     }
 
     return r;
@@ -238,30 +316,45 @@ static inline int append_timestamp(char *dstr, int *doff, int dlen, int *trunc,
         return 0;
     }
 
-    int r = 0;
-    char outs[10 + 1 + 6]; /* 10 sec digits, 1 decimal, 6 usec */
-
-    /* First we convert the seconds to a string which requires
-     * that we identify and skip leading zeros */
-    int i = 0; /* outs index */
-    int leadin = 1; /* We're still getting leading zeros */
-
-    uint64_t secs = ts->tv_sec;
-    for (int p = 1000000000; p >= 10; p /= 10) {
-        int d = secs / p;
-        secs %= p;
+    /* Thousands of consecutive records share the same second, so the
+     * formatted seconds digits are cached per thread, keyed on
+     * tv_sec; only the sub-second part is formatted per record */
+    static thread_local time_t cached_sec = -1;
+    static thread_local char cached_digits[10];
+    static thread_local int cached_len = 0;
+
+    if (ts->tv_sec != cached_sec) {
+        /* Convert the seconds to a string which requires that we
+         * identify and skip leading zeros */
+        int ci = 0; /* cached_digits index */
+        int leadin = 1; /* We're still getting leading zeros */
+
+        uint64_t secs = ts->tv_sec;
+        for (int p = 1000000000; p >= 10; p /= 10) {
+            int d = secs / p;
+            secs %= p;
+
+            if ((d == 0) && (leadin == 1)) {
+                continue;
+            }
 
-        if ((d == 0) && (leadin == 1)) {
-            continue;
+            leadin = 0;
+            cached_digits[ci] = '0' + d;
+            ci++;
         }
+        /* Store the final digit which can be 0 */
+        cached_digits[ci] = '0' + secs;
+        ci++;
 
-        leadin = 0;
-        outs[i] = '0' + d;
-        i++;
+        cached_len = ci;
+        cached_sec = ts->tv_sec;
     }
-    /* Store the final digit which can be 0 */
-    outs[i] = '0' + secs;
-    i++;
+
+    int r = 0;
+    char outs[10 + 1 + 6]; /* 10 sec digits, 1 decimal, 6 usec */
+
+    memcpy(outs, cached_digits, cached_len);
+    int i = cached_len; /* outs index */
 
     /* Now store the decimal point */
     outs[i] = '.';
@@ -356,6 +449,91 @@ static inline int append_uint16(char *dstr, int *doff, int dlen, int *trunc,
 }
 
 
+/*
+ * append_uint() writes the decimal representation of an unsigned
+ * integer of any width, digits computed back to front; it extends the
+ * hand-rolled pattern of append_uint8/16 and append_timestamp to all
+ * numeric fields, avoiding the vsnprintf() format-parsing cost that
+ * dominates serialization of ports and lengths
+ */
+static inline int append_uint(char *dstr, int *doff, int dlen, int *trunc,
+                              uint64_t n) {
+
+    if (*trunc == 1) {
+        return 0;
+    }
+
+    char outs[20]; /* "18446744073709551615" is the longest uint64_t */
+    int i = sizeof(outs);
+
+    do {
+        outs[--i] = '0' + (n % 10);
+        n /= 10;
+    } while (n > 0);
+
+    return append_memcpy(dstr, doff, dlen, trunc,
+                         outs + i, sizeof(outs) - i);
+}
+
+static inline int append_int(char *dstr, int *doff, int dlen, int *trunc,
+                             int64_t n) {
+
+    if (*trunc == 1) {
+        return 0;
+    }
+
+    int r = 0;
+    uint64_t u = n;
+
+    if (n < 0) {
+        r += append_putc(dstr, doff, dlen, trunc, '-');
+        u = -u;
+    }
+    return r + append_uint(dstr, doff, dlen, trunc, u);
+}
+
+/*
+ * append_double() matches the "%f" formatting it replaces: six
+ * fractional digits, always present.  Values too big for the fast
+ * integer path, and non-finite values, fall back to snprintf().
+ */
+static inline int append_double(char *dstr, int *doff, int dlen, int *trunc,
+                                double d) {
+
+    if (*trunc == 1) {
+        return 0;
+    }
+
+    if (!(d >= -1e15 && d <= 1e15)) {   /* also catches NaN */
+        return append_snprintf(dstr, doff, dlen, trunc, "%f", d);
+    }
+
+    int r = 0;
+    if (d < 0) {
+        r += append_putc(dstr, doff, dlen, trunc, '-');
+        d = -d;
+    }
+
+    uint64_t whole = (uint64_t)d;
+    uint64_t frac = (uint64_t)((d - (double)whole) * 1000000.0 + 0.5);
+    if (frac >= 1000000) {   /* the fraction rounded up to 1.0 */
+        frac = 0;
+        whole++;
+    }
+    r += append_uint(dstr, doff, dlen, trunc, whole);
+    r += append_putc(dstr, doff, dlen, trunc, '.');
+
+    char outs[6];
+    for (int p = 5; p >= 0; p--) {
+        outs[p] = '0' + (frac % 10);
+        frac /= 10;
+    }
+    r += append_memcpy(dstr, doff, dlen, trunc, outs, sizeof(outs));
+
+    return r;
+}
+
+
 static inline int append_uint16_hex(char *dstr, int *doff, int dlen, int *trunc,
                                     uint16_t n) {
 
@@ -463,6 +641,55 @@ static inline int append_ipv4_addr(char *dstr, int *doff, int dlen, int *trunc,
 }
 
 
+#ifdef HAVE_SIMD_HEX
+
+/*
+ * Escapable-byte scan for JSON strings: a chunk is clean if every
+ * byte is printable ASCII (0x20-0x7f) and neither '"' nor '\\'.
+ * User-agents and DNS names are long and almost always clean, so
+ * scanning a whole chunk and bulk-copying a run of clean ones beats
+ * the per-byte loop; dirty chunks fall back to that loop.  The
+ * signed compare against 0x1f excludes 0x80-0xff along with the
+ * control characters.
+ */
+
+__attribute__((target("sse2")))
+static inline int json_clean_chunk16(const uint8_t *data) {
+    __m128i in = _mm_loadu_si128((const __m128i *)data);
+    __m128i printable = _mm_cmpgt_epi8(in, _mm_set1_epi8(0x1f));
+    __m128i quote  = _mm_cmpeq_epi8(in, _mm_set1_epi8('"'));
+    __m128i bslash = _mm_cmpeq_epi8(in, _mm_set1_epi8('\\'));
+    __m128i clean = _mm_andnot_si128(_mm_or_si128(quote, bslash), printable);
+    return _mm_movemask_epi8(clean) == 0xffff;
+}
+
+__attribute__((target("avx2")))
+static inline int json_clean_chunk32(const uint8_t *data) {
+    __m256i in = _mm256_loadu_si256((const __m256i *)data);
+    __m256i printable = _mm256_cmpgt_epi8(in, _mm256_set1_epi8(0x1f));
+    __m256i quote  = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('"'));
+    __m256i bslash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('\\'));
+    __m256i clean = _mm256_andnot_si256(_mm256_or_si256(quote, bslash), printable);
+    return (uint32_t)_mm256_movemask_epi8(clean) == 0xffffffffUL;
+}
+
+/* returns 2 for AVX2, 1 for SSE2, 0 for scalar; probed only once */
+static inline int json_escape_simd_level() {
+    static int level = -1;
+    if (level < 0) {
+        if (__builtin_cpu_supports("avx2")) {
+            level = 2;
+        } else if (__builtin_cpu_supports("sse2")) {
+            level = 1;
+        } else {
+            level = 0;
+        }
+    }
+    return level;
+}
+
+#endif /* HAVE_SIMD_HEX */
+
 static inline int append_json_string_escaped(char *dstr, int *doff, int dlen, int *trunc,
                                              const char *key, const uint8_t *data, unsigned int len) {
 
@@ -476,22 +703,54 @@ static inline int append_json_string_escaped(char *dstr, int *doff, int dlen, in
     r += append_strncpy(dstr, doff, dlen, trunc, key);
     r += append_strncpy(dstr, doff, dlen, trunc, "\":\"");
 
-    for (unsigned int i = 0; (i < len) && (*trunc == 0); i++) {
-        if ((data[i] < 0x20) || /* escape control characters   */
-            (data[i] > 0x7f)) { /* escape non-ASCII characters */
-            r += append_strncpy(dstr, doff, dlen, trunc,
-                                "\\u00");
-            r += append_putc(dstr, doff, dlen, trunc,
-                             hex_table[(data[i] & 0xf0) >> 4]);
-            r += append_putc(dstr, doff, dlen, trunc,
-                             hex_table[data[i] & 0x0f]);
-        } else {
-            if (data[i] == '"' || data[i] == '\\') { /* escape special characters   */
+    unsigned int i = 0;
+#ifdef HAVE_SIMD_HEX
+    int level = json_escape_simd_level();
+#endif
+
+    while ((i < len) && (*trunc == 0)) {
+
+#ifdef HAVE_SIMD_HEX
+        /* bulk-copy a run of chunks with nothing to escape */
+        unsigned int run = i;
+        if (level == 2) {
+            while ((run + 32 <= len) && json_clean_chunk32(data + run)) {
+                run += 32;
+            }
+        } else if (level == 1) {
+            while ((run + 16 <= len) && json_clean_chunk16(data + run)) {
+                run += 16;
+            }
+        }
+        if (run > i) {
+            r += append_memcpy(dstr, doff, dlen, trunc,
+                               data + i, run - i);
+            i = run;
+            continue;
+        }
+#endif
+        /* per-byte escaping for a dirty chunk or the tail */
+        unsigned int stop = i + 16;
+        if (stop > len) {
+            stop = len;
+        }
+        for ( ; (i < stop) && (*trunc == 0); i++) {
+            if ((data[i] < 0x20) || /* escape control characters   */
+                (data[i] > 0x7f)) { /* escape non-ASCII characters */
+                r += append_strncpy(dstr, doff, dlen, trunc,
+                                    "\\u00");
                 r += append_putc(dstr, doff, dlen, trunc,
-                                 '\\');
+                                 hex_table[(data[i] & 0xf0) >> 4]);
+                r += append_putc(dstr, doff, dlen, trunc,
+                                 hex_table[data[i] & 0x0f]);
+            } else {
+                if (data[i] == '"' || data[i] == '\\') { /* escape special characters   */
+                    r += append_putc(dstr, doff, dlen, trunc,
+                                     '\\');
+                }
+                r += append_putc(dstr, doff, dlen, trunc,
+                                 data[i]);
             }
-            r += append_putc(dstr, doff, dlen, trunc,
-                             data[i]);
         }
     }
 
@@ -545,6 +804,60 @@ static char encoding_table[] = {'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
                                 'w', 'x', 'y', 'z', '0', '1', '2', '3',
                                 '4', '5', '6', '7', '8', '9', '+', '/'};
 
+#ifdef HAVE_SIMD_HEX
+
+/*
+ * Vectorized base64 encoding, following Mula and Lemire ("Faster
+ * Base64 Encoding and Decoding Using AVX2 Instructions"): each call
+ * reads a 32-byte vector, encodes its first 24 bytes, and writes
+ * exactly 32 output characters.  The caller is responsible for
+ * leaving enough slack at the end of the input for the full load.
+ */
+__attribute__((target("avx2")))
+static inline void base64_encode_avx2(const unsigned char *in, unsigned char *out) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)in);
+
+    /* place the two twelve-byte halves of the payload into separate
+     * lanes, each preceded by four don't-care bytes, so that the
+     * in-lane shuffle below can use the same indices for both */
+    v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 0, 1, 2, 3, 3, 4, 5));
+
+    /* spread each three-byte group over four bytes, duplicating the
+     * middle byte, so that the mask-and-multiply steps can slice out
+     * the four six-bit fields */
+    const __m256i t = _mm256_shuffle_epi8(v, _mm256_set_epi8(
+        14, 15, 13, 14, 11, 12, 10, 11,  8,  9,  7,  8,  5,  6,  4,  5,
+        14, 15, 13, 14, 11, 12, 10, 11,  8,  9,  7,  8,  5,  6,  4,  5));
+    const __m256i t0 = _mm256_and_si256(t, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(t, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    const __m256i indices = _mm256_or_si256(t1, t3);
+
+    /* map each six-bit index to its alphabet character by adding a
+     * per-range offset found with a shuffle; the saturating
+     * subtraction collapses each alphabet range onto one lut slot */
+    const __m256i lut = _mm256_setr_epi8(
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+    __m256i offset_idx = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    const __m256i gt25 = _mm256_cmpgt_epi8(indices, _mm256_set1_epi8(25));
+    offset_idx = _mm256_sub_epi8(offset_idx, gt25);
+
+    _mm256_storeu_si256((__m256i *)out,
+                        _mm256_add_epi8(indices, _mm256_shuffle_epi8(lut, offset_idx)));
+}
+
+/* returns true when the AVX2 path is usable; probed only once */
+static inline bool base64_encode_simd_avx2() {
+    static int level = -1;
+    if (level < 0) {
+        level = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return level == 1;
+}
+
+#endif /* HAVE_SIMD_HEX */
 
 static inline int append_raw_as_base64(char *dstr, int *doff, int dlen, int *trunc,
                                        const unsigned char *data,
@@ -565,6 +878,23 @@ static inline int append_raw_as_base64(char *dstr, int *doff, int dlen, int *tru
 
     r += append_putc(dstr, doff, dlen, trunc,
                 '"');
+
+#ifdef HAVE_SIMD_HEX
+    if (base64_encode_simd_avx2()) {
+        /* eight vector steps of 24 input bytes fill outb exactly; the
+         * loop requires 200 remaining bytes so that the last step's
+         * 32-byte load stays within the input */
+        while ((input_length - i >= 200) && (*trunc == 0)) {
+            for (int b = 0; b < 8; b++) {
+                base64_encode_avx2(data + i + b * 24, (unsigned char *)outb + b * 32);
+            }
+            i += 192;
+            r += append_memcpy(dstr, doff, dlen, trunc,
+                               outb, 256);
+        }
+    }
+#endif
+
     while ((i < len) && (*trunc == 0)) {
 
         oct_a = data[i++];
@@ -705,6 +1035,18 @@ struct buffer_stream {
         append_strncpy(dstr, &doff, dlen, &trunc, sstr);
     }
 
+    /*
+     * write_literal() writes a string literal whose length is known
+     * at compile time, so the copy is one fixed-size memcpy rather
+     * than a byte-at-a-time scan for the terminator; it is the
+     * primitive for emitting the precomputed skeleton of fixed-shape
+     * records
+     */
+    template <size_t N>
+    void write_literal(const char (&lit)[N]) {
+        append_memcpy(dstr, &doff, dlen, &trunc, lit, N - 1);
+    }
+
     void puts(const char *sstr) {
         append_strncpy(dstr, &doff, dlen, &trunc, sstr);
     }
@@ -748,6 +1090,18 @@ struct buffer_stream {
         append_uint8(dstr, &doff, dlen, &trunc, n);
     }
 
+    void write_uint(uint64_t n) {
+        append_uint(dstr, &doff, dlen, &trunc, n);
+    }
+
+    void write_int(int64_t n) {
+        append_int(dstr, &doff, dlen, &trunc, n);
+    }
+
+    void write_double(double d) {
+        append_double(dstr, &doff, dlen, &trunc, d);
+    }
+
     void write_uint16(uint16_t n) {
         append_uint16(dstr, &doff, dlen, &trunc, n);
     }
@@ -0,0 +1,314 @@
+/*
+ * cbor_object.h
+ *
+ * an alternative implementation of the json_object/json_array
+ * interface (see json_object.h) that serializes records as CBOR
+ * (RFC 7049) binary instead of JSON text.  It is selected by
+ * compiling with -DUSE_CBOR_OBJECT ("make use_cbor=yes"), in which
+ * case json_object.h includes this file in place of the JSON text
+ * encoder and every dissector emits CBOR without modification.
+ *
+ * Compared to JSON text, the CBOR encoding avoids string escaping
+ * and hex/base64 expansion entirely: raw fields are written as
+ * length-prefixed byte strings with a single memcpy, and addresses
+ * are 4- or 16-byte strings rather than formatted text.  Objects and
+ * arrays use CBOR's indefinite-length encoding (begin 0xbf/0x9f, end
+ * 0xff), which mirrors the open/close structure of the JSON encoder
+ * and needs no length backpatching.  Each record is one complete
+ * CBOR map, and records written back-to-back form a CBOR sequence
+ * (RFC 8742) that downstream consumers can mmap and scan without a
+ * JSON parser.
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. All rights reserved.
+ * License at https://github.com/cisco/mercury/blob/master/LICENSE
+ */
+#ifndef CBOR_OBJECT_H
+#define CBOR_OBJECT_H
+
+#include "buffer_stream.h"
+
+/*
+ * writes a CBOR "head": the major type and its argument (a length,
+ * an integer value, etc.), using the shortest encoding
+ */
+static inline void cbor_write_head(struct buffer_stream *b, uint8_t major, uint64_t arg) {
+    uint8_t head[9];
+    size_t len;
+
+    major = major << 5;
+    if (arg < 24) {
+        head[0] = major | arg;
+        len = 1;
+    } else if (arg < 256) {
+        head[0] = major | 24;
+        head[1] = arg;
+        len = 2;
+    } else if (arg < 65536) {
+        head[0] = major | 25;
+        head[1] = arg >> 8;
+        head[2] = arg;
+        len = 3;
+    } else if (arg < 4294967296UL) {
+        head[0] = major | 26;
+        head[1] = arg >> 24;
+        head[2] = arg >> 16;
+        head[3] = arg >> 8;
+        head[4] = arg;
+        len = 5;
+    } else {
+        head[0] = major | 27;
+        for (int i = 0; i < 8; i++) {
+            head[1 + i] = arg >> (56 - 8 * i);
+        }
+        len = 9;
+    }
+    b->memcpy(head, len);
+}
+
+/* CBOR major types */
+enum cbor_major {
+    cbor_uint   = 0,
+    cbor_negint = 1,
+    cbor_bytes  = 2,
+    cbor_text   = 3,
+    cbor_array  = 4,
+    cbor_map    = 5,
+    cbor_simple = 7
+};
+
+static inline void cbor_write_text(struct buffer_stream *b, const uint8_t *data, size_t len) {
+    cbor_write_head(b, cbor_text, len);
+    b->memcpy(data, len);
+}
+
+static inline void cbor_write_bytes(struct buffer_stream *b, const uint8_t *data, size_t len) {
+    cbor_write_head(b, cbor_bytes, len);
+    b->memcpy(data, len);
+}
+
+static inline void cbor_write_key(struct buffer_stream *b, const char *k) {
+    cbor_write_text(b, (const uint8_t *)k, strlen(k));
+}
+
+static inline void cbor_write_int(struct buffer_stream *b, long int i) {
+    if (i < 0) {
+        cbor_write_head(b, cbor_negint, -1 - i);
+    } else {
+        cbor_write_head(b, cbor_uint, i);
+    }
+}
+
+/*
+ * json_object and json_array, with the encoding replaced by CBOR;
+ * the comma members are kept (unused) so the interface matches the
+ * JSON text encoder exactly
+ */
+
+struct json_object {
+    buffer_stream *b;
+    bool comma = false;
+    void write_comma(bool &) { }   /* CBOR items need no separator */
+    explicit json_object(struct buffer_stream *buf) : b{buf} {
+        b->write_char('\xbf');     /* begin indefinite-length map */
+    }
+    explicit json_object(struct buffer_stream *buf, const char *name) : b{buf} {
+        cbor_write_key(b, name);
+        b->write_char('\xbf');
+    }
+    json_object(struct json_object &object, const char *name) : b{object.b} {
+        cbor_write_key(b, name);
+        b->write_char('\xbf');
+    }
+    json_object(struct json_object &object) : b{object.b} {
+        b->write_char('\xbf');
+    }
+    explicit json_object(struct json_array &array);
+    void reinit(struct json_array &array);
+    void close() {
+        b->write_char('\xff');     /* end indefinite-length map */
+    }
+    /*
+     * print_raw_members() copies a pre-serialized run of members
+     * (key/value item pairs produced by this encoder) into this
+     * object; items in an indefinite-length map carry no separators,
+     * so the fragment bytes are spliced in as-is.  The fragment must
+     * be well formed CBOR, as no checking is done here.
+     */
+    void print_raw_members(const char *fragment, size_t length) {
+        if (length == 0) {
+            return;
+        }
+        b->memcpy(fragment, length);
+    }
+    void print_key_json_string(const char *k, const uint8_t *v, size_t length) {
+        if (v) {
+            cbor_write_key(b, k);
+            cbor_write_text(b, v, length);   /* no escaping needed */
+        }
+    }
+    void print_key_json_string(const char *k, const struct datum &d) {
+        if (d.is_not_readable()) {
+            return;
+        }
+        cbor_write_key(b, k);
+        cbor_write_text(b, d.data, d.length());
+    }
+    void print_key_string(const char *k, const char *v) {
+        cbor_write_key(b, k);
+        cbor_write_text(b, (const uint8_t *)v, strlen(v));
+    }
+    void print_key_bool(const char *k, bool x) {
+        cbor_write_key(b, k);
+        b->write_char(x ? '\xf5' : '\xf4');
+    }
+    void print_key_null(const char *k) {
+        cbor_write_key(b, k);
+        b->write_char('\xf6');
+    }
+    void print_key_uint8(const char *k, uint8_t u) {
+        cbor_write_key(b, k);
+        cbor_write_head(b, cbor_uint, u);
+    }
+    void print_key_uint16(const char *k, uint16_t u) {
+        cbor_write_key(b, k);
+        cbor_write_head(b, cbor_uint, u);
+    }
+    void print_key_uint(const char *k, unsigned long int u) {
+        cbor_write_key(b, k);
+        cbor_write_head(b, cbor_uint, u);
+    }
+    void print_key_int(const char *k, long int i) {
+        cbor_write_key(b, k);
+        cbor_write_int(b, i);
+    }
+    void print_key_float(const char *k, double d) {
+        cbor_write_key(b, k);
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        uint8_t f[9];
+        f[0] = (7 << 5) | 27;      /* IEEE 754 double */
+        for (int i = 0; i < 8; i++) {
+            f[1 + i] = bits >> (56 - 8 * i);
+        }
+        b->memcpy(f, sizeof(f));
+    }
+    void print_key_hex(const char *k, const struct datum &value) {
+        cbor_write_key(b, k);
+        if (value.data && value.data_end && value.data_end > value.data) {
+            cbor_write_bytes(b, value.data, value.data_end - value.data);
+        } else {
+            cbor_write_head(b, cbor_bytes, 0);
+        }
+    }
+    void print_key_base64(const char *k, const struct datum &value) {
+        cbor_write_key(b, k);
+        if (value.data && value.data_end && value.data_end > value.data) {
+            cbor_write_bytes(b, value.data, value.data_end - value.data);
+        } else {
+            cbor_write_head(b, cbor_bytes, 0);
+        }
+    }
+    void print_key_timestamp(const char *k, struct timespec *ts) {
+        cbor_write_key(b, k);
+        cbor_write_head(b, cbor_array, 2);   /* [ seconds, nanoseconds ] */
+        cbor_write_head(b, cbor_uint, ts->tv_sec);
+        cbor_write_head(b, cbor_uint, ts->tv_nsec);
+    }
+    /*
+     * value writers (fingerprint functors etc.) produce text, which
+     * is captured in a scratch buffer and emitted as a definite-
+     * length text string, keeping the record scannable
+     */
+    template <typename T> void print_key_value(const char *k, T &w) {
+        cbor_write_key(b, k);
+        char tmp[1024];
+        struct buffer_stream tb{tmp, sizeof(tmp)};
+        w(tb);
+        cbor_write_text(b, (const uint8_t *)tmp, tb.length());
+    }
+    void print_key_ipv4_addr(const char *k, const uint8_t *a) {
+        cbor_write_key(b, k);
+        cbor_write_bytes(b, a, 4);
+    }
+    void print_key_ipv6_addr(const char *k, const uint8_t *a) {
+        cbor_write_key(b, k);
+        cbor_write_bytes(b, a, 16);
+    }
+    void print_key_datum(const char *k, const struct datum &d) {
+        cbor_write_key(b, k);
+        b->write_char('\xbf');
+        cbor_write_key(b, "data");
+        cbor_write_head(b, cbor_uint, (uint64_t)d.data);
+        cbor_write_key(b, "data_end");
+        cbor_write_head(b, cbor_uint, (uint64_t)d.data_end);
+        b->write_char('\xff');
+    }
+};
+
+struct json_array {
+    buffer_stream *b;
+    bool comma = false;
+    void write_comma(bool &) { }
+    explicit json_array(struct buffer_stream *buf) : b{buf} {
+        b->write_char('\x9f');     /* begin indefinite-length array */
+    }
+    json_array(struct json_object &object, const char *name) : b{object.b} {
+        cbor_write_key(b, name);
+        b->write_char('\x9f');
+    }
+    void close() {
+        b->write_char('\xff');     /* end indefinite-length array */
+    }
+    void print_bool(bool x) {
+        b->write_char(x ? '\xf5' : '\xf4');
+    }
+    void print_null() {
+        b->write_char('\xf6');
+    }
+    void print_uint(unsigned long int u) {
+        cbor_write_head(b, cbor_uint, u);
+    }
+    void print_int(long int i) {
+        cbor_write_int(b, i);
+    }
+    void print_float(double d) {
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        uint8_t f[9];
+        f[0] = (7 << 5) | 27;
+        for (int i = 0; i < 8; i++) {
+            f[1 + i] = bits >> (56 - 8 * i);
+        }
+        b->memcpy(f, sizeof(f));
+    }
+    void print_string(const char *s) {
+        cbor_write_text(b, (const uint8_t *)s, strlen(s));
+    }
+    void print_base64(const uint8_t *data, size_t length) {
+        if (data) {
+            cbor_write_bytes(b, data, length);
+        } else {
+            cbor_write_head(b, cbor_bytes, 0);
+        }
+    }
+    void print_hex(const struct datum &value) {
+        if (value.data && value.data_end && value.data_end > value.data) {
+            cbor_write_bytes(b, value.data, value.data_end - value.data);
+        } else {
+            cbor_write_head(b, cbor_bytes, 0);
+        }
+    }
+};
+
+inline json_object::json_object(struct json_array &array) : b{array.b} {
+    b->write_char('\xbf');
+}
+
+inline void json_object::reinit(struct json_array &array) {
+    b->write_char('\xff');
+    b->write_char('\xbf');
+    comma = false;
+    array.comma = true;
+}
+
+#endif // CBOR_OBJECT_H
@@ -140,6 +140,25 @@ static enum status mercury_config_parse_line(struct mercury_config *cfg, char *l
         global_vars.metadata_output = true;
         return status_ok;
 
+    } else if ((arg = command_get_argument("xdp", line)) != NULL) {
+        cfg->use_xdp = true;
+        return status_ok;
+
+    } else if ((arg = command_get_argument("busy-poll=", line)) != NULL) {
+        return argument_parse_as_int(arg, &cfg->busy_poll_usecs);
+
+    } else if ((arg = command_get_argument("gzip", line)) != NULL) {
+        cfg->gzip_output = true;
+        return status_ok;
+
+    } else if ((arg = command_get_argument("separate-files", line)) != NULL) {
+        cfg->separate_files = true;
+        return status_ok;
+
+    } else if ((arg = command_get_argument("output-sink=", line)) != NULL) {
+        cfg->output_sink = strdup(arg);
+        return status_ok;
+
     } else {
         if (line[0] == '#') { /* comment line */
             return status_ok;
@@ -12,4 +12,13 @@
 enum status mercury_config_read_from_file(struct mercury_config *cfg,
                                           const char *filename);
 
+/*
+ * line-oriented command parsing helpers, shared with the runtime
+ * control socket (control.c)
+ */
+char *command_get_argument(const char *command, char *line);
+enum status argument_parse_as_boolean(const char *arg, bool *variable_to_set);
+enum status argument_parse_as_int(const char *arg, int *variable_to_set);
+void string_remove_whitespace(char *s);
+
 #endif /* CONFIG_H */
@@ -0,0 +1,226 @@
+/*
+ * control.c
+ *
+ * runtime control socket (--control): accepts line-oriented commands
+ * on a UNIX stream socket, so that a running sensor can be retuned
+ * without the capture gap of a restart.  Commands use the same
+ * "name=value" form as the configuration file (config.c), and each
+ * one is answered with a single "ok" or "error: ..." line:
+ *
+ *    select=tls,quic       change the selected protocols
+ *    metadata=1            enable (0: disable) metadata output
+ *    dns-json=1            enable (0: disable) DNS JSON output
+ *    certs-json=1          enable (0: disable) certificate JSON output
+ *    stats-interval=30     seconds between stats JSON records
+ *    resources=dir         reload the analysis databases from dir
+ *    reload                reload the analysis databases in place
+ *
+ * Every change is published with an atomic swap of the structure it
+ * affects (the protocol matchers, the analysis database generation)
+ * or a write to a flag that the workers read per record, so the
+ * workers see it at the next packet and never block on a change.
+ * The socket serves one connection at a time, which is all an
+ * operator needs; commands arriving on a second connection wait
+ * until the first one closes.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "mercury.h"
+#include "config.h"
+#include "control.h"
+#include "extractor.h"
+#include "analysis.h"
+#include "af_packet_v3.h"
+
+extern struct global_variables global_vars; /* defined in config.c */
+
+static int control_listen_fd = -1;
+static char control_path[MAX_FILENAME] = "";
+static pthread_t control_thread;
+static volatile int control_stop = 0;
+
+static void control_command_process(char *line, FILE *reply) {
+    char *arg = NULL;
+    bool flag = false;
+    int num = 0;
+
+    if ((arg = command_get_argument("select=", line)) != NULL) {
+        if (proto_ident_reconfig(arg) == status_ok) {
+            fprintf(reply, "ok\n");
+        } else {
+            fprintf(reply, "error: could not parse selection '%s'; previous selection kept\n", arg);
+        }
+
+    } else if ((arg = command_get_argument("metadata=", line)) != NULL) {
+        if (argument_parse_as_boolean(arg, &flag) == status_ok) {
+            global_vars.metadata_output = flag;
+            fprintf(reply, "ok\n");
+        } else {
+            fprintf(reply, "error: metadata takes 0 or 1\n");
+        }
+
+    } else if ((arg = command_get_argument("dns-json=", line)) != NULL) {
+        if (argument_parse_as_boolean(arg, &flag) == status_ok) {
+            global_vars.dns_json_output = flag;
+            fprintf(reply, "ok\n");
+        } else {
+            fprintf(reply, "error: dns-json takes 0 or 1\n");
+        }
+
+    } else if ((arg = command_get_argument("certs-json=", line)) != NULL) {
+        if (argument_parse_as_boolean(arg, &flag) == status_ok) {
+            global_vars.certs_json_output = flag;
+            fprintf(reply, "ok\n");
+        } else {
+            fprintf(reply, "error: certs-json takes 0 or 1\n");
+        }
+
+    } else if ((arg = command_get_argument("stats-interval=", line)) != NULL) {
+        if (argument_parse_as_int(arg, &num) == status_ok && num > 0) {
+            af_packet_stats_set_interval(num);
+            fprintf(reply, "ok\n");
+        } else {
+            fprintf(reply, "error: stats-interval takes a positive number of seconds\n");
+        }
+
+    } else if ((arg = command_get_argument("resources=", line)) != NULL) {
+        if (analysis_reload(arg) == 0) {
+            fprintf(reply, "ok\n");
+        } else {
+            fprintf(reply, "error: could not reload analysis databases from '%s'\n", arg);
+        }
+
+    } else if (strcmp(line, "reload") == 0) {
+        if (analysis_reload(NULL) == 0) {
+            fprintf(reply, "ok\n");
+        } else {
+            fprintf(reply, "error: could not reload analysis databases\n");
+        }
+
+    } else {
+        fprintf(reply, "error: unrecognized command '%s'\n", line);
+    }
+    fflush(reply);
+}
+
+static void control_connection_serve(int client) {
+    /* a receive timeout lets the thread notice a shutdown even when
+     * the connected operator is silent */
+    struct timeval timeout = { 0, 500000 };
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    FILE *f = fdopen(client, "r+");
+    if (f == NULL) {
+        close(client);
+        return;
+    }
+    char *line = NULL;
+    size_t len = 0;
+    ssize_t nread;
+    while (control_stop == 0) {
+        errno = 0;
+        nread = getline(&line, &len, f);
+        if (nread < 0) {
+            if (feof(f)) {
+                break;                  /* connection closed */
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                clearerr(f);
+                continue;               /* receive timeout; check for shutdown */
+            }
+            break;
+        }
+        if (nread > 0 && line[nread-1] == '\n') {
+            line[nread-1] = 0;
+        }
+        string_remove_whitespace(line);
+        if (line[0] != 0 && line[0] != '#') {
+            control_command_process(line, f);
+        }
+    }
+    free(line);
+    fclose(f);
+}
+
+static void *control_thread_func(void *arg) {
+    (void)arg;
+
+    while (control_stop == 0) {
+        struct pollfd pfd = { control_listen_fd, POLLIN, 0 };
+        int ret = poll(&pfd, 1, 500);
+        if (ret <= 0) {
+            continue;   /* timeout or EINTR; check for shutdown */
+        }
+        int client = accept(control_listen_fd, NULL, NULL);
+        if (client < 0) {
+            continue;
+        }
+        control_connection_serve(client);
+    }
+    return NULL;
+}
+
+enum status control_socket_init(const char *path, struct mercury_config *cfg) {
+    struct sockaddr_un addr;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "error: control socket path '%s' is too long\n", path);
+        return status_err;
+    }
+    control_listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (control_listen_fd < 0) {
+        fprintf(stderr, "error: could not create control socket: %s\n", strerror(errno));
+        return status_err;
+    }
+    unlink(path);   /* remove a stale socket left by a previous run */
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path)-1);
+    if (bind(control_listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "error: could not bind control socket to '%s': %s\n", path, strerror(errno));
+        close(control_listen_fd);
+        control_listen_fd = -1;
+        return status_err;
+    }
+    if (listen(control_listen_fd, 1) < 0) {
+        fprintf(stderr, "error: could not listen on control socket '%s': %s\n", path, strerror(errno));
+        close(control_listen_fd);
+        control_listen_fd = -1;
+        unlink(path);
+        return status_err;
+    }
+    strncpy(control_path, path, MAX_FILENAME-1);
+
+    int err = pthread_create(&control_thread, NULL, control_thread_func, NULL);
+    if (err != 0) {
+        fprintf(stderr, "error: could not create control thread: %s\n", strerror(err));
+        close(control_listen_fd);
+        control_listen_fd = -1;
+        unlink(path);
+        return status_err;
+    }
+    if (cfg->verbosity) {
+        fprintf(stderr, "accepting runtime commands on control socket %s\n", path);
+    }
+    return status_ok;
+}
+
+void control_socket_finalize() {
+    if (control_listen_fd == -1) {
+        return;
+    }
+    control_stop = 1;
+    pthread_join(control_thread, NULL);
+    close(control_listen_fd);
+    control_listen_fd = -1;
+    unlink(control_path);
+}
@@ -0,0 +1,27 @@
+/*
+ * control.h
+ *
+ * runtime control socket for live reconfiguration
+ */
+
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include "mercury.h"
+
+/*
+ * control_socket_init() creates a UNIX stream socket at path (an
+ * existing socket at that path is removed) and starts a thread that
+ * accepts line-oriented commands on it; see control.c for the command
+ * set.  It returns status_ok on success and status_err otherwise.
+ */
+enum status control_socket_init(const char *path, struct mercury_config *cfg);
+
+/*
+ * control_socket_finalize() stops the control thread, closes the
+ * socket, and removes it from the filesystem; it is a no-op when no
+ * control socket was initialized
+ */
+void control_socket_finalize();
+
+#endif /* CONTROL_H */
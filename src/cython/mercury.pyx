@@ -1,14 +1,17 @@
 #cython: language_level=3
 
 import json
+import sys
 from base64 import b64decode
 
 from libcpp.unordered_map cimport unordered_map
 from libcpp.string cimport string
 from libc.stdio cimport *
+from libc.stdint cimport uint8_t
+from libc.stdlib cimport malloc, free
 
 ### BUILD INSTRUCTIONS
-# To build in-place:
+# To build in-place (libmerc.a must have been built in ../ first):
 #   CC=g++ python setup.py build_ext --inplace
 # To build and install:
 #   CC=g++ python setup.py install
@@ -24,6 +27,15 @@ cdef extern from "../asn1/x509.h":
 cdef extern from "../dns.h":
     string dns_get_json_string(const char *dns_pkt, ssize_t pkt_len)
 
+# imports from mercury's fingerprint extraction library
+cdef extern from "../libmerc.h":
+    size_t extract_fp_from_tls_client_hello(uint8_t *data, size_t data_len,
+                                            uint8_t *outbuf, size_t outbuf_len) nogil
+
+# an output buffer of this size holds any fingerprint that mercury
+# itself would emit (see MAX_FP_STR_LEN in the analysis engine)
+DEF FP_BUF_LEN = 4096
+
 
 
 # parse_cert
@@ -57,3 +69,85 @@ def parse_dns(str b64_dns):
     # use mercury's dns parser to parse the DNS request
     return json.loads(dns_get_json_string(c_string_ref, len_))
 
+
+# tls_fingerprint
+#  Input: tcp_data - any object exporting a contiguous buffer (memoryview,
+#         bytes, bytearray, mmap slice, ...) holding the TCP data field of
+#         a TLS clientHello
+#  Output: the fingerprint as an interned str in mercury's bracket
+#          notation, or None if the data is not a parseable clientHello
+#
+# The buffer is parsed in place by mercury's C extractor -- no copy is
+# made of the packet data -- and the GIL is released during parsing.
+# The returned strings are interned, so the handful of fingerprints
+# that dominate a capture are stored once and compare by pointer.
+def tls_fingerprint(const unsigned char[::1] tcp_data not None):
+    cdef uint8_t out[FP_BUF_LEN]
+    cdef size_t fp_len
+    cdef size_t data_len = tcp_data.shape[0]
+    if data_len == 0:
+        return None
+    with nogil:
+        fp_len = extract_fp_from_tls_client_hello(<uint8_t *>&tcp_data[0], data_len,
+                                                  out, FP_BUF_LEN)
+    if fp_len == 0:
+        return None
+    return sys.intern((<char *>out)[:fp_len].decode('ascii'))
+
+
+# tls_fingerprint_batch
+#  Input: packets - a sequence of buffer-exporting objects, each holding
+#         the TCP data field of a candidate TLS clientHello
+#  Output: a list with one entry per packet: an interned fingerprint str,
+#          or None for packets that are not parseable clientHellos
+#
+# The GIL is released once across the whole batch, so a pcap triage
+# script can hand over thousands of packets per call and pay the
+# interpreter boundary once instead of per packet.
+def tls_fingerprint_batch(packets):
+    cdef Py_ssize_t n = len(packets)
+    cdef Py_ssize_t i
+    if n == 0:
+        return []
+
+    cdef const unsigned char **data = <const unsigned char **>malloc(n * sizeof(unsigned char *))
+    cdef size_t *data_len = <size_t *>malloc(n * sizeof(size_t))
+    cdef size_t *fp_len = <size_t *>malloc(n * sizeof(size_t))
+    cdef char *fp = <char *>malloc(n * FP_BUF_LEN)
+    if data == NULL or data_len == NULL or fp_len == NULL or fp == NULL:
+        free(data); free(data_len); free(fp_len); free(fp)
+        raise MemoryError()
+
+    # the boxed memoryviews hold each exporter's buffer lock until the
+    # batch completes, so the pointers below stay valid
+    views = []
+    cdef const unsigned char[::1] view
+    try:
+        for i in range(n):
+            view = packets[i]
+            views.append(view)
+            data_len[i] = view.shape[0]
+            if data_len[i] > 0:
+                data[i] = &view[0]
+            else:
+                data[i] = NULL
+
+        with nogil:
+            for i in range(n):
+                if data[i] == NULL:
+                    fp_len[i] = 0
+                else:
+                    fp_len[i] = extract_fp_from_tls_client_hello(<uint8_t *>data[i], data_len[i],
+                                                                 <uint8_t *>(fp + i * FP_BUF_LEN),
+                                                                 FP_BUF_LEN)
+
+        result = []
+        for i in range(n):
+            if fp_len[i] == 0:
+                result.append(None)
+            else:
+                result.append(sys.intern((fp + i * FP_BUF_LEN)[:fp_len[i]].decode('ascii')))
+        return result
+    finally:
+        free(data); free(data_len); free(fp_len); free(fp)
+
@@ -8,3 +8,11 @@ print(parse_cert(b64_cert))
 b64_dns = '1e2BgAABAAAAAQAABGxpdmUGZ2l0aHViA2NvbQAAHAABwBEABgABAAABzQBIB25zLTE3MDcJYXdzZG5zLTIxAmNvAnVrABFhd3NkbnMtaG9zdG1hc3RlcgZhbWF6b27AGAAAAAEAABwgAAADhAASdQAAAVGA'
 
 print(parse_dns(b64_dns))
+
+# a TLS clientHello TCP data field; tls_fingerprint() parses the
+# memoryview in place, and the batch call releases the GIL once for
+# the whole list
+b64_client_hello = 'FgMBATMBAAEvAwOzr9lF8V5HqBqMh+tKj0ewTNCHouS2fzu++uirTEcvDCDl0r5YiKhzp3U3iUOKker+IlZEMrYXpevK3H8CbTcjjwA+EwITAxMBwCzAMACfzKnMqMyqwCvALwCewCTAKABrwCPAJwBnwArAFAA5wAnAEwAzAJ0AnAA9ADwANQAvAP8BAACoAAAADwANAAAKZ29vZ2xlLmNvbQALAAQDAAECAAoADAAKAB0AFwAeABkAGAAjAAAAFgAAABcAAAANADAALgQDBQMGAwgHCAgICQgKCAsIBAgFCAYEAQUBBgEDAwIDAwECAQMCAgIEAgUCBgIAKwAJCAMEAwMDAgMBAC0AAgEBADMAJgAkAB0AIIBcCp/9u/kQXoHA17G8zPIG0MZ5lrrcW/T/Zzyqjj88'
+client_hello = memoryview(b64decode(b64_client_hello))
+print(tls_fingerprint(client_hello))
+print(tls_fingerprint_batch([client_hello, memoryview(b'\x00' * 64)]))
@@ -11,9 +11,12 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>      /* for FILE */
+#include <string.h>     /* for memcpy() */
+#include <endian.h>     /* for be64toh() */
 #include <string>
 #include "mercury.h"
 #include "tcp.h"
+#include "arena.h"
 
 /*
  * The extractor_debug macro is useful for debugging (but quite verbose)
@@ -31,6 +34,25 @@ inline uint8_t lowercase(uint8_t x) {
     return x;
 }
 
+#if defined(__x86_64__)
+#define HAVE_SIMD_LOWERCASE 1
+#include <immintrin.h>
+
+/*
+ * lowercase_16(v) case-folds sixteen bytes at once: the two signed
+ * compares select exactly the bytes in 'A'..'Z' (bytes above 0x7f
+ * compare as negative, so they are left alone), and the add folds
+ * them.  SSE2 is part of the x86-64 baseline, so no runtime dispatch
+ * is needed.
+ */
+static inline __m128i lowercase_16(__m128i v) {
+    const __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+                                        _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), v));
+    return _mm_add_epi8(v, _mm_and_si128(upper, _mm_set1_epi8('a' - 'A')));
+}
+
+#endif /* __x86_64__ */
+
 struct datum {
     const unsigned char *data;          /* data being parsed/copied  */
     const unsigned char *data_end;      /* end of data buffer        */
@@ -41,6 +63,16 @@ struct datum {
     //parser(const unsigned char *d, size_t length) : data{d}, data_end{d+length} {}
     const std::string get_string() const { std::string s((char *)data, (int) (data_end - data)); return s;  }
     const std::basic_string<uint8_t> get_bytestring() const { std::basic_string<uint8_t> s((uint8_t *)data, (int) (data_end - data)); return s;  }
+    /* like get_string(), but the copy lives in the per-thread packet
+     * arena, so it costs no heap allocation and needs no free; it is
+     * valid only until the arena is reset at the next packet */
+    const char *get_arena_string() const {
+        size_t len = data_end - data;
+        char *s = (char *)packet_arena.alloc(len + 1);
+        memcpy(s, data, len);
+        s[len] = '\0';
+        return s;
+    }
     bool is_not_null() const { return data == NULL; }
     bool is_not_empty() const { return data != NULL && data < data_end; }
     bool is_not_readable() const { return data == NULL || data == data_end; }
@@ -110,6 +142,19 @@ struct datum {
         } else {
             const uint8_t *tmp_l = data;
             const uint8_t *tmp_r = r.data;
+#ifdef HAVE_SIMD_LOWERCASE
+            /* fold and compare sixteen bytes per step; the scalar
+             * loop below handles whatever remains */
+            while (data_end - tmp_l >= 16) {
+                __m128i l = _mm_loadu_si128((const __m128i *)tmp_l);
+                __m128i f = lowercase_16(_mm_loadu_si128((const __m128i *)tmp_r));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(l, f)) != 0xffff) {
+                    return false;
+                }
+                tmp_l += 16;
+                tmp_r += 16;
+            }
+#endif
             while (tmp_l < data_end) {
                 if (*tmp_l++ != lowercase(*tmp_r++)) {
                     return false;
@@ -213,6 +258,27 @@ struct datum {
         return false;
     }
 
+    // read_uint<N>() reads an N-byte unsigned integer in network byte
+    // order, and advances the data pointer; the width is a template
+    // parameter, so the whole read compiles down to a single bounds
+    // check plus an unaligned load and byte swap, instead of the
+    // byte-at-a-time loop of the runtime-length overload below
+    //
+    template <size_t N>
+    bool read_uint(size_t *output) {
+        static_assert(N > 0 && N <= sizeof(uint64_t), "bad integer width");
+        if (data && data + N <= data_end) {
+            uint64_t tmp = 0;
+            memcpy((unsigned char *)&tmp + (sizeof(tmp) - N), data, N);
+            *output = (size_t)be64toh(tmp);
+            data += N;
+            return true;
+        }
+        set_null();
+        *output = 0;
+        return false;
+    }
+
     // read_uint() reads a length num_bytes uint in network byte order, and advances the data pointer
     //
     bool read_uint(size_t *output, unsigned int num_bytes) {
@@ -249,6 +315,55 @@ struct datum {
         return false;
     }
 
+    /*
+     * The read_* methods above branch and null out the datum on every
+     * call, so a chain of reads is a chain of dependent branches.
+     * The gather_* methods below support an accumulate-then-check
+     * style for deep parse chains: each read clamps the bytes that it
+     * dereferences against data_end but advances the data pointer
+     * unconditionally, so a read past the end yields zero and leaves
+     * the pointer beyond data_end.  That overrun is the sticky
+     * failure record: a parser can issue any number of gather reads
+     * and then call gather_ok() once per message; if it returns
+     * false, the datum has been nulled out, and every value gathered
+     * since the last check must be discarded.  The safe-parsing
+     * guarantee is unchanged -- no read ever dereferences past
+     * data_end -- only the placement of the validity branch moves.
+     */
+    uint8_t gather_uint8() {
+        uint8_t x = (data < data_end) ? data[0] : 0;
+        data += 1;
+        return x;
+    }
+
+    uint16_t gather_uint16() {
+        uint16_t hi = (data     < data_end) ? data[0] : 0;
+        uint16_t lo = (data + 1 < data_end) ? data[1] : 0;
+        data += 2;
+        return (uint16_t)((hi << 8) | lo);
+    }
+
+    size_t gather_uint(unsigned int num_bytes) {
+        size_t tmp = 0;
+        for (unsigned int i = 0; i < num_bytes; i++) {
+            tmp = (tmp << 8) + ((data + i < data_end) ? data[i] : 0);
+        }
+        data += num_bytes;
+        return tmp;
+    }
+
+    void gather_skip(size_t num_bytes) {
+        data += num_bytes;
+    }
+
+    bool gather_ok() {
+        if (data > data_end) {
+            set_null();
+            return false;
+        }
+        return true;
+    }
+
     void init_from_outer_parser(struct datum *outer,
                                 unsigned int data_len) {
         const unsigned char *inner_data_end = outer->data + data_len;
@@ -363,9 +478,29 @@ unsigned int parser_process_eth(struct datum *p, size_t *ethertype);
 
 unsigned int parser_process_tcp(struct datum *p);
 
-unsigned int parser_process_ipv4(struct datum *p, size_t *transport_protocol, struct key *k);
+/*
+ * ip_fragment_fields reports the fragmentation state of a parsed IP
+ * header: the datagram identification, this fragment's byte offset
+ * within the datagram, and whether more fragments follow.  A packet
+ * is a fragment exactly when its offset is nonzero or more fragments
+ * are flagged.  The out-parameter is optional; callers that do not
+ * reassemble pass NULL.
+ */
+struct ip_fragment_fields {
+    uint32_t identification;  /* 16 bits on the wire for IPv4, 32 for IPv6 */
+    uint16_t offset;
+    bool more_fragments;
+
+    ip_fragment_fields() : identification{0}, offset{0}, more_fragments{false} {}
+
+    bool is_fragment() const { return offset != 0 || more_fragments; }
+};
+
+unsigned int parser_process_ipv4(struct datum *p, size_t *transport_protocol, struct key *k,
+                                 struct ip_fragment_fields *frag = NULL);
 
-unsigned int parser_process_ipv6(struct datum *p, size_t *transport_protocol, struct key *k);
+unsigned int parser_process_ipv6(struct datum *p, size_t *transport_protocol, struct key *k,
+                                 struct ip_fragment_fields *frag = NULL);
 
 unsigned int parser_process_packet(struct datum *p);
 
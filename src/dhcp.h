@@ -112,6 +112,37 @@ struct dhcp_option : public datum {
     }
 };
 
+/*
+ * the fingerprint treats each option according to one of three
+ * actions: the tag, length, and data are all emitted (for the options
+ * that characterize the client implementation), only the tag is
+ * emitted, or the option is skipped (padding).  The action for each
+ * of the 256 option codes is held in a table indexed by the code, so
+ * that the option walk dispatches with a single load per option
+ * instead of a chain of tag comparisons.
+ */
+enum dhcp_option_action : uint8_t {
+    dhcp_action_emit_tag  = 0,  /* emit the option tag only          */
+    dhcp_action_emit_full = 1,  /* emit the tag, length, and data    */
+    dhcp_action_skip      = 2   /* emit nothing                      */
+};
+
+struct dhcp_option_action_table {
+    uint8_t action[256];
+
+    dhcp_option_action_table() {
+        for (unsigned int i = 0; i < 256; i++) {
+            action[i] = dhcp_action_emit_tag;
+        }
+        action[DHCP_OPT_PAD]            = dhcp_action_skip;
+        action[DHCP_OPT_MESSAGE_TYPE]   = dhcp_action_emit_full;
+        action[DHCP_OPT_PARAMETER_LIST] = dhcp_action_emit_full;
+        action[DHCP_OPT_VENDOR_CLASS]   = dhcp_action_emit_full;
+    }
+};
+
+static const struct dhcp_option_action_table dhcp_option_actions;
+
 struct dhcp_discover {
     struct datum options;
 
@@ -152,19 +183,24 @@ struct dhcp_discover {
         while (tmp.is_not_empty()) {
             struct dhcp_option opt;
             opt.parse(tmp);
-            if (opt.tag == DHCP_OPT_PARAMETER_LIST || opt.tag == DHCP_OPT_VENDOR_CLASS || opt.tag == DHCP_OPT_MESSAGE_TYPE) {
+            switch (dhcp_option_actions.action[opt.tag]) {
+            case dhcp_action_emit_full:
                 // copy entire option into fingerprint string
                 b.write_char('(');
                 b.raw_as_hex(&opt.tag, sizeof(opt.tag));
                 b.raw_as_hex(&opt.length, sizeof(opt.length));
                 b.raw_as_hex(opt.data, opt.data_end - opt.data);
                 b.write_char(')');
-
-            } else if (opt.tag != DHCP_OPT_PAD) {
+                break;
+            case dhcp_action_emit_tag:
                 // copy only option tag into fingerprint string
                 b.write_char('(');
                 b.raw_as_hex(&opt.tag, sizeof(opt.tag));
                 b.write_char(')');
+                break;
+            case dhcp_action_skip:
+            default:
+                break;
             }
         }
         b.write_char('\"');
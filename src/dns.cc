@@ -184,6 +184,29 @@ enum dns_class {
 /** DNS Max Recursion processing depth */
 #define DNS_MAX_RECURSION_DEPTH 20
 
+/** number of compression targets cached per message */
+#define DNS_NAME_CACHE_ENTRIES 16
+
+/*
+ * A dns_name_cache holds the decoded form of the compression targets
+ * seen so far in a single DNS message.  Nearly every name in a large
+ * response points back at the question name (or at a suffix of it),
+ * so decoding each target once and then reusing the decoded buffer
+ * keeps the work linear in the message size rather than re-walking
+ * the packet for every resource record.  Each entry maps a packet
+ * offset to the printable name suffix that begins at that offset.
+ */
+struct dns_name_cache_entry {
+    uint16_t offset;
+    uint16_t name_len;
+    char name[DNS_OUTNAME_LEN];
+};
+
+struct dns_name_cache {
+    struct dns_name_cache_entry entry[DNS_NAME_CACHE_ENTRIES];
+    unsigned int count;
+};
+
 /** DNS error codes */
 enum dns_err {
     dns_ok                  = 0,
@@ -240,6 +263,56 @@ static enum dns_err dns_rr_parse (const dns_rr **r, const char **data, ssize_t *
     return dns_ok;
 }
 
+/*
+ * skip over an encoded name without decoding it; a compression offset
+ * ends the name, and its target is not followed, since nothing is
+ * being decoded
+ */
+static enum dns_err dns_skip_name (const char **data, ssize_t *len) {
+    while (*len > 0) {
+        unsigned char c = **data;
+        if (char_is_offset(c)) {
+            return data_advance(data, len, 2);
+        }
+        if (c == 0) {
+            return data_advance(data, len, 1);
+        }
+        if (c >= 64) {
+            return dns_err_label_malformed;
+        }
+        enum dns_err err = data_advance(data, len, c + 1);
+        if (err != dns_ok) {
+            return err;
+        }
+    }
+    return dns_err_unterminated;
+}
+
+/*
+ * skip over count resource records without decoding them, using only
+ * the name labels and the rdlength fields to find the record
+ * boundaries; used for the sections that the filter leaves out
+ */
+static enum dns_err dns_section_skip (const char **data, ssize_t *len, uint16_t count) {
+    while (count-- > 0) {
+        enum dns_err err = dns_skip_name(data, len);
+        if (err != dns_ok) {
+            return err;
+        }
+        const dns_rr *rr;
+        ssize_t rdlength;
+        err = dns_rr_parse(&rr, data, len, &rdlength);
+        if (err != dns_ok) {
+            return err;
+        }
+        err = data_advance(data, len, rdlength);
+        if (err != dns_ok) {
+            return err;
+        }
+    }
+    return dns_ok;
+}
+
 /* parse DNS address */
 static enum dns_err dns_addr_parse (const struct in_addr **a, const char **data, ssize_t *len, unsigned short int rdlength) {
     if (*len < (int)sizeof(struct in_addr)) {
@@ -288,7 +361,8 @@ static inline char printable(char c) {
 
 static enum dns_err dns_header_parse_name (const dns_hdr *hdr, const char **name, ssize_t *len,
                                            char *outname, unsigned int outname_len,
-                                           unsigned int recursion_depth) {
+                                           unsigned int recursion_depth,
+                                           struct dns_name_cache *cache) {
     char *terminus = outname + outname_len;
     const char *c = *name;
     unsigned char jump;
@@ -343,17 +417,42 @@ static enum dns_err dns_header_parse_name (const dns_hdr *hdr, const char **name
             }
         } else if (char_is_offset(*c)) {
             uint16_t *offset;
+            uint16_t target;
+            unsigned int j;
 
             err = uint16_parse(&offset, name, len);
             if (err != dns_ok) {
                 return dns_err_offset_too_long;
             }
-            offsetname = (const char *)((char *)hdr + (ntohs(*offset) & 0x3FFF));
-            offsetlen -= (ntohs(*offset) & 0x3FFF);
+            target = ntohs(*offset) & 0x3FFF;
+
+            /* if this target was decoded earlier in the message, reuse that buffer */
+            for (j = 0; j < cache->count; j++) {
+                if (cache->entry[j].offset == target) {
+                    if (outname + cache->entry[j].name_len + 1 > terminus) {
+                        return dns_err_label_too_long;
+                    }
+                    memcpy(outname, cache->entry[j].name, cache->entry[j].name_len + 1);
+                    return dns_ok;
+                }
+            }
+
+            offsetname = (const char *)((char *)hdr + target);
+            offsetlen -= target;
             if (recursion_depth >= DNS_MAX_RECURSION_DEPTH) {
                 return dns_err_offset_too_long;
             }
-            return dns_header_parse_name(hdr, &offsetname, &offsetlen, outname, outname_len, recursion_depth + 1);
+            err = dns_header_parse_name(hdr, &offsetname, &offsetlen, outname, outname_len, recursion_depth + 1, cache);
+            if (err == dns_ok && cache->count < DNS_NAME_CACHE_ENTRIES) {
+                size_t name_len = strlen(outname);
+                if (name_len < DNS_OUTNAME_LEN) {
+                    struct dns_name_cache_entry *e = &cache->entry[cache->count++];
+                    e->offset = target;
+                    e->name_len = name_len;
+                    memcpy(e->name, outname, name_len + 1);
+                }
+            }
+            return err;
         } else {
             return dns_err_label_malformed;
         }
@@ -448,7 +547,8 @@ static enum dns_err dns_header_parse_mxname (const dns_hdr *hdr, const char **na
  * location *r
  */
 static enum dns_err
-dns_rdata_print (const dns_hdr *rh, const dns_rr *rr, const char **r, ssize_t *len, struct json_object &o) {
+dns_rdata_print (const dns_hdr *rh, const dns_rr *rr, const char **r, ssize_t *len,
+                 struct dns_name_cache *cache, struct json_object &o) {
     enum dns_err err;
     uint16_t rclass = ntohs(rr->rclass);
     uint16_t type = ntohs(rr->type);
@@ -486,7 +586,7 @@ dns_rdata_print (const dns_hdr *rh, const dns_rr *rr, const char **r, ssize_t *l
             if (type == type_MX) {
                 err = dns_header_parse_mxname(rh, r, len, name, (DNS_OUTNAME_LEN-1), 0); /* note: does not check rdlength */
             } else {
-                err = dns_header_parse_name(rh, r, len, name, (DNS_OUTNAME_LEN-1), 0); /* note: does not check rdlength */
+                err = dns_header_parse_name(rh, r, len, name, (DNS_OUTNAME_LEN-1), 0, cache); /* note: does not check rdlength */
             }
             if (err != dns_ok) {
                 return err;
@@ -554,7 +654,7 @@ dns_rdata_print (const dns_hdr *rh, const dns_rr *rr, const char **r, ssize_t *l
     return dns_ok;
 }
 
-void dns_print_packet (const char *dns_pkt, ssize_t pkt_len, struct json_object &outer) {
+void dns_print_packet (const char *dns_pkt, ssize_t pkt_len, struct json_object &outer, uint8_t sections) {
     enum dns_err err = dns_ok;
     const dns_hdr *rh = NULL;
     const dns_question *question = NULL;
@@ -563,6 +663,9 @@ void dns_print_packet (const char *dns_pkt, ssize_t pkt_len, struct json_object
     uint16_t qdcount = 0, ancount = 0, nscount = 0, arcount = 0;
     ssize_t rdlength = 0;
     char name[DNS_OUTNAME_LEN];
+    struct dns_name_cache name_cache;
+
+    name_cache.count = 0;   /* the cache covers a single message */
 
     /*
      * DNS packet format:
@@ -602,8 +705,21 @@ void dns_print_packet (const char *dns_pkt, ssize_t pkt_len, struct json_object
 
     memset(name, 0x00, DNS_OUTNAME_LEN);
     while (qdcount-- > 0) {
-        /* parse question name and struct */
-        err = dns_header_parse_name(rh, &r, &len, name, (DNS_OUTNAME_LEN-1), 0);
+        /* parse question name and struct; when the question section is
+         * filtered out, step over it without decoding the name */
+        if ((sections & dns_section_question) == 0) {
+            err = dns_skip_name(&r, &len);
+            if (err == dns_ok) {
+                err = data_advance(&r, &len, sizeof(dns_question));
+            }
+            if (err != dns_ok) {
+                o.print_key_uint("malformed", len);
+                o.close();
+                return;
+            }
+            continue;
+        }
+        err = dns_header_parse_name(rh, &r, &len, name, (DNS_OUTNAME_LEN-1), 0, &name_cache);
         if (err != dns_ok) {
             o.print_key_uint("malformed", len);
             o.close();
@@ -621,137 +737,166 @@ void dns_print_packet (const char *dns_pkt, ssize_t pkt_len, struct json_object
     o.print_key_uint("rcode", flags_rcode);
     o.print_key_uint("flags", flags);
 
-    struct json_array rarray{o, "answer"};
-
     ancount = ntohs(rh->ancount);
-    memset(name, 0x00, DNS_OUTNAME_LEN);
-    while (ancount-- > 0) {
-        struct json_object robj{rarray};
-
-        /* parse rr name, struct, and rdata */
-        err = dns_header_parse_name(rh, &r, &len, name, (DNS_OUTNAME_LEN-1), 0);
-        if (err != dns_ok) {
-            robj.print_key_uint("malformed", len);
-            robj.close();
-            rarray.close();
-            o.close();
-            return;
-        }
-        err = dns_rr_parse(&rr, &r, &len, &rdlength);
-        if (err) {
-            robj.print_key_uint("malformed", len);
-            robj.close();
-            rarray.close();
+    if ((sections & dns_section_answer) == 0) {
+        if (dns_section_skip(&r, &len, ancount) != dns_ok) {
+            o.print_key_uint("malformed", len);
             o.close();
             return;
         }
-        err = dns_rdata_print(rh, rr, &r, &rdlength, robj);
-        if (err) {
-            robj.print_key_uint("malformed", len);
+    } else {
+        struct json_array rarray{o, "answer"};
+
+        memset(name, 0x00, DNS_OUTNAME_LEN);
+        while (ancount-- > 0) {
+            struct json_object robj{rarray};
+
+            /* parse rr name, struct, and rdata */
+            err = dns_header_parse_name(rh, &r, &len, name, (DNS_OUTNAME_LEN-1), 0, &name_cache);
+            if (err != dns_ok) {
+                robj.print_key_uint("malformed", len);
+                robj.close();
+                rarray.close();
+                o.close();
+                return;
+            }
+            err = dns_rr_parse(&rr, &r, &len, &rdlength);
+            if (err) {
+                robj.print_key_uint("malformed", len);
+                robj.close();
+                rarray.close();
+                o.close();
+                return;
+            }
+            err = dns_rdata_print(rh, rr, &r, &rdlength, &name_cache, robj);
+            if (err) {
+                robj.print_key_uint("malformed", len);
+                robj.close();
+                rarray.close();
+                o.close();
+                return;
+            }
+            len -= rdlength;
+            if (rdlength > 1) {
+                r += (rdlength - 1);
+                rdlength = 1;
+            }
+            robj.print_key_uint("ttl", ntohl(rr->ttl));
             robj.close();
-            rarray.close();
-            o.close();
-            return;
         }
-        len -= rdlength;
-        if (rdlength > 1) {
-            r += (rdlength - 1);
-            rdlength = 1;
-        }
-        robj.print_key_uint("ttl", ntohl(rr->ttl));
-        robj.close();
-    }
 
-    rarray.close();
+        rarray.close();
+    }
 
-    struct json_array authority{o, "authority"};
     nscount = ntohs(rh->nscount);
     if (rdlength > 1) {
         r += (rdlength - 1);
+        rdlength = 1;
     }
-    memset(name, 0x00, DNS_OUTNAME_LEN);
-    while (nscount-- > 0) {
-        struct json_object robj{authority};
-
-        /* parse rr name, struct, and rdata */
-        err = dns_header_parse_name(rh, &r, &len, name, (DNS_OUTNAME_LEN-1), 0);
-        if (err != dns_ok) {
-            robj.print_key_uint("malformed", len);
-            robj.close();
-            authority.close();
-            o.close();
-            return;
-        }
-        err = dns_rr_parse(&rr, &r, &len, &rdlength);
-        if (err) {
-            robj.print_key_uint("malformed", len);
-            robj.close();
-            authority.close();
+    if ((sections & dns_section_authority) == 0) {
+        if (dns_section_skip(&r, &len, nscount) != dns_ok) {
+            o.print_key_uint("malformed", len);
             o.close();
             return;
         }
-        err = dns_rdata_print(rh, rr, &r, &rdlength, robj);
-        if (err) {
-            robj.print_key_uint("malformed", len);
+    } else {
+        struct json_array authority{o, "authority"};
+
+        memset(name, 0x00, DNS_OUTNAME_LEN);
+        while (nscount-- > 0) {
+            struct json_object robj{authority};
+
+            /* parse rr name, struct, and rdata */
+            err = dns_header_parse_name(rh, &r, &len, name, (DNS_OUTNAME_LEN-1), 0, &name_cache);
+            if (err != dns_ok) {
+                robj.print_key_uint("malformed", len);
+                robj.close();
+                authority.close();
+                o.close();
+                return;
+            }
+            err = dns_rr_parse(&rr, &r, &len, &rdlength);
+            if (err) {
+                robj.print_key_uint("malformed", len);
+                robj.close();
+                authority.close();
+                o.close();
+                return;
+            }
+            err = dns_rdata_print(rh, rr, &r, &rdlength, &name_cache, robj);
+            if (err) {
+                robj.print_key_uint("malformed", len);
+                robj.close();
+                authority.close();
+                o.close();
+                return;
+            }
+            len -= rdlength;
+            if (rdlength > 1) {
+                r += (rdlength - 1);
+                rdlength = 1;
+            }
+            robj.print_key_uint("ttl", ntohl(rr->ttl));
             robj.close();
-            authority.close();
-            o.close();
-            return;
         }
-        len -= rdlength;
-        if (rdlength > 1) {
-            r += (rdlength - 1);
-            rdlength = 1;
-        }
-        robj.print_key_uint("ttl", ntohl(rr->ttl));
-        robj.close();
-    }
 
-    authority.close();
+        authority.close();
+    }
 
-    struct json_array additional{o, "additional"};
     arcount = ntohs(rh->arcount);
     if (rdlength > 1) {
         r += (rdlength - 1);
+        rdlength = 1;
     }
-    memset(name, 0x00, DNS_OUTNAME_LEN);
-    while (arcount-- > 0) {
-        struct json_object robj{additional};
-
-        /* parse rr name, struct, and rdata */
-        err = dns_header_parse_name(rh, &r, &len, name, (DNS_OUTNAME_LEN-1), 0);
-        if (err != dns_ok) {
-            robj.print_key_uint("malformed", len);
-            robj.close();
-            additional.close();
-            o.close();
-            return;
-        }
-        err = dns_rr_parse(&rr, &r, &len, &rdlength);
-        if (err) {
-            robj.print_key_uint("malformed", len);
-            robj.close();
-            additional.close();
+    if ((sections & dns_section_additional) == 0) {
+        if (dns_section_skip(&r, &len, arcount) != dns_ok) {
+            o.print_key_uint("malformed", len);
             o.close();
             return;
         }
-        err = dns_rdata_print(rh, rr, &r, &rdlength, robj);
-        if (err) {
-            robj.print_key_uint("malformed", len);
+    } else {
+        struct json_array additional{o, "additional"};
+
+        memset(name, 0x00, DNS_OUTNAME_LEN);
+        while (arcount-- > 0) {
+            struct json_object robj{additional};
+
+            /* parse rr name, struct, and rdata */
+            err = dns_header_parse_name(rh, &r, &len, name, (DNS_OUTNAME_LEN-1), 0, &name_cache);
+            if (err != dns_ok) {
+                robj.print_key_uint("malformed", len);
+                robj.close();
+                additional.close();
+                o.close();
+                return;
+            }
+            err = dns_rr_parse(&rr, &r, &len, &rdlength);
+            if (err) {
+                robj.print_key_uint("malformed", len);
+                robj.close();
+                additional.close();
+                o.close();
+                return;
+            }
+            err = dns_rdata_print(rh, rr, &r, &rdlength, &name_cache, robj);
+            if (err) {
+                robj.print_key_uint("malformed", len);
+                robj.close();
+                additional.close();
+                o.close();
+                return;
+            }
+            len -= rdlength;
+            if (rdlength > 1) {
+                r += (rdlength - 1);
+                rdlength = 1;
+            }
+            robj.print_key_uint("ttl", ntohl(rr->ttl));
             robj.close();
-            additional.close();
-            o.close();
-            return;
-        }
-        len -= rdlength;
-        if (rdlength > 1) {
-            r += (rdlength - 1);
-            rdlength = 1;
         }
-        robj.print_key_uint("ttl", ntohl(rr->ttl));
-        robj.close();
+
+        additional.close();
     }
-    additional.close();
     o.close();
 
     return;
@@ -763,18 +908,43 @@ std::string dns_get_json_string(const char *dns_pkt, ssize_t pkt_len) {
     char buffer[8192*8];
     struct buffer_stream buf(buffer, sizeof(buffer));
     struct json_object dns{&buf};
-    dns_print_packet(dns_pkt, pkt_len, dns);
+    dns_print_packet(dns_pkt, pkt_len, dns, dns_section_all);
     dns.close();
     std::string tmp_str(buffer, buf.length());
     return tmp_str;
 }
 
-void write_dns_server_data(const uint8_t *data, size_t length, struct json_object &dns_object, bool output_base64) {
+void write_dns_server_data(const uint8_t *data, size_t length, struct json_object &dns_object, bool output_base64, uint8_t sections) {
     if (output_base64) {
         struct datum p{data, data+length};
         dns_object.print_key_base64("base64", p);
     } else {
-        dns_print_packet((const char *)data, length, dns_object);
+        dns_print_packet((const char *)data, length, dns_object, sections);
     }
     return;
 }
+
+/* see dns.h; the section names match the JSON keys they select */
+uint8_t dns_sections_parse(const char *spec) {
+    uint8_t sections = 0;
+    const char *s = spec;
+    while (*s) {
+        size_t n = strcspn(s, ",");
+        if (n == 8 && strncmp(s, "question", n) == 0) {
+            sections |= dns_section_question;
+        } else if (n == 6 && strncmp(s, "answer", n) == 0) {
+            sections |= dns_section_answer;
+        } else if (n == 9 && strncmp(s, "authority", n) == 0) {
+            sections |= dns_section_authority;
+        } else if (n == 10 && strncmp(s, "additional", n) == 0) {
+            sections |= dns_section_additional;
+        } else {
+            return 0;
+        }
+        s += n;
+        if (*s == ',') {
+            s++;
+        }
+    }
+    return sections;
+}
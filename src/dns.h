@@ -19,7 +19,27 @@
 /** maximum DNS name length */
 #define MAX_DNS_NAME_LEN 256
 
-void write_dns_server_data(const uint8_t *data, size_t length, struct json_object &o, bool base64_output);
+/*
+ * DNS message sections, as a bitmask selecting which sections of a
+ * response are decoded and written as JSON (--dns-json); records in
+ * unselected sections are skipped without decoding
+ */
+enum dns_section : uint8_t {
+    dns_section_question   = 1,
+    dns_section_answer     = 2,
+    dns_section_authority  = 4,
+    dns_section_additional = 8,
+    dns_section_all        = 15
+};
+
+/*
+ * dns_sections_parse(spec) parses a comma-separated list of section
+ * names (question, answer, authority, additional) into a bitmask,
+ * returning 0 if any name is unrecognized
+ */
+uint8_t dns_sections_parse(const char *spec);
+
+void write_dns_server_data(const uint8_t *data, size_t length, struct json_object &o, bool base64_output, uint8_t sections);
 
 std::string dns_get_json_string(const char *dns_pkt, ssize_t pkt_len);
 
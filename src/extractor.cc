@@ -8,9 +8,15 @@
 #include <string.h>   /* for memcpy()   */
 #include <ctype.h>    /* for tolower()  */
 #include <stdio.h>
+#include <inttypes.h> /* for the profile report's PRIu64 */
+#include <pthread.h>  /* for the protocol stats registry mutex */
 #include <arpa/inet.h>  /* for htons()  */
 #include <algorithm>
+#include <atomic>     /* for the live matcher pointer below */
 #include <map>
+#if defined(__x86_64__)
+#include <immintrin.h>  /* for the vectorized degreasing below */
+#endif
 
 #include "extractor.h"
 #include "utils.h"
@@ -116,6 +122,20 @@ struct pi_container http_client = {
     HTTP_PORT
 };
 
+/* HTTP/2 client connection preface ("PRI * HT...") */
+unsigned char http2_preface_mask[] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+unsigned char http2_preface_value[] = {
+    'P', 'R', 'I', ' ', '*', ' ', 'H', 'T'
+};
+
+struct pi_container http2_client = {
+    DIR_CLIENT,
+    HTTP2_PORT
+};
+
 /* http server matching value: HTTP/1 */
 
 unsigned char http_server_mask[] = {
@@ -167,6 +187,96 @@ struct pi_container ssh_kex = {
     SSH_KEX
 };
 
+/*
+ * tcp_matchers packs all of the mask/value pairs above into a single
+ * masked_matcher, so that the first sixteen bytes of TCP data are
+ * loaded once and compared against every pattern in one pass, instead
+ * of walking the chain of masked comparisons below; the pi and msg
+ * arrays map the index of the matching pattern back to the
+ * per-pattern results.  Each pattern is registered with the eight
+ * bytes that the corresponding u32 comparison actually examines, so
+ * the two paths accept exactly the same packets.  The matcher is
+ * built on first use, which is after proto_ident_config() has had a
+ * chance to zero out the masks of deselected protocols; such dead
+ * patterns are omitted from the matcher outright, so a sensor that
+ * selects only one protocol spends no per-packet work on the others.
+ * The scalar chains are retained for payloads shorter than sixteen
+ * bytes.
+ */
+
+struct tcp_matchers {
+    struct masked_matcher m;
+    const struct pi_container *pi[MASKED_MATCHER_MAX_PATTERNS];
+    enum msg_type msg[MASKED_MATCHER_MAX_PATTERNS];
+};
+
+static void tcp_matchers_add(struct tcp_matchers *t,
+                             const unsigned char *mask,
+                             const unsigned char *value,
+                             size_t len,
+                             const struct pi_container *pi,
+                             enum msg_type msg) {
+    if (mask_is_zero(mask, len)) {
+        return;  /* protocol deselected; pattern can never match */
+    }
+    t->pi[t->m.count] = pi;
+    t->msg[t->m.count] = msg;
+    masked_matcher_add(&t->m, mask, value, len);
+}
+
+static struct tcp_matchers build_tcp_matchers() {
+    struct tcp_matchers t;
+    memset(&t, 0, sizeof(t));
+    tcp_matchers_add(&t, tls_client_hello_mask, tls_client_hello_value, sizeof(tls_client_hello_mask),
+                     &https_client, msg_type_tls_client_hello);
+    tcp_matchers_add(&t, tls_server_hello_mask, tls_server_hello_value, sizeof(tls_server_hello_mask),
+                     &https_server, msg_type_tls_server_hello);
+    tcp_matchers_add(&t, tls_server_cert_mask, tls_server_cert_value, sizeof(tls_server_cert_mask),
+                     &https_server_cert, msg_type_tls_certificate);
+    tcp_matchers_add(&t, http_client_mask, http_client_value, sizeof(http_client_mask),
+                     &http_client, msg_type_http_request);
+    tcp_matchers_add(&t, http_client_post_mask, http_client_post_value, sizeof(http_client_post_mask),
+                     &http_client, msg_type_http_request);
+    tcp_matchers_add(&t, http_server_mask, http_server_value, sizeof(http_server_mask),
+                     &http_server, msg_type_http_response);
+    tcp_matchers_add(&t, http2_preface_mask, http2_preface_value, sizeof(http2_preface_mask),
+                     &http2_client, msg_type_http2);
+    tcp_matchers_add(&t, ssh_mask, ssh_value, sizeof(ssh_mask),
+                     &ssh, msg_type_ssh);
+    tcp_matchers_add(&t, ssh_kex_mask, ssh_kex_value, sizeof(ssh_kex_mask),
+                     &ssh_kex, msg_type_ssh_kex);
+    return t;
+}
+
+static std::atomic<const struct tcp_matchers *> tcp_matchers_live{NULL};
+static const struct tcp_matchers *tcp_matchers_retired = NULL;
+
+/*
+ * tcp_matchers_rebuild() builds a replacement matcher from the
+ * current masks and publishes it with a single pointer swap, so that
+ * proto_ident_reconfig() can change the selected protocols while
+ * packets are flowing.  As with database_reload() (analysis.cc), the
+ * generation displaced by the previous rebuild is freed one full
+ * rebuild later, by which time any reader that loaded its pointer has
+ * long since classified its packet.
+ */
+static void tcp_matchers_rebuild() {
+    const struct tcp_matchers *fresh = new tcp_matchers(build_tcp_matchers());
+    const struct tcp_matchers *old = tcp_matchers_live.exchange(fresh, std::memory_order_acq_rel);
+    delete tcp_matchers_retired;
+    tcp_matchers_retired = old;
+}
+
+static const struct tcp_matchers &get_tcp_matchers() {
+    const struct tcp_matchers *t = tcp_matchers_live.load(std::memory_order_acquire);
+    if (t == NULL) {
+        static const bool built = (tcp_matchers_rebuild(), true);  /* first use; initialization is thread-safe */
+        (void)built;
+        t = tcp_matchers_live.load(std::memory_order_acquire);
+    }
+    return *t;
+}
+
 const struct pi_container *proto_identify_tcp(const uint8_t *tcp_data,
                                               unsigned int len) {
 
@@ -178,6 +288,15 @@ const struct pi_container *proto_identify_tcp(const uint8_t *tcp_data,
 
     /* note: tcp_data will be 32-bit aligned as per the standard */
 
+    if (len >= MASKED_PATTERN_LEN) {
+        const struct tcp_matchers &t = get_tcp_matchers();
+        int idx = masked_matcher_match(&t.m, tcp_data);
+        if (idx < 0) {
+            return NULL;
+        }
+        return t.pi[idx];
+    }
+
     if (u32_compare_masked_data_to_value(tcp_data,
                                          tls_client_hello_mask,
                                          tls_client_hello_value)) {
@@ -208,6 +327,11 @@ const struct pi_container *proto_identify_tcp(const uint8_t *tcp_data,
                                          http_server_value)) {
         return &http_server;
     }
+    if (u64_compare_masked_data_to_value(tcp_data,
+                                         http2_preface_mask,
+                                         http2_preface_value)) {
+        return &http2_client;
+    }
     if (u32_compare_masked_data_to_value(tcp_data,
                                          ssh_mask,
                                          ssh_value)) {
@@ -232,6 +356,15 @@ enum msg_type get_message_type(const uint8_t *tcp_data,
 
     /* note: tcp_data will be 32-bit aligned as per the standard */
 
+    if (len >= MASKED_PATTERN_LEN) {
+        const struct tcp_matchers &t = get_tcp_matchers();
+        int idx = masked_matcher_match(&t.m, tcp_data);
+        if (idx < 0) {
+            return msg_type_unknown;
+        }
+        return t.msg[idx];
+    }
+
     if (u32_compare_masked_data_to_value(tcp_data,
                                          tls_client_hello_mask,
                                          tls_client_hello_value)) {
@@ -262,6 +395,11 @@ enum msg_type get_message_type(const uint8_t *tcp_data,
                                          http_server_value)) {
         return msg_type_http_response;
     }
+    if (u64_compare_masked_data_to_value(tcp_data,
+                                         http2_preface_mask,
+                                         http2_preface_value)) {
+        return msg_type_http2;
+    }
     if (u32_compare_masked_data_to_value(tcp_data,
                                          ssh_mask,
                                          ssh_value)) {
@@ -875,27 +1013,15 @@ unsigned int packet_filter_process_tcp(struct packet_filter *pf, struct key *k)
  */
 
 uint16_t degrease_uint16(uint16_t x) {
-    switch(x) {
-    case 0x0a0a:
-    case 0x1a1a:
-    case 0x2a2a:
-    case 0x3a3a:
-    case 0x4a4a:
-    case 0x5a5a:
-    case 0x6a6a:
-    case 0x7a7a:
-    case 0x8a8a:
-    case 0x9a9a:
-    case 0xaaaa:
-    case 0xbaba:
-    case 0xcaca:
-    case 0xdada:
-    case 0xeaea:
-    case 0xfafa:
+    /*
+     * a sixteen-bit value is GREASE exactly when its two bytes are
+     * equal and both low nibbles are 0xa; testing that directly
+     * compiles to a conditional move, where the sixteen-case switch
+     * it replaces mispredicted on exactly the randomized values that
+     * GREASE inserts
+     */
+    if (((x >> 8) == (x & 0x00ff)) && ((x & 0x0f0f) == 0x0a0a)) {
         return 0x0a0a;
-        break;
-    default:
-        return x;
     }
     return x;
 }
@@ -908,6 +1034,29 @@ void degrease_octet_string(void *data, ssize_t len) {
     uint16_t *x = (uint16_t *)data;
     uint16_t *end = x + (len/2);
 
+#if defined(__x86_64__)
+    /*
+     * a sixteen-bit value is GREASE exactly when its two bytes are
+     * equal and both low nibbles are 0xa, so eight values at a time
+     * can be tested with a byte swap and two compares, and the
+     * matching values blended to 0x0a0a; SSE2 is part of the x86-64
+     * baseline, so this path needs no runtime dispatch.  The scalar
+     * loop below handles the remaining values.
+     */
+    const __m128i low_nibbles = _mm_set1_epi16(0x0f0f);
+    const __m128i grease = _mm_set1_epi16(0x0a0a);
+
+    while (end - x >= 8) {
+        __m128i v = _mm_loadu_si128((__m128i *)x);
+        __m128i swapped = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        __m128i m = _mm_and_si128(_mm_cmpeq_epi16(v, swapped),
+                                  _mm_cmpeq_epi16(_mm_and_si128(v, low_nibbles), grease));
+        v = _mm_or_si128(_mm_andnot_si128(m, v), _mm_and_si128(m, grease));
+        _mm_storeu_si128((__m128i *)x, v);
+        x += 8;
+    }
+#endif
+
     while (x < end) {
         *x = degrease_uint16(*x);
         x++;
@@ -1713,9 +1862,59 @@ unsigned int parser_extractor_process_http_server(struct datum *p, struct extrac
 #define L_ssh_comp_algos_server_to_client_len  4
 #define L_ssh_languages_client_to_server_len   4
 #define L_ssh_languages_server_to_client_len   4
+#define L_ssh_name_list_len                    4
+
+/*
+ * parser_extractor_ssh_name_lists(p, x, num_lists) processes the
+ * sequence of num_lists SSH name-lists at the front of the parser p
+ * in a single pass, accounting for each list in the extractor
+ * output.  The output of the SSH path is only ever consumed through
+ * its length (see packet_filter_apply()), so each list is captured
+ * zero-copy: its capture length is encoded into the output stream
+ * and room for the list is reserved, but the comma-separated names
+ * themselves are left in place in the packet buffer instead of being
+ * copied out.  This keeps KEX_INIT bursts from spending one memcpy
+ * per name-list per packet.
+ *
+ * The return value is the number of complete name-lists processed;
+ * as with the copying loop that this function replaces, processing
+ * stops at the first truncated list, retaining the lists that came
+ * before it.
+ */
+static unsigned int parser_extractor_ssh_name_lists(struct datum *p,
+                                                    struct extractor *x,
+                                                    unsigned int num_lists) {
+    unsigned int i;
+
+    for (i = 0; i < num_lists; i++) {
+        size_t len;
+        unsigned char *capture;
+
+        if (parser_read_and_skip_uint(p, L_ssh_name_list_len, &len) == status_err) {
+            break;
+        }
+        if (p->data + len > p->data_end) {
+            break;
+        }
+        if (extractor_reserve(x, &capture, len + sizeof(uint16_t)) == status_err) {
+            break;
+        }
+        x->last_capture = capture;
+        encode_uint16(capture, len);
+        p->data += len;
+    }
+    return i;
+}
+
+/*
+ * a KEX_INIT message carries ten name-lists: kex algorithms, server
+ * host key algorithms, and the client-to-server and server-to-client
+ * lists for encryption, mac, compression, and languages
+ */
+#define L_ssh_num_kexinit_name_lists          10
 
 unsigned int parser_extractor_process_ssh(struct datum *p, struct extractor *x) {
-    size_t packet_length, padding_length, payload, tmp;
+    size_t packet_length, padding_length, payload;
     // uint16_t ssh_proto_number = htons(SSH_PORT);
     const unsigned char ssh_first_packet[] = {
         'S', 'S', 'H', '-', '2', '.', '0', '-'
@@ -1788,66 +1987,7 @@ unsigned int parser_extractor_process_ssh(struct datum *p, struct extractor *x)
             goto bail;
         }
 
-        if (parser_read_and_skip_uint(p, L_ssh_kex_algo_len, &tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_extractor_copy(p, x, tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_read_and_skip_uint(p, L_ssh_server_host_key_algos_len, &tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_extractor_copy(p, x, tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_read_and_skip_uint(p, L_ssh_enc_algos_client_to_server_len, &tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_extractor_copy(p, x, tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_read_and_skip_uint(p, L_ssh_enc_algos_server_to_client_len, &tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_extractor_copy(p, x, tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_read_and_skip_uint(p, L_ssh_mac_algos_client_to_server_len, &tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_extractor_copy(p, x, tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_read_and_skip_uint(p, L_ssh_mac_algos_server_to_client_len, &tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_extractor_copy(p, x, tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_read_and_skip_uint(p, L_ssh_comp_algos_client_to_server_len, &tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_extractor_copy(p, x, tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_read_and_skip_uint(p, L_ssh_comp_algos_server_to_client_len, &tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_extractor_copy(p, x, tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_read_and_skip_uint(p, L_ssh_languages_client_to_server_len, &tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_extractor_copy(p, x, tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_read_and_skip_uint(p, L_ssh_languages_server_to_client_len, &tmp) == status_err) {
-            goto bail;
-        }
-        if (parser_extractor_copy(p, x, tmp) == status_err) {
-            goto bail;
-        }
+        parser_extractor_ssh_name_lists(p, x, L_ssh_num_kexinit_name_lists);
     }
 
     extractor_debug("%s: done parsing KEX (output length: %td)\n", __func__, extractor_get_output_length(x));
@@ -1859,7 +1999,7 @@ unsigned int parser_extractor_process_ssh(struct datum *p, struct extractor *x)
 }
 
 unsigned int parser_extractor_process_ssh_kex(struct datum *p, struct extractor *x) {
-    size_t packet_length, padding_length, payload, tmp;
+    size_t packet_length, padding_length, payload;
 
     extractor_debug("%s: processing packet\n", __func__)
     x->fingerprint_type = fingerprint_type_ssh_kex;
@@ -1893,66 +2033,7 @@ unsigned int parser_extractor_process_ssh_kex(struct datum *p, struct extractor
         goto bail;
     }
 
-    if (parser_read_and_skip_uint(p, L_ssh_kex_algo_len, &tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_extractor_copy(p, x, tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_read_and_skip_uint(p, L_ssh_server_host_key_algos_len, &tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_extractor_copy(p, x, tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_read_and_skip_uint(p, L_ssh_enc_algos_client_to_server_len, &tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_extractor_copy(p, x, tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_read_and_skip_uint(p, L_ssh_enc_algos_server_to_client_len, &tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_extractor_copy(p, x, tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_read_and_skip_uint(p, L_ssh_mac_algos_client_to_server_len, &tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_extractor_copy(p, x, tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_read_and_skip_uint(p, L_ssh_mac_algos_server_to_client_len, &tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_extractor_copy(p, x, tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_read_and_skip_uint(p, L_ssh_comp_algos_client_to_server_len, &tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_extractor_copy(p, x, tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_read_and_skip_uint(p, L_ssh_comp_algos_server_to_client_len, &tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_extractor_copy(p, x, tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_read_and_skip_uint(p, L_ssh_languages_client_to_server_len, &tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_extractor_copy(p, x, tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_read_and_skip_uint(p, L_ssh_languages_server_to_client_len, &tmp) == status_err) {
-        goto bail;
-    }
-    if (parser_extractor_copy(p, x, tmp) == status_err) {
-        goto bail;
-    }
+    parser_extractor_ssh_name_lists(p, x, L_ssh_num_kexinit_name_lists);
 
     extractor_debug("%s: done parsing KEX (output length: %td)\n", __func__, extractor_get_output_length(x));
 
@@ -2047,7 +2128,8 @@ unsigned int parser_extractor_process_tcp_data(struct datum *p, struct extractor
 #define L_ip_src_addr       4
 #define L_ip_dst_addr       4
 
-unsigned int parser_process_ipv4(struct datum *p, size_t *transport_protocol, struct key *k) {
+unsigned int parser_process_ipv4(struct datum *p, size_t *transport_protocol, struct key *k,
+                                 struct ip_fragment_fields *frag) {
     size_t version_ihl;
     uint8_t *transport_data;
 
@@ -2078,9 +2160,22 @@ unsigned int parser_process_ipv4(struct datum *p, size_t *transport_protocol, st
         return 0;
     }
     parser_set_data_length(p, ip_total_length - (L_ip_version_ihl + L_ip_tos + L_ip_total_length));
-    if (parser_skip(p, L_ip_identification + L_ip_flags_frag_off + L_ip_ttl) == status_err) {
+    size_t identification;
+    if (parser_read_and_skip_uint(p, L_ip_identification, &identification) == status_err) {
+        return 0;
+    }
+    size_t flags_frag_off;
+    if (parser_read_and_skip_uint(p, L_ip_flags_frag_off, &flags_frag_off) == status_err) {
+        return 0;
+    }
+    if (parser_skip(p, L_ip_ttl) == status_err) {
         return 0;
     }
+    if (frag != NULL) {
+        frag->identification = identification;
+        frag->offset = (flags_frag_off & 0x1fff) << 3;   /* in 8-octet units on the wire */
+        frag->more_fragments = (flags_frag_off & 0x2000) != 0;
+    }
     if (parser_read_and_skip_uint(p, L_ip_protocol, transport_protocol) == status_err) {
         return 0;
     }
@@ -2167,8 +2262,13 @@ unsigned int parser_process_ipv4(struct datum *p, size_t *transport_protocol, st
 #define L_ipv6_destination_address  16
 #define L_ipv6_hdr_ext_len           1
 #define L_ipv6_ext_hdr_base          8
+#define L_ipv6_frag_reserved         1
+#define L_ipv6_frag_off_flags        2
+#define L_ipv6_frag_identification   4
+#define L_ipv6_ext_hdr_max           8   /* longest legitimate extension header chain */
 
-unsigned int parser_process_ipv6(struct datum *p, size_t *transport_protocol, struct key *k) {
+unsigned int parser_process_ipv6(struct datum *p, size_t *transport_protocol, struct key *k,
+                                 struct ip_fragment_fields *frag) {
     size_t version_tc_hi;
     size_t payload_length;
     size_t next_header;
@@ -2208,18 +2308,82 @@ unsigned int parser_process_ipv6(struct datum *p, size_t *transport_protocol, st
     k->ip_vers = 6;  // ipv6
     k->protocol = 6; // tcp
 
-    /* loop over extensions headers until we find an upper layer protocol */
+    /*
+     * walk the extension header chain until an upper-layer protocol
+     * is found, skipping each known extension header by its own
+     * length rule: the common RFC 6564 layout measures Hdr Ext Len in
+     * 8-octet units beyond the first eight octets, AH measures its
+     * Payload Len in 4-octet units minus two (RFC 4302, Section 2.2),
+     * and ESP cannot be skipped at all, since everything after its
+     * header is encrypted.  The walk is bounded: RFC 8200 lets each
+     * header appear at most once (destination options at most twice),
+     * so a longer chain is hostile or garbage and the packet is
+     * dropped rather than walked indefinitely.
+     */
     unsigned int not_done = 1;
+    unsigned int ext_hdr_count = 0;
     while (not_done) {
         size_t ext_hdr_len;
 
+        if (ext_hdr_count++ > L_ipv6_ext_hdr_max) {
+            return 0;
+        }
         switch (next_header) {
+        case IPPROTO_FRAGMENT:
+            /*
+             * the fragment header is fixed-length (RFC 8200, Section
+             * 4.5), with a reserved octet where the other extension
+             * headers carry Hdr Ext Len: next header, reserved, a
+             * 16-bit field packing the 13-bit fragment offset (in
+             * 8-octet units) and the M flag, and a 32-bit
+             * identification
+             */
+            {
+                size_t off_flags, identification;
+                if (parser_read_uint(p, L_ipv6_next_header, &next_header) == status_err) {
+                    return 0;
+                }
+                if (parser_skip(p, L_ipv6_next_header + L_ipv6_frag_reserved) == status_err) {
+                    return 0;
+                }
+                if (parser_read_and_skip_uint(p, L_ipv6_frag_off_flags, &off_flags) == status_err) {
+                    return 0;
+                }
+                if (parser_read_and_skip_uint(p, L_ipv6_frag_identification, &identification) == status_err) {
+                    return 0;
+                }
+                if (frag != NULL) {
+                    frag->identification = identification;
+                    frag->offset = off_flags & 0xfff8;   /* in byte units once the flags are masked */
+                    frag->more_fragments = (off_flags & 0x0001) != 0;
+                }
+            }
+            break;
+
         case IPPROTO_HOPOPTS:
         case IPPROTO_ROUTING:
-        case IPPROTO_FRAGMENT:
-        case IPPROTO_ESP:
-        case IPPROTO_AH:
         case IPPROTO_DSTOPTS:
+        case 135:     /* mobility (RFC 6275); same RFC 6564 layout */
+        case 139:     /* HIP (RFC 7401)                            */
+        case 140:     /* shim6 (RFC 5533)                          */
+            if (parser_read_uint(p, L_ipv6_next_header, &next_header) == status_err) {
+                return 0;
+            }
+            if (parser_skip(p, L_ipv6_next_header) == status_err) {
+                return 0;
+            }
+            if (parser_read_uint(p, L_ipv6_hdr_ext_len, &ext_hdr_len) == status_err) {
+                return 0;
+            }
+            /* the header is 8 * (ext_hdr_len + 1) octets, of which
+             * the next header octet has already been consumed */
+            if (parser_skip(p, L_ipv6_ext_hdr_base - L_ipv6_next_header + ext_hdr_len * 8) == status_err) {
+                return 0;
+            }
+
+            break;
+
+        case IPPROTO_AH:
             if (parser_read_uint(p, L_ipv6_next_header, &next_header) == status_err) {
                 return 0;
             }
@@ -2229,12 +2393,15 @@ unsigned int parser_process_ipv6(struct datum *p, size_t *transport_protocol, st
             if (parser_read_uint(p, L_ipv6_hdr_ext_len, &ext_hdr_len) == status_err) {
                 return 0;
             }
-            if (parser_skip(p, L_ipv6_ext_hdr_base + ext_hdr_len) == status_err) {
+            /* AH is 4 * (payload_len + 2) octets (RFC 4302), of
+             * which the next header octet has already been consumed */
+            if (parser_skip(p, (ext_hdr_len + 2) * 4 - L_ipv6_next_header) == status_err) {
                 return 0;
             }
 
             break;
 
+        case IPPROTO_ESP:     /* everything after the ESP header is encrypted */
         case IPPROTO_NONE:
         default:
             not_done = 0;
@@ -2295,6 +2462,101 @@ unsigned int parser_process_eth(struct datum *p, size_t *ethertype) {
     return 0;  /* we don't extract any data, but this is not a failure */
 }
 
+/*
+ * packet_filter_process_ip() processes a bare IP packet, that is, one
+ * with no ethernet header, as found inside GTP-U and GRE tunnels.
+ * The IP version is determined from the version field of the header.
+ */
+
+unsigned int packet_filter_process_ip(struct packet_filter *pf, struct key *k) {
+    size_t transport_proto = 0;
+
+    if (parser_get_data_length(&pf->p) < 1) {
+        return 0;
+    }
+    switch(pf->p.data[0] & 0xf0) {
+    case 0x40:
+        parser_process_ipv4(&pf->p, &transport_proto, k);
+        break;
+    case 0x60:
+        parser_process_ipv6(&pf->p, &transport_proto, k);
+        break;
+    default:
+        return 0;
+    }
+    if (transport_proto == 6) {
+        pf->x.tcp = pf->p;
+        return packet_filter_process_tcp(pf, k);
+
+    } else if (transport_proto == 17) {
+        return packet_filter_process_udp(pf, k);
+    }
+
+    return 0;
+}
+
+/*
+ *  GRE Header (RFC 2784):
+ *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *  |C|R|K|S| Reserved0             | Ver |       Protocol Type     |
+ *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *  |     Checksum (optional)       |     Reserved1 (optional)      |
+ *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *  |                       Key (optional, RFC 2890)                |
+ *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *  |                 Sequence Number (optional, RFC 2890)          |
+ *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ */
+
+#define GRE_FLAG_CHECKSUM 0x8000
+#define GRE_FLAG_KEY      0x2000
+#define GRE_FLAG_SEQUENCE 0x1000
+#define GRE_VERSION_MASK  0x0007
+
+enum status parser_skip_gre_header(struct datum *p, size_t *ethertype) {
+    size_t flags_and_version = 0;
+
+    *ethertype = ETH_TYPE_NONE;
+
+    if (parser_read_and_skip_uint(p, sizeof(uint16_t), &flags_and_version) == status_err) {
+        return status_err;
+    }
+    if (flags_and_version & GRE_VERSION_MASK) {
+        return status_err;   /* version 1 (PPTP) and up are not supported */
+    }
+    if (parser_read_and_skip_uint(p, sizeof(uint16_t), ethertype) == status_err) {
+        return status_err;
+    }
+    if (flags_and_version & GRE_FLAG_CHECKSUM) {
+        if (parser_skip(p, sizeof(uint32_t)) == status_err) { // checksum, reserved1
+            return status_err;
+        }
+    }
+    if (flags_and_version & GRE_FLAG_KEY) {
+        if (parser_skip(p, sizeof(uint32_t)) == status_err) {
+            return status_err;
+        }
+    }
+    if (flags_and_version & GRE_FLAG_SEQUENCE) {
+        if (parser_skip(p, sizeof(uint32_t)) == status_err) {
+            return status_err;
+        }
+    }
+    return status_ok;
+}
+
+unsigned int packet_filter_process_gre(struct packet_filter *pf, struct key *k) {
+    size_t ethertype = 0;
+
+    if (parser_skip_gre_header(&pf->p, &ethertype) != status_ok) {
+        return 0;
+    }
+    if (ethertype == ETH_TYPE_IP || ethertype == ETH_TYPE_IPV6) {
+        return packet_filter_process_ip(pf, k);
+    }
+    return 0;
+}
+
 unsigned int packet_filter_process_packet(struct packet_filter *pf, struct key *k) {
     size_t transport_proto = 0;
     size_t ethertype = 0;
@@ -2316,6 +2578,9 @@ unsigned int packet_filter_process_packet(struct packet_filter *pf, struct key *
 
     } else if (transport_proto == 17) {
         return packet_filter_process_udp(pf, k);
+
+    } else if (transport_proto == 47) {
+        return packet_filter_process_gre(pf, k);
     }
 
     return 0;
@@ -2341,15 +2606,233 @@ enum status packet_filter_init(struct packet_filter *pf, const char *config_stri
     return status_ok;
 }
 
+/*
+ * per-protocol accounting (see extractor.h); each worker thread
+ * counts into its own extractor_protocol_stats, which is registered
+ * in a process-wide table on first use so that a telemetry thread can
+ * merge the per-thread counts without stopping the workers
+ */
+#define EXTRACTOR_STATS_MAX_THREADS 64
+static struct extractor_protocol_stats *extractor_stats_registry[EXTRACTOR_STATS_MAX_THREADS];
+static int extractor_stats_num_registered = 0;
+static pthread_mutex_t extractor_stats_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool extractor_stats_cycle_sampling = false;
+static bool extractor_stats_profiling = false;
+static uint64_t extractor_stats_sample_mask = 63;   /* sample every 64th packet by default */
+
+/*
+ * cycle counter used by the optional parse-cost sampling; reads the
+ * timestamp counter on x86, and reports zero cycles elsewhere
+ */
+#if defined(__x86_64__) || defined(__i386__)
+static inline uint64_t extractor_read_cycle_counter() {
+    return __builtin_ia32_rdtsc();
+}
+#else
+static inline uint64_t extractor_read_cycle_counter() {
+    return 0;
+}
+#endif
+
+static struct extractor_protocol_stats *extractor_stats_get() {
+    static thread_local struct extractor_protocol_stats *stats = NULL;
+    if (stats == NULL) {
+        /* allocated once per thread and deliberately never freed, so
+         * that the registry entry stays valid after the thread exits
+         * and the final report still sees its counts */
+        stats = new extractor_protocol_stats();
+        pthread_mutex_lock(&extractor_stats_registry_mutex);
+        if (extractor_stats_num_registered < EXTRACTOR_STATS_MAX_THREADS) {
+            extractor_stats_registry[extractor_stats_num_registered++] = stats;
+        }
+        pthread_mutex_unlock(&extractor_stats_registry_mutex);
+    }
+    return stats;
+}
+
+void extractor_stats_set_cycle_sampling(bool value) {
+    extractor_stats_cycle_sampling = value;
+}
+
+/*
+ * enables profile mode and sets its sampling rate; the rate is
+ * rounded down to a power of two, so that picking a sample costs one
+ * mask instead of a division in the per-packet path
+ */
+void extractor_stats_set_sample_rate(unsigned int rate) {
+    uint64_t mask = 1;
+    while ((mask << 1) <= rate) {
+        mask <<= 1;
+    }
+    extractor_stats_sample_mask = mask - 1;
+    extractor_stats_profiling = true;
+}
+
+/*
+ * the packet-size bucket of a sampled packet: power-of-two buckets
+ * from 64 bytes up, with everything 4096 and over in the last one
+ */
+static inline unsigned int extractor_stats_size_bucket(size_t length) {
+    unsigned int bucket = 0;
+    size_t boundary = 64;
+    while (bucket < EXTRACTOR_STATS_SIZE_BUCKETS - 1 && length >= boundary) {
+        bucket++;
+        boundary <<= 1;
+    }
+    return bucket;
+}
+
+/*
+ * extractor_stats_sample_due() advances this thread's sample clock
+ * and reports whether the current packet should be timed; the two
+ * cycle-counter reads then only sit in the path of sampled packets
+ */
+bool extractor_stats_sample_due() {
+    static thread_local uint64_t sample_clock = 0;
+    return (extractor_stats_cycle_sampling || extractor_stats_profiling)
+        && ((sample_clock++ & extractor_stats_sample_mask) == 0);
+}
+
+uint64_t extractor_stats_cycles() {
+    return extractor_read_cycle_counter();
+}
+
+/*
+ * extractor_stats_account() counts one processed packet into this
+ * thread's per-protocol stats; cycles is only meaningful when sampled
+ * is set.  Both entry points into protocol processing (the packet
+ * filter, and the JSON serialization path in json_file_io.c) account
+ * here, so the reports cover whichever path a configuration uses.
+ */
+void extractor_stats_account(unsigned int type, size_t length, bool sampled, uint64_t cycles) {
+    struct extractor_protocol_stats *stats = extractor_stats_get();
+    if (type >= EXTRACTOR_STATS_NUM_MSG_TYPES) {
+        type = msg_type_unknown;
+    }
+    stats->packets[type]++;
+    stats->bytes[type] += length;
+    if (sampled) {
+        stats->sampled_cycles[type] += cycles;
+        stats->sampled_packets[type]++;
+        if (extractor_stats_profiling) {
+            unsigned int bucket = extractor_stats_size_bucket(length);
+            stats->sampled_size_cycles[type][bucket] += cycles;
+            stats->sampled_size_packets[type][bucket]++;
+        }
+    }
+}
+
+void extractor_stats_sum(struct extractor_protocol_stats *sum) {
+    memset(sum, 0, sizeof(*sum));
+    pthread_mutex_lock(&extractor_stats_registry_mutex);
+    int num_registered = extractor_stats_num_registered;
+    pthread_mutex_unlock(&extractor_stats_registry_mutex);
+    for (int i = 0; i < num_registered; i++) {
+        /* each counter has a single writer; reading it without a lock
+         * gives an approximate but consistent-enough snapshot, as with
+         * the per-thread packet counters in af_packet_v3.c */
+        const struct extractor_protocol_stats *tstats = extractor_stats_registry[i];
+        for (int type = 0; type < EXTRACTOR_STATS_NUM_MSG_TYPES; type++) {
+            sum->packets[type] += tstats->packets[type];
+            sum->bytes[type] += tstats->bytes[type];
+            sum->sampled_packets[type] += tstats->sampled_packets[type];
+            sum->sampled_cycles[type] += tstats->sampled_cycles[type];
+            for (int b = 0; b < EXTRACTOR_STATS_SIZE_BUCKETS; b++) {
+                sum->sampled_size_packets[type][b] += tstats->sampled_size_packets[type][b];
+                sum->sampled_size_cycles[type][b] += tstats->sampled_size_cycles[type][b];
+            }
+        }
+    }
+}
+
+/*
+ * prints the profile histogram: one line per (protocol, size bucket)
+ * pair that recorded samples, with the sample count and the average
+ * parse cost in cycles
+ */
+void extractor_stats_profile_print(FILE *f) {
+    struct extractor_protocol_stats sum;
+    extractor_stats_sum(&sum);
+
+    fprintf(f, "parse-cost profile (sampled every %" PRIu64 " packets):\n",
+            extractor_stats_sample_mask + 1);
+    for (int type = 0; type < EXTRACTOR_STATS_NUM_MSG_TYPES; type++) {
+        for (int b = 0; b < EXTRACTOR_STATS_SIZE_BUCKETS; b++) {
+            uint64_t samples = sum.sampled_size_packets[type][b];
+            if (samples == 0) {
+                continue;
+            }
+            unsigned int lo = b == 0 ? 0 : 32 << b;
+            if (b < EXTRACTOR_STATS_SIZE_BUCKETS - 1) {
+                fprintf(f, "  %-17s %5u-%4u bytes: ", msg_type_string((enum msg_type)type),
+                        lo, (64 << b) - 1);
+            } else {
+                fprintf(f, "  %-17s %5u+     bytes: ", msg_type_string((enum msg_type)type), lo);
+            }
+            fprintf(f, "%10" PRIu64 " samples, %8" PRIu64 " cycles/packet\n",
+                    samples, sum.sampled_size_cycles[type][b] / samples);
+        }
+    }
+}
+
+const char *msg_type_string(enum msg_type type) {
+    switch (type) {
+    case msg_type_http_request:      return "http_request";
+    case msg_type_http_response:     return "http_response";
+    case msg_type_tls_client_hello:  return "tls_client_hello";
+    case msg_type_tls_server_hello:  return "tls_server_hello";
+    case msg_type_tls_certificate:   return "tls_certificate";
+    case msg_type_ssh:               return "ssh";
+    case msg_type_ssh_kex:           return "ssh_kex";
+    case msg_type_dns:               return "dns";
+    case msg_type_dhcp:              return "dhcp";
+    case msg_type_dtls_client_hello: return "dtls_client_hello";
+    case msg_type_dtls_server_hello: return "dtls_server_hello";
+    case msg_type_dtls_certificate:  return "dtls_certificate";
+    case msg_type_wireguard:         return "wireguard";
+    case msg_type_quic_init:         return "quic_init";
+    case msg_type_http2:             return "http2";
+    case msg_type_unknown:
+    default:
+        return "unknown";
+    }
+}
+
 size_t packet_filter_extract(struct packet_filter *pf, struct key *k, uint8_t *packet, size_t length) {
+    return packet_filter_extract_to(pf, k, packet, length,
+                                    pf->extractor_buffer, sizeof(packet_filter::extractor_buffer));
+}
+
+size_t packet_filter_extract_to(struct packet_filter *pf, struct key *k, uint8_t *packet, size_t length,
+                                unsigned char *output, size_t output_len) {
 
-    extractor_init(&pf->x, pf->extractor_buffer, sizeof(packet_filter::extractor_buffer));
+    extractor_init(&pf->x, output, output_len);
     parser_init(&pf->p, (unsigned char *)packet, length);
-    return packet_filter_process_packet(pf, k);
+
+    uint64_t start_cycles = 0;
+    bool sampled = extractor_stats_sample_due();
+    if (sampled) {
+        start_cycles = extractor_stats_cycles();
+    }
+
+    size_t bytes_extracted = packet_filter_process_packet(pf, k);
+
+    extractor_stats_account(pf->x.msg_type, length, sampled,
+                            sampled ? extractor_stats_cycles() - start_cycles : 0);
+    return bytes_extracted;
 }
 
+/*
+ * packet_filter_threshold is a (somewhat arbitrary) threshold used in
+ * the packet metadata filter; it will probably get eliminated soon,
+ * in favor of extractor::proto_state::state, but for now it remains.
+ * It is defined here, rather than in pkt_proc.cc where most of its
+ * users live, so that libmerc.a is self-contained for standalone
+ * consumers (see src/cython)
+ */
+unsigned int packet_filter_threshold = 7;
+
 bool packet_filter_apply(struct packet_filter *pf, uint8_t *packet, size_t length) {
-    extern unsigned int packet_filter_threshold;
     struct key k;
     size_t bytes_extracted = packet_filter_extract(pf, &k, packet, length);
     if (bytes_extracted > packet_filter_threshold) {
@@ -2362,12 +2845,64 @@ bool packet_filter_apply(struct packet_filter *pf, uint8_t *packet, size_t lengt
  * configuration for protocol identification
  */
 
-extern unsigned char dhcp_client_mask[8];  /* udp.c */
-extern unsigned char dns_server_mask[8];   /* udp.c */
-extern unsigned char wireguard_mask[8];    /* udp.c */
+extern unsigned char dhcp_client_mask[8];   /* udp.c */
+extern unsigned char dns_server_mask[8];    /* udp.c */
+extern unsigned char wireguard_mask[8];     /* udp.c */
+extern unsigned char quic_initial_mask[8];  /* udp.c */
 
+/*
+ * protocol selection works by zeroing the masks of deselected
+ * protocols in place, so re-selecting a protocol at runtime (see
+ * proto_ident_reconfig() below) needs the original mask bytes back;
+ * proto_ident_mask_defaults captures them before the first selection
+ * is applied
+ */
+struct proto_ident_mask_default {
+    unsigned char *mask;
+    size_t len;
+    unsigned char saved[MASKED_PATTERN_LEN];
+};
+
+static struct proto_ident_mask_default proto_ident_mask_defaults[] = {
+    { dhcp_client_mask,              sizeof(dhcp_client_mask),              { 0 } },
+    { dns_server_mask,               sizeof(dns_server_mask),               { 0 } },
+    { wireguard_mask,                sizeof(wireguard_mask),                { 0 } },
+    { quic_initial_mask,             sizeof(quic_initial_mask),             { 0 } },
+    { http_client_mask,              sizeof(http_client_mask),              { 0 } },
+    { http_client_post_mask,         sizeof(http_client_post_mask),         { 0 } },
+    { http_server_mask,              sizeof(http_server_mask),              { 0 } },
+    { http2_preface_mask,            sizeof(http2_preface_mask),            { 0 } },
+    { ssh_mask,                      sizeof(ssh_mask),                      { 0 } },
+    { ssh_kex_mask,                  sizeof(ssh_kex_mask),                  { 0 } },
+    { tls_client_hello_mask,         sizeof(tls_client_hello_mask),         { 0 } },
+    { tls_server_cert_embedded_mask, sizeof(tls_server_cert_embedded_mask), { 0 } },
+};
+
+static void proto_ident_masks_save() {
+    static bool saved = false;
+    if (saved) {
+        return;
+    }
+    for (auto &d : proto_ident_mask_defaults) {
+        memcpy(d.saved, d.mask, d.len);
+    }
+    saved = true;
+}
+
+static void proto_ident_masks_restore() {
+    for (auto &d : proto_ident_mask_defaults) {
+        memcpy(d.mask, d.saved, d.len);
+    }
+    select_tcp_syn = 1;
+    tcp_message_filter_cutoff = 0;
+}
+
+/* the last selection string that parsed successfully, kept so that a
+ * failed runtime reconfiguration can fall back to it */
+static char proto_ident_current[256] = "";
 
 enum status proto_ident_config(const char *config_string) {
+    proto_ident_masks_save();
     if (config_string == NULL) {
         return status_ok;    /* use the default configuration */
     }
@@ -2378,6 +2913,7 @@ enum status proto_ident_config(const char *config_string) {
         { "dns",         false },
         { "dtls",        false },
         { "http",        false },
+        { "quic",        false },
         { "ssh",         false },
         { "tcp",         false },
         { "tcp.message", false },
@@ -2412,6 +2948,8 @@ enum status proto_ident_config(const char *config_string) {
         return status_err;
     }
 
+    strncpy(proto_ident_current, config_string, sizeof(proto_ident_current)-1);
+
     if (protocols["all"] == true) {
         return status_ok;
     }
@@ -2425,6 +2963,10 @@ enum status proto_ident_config(const char *config_string) {
         bzero(http_client_mask, sizeof(http_client_mask));
         bzero(http_client_post_mask, sizeof(http_client_post_mask));
         bzero(http_server_mask, sizeof(http_server_mask));
+        bzero(http2_preface_mask, sizeof(http2_preface_mask));
+    }
+    if (protocols["quic"] == false) {
+        bzero(quic_initial_mask, sizeof(quic_initial_mask));
     }
     if (protocols["ssh"] == false) {
         bzero(ssh_kex_mask, sizeof(ssh_kex_mask));
@@ -2447,4 +2989,31 @@ enum status proto_ident_config(const char *config_string) {
     return status_ok;
 }
 
+/*
+ * proto_ident_reconfig() changes the selected protocols at runtime
+ * (see control.c): it restores the default masks, applies the new
+ * selection, and rebuilds the TCP and UDP pattern matchers, each of
+ * which is published with an atomic pointer swap that worker threads
+ * pick up at the next packet.  An unparseable selection string leaves
+ * the previous selection in place.  The masks themselves are rewritten
+ * in place, so a sub-sixteen-byte payload classified through the
+ * scalar chains during the rewrite may see a mix of old and new
+ * selections for one packet; the matcher paths never do.
+ */
+static pthread_mutex_t proto_ident_reconfig_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+enum status proto_ident_reconfig(const char *config_string) {
+    pthread_mutex_lock(&proto_ident_reconfig_mutex);
+    proto_ident_masks_save();
+    proto_ident_masks_restore();
+    enum status status = proto_ident_config(config_string);
+    if (status != status_ok && proto_ident_current[0] != 0) {
+        proto_ident_config(proto_ident_current);  /* fall back to the last good selection */
+    }
+    tcp_matchers_rebuild();
+    udp_matchers_rebuild();
+    pthread_mutex_unlock(&proto_ident_reconfig_mutex);
+    return status;
+}
+
 
@@ -245,8 +245,74 @@ size_t packet_filter_extract(struct packet_filter *pf,
                              uint8_t *packet,
                              size_t length);
 
+/*
+ * packet_filter_extract_to() is packet_filter_extract() with the
+ * extraction written into the caller's buffer instead of the filter's
+ * own scratch buffer, so a caller that keeps the extracted bytes
+ * receives them where they are written rather than copying them out
+ * afterwards
+ */
+size_t packet_filter_extract_to(struct packet_filter *pf,
+                                struct key *k,
+                                uint8_t *packet,
+                                size_t length,
+                                unsigned char *output,
+                                size_t output_len);
+
+/*
+ * Per-protocol packet, byte, and cycle accounting.  Each worker
+ * thread accumulates one extractor_protocol_stats, indexed by the
+ * msg_type that packet_filter_extract() assigns to each packet; the
+ * per-thread counter sets are registered in a process-wide table so
+ * that a telemetry thread can merge them with extractor_stats_sum()
+ * while the workers keep counting.  When cycle sampling is enabled
+ * (see extractor_stats_set_cycle_sampling()), every 64th packet is
+ * timed with the cycle counter, so that the average parse cost of
+ * each protocol can be reported without putting two timestamp reads
+ * in the path of every packet.
+ *
+ * The built-in sampling profiler (--profile-sampling) uses the same
+ * machinery at a configurable rate, and additionally buckets each
+ * sampled packet's cycles by packet size (power-of-two buckets, 64
+ * bytes up), so that a profile attributes cost to a protocol at a
+ * size rather than to inlined symbols; the profile histogram is
+ * printed at exit by extractor_stats_profile_print().  This survives
+ * hosts where external profilers cannot be run.
+ */
+#define EXTRACTOR_STATS_NUM_MSG_TYPES (msg_type_http2 + 1)
+#define EXTRACTOR_STATS_SIZE_BUCKETS 8   /* <64, <128, ..., <4096, and larger */
+
+struct extractor_protocol_stats {
+    uint64_t packets[EXTRACTOR_STATS_NUM_MSG_TYPES];
+    uint64_t bytes[EXTRACTOR_STATS_NUM_MSG_TYPES];
+    uint64_t sampled_packets[EXTRACTOR_STATS_NUM_MSG_TYPES];
+    uint64_t sampled_cycles[EXTRACTOR_STATS_NUM_MSG_TYPES];
+    uint64_t sampled_size_packets[EXTRACTOR_STATS_NUM_MSG_TYPES][EXTRACTOR_STATS_SIZE_BUCKETS];
+    uint64_t sampled_size_cycles[EXTRACTOR_STATS_NUM_MSG_TYPES][EXTRACTOR_STATS_SIZE_BUCKETS];
+};
+
+void extractor_stats_set_cycle_sampling(bool value);
+
+void extractor_stats_set_sample_rate(unsigned int rate);
+
+bool extractor_stats_sample_due(void);
+
+uint64_t extractor_stats_cycles(void);
+
+void extractor_stats_account(unsigned int type, size_t length, bool sampled, uint64_t cycles);
+
+void extractor_stats_sum(struct extractor_protocol_stats *sum);
+
+void extractor_stats_profile_print(FILE *f);
+
+const char *msg_type_string(enum msg_type type);
+
 unsigned int packet_filter_process_packet(struct packet_filter *pf, struct key *k);
 
+unsigned int packet_filter_process_ip(struct packet_filter *pf, struct key *k);
+
+enum status parser_skip_gre_header(struct datum *p, size_t *ethertype);
+
 typedef unsigned int (*parser_extractor_func)(struct datum *p, struct extractor *x);
 
 #define proto_ident_mask_len 8
@@ -272,6 +338,18 @@ enum status proto_dispatch_add(struct proto_dispatch *pd,
 
 enum status proto_ident_config(const char *config_string);
 
+/*
+ * proto_ident_reconfig() changes the selected protocols at runtime:
+ * it restores the default masks, applies the new selection string,
+ * and republishes the pattern matchers with atomic pointer swaps, so
+ * worker threads see the new selection at the next packet.  An
+ * unparseable string returns status_err and leaves the previous
+ * selection in place.  Note that "tcp.message" cannot be enabled this
+ * way, because the per-thread TCP message filters are allocated at
+ * startup.
+ */
+enum status proto_ident_reconfig(const char *config_string);
+
 ptrdiff_t parser_get_data_length(struct datum *p);
 
 enum msg_type get_message_type(const uint8_t *tcp_data,
@@ -0,0 +1,258 @@
+/*
+ * flow_snapshot.c
+ *
+ * warm restart for per-thread flow state (--flow-snapshot); see
+ * flow_snapshot.h for the design
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "flow_snapshot.h"
+#include "mercury.h"
+#include "tcp.h"
+#include "extractor.h"
+
+#define FLOW_SNAPSHOT_MAGIC   0x6d66736e   /* "mfsn" */
+#define FLOW_SNAPSHOT_VERSION 1
+#define FLOW_SNAPSHOT_NAME_LEN 64
+
+/*
+ * the file is a header followed by the deduplication entries and then
+ * the TCP flow entries, all written as the structs below; the version
+ * number covers their layout
+ */
+struct flow_snapshot_hdr {
+    uint32_t magic;
+    uint32_t version;
+    char name[FLOW_SNAPSHOT_NAME_LEN];  /* the capture this state belongs to */
+    int64_t written_sec;                /* when the snapshot was taken       */
+    uint64_t dedup_count;
+    uint64_t tcp_flow_count;
+};
+
+struct flow_snapshot_tcp_entry {
+    struct key k;
+    struct tcp_state state;
+};
+
+/*
+ * the snapshot state: the image loaded at startup for the workers to
+ * restore from, and the entries they contribute at shutdown, gathered
+ * under a mutex (contention is no concern; each thread contributes
+ * once, at exit)
+ */
+static struct {
+    bool active;
+    char path[MAX_FILENAME];
+    char name[FLOW_SNAPSHOT_NAME_LEN];
+
+    struct flow_snapshot_dedup_entry *dedup_in;
+    size_t dedup_in_count;
+    struct flow_snapshot_tcp_entry *tcp_in;
+    size_t tcp_in_count;
+
+    pthread_mutex_t m;
+    struct flow_snapshot_dedup_entry *dedup_out;
+    size_t dedup_out_count;
+    size_t dedup_out_space;
+    struct flow_snapshot_tcp_entry *tcp_out;
+    size_t tcp_out_count;
+    size_t tcp_out_space;
+} snap = { false, {0}, {0}, NULL, 0, NULL, 0, PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, NULL, 0, 0 };
+
+/*
+ * loads the entries of an existing snapshot file; a missing file is a
+ * cold start and a malformed or mismatched one is ignored with a
+ * warning, so a bad snapshot costs only the warm start it would have
+ * provided
+ */
+static void flow_snapshot_load(void) {
+    FILE *f = fopen(snap.path, "r");
+    if (f == NULL) {
+        return;   /* cold start */
+    }
+
+    struct flow_snapshot_hdr hdr;
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1
+        || hdr.magic != FLOW_SNAPSHOT_MAGIC
+        || hdr.version != FLOW_SNAPSHOT_VERSION) {
+        fprintf(stderr, "warning: %s is not a flow snapshot file; starting cold\n", snap.path);
+        fclose(f);
+        return;
+    }
+    if (strncmp(hdr.name, snap.name, FLOW_SNAPSHOT_NAME_LEN) != 0) {
+        fprintf(stderr, "warning: flow snapshot %s was taken on %.*s, not %s; starting cold\n",
+                snap.path, FLOW_SNAPSHOT_NAME_LEN, hdr.name, snap.name);
+        fclose(f);
+        return;
+    }
+
+    struct flow_snapshot_dedup_entry *dedup = NULL;
+    struct flow_snapshot_tcp_entry *tcp = NULL;
+    if (hdr.dedup_count > 0) {
+        dedup = (struct flow_snapshot_dedup_entry *)calloc(hdr.dedup_count, sizeof(*dedup));
+    }
+    if (hdr.tcp_flow_count > 0) {
+        tcp = (struct flow_snapshot_tcp_entry *)calloc(hdr.tcp_flow_count, sizeof(*tcp));
+    }
+    if ((hdr.dedup_count > 0 && dedup == NULL)
+        || (hdr.tcp_flow_count > 0 && tcp == NULL)
+        || (hdr.dedup_count > 0 && fread(dedup, sizeof(*dedup), hdr.dedup_count, f) != hdr.dedup_count)
+        || (hdr.tcp_flow_count > 0 && fread(tcp, sizeof(*tcp), hdr.tcp_flow_count, f) != hdr.tcp_flow_count)) {
+        fprintf(stderr, "warning: could not read flow snapshot %s; starting cold\n", snap.path);
+        free(dedup);
+        free(tcp);
+        fclose(f);
+        return;
+    }
+    fclose(f);
+
+    snap.dedup_in = dedup;
+    snap.dedup_in_count = hdr.dedup_count;
+    snap.tcp_in = tcp;
+    snap.tcp_in_count = hdr.tcp_flow_count;
+
+    /*
+     * entries whose suppression window or flow has expired during the
+     * downtime need no screening here: an expired deduplication entry
+     * passes its next record anyway, and a dead flow is swept from
+     * the flow table by its normal expiry
+     */
+}
+
+int flow_snapshot_init(const char *path, const char *capture_name) {
+    if (strlen(path) >= MAX_FILENAME) {
+        fprintf(stderr, "error: flow snapshot path too long\n");
+        return -1;
+    }
+    strncpy(snap.path, path, MAX_FILENAME - 1);
+    strncpy(snap.name, capture_name, FLOW_SNAPSHOT_NAME_LEN - 1);
+    snap.active = true;
+    flow_snapshot_load();
+    return 0;
+}
+
+bool flow_snapshot_is_active(void) {
+    return snap.active;
+}
+
+size_t flow_snapshot_dedup_entries(const struct flow_snapshot_dedup_entry **entries) {
+    *entries = snap.dedup_in;
+    return snap.dedup_in_count;
+}
+
+/* appends an element to a gathered array, doubling it as needed;
+ * returns NULL (and reports once) if memory runs out, in which case
+ * the snapshot is written short rather than not at all */
+static void *gather_append(void **array, size_t *count, size_t *space, size_t elem_size) {
+    if (*count == *space) {
+        size_t new_space = (*space == 0) ? 4096 : *space * 2;
+        void *tmp = realloc(*array, new_space * elem_size);
+        if (tmp == NULL) {
+            return NULL;
+        }
+        *array = tmp;
+        *space = new_space;
+    }
+    return (char *)*array + (*count)++ * elem_size;
+}
+
+void flow_snapshot_note_dedup(uint64_t hash, int64_t last_emit) {
+    if (!snap.active) {
+        return;
+    }
+    pthread_mutex_lock(&snap.m);
+    struct flow_snapshot_dedup_entry *e =
+        (struct flow_snapshot_dedup_entry *)gather_append((void **)&snap.dedup_out,
+                                                          &snap.dedup_out_count,
+                                                          &snap.dedup_out_space,
+                                                          sizeof(*e));
+    if (e != NULL) {
+        e->hash = hash;
+        e->last_emit = last_emit;
+    }
+    pthread_mutex_unlock(&snap.m);
+}
+
+void flow_snapshot_restore_filter(struct packet_filter *pf) {
+    if (!snap.active || pf == NULL || pf->tcp_init_msg_filter == NULL) {
+        return;
+    }
+    /* every worker gets every flow: which worker a flow lands on
+     * after the restart is the fanout's decision, not ours, and an
+     * entry restored to the wrong worker is swept by normal expiry */
+    struct tcp_flow_table *t = &pf->tcp_init_msg_filter->tcp_flow_table;
+    for (size_t i = 0; i < snap.tcp_in_count; i++) {
+        t->insert(snap.tcp_in[i].k, snap.tcp_in[i].state);
+    }
+}
+
+void flow_snapshot_note_filter(const struct packet_filter *pf) {
+    if (!snap.active || pf == NULL || pf->tcp_init_msg_filter == NULL) {
+        return;
+    }
+    const struct tcp_flow_table *t = &pf->tcp_init_msg_filter->tcp_flow_table;
+    pthread_mutex_lock(&snap.m);
+    for (size_t i = 0; i < t->table_length; i++) {
+        if (t->table[i].k.ip_vers == 0) {
+            continue;
+        }
+        struct flow_snapshot_tcp_entry *e =
+            (struct flow_snapshot_tcp_entry *)gather_append((void **)&snap.tcp_out,
+                                                            &snap.tcp_out_count,
+                                                            &snap.tcp_out_space,
+                                                            sizeof(*e));
+        if (e == NULL) {
+            break;
+        }
+        e->k = t->table[i].k;
+        e->state = t->table[i].state;
+    }
+    pthread_mutex_unlock(&snap.m);
+}
+
+int flow_snapshot_write(void) {
+    if (!snap.active) {
+        return 0;
+    }
+
+    /* the file is replaced atomically, so a crash during the write
+     * leaves the previous snapshot in place rather than a torn one */
+    char tmp_path[MAX_FILENAME + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", snap.path);
+    FILE *f = fopen(tmp_path, "w");
+    if (f == NULL) {
+        fprintf(stderr, "warning: could not write flow snapshot %s: %s\n", tmp_path, strerror(errno));
+        return -1;
+    }
+
+    struct flow_snapshot_hdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = FLOW_SNAPSHOT_MAGIC;
+    hdr.version = FLOW_SNAPSHOT_VERSION;
+    memcpy(hdr.name, snap.name, FLOW_SNAPSHOT_NAME_LEN);
+    hdr.written_sec = time(NULL);
+    hdr.dedup_count = snap.dedup_out_count;
+    hdr.tcp_flow_count = snap.tcp_out_count;
+
+    if (fwrite(&hdr, sizeof(hdr), 1, f) != 1
+        || (snap.dedup_out_count > 0
+            && fwrite(snap.dedup_out, sizeof(*snap.dedup_out), snap.dedup_out_count, f) != snap.dedup_out_count)
+        || (snap.tcp_out_count > 0
+            && fwrite(snap.tcp_out, sizeof(*snap.tcp_out), snap.tcp_out_count, f) != snap.tcp_out_count)
+        || fclose(f) != 0) {
+        fprintf(stderr, "warning: could not write flow snapshot %s\n", tmp_path);
+        unlink(tmp_path);
+        return -1;
+    }
+    if (rename(tmp_path, snap.path) != 0) {
+        fprintf(stderr, "warning: could not move flow snapshot into place at %s: %s\n",
+                snap.path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
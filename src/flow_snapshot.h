@@ -0,0 +1,84 @@
+/*
+ * flow_snapshot.h
+ *
+ * warm restart for per-thread flow state (--flow-snapshot)
+ */
+
+#ifndef FLOW_SNAPSHOT_H
+#define FLOW_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+struct packet_filter;   /* defined in extractor.h */
+
+/*
+ * A flow-state snapshot lets a planned restart resume at steady-state
+ * cost: on shutdown the per-thread flow tables -- the deduplication
+ * table and the TCP initial-message-filter flow table -- are
+ * serialized to a file, and on the next start they are loaded back
+ * into every worker's tables, so the minutes of duplicate records and
+ * elevated CPU that an empty-table start costs are skipped.  The file
+ * is keyed to the capture interface; a snapshot taken on one capture
+ * is never restored onto another.
+ *
+ * Only steady-state tables are snapshotted.  The reassembly buffers
+ * hold messages that are in flight at the instant of shutdown, whose
+ * value does not outlive their flows' packet exchanges, so they are
+ * abandoned the way a reassembly collision is.
+ */
+
+/* one deduplication table entry; the pending occurrence count is
+ * per-thread and cannot be re-attributed after a restart, so only the
+ * suppression state travels in the snapshot */
+struct flow_snapshot_dedup_entry {
+    uint64_t hash;         /* the (fingerprint, server name, destination) triple hash */
+    int64_t last_emit;     /* when the triple's record was last written */
+};
+
+/*
+ * flow_snapshot_init(path, capture_name) arms the snapshot mechanism:
+ * if a snapshot file exists at path and matches capture_name, its
+ * entries are loaded for the workers to restore from, and the tables
+ * are re-serialized to the same path at shutdown.  A missing file is
+ * a cold start, not an error; a mismatched one is ignored with a
+ * warning.  Returns 0 on success and -1 otherwise.
+ */
+int flow_snapshot_init(const char *path, const char *capture_name);
+
+bool flow_snapshot_is_active(void);
+
+/*
+ * flow_snapshot_dedup_entries(&entries) points entries at the loaded
+ * deduplication entries and returns their number; each worker thread
+ * inserts all of them into its own table, since the thread that will
+ * own a triple after the restart is not knowable in advance
+ */
+size_t flow_snapshot_dedup_entries(const struct flow_snapshot_dedup_entry **entries);
+
+/* contributes one live deduplication entry to the snapshot being
+ * gathered at shutdown; safe to call from several threads */
+void flow_snapshot_note_dedup(uint64_t hash, int64_t last_emit);
+
+/*
+ * flow_snapshot_restore_filter(pf) inserts the loaded TCP flow
+ * entries into pf's initial-message-filter table, and
+ * flow_snapshot_note_filter(pf) contributes that table's live flows
+ * to the snapshot at shutdown; both are no-ops when pf is NULL or
+ * carries no filter table
+ */
+void flow_snapshot_restore_filter(struct packet_filter *pf);
+
+void flow_snapshot_note_filter(const struct packet_filter *pf);
+
+/*
+ * flow_snapshot_write() serializes everything the threads have noted
+ * to the snapshot file, replacing it atomically; called once, after
+ * the workers have been joined.  Returns 0 on success and -1
+ * otherwise.
+ */
+int flow_snapshot_write(void);
+
+#endif /* FLOW_SNAPSHOT_H */
@@ -0,0 +1,201 @@
+/*
+ * fp_db_bin.h
+ *
+ * compiled binary form of the fingerprint database
+ *
+ * The JSON fingerprint database (fingerprint_db.json.gz) can be
+ * compiled offline into a flat binary file (fingerprint_db.bin) by
+ * the fp_db_compiler tool; analysis_init() maps that file into
+ * memory with mmap(PROT_READ, MAP_SHARED) and uses it directly, with
+ * no parsing at startup.  Because the mapping is a read-only view of
+ * the file, every mercury process on a host references the same
+ * physical pages through the page cache; running one process per
+ * interface costs one copy of the database, not N.  (The parsed JSON
+ * form, by contrast, lives on each process's heap.)
+ *
+ * All references within the file are byte offsets relative to the
+ * start of the file, so the mapping may land at any address.  All
+ * multi-byte fields are in the byte order of the machine that ran
+ * the compiler; the file is intended to be built and consumed on the
+ * same platform, and the magic number and version are checked at
+ * load time.
+ *
+ * File layout:
+ *
+ *    fp_db_bin_hdr
+ *    string data, class-map entries, and fingerprint records,
+ *       in the order the compiler emitted them
+ *    index: fp_count structs of type fp_db_bin_index, sorted by
+ *       the fingerprint string that each one refers to
+ *
+ * Structures are 8-byte aligned within the file; strings are
+ * NUL-terminated and may appear at any offset.
+ */
+
+#ifndef FP_DB_BIN_H
+#define FP_DB_BIN_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define FP_DB_BIN_MAGIC   "MFDB"
+#define FP_DB_BIN_VERSION 2
+
+/*
+ * scale of the fixed-point log-likelihoods: values are weighted
+ * natural-log probabilities times 2^10, computed by the compiler, so
+ * that quantized scoring can accumulate them in int32 and convert to
+ * a float only when a result is reported (see USE_QUANTIZED_SCORING
+ * in analysis.cc)
+ */
+#define FP_DB_BIN_Q_SCALE 1024
+
+/* header flags */
+#define FP_DB_BIN_FLAG_MALWARE     0x01  /* process entries carry a malware label  */
+#define FP_DB_BIN_FLAG_EXTENDED    0x02  /* dst_ip and sni class maps are present  */
+
+/* process flags */
+#define FP_DB_BIN_PROC_MALWARE     0x01  /* this process is labeled as malware     */
+#define FP_DB_BIN_PROC_DOMAIN_MEAN 0x02  /* the domain_mean field is valid         */
+
+struct fp_db_bin_hdr {
+    uint8_t  magic[4];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t fp_count;
+    uint64_t index_offset;
+    uint64_t file_size;       /* must equal the size of the mapped file */
+};
+
+struct fp_db_bin_index {
+    uint64_t fp_str;          /* offset of the NUL-terminated str_repr  */
+    uint64_t record;          /* offset of the fp_db_bin_record         */
+};
+
+/*
+ * a class map associates strings (an ASN, a domain, a port
+ * application, a destination address, or a server name) with
+ * observation counts; its entries are sorted by strcmp() of the key
+ * string, for binary search
+ */
+struct fp_db_bin_class_entry {
+    uint64_t key;             /* offset of the NUL-terminated key       */
+    uint64_t count;
+    int16_t  q_value;         /* weighted log(count/total), quantized   */
+    uint16_t pad[3];
+};
+
+struct fp_db_bin_class_map {
+    uint64_t entries;         /* offset of the entry array              */
+    uint32_t num_entries;
+    uint32_t pad;
+};
+
+/* indices of the class maps within a process entry */
+enum fp_db_bin_class {
+    fp_db_bin_class_ip_as             = 0,
+    fp_db_bin_class_hostname_domains  = 1,
+    fp_db_bin_class_port_applications = 2,
+    fp_db_bin_class_ip_ip             = 3,  /* extended metadata only */
+    fp_db_bin_class_hostname_sni      = 4,  /* extended metadata only */
+    fp_db_bin_num_classes             = 5
+};
+
+struct fp_db_bin_process {
+    uint64_t name;            /* offset of the process name             */
+    uint64_t count;
+    uint32_t flags;
+    float    domain_mean;
+    int32_t  q_proc;          /* quantized process log-prior            */
+    int16_t  q_miss[fp_db_bin_num_classes];  /* per-class quantized base prior */
+    int16_t  q_pad;
+    struct fp_db_bin_class_map classes[fp_db_bin_num_classes];
+};
+
+/*
+ * a fingerprint record holds the total observation count and a
+ * contiguous array of its process entries
+ */
+struct fp_db_bin_record {
+    uint64_t total_count;
+    uint32_t num_procs;
+    uint32_t pad;
+    /* followed by num_procs structs of type fp_db_bin_process */
+};
+
+static inline const char *fp_db_bin_string(const uint8_t *base, uint64_t offset) {
+    return (const char *)(base + offset);
+}
+
+static inline const struct fp_db_bin_process *fp_db_bin_record_procs(const uint8_t *base,
+                                                                     const struct fp_db_bin_record *r) {
+    (void)base;
+    return (const struct fp_db_bin_process *)(r + 1);
+}
+
+/*
+ * fp_db_bin_class_find(base, map, key) returns the class-map entry
+ * whose key string equals key, or NULL if there is none
+ */
+static inline const struct fp_db_bin_class_entry *fp_db_bin_class_find(const uint8_t *base,
+                                                                       const struct fp_db_bin_class_map *map,
+                                                                       const char *key) {
+    const struct fp_db_bin_class_entry *entry = (const struct fp_db_bin_class_entry *)(base + map->entries);
+    uint32_t lo = 0, hi = map->num_entries;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(key, fp_db_bin_string(base, entry[mid].key));
+        if (cmp == 0) {
+            return &entry[mid];
+        } else if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * fp_db_bin_class_lookup(base, map, key, count) sets *count to the
+ * observation count associated with key, returning true if the key
+ * is present in the class map
+ */
+static inline bool fp_db_bin_class_lookup(const uint8_t *base,
+                                          const struct fp_db_bin_class_map *map,
+                                          const char *key,
+                                          uint64_t *count) {
+    const struct fp_db_bin_class_entry *entry = fp_db_bin_class_find(base, map, key);
+    if (entry) {
+        *count = entry->count;
+        return true;
+    }
+    return false;
+}
+
+/*
+ * fp_db_bin_find(base, hdr, fp_str) returns the record whose
+ * str_repr equals fp_str, or NULL if there is none
+ */
+static inline const struct fp_db_bin_record *fp_db_bin_find(const uint8_t *base,
+                                                            const struct fp_db_bin_hdr *hdr,
+                                                            const char *fp_str) {
+    const struct fp_db_bin_index *index = (const struct fp_db_bin_index *)(base + hdr->index_offset);
+    uint32_t lo = 0, hi = hdr->fp_count;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(fp_str, fp_db_bin_string(base, index[mid].fp_str));
+        if (cmp == 0) {
+            return (const struct fp_db_bin_record *)(base + index[mid].record);
+        } else if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+#endif /* FP_DB_BIN_H */
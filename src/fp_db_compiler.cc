@@ -0,0 +1,264 @@
+/*
+ * fp_db_compiler.cc
+ *
+ * offline tool that compiles the JSON fingerprint database
+ * (fingerprint_db.json.gz) into the flat binary form defined in
+ * fp_db_bin.h, which mercury maps into memory at startup
+ *
+ * usage: fp_db_compiler fingerprint_db.json.gz fingerprint_db.bin
+ *
+ * build with "make fp_db_compiler"
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "fp_db_bin.h"
+
+#include "rapidjson/document.h"
+
+/*
+ * the output file is assembled in a growable byte vector; every
+ * offset recorded in the structures is the position of the emitted
+ * data within that vector, which equals its offset in the file
+ */
+struct blob {
+    std::vector<uint8_t> data;
+
+    uint64_t append(const void *p, size_t len) {
+        uint64_t offset = data.size();
+        const uint8_t *c = (const uint8_t *)p;
+        data.insert(data.end(), c, c + len);
+        return offset;
+    }
+
+    uint64_t append_string(const char *s) {
+        return append(s, strlen(s) + 1);
+    }
+
+    /* structures within the file are kept 8-byte aligned */
+    void align() {
+        while (data.size() % 8) {
+            data.push_back(0);
+        }
+    }
+};
+
+static int gzgetline(gzFile f, std::vector<char>& v) {
+    v = std::vector<char>(256);
+    unsigned pos = 0;
+    for (;;) {
+        if (gzgets(f, &v[pos], v.size()-pos) == 0) {
+            // EOF
+            return 0;
+        }
+        unsigned read = strlen(&v[pos]);
+        if (v[pos+read-1] == '\n') {
+            pos = pos + read - 1;
+            break;
+        }
+        pos = v.size() - 1;
+        v.resize(v.size() * 2);
+    }
+    v.resize(pos);
+    return 1;
+}
+
+/* per-class weights applied to the log-likelihoods during scoring */
+static const double class_weight[fp_db_bin_num_classes] = {
+    0.13924, 0.15590, 0.00528, 0.56735, 0.96941
+};
+
+/* quantize a weighted log-likelihood to 16-bit fixed point */
+static int16_t quantize(double value) {
+    double q = round(value * FP_DB_BIN_Q_SCALE);
+    if (q < INT16_MIN) {
+        q = INT16_MIN;
+    }
+    if (q > INT16_MAX) {
+        q = INT16_MAX;
+    }
+    return (int16_t)q;
+}
+
+/*
+ * emit a class map: its entries are written out sorted by key
+ * string, so that the loader can binary search them
+ */
+static void compile_class_map(struct blob &out,
+                              const rapidjson::Value &procs,
+                              rapidjson::SizeType i,
+                              const char *class_name,
+                              double weight,
+                              uint64_t fp_tc,
+                              struct fp_db_bin_class_map *map) {
+    map->entries = 0;
+    map->num_entries = 0;
+    map->pad = 0;
+
+    rapidjson::Value::ConstMemberIterator itr = procs[i].FindMember(class_name);
+    if (itr == procs[i].MemberEnd()) {
+        return;
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> entries;
+    for (auto &m : itr->value.GetObject()) {
+        entries.push_back({m.name.GetString(), (uint64_t)m.value.GetInt64()});
+    }
+    std::sort(entries.begin(), entries.end());
+
+    std::vector<struct fp_db_bin_class_entry> table(entries.size());
+    for (size_t j = 0; j < entries.size(); j++) {
+        memset(&table[j], 0, sizeof(table[j]));
+        table[j].key = out.append_string(entries[j].first.c_str());
+        table[j].count = entries[j].second;
+        table[j].q_value = quantize(log((double)entries[j].second/fp_tc) * weight);
+    }
+    out.align();
+    map->entries = out.append(table.data(), table.size() * sizeof(table[0]));
+    map->num_entries = table.size();
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s fingerprint_db.json.gz fingerprint_db.bin\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    gzFile in_file = gzopen(argv[1], "r");
+    if (in_file == NULL) {
+        fprintf(stderr, "error: could not open file '%s'\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    static const char *class_names[fp_db_bin_num_classes] = {
+        "classes_ip_as",
+        "classes_hostname_domains",
+        "classes_port_applications",
+        "classes_ip_ip",
+        "classes_hostname_sni"
+    };
+
+    struct blob out;
+    struct fp_db_bin_hdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    out.append(&hdr, sizeof(hdr));   /* placeholder; rewritten at the end */
+
+    bool malware_db = true;
+    bool extended_fp_metadata = true;
+    std::vector<std::pair<std::string, uint64_t>> index;  /* str_repr -> record offset */
+
+    std::vector<char> line;
+    while (gzgetline(in_file, line)) {
+        std::string line_str(line.begin(), line.end());
+        rapidjson::Document fp;
+        fp.Parse(line_str.c_str());
+        if (fp.HasParseError() || !fp.IsObject() || !fp.HasMember("str_repr")) {
+            fprintf(stderr, "error: malformed fingerprint database line\n");
+            return EXIT_FAILURE;
+        }
+
+        const rapidjson::Value &procs = fp["process_info"];
+        uint64_t fp_tc = fp["total_count"].GetInt64();
+
+        if (procs[0].FindMember("malware") == procs[0].MemberEnd()) {
+            malware_db = false;
+        }
+        if (procs[0].FindMember("classes_hostname_sni") == procs[0].MemberEnd()) {
+            extended_fp_metadata = false;
+        }
+
+        /*
+         * emit the variable-length parts of each process entry
+         * first, then the record with its contiguous process array
+         */
+        std::vector<struct fp_db_bin_process> proc_table(procs.Size());
+        for (rapidjson::SizeType i = 0; i < procs.Size(); i++) {
+            struct fp_db_bin_process *p = &proc_table[i];
+            memset(p, 0, sizeof(*p));
+            p->name = out.append_string(procs[i]["process"].GetString());
+            p->count = procs[i]["count"].GetInt64();
+
+            rapidjson::Value::ConstMemberIterator itr = procs[i].FindMember("malware");
+            if (itr != procs[i].MemberEnd() && itr->value.GetBool()) {
+                p->flags |= FP_DB_BIN_PROC_MALWARE;
+            }
+            itr = procs[i].FindMember("domain_mean");
+            if (itr != procs[i].MemberEnd()) {
+                p->flags |= FP_DB_BIN_PROC_DOMAIN_MEAN;
+                p->domain_mean = itr->value.GetFloat();
+            }
+
+            /*
+             * precompute the fixed-point score contributions: the
+             * process log-prior, and the per-class base prior that
+             * applies when a class map has no entry for the flow
+             */
+            double base_prior = log(1.0/fp_tc);
+            if ((p->flags & FP_DB_BIN_PROC_DOMAIN_MEAN) && p->domain_mean < 0.5) {
+                base_prior = log(.1/fp_tc);
+            }
+            p->q_proc = (int32_t)round(fmax(log((double)p->count/fp_tc), log(.1)) * FP_DB_BIN_Q_SCALE);
+            for (unsigned int c = 0; c < fp_db_bin_num_classes; c++) {
+                p->q_miss[c] = quantize(base_prior * class_weight[c]);
+            }
+
+            for (unsigned int c = 0; c < fp_db_bin_num_classes; c++) {
+                compile_class_map(out, procs, i, class_names[c], class_weight[c], fp_tc, &p->classes[c]);
+            }
+        }
+
+        struct fp_db_bin_record record;
+        record.total_count = fp_tc;
+        record.num_procs = proc_table.size();
+        record.pad = 0;
+
+        out.align();
+        uint64_t record_offset = out.append(&record, sizeof(record));
+        out.append(proc_table.data(), proc_table.size() * sizeof(proc_table[0]));
+
+        index.push_back({fp["str_repr"].GetString(), record_offset});
+    }
+    gzclose(in_file);
+
+    /* emit the string data of the index, then the sorted index itself */
+    std::sort(index.begin(), index.end());
+    std::vector<struct fp_db_bin_index> index_table(index.size());
+    for (size_t i = 0; i < index.size(); i++) {
+        index_table[i].fp_str = out.append_string(index[i].first.c_str());
+        index_table[i].record = index[i].second;
+    }
+    out.align();
+    uint64_t index_offset = out.append(index_table.data(), index_table.size() * sizeof(index_table[0]));
+
+    memcpy(hdr.magic, FP_DB_BIN_MAGIC, sizeof(hdr.magic));
+    hdr.version = FP_DB_BIN_VERSION;
+    hdr.flags = (malware_db ? FP_DB_BIN_FLAG_MALWARE : 0)
+        | (extended_fp_metadata ? FP_DB_BIN_FLAG_EXTENDED : 0);
+    hdr.fp_count = index_table.size();
+    hdr.index_offset = index_offset;
+    hdr.file_size = out.data.size();
+    memcpy(out.data.data(), &hdr, sizeof(hdr));
+
+    FILE *out_file = fopen(argv[2], "wb");
+    if (out_file == NULL) {
+        fprintf(stderr, "error: could not open file '%s'\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    if (fwrite(out.data.data(), 1, out.data.size(), out_file) != out.data.size()) {
+        fprintf(stderr, "error: could not write file '%s'\n", argv[2]);
+        fclose(out_file);
+        return EXIT_FAILURE;
+    }
+    fclose(out_file);
+
+    fprintf(stderr, "compiled %u fingerprints (%zu bytes)\n", hdr.fp_count, out.data.size());
+    return 0;
+}
@@ -0,0 +1,239 @@
+/*
+ * hh_sketch.c
+ *
+ * heavy-hitter telemetry (see hh_sketch.h)
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. All rights reserved.  License at
+ * https://github.com/cisco/mercury/blob/master/LICENSE
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include "hh_sketch.h"
+
+/*
+ * sketch dimensions: four counter rows of 1024 counters each, per
+ * category, make the per-thread sketch 48kB of counters, small enough
+ * to stay in cache next to the packet-processing working set.  With
+ * four rows, a label whose estimate is inflated by collisions in one
+ * row is almost never inflated in all four, and the minimum over the
+ * rows is taken as the estimate.
+ */
+#define HH_ROWS 4
+#define HH_WIDTH 1024                /* counters per row; must be a power of two */
+
+#define HH_TOPK 16                   /* labels tracked per thread and category  */
+#define HH_LABEL_LEN 256             /* label slot size, including terminator   */
+#define HH_REPORT_K 8                /* labels reported per category            */
+
+#define HH_MAX_THREADS 64
+
+/*
+ * a tracked label: the count is this thread's count-min estimate, and
+ * length zero marks an empty slot.  The stats thread reads these
+ * while the owning thread writes them, so an entry caught mid-update
+ * can pair a label with a slightly stale count; like the per-thread
+ * packet counters in af_packet_v3.c, the snapshot is approximate but
+ * consistent enough for a rate report.
+ */
+struct hh_topk_entry {
+    uint64_t count;
+    uint32_t length;
+    char label[HH_LABEL_LEN];
+};
+
+struct hh_sketch {
+    uint32_t counters[HH_NUM_CATEGORIES][HH_ROWS][HH_WIDTH];
+    struct hh_topk_entry topk[HH_NUM_CATEGORIES][HH_TOPK];
+};
+
+static struct hh_sketch *hh_registry[HH_MAX_THREADS];
+static int hh_num_registered = 0;
+static pthread_mutex_t hh_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool hh_enabled = false;
+
+void hh_sketch_set_enabled(bool value) {
+    hh_enabled = value;
+}
+
+bool hh_sketch_is_enabled(void) {
+    return hh_enabled;
+}
+
+static struct hh_sketch *hh_sketch_get() {
+    static thread_local struct hh_sketch *sketch = NULL;
+    if (sketch == NULL) {
+        /* allocated once per thread and deliberately never freed, so
+         * that the registry entry stays valid after the thread exits
+         * and the final intervals still see its labels */
+        sketch = new hh_sketch();
+        pthread_mutex_lock(&hh_registry_mutex);
+        if (hh_num_registered < HH_MAX_THREADS) {
+            hh_registry[hh_num_registered++] = sketch;
+        }
+        pthread_mutex_unlock(&hh_registry_mutex);
+    }
+    return sketch;
+}
+
+static uint64_t hh_fnv1a(const uint8_t *data, size_t len) {
+    uint64_t h = 0xcbf29ce484222325;
+    for (size_t i = 0; i < len; i++) {
+        h ^= data[i];
+        h *= 0x00000100000001b3;
+    }
+    return h;
+}
+
+void hh_sketch_update(enum hh_category category,
+                      const uint8_t *label,
+                      size_t label_len) {
+    if (!hh_enabled || label_len == 0) {
+        return;
+    }
+    struct hh_sketch *sketch = hh_sketch_get();
+    if (label_len > HH_LABEL_LEN - 1) {
+        label_len = HH_LABEL_LEN - 1;
+    }
+
+    /*
+     * count-min update: one 64-bit hash of the label, cut into four
+     * 16-bit row indexes; the estimate is the minimum of the four
+     * counters after the increments
+     */
+    uint64_t h = hh_fnv1a(label, label_len);
+    uint64_t est = UINT64_MAX;
+    for (unsigned int row = 0; row < HH_ROWS; row++) {
+        uint32_t *counter = &sketch->counters[category][row][(h >> (16 * row)) & (HH_WIDTH - 1)];
+        (*counter)++;
+        if (*counter < est) {
+            est = *counter;
+        }
+    }
+
+    /*
+     * top-K maintenance: a label already on the list takes the new
+     * estimate; otherwise the estimate must beat the smallest tracked
+     * count to displace its entry.  A displaced label that is still a
+     * heavy hitter climbs back in, since its counters keep counting.
+     */
+    struct hh_topk_entry *topk = sketch->topk[category];
+    struct hh_topk_entry *smallest = &topk[0];
+    for (unsigned int i = 0; i < HH_TOPK; i++) {
+        struct hh_topk_entry *entry = &topk[i];
+        if (entry->length == label_len && memcmp(entry->label, label, label_len) == 0) {
+            entry->count = est;
+            return;
+        }
+        if (entry->count < smallest->count) {
+            smallest = entry;
+        }
+    }
+    if (est > smallest->count) {
+        smallest->count = 0;        /* empty until the label below is complete */
+        memcpy(smallest->label, label, label_len);
+        smallest->label[label_len] = '\0';
+        smallest->length = label_len;
+        smallest->count = est;
+    }
+}
+
+/*
+ * the merge buffer: per-thread entries for one category are gathered
+ * here, entries with the same label summed (each per-thread estimate
+ * counts only that thread's observations), and the result sorted by
+ * count
+ */
+struct hh_merge_entry {
+    uint64_t count;
+    uint32_t length;
+    const char *label;      /* points into the owning thread's entry */
+    char copy[HH_LABEL_LEN];
+};
+
+static int hh_merge_compare(const void *a, const void *b) {
+    const struct hh_merge_entry *ma = (const struct hh_merge_entry *)a;
+    const struct hh_merge_entry *mb = (const struct hh_merge_entry *)b;
+    if (ma->count != mb->count) {
+        return ma->count < mb->count ? 1 : -1;
+    }
+    return 0;
+}
+
+/*
+ * writes s as a JSON string body, escaping the quote, backslash, and
+ * control characters; labels are fingerprints, DNS names, and
+ * addresses, so the escapes are almost never taken
+ */
+static void hh_fputs_json_escaped(FILE *f, const char *s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = s[i];
+        if (c == '"' || c == '\\') {
+            fprintf(f, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(f, "\\u%04x", c);
+        } else {
+            fputc(c, f);
+        }
+    }
+}
+
+void hh_sketch_report_json(FILE *f) {
+    static const char *category_name[HH_NUM_CATEGORIES] = {
+        "fingerprints", "server_names", "destinations"
+    };
+    struct hh_merge_entry merged[HH_MAX_THREADS * HH_TOPK];
+
+    pthread_mutex_lock(&hh_registry_mutex);
+    int num_registered = hh_num_registered;
+    pthread_mutex_unlock(&hh_registry_mutex);
+
+    fprintf(f, ",\"heavy_hitters\":{");
+    const char *category_sep = "";
+    for (unsigned int category = 0; category < HH_NUM_CATEGORIES; category++) {
+        unsigned int num_merged = 0;
+        for (int t = 0; t < num_registered; t++) {
+            const struct hh_topk_entry *topk = hh_registry[t]->topk[category];
+            for (unsigned int i = 0; i < HH_TOPK; i++) {
+                /* copy the entry before comparing, so that the label
+                 * examined is the label counted even if the worker
+                 * replaces the entry meanwhile */
+                uint32_t length = topk[i].length;
+                if (length == 0 || length > HH_LABEL_LEN - 1 || topk[i].count == 0) {
+                    continue;
+                }
+                struct hh_merge_entry *m = &merged[num_merged];
+                memcpy(m->copy, topk[i].label, length);
+                m->count = topk[i].count;
+                m->length = length;
+                m->label = m->copy;
+                unsigned int j;
+                for (j = 0; j < num_merged; j++) {
+                    if (merged[j].length == length
+                        && memcmp(merged[j].label, m->copy, length) == 0) {
+                        merged[j].count += m->count;
+                        break;
+                    }
+                }
+                if (j == num_merged) {
+                    num_merged++;
+                }
+            }
+        }
+        qsort(merged, num_merged, sizeof(merged[0]), hh_merge_compare);
+
+        fprintf(f, "%s\"%s\":[", category_sep, category_name[category]);
+        category_sep = ",";
+        const char *entry_sep = "";
+        for (unsigned int i = 0; i < num_merged && i < HH_REPORT_K; i++) {
+            fprintf(f, "%s{\"value\":\"", entry_sep);
+            entry_sep = ",";
+            hh_fputs_json_escaped(f, merged[i].label, merged[i].length);
+            fprintf(f, "\",\"count\":%" PRIu64 "}", merged[i].count);
+        }
+        fprintf(f, "]");
+    }
+    fprintf(f, "}");
+}
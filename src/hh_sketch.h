@@ -0,0 +1,70 @@
+/*
+ * hh_sketch.h
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. All rights reserved.  License at
+ * https://github.com/cisco/mercury/blob/master/LICENSE
+ */
+
+#ifndef HH_SKETCH_H
+#define HH_SKETCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * In-process heavy-hitter telemetry: answers "what are the top
+ * fingerprints, server names, and destinations right now" from inside
+ * the capture process, so that the answer does not require shipping
+ * and aggregating the full record stream downstream.
+ *
+ * Each worker thread keeps a count-min sketch (a small fixed array of
+ * counters, so the estimate of any label's count never underestimates
+ * and the whole structure stays cache resident) next to a short
+ * unsorted top-K list of the labels whose estimates are currently
+ * largest.  The per-thread structures are registered in a
+ * process-wide table on first use, exactly as the per-protocol
+ * counters in extractor.cc are, and the stats thread merges the
+ * per-thread top-K lists into the periodic report without stopping
+ * the workers.
+ *
+ * Updates happen only when hh_sketch_set_enabled(true) has been
+ * called, which the stats thread does when a periodic report will
+ * actually be printed; otherwise the per-packet cost is one branch.
+ */
+
+enum hh_category {
+    hh_category_fingerprint = 0,
+    hh_category_server_name = 1,
+    hh_category_destination = 2,
+};
+#define HH_NUM_CATEGORIES 3
+
+/*
+ * hh_sketch_set_enabled(value) turns the per-packet accounting on or
+ * off; hh_sketch_is_enabled() lets a caller skip the label
+ * serialization that an update would need
+ */
+void hh_sketch_set_enabled(bool value);
+
+bool hh_sketch_is_enabled(void);
+
+/*
+ * hh_sketch_update(category, label, label_len) counts one observation
+ * of label into this thread's sketch; labels longer than the fixed
+ * slot size are truncated, and their counts merge under the truncated
+ * prefix
+ */
+void hh_sketch_update(enum hh_category category,
+                      const uint8_t *label,
+                      size_t label_len);
+
+/*
+ * hh_sketch_report_json(f) merges the per-thread top-K lists and
+ * writes a "heavy_hitters" JSON object (as a member of an enclosing
+ * object, with a leading comma) holding the top labels of each
+ * category with their estimated cumulative counts
+ */
+void hh_sketch_report_json(FILE *f);
+
+#endif /* HH_SKETCH_H */
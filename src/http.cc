@@ -2,7 +2,6 @@
  * http.c
  */
 
-#include <unordered_map>
 #include "asn1/bytestring.h"
 #include "http.h"
 #include "json_object.h"
@@ -24,7 +23,7 @@ void http_request::parse(struct datum &p) {
     return;
 }
 
-void http_headers::print_matching_names(struct json_object &o, std::list<std::pair<struct datum, std::string>> &name_list) const {
+void http_headers::print_matching_names(struct json_object &o, const struct http_header_recognizer &selected) const {
     unsigned char crlf[2] = { '\r', '\n' };
     unsigned char csp[2] = { ':', ' ' };
 
@@ -43,34 +42,20 @@ void http_headers::print_matching_names(struct json_object &o, std::list<std::pa
             return;
         }
         keyword.data_end = p.data;
-        const char *header_name = NULL;
+        const struct http_header_recognizer::header_name *match = selected.find(keyword);
 
-        for (const auto &name : name_list) {
-            if (name.first.case_insensitive_match(keyword)) {
-                header_name = (const char *)name.second.c_str();
-            }
-        }
         const uint8_t *value_start = p.data;
         if (parser_skip_upto_delim(&p, crlf, sizeof(crlf)) == status_err) {
             return;
         }
         const uint8_t *value_end = p.data - 2;
-        if (header_name) {
-            o.print_key_json_string(header_name, value_start, value_end - value_start);
+        if (match && match->json_key) {
+            o.print_key_json_string(match->json_key, value_start, value_end - value_start);
         }
     }
 }
 
-inline void to_lower(std::basic_string<uint8_t> &str, struct datum d) {
-    if (d.is_not_readable()) {
-        return;
-    }
-    while (d.data < d.data_end) {
-        str.push_back(tolower(*d.data++));
-    }
-}
-
-void http_headers::fingerprint(struct buffer_stream &buf, std::unordered_map<std::basic_string<uint8_t>, bool> &name_dict) const {
+void http_headers::fingerprint(struct buffer_stream &buf, const struct http_header_recognizer &selected) const {
     unsigned char crlf[2] = { '\r', '\n' };
     unsigned char csp[2] = { ':', ' ' };
 
@@ -86,23 +71,14 @@ void http_headers::fingerprint(struct buffer_stream &buf, std::unordered_map<std
             return;
         }
         name.data_end = p.data;
-        bool include_name = false;
-        bool include_value = false;
-
-        std::basic_string<uint8_t> name_lowercase;
-        to_lower(name_lowercase, name);
-        auto pair = name_dict.find(name_lowercase);
-        if (pair != name_dict.end()) {
-            include_name = true;
-            include_value = pair->second;
-        }
+        const struct http_header_recognizer::header_name *match = selected.find(name);
 
         if (parser_skip_upto_delim(&p, crlf, sizeof(crlf)) == status_err) {
             return;
         }
         const uint8_t *name_end = p.data - 2;
-        if (include_name) {
-            if (include_value) {
+        if (match) {
+            if (match->include_value) {
                 buf.write_char('(');
                 buf.raw_as_hex(name.data, name_end - name.data);         // write {name, value}
                 buf.write_char(')');
@@ -117,29 +93,19 @@ void http_headers::fingerprint(struct buffer_stream &buf, std::unordered_map<std
 
 void http_request::write_json(struct json_object &record, bool output_metadata) {
 
-    // construct a list of http header names to be printed out
+    // the http header names to be printed out, compiled into a
+    // perfect-hash recognizer once, at first use
     //
-    uint8_t ua[] = { 'u', 's', 'e', 'r', '-', 'a', 'g', 'e', 'n', 't', ':', ' ' };
-    struct datum user_agent{ua, ua+sizeof(ua)};
-    std::pair<struct datum, std::string> user_agent_name{user_agent, "user_agent"};
-
-    uint8_t h[] = { 'h', 'o', 's', 't', ':', ' ' };
-    struct datum host{h, h+sizeof(h)};
-    std::pair<struct datum, std::string> host_name{host, "host"};
-
-    uint8_t xff[] = { 'x', '-', 'f', 'o', 'r', 'w', 'a', 'r', 'd', 'e', 'd', '-', 'f', 'o', 'r', ':', ' ' };
-    struct datum xff_parser{xff, xff+sizeof(xff)};
-    std::pair<struct datum, std::string> x_forwarded_for{xff_parser, "x_forwarded_for"};
-
-    uint8_t v[] = { 'v', 'i', 'a', ':', ' ' };
-    struct datum v_parser{v, v+sizeof(v)};
-    std::pair<struct datum, std::string> via{v_parser, "via"};
-
-    uint8_t u[] = { 'u', 'p', 'g', 'r', 'a', 'd', 'e', ':', ' ' };
-    struct datum u_parser{u, u+sizeof(u)};
-    std::pair<struct datum, std::string> upgrade_pair{u_parser, "upgrade"};
-
-    std::list<std::pair<struct datum, std::string>> names_to_print{user_agent_name, host_name, x_forwarded_for, via, upgrade_pair};
+    static const struct http_header_recognizer names_to_print{{
+        { (uint8_t *)"user-agent: ",      "user_agent",      false },
+        { (uint8_t *)"host: ",            "host",            false },
+        { (uint8_t *)"x-forwarded-for: ", "x_forwarded_for", false },
+        { (uint8_t *)"via: ",             "via",             false },
+        { (uint8_t *)"upgrade: ",         "upgrade",         false }
+    }};
+    static const struct http_header_recognizer ua_only{{
+        { (uint8_t *)"user-agent: ",      "user_agent",      false }
+    }};
 
     if (this->is_not_empty()) {
         struct json_object http{record, "http"};
@@ -161,7 +127,6 @@ void http_request::write_json(struct json_object &record, bool output_metadata)
         } else {
 
             // output only the user-agent
-            std::list<std::pair<struct datum, std::string>> ua_only{user_agent_name};
             headers.print_matching_names(http_request, ua_only);
         }
         http_request.close();
@@ -188,25 +153,15 @@ void http_response::parse(struct datum &p) {
 
 void http_response::write_json(struct json_object &record) {
 
-    // construct a list of http header names to be printed out
+    // the http header names to be printed out, compiled into a
+    // perfect-hash recognizer once, at first use
     //
-    uint8_t ct[] = { 'c', 'o', 'n', 't', 'e', 'n', 't', '-', 't', 'y', 'p', 'e', ':', ' ' };
-    struct datum content_type{ct, ct+sizeof(ct)};
-    std::pair<struct datum, std::string> content_type_pair{content_type, "content_type"};
-
-    uint8_t cl[] = { 'c', 'o', 'n', 't', 'e', 'n', 't', '-', 'l', 'e', 'n', 'g', 't', 'h', ':', ' ' };
-    struct datum content_length{cl, cl+sizeof(cl)};
-    std::pair<struct datum, std::string> content_length_pair{content_length, "content_length"};
-
-    uint8_t srv[] = { 's', 'e', 'r', 'v', 'e', 'r', ':', ' ' };
-    struct datum server{srv, srv+sizeof(srv)};
-    std::pair<struct datum, std::string> server_pair{server, "server"};
-
-    uint8_t v[] = { 'v', 'i', 'a', ':', ' ' };
-    struct datum v_parser{v, v+sizeof(v)};
-    std::pair<struct datum, std::string> via_pair{v_parser, "via"};
-
-    std::list<std::pair<struct datum, std::string>> names_to_print{server_pair, content_type_pair, content_length_pair, via_pair};
+    static const struct http_header_recognizer names_to_print{{
+        { (uint8_t *)"server: ",          "server",          false },
+        { (uint8_t *)"content-type: ",    "content_type",    false },
+        { (uint8_t *)"content-length: ",  "content_length",  false },
+        { (uint8_t *)"via: ",             "via",             false }
+    }};
 
     struct json_object http{record, "http"};
     struct json_object http_response{http, "response"};
@@ -241,25 +196,27 @@ void http_request::operator()(struct buffer_stream &b) const {
     b.raw_as_hex(protocol.data, protocol.data_end - protocol.data);
     b.write_char(')');
 
-    std::unordered_map<std::basic_string<uint8_t>, bool> http_static_keywords = {
-        { { 'a', 'c', 'c', 'e', 'p', 't', ':', ' ' }, true },
-        { { 'a', 'c', 'c', 'e', 'p', 't', '-', 'e', 'n', 'c', 'o', 'd', 'i', 'n', 'g', ':', ' '}, true },
-        { { 'c', 'o', 'n', 'n', 'e', 'c', 't', 'i', 'o', 'n', ':', ' ' }, true },
-        { { 'd', 'n', 't', ':', ' ' }, true },
-        { { 'd', 'p', 'r', ':', ' ' }, true },
-        { { 'u', 'p', 'g', 'r', 'a', 'd', 'e', '-', 'i', 'n', 's', 'e', 'c', 'u', 'r', 'e', '-', 'r', 'e', 'q', 'u', 'e', 's', 't', 's', ':', ' ' }, true },
-        { { 'x', '-', 'r', 'e', 'q', 'u', 'e', 's', 't', 'e', 'd', '-', 'w', 'i', 't', 'h', ':', ' ' }, true },
-        { { 'a', 'c', 'c', 'e', 'p', 't', '-', 'c', 'h', 'a', 'r', 's', 'e', 't', ':', ' ' }, false },
-        { { 'a', 'c', 'c', 'e', 'p', 't', '-', 'l', 'a', 'n', 'g', 'u', 'a', 'g', 'e', ':', ' ' }, false },
-        { { 'a', 'u', 't', 'h', 'o', 'r', 'i', 'z', 'a', 't', 'i', 'o', 'n', ':', ' ' }, false },
-        { { 'c', 'a', 'c', 'h', 'e', '-', 'c', 'o', 'n', 't', 'r', 'o', 'l', ':', ' ' }, false },
-        { { 'h', 'o', 's', 't', ':', ' ' }, false },
-        { { 'i', 'f', '-', 'm', 'o', 'd', 'i', 'f', 'i', 'e', 'd', '-', 's', 'i', 'n', 'c', 'e', ':', ' ' }, false },
-        { { 'k', 'e', 'e', 'p', '-', 'a', 'l', 'i', 'v', 'e', ':', ' ' }, false },
-        { { 'u', 's', 'e', 'r', '-', 'a', 'g', 'e', 'n', 't', ':', ' ' }, false },
-        { { 'x', '-', 'f', 'l', 'a', 's', 'h', '-', 'v', 'e', 'r', 's', 'i', 'o', 'n', ':', ' ' }, false },
-        { { 'x', '-', 'p', '2', 'p', '-', 'p', 'e', 'e', 'r', 'd', 'i', 's', 't', ':', ' ' }, false } 
-    };
+    /* constant; compiled into a perfect-hash recognizer once rather
+     * than once per packet */
+    static const struct http_header_recognizer http_static_keywords{{
+        { (uint8_t *)"accept: ",                    NULL, true },
+        { (uint8_t *)"accept-encoding: ",           NULL, true },
+        { (uint8_t *)"connection: ",                NULL, true },
+        { (uint8_t *)"dnt: ",                       NULL, true },
+        { (uint8_t *)"dpr: ",                       NULL, true },
+        { (uint8_t *)"upgrade-insecure-requests: ", NULL, true },
+        { (uint8_t *)"x-requested-with: ",          NULL, true },
+        { (uint8_t *)"accept-charset: ",            NULL, false },
+        { (uint8_t *)"accept-language: ",           NULL, false },
+        { (uint8_t *)"authorization: ",             NULL, false },
+        { (uint8_t *)"cache-control: ",             NULL, false },
+        { (uint8_t *)"host: ",                      NULL, false },
+        { (uint8_t *)"if-modified-since: ",         NULL, false },
+        { (uint8_t *)"keep-alive: ",                NULL, false },
+        { (uint8_t *)"user-agent: ",                NULL, false },
+        { (uint8_t *)"x-flash-version: ",           NULL, false },
+        { (uint8_t *)"x-p2p-peerdist: ",            NULL, false }
+    }};
     headers.fingerprint(b, http_static_keywords);
     b.write_char('\"');
 }
@@ -281,58 +238,59 @@ void http_response::operator()(struct buffer_stream &buf) const {
     buf.raw_as_hex(status_reason.data, status_reason.data_end - status_reason.data);
     buf.write_char(')');
 
-    std::unordered_map<std::basic_string<uint8_t>, bool> http_static_keywords = {
-        { (uint8_t *)"access-control-allow-credentials: ", true },
-        { (uint8_t *)"access-control-allow-headers: ", true },
-        { (uint8_t *)"access-control-allow-methods: ", true },
-        { (uint8_t *)"access-control-expose-headers: ", true },
-        { (uint8_t *)"cache-control: ", true },
-        { (uint8_t *)"code: ", true },
-        { (uint8_t *)"connection: ", true },
-        { (uint8_t *)"content-language: ", true },
-        { (uint8_t *)"content-transfer-encoding: ", true },
-        { (uint8_t *)"p3p: ", true },
-        { (uint8_t *)"pragma: ", true },
-        { (uint8_t *)"reason: ", true },
-        { (uint8_t *)"server: ", true },
-        { (uint8_t *)"strict-transport-security: ", true },
-        { (uint8_t *)"version: ", true },
-        { (uint8_t *)"x-aspnetmvc-version: ", true },
-        { (uint8_t *)"x-aspnet-version: ", true },
-        { (uint8_t *)"x-cid: ", true },
-        { (uint8_t *)"x-ms-version: ", true },
-        { (uint8_t *)"x-xss-protection: ", true },
-        { (uint8_t *)"appex-activity-id: ", false },
-        { (uint8_t *)"cdnuuid: ", false },
-        { (uint8_t *)"cf-ray: ", false },
-        { (uint8_t *)"content-range: ", false },
-        { (uint8_t *)"content-type: ", false },
-        { (uint8_t *)"date: ", false },
-        { (uint8_t *)"etag: ", false },
-        { (uint8_t *)"expires: ", false },
-        { (uint8_t *)"flow_context: ", false },
-        { (uint8_t *)"ms-cv: ", false },
-        { (uint8_t *)"msregion: ", false },
-        { (uint8_t *)"ms-requestid: ", false },
-        { (uint8_t *)"request-id: ", false },
-        { (uint8_t *)"vary: ", false },
-        { (uint8_t *)"x-amz-cf-pop: ", false },
-        { (uint8_t *)"x-amz-request-id: ", false },
-        { (uint8_t *)"x-azure-ref-originshield: ", false },
-        { (uint8_t *)"x-cache: ", false },
-        { (uint8_t *)"x-cache-hits: ", false },
-        { (uint8_t *)"x-ccc: ", false },
-        { (uint8_t *)"x-diagnostic-s: ", false },
-        { (uint8_t *)"x-feserver: ", false },
-        { (uint8_t *)"x-hw: ", false },
-        { (uint8_t *)"x-msedge-ref: ", false },
-        { (uint8_t *)"x-ocsp-responder-id: ", false },
-        { (uint8_t *)"x-requestid: ", false },
-        { (uint8_t *)"x-served-by: ", false },
-        { (uint8_t *)"x-timer: ", false },
-        { (uint8_t *)"x-trace-context: ", false }
-
-    };
+    /* constant; compiled into a perfect-hash recognizer once rather
+     * than once per packet */
+    static const struct http_header_recognizer http_static_keywords{{
+        { (uint8_t *)"access-control-allow-credentials: ", NULL, true },
+        { (uint8_t *)"access-control-allow-headers: ",     NULL, true },
+        { (uint8_t *)"access-control-allow-methods: ",     NULL, true },
+        { (uint8_t *)"access-control-expose-headers: ",    NULL, true },
+        { (uint8_t *)"cache-control: ",                    NULL, true },
+        { (uint8_t *)"code: ",                             NULL, true },
+        { (uint8_t *)"connection: ",                       NULL, true },
+        { (uint8_t *)"content-language: ",                 NULL, true },
+        { (uint8_t *)"content-transfer-encoding: ",        NULL, true },
+        { (uint8_t *)"p3p: ",                              NULL, true },
+        { (uint8_t *)"pragma: ",                           NULL, true },
+        { (uint8_t *)"reason: ",                           NULL, true },
+        { (uint8_t *)"server: ",                           NULL, true },
+        { (uint8_t *)"strict-transport-security: ",        NULL, true },
+        { (uint8_t *)"version: ",                          NULL, true },
+        { (uint8_t *)"x-aspnetmvc-version: ",              NULL, true },
+        { (uint8_t *)"x-aspnet-version: ",                 NULL, true },
+        { (uint8_t *)"x-cid: ",                            NULL, true },
+        { (uint8_t *)"x-ms-version: ",                     NULL, true },
+        { (uint8_t *)"x-xss-protection: ",                 NULL, true },
+        { (uint8_t *)"appex-activity-id: ",                NULL, false },
+        { (uint8_t *)"cdnuuid: ",                          NULL, false },
+        { (uint8_t *)"cf-ray: ",                           NULL, false },
+        { (uint8_t *)"content-range: ",                    NULL, false },
+        { (uint8_t *)"content-type: ",                     NULL, false },
+        { (uint8_t *)"date: ",                             NULL, false },
+        { (uint8_t *)"etag: ",                             NULL, false },
+        { (uint8_t *)"expires: ",                          NULL, false },
+        { (uint8_t *)"flow_context: ",                     NULL, false },
+        { (uint8_t *)"ms-cv: ",                            NULL, false },
+        { (uint8_t *)"msregion: ",                         NULL, false },
+        { (uint8_t *)"ms-requestid: ",                     NULL, false },
+        { (uint8_t *)"request-id: ",                       NULL, false },
+        { (uint8_t *)"vary: ",                             NULL, false },
+        { (uint8_t *)"x-amz-cf-pop: ",                     NULL, false },
+        { (uint8_t *)"x-amz-request-id: ",                 NULL, false },
+        { (uint8_t *)"x-azure-ref-originshield: ",         NULL, false },
+        { (uint8_t *)"x-cache: ",                          NULL, false },
+        { (uint8_t *)"x-cache-hits: ",                     NULL, false },
+        { (uint8_t *)"x-ccc: ",                            NULL, false },
+        { (uint8_t *)"x-diagnostic-s: ",                   NULL, false },
+        { (uint8_t *)"x-feserver: ",                       NULL, false },
+        { (uint8_t *)"x-hw: ",                             NULL, false },
+        { (uint8_t *)"x-msedge-ref: ",                     NULL, false },
+        { (uint8_t *)"x-ocsp-responder-id: ",              NULL, false },
+        { (uint8_t *)"x-requestid: ",                      NULL, false },
+        { (uint8_t *)"x-served-by: ",                      NULL, false },
+        { (uint8_t *)"x-timer: ",                          NULL, false },
+        { (uint8_t *)"x-trace-context: ",                  NULL, false }
+    }};
     headers.fingerprint(buf, http_static_keywords);
     buf.write_char('\"');
 }
@@ -6,7 +6,93 @@
 #ifndef HTTP_H
 #define HTTP_H
 
+#include <vector>
 #include "extractor.h"
+#include "arena.h"
+
+/*
+ * An http_header_recognizer holds the set of header names selected
+ * for extraction, compiled at construction into a perfect-hash table
+ * keyed on the length and case-folded bytes of the name.  Matching a
+ * header then costs one table probe and at most one comparison,
+ * however many names the set holds, so the extracted set can grow
+ * without adding a per-header scan penalty.  The constructor searches
+ * for a seed under which the set hashes without collisions, doubling
+ * the table whenever no seed works; for a few dozen names, at a load
+ * factor of at most one half, the search is paid once, at startup.
+ */
+struct http_header_recognizer {
+
+    struct header_name {
+        std::basic_string<uint8_t> name;  /* lowercase, ending with ": "       */
+        const char *json_key;             /* key for JSON output, or NULL      */
+        bool include_value;               /* fingerprint includes the value    */
+    };
+
+    std::vector<header_name> table;       /* empty names mark empty slots      */
+    size_t mask;
+    uint64_t seed;
+
+    http_header_recognizer(const std::vector<header_name> &set) : table{}, mask{0}, seed{0} {
+        size_t table_length = 8;
+        while (table_length < 2 * set.size()) {
+            table_length *= 2;
+        }
+        for (;;) {
+            for (uint64_t s = 0; s < 64; s++) {
+                if (compile(set, table_length, s)) {
+                    return;
+                }
+            }
+            table_length *= 2;   /* no perfect seed at this size; very unlikely */
+        }
+    }
+
+    /* place every name in a table of the given length, under seed s;
+     * returns false as soon as two names collide */
+    bool compile(const std::vector<header_name> &set, size_t table_length, uint64_t s) {
+        table.assign(table_length, header_name{});
+        mask = table_length - 1;
+        seed = s;
+        for (const header_name &h : set) {
+            header_name &slot = table[hash(h.name.data(), h.name.length()) & mask];
+            if (!slot.name.empty()) {
+                return false;
+            }
+            slot = h;
+        }
+        return true;
+    }
+
+    /* FNV-1a over the case-folded bytes, mixed with the seed and the length */
+    uint64_t hash(const uint8_t *data, size_t len) const {
+        uint64_t h = 0xcbf29ce484222325 ^ (seed * 0x9e3779b97f4a7c15) ^ len;
+        for (size_t i = 0; i < len; i++) {
+            h ^= lowercase(data[i]);
+            h *= 0x00000100000001b3;
+        }
+        return h;
+    }
+
+    /*
+     * find(name) returns the entry whose name matches, compared case
+     * insensitively, or NULL; name includes the ": " delimiter, just
+     * as the header parsing loops produce it
+     */
+    const header_name *find(const struct datum &name) const {
+        if (name.is_not_readable()) {
+            return NULL;
+        }
+        const header_name *entry = &table[hash(name.data, name.length()) & mask];
+        if (entry->name.empty()) {
+            return NULL;
+        }
+        if (datum{entry->name.data(), entry->name.data() + entry->name.length()}.case_insensitive_match(name)) {
+            return entry;
+        }
+        return NULL;
+    }
+};
 
 struct http_headers : public datum {
     bool complete;
@@ -31,10 +117,9 @@ struct http_headers : public datum {
 
     void print_host(struct json_object &o, const char *key) const;
     void print_matching_name(struct json_object &o, const char *key, struct datum &name) const;
-    void print_matching_names(struct json_object &o, const char *key, std::list<struct datum> &name) const;
-    void print_matching_names(struct json_object &o, std::list<std::pair<struct datum, std::string>> &name_list) const;
+    void print_matching_names(struct json_object &o, const struct http_header_recognizer &selected) const;
 
-    void fingerprint(struct buffer_stream &buf, std::unordered_map<std::basic_string<uint8_t>, bool> &name_dict) const;
+    void fingerprint(struct buffer_stream &buf, const struct http_header_recognizer &selected) const;
 
 };
 
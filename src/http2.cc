@@ -0,0 +1,338 @@
+/*
+ * http2.c
+ *
+ * HTTP/2 frame parsing and static-table HPACK decoding
+ */
+
+#include <string.h>
+#include <unordered_map>
+#include "asn1/bytestring.h"
+#include "http2.h"
+#include "extractor.h"
+
+/*
+ * the HPACK static table (RFC 7541, Appendix A); index zero is not
+ * used on the wire
+ */
+struct hpack_static_entry {
+    const char *name;
+    const char *value;
+};
+
+#define HPACK_STATIC_TABLE_LEN 61
+
+static const struct hpack_static_entry hpack_static_table[HPACK_STATIC_TABLE_LEN + 1] = {
+    { NULL,                          NULL },
+    { ":authority",                  "" },
+    { ":method",                     "GET" },
+    { ":method",                     "POST" },
+    { ":path",                       "/" },
+    { ":path",                       "/index.html" },
+    { ":scheme",                     "http" },
+    { ":scheme",                     "https" },
+    { ":status",                     "200" },
+    { ":status",                     "204" },
+    { ":status",                     "206" },
+    { ":status",                     "304" },
+    { ":status",                     "400" },
+    { ":status",                     "404" },
+    { ":status",                     "500" },
+    { "accept-charset",              "" },
+    { "accept-encoding",             "gzip, deflate" },
+    { "accept-language",             "" },
+    { "accept-ranges",               "" },
+    { "accept",                      "" },
+    { "access-control-allow-origin", "" },
+    { "age",                         "" },
+    { "allow",                       "" },
+    { "authorization",               "" },
+    { "cache-control",               "" },
+    { "content-disposition",         "" },
+    { "content-encoding",            "" },
+    { "content-language",            "" },
+    { "content-length",              "" },
+    { "content-location",            "" },
+    { "content-range",               "" },
+    { "content-type",                "" },
+    { "cookie",                      "" },
+    { "date",                        "" },
+    { "etag",                        "" },
+    { "expect",                      "" },
+    { "expires",                     "" },
+    { "from",                        "" },
+    { "host",                        "" },
+    { "if-match",                    "" },
+    { "if-modified-since",           "" },
+    { "if-none-match",               "" },
+    { "if-range",                    "" },
+    { "if-unmodified-since",         "" },
+    { "last-modified",               "" },
+    { "link",                        "" },
+    { "location",                    "" },
+    { "max-forwards",                "" },
+    { "proxy-authenticate",          "" },
+    { "proxy-authorization",         "" },
+    { "range",                       "" },
+    { "referer",                     "" },
+    { "refresh",                     "" },
+    { "retry-after",                 "" },
+    { "server",                      "" },
+    { "set-cookie",                  "" },
+    { "strict-transport-security",   "" },
+    { "transfer-encoding",           "" },
+    { "user-agent",                  "" },
+    { "vary",                        "" },
+    { "via",                         "" },
+    { "www-authenticate",            "" }
+};
+
+static void datum_from_string(struct datum &d, const char *s) {
+    d.data = (const unsigned char *)s;
+    d.data_end = d.data + strlen(s);
+}
+
+static bool datum_equals_string(const struct datum &d, const char *s) {
+    size_t len = strlen(s);
+    return d.length() == (ssize_t)len && memcmp(d.data, s, len) == 0;
+}
+
+/*
+ * hpack_int() reads an HPACK integer (RFC 7541, Section 5.1), whose
+ * first byte shares space with the entry type bits
+ */
+static bool hpack_int(struct datum &d, unsigned int prefix_bits, size_t *value) {
+    uint8_t b = 0;
+    if (d.read_uint8(&b) == false) {
+        return false;
+    }
+    uint8_t prefix_mask = (1 << prefix_bits) - 1;
+    size_t v = b & prefix_mask;
+    if (v == prefix_mask) {
+        unsigned int shift = 0;
+        do {
+            if (d.read_uint8(&b) == false || shift > 28) {
+                return false;   /* truncated or implausibly large */
+            }
+            v += (size_t)(b & 0x7f) << shift;
+            shift += 7;
+        } while (b & 0x80);
+    }
+    *value = v;
+    return true;
+}
+
+/*
+ * hpack_string() reads an HPACK string literal (RFC 7541, Section
+ * 5.2); a Huffman-coded literal is skipped, leaving s null, so that
+ * the decoder stays synchronized without maintaining a Huffman
+ * decoder
+ */
+static bool hpack_string(struct datum &d, struct datum &s) {
+    if (d.is_not_empty() == false) {
+        return false;
+    }
+    bool huffman = (d.data[0] & 0x80) != 0;
+    size_t len = 0;
+    if (hpack_int(d, 7, &len) == false) {
+        return false;
+    }
+    if ((ssize_t)len > d.length()) {
+        return false;
+    }
+    if (huffman) {
+        d.skip(len);
+        s.set_null();
+    } else {
+        s.parse(d, len);
+    }
+    return true;
+}
+
+void http2_request::add_header(const struct datum &name, const struct datum &value) {
+    headers[num_headers].name = name;
+    headers[num_headers].value = value;
+    num_headers++;
+
+    if (datum_equals_string(name, ":method")) {
+        method = value;
+    } else if (datum_equals_string(name, ":scheme")) {
+        scheme = value;
+    } else if (datum_equals_string(name, ":path")) {
+        path = value;
+    } else if (datum_equals_string(name, ":authority")) {
+        authority = value;
+    } else if (datum_equals_string(name, "user-agent")) {
+        user_agent = value;
+    }
+}
+
+void http2_request::decode_header_block(struct datum &d) {
+
+    while (d.is_not_empty() && num_headers < HTTP2_MAX_HEADERS) {
+        uint8_t b = d.data[0];
+        struct datum name{NULL, NULL};
+        struct datum value{NULL, NULL};
+        size_t index = 0;
+
+        if (b & 0x80) {
+            /* indexed header field */
+            if (hpack_int(d, 7, &index) == false) {
+                return;
+            }
+            if (index >= 1 && index <= HPACK_STATIC_TABLE_LEN) {
+                datum_from_string(name, hpack_static_table[index].name);
+                datum_from_string(value, hpack_static_table[index].value);
+                add_header(name, value);
+            }
+            /* a dynamic table reference; the entry is unknown */
+
+        } else if ((b & 0xe0) == 0x20) {
+            /* dynamic table size update; no effect on this decoder */
+            if (hpack_int(d, 5, &index) == false) {
+                return;
+            }
+
+        } else {
+            /* literal header field, with or without indexed name */
+            unsigned int prefix_bits = (b & 0x40) ? 6 : 4;
+            if (hpack_int(d, prefix_bits, &index) == false) {
+                return;
+            }
+            if (index == 0) {
+                if (hpack_string(d, name) == false) {
+                    return;
+                }
+            } else if (index <= HPACK_STATIC_TABLE_LEN) {
+                datum_from_string(name, hpack_static_table[index].name);
+            }
+            if (hpack_string(d, value) == false) {
+                return;
+            }
+            if (name.is_not_empty()) {
+                add_header(name, value);
+            }
+        }
+    }
+}
+
+void http2_request::parse(struct datum &p) {
+
+    static const char client_preface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+    const size_t client_preface_len = sizeof(client_preface) - 1;
+
+    if (p.length() < (ssize_t)client_preface_len
+        || memcmp(p.data, client_preface, client_preface_len) != 0) {
+        return;
+    }
+    p.skip(client_preface_len);
+
+    /*
+     * walk the frames that follow the preface; the request headers
+     * are in the first HEADERS frame, and any frame before it
+     * (typically SETTINGS) is skipped by length
+     */
+    while (p.length() >= 9) {
+        size_t frame_length = 0;
+        size_t type = 0;
+        size_t flags = 0;
+        size_t stream_id = 0;
+        p.read_uint<3>(&frame_length);
+        p.read_uint<1>(&type);
+        p.read_uint<1>(&flags);
+        p.read_uint<4>(&stream_id);
+
+        struct datum frame{NULL, NULL};
+        frame.parse_soft_fail(p, frame_length);  /* the last frame may be truncated */
+
+        if (type == HTTP2_FRAME_TYPE_HEADERS) {
+            size_t pad_length = 0;
+            if (flags & 0x08) {                  /* PADDED */
+                uint8_t pl = 0;
+                if (frame.read_uint8(&pl) == false) {
+                    return;
+                }
+                pad_length = pl;
+            }
+            if (flags & 0x20) {                  /* PRIORITY */
+                frame.skip(5);
+            }
+            if (pad_length < (size_t)frame.length()) {
+                frame.data_end -= pad_length;
+            }
+            decode_header_block(frame);
+            return;
+        }
+    }
+}
+
+/*
+ * the fingerprint mirrors the HTTP/1 request fingerprint: the method
+ * and protocol version lead, followed by one element per decoded
+ * header in wire order; the value is included only for the names
+ * below, with a ": " separator so that the elements are comparable
+ * with their HTTP/1 counterparts
+ */
+void http2_request::operator()(struct buffer_stream &b) const {
+    if (is_not_empty() == false) {
+        b.write_char('\"');
+        b.write_char('\"');
+        return;
+    }
+
+    static const std::unordered_map<std::basic_string<uint8_t>, bool> http2_static_keywords = {
+        { { 'a', 'c', 'c', 'e', 'p', 't' }, true },
+        { { 'a', 'c', 'c', 'e', 'p', 't', '-', 'e', 'n', 'c', 'o', 'd', 'i', 'n', 'g' }, true },
+        { { 'd', 'n', 't' }, true },
+        { { 'd', 'p', 'r' }, true },
+        { { 'u', 'p', 'g', 'r', 'a', 'd', 'e', '-', 'i', 'n', 's', 'e', 'c', 'u', 'r', 'e', '-', 'r', 'e', 'q', 'u', 'e', 's', 't', 's' }, true },
+        { { 'x', '-', 'r', 'e', 'q', 'u', 'e', 's', 't', 'e', 'd', '-', 'w', 'i', 't', 'h' }, true },
+        { { ':', 's', 'c', 'h', 'e', 'm', 'e' }, true },
+    };
+
+    b.write_char('\"');
+    b.write_char('(');
+    b.raw_as_hex(method.data, method.data_end - method.data);
+    b.write_char(')');
+    b.write_char('(');
+    b.raw_as_hex((const uint8_t *)"2", 1);     /* protocol version */
+    b.write_char(')');
+
+    for (unsigned int i = 0; i < num_headers; i++) {
+        const struct datum &name = headers[i].name;
+        if (datum_equals_string(name, ":method")) {
+            continue;          /* already emitted as the leading element */
+        }
+        std::basic_string<uint8_t> name_string{name.data, name.data_end};
+        auto pair = http2_static_keywords.find(name_string);
+        b.write_char('(');
+        b.raw_as_hex(name.data, name.data_end - name.data);
+        if (pair != http2_static_keywords.end() && pair->second && headers[i].value.is_not_empty()) {
+            b.raw_as_hex((const uint8_t *)": ", 2);
+            b.raw_as_hex(headers[i].value.data, headers[i].value.data_end - headers[i].value.data);
+        }
+        b.write_char(')');
+    }
+    b.write_char('\"');
+}
+
+void http2_request::write_json(struct json_object &record, bool output_metadata) {
+
+    if (this->is_not_empty()) {
+        struct json_object http{record, "http"};
+        struct json_object http_request{http, "request"};
+        if (output_metadata) {
+            if (method.is_not_empty())     { http_request.print_key_json_string("method", method); }
+            if (scheme.is_not_empty())     { http_request.print_key_json_string("scheme", scheme); }
+            if (path.is_not_empty())       { http_request.print_key_json_string("uri", path); }
+            if (authority.is_not_empty())  { http_request.print_key_json_string("authority", authority); }
+            if (user_agent.is_not_empty()) { http_request.print_key_json_string("user_agent", user_agent); }
+            http_request.print_key_value("fingerprint", *this);
+        } else {
+            /* output only the user-agent */
+            if (user_agent.is_not_empty()) { http_request.print_key_json_string("user_agent", user_agent); }
+        }
+        http_request.close();
+        http.close();
+    }
+
+}
@@ -0,0 +1,76 @@
+/*
+ * http2.h
+ *
+ * HTTP/2 frame parsing and static-table HPACK decoding
+ */
+
+#ifndef HTTP2_H
+#define HTTP2_H
+
+#include "datum.h"
+#include "json_object.h"
+
+/*
+ * From RFC 7540:
+ *
+ *    In HTTP/2, each endpoint is required to send a connection
+ *    preface as a final confirmation of the protocol in use.  [...]
+ *    The client connection preface starts with a sequence of 24
+ *    octets [...] the string "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n".
+ *
+ *    All frames begin with a fixed 9-octet header followed by a
+ *    variable-length payload.
+ *
+ *     +-----------------------------------------------+
+ *     |                 Length (24)                   |
+ *     +---------------+---------------+---------------+
+ *     |   Type (8)    |   Flags (8)   |
+ *     +-+-------------+---------------+-------------------------------+
+ *     |R|                 Stream Identifier (31)                      |
+ *     +=+=============================================================+
+ *     |                   Frame Payload (0...)                      ...
+ *     +---------------------------------------------------------------+
+ *
+ * The header block of the first HEADERS frame is HPACK-encoded (RFC
+ * 7541).  The decoder below is stateless: it resolves indexed entries
+ * against the static table and reads literal strings, but does not
+ * maintain the dynamic table, and it does not decode Huffman-coded
+ * string literals; entries that depend on either are skipped, while
+ * the decoder stays synchronized with the encoding.
+ */
+
+#define HTTP2_FRAME_TYPE_HEADERS  0x01
+
+#define HTTP2_MAX_HEADERS 32
+
+struct http2_header {
+    struct datum name;
+    struct datum value;
+};
+
+struct http2_request {
+    struct datum method;
+    struct datum scheme;
+    struct datum path;
+    struct datum authority;
+    struct datum user_agent;
+    struct http2_header headers[HTTP2_MAX_HEADERS];
+    unsigned int num_headers;
+
+    http2_request() : method{NULL, NULL}, scheme{NULL, NULL}, path{NULL, NULL}, authority{NULL, NULL}, user_agent{NULL, NULL}, num_headers{0} {}
+
+    void parse(struct datum &p);
+
+    bool is_not_empty() const { return num_headers > 0; }
+
+    void write_json(struct json_object &record, bool output_metadata);
+
+    void operator()(struct buffer_stream &b) const;
+
+private:
+    void decode_header_block(struct datum &d);
+
+    void add_header(const struct datum &name, const struct datum &value);
+};
+
+#endif /* HTTP2_H */
@@ -0,0 +1,134 @@
+/*
+ * intern.h
+ *
+ * A per-thread string interning pool.  Fingerprint strings and server
+ * names repeat heavily -- a busy link carries a few thousand distinct
+ * values through millions of flows -- but they travel through the
+ * pipeline as full copies, each one hashed again at every cache or
+ * index that uses it as a key.  The pool below hash-conses them: the
+ * first time a string is seen it is copied and hashed once, and every
+ * later occurrence resolves to the same entry, so equal strings
+ * compare equal as pointers and the stored hash replaces repeated
+ * passes over the bytes.
+ *
+ * Each entry also carries a caller-owned memo slot (note/note_tag): a
+ * pointer to state derived from the string, such as its fingerprint
+ * database record, and a tag naming the generation that state was
+ * derived from.  Hash-consing gives the memo a natural home, turning
+ * a per-flow derivation into a per-distinct-string one.
+ *
+ * Reclamation is by epoch, in the spirit of the generation counters
+ * in analysis.cc: every INTERN_EPOCH_INTERNS intern() calls the pool
+ * sweeps out the entries it did not touch during the epoch just
+ * ended, so a shift in traffic cannot grow the pool without bound.  A
+ * reference returned by intern() therefore stays valid for at least
+ * one full epoch, far longer than the per-packet scope in which the
+ * callers hold it.  Declare an instance thread_local and it needs no
+ * locking.
+ */
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INTERN_NUM_BUCKETS 1024          /* must be a power of two */
+#define INTERN_EPOCH_INTERNS (1 << 16)   /* intern() calls between sweeps */
+
+struct interned_string {
+    struct interned_string *next;   /* bucket chain */
+    uint64_t hash;                  /* FNV-1a over chars[0..len) */
+    uint64_t note_tag;              /* generation the note was derived from */
+    const void *note;               /* caller-owned memo; NULL when unset */
+    uint32_t len;
+    uint32_t last_epoch;
+    char *chars;                    /* len bytes, NUL-terminated; carved
+                                     * from the entry's own allocation */
+};
+
+struct string_intern_table {
+    struct interned_string *bucket[INTERN_NUM_BUCKETS] = {};
+    uint32_t epoch = 0;
+    uint32_t interns = 0;
+
+    ~string_intern_table() {
+        for (size_t i = 0; i < INTERN_NUM_BUCKETS; i++) {
+            struct interned_string *e = bucket[i];
+            while (e != NULL) {
+                struct interned_string *next = e->next;
+                free(e);
+                e = next;
+            }
+        }
+    }
+
+    static uint64_t fnv1a(const uint8_t *data, size_t len) {
+        uint64_t hash = 0xcbf29ce484222325;
+        for (size_t i = 0; i < len; i++) {
+            hash ^= data[i];
+            hash *= 0x00000100000001b3;
+        }
+        return hash;
+    }
+
+    /*
+     * intern(data, len) returns the pool's entry for the string
+     * data[0..len), creating it on first sight; equal strings get the
+     * same entry until a sweep reclaims it.  Returns NULL only when
+     * the allocation of a new entry fails, in which case the caller
+     * falls back to working with its own copy.
+     */
+    struct interned_string *intern(const void *data, size_t len) {
+        if (++interns == INTERN_EPOCH_INTERNS) {
+            interns = 0;
+            advance_epoch();
+        }
+        uint64_t h = fnv1a((const uint8_t *)data, len);
+        struct interned_string **chain = &bucket[h & (INTERN_NUM_BUCKETS - 1)];
+        for (struct interned_string *e = *chain; e != NULL; e = e->next) {
+            if (e->hash == h && e->len == len && memcmp(e->chars, data, len) == 0) {
+                e->last_epoch = epoch;
+                return e;
+            }
+        }
+        struct interned_string *e = (struct interned_string *)malloc(sizeof(*e) + len + 1);
+        if (e == NULL) {
+            return NULL;
+        }
+        e->hash = h;
+        e->note_tag = 0;
+        e->note = NULL;
+        e->len = len;
+        e->last_epoch = epoch;
+        e->chars = (char *)(e + 1);
+        memcpy(e->chars, data, len);
+        e->chars[len] = '\0';
+        e->next = *chain;
+        *chain = e;
+        return e;
+    }
+
+    /*
+     * free every entry not interned during the epoch now ending; an
+     * entry created or returned in this epoch survives the sweep
+     */
+    void advance_epoch() {
+        for (size_t i = 0; i < INTERN_NUM_BUCKETS; i++) {
+            struct interned_string **link = &bucket[i];
+            while (*link != NULL) {
+                struct interned_string *e = *link;
+                if (e->last_epoch != epoch) {
+                    *link = e->next;
+                    free(e);
+                } else {
+                    link = &e->next;
+                }
+            }
+        }
+        epoch++;
+    }
+};
+
+#endif /* INTERN_H */
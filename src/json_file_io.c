@@ -6,6 +6,7 @@
  */
 
 #include <string.h>
+#include <math.h>
 #include <time.h>
 #include <sys/time.h>
 #include <arpa/inet.h>
@@ -25,8 +26,13 @@
 #include "ssh.h"
 #include "dhcp.h"
 #include "tcpip.h"
+#include "checksum.h"
 #include "eth.h"
 #include "udp.h"
+#include "quic.h"
+#include "http2.h"
+#include "hh_sketch.h"
+#include "flow_snapshot.h"
 
 extern struct global_variables global_vars; /* defined in config.c */
 
@@ -34,9 +40,98 @@ extern struct global_variables global_vars; /* defined in config.c */
 #define SNI_HDR_LEN 9
 #define FP_BUF_LEN 2048
 
+/*
+ * creates the filename of the next file in the fileset, which
+ * includes a sequence number and a date/timestamp, and advances the
+ * sequence number; only used when max_records is nonzero
+ */
+static enum status json_file_build_next_name(struct json_file *jf, char *outfile) {
+    char file_num[MAX_HEX];
+    snprintf(file_num, MAX_HEX, "%x", jf->file_num++);
+    enum status status = filename_append(outfile, jf->outfile_name, "-", file_num);
+    if (status) {
+        return status;
+    }
+
+    char time_str[128];
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    strftime(time_str, sizeof(time_str) - 1, "%Y%m%d%H%M%S", localtime(&now.tv_sec));
+    return filename_append(outfile, outfile, "-", time_str);
+}
+
+static FILE *json_file_open_next(struct json_file *jf) {
+    char outfile[MAX_FILENAME];
+
+    if (json_file_build_next_name(jf, outfile) != status_ok) {
+        return NULL;
+    }
+    return fopen(outfile, jf->mode);
+}
+
+/*
+ * The rotation helper thread closes the file that a rotation just
+ * retired, then pre-opens the file for the following rotation, so
+ * that the output path never waits on fclose()/fopen(); a rotation
+ * there costs one pointer swap.  After initialization this thread is
+ * the only one that opens files, so file_num needs no locking.
+ */
+static void *json_file_rotation_thread_func(void *arg) {
+    struct json_file *jf = (struct json_file *)arg;
+
+    pthread_mutex_lock(&jf->rotation_mutex);
+    for (;;) {
+        while (jf->retired_file == NULL && !jf->rotation_stop) {
+            pthread_cond_wait(&jf->rotation_cond, &jf->rotation_mutex);
+        }
+        FILE *retired = jf->retired_file;
+        jf->retired_file = NULL;
+        if (retired == NULL) {
+            break;   /* stop was requested, and there is nothing left to close */
+        }
+        pthread_mutex_unlock(&jf->rotation_mutex);
+
+        if (fclose(retired) != 0) {
+            perror("could not close json file");
+        }
+        FILE *next = json_file_open_next(jf);
+        if (next == NULL) {
+            perror("error: could not pre-open fingerprint output file");
+            exit(255);
+        }
+
+        pthread_mutex_lock(&jf->rotation_mutex);
+        jf->next_file = next;
+        pthread_cond_signal(&jf->rotation_cond);
+    }
+    pthread_mutex_unlock(&jf->rotation_mutex);
+    return NULL;
+}
+
 enum status json_file_rotate(struct json_file *jf) {
     char outfile[MAX_FILENAME];
 
+    if (jf->rotation_thread_used) {
+        /*
+         * pause-free path: swap in the pre-opened file and hand the
+         * old one to the helper thread for closing; if the helper is
+         * still working on the previous swap, wait for it rather
+         * than racing it for file_num
+         */
+        pthread_mutex_lock(&jf->rotation_mutex);
+        while (jf->next_file == NULL) {
+            pthread_cond_wait(&jf->rotation_cond, &jf->rotation_mutex);
+        }
+        jf->retired_file = jf->file;
+        jf->file = jf->next_file;
+        jf->next_file = NULL;
+        pthread_cond_signal(&jf->rotation_cond);
+        pthread_mutex_unlock(&jf->rotation_mutex);
+
+        jf->record_countdown = jf->max_records;
+        return status_ok;
+    }
+
     if (jf->file) {
         // printf("rotating output file\n");
 
@@ -46,21 +141,7 @@ enum status json_file_rotate(struct json_file *jf) {
     }
 
     if (jf->max_records) {
-        /*
-         * create filename that includes sequence number and date/timestamp
-         */
-        char file_num[MAX_HEX];
-        snprintf(file_num, MAX_HEX, "%x", jf->file_num++);
-        enum status status = filename_append(outfile, jf->outfile_name, "-", file_num);
-        if (status) {
-            return status;
-        }
-
-        char time_str[128];
-        struct timeval now;
-        gettimeofday(&now, NULL);
-        strftime(time_str, sizeof(time_str) - 1, "%Y%m%d%H%M%S", localtime(&now.tv_sec));
-        status = filename_append(outfile, outfile, "-", time_str);
+        enum status status = json_file_build_next_name(jf, outfile);
         if (status) {
             return status;
         }
@@ -92,29 +173,132 @@ enum status json_file_init(struct json_file *jf,
     jf->file_num = 0;
     jf->max_records = max_records; /* note: if 0, effectively no rotation */
     jf->file = NULL;               /* initialized in json_file_rotate()   */
+    jf->next_file = NULL;
+    jf->retired_file = NULL;
+    jf->rotation_thread_used = 0;
+    jf->rotation_stop = 0;
+
+    if (json_file_rotate(jf) != status_ok) {
+        return status_err;
+    }
+
+    if (jf->max_records) {
+        /*
+         * start the rotation helper thread with the next file already
+         * pre-opened, so that every subsequent rotation is pause-free
+         */
+        jf->next_file = json_file_open_next(jf);
+        if (jf->next_file == NULL) {
+            perror("error: could not pre-open fingerprint output file");
+            return status_err;
+        }
+        pthread_mutex_init(&jf->rotation_mutex, NULL);
+        pthread_cond_init(&jf->rotation_cond, NULL);
+        int err = pthread_create(&jf->rotation_thread, NULL, json_file_rotation_thread_func, jf);
+        if (err != 0) {
+            fprintf(stderr, "%s: error creating json file rotation thread\n", strerror(err));
+            return status_err;
+        }
+        jf->rotation_thread_used = 1;
+    }
+
+    return status_ok;
+}
 
-    return json_file_rotate(jf);
+/*
+ * json_file_finalize() stops the rotation helper thread, if one is
+ * running, and closes the current and pre-opened files
+ */
+void json_file_finalize(struct json_file *jf) {
+    if (jf->rotation_thread_used) {
+        pthread_mutex_lock(&jf->rotation_mutex);
+        jf->rotation_stop = 1;
+        pthread_cond_signal(&jf->rotation_cond);
+        pthread_mutex_unlock(&jf->rotation_mutex);
+        pthread_join(jf->rotation_thread, NULL);
+        jf->rotation_thread_used = 0;
+    }
+    if (jf->next_file) {
+        fclose(jf->next_file);   /* pre-opened but never written */
+        jf->next_file = NULL;
+    }
+    if (jf->file) {
+        fclose(jf->file);
+        jf->file = NULL;
+    }
+}
+
+/*
+ * cache of textual IP addresses.  Every record formats src_ip and
+ * dst_ip from the binary key, and real traffic repeats addresses
+ * constantly: every packet of a flow carries the same pair, and many
+ * flows share their destination.  Each thread memoizes the conversion
+ * in a small direct-mapped table (as with the fingerprint cache in
+ * tls.cc), so the digit emission runs once per distinct address
+ * rather than twice per record; a hit replays the stored text with a
+ * single copy.  Entries are matched on the binary address itself, so
+ * a slot collision can never emit the wrong text -- it just converts
+ * again.
+ */
+
+#define ADDR_CACHE_NUM_ENTRIES 1024   /* must be a power of two */
+#define ADDR_CACHE_MAX_TEXT_LEN 46    /* the longest textual IPv6 address */
+
+struct addr_text_entry {
+    uint8_t addr[16];             /* binary address; IPv4 uses the first four bytes */
+    uint8_t ip_vers;              /* zero marks an empty slot */
+    uint8_t text_len;
+    char text[ADDR_CACHE_MAX_TEXT_LEN];
+};
+
+static thread_local struct addr_text_entry addr_cache[ADDR_CACHE_NUM_ENTRIES];
+
+static void write_addr_cached(struct buffer_stream &buf, const uint8_t *addr, uint8_t ip_vers) {
+    size_t addr_len = (ip_vers == 6) ? 16 : 4;
+    uint64_t h = 0xcbf29ce484222325;          /* FNV-1a */
+    for (size_t i = 0; i < addr_len; i++) {
+        h ^= addr[i];
+        h *= 0x00000100000001b3;
+    }
+    struct addr_text_entry *e = &addr_cache[h & (ADDR_CACHE_NUM_ENTRIES - 1)];
+    if (e->ip_vers == ip_vers && memcmp(e->addr, addr, addr_len) == 0) {
+        buf.memcpy(e->text, e->text_len);     /* cache hit; skip the conversion */
+        return;
+    }
+    size_t start = buf.length();
+    if (ip_vers == 6) {
+        buf.write_ipv6_addr(addr);
+    } else {
+        buf.write_ipv4_addr(addr);
+    }
+    size_t text_len = buf.length() - start;
+    if (buf.trunc == 0 && text_len <= ADDR_CACHE_MAX_TEXT_LEN) {
+        memcpy(e->addr, addr, addr_len);
+        e->ip_vers = ip_vers;
+        e->text_len = text_len;
+        memcpy(e->text, buf.dstr + start, text_len);
+    }
 }
 
 void write_flow_key(struct buffer_stream &buf, const struct key &k) {
     if (k.ip_vers == 6) {
         const uint8_t *s = (const uint8_t *)&k.addr.ipv6.src;
         buf.strncpy("\"src_ip\":\"");
-        buf.write_ipv6_addr(s);
+        write_addr_cached(buf, s, 6);
 
         const uint8_t *d = (const uint8_t *)&k.addr.ipv6.dst;
         buf.strncpy("\",\"dst_ip\":\"");
-        buf.write_ipv6_addr(d);
+        write_addr_cached(buf, d, 6);
 
     } else {
 
         const uint8_t *s = (const uint8_t *)&k.addr.ipv4.src;
         buf.strncpy("\"src_ip\":\"");
-        buf.write_ipv4_addr(s);
+        write_addr_cached(buf, s, 4);
 
         const uint8_t *d = (const uint8_t *)&k.addr.ipv4.dst;
         buf.strncpy("\",\"dst_ip\":\"");
-        buf.write_ipv4_addr(d);
+        write_addr_cached(buf, d, 4);
     }
 
     buf.strncpy("\",\"protocol\":");
@@ -128,6 +312,40 @@ void write_flow_key(struct buffer_stream &buf, const struct key &k) {
 
 }
 
+#ifndef USE_CBOR_OBJECT
+
+/*
+ * The flow key has the same shape in every record, so its keys and
+ * punctuation are emitted as precomputed skeleton fragments (each a
+ * single fixed-length copy; see json_object::print_skeleton) with
+ * only the values formatted per record.  Every record writes its
+ * fingerprint object before the flow key, so the leading comma in
+ * the first fragment is always correct.
+ */
+void write_flow_key(struct json_object &o, const struct key &k) {
+    if (k.ip_vers == 6) {
+        o.print_skeleton(",\"src_ip\":\"");
+        write_addr_cached(*o.b, (const uint8_t *)&k.addr.ipv6.src, 6);
+        o.print_skeleton("\",\"dst_ip\":\"");
+        write_addr_cached(*o.b, (const uint8_t *)&k.addr.ipv6.dst, 6);
+    } else {
+        o.print_skeleton(",\"src_ip\":\"");
+        write_addr_cached(*o.b, (const uint8_t *)&k.addr.ipv4.src, 4);
+        o.print_skeleton("\",\"dst_ip\":\"");
+        write_addr_cached(*o.b, (const uint8_t *)&k.addr.ipv4.dst, 4);
+    }
+    o.print_skeleton("\",\"protocol\":");
+    o.b->write_uint8(k.protocol);
+    o.print_skeleton(",\"src_port\":");
+    o.b->write_uint16(k.src_port);
+    o.print_skeleton(",\"dst_port\":");
+    o.b->write_uint16(k.dst_port);
+}
+
+#else /* USE_CBOR_OBJECT */
+
+/* CBOR records have no textual skeleton, so each field is written
+ * through the generic interface */
 void write_flow_key(struct json_object &o, const struct key &k) {
     if (k.ip_vers == 6) {
         const uint8_t *s = (const uint8_t *)&k.addr.ipv6.src;
@@ -152,25 +370,689 @@ void write_flow_key(struct json_object &o, const struct key &k) {
 
 }
 
+#endif /* USE_CBOR_OBJECT */
+
+/* the per-packet bump allocator (see arena.h); one per worker thread */
+thread_local struct pkt_arena packet_arena;
+
+/* the tcp reassembler (see tcp.h); one per worker thread, since each
+ * flow is pinned to one thread by the RSS hash */
+thread_local struct tcp_reassembler reassembler;
+
+/*
+ * IP fragment reassembly
+ *
+ * A fragmented datagram cannot be fingerprinted packet-by-packet: the
+ * first fragment may be missing the tail of the message, and the
+ * fragments after it carry no transport header at all, so every piece
+ * of it used to be dropped.  DNS-over-UDP responses fragment
+ * routinely at EDNS sizes, and IKE handshakes with large key payloads
+ * do as well.  The reassembler below follows the design of the TCP
+ * reassembler (tcp.h): a pre-allocated array of fixed-size buffers,
+ * direct mapped by a hash of the addresses and the datagram
+ * identification, so insertion, lookup, and eviction are all O(1) and
+ * memory use is strictly bounded.  Only in-order fragments are
+ * accepted; loss, reordering, an oversized datagram, or a colliding
+ * datagram just abandons reassembly, leaving behavior no worse than
+ * having no reassembler.
+ */
+
+struct ip_frag_buffer {
+    static const size_t data_length = 8192;  // caps the reassembled datagram size
+
+    struct key k;             // addresses of the datagram; ip_vers == 0 marks the entry unused
+    uint32_t identification;  // the IP identification of the datagram being assembled
+    uint8_t protocol;         // the transport protocol of the datagram being assembled
+    uint16_t offset_next;     // the fragment offset expected of the next fragment
+    uint16_t total_length;    // the datagram's length; 0 until the final fragment arrives
+    uint8_t data[data_length];
+
+    ip_frag_buffer() : k{}, identification{0}, protocol{0}, offset_next{0}, total_length{0}, data{} {}
+
+    bool is_in_use() const { return k.ip_vers != 0; }
+
+    void clear() {
+        k = key{};
+        identification = 0;
+        protocol = 0;
+        offset_next = 0;
+        total_length = 0;
+    }
+};
+
+struct ip_reassembler {
+    static const size_t table_length = 256;  // about 2.1MB per thread
+
+    struct ip_frag_buffer *buffer;  // heap allocated; too large for thread-local storage
+
+    ip_reassembler() : buffer{new ip_frag_buffer[table_length]} {  }
+
+    ~ip_reassembler() { delete[] buffer; }
+
+    struct ip_frag_buffer *slot(const struct key &k, uint32_t identification) {
+        return &buffer[(k.hash() ^ identification) % table_length];
+    }
+
+    /*
+     * update() folds one fragment into the datagram being assembled
+     * for (k, identification, protocol), starting one when the
+     * fragment is the datagram's first; the key holds addresses only,
+     * since ports are not known until reassembly completes.  It
+     * returns the buffer holding the complete datagram, or NULL while
+     * the datagram is incomplete.  The returned entry is freed for
+     * reuse, but its data and total_length remain intact until this
+     * thread's reassembler starts another datagram in the same slot,
+     * so the caller can process it in place.
+     */
+    struct ip_frag_buffer *update(const struct key &k, uint32_t identification, uint8_t protocol,
+                                  uint16_t offset, bool more_fragments,
+                                  const uint8_t *data, size_t length) {
+        struct ip_frag_buffer *b = slot(k, identification);
+        if (offset == 0) {
+            /* the first fragment; a colliding in-progress datagram is simply evicted */
+            if (length == 0 || length > ip_frag_buffer::data_length) {
+                b->clear();
+                return NULL;
+            }
+            b->k = k;
+            b->identification = identification;
+            b->protocol = protocol;
+            b->offset_next = length;
+            b->total_length = 0;
+            memcpy(b->data, data, length);
+            return NULL;
+        }
+        if (!b->is_in_use() || !(b->k == k)
+            || b->identification != identification || b->protocol != protocol) {
+            return NULL;   /* no datagram in progress for this fragment */
+        }
+        if (offset != b->offset_next || offset + length > ip_frag_buffer::data_length) {
+            b->clear();    /* loss, reordering, or an oversized datagram; abandon */
+            return NULL;
+        }
+        memcpy(b->data + offset, data, length);
+        b->offset_next = offset + length;
+        if (more_fragments) {
+            return NULL;
+        }
+        b->total_length = offset + length;
+        b->k = key{};   /* free the slot; data and total_length stay valid for the caller */
+        return b;
+    }
+
+};
+
+/* the IP fragment reassembler; one per worker thread, like the tcp
+ * reassembler above */
+thread_local struct ip_reassembler ip_reasm;
+
+/*
+ * Once a flow's fingerprint has been captured, none of its later
+ * packets can produce output, but each of them still paid for
+ * protocol identification.  The skip set remembers fingerprint-
+ * complete flows (currently those whose ClientHello record has been
+ * written) in a small direct-mapped table, so that the rest of the
+ * flow is dropped after the 5-tuple lookup alone; on busy links the
+ * tails of a few elephant flows are most of the packets.  A hash
+ * collision just evicts the older flow, which merely resumes full
+ * processing for it, and a SYN clears any stale entry left by an
+ * earlier connection on the same 5-tuple.
+ */
+struct flow_skip_set {
+    static const size_t table_length = 4096;   // must be a power of two
+
+    struct key *table;   // ip_vers == 0 marks an empty slot
+
+    flow_skip_set() : table{new key[table_length]()} {}
+
+    ~flow_skip_set() { delete[] table; }
+
+    struct key *slot(const struct key &k) {
+        return &table[k.hash() & (table_length - 1)];
+    }
+
+    bool contains(const struct key &k) {
+        return *slot(k) == k;
+    }
+
+    void insert(const struct key &k) {
+        *slot(k) = k;
+    }
+
+    void erase(const struct key &k) {
+        struct key *s = slot(k);
+        if (*s == k) {
+            *s = key{};
+        }
+    }
+};
+
+thread_local struct flow_skip_set flow_skip;
+
+/*
+ * Record deduplication (--dedup) suppresses repeated ClientHello
+ * records: on production links the same (fingerprint, server name,
+ * destination) triple recurs constantly, and every occurrence pays
+ * serialization, queue, and disk cost for a record that downstream
+ * processing collapses anyway.  The table is per thread and direct
+ * mapped, keyed by a hash of the triple; the first record of a triple
+ * is written in full, later ones are suppressed, and the record is
+ * re-emitted once per configured interval, carrying an "occurrences"
+ * count of the observations it represents.  A hash collision
+ * displaces the older triple, which is then re-emitted early if it
+ * returns, so collisions cause extra records, never lost triples.
+ * Suppressed records are counted as filtered, a policy decision.
+ */
+struct dedup_table {
+    static const size_t table_length = 8192;   // must be a power of two
+
+    struct entry {
+        uint64_t hash;         // 0 marks an empty slot
+        time_t last_emit;
+        uint64_t occurrences;  // suppressed since the last emission
+    };
+    struct entry *table;       // heap allocated; the table is large
+
+    /* a warm restart (--flow-snapshot) re-seeds the suppression
+     * state saved at the previous shutdown, so known triples stay
+     * suppressed instead of re-emitting while the table refills; the
+     * pending occurrence counts are per-thread and cannot be
+     * re-attributed across a restart, so they restart at zero */
+    dedup_table() : table{new entry[table_length]()} {
+        const struct flow_snapshot_dedup_entry *entries;
+        size_t count = flow_snapshot_dedup_entries(&entries);
+        for (size_t i = 0; i < count; i++) {
+            struct entry *e = &table[entries[i].hash & (table_length - 1)];
+            e->hash = entries[i].hash;
+            e->last_emit = entries[i].last_emit;
+            e->occurrences = 0;
+        }
+    }
+
+    ~dedup_table() {
+        /* this destructor runs at worker thread exit, before the
+         * main thread writes the snapshot file */
+        if (flow_snapshot_is_active()) {
+            for (size_t i = 0; i < table_length; i++) {
+                if (table[i].hash != 0) {
+                    flow_snapshot_note_dedup(table[i].hash, table[i].last_emit);
+                }
+            }
+        }
+        delete[] table;
+    }
+
+    static uint64_t fnv1a(uint64_t h, const uint8_t *data, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            h ^= data[i];
+            h *= 0x00000100000001b3;
+        }
+        return h;
+    }
+
+    /*
+     * triple_hash() hashes the fingerprint, the server name, and the
+     * destination address and port; the fingerprint is serialized
+     * into a stack buffer, a cost the fingerprint cache (see tls.cc)
+     * keeps small next to the serialization and output that
+     * suppression saves
+     */
+    static uint64_t triple_hash(const struct tls_client_hello &hello, const struct key &k) {
+        uint64_t h = 0xcbf29ce484222325;
+
+        char fp_str[FP_BUF_LEN];
+        struct buffer_stream fp_buf{fp_str, sizeof(fp_str)};
+        hello(fp_buf);
+        if (fp_buf.trunc == 0) {
+            h = fnv1a(h, (const uint8_t *)fp_str, fp_buf.length());
+        }
+
+        struct datum server_name{NULL, NULL};
+        hello.extensions.set_server_name(server_name);
+        if (server_name.is_not_empty()) {
+            h = fnv1a(h, server_name.data, server_name.length());
+        }
+
+        if (k.ip_vers == 6) {
+            h = fnv1a(h, (const uint8_t *)&k.addr.ipv6.dst, sizeof(k.addr.ipv6.dst));
+        } else {
+            h = fnv1a(h, (const uint8_t *)&k.addr.ipv4.dst, sizeof(k.addr.ipv4.dst));
+        }
+        h = fnv1a(h, (const uint8_t *)&k.dst_port, sizeof(k.dst_port));
+
+        if (h == 0) {
+            h = 1;     /* 0 marks an empty slot */
+        }
+        return h;
+    }
+
+    /*
+     * pass(h, sec, occurrences) returns true if the record whose
+     * triple hash is h should be written now, setting *occurrences to
+     * the number of observations it represents; a false return means
+     * the record is suppressed, and charged to the triple's count
+     */
+    bool pass(uint64_t h, time_t sec, uint64_t *occurrences) {
+        struct entry *e = &table[h & (table_length - 1)];
+        if (e->hash != h) {
+            e->hash = h;    /* new triple, or a collision displacing the old one */
+            e->last_emit = sec;
+            e->occurrences = 0;
+            *occurrences = 1;
+            return true;
+        }
+        e->occurrences++;
+        if (sec - e->last_emit >= (time_t)global_vars.dedup_interval) {
+            e->last_emit = sec;
+            *occurrences = e->occurrences;   /* includes this observation */
+            e->occurrences = 0;
+            return true;
+        }
+        return false;
+    }
+};
+
+thread_local struct dedup_table dedup;
+
+/*
+ * the heavy-hitter telemetry (see hh_sketch.h) is fed from the
+ * ClientHello paths with the same three labels the deduplication
+ * triple hashes -- the fingerprint, the server name, and the
+ * destination address and port -- but counted individually, so that
+ * the stats thread can report the top few of each; the sketches
+ * count every observed hello, before deduplication and aggregation
+ */
+static void heavy_hitter_account(const struct tls_client_hello &hello, const struct key &k) {
+    if (hh_sketch_is_enabled() == false) {
+        return;
+    }
+    char fp_str[FP_BUF_LEN];
+    struct buffer_stream fp_buf{fp_str, sizeof(fp_str)};
+    hello(fp_buf);
+    if (fp_buf.trunc == 0) {
+        hh_sketch_update(hh_category_fingerprint, (const uint8_t *)fp_str, fp_buf.length());
+    }
+
+    struct datum server_name{NULL, NULL};
+    hello.extensions.set_server_name(server_name);
+    if (server_name.is_not_empty()) {
+        hh_sketch_update(hh_category_server_name, server_name.data, server_name.length());
+    }
+
+    char dst_str[64];
+    struct buffer_stream dst_buf{dst_str, sizeof(dst_str)};
+    if (k.ip_vers == 6) {
+        dst_buf.write_ipv6_addr((const uint8_t *)&k.addr.ipv6.dst);
+    } else {
+        dst_buf.write_ipv4_addr((const uint8_t *)&k.addr.ipv4.dst);
+    }
+    dst_buf.strncpy(":");
+    dst_buf.write_uint16(k.dst_port);
+    if (dst_buf.trunc == 0) {
+        hh_sketch_update(hh_category_destination, (const uint8_t *)dst_str, dst_buf.length());
+    }
+}
+
+/*
+ * The entropy report (--unknown-entropy) covers the flows that the
+ * protocol matchers say nothing about: without it, an encrypted
+ * tunnel on an unregistered port and an idle chat protocol look
+ * identical, namely absent from the output.  For each such flow, the
+ * byte entropy of its first sizeable payload is reported once, in an
+ * "unknown" record; the set below remembers which flows have been
+ * reported, in the same direct-mapped form as the skip set above,
+ * and with the same collision policy (an evicted flow may be
+ * reported again, never lost).
+ */
+struct entropy_seen_set {
+    static const size_t table_length = 4096;   // must be a power of two
+
+    struct key *table;   // ip_vers == 0 marks an empty slot
+
+    entropy_seen_set() : table{new key[table_length]()} {}
+
+    ~entropy_seen_set() { delete[] table; }
+
+    struct key *slot(const struct key &k) {
+        return &table[k.hash() & (table_length - 1)];
+    }
+
+    /* returns true if k was already present, inserting it otherwise */
+    bool test_and_set(const struct key &k) {
+        struct key *s = slot(k);
+        if (*s == k) {
+            return true;
+        }
+        *s = k;
+        return false;
+    }
+
+    void erase(const struct key &k) {
+        struct key *s = slot(k);
+        if (*s == k) {
+            *s = key{};
+        }
+    }
+};
+
+thread_local struct entropy_seen_set entropy_seen;
+
+/*
+ * payload_entropy(data, len) returns the Shannon entropy of the byte
+ * distribution of data, in bits per byte; 8.0 means uniformly random
+ * (ciphertext, compressed data), plaintext protocols score far lower.
+ * The histogram is kept in four interleaved sub-tables, so that a run
+ * of one repeated byte, common in binary padding, does not serialize
+ * every increment behind the same counter's store-to-load dependency;
+ * the sub-tables are merged in the entropy sum.
+ */
+static double payload_entropy(const uint8_t *data, size_t len) {
+    uint32_t count[4][256] = { { 0 } };
+
+    size_t i = 0;
+    for ( ; i + 4 <= len; i += 4) {
+        count[0][data[i]]++;
+        count[1][data[i+1]]++;
+        count[2][data[i+2]]++;
+        count[3][data[i+3]]++;
+    }
+    for ( ; i < len; i++) {
+        count[0][data[i]]++;
+    }
+
+    double h = 0.0;
+    for (size_t b = 0; b < 256; b++) {
+        uint32_t c = count[0][b] + count[1][b] + count[2][b] + count[3][b];
+        if (c) {
+            double p = (double)c / (double)len;
+            h -= p * log2(p);
+        }
+    }
+    return h;
+}
+
+/*
+ * Flow aggregation (--aggregate-flows) merges the client and server
+ * halves of a TLS session into one record: the serialized ClientHello
+ * fingerprint and metadata are held, keyed on the flow's 5-tuple,
+ * until the server response arrives on the mirrored tuple, and the
+ * merged record then carries both halves under the client's flow key
+ * and start time.  The table is per thread and direct mapped; a
+ * colliding entry, or one whose server response never arrives, is
+ * emitted alone, either inline when its slot is reused or swept, or
+ * through the flush path at shutdown, so records are delayed but
+ * never lost.  Records are not aggregated when analysis is enabled,
+ * since the analysis object belongs to the client record alone.
+ */
+struct flow_record {
+    static const size_t data_length = 4096;
+
+    struct key k;              // client-to-server key; ip_vers == 0 marks an empty slot
+    struct timespec ts;        // ClientHello arrival time
+    uint64_t last_used;
+    uint16_t fp_len;           // fingerprint member: "tls":"(...)"
+    uint16_t meta_len;         // metadata member: "client":{...}
+    char data[data_length];    // fingerprint member, then metadata member
+};
+
+struct flow_aggregator {
+    static const size_t table_length = 1024;    // must be a power of two
+    static const uint64_t expiry_age = 65536;   // lookups before a lone client record is emitted
+
+    struct flow_record *table;  // heap allocated; too large for thread-local storage
+    uint64_t clock;
+    size_t sweep_cursor;
+
+    flow_aggregator() : table{new flow_record[table_length]()}, clock{0}, sweep_cursor{0} {}
+
+    ~flow_aggregator() { delete[] table; }
+
+    struct flow_record *slot(const struct key &k) {
+        return &table[k.hash() & (table_length - 1)];
+    }
+
+    struct flow_record *find(const struct key &k) {
+        struct flow_record *e = slot(k);
+        if (e->k == k) {
+            return e;
+        }
+        return NULL;
+    }
+
+    /*
+     * emit_single() writes the held client-only record, newline
+     * terminated, and frees the slot
+     */
+    void emit_single(struct flow_record *e, struct buffer_stream &buf) {
+        struct json_object record{&buf};
+        struct json_object fps{record, "fingerprints"};
+        fps.print_raw_members(e->data, e->fp_len);
+        fps.close();
+        struct json_object tls{record, "tls"};
+        tls.print_raw_members(e->data + e->fp_len, e->meta_len);
+        tls.close();
+        write_flow_key(record, e->k);
+        record.print_key_timestamp("event_start", &e->ts);
+        record.close();
+#ifndef USE_CBOR_OBJECT
+        buf.strncpy("\n");   /* CBOR records are self-delimiting */
+#endif
+        e->k = key{};
+    }
+
+    /*
+     * stash() serializes a ClientHello's fingerprint and metadata
+     * into the flow's slot; a colliding entry is emitted into buf
+     * first, so it is delayed rather than lost.  Returns false when
+     * the serialized form does not fit, in which case the caller
+     * emits a normal record instead.
+     */
+    bool stash(const struct key &k, const struct timespec *ts, const struct tls_client_hello &hello,
+               bool metadata, struct buffer_stream &buf) {
+        struct flow_record *e = slot(k);
+        if (e->k.ip_vers != 0 && !(e->k == k)) {
+            emit_single(e, buf);
+        }
+        struct buffer_stream fp{e->data, (int)flow_record::data_length};
+#ifndef USE_CBOR_OBJECT
+        fp.puts("\"tls\":");
+        hello(fp);
+#else
+        /* as in print_key_value(): the fingerprint text is captured
+         * and framed as a CBOR text string */
+        cbor_write_key(&fp, "tls");
+        char tmp[1024];
+        struct buffer_stream tb{tmp, sizeof(tmp)};
+        hello(tb);
+        if (tb.trunc) {
+            e->k = key{};
+            return false;
+        }
+        cbor_write_text(&fp, (const uint8_t *)tmp, tb.length());
+#endif
+        if (fp.trunc) {
+            e->k = key{};
+            return false;
+        }
+        struct buffer_stream meta{e->data + fp.length(), (int)(flow_record::data_length - fp.length())};
+#ifndef USE_CBOR_OBJECT
+        meta.puts("\"client\":");
+#else
+        cbor_write_key(&meta, "client");
+#endif
+        struct json_object client{&meta};
+        hello.write_json_members(client, metadata);
+        client.close();
+        if (meta.trunc) {
+            e->k = key{};
+            return false;
+        }
+        e->k = k;
+        e->ts = *ts;
+        e->last_used = clock;
+        e->fp_len = fp.length();
+        e->meta_len = meta.length();
+        return true;
+    }
+
+    /*
+     * sweep() advances the clock and examines the slot under the
+     * cursor, emitting its record alone if its server response has
+     * not arrived within the expiry window
+     */
+    void sweep(struct buffer_stream &buf) {
+        clock++;
+        struct flow_record *e = &table[sweep_cursor];
+        if (e->k.ip_vers != 0 && clock - e->last_used > expiry_age) {
+            emit_single(e, buf);
+        }
+        sweep_cursor = (sweep_cursor + 1) & (table_length - 1);
+    }
+};
+
+thread_local struct flow_aggregator flow_agg;
+
+/* reverse_key() mirrors a flow key, mapping one direction of a
+ * connection onto the other */
+static struct key reverse_key(const struct key &k) {
+    struct key r = k;
+    r.src_port = k.dst_port;
+    r.dst_port = k.src_port;
+    if (k.ip_vers == 6) {
+        r.addr.ipv6.src = k.addr.ipv6.dst;
+        r.addr.ipv6.dst = k.addr.ipv6.src;
+    } else {
+        r.addr.ipv4.src = k.addr.ipv4.dst;
+        r.addr.ipv4.dst = k.addr.ipv4.src;
+    }
+    return r;
+}
+
+/*
+ * tcp_message_length() returns the total length of the message whose
+ * first bytes are in data, or 0 if it cannot be determined.  Only the
+ * TLS handshake messages that carry fingerprints or certificates are
+ * reported, since those are the messages worth reassembling when they
+ * extend past one segment.
+ */
+static size_t tcp_message_length(const uint8_t *data, size_t length, enum msg_type msg_type) {
+    switch(msg_type) {
+    case msg_type_tls_client_hello:
+    case msg_type_tls_server_hello:
+    case msg_type_tls_certificate:
+        if (length >= 5) {
+            return 5 + (((size_t)data[3] << 8) | (size_t)data[4]);  /* TLS record header and body */
+        }
+        break;
+    default:
+        ;
+    }
+    return 0;
+}
+
 int append_packet_json(struct buffer_stream &buf,
                        uint8_t *packet,
                        size_t length,
                        struct timespec *ts) {
+
+    packet_arena.reset();  /* the previous packet's temporaries are dead */
+
+    if (global_vars.aggregate_flows && !global_vars.do_analysis) {
+        flow_agg.sweep(buf);   /* emit a held record whose server response never came */
+    }
+
     struct key k;
     struct datum pkt{packet, packet+length};
     size_t transport_proto = 0;
     size_t ethertype = 0;
     parser_process_eth(&pkt, &ethertype);
+
+    /*
+     * the checksum verification gate (--verify-checksums): a corrupt
+     * frame is discarded here, before any protocol parsing, so it can
+     * neither produce a garbage fingerprint nor poison the state
+     * keyed on fingerprints downstream; the caller counts it as
+     * filtered
+     */
+    if (global_vars.verify_checksums && ethertype == ETH_TYPE_IP
+        && !ipv4_checksums_valid(pkt.data, pkt.length())) {
+        return 0;
+    }
+
+    struct ip_fragment_fields frag;
     switch(ethertype) {
     case ETH_TYPE_IP:
-        parser_process_ipv4(&pkt, &transport_proto, &k);
+        parser_process_ipv4(&pkt, &transport_proto, &k, &frag);
         break;
     case ETH_TYPE_IPV6:
-        parser_process_ipv6(&pkt, &transport_proto, &k);
+        parser_process_ipv6(&pkt, &transport_proto, &k, &frag);
         break;
     default:
         ;
     }
+
+    /*
+     * a fragmented datagram is reassembled (see ip_reassembler,
+     * above) before the transport dispatch: only its first fragment
+     * carries a transport header, and that fragment may be missing
+     * the tail of the message, so no piece of it can be processed on
+     * its own.  The fragment that completes a datagram is replaced by
+     * the whole datagram here; the earlier fragments, and all the
+     * fragments of a datagram that never completes, produce no
+     * record, and the caller counts them as filtered.
+     */
+    if (frag.is_fragment() && pkt.length() > 0) {
+        struct ip_frag_buffer *fbuf = ip_reasm.update(k, frag.identification, transport_proto,
+                                                      frag.offset, frag.more_fragments,
+                                                      pkt.data, pkt.length());
+        if (fbuf == NULL) {
+            return 0;
+        }
+        pkt = datum{fbuf->data, fbuf->data + fbuf->total_length};
+    }
+
+    /*
+     * GRE and GTP-U tunnels are decapsulated in place, so that the
+     * inner flows are fingerprinted just like native traffic; note
+     * that the flow key reports the inner addresses and ports.  A
+     * short fixed limit guards against pathological nesting.
+     */
+    for (unsigned int encap = 0; encap < 3; encap++) {
+        if (transport_proto == 47) {
+            size_t inner_ethertype = 0;
+            if (parser_skip_gre_header(&pkt, &inner_ethertype) != status_ok) {
+                transport_proto = 0;
+                break;
+            }
+            transport_proto = 0;
+            if (inner_ethertype == ETH_TYPE_IP) {
+                parser_process_ipv4(&pkt, &transport_proto, &k);
+            } else if (inner_ethertype == ETH_TYPE_IPV6) {
+                parser_process_ipv6(&pkt, &transport_proto, &k);
+            } else {
+                break;
+            }
+        } else if (transport_proto == 17
+                   && pkt.length() >= (int)sizeof(struct udp_header)
+                   && ntohs(((const struct udp_header *)pkt.data)->dst_port) == GTP_PORT) {
+            pkt.skip(sizeof(struct udp_header));
+            if (parser_skip_gtp_header(&pkt) != status_ok || pkt.length() < 1) {
+                transport_proto = 0;
+                break;
+            }
+            transport_proto = 0;
+            if ((pkt.data[0] & 0xf0) == 0x40) {
+                parser_process_ipv4(&pkt, &transport_proto, &k);
+            } else if ((pkt.data[0] & 0xf0) == 0x60) {
+                parser_process_ipv6(&pkt, &transport_proto, &k);
+            } else {
+                break;
+            }
+        } else {
+            break;
+        }
+    }
+
     enum msg_type msg_type = msg_type_unknown;
     if (transport_proto == 6) {
         struct tcp_packet tcp_pkt;
@@ -187,8 +1069,41 @@ int append_packet_json(struct buffer_stream &buf,
             write_flow_key(record, k);
             record.print_key_timestamp("event_start", ts);
             record.close();
+            flow_skip.erase(k);   /* a new connection may reuse the 5-tuple */
+            if (global_vars.unknown_entropy) {
+                entropy_seen.erase(k);
+            }
+        } else if (flow_skip.contains(k)) {
+            return 0;             /* this flow's fingerprint has been captured */
         }
         msg_type = get_message_type(pkt.data, pkt.length());
+
+        /*
+         * a handshake message that extends past this segment (a
+         * ClientHello with post-quantum key shares, a large
+         * certificate chain) is buffered by the reassembler and
+         * processed when its remaining segments arrive, in place of
+         * the segment that completes it
+         */
+        if (tcp_pkt.header != NULL && pkt.length() > 0) {
+            uint32_t seq = ntohl(tcp_pkt.header->seq);
+            if (msg_type == msg_type_unknown) {
+                struct tcp_buffer *tbuf = reassembler.continue_message(k, seq, pkt.data, pkt.length());
+                if (tbuf != NULL) {
+                    pkt = datum{tbuf->data, tbuf->data + tbuf->bytes_needed};
+                    msg_type = get_message_type(pkt.data, pkt.length());
+                }
+            } else {
+                size_t msg_len = tcp_message_length(pkt.data, pkt.length(), msg_type);
+                if (msg_len > (size_t)pkt.length()) {
+                    reassembler.start_message(k, seq + pkt.length(), pkt.data, pkt.length(), msg_len);
+                    msg_type = msg_type_unknown;   /* wait for the rest of the message */
+                    if (global_vars.unknown_entropy) {
+                        entropy_seen.test_and_set(k);   /* under reassembly, not unidentified */
+                    }
+                }
+            }
+        }
     } else if (transport_proto == 17) {
         struct udp_packet udp_pkt;
         udp_pkt.parse(pkt);
@@ -196,6 +1111,15 @@ int append_packet_json(struct buffer_stream &buf,
         msg_type = udp_get_message_type(pkt.data, pkt.length());
     }
 
+    /* per-protocol accounting, and the optional parse-cost sampling
+     * (see extractor.h); the timed region is the protocol parse and
+     * serialization below, which is where this path spends its time */
+    bool stats_sampled = extractor_stats_sample_due();
+    uint64_t stats_start_cycles = 0;
+    if (stats_sampled) {
+        stats_start_cycles = extractor_stats_cycles();
+    }
+
     switch(msg_type) {
     case msg_type_http_request:
         {
@@ -223,11 +1147,35 @@ int append_packet_json(struct buffer_stream &buf,
             struct tls_client_hello hello;
             hello.parse(handshake.body);
             if (hello.is_not_empty()) {
+                heavy_hitter_account(hello, k);
+                /*
+                 * deduplication takes precedence over aggregation: a
+                 * suppressed record is neither written nor held.  The
+                 * analysis object is a function of the triple, so
+                 * suppression loses no distinct observations there
+                 * either.
+                 */
+                uint64_t dedup_occurrences = 0;
+                if (global_vars.dedup_interval
+                    && dedup.pass(dedup_table::triple_hash(hello, k), ts->tv_sec, &dedup_occurrences) == false) {
+                    if (transport_proto == 6) {
+                        flow_skip.insert(k);   /* suppressed; skip the rest of the flow too */
+                    }
+                    break;   /* counted as filtered by the caller */
+                }
+                if (global_vars.aggregate_flows && !global_vars.do_analysis && transport_proto == 6
+                    && flow_agg.stash(k, ts, hello, global_vars.metadata_output, buf)) {
+                    flow_skip.insert(k);   /* held until the server responds or a timeout fires */
+                    break;
+                }
                 struct json_object record{&buf};
                 struct json_object fps{record, "fingerprints"};
                 fps.print_key_value("tls", hello);
                 fps.close();
                 hello.write_json(record, global_vars.metadata_output);
+                if (global_vars.attribute_resumptions) {
+                    tls_resumption_note(hello, k, record);
+                }
                 /*
                  * output analysis (if it's configured)
                  */
@@ -236,7 +1184,13 @@ int append_packet_json(struct buffer_stream &buf,
                 }
                 write_flow_key(record, k);
                 record.print_key_timestamp("event_start", ts);
+                if (global_vars.dedup_interval) {
+                    record.print_key_uint("occurrences", dedup_occurrences);
+                }
                 record.close();
+                if (transport_proto == 6) {
+                    flow_skip.insert(k);   /* nothing more to capture from this direction */
+                }
             }
         }
         break;
@@ -274,19 +1228,36 @@ int append_packet_json(struct buffer_stream &buf,
             bool have_hello = hello.is_not_empty();
             bool have_certificate = certificate.is_not_empty();
             if (have_hello || have_certificate) {
+
+                // when aggregating, a held ClientHello on the mirrored
+                // 5-tuple is merged into this record, which is then
+                // reported under the client's flow key and start time
+                //
+                struct flow_record *client_half = NULL;
+                if (global_vars.aggregate_flows && !global_vars.do_analysis && transport_proto == 6) {
+                    client_half = flow_agg.find(reverse_key(k));
+                }
                 struct json_object record{&buf};
 
                 // output fingerprint
-                if (have_hello) {
+                if (have_hello || client_half) {
                     struct json_object fps{record, "fingerprints"};
-                    fps.print_key_value("tls_server", hello);
+                    if (client_half) {
+                        fps.print_raw_members(client_half->data, client_half->fp_len);
+                    }
+                    if (have_hello) {
+                        fps.print_key_value("tls_server", hello);
+                    }
                     fps.close();
                 }
 
                 // output certificate (always) and server_hello (if configured to)
                 //
-                if ((global_vars.metadata_output && have_hello) || have_certificate) {
+                if ((global_vars.metadata_output && have_hello) || have_certificate || client_half) {
                     struct json_object tls{record, "tls"};
+                    if (client_half) {
+                        tls.print_raw_members(client_half->data + client_half->fp_len, client_half->meta_len);
+                    }
                     struct json_object tls_server{tls, "server"};
                     if (global_vars.metadata_output && have_hello) {
                         hello.write_json(tls_server);
@@ -299,8 +1270,14 @@ int append_packet_json(struct buffer_stream &buf,
                     tls_server.close();
                     tls.close();
                 }
-                write_flow_key(record, k);
-                record.print_key_timestamp("event_start", ts);
+                if (client_half) {
+                    write_flow_key(record, client_half->k);
+                    record.print_key_timestamp("event_start", &client_half->ts);
+                    client_half->k = key{};
+                } else {
+                    write_flow_key(record, k);
+                    record.print_key_timestamp("event_start", ts);
+                }
                 record.close();
             }
         }
@@ -342,7 +1319,8 @@ int append_packet_json(struct buffer_stream &buf,
             write_dns_server_data(pkt.data,
                                   pkt.length(),
                                   dns,
-                                  !global_vars.dns_json_output);
+                                  !global_vars.dns_json_output,
+                                  global_vars.dns_sections);
             dns.close();
             write_flow_key(record, k);
             record.print_key_timestamp("event_start", ts);
@@ -359,6 +1337,17 @@ int append_packet_json(struct buffer_stream &buf,
                 struct tls_client_hello hello;
                 hello.parse(handshake.body);
                 if (hello.is_not_empty()) {
+                    heavy_hitter_account(hello, k);
+                    /*
+                     * the deduplication table is shared with TLS: the
+                     * triple hash covers the protocol version bytes,
+                     * so DTLS and TLS triples cannot collide
+                     */
+                    uint64_t dedup_occurrences = 0;
+                    if (global_vars.dedup_interval
+                        && dedup.pass(dedup_table::triple_hash(hello, k), ts->tv_sec, &dedup_occurrences) == false) {
+                        break;   /* counted as filtered by the caller */
+                    }
                     struct json_object record{&buf};
                     struct json_object fps{record, "fingerprints"};
                     fps.print_key_value("dtls", hello);
@@ -366,11 +1355,56 @@ int append_packet_json(struct buffer_stream &buf,
                     hello.write_json(record, global_vars.metadata_output);
                     write_flow_key(record, k);
                     record.print_key_timestamp("event_start", ts);
+                    if (global_vars.dedup_interval) {
+                        record.print_key_uint("occurrences", dedup_occurrences);
+                    }
                     record.close();
                 }
             }
         }
         break;
+    case msg_type_http2:
+        {
+            struct http2_request request;
+            request.parse(pkt);
+            if (request.is_not_empty()) {
+                struct json_object record{&buf};
+                struct json_object fps{record, "fingerprints"};
+                fps.print_key_value("http", request);
+                fps.close();
+                request.write_json(record, global_vars.metadata_output);
+                write_flow_key(record, k);
+                record.print_key_timestamp("event_start", ts);
+                record.close();
+            }
+        }
+        break;
+    case msg_type_quic_init:
+        {
+            struct quic_initial_packet quic_pkt{pkt};
+            uint8_t crypto_buf[QUIC_CRYPTO_BUF_LEN];
+            struct datum crypto_stream{NULL, NULL};
+            if (quic_decrypt_initial(quic_pkt, crypto_buf, sizeof(crypto_buf), crypto_stream)) {
+                struct tls_handshake handshake;
+                handshake.parse(crypto_stream);
+                if (handshake.msg_type == handshake_type::client_hello) {
+                    struct tls_client_hello hello;
+                    hello.parse(handshake.body);
+                    if (hello.is_not_empty()) {
+                        heavy_hitter_account(hello, k);
+                        struct json_object record{&buf};
+                        struct json_object fps{record, "fingerprints"};
+                        fps.print_key_value("quic", hello);
+                        fps.close();
+                        hello.write_json(record, global_vars.metadata_output);
+                        write_flow_key(record, k);
+                        record.print_key_timestamp("event_start", ts);
+                        record.close();
+                    }
+                }
+            }
+        }
+        break;
     case msg_type_ssh:
         {
             struct ssh_init_packet init_packet;
@@ -434,68 +1468,240 @@ int append_packet_json(struct buffer_stream &buf,
         break;
     case msg_type_dtls_server_hello:
     case msg_type_dtls_certificate:
-        // cases that fall through here are not yet supported
+        {
+            /*
+             * the server side of a DTLS handshake, parsed with the
+             * same hello and certificate classes as TLS; only the
+             * record and handshake framing differ.  A Certificate
+             * message may share the ServerHello's flight, either in
+             * the same record or in a record of its own, so both
+             * places are checked; a certificate fragmented across
+             * datagrams is reported truncated, like an unreassembled
+             * TCP certificate is.
+             */
+            struct dtls_record dtls_rec;
+            dtls_rec.parse(pkt);
+            struct dtls_handshake handshake;
+            handshake.parse(dtls_rec.fragment);
+            struct tls_server_hello hello;
+            struct tls_server_certificate certificate;
+            if (handshake.msg_type == handshake_type::server_hello) {
+                hello.parse(handshake.body);
+                if (dtls_rec.fragment.is_not_empty()) {
+                    struct dtls_handshake h{dtls_rec.fragment};
+                    if (h.msg_type == handshake_type::certificate) {
+                        certificate.parse(h.body);
+                    }
+                }
+                if (pkt.is_not_empty()) {
+                    struct dtls_record rec2;
+                    rec2.parse(pkt);
+                    struct dtls_handshake h2;
+                    h2.parse(rec2.fragment);
+                    if (h2.msg_type == handshake_type::certificate) {
+                        certificate.parse(h2.body);
+                    }
+                }
+            } else if (handshake.msg_type == handshake_type::certificate) {
+                certificate.parse(handshake.body);
+            }
+            bool have_hello = hello.is_not_empty();
+            bool have_certificate = certificate.is_not_empty();
+            if (have_hello || have_certificate) {
+                struct json_object record{&buf};
+                if (have_hello) {
+                    struct json_object fps{record, "fingerprints"};
+                    fps.print_key_value("dtls_server", hello);
+                    fps.close();
+                }
+                if ((global_vars.metadata_output && have_hello) || have_certificate) {
+                    struct json_object dtls{record, "dtls"};
+                    struct json_object dtls_server{dtls, "server"};
+                    if (global_vars.metadata_output && have_hello) {
+                        hello.write_json(dtls_server);
+                    }
+                    if (have_certificate) {
+                        struct json_array server_certs{dtls_server, "certs"};
+                        certificate.write_json(server_certs, global_vars.certs_json_output);
+                        server_certs.close();
+                    }
+                    dtls_server.close();
+                    dtls.close();
+                }
+                write_flow_key(record, k);
+                record.print_key_timestamp("event_start", ts);
+                record.close();
+            }
+        }
+        break;
     case msg_type_unknown:
-        // no output
+        /*
+         * report the flow's first sizeable payload once, if configured
+         * to; shorter payloads are skipped, since their histograms are
+         * too sparse for the entropy to mean anything
+         */
+        if (global_vars.unknown_entropy
+            && (transport_proto == 6 || transport_proto == 17)
+            && pkt.length() >= 32
+            && !entropy_seen.test_and_set(k)) {
+            struct json_object record{&buf};
+            struct json_object unk{record, "unknown"};
+            unk.print_key_uint("length", pkt.length());
+            unk.print_key_float("entropy", payload_entropy(pkt.data, pkt.length()));
+            unk.close();
+            write_flow_key(record, k);
+            record.print_key_timestamp("event_start", ts);
+            record.close();
+        }
         break;
     }
 
+    extractor_stats_account(msg_type, length, stats_sampled,
+                            stats_sampled ? extractor_stats_cycles() - stats_start_cycles : 0);
+
     //    buf.snprintf(dstr, doff, dlen, trunc, ",\"flowhash\":\"%016lx\"", flowhash(key, ts->tv_sec));
 
     if (buf.length() != 0) {
-        buf.strncpy("\n");
+#ifndef USE_CBOR_OBJECT
+        if (buf.dstr[buf.length()-1] != '\n') {   /* an emitted held record brings its own newline */
+            buf.strncpy("\n");   /* CBOR records are self-delimiting */
+        }
+#endif
         return buf.length();
     }
     return 0;
 }
 
-void json_queue_write(struct ll_queue *llq,
+bool json_queue_write(struct ll_queue *llq,
                       uint8_t *packet,
                       size_t length,
                       unsigned int sec,
                       unsigned int nsec) {
 
-    if (llq->msgs[llq->widx].used == 0) {
+    struct llq_msg *msg = llq_write_slot(llq);
+    if (msg != NULL) {
 
-        //char obuf[LLQ_MSG_SIZE];
-        // int olen = LLQ_MSG_SIZE;
-        // int ooff = 0;
-        // int trunc = 0;
+        msg->ts.tv_sec = sec;
+        msg->ts.tv_nsec = nsec;
 
-        llq->msgs[llq->widx].ts.tv_sec = sec;
-        llq->msgs[llq->widx].ts.tv_nsec = nsec;
+        char *msg_buf = llq_msg_buf(msg);
+        msg_buf[0] = '\0';
 
-
-        //obuf[sizeof(struct timespec)] = '\0';
-        llq->msgs[llq->widx].buf[0] = '\0';
-
-        struct buffer_stream buf(llq->msgs[llq->widx].buf, LLQ_MSG_SIZE);
-        append_packet_json(buf, packet, length, &(llq->msgs[llq->widx].ts));
+        struct buffer_stream buf(msg_buf, LLQ_MSG_SIZE);
+        append_packet_json(buf, packet, length, &(msg->ts));
         int r = buf.length();
         if ((buf.trunc == 0) && (r > 0)) {
 
-            llq->msgs[llq->widx].len = r;
+            msg->len = r;
 
             //fprintf(stderr, "DEBUG: sent a message!\n");
-            __sync_synchronize(); /* A full memory barrier prevents the following flag set from happening too soon */
-            llq->msgs[llq->widx].used = 1;
+            llq_publish(llq, msg);
 
             /* fprintf(stderr, "DEBUG QUEUE %d packet time: %ld.%09ld\n", */
             /*         llq->qnum, */
-            /*         llq->msgs[llq->widx].ts.tv_sec, */
-            /*         llq->msgs[llq->widx].ts.tv_nsec); */
-
-            //llq->next_write();
-            llq->widx = (llq->widx + 1) % LLQ_DEPTH;
+            /*         msg->ts.tv_sec, */
+            /*         msg->ts.tv_nsec); */
+            return true;
+        } else if (buf.trunc != 0) {
+            llq->truncated++;  /* the record outgrew LLQ_MSG_SIZE; an involuntary loss */
+        } else {
+            llq->filtered++;   /* the filter selected nothing from this packet; a policy decision */
         }
     }
     else {
-        //fprintf(stderr, "DEBUG: queue bucket used!\n");
+        llq->enqueue_drops++;  /* reported by the stats thread alongside socket_drops */
+    }
+    return false;
+}
+
+/*
+ * json_file_write() writes a record directly into a per-thread output
+ * file, with no lockless queue and no output thread in between; it is
+ * used in --separate-files mode, where downstream tooling handles any
+ * cross-thread ordering
+ */
+void json_file_write(struct json_file *jf,
+                     uint8_t *packet,
+                     size_t length,
+                     unsigned int sec,
+                     unsigned int nsec) {
+
+    struct timespec ts;
+    ts.tv_sec = sec;
+    ts.tv_nsec = nsec;
 
-        // TODO: this is where we'd update an output drop counter
-        // but currently this spot in the code doesn't have access to
-        // any thread stats pointer or similar and I don't want
-        // to update a global variable in this location.
+    char record[LLQ_MSG_SIZE];
+    struct buffer_stream buf(record, LLQ_MSG_SIZE);
+    append_packet_json(buf, packet, length, &ts);
+    int r = buf.length();
+    if ((buf.trunc == 0) && (r > 0)) {
+        fwrite(record, r, 1, jf->file);
+
+        if (json_file_needs_rotation(jf)) {
+            json_file_rotate(jf);
+        }
+    }
+}
+
+/*
+ * json_queue_flush() sends every record still held by this thread's
+ * flow aggregator into the queue, each without its server half; it is
+ * called when a capture loop goes idle or shuts down, so aggregation
+ * delays records but never withholds them.  Must run on the thread
+ * that processed the packets, since the aggregator is thread local.
+ */
+void json_queue_flush(struct ll_queue *llq) {
+    if (global_vars.aggregate_flows == false || global_vars.do_analysis) {
+        return;
+    }
+    for (size_t i = 0; i < flow_aggregator::table_length; i++) {
+        struct flow_record *e = &flow_agg.table[i];
+        if (e->k.ip_vers == 0) {
+            continue;
+        }
+        struct llq_msg *msg = llq_write_slot(llq);
+        if (msg == NULL) {
+            llq->enqueue_drops++;
+            continue;
+        }
+        msg->ts = e->ts;
+        struct buffer_stream buf(llq_msg_buf(msg), LLQ_MSG_SIZE);
+        flow_agg.emit_single(e, buf);
+        int r = buf.length();
+        if ((buf.trunc == 0) && (r > 0)) {
+            msg->len = r;
+            llq_publish(llq, msg);
+        } else if (buf.trunc != 0) {
+            llq->truncated++;  /* the slot was never published, so the ring is unchanged */
+        }
+    }
+}
+
+/*
+ * json_file_flush() writes every record still held by this thread's
+ * flow aggregator into the file, each without its server half; it is
+ * called after the last packet of a capture file has been processed,
+ * on the thread that processed the packets
+ */
+void json_file_flush(struct json_file *jf) {
+    if (global_vars.aggregate_flows == false || global_vars.do_analysis) {
+        return;
     }
+    for (size_t i = 0; i < flow_aggregator::table_length; i++) {
+        struct flow_record *e = &flow_agg.table[i];
+        if (e->k.ip_vers == 0) {
+            continue;
+        }
+        char record[LLQ_MSG_SIZE];
+        struct buffer_stream buf(record, LLQ_MSG_SIZE);
+        flow_agg.emit_single(e, buf);
+        int r = buf.length();
+        if ((buf.trunc == 0) && (r > 0)) {
+            fwrite(record, r, 1, jf->file);
 
+            if (json_file_needs_rotation(jf)) {
+                json_file_rotate(jf);
+            }
+        }
+    }
 }
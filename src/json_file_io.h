@@ -11,6 +11,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <pthread.h>
 #include "mercury.h"
 
 struct json_file {
@@ -20,6 +21,13 @@ struct json_file {
     uint32_t file_num;
     char outfile_name[MAX_FILENAME];
     const char *mode;
+    FILE *next_file;                 /* The pre-opened file for the next rotation, or NULL */
+    FILE *retired_file;              /* The file handed to the rotation thread for closing */
+    int rotation_thread_used;        /* Nonzero once the rotation helper thread is running */
+    int rotation_stop;               /* Tells the rotation helper thread to exit */
+    pthread_t rotation_thread;
+    pthread_mutex_t rotation_mutex;
+    pthread_cond_t rotation_cond;
 };
 
 void json_file_write(struct json_file *jf,
@@ -28,15 +36,28 @@ void json_file_write(struct json_file *jf,
 		     unsigned int sec,
 		     unsigned int usec);
 
-void json_queue_write(struct ll_queue *llq,
+/*
+ * json_queue_write() parses the packet and, if the parse selected
+ * anything, publishes a JSON record into the queue; it returns true
+ * exactly when a record was published, so a caller can drive further
+ * per-packet decisions (see pkt_proc_json_pcap_writer_llq) from the
+ * one parse
+ */
+bool json_queue_write(struct ll_queue *llq,
                       uint8_t *packet,
                       size_t length,
                       unsigned int sec,
                       unsigned int usec);
 
+void json_queue_flush(struct ll_queue *llq);
+
+void json_file_flush(struct json_file *jf);
+
 enum status json_file_init(struct json_file *js,
 			   const char *outfile_name,
 			   const char *mode,
 			   uint64_t max_records);
 
+void json_file_finalize(struct json_file *jf);
+
 #endif /* JSON_FILE_IO_H */
@@ -9,6 +9,17 @@
 
 #include "buffer_stream.h"
 
+#ifdef USE_CBOR_OBJECT
+
+/*
+ * cbor_object.h provides the same json_object/json_array interface,
+ * but serializes records as CBOR binary instead of JSON text; see
+ * the comments there for the encoding details
+ */
+#include "cbor_object.h"
+
+#else /* USE_CBOR_OBJECT */
+
 /*
  * json_object and json_array serialize JSON objects and arrays,
  * respectively, into a buffer
@@ -47,6 +58,33 @@ struct json_object {
     void close() {
         b->write_char('}');
     }
+    /*
+     * print_skeleton() emits a precomputed constant fragment of a
+     * fixed-shape record: the keys and punctuation up to the next
+     * value slot, joined into a single string literal whose length
+     * is known at compile time, so the whole fragment is one
+     * fixed-size memcpy.  The fragment must carry its own leading
+     * comma, so it may only be used after a member has already been
+     * written to this object.
+     */
+    template <size_t N>
+    void print_skeleton(const char (&lit)[N]) {
+        comma = true;   /* a fragment always writes at least one member */
+        b->write_literal(lit);
+    }
+    /*
+     * print_raw_members() copies a pre-serialized run of members
+     * (keys and values, with their internal commas but no leading or
+     * trailing one) into this object; the fragment must be well
+     * formed, as no checking is done here
+     */
+    void print_raw_members(const char *fragment, size_t length) {
+        if (length == 0) {
+            return;
+        }
+        write_comma(comma);
+        b->memcpy(fragment, length);
+    }
     void print_key_json_string(const char *k, const uint8_t *v, size_t length) {
         if (v) {
             write_comma(comma);
@@ -103,15 +141,24 @@ struct json_object {
     }
     void print_key_uint(const char *k, unsigned long int u) {
         write_comma(comma);
-        b->snprintf("\"%s\":%lu", k, u);
+        b->write_char('\"');
+        b->puts(k);
+        b->puts("\":");
+        b->write_uint(u);
     }
     void print_key_int(const char *k, long int i) {
         write_comma(comma);
-        b->snprintf("\"%s\":%ld", k, i);
+        b->write_char('\"');
+        b->puts(k);
+        b->puts("\":");
+        b->write_int(i);
     }
     void print_key_float(const char *k, double d) {
         write_comma(comma);
-        b->snprintf("\"%s\":%f", k, d);
+        b->write_char('\"');
+        b->puts(k);
+        b->puts("\":");
+        b->write_double(d);
     }
     void print_key_hex(const char *k, const struct datum &value) {
         write_comma(comma);
@@ -211,15 +258,15 @@ struct json_array {
     }
     void print_uint(unsigned long int u) {
         write_comma(comma);
-        b->snprintf("%lu", u);
+        b->write_uint(u);
     }
     void print_int(long int i) {
         write_comma(comma);
-        b->snprintf("%ld", i);
+        b->write_int(i);
     }
     void print_float(double d) {
         write_comma(comma);
-        b->snprintf("%f", d);
+        b->write_double(d);
     }
     void print_string(const char *s) {
         write_comma(comma);
@@ -259,6 +306,8 @@ inline void json_object::reinit(struct json_array &array) {
     array.comma = true;
 }
 
+#endif /* USE_CBOR_OBJECT */
+
 #ifdef USE_JSON_FILE_OBJECT
 #include <stdio.h>
 /*
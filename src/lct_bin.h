@@ -0,0 +1,61 @@
+/*
+ * lct_bin.h
+ *
+ * compiled binary form of the lctrie subnet database
+ *
+ * The text BGP prefix dump (pyasn.db) can be compiled offline into a
+ * flat binary image (pyasn.db.bin) by the lct_db_compiler tool;
+ * addr_init() maps that file with mmap(PROT_READ, MAP_SHARED) and
+ * points the tries directly at the mapped arrays, skipping the
+ * per-startup text parse, sort, and trie build, and the large
+ * temporary subnet buffer that they require.  As with the compiled
+ * fingerprint database (see fp_db_bin.h), the read-only mapping is
+ * shared between concurrent mercury processes through the page cache.
+ *
+ * The image holds the three arrays of a finished trie — the subnet
+ * entries, the base index, and the trie nodes — for IPv4 and,
+ * when the prefix file contains IPv6 entries, for IPv6 as well.  The
+ * arrays reference each other only by index, so they are stored as
+ * raw structs at byte offsets relative to the start of the file; the
+ * pointer-valued fields of lct_subnet_info_t (a reserved-range
+ * description, user data) are written as zero and must not be
+ * dereferenced from a loaded image.  Multi-byte fields are in the
+ * byte order of the machine that ran the compiler; the file is
+ * intended to be built and consumed on the same platform, and the
+ * magic number, version, and file size are checked at load time.
+ */
+
+#ifndef LCT_BIN_H
+#define LCT_BIN_H
+
+#include <stdint.h>
+
+#define LCT_BIN_MAGIC   "MLCT"
+#define LCT_BIN_VERSION 2   /* v2: leaf nodes index the subnet array directly */
+
+struct lct_bin_hdr {
+    uint8_t  magic[4];
+    uint32_t version;
+    uint64_t file_size;       /* must equal the size of the mapped file */
+
+    /* IPv4 trie */
+    uint32_t subnet_count;    /* number of lct_subnet_t entries     */
+    uint32_t base_count;      /* number of base index entries       */
+    uint32_t node_count;      /* number of lct_node_t entries       */
+    uint32_t shortest;        /* shortest base subnet length        */
+    uint64_t subnets;         /* offset of the subnet array         */
+    uint64_t bases;           /* offset of the base index array     */
+    uint64_t nodes;           /* offset of the trie node array      */
+
+    /* IPv6 trie; all counts are zero when the prefix file had no
+     * IPv6 entries */
+    uint32_t subnet6_count;
+    uint32_t base6_count;
+    uint32_t node6_count;
+    uint32_t shortest6;
+    uint64_t subnets6;
+    uint64_t bases6;
+    uint64_t nodes6;
+};
+
+#endif /* LCT_BIN_H */
@@ -0,0 +1,247 @@
+/*
+ * lct_db_compiler.cc
+ *
+ * offline tool that compiles the text BGP prefix dump (pyasn.db)
+ * into the flat binary trie image defined in lct_bin.h, which
+ * addr_init() maps into memory at startup
+ *
+ * usage: lct_db_compiler pyasn.db pyasn.db.bin
+ *
+ * build with "make lct_db_compiler"
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "lct_bin.h"
+
+#if defined(__cplusplus)
+    extern "C" {
+#endif
+#include "lctrie/lctrie.h"
+#include "lctrie/lctrie_bgp.h"
+#if defined(__cplusplus)
+    }
+#endif
+
+/*
+ * maximum subnet counts, as in addr.cc
+ */
+#define BGP_MAX_ENTRIES             4000000
+#define BGP6_MAX_ENTRIES            1000000
+
+/*
+ * the output file is assembled in a growable byte vector; every
+ * offset recorded in the header is the position of the emitted data
+ * within that vector, which equals its offset in the file
+ */
+struct blob {
+    std::vector<uint8_t> data;
+
+    uint64_t append(const void *p, size_t len) {
+        uint64_t offset = data.size();
+        const uint8_t *c = (const uint8_t *)p;
+        data.insert(data.end(), c, c + len);
+        return offset;
+    }
+
+    /* structures within the file are kept 8-byte aligned */
+    void align() {
+        while (data.size() % 8) {
+            data.push_back(0);
+        }
+    }
+};
+
+/*
+ * the pointer-valued fields of lct_subnet_info_t are meaningless in
+ * the image (see lct_bin.h); write them as zero
+ */
+static void subnet_info_clear_pointers(lct_subnet_info_t *info) {
+    if (info->type == IP_SUBNET_RESERVED) {
+        info->rsv.desc = NULL;
+    } else if (info->type == IP_SUBNET_USER) {
+        info->usr.data = NULL;
+    }
+}
+
+/*
+ * build the IPv4 trie from the prefix file, following the same steps
+ * as lct_init_from_file() in addr.cc; returns the subnet array and
+ * sets *num_out to its length, or returns NULL on error
+ */
+static lct_subnet_t *build_trie(lct_t *lct, char *filename, int *num_out) {
+    int num = 0;
+    lct_subnet_t *p;
+    lct_subnet_t *tmp;
+    lct_ip_stats_t *stats;
+
+    if (!(p = (lct_subnet_t *)calloc(sizeof(lct_subnet_t), BGP_MAX_ENTRIES))) {
+        return NULL;
+    }
+    num += init_private_subnets(&p[num], BGP_MAX_ENTRIES);
+    num += init_special_subnets(&p[num], BGP_MAX_ENTRIES);
+
+    int rc = read_prefix_table(filename, &p[num], BGP_MAX_ENTRIES - num);
+    if (rc < 0) {
+        free(p);
+        return NULL;
+    }
+    num += rc;
+
+    subnet_mask(p, num);
+    qsort(p, num, sizeof(lct_subnet_t), subnet_cmp);
+    num -= subnet_dedup(p, num);
+    tmp = (lct_subnet_t *)realloc(p, num * sizeof(lct_subnet_t));
+    if (tmp == NULL) {
+        free(p);
+        return NULL;
+    }
+    p = tmp;
+
+    stats = (lct_ip_stats_t *)calloc(num, sizeof(lct_ip_stats_t));
+    if (stats == NULL) {
+        free(p);
+        return NULL;
+    }
+    subnet_prefix(p, stats, num);
+    free(stats);
+
+    memset(lct, 0, sizeof(lct_t));
+    if (lct_build(lct, p, num) != 0) {
+        free(p);
+        return NULL;
+    }
+    *num_out = num;
+    return p;
+}
+
+/*
+ * the IPv6 counterpart of build_trie(); returns NULL (which is not
+ * an error) when the prefix file holds no IPv6 entries
+ */
+static lct_subnet6_t *build_trie6(lct6_t *lct, char *filename, int *num_out) {
+    int num = 0;
+    lct_subnet6_t *p;
+    lct_subnet6_t *tmp;
+    lct_ip6_stats_t *stats;
+
+    if (!(p = (lct_subnet6_t *)calloc(sizeof(lct_subnet6_t), BGP6_MAX_ENTRIES))) {
+        return NULL;
+    }
+    num += init_special_subnets6(&p[num], BGP6_MAX_ENTRIES);
+
+    int rc = read_prefix_table6(filename, &p[num], BGP6_MAX_ENTRIES - num);
+    if (rc <= 0) {
+        free(p);
+        return NULL;
+    }
+    num += rc;
+
+    subnet6_mask(p, num);
+    qsort(p, num, sizeof(lct_subnet6_t), subnet6_cmp);
+    num -= subnet6_dedup(p, num);
+    tmp = (lct_subnet6_t *)realloc(p, num * sizeof(lct_subnet6_t));
+    if (tmp == NULL) {
+        free(p);
+        return NULL;
+    }
+    p = tmp;
+
+    stats = (lct_ip6_stats_t *)calloc(num, sizeof(lct_ip6_stats_t));
+    if (stats == NULL) {
+        free(p);
+        return NULL;
+    }
+    subnet6_prefix(p, stats, num);
+    free(stats);
+
+    memset(lct, 0, sizeof(lct6_t));
+    if (lct6_build(lct, p, num) != 0) {
+        free(p);
+        return NULL;
+    }
+    *num_out = num;
+    return p;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s pyasn.db pyasn.db.bin\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    lct_t trie;
+    int num = 0;
+    lct_subnet_t *subnets = build_trie(&trie, argv[1], &num);
+    if (subnets == NULL) {
+        fprintf(stderr, "error: could not build subnet trie from %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    lct6_t trie6;
+    int num6 = 0;
+    lct_subnet6_t *subnets6 = build_trie6(&trie6, argv[1], &num6);
+
+    for (int i = 0; i < num; i++) {
+        subnet_info_clear_pointers(&subnets[i].info);
+    }
+    for (int i = 0; i < num6; i++) {
+        subnet_info_clear_pointers(&subnets6[i].info);
+    }
+
+    struct blob out;
+    struct lct_bin_hdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    out.append(&hdr, sizeof(hdr));   /* placeholder, rewritten below */
+
+    out.align();
+    hdr.subnets = out.append(subnets, num * sizeof(lct_subnet_t));
+    out.align();
+    hdr.bases = out.append(trie.bases, trie.bcount * sizeof(uint32_t));
+    out.align();
+    hdr.nodes = out.append(trie.root, trie.ncount * sizeof(lct_node_t));
+    hdr.subnet_count = num;
+    hdr.base_count = trie.bcount;
+    hdr.node_count = trie.ncount;
+    hdr.shortest = trie.shortest;
+
+    if (subnets6) {
+        out.align();
+        hdr.subnets6 = out.append(subnets6, num6 * sizeof(lct_subnet6_t));
+        out.align();
+        hdr.bases6 = out.append(trie6.bases, trie6.bcount * sizeof(uint32_t));
+        out.align();
+        hdr.nodes6 = out.append(trie6.root, trie6.ncount * sizeof(lct_node_t));
+        hdr.subnet6_count = num6;
+        hdr.base6_count = trie6.bcount;
+        hdr.node6_count = trie6.ncount;
+        hdr.shortest6 = trie6.shortest;
+    }
+
+    memcpy(hdr.magic, LCT_BIN_MAGIC, sizeof(hdr.magic));
+    hdr.version = LCT_BIN_VERSION;
+    hdr.file_size = out.data.size();
+    memcpy(&out.data[0], &hdr, sizeof(hdr));
+
+    FILE *outfile = fopen(argv[2], "w");
+    if (outfile == NULL) {
+        fprintf(stderr, "error: could not open output file %s\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    if (fwrite(&out.data[0], 1, out.data.size(), outfile) != out.data.size()) {
+        fprintf(stderr, "error: could not write output file %s\n", argv[2]);
+        fclose(outfile);
+        return EXIT_FAILURE;
+    }
+    fclose(outfile);
+
+    fprintf(stderr, "compiled %d IPv4 and %d IPv6 subnets (%u + %u trie nodes) into %s (%zu bytes)\n",
+            num, num6, trie.ncount, subnets6 ? trie6.ncount : 0, argv[2], out.data.size());
+
+    return 0;
+}
@@ -218,7 +218,16 @@ int lct_build(lct_t *trie, lct_subnet_t *subnets, uint32_t size) {
       return -1;   /* error: reallocation failed */
   }
   trie->root = tmp;
-  
+
+  // resolve each leaf's bases[] indirection now, so that a lookup
+  // stays within the compact node array for the whole walk and goes
+  // straight to its subnet entry at the end, rather than loading a
+  // base index first; the bases array is only needed while building
+  for (uint32_t i = 0; i < trie->ncount; i++) {
+    if (trie->root[i].branch == 0)
+      trie->root[i].index = trie->bases[trie->root[i].index];
+  }
+
   return 0;
 }
 
@@ -256,13 +265,13 @@ lct_subnet_t *lct_find(lct_t *trie, uint32_t key) {
     idx = node->index;
   }
 
-  /* Was this a hit? */
-  bitmask = trie->nets[trie->bases[idx]].addr ^ key;
-  if (EXTRACT(0, trie->nets[trie->bases[idx]].len, bitmask) == 0)
-    return &trie->nets[trie->bases[idx]];
+  /* Was this a hit?  leaf indexes point directly at subnet entries */
+  bitmask = trie->nets[idx].addr ^ key;
+  if (EXTRACT(0, trie->nets[idx].len, bitmask) == 0)
+    return &trie->nets[idx];
 
   /* If not, look in the prefix tree */
-  prep = trie->nets[trie->bases[idx]].prefix;
+  prep = trie->nets[idx].prefix;
   while (prep != IP_PREFIX_NIL) {
     if (EXTRACT(0, trie->nets[prep].len, bitmask) == 0)
       return &trie->nets[prep];
@@ -271,3 +280,351 @@ lct_subnet_t *lct_find(lct_t *trie, uint32_t key) {
 
   return NULL;
 }
+
+// number of lookups lct_find_batch() keeps in flight; enough to hide
+// the latency of a main memory access behind the other lookups' work
+// without spilling the per-lookup traversal state out of registers
+#define LCT_BATCH_WIDTH 8
+
+void lct_find_batch(lct_t *trie, const uint32_t *keys,
+                    lct_subnet_t **results, size_t n) {
+  lct_node_t *node;
+  int pos[LCT_BATCH_WIDTH], branch[LCT_BATCH_WIDTH], idx[LCT_BATCH_WIDTH];
+  uint32_t bitmask, prep;
+
+  // idiot check
+  if (!trie) {
+    for (size_t i = 0; i < n; i++)
+      results[i] = NULL;
+    return;
+  }
+
+  for (size_t off = 0; off < n; off += LCT_BATCH_WIDTH) {
+    size_t m = ((n - off) < LCT_BATCH_WIDTH) ? (n - off) : LCT_BATCH_WIDTH;
+
+    // start every lookup at the root and prefetch its first child
+    for (size_t i = 0; i < m; i++) {
+      node = &trie->root[0];
+      pos[i] = node->skip;
+      branch[i] = node->branch;
+      idx[i] = node->index;
+      if (branch[i] != 0)
+        __builtin_prefetch(&trie->root[idx[i] + EXTRACT(pos[i], branch[i], keys[off + i])]);
+    }
+
+    // advance every unfinished lookup one node per round.  By the time
+    // a lookup comes around again, the node prefetched for it on the
+    // previous round has had the other lookups' worth of time to
+    // arrive, so the walk down each chain rarely stalls.
+    int active = 1;
+    while (active) {
+      active = 0;
+      for (size_t i = 0; i < m; i++) {
+        if (branch[i] == 0)
+          continue;
+        node = &trie->root[idx[i] + EXTRACT(pos[i], branch[i], keys[off + i])];
+        pos[i] += branch[i] + node->skip;
+        branch[i] = node->branch;
+        idx[i] = node->index;
+        if (branch[i] != 0) {
+          __builtin_prefetch(&trie->root[idx[i] + EXTRACT(pos[i], branch[i], keys[off + i])]);
+          active = 1;
+        }
+        else {
+          // this lookup is done traversing; warm up its subnet entry
+          __builtin_prefetch(&trie->nets[idx[i]]);
+        }
+      }
+    }
+
+    // resolve each lookup against its base subnet and prefix chain,
+    // exactly as lct_find() does
+    for (size_t i = 0; i < m; i++) {
+      bitmask = trie->nets[idx[i]].addr ^ keys[off + i];
+      if (EXTRACT(0, trie->nets[idx[i]].len, bitmask) == 0) {
+        results[off + i] = &trie->nets[idx[i]];
+        continue;
+      }
+
+      results[off + i] = NULL;
+      prep = trie->nets[idx[i]].prefix;
+      while (prep != IP_PREFIX_NIL) {
+        if (EXTRACT(0, trie->nets[prep].len, bitmask) == 0) {
+          results[off + i] = &trie->nets[prep];
+          break;
+        }
+        prep = trie->nets[prep].prefix;
+      }
+    }
+  }
+}
+
+// The IPv6 trie functions below mirror their IPv4 counterparts above
+// one for one; the key is a 128-bit scalar and prefix lengths run to
+// 128, but the level compression scheme is unchanged.
+
+static
+uint8_t compute_skip6(lct6_t *trie, uint32_t prefix, uint32_t first,
+                          uint32_t num, uint32_t *newprefix) {
+  lct_ip6_t low, high;
+  uint32_t i;
+
+  // there is no skip factor on the root node
+  if ((prefix == 0) && (first == 0)) {
+    return 0;
+  }
+
+  // Compute the new prefix
+  low = REMOVE6(prefix, trie->nets[trie->bases[first]].addr);
+  high = REMOVE6(prefix, trie->nets[trie->bases[first + num - 1]].addr);
+  i = prefix;
+  while (EXTRACT6(i, 1, low) == EXTRACT6(i, 1, high))
+    i++;
+  *newprefix = i;
+
+  return (*newprefix - prefix);
+}
+
+static
+uint8_t compute_branch6(lct6_t *trie, uint32_t prefix, uint32_t first,
+                            uint32_t num, uint32_t newprefix) {
+  int i, pat, bits, count, patfound;
+
+  // branch factor results in 1 << branch trie subnodes
+
+  // always use a branch factor of 1 for two element arrays
+  if (num == 2) {
+    return 1;
+  }
+
+  // a large root factor may waste entries for the same base off of the root,
+  // but performan exceptionally better for longer prefix matches.
+  if ((prefix == 0) && (first == 0)) {
+    return ROOT_BRANCH;
+  }
+
+  // Compute the number of bits that can be used for branching.
+  // We have at least two branches. Therefore we start the search
+  // at 2^b = 4 branches.
+  bits = 1;
+  do {
+    bits++;
+    if (num < ((FILLFACT * (1<<bits)) / 100) ||
+        newprefix + bits > 128)
+      break;
+    i = first;
+    pat = 0;
+    count = 0;
+    while (pat < 1<<bits) {
+      patfound = 0;
+      while (i < first + num &&
+             (lct_ip6_t)pat == EXTRACT6(newprefix, bits, trie->nets[trie->bases[i]].addr)) {
+        i++;
+        patfound = 1;
+      }
+      if (patfound)
+        count++;
+      pat++;
+    }
+  } while (count >= ((FILLFACT * (1<<bits)) / 100));
+  return bits - 1;
+}
+
+static
+void build_inner6(lct6_t *trie, uint32_t prefix, uint32_t first, uint32_t num, uint32_t pos) {
+  int k, p, idx, bits;
+  uint32_t bitpat, newprefix = 0, i;
+  uint8_t branch;
+
+  if (num == 1) {
+    trie->root[pos].branch = 0;
+    trie->root[pos].skip = 0;
+    trie->root[pos].index = first;
+  }
+  else {
+    // calculate the skip and branch for this node
+    trie->root[pos].skip = compute_skip6(trie, prefix, first, num, &newprefix);
+    branch = trie->root[pos].branch = compute_branch6(trie, prefix, first, num, newprefix);
+
+    // get a pointer to the next unused trie node which is conveniently
+    // located at trie->ncount since our caller allocated this node
+    // for us.  save off the child pointer for this node to it.
+    idx = trie->ncount;
+    trie->root[pos].index = idx;
+
+    // ok, we need to allocate our child nodes before we recurse over them
+    trie->ncount += 1 << branch;
+
+    // Build the subtrees
+    p = first;
+    for (bitpat = 0; bitpat < (1u << branch); ++bitpat) {
+      k = 0;
+      while (p + k < (int)(first + num) &&
+             EXTRACT6(newprefix, branch, trie->nets[trie->bases[p + k]].addr) == (lct_ip6_t)bitpat) {
+        ++k;
+      }
+
+      if (k == 0) {
+        // The leaf should have a pointer either to p-1 or p,
+        // whichever has the longest matching prefix
+        int match1 = 0, match2 = 0;
+
+        // Compute the longest prefix match for p - 1
+        if (p > (int)first) {
+          int prep, len;
+          prep =  trie->nets[trie->bases[p - 1]].prefix;
+          while (prep != (int)IP_PREFIX_NIL && match1 == 0) {
+            len = trie->nets[prep].len;
+            if (len > (int)newprefix &&
+                EXTRACT6(newprefix, len - newprefix, trie->nets[trie->bases[p - 1]].addr) ==
+                EXTRACT6(128 - branch, len - newprefix, bitpat))
+              match1 = len;
+            else
+              prep = trie->nets[prep].prefix;
+          }
+        }
+
+        // Compute the longest prefix match for p
+        if (p < (int)(first + num)) {
+          int prep, len;
+          prep =  trie->nets[trie->bases[p]].prefix;
+          while (prep != (int)IP_PREFIX_NIL && match2 == 0) {
+            len = trie->nets[prep].len;
+            if (len > (int)newprefix &&
+                EXTRACT6(newprefix, len - newprefix, trie->nets[trie->bases[p]].addr) ==
+                EXTRACT6(128 - branch, len - newprefix, bitpat))
+              match2 = len;
+            else
+              prep = trie->nets[prep].prefix;
+          }
+        }
+
+        if ((match1 > match2 && p > (int)first) || p == (int)(first + num))
+          build_inner6(trie, newprefix + branch, p - 1, 1, idx + bitpat);
+        else
+          build_inner6(trie, newprefix + branch, p, 1, idx + bitpat);
+      } else if (k == 1 && trie->nets[trie->bases[p]].len - newprefix < branch) {
+        bits = branch - trie->nets[trie->bases[p]].len + newprefix;
+        for (i = bitpat; i < bitpat + (1 << bits); i++)
+          build_inner6(trie, newprefix + branch, p, 1, idx + i);
+        bitpat += (1 << bits) - 1;
+      } else
+        build_inner6(trie, newprefix + branch, p, k, idx + bitpat);
+      p += k;
+    }
+  }
+}
+
+int lct6_build(lct6_t *trie, lct_subnet6_t *subnets, uint32_t size) {
+  // why are you hitting yourself, mcfly?
+  if (!trie || !subnets || !size)
+    return -1;
+
+  // user is responsible for the outer struct,
+  // and we're responsible for the interior memory
+  trie->nets = subnets;
+
+  // bases will never be more than size, but we will need to
+  // shrink it back down after it's allocated
+  trie->bases = (uint32_t *) malloc(size * sizeof(uint32_t));
+  if (!trie->bases) {
+    fprintf(stderr, "ERROR: failed to allocate trie bases index buffer\n");
+    return -1;
+  }
+
+  // allocate and count the bases
+  trie->bcount = 0;
+
+  trie->shortest = 128;  // max subnet prefix length (single address)
+  for (uint32_t i = 0; i < size; ++i) {
+    if (IP_BASE == subnets[i].type) {
+      // save off the base's index in the subnet array
+      // and increment the bases counter
+      trie->bases[trie->bcount++] = i;
+      if (subnets[i].len < trie->shortest)
+        trie->shortest = subnets[i].len;
+    }
+  }
+
+  // reallocate the base index buffer back down to the actual size.
+  trie->bases = (uint32_t *) realloc(trie->bases, trie->bcount * sizeof(uint32_t));
+
+  // give a 2MB buffer, and we'll shrink it down once we've built the trie
+  trie->root = (lct_node_t *) malloc((size + 2000000) * sizeof(lct_node_t));
+  if (!trie->root) {
+    free(trie->bases);
+    fprintf(stderr, "ERROR: failed to allocate trie node buffer\n");
+    return -1;
+  }
+
+  // hande off to the inner recursive function
+  trie->ncount = 1; // we start with the root node allocated
+  build_inner6(trie, 0, 0, trie->bcount, 0);
+
+  // shrink down the trie node array to its actual size
+  lct_node_t *tmp = (lct_node_t *) realloc(trie->root, trie->ncount * sizeof(lct_node_t));
+  if (tmp == NULL) {
+      free(trie->root);
+      return -1;   /* error: reallocation failed */
+  }
+  trie->root = tmp;
+
+  // resolve each leaf's bases[] indirection, as in lct_build()
+  for (uint32_t i = 0; i < trie->ncount; i++) {
+    if (trie->root[i].branch == 0)
+      trie->root[i].index = trie->bases[trie->root[i].index];
+  }
+
+  return 0;
+}
+
+void lct6_free(lct6_t *trie) {
+  if (!trie)
+    return;
+
+  // don't free the external subnet array.
+  // that's under outside control.
+  free(trie->bases);
+  trie->bases = NULL;
+  trie->root = NULL;
+  trie->ncount = 0;
+  trie->bcount = 0;
+}
+
+lct_subnet6_t *lct6_find(lct6_t *trie, lct_ip6_t key) {
+  lct_node_t *node;
+  int pos, branch, idx;
+  uint32_t prep;
+  lct_ip6_t bitmask;
+
+  // idiot check
+  if (!trie || !trie->root)
+    return NULL;
+
+  // Traverse the trie
+  node = &trie->root[0];
+  pos = node->skip;
+  branch = node->branch;
+  idx = node->index;
+  while (branch != 0) {
+    node = &trie->root[idx + (uint32_t)EXTRACT6(pos, branch, key)];
+    pos += branch + node->skip;
+    branch = node->branch;
+    idx = node->index;
+  }
+
+  /* Was this a hit?  leaf indexes point directly at subnet entries */
+  bitmask = trie->nets[idx].addr ^ key;
+  if (EXTRACT6(0, trie->nets[idx].len, bitmask) == 0)
+    return &trie->nets[idx];
+
+  /* If not, look in the prefix tree */
+  prep = trie->nets[idx].prefix;
+  while (prep != IP_PREFIX_NIL) {
+    if (EXTRACT6(0, trie->nets[prep].len, bitmask) == 0)
+      return &trie->nets[prep];
+    prep = trie->nets[prep].prefix;
+  }
+
+  return NULL;
+}
@@ -10,6 +10,9 @@
 /* remove the first p bits from string */
 #define REMOVE(p, str)   ((str)<<(p)>>(p))
 
+/* remove the first p bits from a 128 bit string */
+#define REMOVE6(p, str)  ((lct_ip6_t)(str)<<(p)>>(p))
+
 // Since a Trie is a radix tree, the number of
 // operations to lookup a key in a tree is dependent
 // on the depth of the tree.  The more bits allow for
@@ -43,10 +46,18 @@
 // size and prefix address.  We also have the prefix pointer to
 // walk up the tree to compare against prefixes of this base node
 // in the tree.
+//
+// The traversal therefore touches nothing but the compact node
+// array; the cold per-subnet data (ASN, prefix chain) lives in the
+// parallel nets array and is consulted only once, at the end of the
+// walk.  To keep that final step to a single dependent load, the
+// build resolves each leaf's index through the bases array up front,
+// so leaves point directly at their subnet entries.
 typedef struct lct_node {
   uint8_t branch;         // size of the child node array
   uint8_t skip;           // number of bits to skip of the key before extracting
-  uint32_t index;         // index of this node's first child if a branch
+  uint32_t index;         // index of this node's first child if a branch,
+                          // or of its subnet entry in the nets array if a leaf
 } lct_node_t;
 // Leave this structure unpacked so the compiler will memory align it
 // in a mannder that favors fast access over memory unit size.
@@ -86,5 +97,35 @@ extern void lct_free(lct_t *trie);
 // key must be provided in host byte ordering
 extern lct_subnet_t *lct_find(lct_t *trie, uint32_t key);
 
+// batched trie search
+// fills results[i] with the subnet matching keys[i], or NULL if not
+// found, exactly as n calls to lct_find() would.  The traversals are
+// interleaved and each lookup's next trie node is prefetched before
+// moving on to the other lookups, so the dependent cache misses of
+// one key's node chain overlap those of the others.
+// keys must be provided in host byte ordering
+extern void lct_find_batch(lct_t *trie, const uint32_t *keys,
+                           lct_subnet_t **results, size_t n);
+
+// IPv6 variant of the trie.  The node layout and build algorithm are
+// the same level compressed scheme as the IPv4 trie; only the key
+// width and the subnet array type differ.
+typedef struct lct6 {
+  uint32_t ncount;     // number of trie nodes, will always be <= 2 * pcount
+  uint32_t bcount;     // number of trie base subnet leaves
+  uint8_t shortest;    // shortest base subnet length (just for stats)
+
+  uint32_t *bases;     // array of indexes in the base array to indexes
+                       // into the subnet info data array.
+  lct_subnet6_t *nets; // pointer to a sorted and prefixed array of subnets
+  lct_node_t *root;    // pointer to the root of the trie node tree
+} lct6_t;
+
+extern int lct6_build(lct6_t *trie, lct_subnet6_t *subnets, uint32_t size);
+extern void lct6_free(lct6_t *trie);
+
+// key must be provided as a 128-bit scalar (see lct_ip6_key)
+extern lct_subnet6_t *lct6_find(lct6_t *trie, lct_ip6_t key);
+
 // end #ifndef guard
 #endif
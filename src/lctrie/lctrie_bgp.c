@@ -57,12 +57,87 @@ read_prefix_table(char *filename,
     // clip off the trailing newline character
     line[strcspn(line, "\n")] = 0;
 
-    // set the prefix[num] to the subnet and ASN found in line 
+    // IPv6 entries belong to the IPv6 trie; see read_prefix_table6()
+    if (strchr(line, ':')) {
+      continue;
+    }
+
+    // set the prefix[num] to the subnet and ASN found in line
     if (lct_subnet_set_from_string(&prefix[num], line) != 0) {
       fprintf(stderr, "error: could not parse subnet string '%s'\n", line);
       return -1;
     }
-    
+
+    num++;
+  }
+
+  free(line);
+  fclose(infile);
+
+  return num;
+}
+
+int
+lct_subnet6_set_from_string(lct_subnet6_t *subnet, const char *subnet_string) {
+  char addr_str[INET6_ADDRSTRLEN];
+  uint8_t bytes[16];
+  uint32_t asn;
+  uint8_t mask_length;
+
+  int num_items_parsed = sscanf(subnet_string, "%45[0-9a-fA-F:.]/%hhu\t%u",
+         addr_str, &mask_length, &asn);
+
+  if (num_items_parsed == 3) {
+
+    if ((mask_length == 0) || (mask_length > 128)) {
+      fprintf(stderr, "ERROR: %u is not a valid IPv6 prefix length\n", mask_length);
+      return -1;
+    }
+    if (inet_pton(AF_INET6, addr_str, bytes) != 1) {
+      fprintf(stderr, "ERROR: %s is not a valid IPv6 address\n", addr_str);
+      return -1;
+    }
+
+    subnet->addr = lct_ip6_key(bytes);
+    subnet->len = mask_length;
+    subnet->info.type = IP_SUBNET_BGP;
+    subnet->info.bgp.asn = asn;
+    return 0;
+  }
+  return -1;  /* error parsing subnet_string */
+}
+
+int
+read_prefix_table6(char *filename,
+                   lct_subnet6_t prefix[],
+                   size_t prefix_size) {
+  int num = 0;
+  FILE *infile;
+  char *line = NULL;
+  size_t line_len = 0;
+
+  // open the file for reading
+  if (!(infile = fopen(filename, "r"))) {
+    fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+    return -1;
+  }
+
+  // validate and parse each line of input
+  while (-1 != getline(&line, &line_len, infile)) {
+    // clip off the trailing newline character
+    line[strcspn(line, "\n")] = 0;
+
+    // IPv4 entries belong to the IPv4 trie; see read_prefix_table()
+    if (!strchr(line, ':')) {
+      continue;
+    }
+
+    // set the prefix[num] to the subnet and ASN found in line
+    if (lct_subnet6_set_from_string(&prefix[num], line) != 0) {
+      fprintf(stderr, "error: could not parse subnet string '%s'\n", line);
+      return -1;
+    }
+
     num++;
   }
 
@@ -13,6 +13,7 @@ typedef struct lct_bgp_asn {
 } lct_bgp_asn_t;
 
 // read the subnet to ASN file
+// IPv6 entries in the file are passed over
 // return number of entries read
 // return negative on failure
 extern int
@@ -20,6 +21,15 @@ read_prefix_table(char *filename,
                   lct_subnet_t prefix[],
                   size_t prefix_size);
 
+// read the IPv6 subnets from the same subnet to ASN file
+// IPv4 entries in the file are passed over
+// return number of entries read
+// return negative on failure
+extern int
+read_prefix_table6(char *filename,
+                   lct_subnet6_t prefix[],
+                   size_t prefix_size);
+
 // read the ASN to description file
 // return number of entries read
 // return negative on failure
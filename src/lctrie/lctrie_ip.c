@@ -399,3 +399,220 @@ int init_special_subnets(lct_subnet_t *subnets, size_t size) {
 
   return num;
 }
+
+// The IPv6 subnet preparation functions below mirror their IPv4
+// counterparts above, operating on 128-bit keys.
+
+// render a 128-bit key as presentation text for diagnostics
+static const char *subnet6_ntop(lct_ip6_t addr, char *pstr, size_t size) {
+  uint8_t bytes[16];
+  for (int i = 15; i >= 0; --i) {
+    bytes[i] = (uint8_t)addr;
+    addr >>= 8;
+  }
+  if (!inet_ntop(AF_INET6, bytes, pstr, size)) {
+    fprintf(stderr, "ERROR: %s\n", strerror(errno));
+    pstr[0] = 0;
+  }
+  return pstr;
+}
+
+int subnet6_cmp(const void *di, const void *dj) {
+  const lct_subnet6_t *i = (const lct_subnet6_t *) di;
+  const lct_subnet6_t *j = (const lct_subnet6_t *) dj;
+
+  if (i->addr < j->addr)
+    return -1;
+  else if (i->addr > j->addr)
+    return 1;
+  else if (i->len < j->len)
+    return -1;
+  else if (i->len > j->len)
+    return 1;
+  else
+    return 0;
+}
+
+int subnet6_isprefix(lct_subnet6_t *s, lct_subnet6_t *t) {
+  return s && t &&
+         (s->len == 0 || // EXTRACT6() can't handle 0 bits
+          (s->len <= t->len &&
+           EXTRACT6(0, s->len, s->addr) ==
+           EXTRACT6(0, s->len, t->addr)));
+}
+
+void subnet6_mask(lct_subnet6_t *subnets, size_t size) {
+  char pstr[INET6_ADDRSTRLEN], pstr2[INET6_ADDRSTRLEN];
+
+  for (size_t i = 0; i < size; ++i) {
+    lct_subnet6_t *p = &subnets[i];
+
+    lct_ip6_t netmask = ~(lct_ip6_t)0;
+    if (p->len < 128)
+      netmask <<= (128 - p->len);
+
+    lct_ip6_t newaddr = p->addr & netmask;
+    if (newaddr != p->addr) {
+      fprintf(stderr, "Subnet %s/%d has not been properly masked, should be %s/%d\n",
+              subnet6_ntop(p->addr, pstr, sizeof(pstr)), p->len,
+              subnet6_ntop(newaddr, pstr2, sizeof(pstr2)), p->len);
+
+      p->addr = newaddr;
+    }
+  }
+}
+
+size_t subnet6_dedup(lct_subnet6_t *subnets, size_t size) {
+  // remove duplicates
+  char pstr[INET6_ADDRSTRLEN];
+  size_t ndup = 0;
+
+  for (size_t i = 0, j = 1; j < size; ++i, ++j) {
+    // we have a duplicate!
+    if (!subnet6_cmp(&subnets[i], &subnets[j])) {
+      printf("Subnet %s/%d type %d duplicates another of type %d\n",
+             subnet6_ntop(subnets[i].addr, pstr, sizeof(pstr)),
+             subnets[i].len, subnets[i].info.type, subnets[j].info.type);
+
+      // assume that the prior defined subnet is the desired one,
+      // dis-allowing redefinition of that subnet elsewhere
+      //
+      // slide the rest of the array over the second value.  if we're at the
+      // end of the array, just let it drop off.
+      if ((j + 1) < size)
+        memmove(&subnets[j], &subnets[j + 1], (size - (j + 1)) * sizeof(lct_subnet6_t));
+      --size;
+      ++ndup;
+    }
+  }
+
+  if (ndup)
+    printf("%zu duplicates removed\n\n", ndup);
+
+  return ndup;
+}
+
+size_t subnet6_prefix(lct_subnet6_t *p, lct_ip6_stats_t *stats, size_t size) {
+  size_t npre = 0;
+  uint32_t prefix;
+
+  // the passes here are the same as in subnet_prefix(); see the
+  // commentary there
+
+  // first, mark every node's prefix as invalid.
+  for (size_t i = 0; i < size; ++i) {
+    p[i].prefix = IP_PREFIX_NIL;
+  }
+
+  // go through and determine which subnets are prefixes of other subnets
+  for (size_t i = 0; i < size; ++i) {
+    size_t j = i + 1;  // fake out a psuedo second iterator
+    if ((j < size) && subnet6_isprefix(&p[i], &p[j])) {
+      // mark the prefix of the second node
+      p[j].prefix = i;
+      p[j].fullprefix = i;
+
+      for (size_t k = j + 1; k < size && subnet6_isprefix(&p[i], &p[k]); ++k) {
+        // mark the prefix of the following node
+        // if there's another more specific prefix, it will be overwritten
+        // on additional passes further into the array
+        p[k].prefix = i;
+        p[k].fullprefix = i;
+      }
+
+      p[i].type = IP_PREFIX;
+      ++npre;
+    }
+    else {
+      p[i].type = IP_BASE;
+    }
+    stats[i].size = (lct_ip6_t)1 << (128 - p[i].len);
+    stats[i].used = 0;
+  }
+
+  // walk through the sorted array forwards to add the bases to their prefixes
+  for (size_t i = 0; i < size; ++i) {
+    if (IP_PREFIX_NIL != p[i].prefix) {
+      // add the base's size to it's prefix's count
+      stats[p[i].prefix].used += stats[i].size;
+    }
+  }
+
+  // go through the array yet again to find full prefixes
+  for (size_t i = 0; i < size; ++i ) {
+    // if the prefix is fully used, mark it full
+    if (stats[i].used == stats[i].size)
+      p[i].type = IP_PREFIX_FULL;
+  }
+
+  // go through the array yet again to find full prefixes
+  // and update the prefix pointer to the next non-full prefix or
+  // IP_PREFIX_NIL.
+  for (size_t i = 0; i < size; ++i ) {
+    prefix = p[i].prefix;
+    if (prefix != IP_PREFIX_NIL && p[prefix].type == IP_PREFIX_FULL)
+      p[i].prefix = p[prefix].prefix;
+  }
+
+  return npre;
+}
+
+int init_special_subnets6(lct_subnet6_t *subnets, size_t size) {
+  if (size < 5) {
+    fprintf(stderr, "Need a prefix buffer of size 5 for special IPv6 ranges\n");
+    return -1;
+  }
+
+  // ::/128        Unspecified Address        RFC 4291
+  // ::1/128       Loopback                   RFC 4291
+  // fc00::/7      Unique Local               RFC 4193
+  // fe80::/10     Link Local                 RFC 4291
+  // ff00::/8      Multicast                  RFC 4291
+
+  uint8_t bytes[16];
+  int num = 0;
+
+  // RFC 4291 Unspecified Address
+  //
+  subnets[num].info.type = IP_SUBNET_RESERVED;
+  subnets[num].info.rsv.desc = "RFC 4291 Unspecified Address";
+  inet_pton(AF_INET6, "::", bytes);
+  subnets[num].addr = lct_ip6_key(bytes);
+  subnets[num].len = 128;
+  ++num;
+
+  // RFC 4291 Loopback
+  //
+  subnets[num].info.type = IP_SUBNET_LOOPBACK;
+  inet_pton(AF_INET6, "::1", bytes);
+  subnets[num].addr = lct_ip6_key(bytes);
+  subnets[num].len = 128;
+  ++num;
+
+  // RFC 4193 Unique Local Addresses
+  //
+  subnets[num].info.type = IP_SUBNET_PRIVATE;
+  subnets[num].info.priv.net_class = 'u';
+  inet_pton(AF_INET6, "fc00::", bytes);
+  subnets[num].addr = lct_ip6_key(bytes);
+  subnets[num].len = 7;
+  ++num;
+
+  // RFC 4291 Link Local Addresses
+  //
+  subnets[num].info.type = IP_SUBNET_LINKLOCAL;
+  inet_pton(AF_INET6, "fe80::", bytes);
+  subnets[num].addr = lct_ip6_key(bytes);
+  subnets[num].len = 10;
+  ++num;
+
+  // RFC 4291 Multicast Addresses
+  //
+  subnets[num].info.type = IP_SUBNET_MULTICAST;
+  inet_pton(AF_INET6, "ff00::", bytes);
+  subnets[num].addr = lct_ip6_key(bytes);
+  subnets[num].len = 8;
+  ++num;
+
+  return num;
+}
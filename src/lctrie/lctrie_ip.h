@@ -97,10 +97,47 @@ typedef struct lct_ip_stats {
   uint32_t used;  // size of the subprefixed address space
 } lct_ip_stats_t;
 
+// IPv6 keys are manipulated as 128-bit scalars in host bit order so
+// that the same shift-based bit extraction used for IPv4 applies;
+// __extension__ keeps -Wpedantic quiet about the gcc 128-bit type
+__extension__ typedef unsigned __int128 lct_ip6_t;
+
+// Extract num bits from a 128 bit string starting at pos bit
+#define EXTRACT6(pos, num, str) ((lct_ip6_t)(str)<<(pos)>>(128-(num)))
+
+// convert a 16-byte network byte order IPv6 address into a 128-bit key
+static inline lct_ip6_t lct_ip6_key(const uint8_t *bytes) {
+  lct_ip6_t key = 0;
+  for (int i = 0; i < 16; i++)
+    key = (key << 8) | bytes[i];
+  return key;
+}
+
+// the IPv6 counterpart of lct_subnet; the info union is shared
+typedef struct lct_subnet6 {
+  lct_ip6_t addr;       // subnet address
+  uint8_t type;         // prefix type
+  uint8_t len;          // CIDR address prefix length
+
+  uint32_t prefix;      // index to our next highest prefix
+  uint32_t fullprefix;
+
+  lct_subnet_info_t info;
+} lct_subnet6_t;
+
+typedef struct lct_ip6_stats {
+  lct_ip6_t size;  // size of the subnet
+  lct_ip6_t used;  // size of the subprefixed address space
+} lct_ip6_stats_t;
+
 // fill in user array with reserved IP subnets according to RFC 1918
 // private use IP networks and RFC 3927 link local networks
 extern int init_private_subnets(lct_subnet_t *subnets, size_t size);
 
+// fill in user array with the RFC 4291 unspecified, loopback, link
+// local, and multicast ranges and the RFC 4193 unique local range
+extern int init_special_subnets6(lct_subnet6_t *subnets, size_t size);
+
 // fill in user array with reserved IP subnets according to RFC 5735
 // minus the private IP subets from RFC 1918
 extern int init_special_subnets(lct_subnet_t *subnets, size_t size);
@@ -126,5 +163,12 @@ extern size_t subnet_prefix(lct_subnet_t *subnets, lct_ip_stats_t *stats, size_t
 // to subnet_cmp
 extern int subnet_isprefix(lct_subnet_t *s, lct_subnet_t *t);
 
+// IPv6 counterparts of the subnet array preparation functions above
+extern int subnet6_cmp(const void *di, const void *dj);
+extern void subnet6_mask(lct_subnet6_t *subnets, size_t size);
+extern size_t subnet6_dedup(lct_subnet6_t *subnets, size_t size);
+extern size_t subnet6_prefix(lct_subnet6_t *subnets, lct_ip6_stats_t *stats, size_t size);
+extern int subnet6_isprefix(lct_subnet6_t *s, lct_subnet6_t *t);
+
 // end #ifndef guard
 #endif
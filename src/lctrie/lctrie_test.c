@@ -8,6 +8,13 @@
 
 #include <arpa/inet.h>
 #include <sys/time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
 
 #include "lctrie_ip.h"
 #include "lctrie_bgp.h"
@@ -23,6 +30,11 @@
 #define LCT_VERIFY_PREFIXES         1
 #define LCT_IP_DISPLAY_PREFIXES     0
 
+// benchmark trace replay parameters
+#define LCT_BENCH_TRACE_LEN         (1 << 22)
+#define LCT_BENCH_LOOKUPS           50000000
+#define LCT_BENCH_BATCH             1024
+
 static unsigned long next = 1;
 
 int fastrand(void) {
@@ -30,6 +42,237 @@ int fastrand(void) {
   return((unsigned)(next/65536) % RAND_MAX);
 }
 
+// fastrand() yields at most 31 bits; stitch two calls together so that
+// uniform traces cover the entire address space
+static uint32_t fastrand32(void) {
+  return ((uint32_t)fastrand() << 16) ^ (uint32_t)fastrand();
+}
+
+// hardware cache counters wrapped around a replay loop, read with
+// perf_event_open(2).  the counters may be unavailable (a non-Linux
+// host, a restrictive perf_event_paranoid setting, or a container that
+// filters the syscall); in that case the replay still reports
+// lookups/sec and marks the miss rate unavailable.
+typedef struct {
+  int ref_fd;
+  int miss_fd;
+} bench_counters_t;
+
+#ifdef __linux__
+static int perf_counter_open(uint64_t config) {
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void bench_counters_open(bench_counters_t *c) {
+  c->ref_fd = perf_counter_open(PERF_COUNT_HW_CACHE_REFERENCES);
+  c->miss_fd = perf_counter_open(PERF_COUNT_HW_CACHE_MISSES);
+}
+
+static void bench_counters_start(bench_counters_t *c) {
+  if (c->ref_fd >= 0) {
+    ioctl(c->ref_fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(c->ref_fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+  if (c->miss_fd >= 0) {
+    ioctl(c->miss_fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(c->miss_fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+static void bench_counters_stop(bench_counters_t *c) {
+  if (c->ref_fd >= 0)
+    ioctl(c->ref_fd, PERF_EVENT_IOC_DISABLE, 0);
+  if (c->miss_fd >= 0)
+    ioctl(c->miss_fd, PERF_EVENT_IOC_DISABLE, 0);
+}
+
+static long long bench_counter_read(int fd) {
+  long long value;
+
+  if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value))
+    return -1;
+  return value;
+}
+
+static void bench_counters_close(bench_counters_t *c) {
+  if (c->ref_fd >= 0)
+    close(c->ref_fd);
+  if (c->miss_fd >= 0)
+    close(c->miss_fd);
+}
+#else
+static void bench_counters_open(bench_counters_t *c) { c->ref_fd = -1; c->miss_fd = -1; }
+static void bench_counters_start(bench_counters_t *c) { (void)c; }
+static void bench_counters_stop(bench_counters_t *c) { (void)c; }
+static long long bench_counter_read(int fd) { (void)fd; return -1; }
+static void bench_counters_close(bench_counters_t *c) { (void)c; }
+#endif
+
+// replays a prepared address trace against the trie and reports the
+// lookup rate and, when the hardware counters can be read, the cache
+// miss rate of the replay.  batched selects lct_find_batch() over a
+// scalar lct_find() loop, so the two paths can be compared on an
+// identical key stream.
+static void bench_replay(lct_t *t, const char *label, int batched,
+                         const uint32_t *trace, size_t trace_len) {
+  lct_subnet_t *results[LCT_BENCH_BATCH];
+  unsigned long nlookup = 0, nhit = 0;
+  struct timeval start, now;
+  bench_counters_t c;
+  size_t off = 0;
+
+  bench_counters_open(&c);
+  bench_counters_start(&c);
+  gettimeofday(&start, NULL);
+  while (nlookup < LCT_BENCH_LOOKUPS) {
+    if (batched) {
+      size_t chunk = trace_len - off;
+      if (chunk > LCT_BENCH_BATCH)
+        chunk = LCT_BENCH_BATCH;
+      lct_find_batch(t, &trace[off], results, chunk);
+      for (size_t j = 0; j < chunk; j++) {
+        if (results[j])
+          ++nhit;
+      }
+      nlookup += chunk;
+      off += chunk;
+    }
+    else {
+      if (lct_find(t, trace[off]))
+        ++nhit;
+      ++nlookup;
+      ++off;
+    }
+    if (off == trace_len)
+      off = 0;
+  }
+  gettimeofday(&now, NULL);
+  bench_counters_stop(&c);
+
+  unsigned long took_ms = 1000 * (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) / 1000;
+  if (!took_ms)
+    took_ms = 1;  // timer has millisecond accuracy
+
+  long long refs = bench_counter_read(c.ref_fd);
+  long long misses = bench_counter_read(c.miss_fd);
+  bench_counters_close(&c);
+
+  printf("%s/%s: %'lu lookups (%'lu hits, %'lu misses) in %'lums, %'lu lookups/sec",
+         label, batched ? "batch" : "scalar",
+         nlookup, nhit, nlookup - nhit, took_ms, nlookup / took_ms * 1000);
+  if (refs > 0 && misses >= 0)
+    printf(", %'lld cache misses of %'lld references (%1.2f%%)\n",
+           misses, refs, (100.0 * misses) / refs);
+  else
+    printf(", cache counters unavailable\n");
+}
+
+static void trace_fill_uniform(uint32_t *trace, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    trace[i] = fastrand32();
+}
+
+// a Zipf(s = 1) rank distribution over the subnet list: a few subnets
+// receive most of the lookups, the way addresses on a real link do.
+// ranks are scattered across the list with a multiplicative hash so
+// that popularity is not correlated with the trie's layout order.
+static void trace_fill_zipf(uint32_t *trace, size_t n, lct_subnet_t *p, size_t num) {
+  double *cdf = (double *) malloc(num * sizeof(double));
+
+  if (!cdf) {
+    fprintf(stderr, "Failed to allocate zipf distribution buffer\n");
+    exit(EXIT_FAILURE);
+  }
+  double sum = 0.0;
+  for (size_t i = 0; i < num; i++) {
+    sum += 1.0 / (i + 1);
+    cdf[i] = sum;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double u = sum * ((double)fastrand() / RAND_MAX);
+    size_t lo = 0, hi = num - 1;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (cdf[mid] < u)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    lct_subnet_t *s = &p[(lo * 2654435761UL) % num];
+    uint32_t host = (s->len < 32) ? (fastrand32() & (0xffffffffu >> s->len)) : 0;
+    trace[i] = s->addr | host;
+  }
+  free(cdf);
+}
+
+// pulls the IPv4 source and destination addresses out of a pcap file,
+// in capture order, and tiles them across the trace buffer.  handles
+// both byte orders of the classic pcap format and untagged or 802.1Q
+// tagged ethernet frames, which covers the captures under test/data.
+// returns the number of addresses read, or 0 if the file could not be
+// used.
+static size_t trace_fill_pcap(uint32_t *trace, size_t n, const char *path) {
+  static uint8_t pkt[65535];
+  FILE *f = fopen(path, "r");
+
+  if (!f) {
+    fprintf(stderr, "could not open pcap file \"%s\": %s\n", path, strerror(errno));
+    return 0;
+  }
+  uint32_t ghdr[6];
+  int swap;
+  if (fread(ghdr, sizeof(uint32_t), 6, f) != 6
+      || (ghdr[0] != 0xa1b2c3d4 && ghdr[0] != 0xd4c3b2a1)) {
+    fprintf(stderr, "\"%s\" is not a pcap file\n", path);
+    fclose(f);
+    return 0;
+  }
+  swap = (ghdr[0] == 0xd4c3b2a1);
+
+  size_t count = 0;
+  while (count < n) {
+    uint32_t rhdr[4];
+    if (fread(rhdr, sizeof(uint32_t), 4, f) != 4)
+      break;
+    uint32_t caplen = swap ? __builtin_bswap32(rhdr[2]) : rhdr[2];
+    if (caplen > sizeof(pkt) || fread(pkt, 1, caplen, f) != caplen)
+      break;
+    size_t ip_off = 14;
+    if (caplen < ip_off + 20)
+      continue;
+    uint16_t etype = (pkt[12] << 8) | pkt[13];
+    if (etype == 0x8100) {
+      etype = (pkt[16] << 8) | pkt[17];
+      ip_off = 18;
+    }
+    if (etype != 0x0800 || caplen < ip_off + 20)
+      continue;
+    uint32_t src, dst;
+    memcpy(&src, &pkt[ip_off + 12], sizeof(src));
+    memcpy(&dst, &pkt[ip_off + 16], sizeof(dst));
+    trace[count++] = ntohl(src);
+    if (count < n)
+      trace[count++] = ntohl(dst);
+  }
+  fclose(f);
+  if (count == 0) {
+    fprintf(stderr, "no IPv4 addresses found in \"%s\"\n", path);
+    return 0;
+  }
+  for (size_t i = count; i < n; i++)
+    trace[i] = trace[i - count];
+  return count;
+}
+
 void print_subnet(lct_subnet_t *subnet) {
   char pstr[INET_ADDRSTRLEN];
   uint32_t prefix;
@@ -149,12 +392,12 @@ void print_subnet_stats(lct_subnet_t *subnet, lct_ip_stats_t *stats) {
 int main(int argc, char *argv[]) {
   int num = 0;
   int nprefixes = 0, nbases = 0, nfull = 0;
-  uint32_t prefix, localprefix;
+  uint32_t prefix;
   lct_subnet_t *p, *subnet = NULL;
   lct_t t;
 
-  if (argc != 2) {
-    fprintf(stderr, "usage: %s <BGP Prefixes File>\n", basename(argv[0]));
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "usage: %s <BGP Prefixes File> [pcap trace file]\n", basename(argv[0]));
     exit(EXIT_FAILURE);
   }
 
@@ -340,48 +583,53 @@ int main(int argc, char *argv[]) {
   }
   printf("Finished printed trie subnet matches.\n\n");
 
-  printf("Performance testing, might take a while...\n");
-
-  // init zero stats and seed the RNG
-  unsigned int nlookup = 0, nhit = 0, nmiss = 0;
-  srand(time(NULL));  // not crypto secure, but we don't need that
+  printf("Performance testing, might take a while...\n\n");
 
-  // setup the start of our local range for the test
-  inet_pton(AF_INET, "192.168.0.0", (void *) &localprefix);
-  localprefix = ntohl(localprefix);
-
-  // start the stop clock
-  struct timeval start, now;
-  gettimeofday(&start, NULL);
-  for (int i = 0; i < 50000000; i++) {
-
-    // just grab a random number and check to match
-    prefix = fastrand();
-
-    // record the lookup, hit, and miss stats
-    ++nlookup;
-    subnet = lct_find(&t, prefix);
-    if (subnet) {
-      ++nhit;
-    }
-    else {
-      ++nmiss;
+  // the traces are generated from a fixed seed, so two builds of the
+  // trie code replay byte-identical key streams and their rates and
+  // miss percentages can be compared run against run
+  uint32_t *trace = (uint32_t *) malloc(LCT_BENCH_TRACE_LEN * sizeof(uint32_t));
+  if (!trace) {
+    fprintf(stderr, "Failed to allocate trace buffer\n");
+    exit(EXIT_FAILURE);
+  }
+  next = 1;
+  trace_fill_uniform(trace, LCT_BENCH_TRACE_LEN);
+
+  // verify that lct_find_batch() agrees with lct_find() on the same
+  // key stream before timing either of them
+  lct_subnet_t *batch_results[LCT_BENCH_BATCH];
+  unsigned int nmismatch = 0;
+  for (size_t off = 0; off < LCT_BENCH_TRACE_LEN; off += LCT_BENCH_BATCH) {
+    lct_find_batch(&t, &trace[off], batch_results, LCT_BENCH_BATCH);
+    for (int j = 0; j < LCT_BENCH_BATCH; j++) {
+      if (batch_results[j] != lct_find(&t, trace[off + j]))
+        ++nmismatch;
     }
+  }
+  printf("%'u batched lookups compared against lct_find() with %u mismatches.\n\n",
+         LCT_BENCH_TRACE_LEN, nmismatch);
 
-    // get the current time
-  } 
-  gettimeofday(&now, NULL);
-  unsigned long took_ms = 1000 * (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) / 1000;
-  // timer has millisecond accuracy
+  // replay each trace through the scalar and the batched lookup paths
+  bench_replay(&t, "uniform", 0, trace, LCT_BENCH_TRACE_LEN);
+  bench_replay(&t, "uniform", 1, trace, LCT_BENCH_TRACE_LEN);
+
+  trace_fill_zipf(trace, LCT_BENCH_TRACE_LEN, p, num);
+  bench_replay(&t, "zipf", 0, trace, LCT_BENCH_TRACE_LEN);
+  bench_replay(&t, "zipf", 1, trace, LCT_BENCH_TRACE_LEN);
 
-  printf("Complete.\n");
-printf("%'u lookups with %'u hits and %'u misses in %ldms.\n", nlookup, nhit, nmiss,
-       took_ms);
-  printf("%'lu lookups/sec.\n\n", nlookup / took_ms * 1000);
+  if (argc == 3 && trace_fill_pcap(trace, LCT_BENCH_TRACE_LEN, argv[2])) {
+    bench_replay(&t, "pcap", 0, trace, LCT_BENCH_TRACE_LEN);
+    bench_replay(&t, "pcap", 1, trace, LCT_BENCH_TRACE_LEN);
+  }
+  printf("\n");
+  free(trace);
 
-  printf("Pausing to allow for system analysis.\n");
-  printf("Hit enter key to continue...\n");
-  getc(stdin);
+  if (isatty(fileno(stdin))) {
+    printf("Pausing to allow for system analysis.\n");
+    printf("Hit enter key to continue...\n");
+    getc(stdin);
+  }
 
   // we're done with the subnets, stats, and trie;  dump them.
   lct_free(&t);
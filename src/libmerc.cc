@@ -0,0 +1,142 @@
+/*
+ * libmerc.cc
+ *
+ * batch packet-processing interface to the mercury packet metadata
+ * capture and analysis library; see libmerc.h for the interface
+ * documentation
+ *
+ * Copyright (c) 2019 Cisco Systems, Inc. All rights reserved.  License at
+ * https://github.com/cisco/mercury/blob/master/LICENSE
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mercury.h"
+#include "extractor.h"
+#include "buffer_stream.h"
+#include "tls.h"
+#include "libmerc.h"
+
+/*
+ * extract_fp_from_tls_client_hello() parses the TCP data in place --
+ * nothing is copied except the fingerprint characters written into
+ * the caller's output buffer -- so a caller holding a mapped capture
+ * buffer (or a Python memoryview; see src/cython) pays no per-packet
+ * allocation for fingerprinting
+ */
+size_t extract_fp_from_tls_client_hello(uint8_t *data,
+                                        size_t data_len,
+                                        uint8_t *outbuf,
+                                        size_t outbuf_len) {
+    struct datum pkt{data, data + data_len};
+    struct tls_record rec;
+    rec.parse(pkt);
+    struct tls_handshake handshake;
+    handshake.parse(rec.fragment);
+    struct tls_client_hello hello;
+    hello.parse(handshake.body);
+    if (!hello.is_not_empty()) {
+        return 0;
+    }
+    struct buffer_stream buf{(char *)outbuf, (int)outbuf_len};
+    hello.write_fingerprint(buf);
+    if (buf.trunc) {
+        return 0;   /* output buffer too small for this fingerprint */
+    }
+    return buf.length();
+}
+
+/*
+ * struct libmerc_batch_state holds the per-caller state of the batch
+ * interface: a packet filter, whose extractor parses each packet, and
+ * an arena into which the bytes selected from every packet of a batch
+ * are emitted as they are extracted, so that the records handed back
+ * to the caller remain valid while further packets are parsed
+ */
+struct libmerc_batch_state {
+    struct packet_filter pf;
+    uint8_t *arena;
+    size_t arena_bytes;
+};
+
+struct libmerc_batch_state *libmerc_batch_init(size_t arena_bytes) {
+
+    struct libmerc_batch_state *state = (struct libmerc_batch_state *)malloc(sizeof(struct libmerc_batch_state));
+    if (state == NULL) {
+        return NULL;
+    }
+    if (arena_bytes == 0) {
+        arena_bytes = LIBMERC_BATCH_DEFAULT_ARENA;
+    }
+    /* extractions are emitted straight into the arena (see
+     * libmerc_process_batch()), so it must hold at least one
+     * maximum-size extraction */
+    if (arena_bytes < sizeof(packet_filter::extractor_buffer)) {
+        arena_bytes = sizeof(packet_filter::extractor_buffer);
+    }
+    state->arena = (uint8_t *)malloc(arena_bytes);
+    if (state->arena == NULL) {
+        free(state);
+        return NULL;
+    }
+    state->arena_bytes = arena_bytes;
+    if (packet_filter_init(&state->pf, NULL) != status_ok) {
+        free(state->arena);
+        free(state);
+        return NULL;
+    }
+    return state;
+}
+
+size_t libmerc_process_batch(struct libmerc_batch_state *state,
+                             const struct libmerc_packet *packets,
+                             size_t num_packets,
+                             struct libmerc_record *records) {
+
+    size_t arena_used = 0;
+    struct key k;
+
+    for (size_t i = 0; i < num_packets; i++) {
+
+        /* start the next packet's cache refill while this one parses */
+        if (i + 1 < num_packets) {
+            __builtin_prefetch(packets[i + 1].data);
+        }
+
+        /*
+         * the extraction is emitted straight into the arena, so the
+         * normalized bytes are written once instead of being staged
+         * in the filter's scratch buffer and copied out.  Extraction
+         * output is bounded by the scratch buffer size, so requiring
+         * that much free arena before parsing rules out truncation.
+         */
+        if (state->arena_bytes - arena_used < sizeof(state->pf.extractor_buffer)) {
+            return i;    /* arena full; the caller resubmits packets[i] onward */
+        }
+        size_t bytes = packet_filter_extract_to(&state->pf, &k,
+                                                (uint8_t *)packets[i].data,
+                                                packets[i].length,
+                                                state->arena + arena_used,
+                                                sizeof(state->pf.extractor_buffer));
+        records[i].msg_type = state->pf.x.msg_type;
+        if (bytes == 0) {
+            records[i].data = NULL;
+            records[i].length = 0;
+            continue;
+        }
+        records[i].data = state->arena + arena_used;
+        records[i].length = bytes;
+        arena_used += bytes;
+    }
+    return num_packets;
+}
+
+void libmerc_batch_free(struct libmerc_batch_state *state) {
+    if (state == NULL) {
+        return;
+    }
+    free(state->arena);
+    free(state);
+}
@@ -7,6 +7,9 @@
 #ifndef LIBMERC_H
 #define LIBMERC_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include "mercury.h"   /* for enum status */
 
 /**
  * @brief extracts a TLS client fingerprint from a packet
@@ -34,4 +37,88 @@ enum status proto_ident_config(const char *config_string);
 enum status static_data_config(const char *config_string);
 
 
+/**
+ * @brief a packet submitted to the batch interface
+ *
+ * Each descriptor references an ethernet frame owned by the caller;
+ * the library reads the frame but never writes it or retains a
+ * pointer to it beyond the libmerc_process_batch() call.
+ */
+struct libmerc_packet {
+    const uint8_t *data;    /**< start of the ethernet frame          */
+    size_t length;          /**< number of bytes at @em data          */
+};
+
+/**
+ * @brief a record produced by the batch interface
+ *
+ * After libmerc_process_batch() returns, each record references the
+ * bytes that the extractor selected from the corresponding packet.
+ * The referenced bytes live in an arena owned by the batch state, and
+ * remain valid until the next libmerc_process_batch() call on that
+ * state.  A packet from which nothing was selected has a record with
+ * @em data NULL and @em length zero; its @em msg_type is still set.
+ */
+struct libmerc_record {
+    const uint8_t *data;    /**< selected bytes, in the batch arena   */
+    size_t length;          /**< number of selected bytes, or zero    */
+    unsigned int msg_type;  /**< enum msg_type assigned to the packet */
+};
+
+/**
+ * @brief default arena size for libmerc_batch_init()
+ */
+#define LIBMERC_BATCH_DEFAULT_ARENA (1 << 20)
+
+/**
+ * @brief allocates and initializes a batch processing state
+ *
+ * The state holds a packet filter and an arena of @em arena_bytes
+ * bytes (or LIBMERC_BATCH_DEFAULT_ARENA, if @em arena_bytes is zero)
+ * into which the records of each batch are copied.  A state must be
+ * used by one thread at a time; callers that process packets on
+ * several threads should create one state per thread.
+ *
+ * @param [in] arena_bytes the size of the record arena, or zero
+ *
+ * @return a pointer to the new state, or NULL on failure
+ */
+struct libmerc_batch_state *libmerc_batch_init(size_t arena_bytes);
+
+/**
+ * @brief processes a batch of packets
+ *
+ * Runs each of the @em num_packets packets described by @em packets
+ * through the extractor, and writes one record for each processed
+ * packet into the corresponding element of @em records, which must
+ * have room for @em num_packets elements.  Processing a batch in one
+ * call amortizes the call boundary over the batch, and lets the
+ * library prefetch each packet's data while the previous packet is
+ * being parsed.
+ *
+ * @param [in] state the batch state from libmerc_batch_init()
+ * @param [in] packets the packet descriptors
+ * @param [in] num_packets the number of packet descriptors
+ * @param [out] records the output records, one per processed packet
+ *
+ * @return the number of packets processed; this is less than @em
+ * num_packets only when the arena fills, in which case the caller
+ * should resubmit the remaining packets in a following call
+ */
+size_t libmerc_process_batch(struct libmerc_batch_state *state,
+                             const struct libmerc_packet *packets,
+                             size_t num_packets,
+                             struct libmerc_record *records);
+
+/**
+ * @brief frees a batch processing state
+ *
+ * Frees the state and its arena; any records returned by the last
+ * libmerc_process_batch() call are invalidated.
+ *
+ * @param [in] state the batch state, or NULL (a no-op)
+ */
+void libmerc_batch_free(struct libmerc_batch_state *state);
+
+
 #endif /* LIBMERC_H */
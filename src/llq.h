@@ -1,44 +1,270 @@
 /*
  * llq - lockless queue for inter-thread communication
+ *
+ * Each queue is a single-producer, single-consumer byte ring holding
+ * variable-length, length-prefixed records.  A JSON record is
+ * typically a few hundred bytes, so packing records back-to-back
+ * (rounded up to a cache line) holds more than an order of magnitude
+ * more messages than the old fixed 16KB buckets did in the same
+ * memory, which directly reduces queue-full drops during bursts.
+ *
+ * The producer publishes a record by advancing widx; the consumer
+ * retires one by advancing ridx.  Each index has a single writer, so
+ * no locks are needed; the indexes are C++11 atomics, and every store
+ * that publishes or retires a record is a release paired with an
+ * acquire load on the other side.  That constrains exactly the
+ * ordering the handshake needs and nothing more -- the volatile
+ * indexes and full barriers used before both relied on incidental x86
+ * ordering and forced the compiler to reload the indexes at every
+ * use.
  */
 
 #ifndef LLQ_H
 #define LLQ_H
 
-#define LLQ_MSG_SIZE 16384   /* The number of bytes allowed for each message in the lockless queue */
-#define LLQ_DEPTH    2048    /* The number of "buckets" (queue messages) allowed */
-#define LLQ_MAX_AGE  5       /* Maximum age (in seconds) messages are allowed to sit in a queue */
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include "probe.h"
 
-/* The message object suitable for the std::priority_queue */
+#define LLQ_MSG_SIZE (16384)           /* The maximum number of bytes in one message */
+#define LLQ_BUF_SIZE (4 * 1024 * 1024) /* The number of record bytes in each queue's ring */
+#define LLQ_ALIGN    64                /* Records are cache-line aligned */
+
+/* The record header; the message bytes follow it directly in the ring */
 struct llq_msg {
-    volatile int used; /* The flag that says if this object is actually in use (if not, it's available) */
-    char buf[LLQ_MSG_SIZE];
-    ssize_t len;
+    ssize_t len;        /* The message length, or -1 for a wrap marker */
     struct timespec ts;
 };
 
-
-/* a "lockless" queue */
+/*
+ * a "lockless" queue; each index has a single writer and is read by
+ * the other side, and the two live on separate cache lines -- widx
+ * next to the rest of the producer-owned state -- so that publishing
+ * a record and retiring one do not ping-pong one line between the
+ * producer and consumer cores
+ */
 struct ll_queue {
-    int qnum;  /* This is the queue number and is only needed for debugging */
-    int ridx;  /* The read index */
-    int widx;  /* The write index */
-    struct llq_msg msgs[LLQ_DEPTH];
+    int qnum;           /* This is the queue number and is only needed for debugging */
+    alignas(64) std::atomic<int> ridx;  /* The byte offset of the oldest record (written only by the consumer) */
+    alignas(64) std::atomic<int> widx;  /* The byte offset of the next free byte (written only by the producer) */
+    uint64_t enqueue_drops;  /* Records lost because the ring was full (written only by the producer) */
+    uint64_t filtered;       /* Packets that produced no record, by filter policy (written only by the producer) */
+    uint64_t truncated;      /* Records abandoned at the record size cap (written only by the producer) */
+    uint64_t stall_usec;     /* Microseconds the producer spent waiting on a full ring */
+    int depth_hwm;           /* High-watermark of ring bytes in use (written only by the producer) */
+    alignas(64) char buf[LLQ_BUF_SIZE];
+};
+
+/* the message bytes that follow a record header */
+static inline char *llq_msg_buf(struct llq_msg *m) {
+    return (char *)(m + 1);
+}
+
+/* the number of ring bytes a record with the given message length occupies */
+static inline int llq_record_bytes(ssize_t len) {
+    return (sizeof(struct llq_msg) + len + (LLQ_ALIGN - 1)) & ~(LLQ_ALIGN - 1);
+}
+
+/*
+ * the number of ring bytes currently holding unconsumed records; both
+ * sides may call this, and either may be racing an index update, so
+ * the answer is a snapshot, not an invariant
+ */
+static inline int llq_bytes_used(const struct ll_queue *q) {
+    return (q->widx.load(std::memory_order_relaxed)
+            - q->ridx.load(std::memory_order_relaxed) + LLQ_BUF_SIZE) % LLQ_BUF_SIZE;
+}
+
+/*
+ * returns a slot with room for a maximum-sized message, or NULL if
+ * the queue is too full; the producer fills in the message bytes, ts,
+ * and len, and then calls llq_publish().  May emit a wrap marker when
+ * the free space at the end of the ring is too small.
+ */
+static inline struct llq_msg *llq_write_slot(struct ll_queue *q) {
+    int needed = llq_record_bytes(LLQ_MSG_SIZE);
+    /* the acquire pairs with the consumer's release in llq_consume(),
+     * so ring bytes are reused only after the consumer is done
+     * reading them */
+    int r = q->ridx.load(std::memory_order_acquire);
+    int w = q->widx.load(std::memory_order_relaxed);
+
+    int used = (w - r + LLQ_BUF_SIZE) % LLQ_BUF_SIZE;
+    if (used > q->depth_hwm) {
+        q->depth_hwm = used;   /* only the producer writes this, so no race */
+    }
+
+    if (w >= r) {
+        if (LLQ_BUF_SIZE - w >= needed) {
+            return (struct llq_msg *)(q->buf + w);
+        }
+        if (r > needed) {
+            /* not enough room at the end of the ring, but the front
+             * has room; publish a wrap marker and continue at 0 */
+            struct llq_msg *wrap = (struct llq_msg *)(q->buf + w);
+            wrap->len = -1;
+            q->widx.store(0, std::memory_order_release);
+            return (struct llq_msg *)(q->buf);
+        }
+        return NULL;
+    }
+    if (r - w > needed) {
+        return (struct llq_msg *)(q->buf + w);
+    }
+    return NULL;   /* the consumer hasn't caught up; drop */
+}
+
+/* makes a filled-in record visible to the consumer */
+static inline void llq_publish(struct ll_queue *q, struct llq_msg *m) {
+    int w = (char *)m - q->buf;
+
+    /* the release keeps the record contents ahead of the index update */
+    q->widx.store((w + llq_record_bytes(m->len)) % LLQ_BUF_SIZE, std::memory_order_release);
+    mercury_probe2(llq_enqueue, q->qnum, m->len);
+}
+
+/*
+ * returns the oldest unconsumed record, or NULL if the queue is
+ * empty; wrap markers are skipped here, so this must only ever be
+ * called by the consumer (the output thread)
+ */
+static inline struct llq_msg *llq_peek(struct ll_queue *q) {
+    for (;;) {
+        int r = q->ridx.load(std::memory_order_relaxed);
+        /* the acquire pairs with the producer's release in
+         * llq_publish(), so the record contents are visible */
+        if (r == q->widx.load(std::memory_order_acquire)) {
+            return NULL;
+        }
+        struct llq_msg *m = (struct llq_msg *)(q->buf + r);
+        if (m->len == -1) {
+            /* wrap marker; the ring continues at offset 0 */
+            q->ridx.store(0, std::memory_order_release);
+            continue;
+        }
+        return m;
+    }
+}
+
+/*
+ * returns the record that follows m in the ring, or NULL if m is the
+ * newest published record; does not advance ridx, so the consumer can
+ * look ahead at a run of records and retire them all with a single
+ * llq_consume() of the last one
+ */
+static inline struct llq_msg *llq_peek_next(struct ll_queue *q, struct llq_msg *m) {
+    int r = (int)(((char *)m - q->buf + llq_record_bytes(m->len)) % LLQ_BUF_SIZE);
+    int w = q->widx.load(std::memory_order_acquire);
+
+    if (r == w) {
+        return NULL;
+    }
+    struct llq_msg *n = (struct llq_msg *)(q->buf + r);
+    if (n->len == -1) {
+        /* wrap marker; the ring continues at offset 0 */
+        if (w == 0) {
+            return NULL;   /* nothing published past the marker yet */
+        }
+        n = (struct llq_msg *)(q->buf);
+    }
+    return n;
+}
+
+/* retires a record obtained from llq_peek(), freeing its ring bytes */
+static inline void llq_consume(struct ll_queue *q, struct llq_msg *m) {
+    int r = (char *)m - q->buf;
+
+    /* the release prevents the index update from passing the reads of
+     * the record being retired */
+    q->ridx.store((r + llq_record_bytes(m->len)) % LLQ_BUF_SIZE, std::memory_order_release);
+    mercury_probe2(llq_dequeue, q->qnum, m->len);
+}
+
+
+/*
+ * Capture-to-write latency histogram.  The output thread adds the
+ * difference between each record's packet timestamp and the time of
+ * the merge pass that writes it; the stats thread snapshots the
+ * histogram each second and reports interval percentiles.  The
+ * buckets are HDR-style: each power-of-two range (octave) is split
+ * into 2^LLQ_LAT_SUBBUCKET_BITS linear sub-buckets, so the relative
+ * quantization error is bounded (at most 1/8 here) at every scale
+ * from nanoseconds up to minutes.  The histogram has a single writer
+ * (the output thread); the reader sees an approximate but
+ * consistent-enough snapshot, as with the other queue telemetry.
+ */
+#define LLQ_LAT_SUBBUCKET_BITS 3
+#define LLQ_LAT_SUBBUCKETS (1 << LLQ_LAT_SUBBUCKET_BITS)
+#define LLQ_LAT_OCTAVES 40
+#define LLQ_LAT_NUM_BUCKETS (LLQ_LAT_OCTAVES * LLQ_LAT_SUBBUCKETS)
+
+struct latency_histogram {
+    uint64_t count[LLQ_LAT_NUM_BUCKETS];
+    uint64_t total;
 };
 
+static inline void latency_histogram_add(struct latency_histogram *h, uint64_t nsec) {
+    int bucket;
+    if (nsec < LLQ_LAT_SUBBUCKETS) {
+        bucket = nsec;
+    } else {
+        int msb = 63 - __builtin_clzll(nsec);
+        int shift = msb - LLQ_LAT_SUBBUCKET_BITS;
+        bucket = ((shift + 1) << LLQ_LAT_SUBBUCKET_BITS)
+            + ((nsec >> shift) & (LLQ_LAT_SUBBUCKETS - 1));
+        if (bucket >= LLQ_LAT_NUM_BUCKETS) {
+            bucket = LLQ_LAT_NUM_BUCKETS - 1;
+        }
+    }
+    h->count[bucket]++;
+    h->total++;
+}
+
+/* the smallest latency (in nanoseconds) that falls in a bucket */
+static inline uint64_t latency_histogram_bucket_nsec(int bucket) {
+    if (bucket < LLQ_LAT_SUBBUCKETS) {
+        return bucket;
+    }
+    int shift = (bucket >> LLQ_LAT_SUBBUCKET_BITS) - 1;
+    return ((uint64_t)(LLQ_LAT_SUBBUCKETS + (bucket & (LLQ_LAT_SUBBUCKETS - 1)))) << shift;
+}
+
+/*
+ * returns the latency (in nanoseconds) at the given percentile
+ * (e.g. 0.99) of the histogram cur, less the counts of the earlier
+ * snapshot prev (which may be NULL, for totals since startup);
+ * returns 0 when the interval recorded no latencies
+ */
+static inline uint64_t latency_histogram_percentile(const struct latency_histogram *cur,
+                                                    const struct latency_histogram *prev,
+                                                    double fraction) {
+    uint64_t total = cur->total - (prev ? prev->total : 0);
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(fraction * total);
+    if (rank >= total) {
+        rank = total - 1;
+    }
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < LLQ_LAT_NUM_BUCKETS; bucket++) {
+        seen += cur->count[bucket] - (prev ? prev->count[bucket] : 0);
+        if (seen > rank) {
+            return latency_histogram_bucket_nsec(bucket);
+        }
+    }
+    return latency_histogram_bucket_nsec(LLQ_LAT_NUM_BUCKETS - 1);
+}
 
 struct thread_queues {
     int qnum;             /* The number of queues that have been allocated */
     int qidx;             /* The index of the first free queue */
     struct ll_queue *queue;      /* The actual queue datastructure */
-};
-
-
-struct tourn_tree {
-    int qnum;
-    int qp2;
-    int *tree;
-    int stalled;
+    struct latency_histogram latency;  /* capture-to-write latency (written only by the output thread) */
+    uint64_t rotations;   /* output file opens and rotations (written only by the output thread) */
+    uint64_t records_written;  /* records retired to the output destination (written only by the output thread) */
 };
 
 #endif // LLQ_H
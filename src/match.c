@@ -6,14 +6,38 @@
  */
 
 #include <ctype.h>    // for tolower()
+#include <stdio.h>    // for fprintf()
+#include <string.h>   // for memcpy()
 #include "mercury.h"  // for extractor_debug()
 #include "match.h"
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 unsigned int uint16_match(uint16_t x,
                           const uint16_t *ulist,
                           unsigned int num) {
     const uint16_t *ulist_end = ulist + num;
 
+#if defined(__x86_64__)
+    /*
+     * check eight list entries per compare; the TLS/DTLS static
+     * extension type lists run this lookup once per extension, so the
+     * linear search is worth vectorizing.  SSE2 is part of the x86-64
+     * baseline, so this path needs no runtime dispatch; the scalar
+     * loop below handles the remaining entries.
+     */
+    const __m128i xv = _mm_set1_epi16(x);
+
+    while (ulist_end - ulist >= 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)ulist);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(v, xv)) != 0) {
+            return 1;
+        }
+        ulist += 8;
+    }
+#endif
+
     while (ulist < ulist_end) {
         if (x == *ulist++) {
             return 1;
@@ -48,6 +72,80 @@ unsigned int u64_compare_masked_data_to_value(const void *data,
 }
 
 
+void masked_matcher_add(struct masked_matcher *m,
+                        const void *mask,
+                        const void *value,
+                        size_t len) {
+    if (m->count >= MASKED_MATCHER_MAX_PATTERNS || len > MASKED_PATTERN_LEN) {
+        fprintf(stderr, "error: could not add pattern to masked matcher\n");
+        return;
+    }
+    struct masked_pattern *p = &m->pattern[m->count];
+    memset(p, 0, sizeof(struct masked_pattern));
+    memcpy(p->mask, mask, len);
+    memcpy(p->value, value, len);
+    m->count++;
+}
+
+/*
+ * mask_is_zero(mask, len) returns 1 if every byte of the mask is
+ * zero; since every registered value is nonzero, such a pattern can
+ * never match, and the caller can omit it from a matcher.  This is
+ * how proto_ident_config() disables deselected protocols.
+ */
+unsigned int mask_is_zero(const void *mask, size_t len) {
+    const uint8_t *m = (const uint8_t *)mask;
+
+    for (size_t i = 0; i < len; i++) {
+        if (m[i] != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+#if defined(__x86_64__)
+
+/*
+ * the data is loaded once and compared against each pattern with one
+ * AND, one byte-wise compare, and one movemask; SSE2 is part of the
+ * x86-64 baseline, so this path needs no runtime dispatch
+ */
+int masked_matcher_match(const struct masked_matcher *m,
+                         const void *data) {
+    __m128i d = _mm_loadu_si128((const __m128i *)data);
+
+    for (unsigned int i = 0; i < m->count; i++) {
+        __m128i msk = _mm_loadu_si128((const __m128i *)m->pattern[i].mask);
+        __m128i val = _mm_loadu_si128((const __m128i *)m->pattern[i].value);
+        __m128i eq  = _mm_cmpeq_epi8(_mm_and_si128(d, msk), val);
+        if (_mm_movemask_epi8(eq) == 0xffff) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+#else /* __x86_64__ */
+
+int masked_matcher_match(const struct masked_matcher *m,
+                         const void *data) {
+    uint64_t d[2];
+    memcpy(d, data, sizeof(d));
+
+    for (unsigned int i = 0; i < m->count; i++) {
+        uint64_t mask[2], value[2];
+        memcpy(mask, m->pattern[i].mask, sizeof(mask));
+        memcpy(value, m->pattern[i].value, sizeof(value));
+        if (((d[0] & mask[0]) == value[0]) && ((d[1] & mask[1]) == value[1])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+#endif /* __x86_64__ */
+
 /*
  * keyword_matcher performs multiple string matching the
  * straightforward way.  It should be robust and maintainable, and
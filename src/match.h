@@ -23,6 +23,40 @@ unsigned int u64_compare_masked_data_to_value(const void *data,
                                               const void *mask,
                                               const void *value);
 
+/*
+ * masked_matcher holds a set of (mask, value) byte patterns, each
+ * zero-padded out to MASKED_PATTERN_LEN bytes, so that a single
+ * sixteen-byte load of packet data can be checked against every
+ * registered pattern in one pass; a zero mask byte matches anything,
+ * just as in the masked comparisons above.  Patterns are checked in
+ * the order in which they were added, and the index of the first one
+ * that matches is returned, so the caller can map it back to a
+ * per-pattern result.
+ */
+
+#define MASKED_PATTERN_LEN 16
+#define MASKED_MATCHER_MAX_PATTERNS 16
+
+struct masked_pattern {
+    uint8_t mask[MASKED_PATTERN_LEN];
+    uint8_t value[MASKED_PATTERN_LEN];
+};
+
+struct masked_matcher {
+    struct masked_pattern pattern[MASKED_MATCHER_MAX_PATTERNS];
+    unsigned int count;
+};
+
+void masked_matcher_add(struct masked_matcher *m,
+                        const void *mask,
+                        const void *value,
+                        size_t len);
+
+unsigned int mask_is_zero(const void *mask, size_t len);
+
+int masked_matcher_match(const struct masked_matcher *m,
+                         const void *data);
+
 /*
  * keyword_matcher performs multiple string matching the
  * straightforward way.  It should be robust and maintainable, and
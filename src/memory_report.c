@@ -0,0 +1,93 @@
+/*
+ * memory_report.c
+ *
+ * memory accounting for mercury's large allocations (see
+ * memory_report.h)
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <string.h>
+#include "memory_report.h"
+
+#define MEMORY_REPORT_MAX_ENTRIES 64
+
+struct memory_report_entry {
+    const char *subsystem;
+    const char *what;
+    uint64_t bytes;
+};
+
+static struct memory_report_entry memory_report_table[MEMORY_REPORT_MAX_ENTRIES];
+static int memory_report_count = 0;
+static pthread_mutex_t memory_report_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void memory_report_register(const char *subsystem, const char *what, uint64_t bytes) {
+    pthread_mutex_lock(&memory_report_mutex);
+    for (int i = 0; i < memory_report_count; i++) {
+        if (strcmp(memory_report_table[i].subsystem, subsystem) == 0
+            && strcmp(memory_report_table[i].what, what) == 0) {
+            memory_report_table[i].bytes = bytes;   /* a reload updates its row */
+            pthread_mutex_unlock(&memory_report_mutex);
+            return;
+        }
+    }
+    if (memory_report_count < MEMORY_REPORT_MAX_ENTRIES) {
+        memory_report_table[memory_report_count].subsystem = subsystem;
+        memory_report_table[memory_report_count].what = what;
+        memory_report_table[memory_report_count].bytes = bytes;
+        memory_report_count++;
+    }
+    pthread_mutex_unlock(&memory_report_mutex);
+}
+
+/*
+ * reads the kernel's view of this process's memory (current and peak
+ * resident set, and mlock()ed pages, in kilobytes) from
+ * /proc/self/status; returns 0 on platforms without procfs, and the
+ * report then omits those lines
+ */
+static void memory_report_rss(uint64_t *rss_kb, uint64_t *hwm_kb, uint64_t *lck_kb) {
+    *rss_kb = 0;
+    *hwm_kb = 0;
+    *lck_kb = 0;
+    FILE *status = fopen("/proc/self/status", "r");
+    if (status == NULL) {
+        return;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), status) != NULL) {
+        if (strncmp(line, "VmRSS:", 6) == 0) {
+            sscanf(line + 6, "%" SCNu64, rss_kb);
+        } else if (strncmp(line, "VmHWM:", 6) == 0) {
+            sscanf(line + 6, "%" SCNu64, hwm_kb);
+        } else if (strncmp(line, "VmLck:", 6) == 0) {
+            sscanf(line + 6, "%" SCNu64, lck_kb);
+        }
+    }
+    fclose(status);
+}
+
+void memory_report_print(FILE *f) {
+    pthread_mutex_lock(&memory_report_mutex);
+    uint64_t total = 0;
+    fprintf(f, "memory accounting report:\n");
+    for (int i = 0; i < memory_report_count; i++) {
+        fprintf(f, "  %9.1f MB  %s: %s\n",
+                memory_report_table[i].bytes / (1024.0 * 1024.0),
+                memory_report_table[i].subsystem, memory_report_table[i].what);
+        total += memory_report_table[i].bytes;
+    }
+    fprintf(f, "  %9.1f MB  total registered\n", total / (1024.0 * 1024.0));
+    pthread_mutex_unlock(&memory_report_mutex);
+
+    uint64_t rss_kb, hwm_kb, lck_kb;
+    memory_report_rss(&rss_kb, &hwm_kb, &lck_kb);
+    if (rss_kb > 0) {
+        fprintf(f, "  %9.1f MB  resident set (kernel; %.1f MB peak)\n",
+                rss_kb / 1024.0, hwm_kb / 1024.0);
+    }
+    if (lck_kb > 0) {
+        fprintf(f, "  %9.1f MB  locked in RAM (--lock-memory)\n", lck_kb / 1024.0);
+    }
+}
@@ -0,0 +1,34 @@
+/*
+ * memory_report.h
+ *
+ * memory accounting for mercury's large allocations
+ */
+
+#ifndef MEMORY_REPORT_H
+#define MEMORY_REPORT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Each subsystem that makes a large allocation (the TPACKETv3 rings,
+ * the lockless output queues, the fingerprint database, the subnet
+ * tries) registers it here, so that the report can show where the
+ * process's memory budget goes.  The report is printed at startup and
+ * whenever SIGUSR1 is received (see signal_handling.c), alongside the
+ * RSS reported by the kernel, so that an operator can size the
+ * --buffer fraction for a co-tenanted sensor without guessing.
+ *
+ * memory_report_register(subsystem, what, bytes) records an
+ * allocation; registering the same (subsystem, what) pair again
+ * replaces the recorded size, so a database reload updates its row
+ * instead of double-counting.  Both strings must outlive the program
+ * (string literals, in practice).  Small or short-lived allocations
+ * are not worth registering; the point of the report is the handful
+ * of items that dominate the footprint.
+ */
+void memory_report_register(const char *subsystem, const char *what, uint64_t bytes);
+
+void memory_report_print(FILE *f);
+
+#endif /* MEMORY_REPORT_H */
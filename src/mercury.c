@@ -18,11 +18,20 @@
 #include "mercury.h"
 #include "pcap_file_io.h"
 #include "af_packet_v3.h"
+#ifdef HAVE_AF_XDP
+#include "af_xdp.h"
+#endif
 #include "pcap_reader.h"
+#include "traffic_gen.h"
+#include "pkt_proc.h"
 #include "analysis.h"
 #include "signal_handling.h"
 #include "config.h"
+#include "utils.h"
+#include "control.h"
+#include "flow_snapshot.h"
 #include "output.h"
+#include "dns.h"
 #include "license.h"
 #include "version.h"
 
@@ -36,26 +45,57 @@ struct semantic_version mercury_version(MERCURY_SEMANTIC_VERSION);
 char mercury_help[] =
     "%s INPUT [OUTPUT] [OPTIONS]:\n"
     "INPUT\n"
-    "   [-c or --capture] capture_interface   # capture packets from interface\n"
+    "   [-c or --capture] capture_interface   # capture packets from interface(s)\n"
+    "                                         # (multiple: comma-separated list)\n"
     "   [-r or --read] read_file              # read packets from file\n"
+    "   --synthesize config_file              # generate synthetic traffic (see --help)\n"
     "OUTPUT\n"
     "   [-f or --fingerprint] json_file_name  # write JSON fingerprints to file\n"
     "   [-w or --write] pcap_file_name        # write packets to PCAP/MCAP file\n"
+    "   --gzip                                # compress JSON or pcap output with gzip\n"
+    "   --separate-files                      # one JSON output file per thread\n"
+    "   --output-sink tcp:host:port           # stream JSON records to a TCP collector\n"
+    "   --output-sink unix:path               # stream JSON records to a UNIX socket\n"
+    "   --output-max-age i                    # merge output records after i ms (def. 100)\n"
+    "   --output-threads n                    # merge into n output files, one per thread\n"
     "   no output option                      # write JSON fingerprints to stdout\n"
     "--capture OPTIONS\n"
     "   [-b or --buffer] b                    # set RX_RING size to (b * PHYS_MEM)\n"
-    "   [-t or --threads] [num_threads | cpu] # set number of threads\n"
+    "   [-t or --threads] [num_threads | cpu | auto] # set number of threads\n"
+    "   --serialize-threads n                 # parse/serialize on a pool of n threads\n"
     "   [-u or --user] u                      # set UID and GID to those of user u\n"
     "   [-d or --directory] d                 # set working directory to d\n"
+    "   --xdp                                 # use AF_XDP (XSK) instead of AF_PACKET\n"
+    "   --busy-poll b                         # busy-poll with spin budget of b usec\n"
+    "   --mirror i                            # mirror selected packets to interface i\n"
+    "   --lock-memory                         # lock and prefault all process memory\n"
+    "   --numa-replicate-db                   # per-NUMA-node analysis database copies\n"
+    "   --fanout-group g                      # pin the fanout group id to g\n"
+    "   --handoff p                           # take over capture from process p\n"
     "GENERAL OPTIONS\n"
     "   --config c                            # read configuration from file c\n"
     "   [-a or --analysis]                    # analyze fingerprints\n"
     "   --resources d                         # use resource directory d\n"
     "   [-s or --select] filter               # select only metadata (see --help)\n"
     "   [-l or --limit] l                     # rotate output file after l records\n"
-    "   --dns-json                            # output DNS as JSON, not base64\n"
+    "   --dns-json[=s]                        # output DNS as JSON, not base64\n"
     "   --certs-json                          # output certs as JSON, not base64\n"
     "   --metadata                            # output more protocol metadata in JSON\n"
+    "   --aggregate-flows                     # merge client/server records per flow\n"
+    "   --dedup i                             # emit repeated records once per i seconds\n"
+    "   --flow-snapshot f                     # save/restore flow state in file f\n"
+    "   --verify-checksums                    # discard corrupt frames before parsing\n"
+    "   --unknown-entropy                     # report entropy of unidentified flows\n"
+    "   --attribute-resumptions               # annotate resumed TLS sessions with the\n"
+    "                                         # original full-handshake fingerprint\n"
+    "   --pcap-index                          # write a flow index next to the pcap\n"
+    "   --replay x                            # replay file at x times recorded speed\n"
+    "   --flow-budget-bytes n                 # write at most n pcap bytes per flow\n"
+    "   --flow-budget-packets n               # write at most n pcap packets per flow\n"
+    "   --stats-json f                        # write periodic stats as JSON to file f\n"
+    "   --stats-interval i                    # write a stats record every i seconds\n"
+    "   --profile-sampling r                  # time every r-th packet; report at exit\n"
+    "   --control s                           # accept runtime commands on UNIX socket s\n"
     "   [-v or --verbose]                     # additional information sent to stderr\n"
     "   --license                             # write license information to stdout\n"
     "   --version                             # write version information to stdout\n"
@@ -80,7 +120,9 @@ char mercury_extended_help[] =
     "\n"
     "   \"[-w or --write] w\" writes packets to the file w, in PCAP format.  With the\n"
     "   option [-s or --select], packets are filtered so that only ones with\n"
-    "   fingerprint metadata are written.\n"
+    "   fingerprint metadata are written.  Combined with [-f or --fingerprint],\n"
+    "   both outputs are produced from a single parse of each packet: the\n"
+    "   packets written to w are exactly the ones that produced a JSON record.\n"
     "\n"
     "   \"[r or --read] r\" reads packets from the file r, in PCAP format.\n"
     "\n"
@@ -120,12 +162,184 @@ char mercury_extended_help[] =
     "\n"
     "   --dns-json writes out DNS responses as a JSON object; otherwise,\n"
     "   that data is output in base64 format, as a string with the key \"base64\".\n"
+    "   An optional argument selects which message sections are decoded and\n"
+    "   written, as a comma-separated list drawn from question, answer,\n"
+    "   authority and additional; the records of unselected sections are\n"
+    "   stepped over without being decoded.  For example,\n"
+    "   --dns-json=question,answer omits the authority and additional\n"
+    "   sections, which hold most of a typical response's bytes.  The\n"
+    "   default is to write all four sections.\n"
     "\n"
     "   --certs-json writes out certificates as JSON objects; otherwise,\n"
    "    that data is output in base64 format, as a string with the key \"base64\".\n"
     "\n"
     "   --metadata writes out additional metadata into the protocol JSON objects.\n"
     "\n"
+    "   --aggregate-flows holds each TLS ClientHello record until the server\n"
+    "   response arrives on the same flow, then writes one merged record with the\n"
+    "   client and server fingerprints and metadata together.  A record whose\n"
+    "   server response does not arrive is written out alone after a timeout.\n"
+    "   This option has no effect when analysis is enabled.\n"
+    "\n"
+    "   --dedup i suppresses repeated TLS ClientHello records: records whose\n"
+    "   (fingerprint, server name, destination) triple has already been written\n"
+    "   within the last i seconds are dropped, and each emitted record carries\n"
+    "   an \"occurrences\" count of the observations it represents, so repeated\n"
+    "   triples cost one record per interval with no loss of distinct\n"
+    "   observations.  Suppressed records are counted as filtered.\n"
+    "\n"
+    "   --flow-snapshot f serializes the per-thread flow state -- the\n"
+    "   deduplication table and the TCP initial-message-filter table -- to file\n"
+    "   f at shutdown, and restores it from f at the next start, so that a\n"
+    "   planned restart resumes at steady-state cost instead of emitting\n"
+    "   duplicate and mid-flow records at elevated CPU while the tables refill.\n"
+    "   The snapshot is keyed to the capture interface, and one that does not\n"
+    "   match is ignored with a warning; entries that expired during the\n"
+    "   downtime age out by the tables' normal rules.  In-flight reassembly\n"
+    "   buffers are not snapshotted, since their contents do not outlive their\n"
+    "   flows.  With -u, the file must be writable by that user.\n"
+    "\n"
+    "   --verify-checksums verifies the IPv4 header checksum and the TCP or UDP\n"
+    "   checksum of each frame before any protocol parsing, and silently discards\n"
+    "   frames that fail; on links that deliver corrupted frames (optical taps),\n"
+    "   this keeps garbage fingerprints out of the output and out of everything\n"
+    "   keyed on fingerprints downstream.  Frames that cannot be verified (IPv6,\n"
+    "   fragments, truncated captures, UDP without a checksum) pass unexamined,\n"
+    "   and discarded frames are counted as filtered.\n"
+    "\n"
+    "   --unknown-entropy writes a record for each flow that no protocol matcher\n"
+    "   identifies, reporting the length and Shannon entropy (bits per byte) of\n"
+    "   its first payload; entropy close to 8 indicates an encrypted tunnel,\n"
+    "   while plaintext protocols on unknown ports score well below it.  One\n"
+    "   record is written per unidentified flow.\n"
+    "\n"
+    "   --pcap-index writes a sidecar file (\"<pcap file>.idx\") alongside a pcap\n"
+    "   output file, holding flow key -> (file offset, length) entries, so that\n"
+    "   the pcap_lookup tool can later extract one flow's packets with a few\n"
+    "   seeks instead of a full-file scan.\n"
+    "\n"
+    "   --replay x paces packets from the file given with -r through the full\n"
+    "   processing pipeline at x times their recorded speed (x=0 means as fast\n"
+    "   as possible), and reports the achieved packet rate and the records\n"
+    "   dropped or stalled at each output queue.  Combined with -p, the file is\n"
+    "   replayed repeatedly, which is useful for load testing a configuration\n"
+    "   before deployment.\n"
+    "\n"
+    "   --synthesize c generates a synthetic mix of TLS, HTTP, DNS and SSH\n"
+    "   handshake packets and drives them through the full processing pipeline,\n"
+    "   so a performance scenario can be reproduced from the config file c\n"
+    "   instead of a capture file.  The config holds key=value lines: packets,\n"
+    "   seed, the protocol weights tls, http, dns and ssh, fingerprints (the\n"
+    "   number of distinct TLS fingerprints), snis (the number of distinct\n"
+    "   server names, drawn from a skewed distribution), and padding (the\n"
+    "   maximum random padding per packet).  The same seed always produces the\n"
+    "   same packet sequence.\n"
+    "\n"
+    "   --flow-budget-bytes and --flow-budget-packets limit how much of each\n"
+    "   flow direction is written to a pcap output file; once a flow has used\n"
+    "   its budget, its later packets are not written.  Fingerprint-relevant\n"
+    "   data sits at the start of a flow, so a modest budget captures it while\n"
+    "   cutting the pcap volume of long flows by orders of magnitude.  Packets\n"
+    "   are written whole; a packet that crosses the byte budget is included.\n"
+    "\n"
+    "   --serialize-threads n splits live JSON capture into two stages: the\n"
+    "   capture threads forward raw frames into per-worker parse queues, and a\n"
+    "   pool of n serializer threads parses them into JSON records from there.\n"
+    "   A serialization-heavy packet (a certificate chain, say) then costs a\n"
+    "   serializer thread time instead of stalling ring consumption, and the\n"
+    "   two pools are sized independently: capture threads (-t) for the peak\n"
+    "   packet rate, serializer threads for the record volume.\n"
+    "\n"
+    "   --mirror i forwards the captured packets that match the metadata filter\n"
+    "   (see --select) out of interface i, so that a downstream appliance (an\n"
+    "   IDS, say) receives only handshake and fingerprint-relevant traffic.  Each\n"
+    "   worker writes matching frames into its own memory-mapped PACKET_TX_RING\n"
+    "   and kicks the driver once per captured ring block with a non-blocking\n"
+    "   send(), so mirroring never stalls capture; frames that do not fit in the\n"
+    "   TX ring are dropped and counted rather than awaited.\n"
+    "\n"
+    "   --lock-memory locks the whole process into RAM with mlockall(), raising\n"
+    "   RLIMIT_MEMLOCK first if needed, so that no page of the rings, the flow\n"
+    "   tables or the analysis databases can be paged out and faulted back in\n"
+    "   under traffic; the large allocations that follow are also prefaulted at\n"
+    "   startup rather than page by page during the first minutes of capture.\n"
+    "   The memory accounting report shows how much was locked.  Use this on a\n"
+    "   dedicated sensor; on a co-tenanted host, locked pages are unavailable\n"
+    "   to every other process.\n"
+    "\n"
+    "   --numa-replicate-db builds one copy of the analysis database per NUMA\n"
+    "   node that hosts worker threads, with that copy's memory bound to the\n"
+    "   node, and each worker scores flows through its node-local copy.  On a\n"
+    "   multi-socket sensor the database otherwise lives on one node, and the\n"
+    "   workers on the other node pay remote-memory latency on every lookup.\n"
+    "   A database reload (SIGHUP) rebuilds the copies; a worker whose copy\n"
+    "   lags a reload falls back to the live database until the rebuild lands.\n"
+    "   Only useful with --analysis, on a multi-socket machine.\n"
+    "\n"
+    "   --fanout-group g pins the PACKET_FANOUT group id to g (1-65535) instead\n"
+    "   of deriving it from the process id; with multiple interfaces, interface\n"
+    "   i uses group g+i.  A pinned group id is what lets a second mercury\n"
+    "   process join the same group for a hot upgrade.\n"
+    "\n"
+    "   --handoff p upgrades a running capture without losing packets: start the\n"
+    "   new mercury with the same --fanout-group as the running process p.  The\n"
+    "   new process loads its databases, joins the fanout group (at which point\n"
+    "   the kernel load-balances packets between the two processes), and then\n"
+    "   signals process p with SIGTERM; the old process drains its queues and\n"
+    "   exits gracefully, and all packets from then on are delivered to the new\n"
+    "   process.\n"
+    "\n"
+    "   --attribute-resumptions annotates each resumed TLS session (a ClientHello\n"
+    "   carrying a nonempty session ticket or a TLS 1.3 pre-shared key) with a\n"
+    "   resumption{} object holding the fingerprint of the full handshake it\n"
+    "   resumes, attributed from a per-thread cache keyed by client address and\n"
+    "   server name.  Resumed handshakes have degenerate fingerprints and carry\n"
+    "   no certificates, so this annotation replaces the join against the\n"
+    "   original record that downstream analysis would otherwise need.\n"
+    "\n"
+    "   --output-max-age i bounds how long a record may wait in the output merge,\n"
+    "   in milliseconds (default 100).  The output thread hides records younger\n"
+    "   than this bound from its merge so that a momentarily idle worker cannot\n"
+    "   cause an out-of-order write; lowering the bound trades that reordering\n"
+    "   margin for lower output latency.  When any queue fills past a quarter of\n"
+    "   its capacity the merge runs immediately regardless of age, so a traffic\n"
+    "   burst costs queue depth rather than drops.\n"
+    "\n"
+    "   --output-threads n shards the output merge across n threads, each\n"
+    "   merging an equal share of the worker queues in timestamp order and\n"
+    "   writing its own file (named like the per-thread files of\n"
+    "   --separate-files), so output bandwidth scales with n instead of\n"
+    "   capping the deployment at one writer.  Records are ordered within\n"
+    "   each file, but not across files; the queues are dealt to the shards\n"
+    "   round-robin, matching how workers are dealt to interfaces, so the\n"
+    "   shards carry balanced rates.  Requires -f or -w.\n"
+    "\n"
+    "   --profile-sampling r times one packet in every r (rounded down to a power\n"
+    "   of two) through the protocol extractor with the cycle counter, and prints\n"
+    "   a histogram at exit of parse cost by protocol and packet size bucket.\n"
+    "   This built-in profiler attributes cost to mercury's own logical stages,\n"
+    "   and works on locked-down hosts where external profilers cannot run; at a\n"
+    "   low rate (say 1024) its overhead is negligible.\n"
+    "\n"
+    "   --stats-json f appends one newline-delimited JSON record per interval to\n"
+    "   the file f (which may be a named pipe or /dev/fd/N), holding the full\n"
+    "   counter set: packets, bytes, socket drops and freezes, output queue\n"
+    "   drops, stalls and depth, file rotations, output latency percentiles,\n"
+    "   and per-protocol packet and byte counts.  --stats-interval i sets the\n"
+    "   interval to i seconds (default 1).  The counters are cumulative, so a\n"
+    "   missed record loses resolution, not data.  This option only applies\n"
+    "   when capturing from an interface.\n"
+    "\n"
+    "   --control s accepts line-oriented commands on the UNIX socket s, so\n"
+    "   that a running capture can be retuned without a restart: select=...\n"
+    "   changes the selected protocols, metadata=0/1, dns-json=0/1 and\n"
+    "   certs-json=0/1 change the output verbosity, stats-interval=i changes\n"
+    "   the stats JSON interval, and resources=d (or a bare reload) reloads\n"
+    "   the analysis databases.  Each change is published with an atomic\n"
+    "   swap that the workers see at the next packet, and each command is\n"
+    "   answered with an \"ok\" or \"error: ...\" line; for example:\n"
+    "      echo select=tls,quic | socat - UNIX-CONNECT:/run/mercury.sock\n"
+    "\n"
     "   [-v or --verbose] writes additional information to the standard error,\n"
     "   including the packet count, byte count, elapsed time and processing rate, as\n"
     "   well as information about threads and files.\n"
@@ -180,16 +394,44 @@ int main(int argc, char *argv[]) {
     struct mercury_config cfg = mercury_config_init();
 
     while(1) {
-        enum opt { config=1, version=2, license=3, dns_json=4, certs_json=5, metadata=6, resources=7 };
+        enum opt { config=1, version=2, license=3, dns_json=4, certs_json=5, metadata=6, resources=7, xdp=8, busy_poll=9, gzip=10, separate_files=11, output_sink=12, aggregate_flows=13, pcap_index=14, replay=15, flow_budget_bytes=16, flow_budget_packets=17, stats_json=18, stats_interval=19, synthesize=20, profile_sampling=21, serialize_threads=22, control=23, mirror=24, lock_memory=25, dedup=26, fanout_group=27, handoff=28, verify_checksums=29, unknown_entropy=30, output_max_age=31, attribute_resumptions=32, numa_replicate_db=33, output_threads=34, flow_snapshot=35 };
         int opt_idx = 0;
         static struct option long_opts[] = {
             { "config",      required_argument, NULL, config  },
             { "resources",   required_argument, NULL, resources },
             { "version",     no_argument,       NULL, version },
             { "license",     no_argument,       NULL, license },
-            { "dns-json",    no_argument,       NULL, dns_json },
+            { "dns-json",    optional_argument, NULL, dns_json },
             { "certs-json",  no_argument,       NULL, certs_json },
             { "metadata",    no_argument,       NULL, metadata },
+            { "aggregate-flows", no_argument,   NULL, aggregate_flows },
+            { "dedup",       required_argument, NULL, dedup },
+            { "verify-checksums", no_argument,  NULL, verify_checksums },
+            { "unknown-entropy", no_argument,   NULL, unknown_entropy },
+            { "attribute-resumptions", no_argument, NULL, attribute_resumptions },
+            { "pcap-index",  no_argument,       NULL, pcap_index },
+            { "replay",      required_argument, NULL, replay },
+            { "flow-budget-bytes",   required_argument, NULL, flow_budget_bytes },
+            { "flow-budget-packets", required_argument, NULL, flow_budget_packets },
+            { "xdp",         no_argument,       NULL, xdp },
+            { "busy-poll",   required_argument, NULL, busy_poll },
+            { "gzip",        no_argument,       NULL, gzip },
+            { "separate-files", no_argument,    NULL, separate_files },
+            { "output-sink", required_argument, NULL, output_sink },
+            { "output-max-age", required_argument, NULL, output_max_age },
+            { "output-threads", required_argument, NULL, output_threads },
+            { "flow-snapshot", required_argument, NULL, flow_snapshot },
+            { "stats-json",  required_argument, NULL, stats_json },
+            { "stats-interval", required_argument, NULL, stats_interval },
+            { "synthesize",  required_argument, NULL, synthesize },
+            { "profile-sampling", required_argument, NULL, profile_sampling },
+            { "serialize-threads", required_argument, NULL, serialize_threads },
+            { "control",     required_argument, NULL, control },
+            { "mirror",      required_argument, NULL, mirror },
+            { "lock-memory", no_argument,       NULL, lock_memory },
+            { "numa-replicate-db", no_argument, NULL, numa_replicate_db },
+            { "fanout-group", required_argument, NULL, fanout_group },
+            { "handoff",     required_argument, NULL, handoff },
             { "read",        required_argument, NULL, 'r' },
             { "write",       required_argument, NULL, 'w' },
             { "directory",   required_argument, NULL, 'd' },
@@ -234,10 +476,12 @@ int main(int argc, char *argv[]) {
             break;
         case dns_json:
             if (optarg) {
-                usage(argv[0], "option dns-json does not use an argument", extended_help_off);
-            } else {
-                global_vars.dns_json_output = true;
+                global_vars.dns_sections = dns_sections_parse(optarg);
+                if (global_vars.dns_sections == 0) {
+                    usage(argv[0], "option dns-json takes a comma-separated list of the sections question, answer, authority and additional", extended_help_off);
+                }
             }
+            global_vars.dns_json_output = true;
             break;
         case certs_json:
             if (optarg) {
@@ -253,6 +497,251 @@ int main(int argc, char *argv[]) {
                 global_vars.metadata_output = true;
             }
             break;
+        case aggregate_flows:
+            if (optarg) {
+                usage(argv[0], "option aggregate-flows does not use an argument", extended_help_off);
+            } else {
+                global_vars.aggregate_flows = true;
+            }
+            break;
+        case pcap_index:
+            if (optarg) {
+                usage(argv[0], "option pcap-index does not use an argument", extended_help_off);
+            } else {
+                global_vars.pcap_index = true;
+            }
+            break;
+        case attribute_resumptions:
+            if (optarg) {
+                usage(argv[0], "option attribute-resumptions does not use an argument", extended_help_off);
+            } else {
+                global_vars.attribute_resumptions = true;
+            }
+            break;
+        case output_max_age:
+            if (optarg) {
+                errno = 0;
+                global_vars.output_max_age_ms = strtol(optarg, NULL, 10);
+                if (errno || global_vars.output_max_age_ms < 1) {
+                    usage(argv[0], "error: could not parse argument for option --output-max-age", extended_help_off);
+                }
+            } else {
+                usage(argv[0], "option --output-max-age requires an argument in milliseconds", extended_help_off);
+            }
+            break;
+        case output_threads:
+            if (optarg) {
+                errno = 0;
+                cfg.output_threads = strtol(optarg, NULL, 10);
+                if (errno || cfg.output_threads < 1) {
+                    usage(argv[0], "error: could not parse argument for option --output-threads", extended_help_off);
+                }
+            } else {
+                usage(argv[0], "option --output-threads requires a thread count argument", extended_help_off);
+            }
+            break;
+        case flow_snapshot:
+            if (option_is_valid(optarg)) {
+                cfg.flow_snapshot = optarg;
+            } else {
+                usage(argv[0], "option --flow-snapshot requires a file path argument", extended_help_off);
+            }
+            break;
+        case dedup:
+            if (optarg) {
+                errno = 0;
+                global_vars.dedup_interval = strtol(optarg, NULL, 10);
+                if (errno || global_vars.dedup_interval < 1) {
+                    usage(argv[0], "error: could not parse argument for option --dedup", extended_help_off);
+                }
+            } else {
+                usage(argv[0], "option --dedup requires an interval argument in seconds", extended_help_off);
+            }
+            break;
+        case xdp:
+            if (optarg) {
+                usage(argv[0], "option xdp does not use an argument", extended_help_off);
+            } else {
+                cfg.use_xdp = true;
+            }
+            break;
+        case busy_poll:
+            if (optarg) {
+                errno = 0;
+                cfg.busy_poll_usecs = strtol(optarg, NULL, 10);
+                if (errno || cfg.busy_poll_usecs < 1) {
+                    usage(argv[0], "error: could not parse argument for option --busy-poll", extended_help_off);
+                }
+            } else {
+                usage(argv[0], "option --busy-poll requires a spin budget argument in microseconds", extended_help_off);
+            }
+            break;
+        case flow_budget_bytes:
+            if (optarg) {
+                errno = 0;
+                cfg.flow_budget_bytes = strtoul(optarg, NULL, 10);
+                if (errno || cfg.flow_budget_bytes == 0) {
+                    usage(argv[0], "error: could not parse argument for option --flow-budget-bytes", extended_help_off);
+                }
+            } else {
+                usage(argv[0], "option --flow-budget-bytes requires a byte count argument", extended_help_off);
+            }
+            break;
+        case flow_budget_packets:
+            if (optarg) {
+                errno = 0;
+                cfg.flow_budget_packets = strtoul(optarg, NULL, 10);
+                if (errno || cfg.flow_budget_packets == 0) {
+                    usage(argv[0], "error: could not parse argument for option --flow-budget-packets", extended_help_off);
+                }
+            } else {
+                usage(argv[0], "option --flow-budget-packets requires a packet count argument", extended_help_off);
+            }
+            break;
+        case replay:
+            if (optarg) {
+                errno = 0;
+                char *endp = NULL;
+                cfg.replay_rate = strtod(optarg, &endp);
+                if (errno || endp == optarg || *endp != '\0' || cfg.replay_rate < 0.0) {
+                    usage(argv[0], "error: could not parse argument for option --replay", extended_help_off);
+                }
+            } else {
+                usage(argv[0], "option --replay requires a speed multiple argument (0 means flat-out)", extended_help_off);
+            }
+            break;
+        case gzip:
+            if (optarg) {
+                usage(argv[0], "error: option --gzip does not use an argument", extended_help_off);
+            } else {
+                cfg.gzip_output = true;
+            }
+            break;
+        case separate_files:
+            if (optarg) {
+                usage(argv[0], "error: option --separate-files does not use an argument", extended_help_off);
+            } else {
+                cfg.separate_files = true;
+            }
+            break;
+        case output_sink:
+            if (optarg) {
+                cfg.output_sink = optarg;
+            } else {
+                usage(argv[0], "option --output-sink requires tcp:host:port or unix:path argument", extended_help_off);
+            }
+            break;
+        case stats_json:
+            if (option_is_valid(optarg)) {
+                cfg.stats_json = optarg;
+            } else {
+                usage(argv[0], "option --stats-json requires filename argument", extended_help_off);
+            }
+            break;
+        case stats_interval:
+            if (optarg) {
+                errno = 0;
+                cfg.stats_interval = strtol(optarg, NULL, 10);
+                if (errno || cfg.stats_interval < 1) {
+                    usage(argv[0], "error: could not parse argument for option --stats-interval", extended_help_off);
+                }
+            } else {
+                usage(argv[0], "option --stats-interval requires an interval argument in seconds", extended_help_off);
+            }
+            break;
+        case synthesize:
+            if (option_is_valid(optarg)) {
+                cfg.synth_config = optarg;
+            } else {
+                usage(argv[0], "option --synthesize requires a config file argument", extended_help_off);
+            }
+            break;
+        case profile_sampling:
+            if (optarg) {
+                errno = 0;
+                cfg.profile_sampling = strtol(optarg, NULL, 10);
+                if (errno || cfg.profile_sampling < 1) {
+                    usage(argv[0], "error: could not parse argument for option --profile-sampling", extended_help_off);
+                }
+            } else {
+                usage(argv[0], "option --profile-sampling requires a sampling rate argument", extended_help_off);
+            }
+            break;
+        case serialize_threads:
+            if (optarg) {
+                errno = 0;
+                cfg.serialize_threads = strtol(optarg, NULL, 10);
+                if (errno || cfg.serialize_threads < 1) {
+                    usage(argv[0], "error: could not parse argument for option --serialize-threads", extended_help_off);
+                }
+            } else {
+                usage(argv[0], "option --serialize-threads requires a thread count argument", extended_help_off);
+            }
+            break;
+        case control:
+            if (option_is_valid(optarg)) {
+                cfg.control_socket = optarg;
+            } else {
+                usage(argv[0], "option --control requires a socket path argument", extended_help_off);
+            }
+            break;
+        case mirror:
+            if (option_is_valid(optarg)) {
+                cfg.mirror_interface = optarg;
+            } else {
+                usage(argv[0], "option --mirror requires an interface argument", extended_help_off);
+            }
+            break;
+        case lock_memory:
+            if (optarg) {
+                usage(argv[0], "error: option --lock-memory does not use an argument", extended_help_off);
+            } else {
+                cfg.lock_memory = true;
+            }
+            break;
+        case numa_replicate_db:
+            if (optarg) {
+                usage(argv[0], "error: option --numa-replicate-db does not use an argument", extended_help_off);
+            } else {
+                cfg.numa_replicate_db = true;
+            }
+            break;
+        case verify_checksums:
+            if (optarg) {
+                usage(argv[0], "option verify-checksums does not use an argument", extended_help_off);
+            } else {
+                global_vars.verify_checksums = true;
+            }
+            break;
+        case unknown_entropy:
+            if (optarg) {
+                usage(argv[0], "option unknown-entropy does not use an argument", extended_help_off);
+            } else {
+                global_vars.unknown_entropy = true;
+            }
+            break;
+        case fanout_group:
+            if (optarg) {
+                errno = 0;
+                cfg.fanout_group = strtol(optarg, NULL, 10);
+                if (errno || cfg.fanout_group < 1 || cfg.fanout_group > 65535) {
+                    usage(argv[0], "error: could not parse argument for option --fanout-group", extended_help_off);
+                }
+            } else {
+                usage(argv[0], "option --fanout-group requires a group id argument", extended_help_off);
+            }
+            break;
+        case handoff:
+            if (optarg) {
+                errno = 0;
+                cfg.handoff_pid = strtol(optarg, NULL, 10);
+                if (errno || cfg.handoff_pid < 1) {
+                    usage(argv[0], "error: could not parse argument for option --handoff", extended_help_off);
+                }
+            } else {
+                usage(argv[0], "option --handoff requires a process id argument", extended_help_off);
+            }
+            break;
         case 'r':
             if (option_is_valid(optarg)) {
                 cfg.read_filename = optarg;
@@ -343,6 +832,10 @@ int main(int argc, char *argv[]) {
                     cfg.num_threads = -1; /* create as many threads as there are cpus */
                     break;
                 }
+                if (strcmp(optarg, "auto") == 0) {
+                    cfg.num_threads = -2; /* match the capture interface's queue count */
+                    break;
+                }
                 errno = 0;
                 cfg.num_threads = strtol(optarg, NULL, 10);
                 if (cfg.num_threads == 0 || errno) {
@@ -427,20 +920,99 @@ int main(int argc, char *argv[]) {
         usage(argv[0], "unrecognized options", extended_help_off);
     }
 
-    if (cfg.read_filename == NULL && cfg.capture_interface == NULL) {
-        usage(argv[0], "neither read [r] nor capture [c] specified on command line", extended_help_off);
+    if (cfg.read_filename == NULL && cfg.capture_interface == NULL && cfg.synth_config == NULL) {
+        usage(argv[0], "neither read [r] nor capture [c] nor synthesize specified on command line", extended_help_off);
     }
     if (cfg.read_filename != NULL && cfg.capture_interface != NULL) {
         usage(argv[0], "incompatible arguments read [r] and capture [c] specified on command line", extended_help_off);
     }
-    if (cfg.fingerprint_filename && cfg.write_filename) {
-        usage(argv[0], "both fingerprint [f] and write [w] specified on command line", extended_help_off);
+    if (cfg.synth_config != NULL && (cfg.read_filename != NULL || cfg.capture_interface != NULL)) {
+        usage(argv[0], "The option --synthesize cannot be combined with read [r] or capture [c].", extended_help_off);
+    }
+    /* fingerprint [f] and write [w] together select dual output: one
+     * parse feeds the JSON records and decides the pcap write (see
+     * pkt_proc_json_pcap_writer_llq); the workers append the capture
+     * file themselves, so the index and per-thread files do not apply */
+    if (cfg.fingerprint_filename && cfg.write_filename && global_vars.pcap_index) {
+        usage(argv[0], "The option --pcap-index cannot be combined with both fingerprint [f] and write [w].", extended_help_off);
+    }
+    if (cfg.separate_files && cfg.write_filename) {
+        usage(argv[0], "The option --separate-files cannot be combined with write [w].", extended_help_off);
     }
 
     if (cfg.write_filename && cfg.read_filename) {
         cfg.output_block = true;      // use blocking output, so that no packets are lost in copying
     }
 
+    /* The option --separate-files writes one JSON file per thread, so it needs -f */
+    if (cfg.separate_files && cfg.fingerprint_filename == NULL) {
+        usage(argv[0], "The option --separate-files requires option -f json file.", extended_help_off);
+    }
+
+    /* The option --output-sink replaces file output entirely */
+    if (cfg.output_sink && (cfg.fingerprint_filename || cfg.write_filename || cfg.separate_files)) {
+        usage(argv[0], "The option --output-sink cannot be combined with -f, -w or --separate-files.", extended_help_off);
+    }
+
+    /* The option --serialize-threads splits live JSON capture into a
+     * parse stage and a serialize stage, so it needs -c, and has no
+     * meaning with pcap output or per-thread files */
+    if (cfg.serialize_threads > 0 && cfg.capture_interface == NULL) {
+        usage(argv[0], "The option --serialize-threads requires capture [c].", extended_help_off);
+    }
+    if (cfg.serialize_threads > 0 && (cfg.write_filename || cfg.separate_files)) {
+        usage(argv[0], "The option --serialize-threads cannot be combined with write [w] or --separate-files.", extended_help_off);
+    }
+
+    /* The option --output-threads shards the ordered output merge
+     * across several files, so it needs a file output to shard */
+    if (cfg.output_threads > 1 && cfg.fingerprint_filename == NULL && cfg.write_filename == NULL) {
+        usage(argv[0], "The option --output-threads requires fingerprint [f] or write [w].", extended_help_off);
+    }
+    if (cfg.output_threads > 1 && cfg.separate_files) {
+        usage(argv[0], "The option --output-threads cannot be combined with --separate-files.", extended_help_off);
+    }
+
+    /* The option --control retunes a running capture, so it needs -c */
+    if (cfg.control_socket && cfg.capture_interface == NULL) {
+        usage(argv[0], "The option --control requires capture [c].", extended_help_off);
+    }
+
+    /* The option --mirror forwards captured packets, so it needs -c */
+    if (cfg.mirror_interface && cfg.capture_interface == NULL) {
+        usage(argv[0], "The option --mirror requires capture [c].", extended_help_off);
+    }
+
+    /* The fanout group id and the handoff it enables only apply to capture */
+    if (cfg.fanout_group && cfg.capture_interface == NULL) {
+        usage(argv[0], "The option --fanout-group requires capture [c].", extended_help_off);
+    }
+    if (cfg.handoff_pid && cfg.capture_interface == NULL) {
+        usage(argv[0], "The option --handoff requires capture [c].", extended_help_off);
+    }
+    if (cfg.handoff_pid && cfg.fanout_group == 0) {
+        usage(argv[0], "The option --handoff requires --fanout-group, matching the running process.", extended_help_off);
+    }
+
+    /* The option --replay paces a capture file through the pipeline, so it needs -r */
+    if (cfg.replay_rate >= 0.0 && cfg.read_filename == NULL) {
+        usage(argv[0], "The option --replay requires option -r pcap file.", extended_help_off);
+    }
+
+    /* The per-flow capture budgets apply to pcap output, so they need -w */
+    if ((cfg.flow_budget_bytes || cfg.flow_budget_packets) && cfg.write_filename == NULL) {
+        usage(argv[0], "The options --flow-budget-bytes and --flow-budget-packets require option -w pcap file.", extended_help_off);
+    }
+
+    /* lock memory before the subsystems allocate, so that MCL_FUTURE
+     * covers (and prefaults) the rings, queues and databases, and
+     * while we are still root, so RLIMIT_MEMLOCK can be raised */
+    if (cfg.lock_memory) {
+        if (lock_process_memory() != status_ok) {
+            return EXIT_FAILURE;  /* process memory could not be locked */
+        }
+    }
+
     if (cfg.analysis) {
         if (analysis_init(cfg.verbosity, cfg.resources) == -1) {
             return EXIT_FAILURE;  /* analysis engine could not be initialized */
@@ -448,6 +1020,13 @@ int main(int argc, char *argv[]) {
         global_vars.do_analysis = true;
     }
 
+    /* the sampling profiler times one packet in every
+     * cfg.profile_sampling through the extractor, and its histogram
+     * is printed just before exit */
+    if (cfg.profile_sampling > 0) {
+        extractor_stats_set_sample_rate(cfg.profile_sampling);
+    }
+
     /*
      * loop_count < 1  ==> not valid
      * loop_count > 1  ==> looping (i.e. repeating read file) will be done
@@ -476,6 +1055,22 @@ int main(int argc, char *argv[]) {
     }
 
     /* set the number of threads, if needed */
+    if (cfg.num_threads == -2) {
+        /* --threads auto: one thread per NIC RX queue, so the fanout
+         * group has exactly as many members as the NIC has queues */
+        if (cfg.capture_interface == NULL) {
+            usage(argv[0], "The option --threads auto requires option -c capture interface.", extended_help_off);
+        }
+        cfg.num_threads = af_packet_interface_thread_count(cfg.capture_interface);
+        if (cfg.num_threads > 0) {
+            fprintf(stderr, "found %d NIC RX queue(s), creating %d thread(s)\n",
+                    cfg.num_threads, cfg.num_threads);
+        } else {
+            fprintf(stderr, "warning: could not determine the queue count of %s; creating one thread per CPU\n",
+                    cfg.capture_interface);
+            cfg.num_threads = -1;
+        }
+    }
     if (cfg.num_threads == -1) {
         int num_cpus = std::thread::hardware_concurrency();
         cfg.num_threads = num_cpus;
@@ -484,21 +1079,63 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    /* a comma-separated capture interface list needs at least one
+     * worker thread (and thus one output queue) per interface */
+    if (cfg.capture_interface) {
+        int num_ifaces = 1;
+        for (const char *ch = cfg.capture_interface; *ch != '\0'; ch++) {
+            if (*ch == ',') {
+                num_ifaces++;
+            }
+        }
+        if (cfg.num_threads < num_ifaces) {
+            fprintf(stderr, "Notice: %d interfaces but only %d thread(s); using %d thread(s)\n",
+                    num_ifaces, cfg.num_threads, num_ifaces);
+            cfg.num_threads = num_ifaces;
+        }
+    }
+
     /* init random number generator */
     srand(time(0));
 
+    /* arm the flow-state snapshot (--flow-snapshot) before any worker
+     * starts, so that the workers restore from it as they come up; the
+     * snapshot is keyed to the capture (or, for offline runs, to the
+     * file being read) */
+    if (cfg.flow_snapshot) {
+        const char *capture_name = cfg.capture_interface ? cfg.capture_interface :
+            cfg.read_filename ? cfg.read_filename : "none";
+        if (flow_snapshot_init(cfg.flow_snapshot, capture_name) != 0) {
+            return EXIT_FAILURE;
+        }
+    }
+
     pthread_t output_thread;
     struct output_file out_file;
     if (output_thread_init(output_thread, out_file, cfg) != 0) {
         fprintf(stderr, "error: unable to initialize output thread\n");
         return EXIT_FAILURE;
     }
+    if (cfg.control_socket) {
+        if (control_socket_init(cfg.control_socket, &cfg) != status_ok) {
+            return EXIT_FAILURE;  /* control socket could not be created */
+        }
+    }
     if (cfg.capture_interface) {
 
         if (cfg.verbosity) {
             fprintf(stderr, "initializing interface %s\n", cfg.capture_interface);
         }
-        if (bind_and_dispatch(&cfg, &out_file) != status_ok) {
+        if (cfg.use_xdp) {
+#ifdef HAVE_AF_XDP
+            if (af_xdp_bind_and_dispatch(&cfg, &out_file) != status_ok) {
+                fprintf(stderr, "error: xdp bind and dispatch failed\n");
+                return EXIT_FAILURE;
+            }
+#else
+            usage(argv[0], "option xdp requires AF_XDP support, which is not compiled in", extended_help_off);
+#endif
+        } else if (bind_and_dispatch(&cfg, &out_file) != status_ok) {
             fprintf(stderr, "error: bind and dispatch failed\n");
             return EXIT_FAILURE;
         }
@@ -507,6 +1144,21 @@ int main(int argc, char *argv[]) {
         if (open_and_dispatch(&cfg, &out_file) != status_ok) {
             return EXIT_FAILURE;
         }
+    } else if (cfg.synth_config) {
+
+        if (synthesize_and_dispatch(&cfg, &out_file) != status_ok) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (cfg.control_socket) {
+        control_socket_finalize();  /* stop accepting commands before teardown */
+    }
+
+    /* the workers have been joined and have contributed their flow
+     * tables; write the snapshot for the next start to restore */
+    if (cfg.flow_snapshot) {
+        flow_snapshot_write();
     }
 
     if (cfg.analysis) {
@@ -516,7 +1168,13 @@ int main(int argc, char *argv[]) {
     if (cfg.verbosity) {
         fprintf(stderr, "stopping output thread and flushing queued output to disk.\n");
     }
-    output_thread_finalize(output_thread, &out_file);
+    if (cfg.separate_files == false && pkt_proc_uses_ring_pcap_writer(&cfg) == false) {
+        output_thread_finalize(output_thread, &out_file);
+    }
+
+    if (cfg.profile_sampling > 0) {
+        extractor_stats_profile_print(stderr);
+    }
 
     return 0;
 }
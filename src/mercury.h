@@ -70,9 +70,29 @@ struct mercury_config {
     int use_test_packet;            /* use test packet to write output file           */
     int adaptive;                   /* adaptively accept/skip packets for PCAP output */
     bool output_block;              /* use blocking output                            */
+    bool use_xdp;                   /* use AF_XDP (XSK) capture instead of AF_PACKET  */
+    int busy_poll_usecs;            /* busy-poll spin budget in usec, or 0 to disable */
+    bool gzip_output;               /* compress JSON output with gzip                 */
+    bool separate_files;            /* one JSON output file per thread; no merge      */
+    char *output_sink;              /* network sink spec (tcp:host:port or unix:path) */
+    double replay_rate;             /* replay speed multiple; 0=flat-out, <0=disabled */
+    uint64_t flow_budget_bytes;     /* pcap bytes written per flow, or 0 (no limit)   */
+    uint64_t flow_budget_packets;   /* pcap packets written per flow, or 0 (no limit) */
+    char *stats_json;               /* stats JSON destination path, or NULL           */
+    int stats_interval;             /* seconds between stats JSON records             */
+    char *synth_config;             /* synthetic traffic config file, or NULL         */
+    int profile_sampling;           /* parse-cost sampling rate, or 0 (disabled)      */
+    int serialize_threads;          /* serializer pool size, or 0 (single-stage)      */
+    char *control_socket;           /* UNIX control socket path, or NULL              */
+    char *mirror_interface;         /* TX mirror egress interface, or NULL            */
+    bool lock_memory;               /* mlockall() the process; prefault allocations   */
+    int handoff_pid;                /* pid of the process being replaced, or 0        */
+    bool numa_replicate_db;         /* per-NUMA-node analysis database replicas       */
+    int output_threads;             /* output shard count, or 0 (one output thread)   */
+    char *flow_snapshot;            /* flow-state snapshot file path, or NULL         */
 };
 
-#define mercury_config_init() { NULL, NULL, NULL, NULL, NULL, NULL, false, false, O_EXCL, (char *)"w", 0, 8, 1, 0, NULL, 1, 0, NULL, 0, 0, false }
+#define mercury_config_init() { NULL, NULL, NULL, NULL, NULL, NULL, false, false, O_EXCL, (char *)"w", 0, 8, 1, 0, NULL, 1, 0, NULL, 0, 0, false, false, 0, false, false, NULL, -1.0, 0, 0, NULL, 1, NULL, 0, 0, NULL, NULL, false, 0, false, 0, NULL }
 
 /*
  * struct global_variables holds all of mercury's global variables.
@@ -83,12 +103,20 @@ struct mercury_config {
  * global state, and put them all on the same cache line.
  */
 struct global_variables {
-    global_variables() : dns_json_output{false}, certs_json_output{false}, metadata_output{false}, do_analysis{false} {}
+    global_variables() : dns_json_output{false}, certs_json_output{false}, metadata_output{false}, do_analysis{false}, aggregate_flows{false}, pcap_index{false}, dedup_interval{0}, verify_checksums{false}, unknown_entropy{false}, dns_sections{0xf}, output_max_age_ms{100}, attribute_resumptions{false} {}
 
     bool dns_json_output;   /* output DNS as JSON              */
     bool certs_json_output; /* output certificates as JSON     */
     bool metadata_output;   /* output lots of metadata         */
     bool do_analysis;       /* write analysys{} JSON object    */
+    bool aggregate_flows;   /* merge client/server records     */
+    bool pcap_index;        /* write flow index next to pcap   */
+    int dedup_interval;     /* deduplication window in seconds */
+    bool verify_checksums;  /* discard corrupt frames unparsed  */
+    bool unknown_entropy;   /* report entropy of unknown flows  */
+    uint8_t dns_sections;   /* DNS sections written as JSON     */
+    int output_max_age_ms;  /* output merge age bound, in ms    */
+    bool attribute_resumptions; /* annotate resumed TLS sessions */
 };
 
 #endif /* MERCURY_H */
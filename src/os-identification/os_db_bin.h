@@ -0,0 +1,132 @@
+/*
+ * os_db_bin.h
+ *
+ * compiled binary form of the OS-identification databases
+ *
+ * The three JSON fingerprint/OS databases
+ * (fingerprint-db-{tcp,tls,http}-os.json.gz) and the classifier
+ * parameter file (os_detection_model.json) can be compiled offline
+ * into a single flat binary file (os_db.bin) by the os_db_compiler
+ * tool; os_analysis_init() maps that file into memory with
+ * mmap(PROT_READ, MAP_SHARED) and uses it directly, with no parsing
+ * at startup.  OS names are resolved to integer feature ids by the
+ * compiler, so scoring a record is a fingerprint lookup followed by
+ * additions into a flat feature array, with no per-record string
+ * handling.
+ *
+ * All references within the file are byte offsets relative to the
+ * start of the file, so the mapping may land at any address.  All
+ * multi-byte fields are in the byte order of the machine that ran
+ * the compiler; the file is intended to be built and consumed on the
+ * same platform, and the magic number and version are checked at
+ * load time.
+ *
+ * File layout:
+ *
+ *    os_db_bin_hdr
+ *    classifier labels, intercepts, and coefficient matrix
+ *    string data and fingerprint records, in the order the compiler
+ *       emitted them
+ *    one index per fingerprint type (tcp, tls, http), each sorted by
+ *       the fingerprint string that its entries refer to
+ *
+ * Structures are 8-byte aligned within the file; strings are
+ * NUL-terminated and may appear at any offset.
+ */
+
+#ifndef OS_DB_BIN_H
+#define OS_DB_BIN_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define OS_DB_BIN_MAGIC   "MOSD"
+#define OS_DB_BIN_VERSION 1
+
+/*
+ * indices of the per-fingerprint-type tables within the file; these
+ * match the feature-vector segment that each type contributes to
+ * (the "multiplier" in the JSON scoring path)
+ */
+enum os_db_bin_fp_type {
+    os_db_bin_fp_tcp       = 0,
+    os_db_bin_fp_tls       = 1,
+    os_db_bin_fp_http      = 2,
+    os_db_bin_num_fp_types = 3
+};
+
+struct os_db_bin_table {
+    uint64_t index;           /* offset of num_fps structs of type os_db_bin_index */
+    uint32_t num_fps;
+    uint32_t pad;
+};
+
+struct os_db_bin_hdr {
+    uint8_t  magic[4];
+    uint32_t version;
+    uint32_t os_len;          /* number of integer OS feature ids           */
+    uint32_t label_len;       /* number of classifier output labels         */
+    uint64_t labels;          /* offset of label_len string offsets         */
+    uint64_t intercepts;      /* offset of label_len doubles                */
+    uint64_t coefficients;    /* offset of label_len * os_len*3 doubles,    */
+                              /*    one contiguous row per label            */
+    struct os_db_bin_table fp_tables[os_db_bin_num_fp_types];
+    uint64_t file_size;       /* must equal the size of the mapped file     */
+};
+
+struct os_db_bin_index {
+    uint64_t fp_str;          /* offset of the NUL-terminated str_repr      */
+    uint64_t record;          /* offset of the os_db_bin_record             */
+};
+
+/*
+ * one OS observation within a fingerprint record; os_id indexes the
+ * feature-vector segment of the record's fingerprint type
+ */
+struct os_db_bin_entry {
+    uint32_t os_id;           /* integer feature id, less than os_len       */
+    float    weight;          /* observation fraction for this OS           */
+};
+
+/*
+ * a fingerprint record holds a contiguous array of its OS entries
+ */
+struct os_db_bin_record {
+    uint32_t num_entries;
+    uint32_t pad;
+    /* followed by num_entries structs of type os_db_bin_entry */
+};
+
+static inline const char *os_db_bin_string(const uint8_t *base, uint64_t offset) {
+    return (const char *)(base + offset);
+}
+
+static inline const struct os_db_bin_entry *os_db_bin_record_entries(const struct os_db_bin_record *r) {
+    return (const struct os_db_bin_entry *)(r + 1);
+}
+
+/*
+ * os_db_bin_find(base, table, fp_str) returns the record whose
+ * str_repr equals fp_str, or NULL if there is none
+ */
+static inline const struct os_db_bin_record *os_db_bin_find(const uint8_t *base,
+                                                            const struct os_db_bin_table *table,
+                                                            const char *fp_str) {
+    const struct os_db_bin_index *index = (const struct os_db_bin_index *)(base + table->index);
+    uint32_t lo = 0, hi = table->num_fps;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(fp_str, os_db_bin_string(base, index[mid].fp_str));
+        if (cmp == 0) {
+            return (const struct os_db_bin_record *)(base + index[mid].record);
+        } else if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+#endif /* OS_DB_BIN_H */
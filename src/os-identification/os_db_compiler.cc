@@ -0,0 +1,242 @@
+/*
+ * os_db_compiler.cc
+ *
+ * offline tool that compiles the JSON OS-identification databases
+ * (fingerprint-db-{tcp,tls,http}-os.json.gz) and the classifier
+ * parameter file (os_detection_model.json) into the flat binary form
+ * defined in os_db_bin.h, which os_analysis_init() maps into memory
+ *
+ * usage: os_db_compiler <resource-dir> os_db.bin
+ *
+ * build: g++ -Wall -O2 os_db_compiler.cc -o os_db_compiler -lz
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+
+#include "os_db_bin.h"
+
+#include "../rapidjson/document.h"
+#include "../rapidjson/istreamwrapper.h"
+
+/*
+ * the output file is assembled in a growable byte vector; every
+ * offset recorded in the structures is the position of the emitted
+ * data within that vector, which equals its offset in the file
+ */
+struct blob {
+    std::vector<uint8_t> data;
+
+    uint64_t append(const void *p, size_t len) {
+        uint64_t offset = data.size();
+        const uint8_t *c = (const uint8_t *)p;
+        data.insert(data.end(), c, c + len);
+        return offset;
+    }
+
+    uint64_t append_string(const char *s) {
+        return append(s, strlen(s) + 1);
+    }
+
+    /* structures within the file are kept 8-byte aligned */
+    void align() {
+        while (data.size() % 8) {
+            data.push_back(0);
+        }
+    }
+};
+
+static int gzgetline(gzFile f, std::vector<char>& v) {
+    v = std::vector<char>(256);
+    unsigned pos = 0;
+    for (;;) {
+        if (gzgets(f, &v[pos], v.size()-pos) == 0) {
+            // EOF
+            return 0;
+        }
+        unsigned read = strlen(&v[pos]);
+        if (v[pos+read-1] == '\n') {
+            pos = pos + read - 1;
+            break;
+        }
+        pos = v.size() - 1;
+        v.resize(v.size() * 2);
+    }
+    v.resize(pos);
+    return 1;
+}
+
+/*
+ * emit the records of one fingerprint/OS database; the os_map
+ * resolves each OS name to the integer feature id that the entries
+ * carry in place of the name
+ */
+static int compile_fp_db(struct blob &out,
+                         const char *resource_file,
+                         const std::unordered_map<std::string, uint32_t> &os_map,
+                         struct os_db_bin_table *table) {
+    gzFile in_file = gzopen(resource_file, "r");
+    if (in_file == NULL) {
+        fprintf(stderr, "error: could not open file '%s'\n", resource_file);
+        return -1;
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> index;  /* str_repr -> record offset */
+
+    std::vector<char> line;
+    while (gzgetline(in_file, line)) {
+        std::string line_str(line.begin(), line.end());
+        rapidjson::Document fp;
+        fp.Parse(line_str.c_str());
+        if (fp.HasParseError() || !fp.IsObject()
+            || !fp.HasMember("str_repr") || !fp.HasMember("os_info")) {
+            fprintf(stderr, "error: malformed line in '%s'\n", resource_file);
+            gzclose(in_file);
+            return -1;
+        }
+
+        /* OS names absent from the classifier's os_map contribute
+         * nothing to a feature vector, and are dropped here, just as
+         * the JSON scoring path ignores them */
+        std::vector<struct os_db_bin_entry> entries;
+        for (auto &m : fp["os_info"].GetObject()) {
+            auto it = os_map.find(m.name.GetString());
+            if (it != os_map.end()) {
+                entries.push_back({it->second, m.value.GetFloat()});
+            }
+        }
+
+        struct os_db_bin_record record;
+        record.num_entries = entries.size();
+        record.pad = 0;
+
+        out.align();
+        uint64_t record_offset = out.append(&record, sizeof(record));
+        out.append(entries.data(), entries.size() * sizeof(entries[0]));
+
+        index.push_back({fp["str_repr"].GetString(), record_offset});
+    }
+    gzclose(in_file);
+
+    /* emit the string data of the index, then the sorted index itself */
+    std::sort(index.begin(), index.end());
+    std::vector<struct os_db_bin_index> index_table(index.size());
+    for (size_t i = 0; i < index.size(); i++) {
+        index_table[i].fp_str = out.append_string(index[i].first.c_str());
+        index_table[i].record = index[i].second;
+    }
+    out.align();
+    table->index = out.append(index_table.data(), index_table.size() * sizeof(index_table[0]));
+    table->num_fps = index_table.size();
+    table->pad = 0;
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <resource-dir> os_db.bin\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    char resource_file[4096];
+    snprintf(resource_file, sizeof(resource_file), "%s/os_detection_model.json", argv[1]);
+    std::ifstream ifs {resource_file};
+    if (!ifs.is_open()) {
+        fprintf(stderr, "error: could not open file '%s'\n", resource_file);
+        return EXIT_FAILURE;
+    }
+    rapidjson::IStreamWrapper isw{ifs};
+    rapidjson::Document clf_params;
+    clf_params.ParseStream(isw);
+    if (clf_params.HasParseError() || !clf_params.IsObject()) {
+        fprintf(stderr, "error: could not parse file '%s'\n", resource_file);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t os_len = clf_params["os_len"].GetInt();
+    const rapidjson::Value &lbls = clf_params["labels"];
+    uint32_t label_len = lbls.Size();
+
+    struct blob out;
+    struct os_db_bin_hdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    out.append(&hdr, sizeof(hdr));   /* placeholder; rewritten at the end */
+
+    /* emit the classifier labels, intercepts, and coefficients */
+    std::vector<uint64_t> label_offsets(label_len);
+    for (uint32_t i = 0; i < label_len; i++) {
+        label_offsets[i] = out.append_string(lbls[i].GetString());
+    }
+    out.align();
+    hdr.labels = out.append(label_offsets.data(), label_offsets.size() * sizeof(label_offsets[0]));
+
+    std::vector<double> intercepts(label_len, 0.0);
+    const rapidjson::Value &intc = clf_params["intercepts"];
+    for (rapidjson::SizeType i = 0; i < intc.Size(); i++) {
+        intercepts[i] = intc[i].GetDouble();
+    }
+    hdr.intercepts = out.append(intercepts.data(), intercepts.size() * sizeof(intercepts[0]));
+
+    std::vector<double> coefficients((uint64_t)label_len * os_len * 3, 0.0);
+    const rapidjson::Value &cff = clf_params["coefficients"];
+    for (rapidjson::SizeType i = 0; i < cff.Size(); i++) {
+        const rapidjson::Value &cff_inner = cff[i];
+        for (rapidjson::SizeType j = 0; j < cff_inner.Size(); j++) {
+            coefficients[(uint64_t)i * os_len * 3 + j] = cff_inner[j].GetDouble();
+        }
+    }
+    hdr.coefficients = out.append(coefficients.data(), coefficients.size() * sizeof(coefficients[0]));
+
+    /* the os_map assigns each OS name its integer feature id */
+    std::unordered_map<std::string, uint32_t> os_map;
+    const rapidjson::Value &os_m = clf_params["os_map"];
+    for (rapidjson::Value::ConstMemberIterator iter = os_m.MemberBegin(); iter != os_m.MemberEnd(); ++iter) {
+        os_map[iter->name.GetString()] = iter->value.GetInt();
+    }
+
+    static const char *fp_db_names[os_db_bin_num_fp_types] = {
+        "fingerprint-db-tcp-os.json.gz",
+        "fingerprint-db-tls-os.json.gz",
+        "fingerprint-db-http-os.json.gz"
+    };
+    for (unsigned int t = 0; t < os_db_bin_num_fp_types; t++) {
+        snprintf(resource_file, sizeof(resource_file), "%s/%s", argv[1], fp_db_names[t]);
+        if (compile_fp_db(out, resource_file, os_map, &hdr.fp_tables[t]) != 0) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    memcpy(hdr.magic, OS_DB_BIN_MAGIC, sizeof(hdr.magic));
+    hdr.version = OS_DB_BIN_VERSION;
+    hdr.os_len = os_len;
+    hdr.label_len = label_len;
+    hdr.file_size = out.data.size();
+    memcpy(out.data.data(), &hdr, sizeof(hdr));
+
+    FILE *out_file = fopen(argv[2], "wb");
+    if (out_file == NULL) {
+        fprintf(stderr, "error: could not open file '%s'\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    if (fwrite(out.data.data(), 1, out.data.size(), out_file) != out.data.size()) {
+        fprintf(stderr, "error: could not write file '%s'\n", argv[2]);
+        fclose(out_file);
+        return EXIT_FAILURE;
+    }
+    fclose(out_file);
+
+    fprintf(stderr, "compiled %u + %u + %u fingerprints (%zu bytes)\n",
+            hdr.fp_tables[0].num_fps, hdr.fp_tables[1].num_fps, hdr.fp_tables[2].num_fps,
+            out.data.size());
+    return 0;
+}
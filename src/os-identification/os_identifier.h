@@ -4,14 +4,19 @@
 
 #include <iostream>
 #include <fstream>
+#include <fcntl.h>
 #include <math.h>
 #include <zlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <string>
 #include <unordered_set>
 #include <unordered_map>
 #include <vector>
 
 #include "../parser.h"
+#include "os_db_bin.h"
 
 #include "../rapidjson/document.h"
 #include "../rapidjson/stringbuffer.h"
@@ -23,6 +28,10 @@ rapidjson::Document tcp_os_fp_db;
 rapidjson::Document tls_os_fp_db;
 rapidjson::Document http_os_fp_db;
 
+/* compiled form of the OS databases, mapped read-only (see os_db_bin.h) */
+const uint8_t *os_db_base = NULL;
+const struct os_db_bin_hdr *os_db_hdr = NULL;
+
 #ifndef DEFAULT_RESOURCE_DIR
 #define DEFAULT_RESOURCE_DIR "/usr/local/share/mercury"
 #endif
@@ -192,11 +201,16 @@ struct os_classifier {
     void classify(double *features, struct os_result *r) {
         double scores[label_len] = {0};
         double score_sum = 0.0;
+        int num_features = os_len*3;
         for (int i = 0; i < label_len; i++) {
-            scores[i] = intercepts[i];
-            for (int j = 0; j < os_len*3; j++) {
-                scores[i] += coefficients[i*os_len*3+j]*features[j];
+            /* each label's coefficient row and the feature vector are
+             * contiguous, so this dot product vectorizes */
+            const double *row = &coefficients[i*num_features];
+            double score = 0.0;
+            for (int j = 0; j < num_features; j++) {
+                score += row[j]*features[j];
             }
+            scores[i] = intercepts[i] + score;
             score_sum += exp(scores[i]);
         }
 
@@ -218,6 +232,59 @@ struct os_classifier {
 } os_clf;
 
 
+int os_db_bin_init(const char *resource_file) {
+
+    int fd = open(resource_file, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) != 0 || statbuf.st_size < (off_t)sizeof(struct os_db_bin_hdr)) {
+        close(fd);
+        return -1;
+    }
+    /*
+     * the mapping is read-only and MAP_SHARED, so every process
+     * scoring records on the host references the same physical pages
+     * through the page cache
+     */
+    void *addr = mmap(NULL, statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return -1;
+    }
+
+    const struct os_db_bin_hdr *hdr = (const struct os_db_bin_hdr *)addr;
+    if (memcmp(hdr->magic, OS_DB_BIN_MAGIC, sizeof(hdr->magic)) != 0
+        || hdr->version != OS_DB_BIN_VERSION
+        || hdr->file_size != (uint64_t)statbuf.st_size) {
+        munmap(addr, statbuf.st_size);
+        return -1;
+    }
+
+    os_db_base = (const uint8_t *)addr;
+    os_db_hdr = hdr;
+
+    /*
+     * point the classifier at the mapped parameter arrays; the casts
+     * discard const, but classify() only reads them.  The os_map
+     * stays empty: the compiled records carry integer feature ids, so
+     * the name-to-id map is never consulted on this path.
+     */
+    os_clf.os_len = hdr->os_len;
+    os_clf.label_len = hdr->label_len;
+    os_clf.intercepts = (double *)(os_db_base + hdr->intercepts);
+    os_clf.coefficients = (double *)(os_db_base + hdr->coefficients);
+    os_clf.labels = new std::string[hdr->label_len];
+    const uint64_t *label_offsets = (const uint64_t *)(os_db_base + hdr->labels);
+    for (uint32_t i = 0; i < hdr->label_len; i++) {
+        os_clf.labels[i] = os_db_bin_string(os_db_base, label_offsets[i]);
+    }
+
+    return 0;  /* success */
+}
+
+
 int os_analysis_init(const char *resource_dir) {
     const char *resource_dir_list[] =
       {
@@ -235,6 +302,14 @@ int os_analysis_init(const char *resource_dir) {
 
     unsigned int index = 0;
     while (resource_dir_list[index] != NULL) {
+        /* prefer the compiled form (built offline by os_db_compiler),
+         * which is mapped rather than parsed */
+        strncpy(resource_file_name, resource_dir_list[index], PATH_MAX-1);
+        strncat(resource_file_name, "/os_db.bin", PATH_MAX-1);
+        if (os_db_bin_init(resource_file_name) == 0) {
+            return 0;
+        }
+
         strncpy(resource_file_name, resource_dir_list[index], PATH_MAX-1);
         strncat(resource_file_name, "/fingerprint-db-tcp-os.json.gz", PATH_MAX-1);
         int retcode = database_init(resource_file_name, tcp_os_fp_db);
@@ -262,6 +337,33 @@ int os_analysis_init(const char *resource_dir) {
 
 
 void update_features(double **features, const char *fp_type, const char *str_repr) {
+    if (os_db_base) {
+        int type_idx;
+        if (strcmp(fp_type, "tcp") == 0) {
+            type_idx = os_db_bin_fp_tcp;
+        } else if (strcmp(fp_type, "tls") == 0) {
+            type_idx = os_db_bin_fp_tls;
+        } else if (strcmp(fp_type, "http") == 0) {
+            type_idx = os_db_bin_fp_http;
+        } else {
+            return ;
+        }
+        const struct os_db_bin_record *rec =
+            os_db_bin_find(os_db_base, &os_db_hdr->fp_tables[type_idx], str_repr);
+        if (rec == NULL) {
+            return ;
+        }
+        /* the compiled entries carry integer feature ids, so the
+         * accumulation is a walk over one contiguous array, with no
+         * per-OS string lookups */
+        const struct os_db_bin_entry *entry = os_db_bin_record_entries(rec);
+        double *f = *features + type_idx*os_clf.os_len;
+        for (uint32_t k = 0; k < rec->num_entries; k++) {
+            f[entry[k].os_id] += entry[k].weight;
+        }
+        return ;
+    }
+
     rapidjson::Value::ConstMemberIterator matcher;
     int multiplier = 0;
     if (strcmp(fp_type, "tcp") == 0) {
@@ -3,32 +3,86 @@
  */
 
 #include <stdlib.h>
+#include <new>
 #include <sys/time.h>
 #include <string.h>
 #include "output.h"
 #include "pcap_file_io.h"  // for write_pcap_file_header()
+#include "pcap_index.h"    // for the --pcap-index flow index sidecar
+#include "pkt_proc.h"      // for pkt_proc_uses_ring_pcap_writer()
+#include "memory_report.h"
+#include "probe.h"
 #include "utils.h"
 
+extern struct global_variables global_vars; /* defined in config.c */
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#if defined(__NR_io_uring_setup) && defined(IORING_OP_WRITE_FIXED)
+#define HAVE_IO_URING 1
+#endif
+
+#include <errno.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#define OUTPUT_WRITEV_IOVECS 64   /* maximum records gathered into one writev() */
+
 
 #define output_file_needs_rotation(ojf) (--((ojf)->record_countdown) == 0)
 
-void thread_queues_init(struct thread_queues *tqs, int n) {
-    tqs->qnum = n;
-    tqs->queue = (struct ll_queue *)calloc(n, sizeof(struct ll_queue));
+/*
+ * With --output-threads, the worker queues are dealt round-robin to
+ * the output shards; round-robin matches how workers are dealt to the
+ * capture interfaces, so the shards carry balanced rates without
+ * anyone measuring them.  Without sharding, shard_count is 1 and
+ * every queue belongs to the single output thread.
+ */
+static int shard_owns_queue(const struct output_file *ctx, int q) {
+    return (q % ctx->shard_count) == ctx->shard_num;
+}
 
+void thread_queues_init(struct thread_queues *tqs, int n,
+                        const char *subsystem, const char *what) {
+    tqs->qnum = n;
+    /* the queue indexes are cache-line aligned (see struct ll_queue),
+     * which calloc() does not guarantee */
+    if (posix_memalign((void **)&tqs->queue, alignof(struct ll_queue),
+                       (size_t)n * sizeof(struct ll_queue)) != 0) {
+        tqs->queue = NULL;
+    }
     if (tqs->queue == NULL) {
         fprintf(stderr, "Failed to allocate memory for thread queues\n");
         exit(255);
     }
+    for (int i = 0; i < n; i++) {
+        new (&tqs->queue[i]) ll_queue();   /* value-initialization zeroes the atomics */
+    }
+    memory_report_register(subsystem, what, (uint64_t)n * sizeof(struct ll_queue));
+
+    memset(&tqs->latency, 0, sizeof(tqs->latency));
+    tqs->rotations = 0;
+    tqs->records_written = 0;
 
     for (int i = 0; i < n; i++) {
         tqs->queue[i].qnum = i; /* only needed for debug output */
         tqs->queue[i].ridx = 0;
         tqs->queue[i].widx = 0;
-
-        for (int j = 0; j < LLQ_DEPTH; j++) {
-            tqs->queue[i].msgs[j].used = 0;
-        }
+        tqs->queue[i].enqueue_drops = 0;
+        tqs->queue[i].filtered = 0;
+        tqs->queue[i].truncated = 0;
+        tqs->queue[i].stall_usec = 0;
+        tqs->queue[i].depth_hwm = 0;
     }
 }
 
@@ -49,189 +103,662 @@ int time_less(struct timespec *tsl, struct timespec *tsr) {
     }
 }
 
-int queue_less(int ql, int qr, struct tourn_tree *t_tree, const struct thread_queues *tqs) {
+/*
+ * The output thread merges the per-worker queues with a loser tree,
+ * in batches bounded by an epoch watermark.
+ *
+ * Records newer than the watermark (--output-max-age before the
+ * current time, 100 ms by default) are hidden from the merge, so a
+ * queue that happens to be momentarily empty can't force either a
+ * stall or an out-of-order write: by the time a record becomes
+ * eligible, every worker that could produce an older one already has
+ * (workers enqueue records within a fraction of the epoch of their
+ * packet timestamps).  This replaces the old stall-and-rescan scheme,
+ * which re-ran an O(n log n) tournament whenever any queue was empty.
+ *
+ * The age bound yields at both ends of the load curve.  When any
+ * queue fills past LLQ_FLUSH_FILL_FRACTION of its ring, the next pass
+ * merges everything available regardless of age, so that a burst is
+ * absorbed by writing sooner instead of by dropping records at a full
+ * ring.  When traffic is light, the thread sleeps until the oldest
+ * hidden record will age past the watermark, rather than polling on a
+ * fixed timer that is both too slow for a small age bound and
+ * needlessly busy for a large one.
+ *
+ * The loser tree itself stores, at each internal node, the loser of
+ * the match played there; node[0] holds the overall winner.  After
+ * the winner's record is written, only the winner's leaf-to-root path
+ * is replayed -- O(log n) comparisons per record, with no revisiting
+ * of the rest of the tree.
+ */
+
+#define LLQ_FLUSH_FILL_FRACTION 4     /* merge early past 1/4 of a ring    */
+#define LLQ_SLEEP_MAX_NSEC (100 * 1000 * 1000)  /* pass interval ceiling   */
 
-    /* returns 1 if the time of ql < qr and 0 otherwise
-     * Also sets t_tree->stalled = 1 if needed.
-     *
-     * WARNING: This function is NOT thread safe!
-     *
-     * Meaning the access to the 'used' member in the queue
-     * struct happens and then later the access to the
-     * struct timespec happens.
-     * This function must be called by the output thread
-     * and ONLY the output thread because if
-     * queues are changed while this function is going
-     * shit will hit the fan!
-     */
+struct loser_tree {
+    int qnum;               /* the number of queues being merged */
+    int qp2;                /* leaves in the tree: smallest power of two >= qnum */
+    int *node;              /* node[0] is the winner; node[1..qp2-1] hold losers */
+    struct llq_msg **head;  /* head[q]: q's next eligible record, or NULL */
+};
 
-    int ql_used = 0; /* The (l)eft queue in the tree */
-    int qr_used = 0; /* The (r)ight queue in the tree */
+/*
+ * returns 1 if queue ql's next record is older than queue qr's; a
+ * queue index of -1 (tree padding) or a NULL head (empty, or nothing
+ * eligible this batch) loses to everything
+ */
+static int lt_less(struct loser_tree *t, int ql, int qr) {
+    if ((ql < 0) || (t->head[ql] == NULL)) {
+        return 0;
+    }
+    if ((qr < 0) || (t->head[qr] == NULL)) {
+        return 1;
+    }
+    return time_less(&(t->head[ql]->ts), &(t->head[qr]->ts));
+}
 
-    /* check for a queue stall before we return anything otherwise
-     * we could short-circuit logic before realizing one of the
-     * queues was stalled
-     */
-    if ((ql >= 0) && (ql < tqs->qnum)) {
-        ql_used = tqs->queue[ql].msgs[tqs->queue[ql].ridx].used;
-        if (ql_used == 0) {
-            t_tree->stalled = 1;
-        }
+/*
+ * (re)builds the tree from the current heads; winner is scratch space
+ * for 2 * qp2 ints.  The conceptual tree has leaves at indices
+ * qp2..2*qp2-1 (leaf qp2 + q holds queue q) and internal nodes at
+ * 1..qp2-1; each match records its winner in the scratch array and
+ * its loser in the tree.
+ */
+static void lt_build(struct loser_tree *t, int *winner) {
+    for (int i = t->qp2; i < 2 * t->qp2; i++) {
+        winner[i] = (i - t->qp2 < t->qnum) ? i - t->qp2 : -1;
     }
-    if ((qr >= 0) && (qr < tqs->qnum)) {
-        qr_used = tqs->queue[qr].msgs[tqs->queue[qr].ridx].used;
-        if (qr_used == 0) {
-            t_tree->stalled = 1;
+    for (int i = t->qp2 - 1; i >= 1; i--) {
+        int a = winner[2 * i];
+        int b = winner[(2 * i) + 1];
+        if (lt_less(t, a, b)) {
+            winner[i] = a;
+            t->node[i] = b;
+        } else {
+            winner[i] = b;
+            t->node[i] = a;
         }
     }
+    t->node[0] = winner[1];   /* with one leaf (qp2 == 1), index 1 is that leaf */
+}
 
-    /* If the queue numbers here are -1 that means we've spilled
-     * over into the portion of the tournament tree that isn't
-     * populated by queues because the number of queues wasn't a
-     * power-of-two
-     *
-     * Don't blindly combine this into the above statements as an else
-     * without realising that both qr and ql must be checked for
-     * a stall before any return is done
-     */
-    if (ql == -1) {
-        return 0;
-    } else if (qr == -1) {
-        return 1;
+/*
+ * replays the matches along queue wq's leaf-to-root path after its
+ * head has changed, updating the overall winner
+ */
+static void lt_replay(struct loser_tree *t, int wq) {
+    int w = wq;
+    for (int n = (t->qp2 + wq) / 2; n >= 1; n /= 2) {
+        if (lt_less(t, t->node[n], w)) {
+            int tmp = w;
+            w = t->node[n];
+            t->node[n] = tmp;
+        }
     }
+    t->node[0] = w;
+}
 
-    /* The t_tree is built as though the number of queues is
-     * a power-of-two however it doesn't actually have to be
-     * that way so if the computed queue number spills over past
-     * the actual number of queues we just fill the tree with -1
-     * to indicate that portion of the tree shouldn't be use
-     * in the tournament (and any real queue compared to a -1 queue
-     * automatically "wins").
-     */
-    if (ql >= tqs->qnum) {
-        return 0;
-    } else if (qr >= tqs->qnum) {
-        return 1;
+#ifdef HAVE_IO_URING
+
+/*
+ * The output thread can submit its writes through io_uring instead of
+ * making synchronous write() calls, so that the tournament merge never
+ * blocks in the kernel waiting on the disk.  Messages are copied out
+ * of the lockless queues into a small set of large staging buffers
+ * that are registered with the kernel up front (IORING_OP_WRITE_FIXED
+ * avoids a page pin/unpin on every submission); a buffer is submitted
+ * when it fills, or when the merge stalls, and it is reused only
+ * after its completion arrives.  If io_uring isn't available at
+ * runtime the output thread just falls back to fwrite().
+ */
+
+#define URING_NUM_BUFS 4              /* staging buffers (also the queue depth) */
+#define URING_BUF_SIZE (256 * 1024)   /* bytes per staging buffer */
+
+struct uring_writer {
+    int ring_fd;
+    unsigned int *sq_head;      /* submission ring */
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    unsigned int *cq_head;      /* completion ring */
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_sqe *sqes;
+    size_t sqes_sz;
+    struct io_uring_cqe *cqes;
+    void *sq_ring_ptr;
+    size_t sq_ring_sz;
+    void *cq_ring_ptr;
+    size_t cq_ring_sz;
+    char *buf[URING_NUM_BUFS];
+    size_t buf_len[URING_NUM_BUFS];  /* submitted length, while in flight */
+    off_t buf_off[URING_NUM_BUFS];   /* submitted file offset, while in flight */
+    int buf_inflight[URING_NUM_BUFS];
+    int num_inflight;
+    int cur;           /* the buffer currently being filled */
+    size_t cur_len;    /* how full the current buffer is */
+    int fd;            /* the file being written */
+    int use_offset;    /* explicit offsets (regular file) vs. current position */
+    off_t off;         /* next file offset to write at */
+};
+
+static int uring_writer_init(struct uring_writer *u) {
+    struct io_uring_params p;
+
+    memset(u, 0, sizeof(struct uring_writer));
+    memset(&p, 0, sizeof(p));
+
+    u->ring_fd = syscall(__NR_io_uring_setup, URING_NUM_BUFS, &p);
+    if (u->ring_fd < 0) {
+        return -1;  /* kernel too old, or io_uring disabled; caller falls back */
     }
 
-    /* This is where we do the actual less comparison */
-    if (ql_used == 0) {
-        return 0;
-    } else if (qr_used == 0) {
-        return 1;
+    u->sq_ring_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    u->cq_ring_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->cq_ring_sz > u->sq_ring_sz) {
+            u->sq_ring_sz = u->cq_ring_sz;
+        }
+        u->cq_ring_sz = u->sq_ring_sz;
+    }
+    u->sq_ring_ptr = mmap(NULL, u->sq_ring_sz, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_SQ_RING);
+    if (u->sq_ring_ptr == MAP_FAILED) {
+        return -1;  /* uring_writer_free() cleans up on every failure path */
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        u->cq_ring_ptr = u->sq_ring_ptr;
     } else {
-        struct timespec *tsl = &(tqs->queue[ql].msgs[tqs->queue[ql].ridx].ts);
-        struct timespec *tsr = &(tqs->queue[qr].msgs[tqs->queue[qr].ridx].ts);
+        u->cq_ring_ptr = mmap(NULL, u->cq_ring_sz, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_CQ_RING);
+        if (u->cq_ring_ptr == MAP_FAILED) {
+            return -1;
+        }
+    }
+    u->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = (struct io_uring_sqe *)mmap(NULL, u->sqes_sz,
+                                          PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                          u->ring_fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) {
+        return -1;
+    }
 
-        return time_less(tsl, tsr);
+    u->sq_head  = (unsigned int *)((char *)u->sq_ring_ptr + p.sq_off.head);
+    u->sq_tail  = (unsigned int *)((char *)u->sq_ring_ptr + p.sq_off.tail);
+    u->sq_mask  = (unsigned int *)((char *)u->sq_ring_ptr + p.sq_off.ring_mask);
+    u->sq_array = (unsigned int *)((char *)u->sq_ring_ptr + p.sq_off.array);
+    u->cq_head  = (unsigned int *)((char *)u->cq_ring_ptr + p.cq_off.head);
+    u->cq_tail  = (unsigned int *)((char *)u->cq_ring_ptr + p.cq_off.tail);
+    u->cq_mask  = (unsigned int *)((char *)u->cq_ring_ptr + p.cq_off.ring_mask);
+    u->cqes     = (struct io_uring_cqe *)((char *)u->cq_ring_ptr + p.cq_off.cqes);
+
+    struct iovec iov[URING_NUM_BUFS];
+    for (int i = 0; i < URING_NUM_BUFS; i++) {
+        if (posix_memalign((void **)&u->buf[i], 4096, URING_BUF_SIZE) != 0) {
+            u->buf[i] = NULL;
+        }
+        iov[i].iov_base = u->buf[i];
+        iov[i].iov_len = URING_BUF_SIZE;
+    }
+    for (int i = 0; i < URING_NUM_BUFS; i++) {
+        if (u->buf[i] == NULL) {
+            return -1;
+        }
+    }
+    if (syscall(__NR_io_uring_register, u->ring_fd, IORING_REGISTER_BUFFERS,
+                iov, URING_NUM_BUFS) != 0) {
+        return -1;
     }
-}
 
+    return 0;
+}
 
-int lesser_queue(int ql, int qr, struct tourn_tree *t_tree, const struct thread_queues *tqs) {
+static void uring_writer_free(struct uring_writer *u) {
+    for (int i = 0; i < URING_NUM_BUFS; i++) {
+        free(u->buf[i]);
+        u->buf[i] = NULL;
+    }
+    if ((u->sqes != NULL) && (u->sqes != MAP_FAILED)) {
+        munmap(u->sqes, u->sqes_sz);
+    }
+    if ((u->cq_ring_ptr != NULL) && (u->cq_ring_ptr != MAP_FAILED)
+        && (u->cq_ring_ptr != u->sq_ring_ptr)) {
+        munmap(u->cq_ring_ptr, u->cq_ring_sz);
+    }
+    if ((u->sq_ring_ptr != NULL) && (u->sq_ring_ptr != MAP_FAILED)) {
+        munmap(u->sq_ring_ptr, u->sq_ring_sz);
+    }
+    if (u->ring_fd >= 0) {
+        close(u->ring_fd);
+    }
+}
 
-    if (queue_less(ql, qr, t_tree, tqs) == 1) {
-        return ql;
+/*
+ * points the writer at the (just opened or just rotated) output file;
+ * any stdio-buffered bytes, like a pcap file header, are flushed first
+ * so raw writes can't pass them
+ */
+static void uring_writer_set_file(struct uring_writer *u, FILE *f) {
+    fflush(f);
+    u->fd = fileno(f);
+
+    struct stat st;
+    if ((fstat(u->fd, &st) == 0) && S_ISREG(st.st_mode)) {
+        u->use_offset = 1;
+        u->off = lseek(u->fd, 0, SEEK_CUR);
     } else {
-        return qr;
+        u->use_offset = 0;
+        u->off = 0;
     }
 }
 
+/*
+ * processes any available completions, freeing their staging buffers;
+ * if wait is nonzero, blocks until at least one completion arrives
+ */
+static void uring_reap(struct uring_writer *u, int wait) {
+    if (wait && (u->num_inflight > 0)) {
+        if (syscall(__NR_io_uring_enter, u->ring_fd, 0, 1,
+                    IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+            perror("error: io_uring_enter (wait)");
+        }
+    }
 
-void run_tourn_for_queue(struct tourn_tree *t_tree, int q, const struct thread_queues *tqs) {
+    unsigned int head = *u->cq_head;
+    while (head != *(volatile unsigned int *)u->cq_tail) {
+        __sync_synchronize();  /* read the cqe only after seeing the tail */
+        struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+        int b = (int)cqe->user_data;
+
+        if (cqe->res < 0) {
+            fprintf(stderr, "error: asynchronous output write failed: %s\n", strerror(-cqe->res));
+        } else if ((size_t)cqe->res < u->buf_len[b]) {
+            /* short write; finish the buffer off synchronously */
+            size_t done = cqe->res;
+            while (done < u->buf_len[b]) {
+                ssize_t n;
+                if (u->use_offset) {
+                    n = pwrite(u->fd, u->buf[b] + done, u->buf_len[b] - done, u->buf_off[b] + done);
+                } else {
+                    n = write(u->fd, u->buf[b] + done, u->buf_len[b] - done);
+                }
+                if (n <= 0) {
+                    perror("error: could not complete short output write");
+                    break;
+                }
+                done += n;
+            }
+        }
 
-    /*
-     * The leaf index in the tree for a particular queue
-     * is the queue's index in the tree minus 1 (or 2) divided by 2
-     * however we don't bother to store the bottem-most layer in the
-     * the tree and also, by clearing the least significant bit in
-     * the q number we can reduce the minus 1 or 2 to just minus 1.
-     */
+        u->buf_inflight[b] = 0;
+        u->num_inflight--;
+        head++;
+    }
+    __sync_synchronize();  /* finish reading cqes before giving them back */
+    *u->cq_head = head;
+}
 
-    int ql = (q % 2 == 0)? q : q - 1; /* the even q is (l)eft */
-    int qr = ql + 1;                  /* the odd q is (r)ight */
-    int lidx = ((ql + t_tree->qp2) - 1) / 2;
+/*
+ * submits the current staging buffer for writing and picks the next
+ * free buffer to fill, waiting on a completion if all are in flight
+ */
+static void uring_submit_cur(struct uring_writer *u) {
+    int b = u->cur;
 
-    t_tree->tree[lidx] = lesser_queue(ql, qr, t_tree, tqs);
+    if (u->cur_len == 0) {
+        return;
+    }
 
-    /* This "walks" back up the tree to the root node (0) */
-    while (lidx > 0) {
-        lidx = (lidx - 1) / 2; /* Up up a level in the tree */
-        ql = t_tree->tree[(lidx * 2) + 1]; /* (l)eft child queue */
-        qr = t_tree->tree[(lidx * 2) + 2]; /* (r)ight child queue */
+    unsigned int tail = *u->sq_tail;
+    unsigned int idx = tail & *u->sq_mask;
+    struct io_uring_sqe *sqe = &u->sqes[idx];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->fd = u->fd;
+    sqe->addr = (unsigned long)u->buf[b];
+    sqe->len = u->cur_len;
+    sqe->off = u->use_offset ? (uint64_t)u->off : (uint64_t)-1;
+    sqe->buf_index = b;
+    sqe->user_data = b;
+    u->sq_array[idx] = idx;
+    __sync_synchronize();  /* the sqe must be visible before the tail moves */
+    *u->sq_tail = tail + 1;
+    __sync_synchronize();
+
+    if (syscall(__NR_io_uring_enter, u->ring_fd, 1, 0, 0, NULL, 0) < 0) {
+        perror("error: io_uring_enter (submit)");
+    }
 
-        /* Run the tournament between ql and qr */
-        t_tree->tree[lidx] = lesser_queue(ql, qr, t_tree, tqs);
+    u->buf_len[b] = u->cur_len;
+    u->buf_off[b] = u->off;
+    u->buf_inflight[b] = 1;
+    u->num_inflight++;
+    if (u->use_offset) {
+        u->off += u->cur_len;
     }
-}
 
+    /* find a free buffer to keep filling */
+    for (;;) {
+        uring_reap(u, 0);
+        for (int i = 0; i < URING_NUM_BUFS; i++) {
+            if (u->buf_inflight[i] == 0) {
+                u->cur = i;
+                u->cur_len = 0;
+                return;
+            }
+        }
+        uring_reap(u, 1);  /* all buffers in flight; wait for one */
+    }
+}
 
+/* copies a message into the staging buffers, submitting as they fill */
+static void uring_write(struct uring_writer *u, const char *data, size_t len) {
+    while (len > 0) {
+        size_t avail = URING_BUF_SIZE - u->cur_len;
+        if (avail == 0) {
+            uring_submit_cur(u);
+            continue;
+        }
+        size_t n = (len < avail) ? len : avail;
+        memcpy(u->buf[u->cur] + u->cur_len, data, n);
+        u->cur_len += n;
+        data += n;
+        len -= n;
+    }
+}
 
-void run_tourn_for_entire_tree(struct tourn_tree *t_tree, const struct thread_queues *tqs) {
+/* submits anything buffered and waits until every write has completed */
+static void uring_drain(struct uring_writer *u) {
+    uring_submit_cur(u);
+    while (u->num_inflight > 0) {
+        uring_reap(u, 1);
+    }
+}
 
-    /* We can run the tournament faster for the entire tree by
-     * visiting each index in the tree once rather than running
-     * the tournament for each queue because that will re-visit
-     * the top of the tree over and over.
-     */
+#endif /* HAVE_IO_URING */
 
-    int ql, qr, lidx;
 
-    /* First run the tournament for each pair to fill in the bottom
-     * row of the tree
-     */
-    for (ql = 0; ql < tqs->qnum; ql += 2) {
-        qr = ql + 1;
-        lidx = ((ql + t_tree->qp2) - 1) / 2;
+/*
+ * writes a gathered batch of records with writev(); any stdio-buffered
+ * bytes (a pcap file header, or records from the flush-old-messages
+ * path) are pushed out first so the batch can't pass them
+ */
+static void writev_batch(FILE *f, struct iovec *iov, int iovcnt) {
+    size_t batch_bytes = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        batch_bytes += iov[i].iov_len;
+    }
+    mercury_probe2(output_write, batch_bytes, iovcnt);
+    fflush(f);
+    int fd = fileno(f);
+    while (iovcnt > 0) {
+        ssize_t n = writev(fd, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("error: could not write output record batch");
+            return;
+        }
+        while ((iovcnt > 0) && (n >= (ssize_t)iov[0].iov_len)) {
+            n -= iov[0].iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov[0].iov_base = (char *)iov[0].iov_base + n;
+            iov[0].iov_len -= n;
+        }
+    }
+}
 
-        t_tree->tree[lidx] = lesser_queue(ql, qr, t_tree, tqs);
+/*
+ * writes out the gathered writev batch, if any, and retires every
+ * record it referenced; in the gzip and io_uring modes the batch is
+ * always empty and this is a no-op
+ */
+static void flush_writev_pending(struct output_file *out_ctx, struct iovec *iov, int *iovcnt,
+                                 struct llq_msg **pending) {
+    struct thread_queues *qs = (out_ctx->shared != NULL) ? &out_ctx->shared->qs : &out_ctx->qs;
+    if (*iovcnt > 0) {
+        writev_batch(out_ctx->file, iov, *iovcnt);
+        *iovcnt = 0;
+    }
+    for (int q = 0; q < qs->qnum; q++) {
+        if (pending[q] != NULL) {
+            llq_consume(&qs->queue[q], pending[q]);
+            pending[q] = NULL;
+        }
     }
+}
 
-    /* Now we can run through each tree index once */
-    for (lidx = (t_tree->qp2 / 2) - 2; lidx >= 0; lidx--) {
-        ql = t_tree->tree[(lidx * 2) + 1]; /* (l)eft child queue */
-        qr = t_tree->tree[(lidx * 2) + 2]; /* (r)ight child queue */
 
-        t_tree->tree[lidx] = lesser_queue(ql, qr, t_tree, tqs);
-    }
+/*
+ * A network sink (--output-sink) streams records to a collector over
+ * a TCP or UNIX-socket connection, with no disk I/O; the spec is
+ * either "tcp:host:port" or "unix:path".  Unsent bytes sit in a
+ * bounded buffer that is flushed with nonblocking send()s, so a slow
+ * or absent collector costs record drops here instead of stalling the
+ * merge, and a lost connection is re-dialed at most once per second.
+ */
 
+#define SINK_BUF_SIZE (4 * 1024 * 1024)
 
-}
+struct sink_writer {
+    int fd;                 /* the connected socket, or -1 */
+    const char *spec;       /* "tcp:host:port" or "unix:path" */
+    char *buf;              /* unsent bytes, between off and off+len */
+    size_t off;
+    size_t len;
+    uint64_t drops;         /* records dropped because the buffer was full */
+    time_t last_attempt;    /* reconnects are rate-limited to one per second */
+};
 
+/*
+ * dials the sink; the connect is nonblocking with a short poll() so
+ * that a dead collector costs milliseconds per attempt, not a TCP
+ * connect timeout.  Returns the socket, or -1.
+ */
+static int sink_connect(const char *spec) {
+    int fd = -1;
 
-void debug_print_tour_tree(struct tourn_tree *t_tree, const struct thread_queues *tqs) {
+    if (strncmp(spec, "unix:", 5) == 0) {
+        struct sockaddr_un addr;
+        const char *path = spec + 5;
 
-    fprintf(stderr, "Tourn Tree size: %d\n", (t_tree->qp2 - 1));
-    int i = 0;
-    int l = 2;
-    while (i < (t_tree->qp2 - 1)) {
-        for (; i < l - 1; i++) {
-            fprintf(stderr, "%d ", t_tree->tree[i]);
+        if (strlen(path) >= sizeof(addr.sun_path)) {
+            fprintf(stderr, "error: UNIX socket path too long in sink %s\n", spec);
+            return -1;
+        }
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            return -1;
         }
-        fprintf(stderr, "\n");
-        l *= 2;
+    } else if (strncmp(spec, "tcp:", 4) == 0) {
+        char host[MAX_FILENAME];
+        strncpy(host, spec + 4, sizeof(host) - 1);
+        host[sizeof(host) - 1] = '\0';
+        char *port = strrchr(host, ':');
+        if (port == NULL) {
+            fprintf(stderr, "error: no port in sink %s\n", spec);
+            return -1;
+        }
+        *port++ = '\0';
+
+        struct addrinfo hints, *res;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host, port, &hints, &res) != 0) {
+            return -1;
+        }
+        for (struct addrinfo *ai = res; ai != NULL; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) {
+                continue;
+            }
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+                break;
+            }
+            if (errno == EINPROGRESS) {
+                struct pollfd pfd = { fd, POLLOUT, 0 };
+                int so_error = 0;
+                socklen_t so_len = sizeof(so_error);
+                if ((poll(&pfd, 1, 10 /* ms */) == 1)
+                    && (getsockopt(fd, SOL_SOCKET, SO_ERROR, &so_error, &so_len) == 0)
+                    && (so_error == 0)) {
+                    break;
+                }
+            }
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(res);
+    } else {
+        fprintf(stderr, "error: sink %s is neither tcp:host:port nor unix:path\n", spec);
+        return -1;
+    }
+
+    if (fd >= 0) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
     }
+    return fd;
+}
 
-    fprintf(stderr, "Ready queues:\n");
-    for (int q = 0; q < t_tree->qnum; q++) {
-        if (tqs->queue[q].msgs[tqs->queue[q].ridx].used == 1) {
-            fprintf(stderr, "%d ", q);
+static int sink_writer_init(struct sink_writer *s, const char *spec) {
+    s->spec = spec;
+    s->buf = (char *)malloc(SINK_BUF_SIZE);
+    if (s->buf == NULL) {
+        fprintf(stderr, "error: could not allocate sink buffer\n");
+        return -1;
+    }
+    s->off = 0;
+    s->len = 0;
+    s->drops = 0;
+    s->last_attempt = time(NULL);
+    s->fd = sink_connect(spec);
+    if (s->fd < 0) {
+        /* tolerated: the collector may come up after we do; buffer
+         * and keep re-dialing */
+        fprintf(stderr, "warning: could not connect to sink %s; will retry\n", spec);
+    }
+    return 0;
+}
+
+/* sends as much buffered data as the socket will take right now */
+static void sink_flush(struct sink_writer *s) {
+    if (s->fd < 0) {
+        time_t now = time(NULL);
+        if (now == s->last_attempt) {
+            return;
+        }
+        s->last_attempt = now;
+        s->fd = sink_connect(s->spec);
+        if (s->fd < 0) {
+            return;
+        }
+    }
+    while (s->len > 0) {
+        ssize_t n = send(s->fd, s->buf + s->off, s->len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+                close(s->fd);   /* connection lost; re-dialed on a later flush */
+                s->fd = -1;
+            }
+            break;
+        }
+        s->off += n;
+        s->len -= n;
+    }
+    if (s->len == 0) {
+        s->off = 0;
+    }
+}
+
+/* appends one record to the sink buffer, or drops it if full */
+static void sink_write(struct sink_writer *s, const char *data, size_t len) {
+    if (s->off + s->len + len > SINK_BUF_SIZE) {
+        if (s->off > 0) {
+            memmove(s->buf, s->buf + s->off, s->len);   /* reclaim the sent prefix */
+            s->off = 0;
+        }
+        if (s->len + len > SINK_BUF_SIZE) {
+            sink_flush(s);
+            if (s->len + len > SINK_BUF_SIZE) {
+                s->drops++;   /* records are dropped whole, never truncated */
+                return;
+            }
         }
     }
-    fprintf(stderr, "\n");
+    memcpy(s->buf + s->off + s->len, data, len);
+    s->len += len;
 }
 
+static void sink_writer_free(struct sink_writer *s) {
+    sink_flush(s);
+    if (s->len > 0) {
+        fprintf(stderr, "warning: %zu unsent bytes discarded at sink shutdown\n", s->len);
+    }
+    if (s->drops > 0) {
+        fprintf(stderr, "warning: %" PRIu64 " records dropped at full sink buffer\n", s->drops);
+    }
+    if (s->fd >= 0) {
+        close(s->fd);
+    }
+    free(s->buf);
+}
+
+
 enum status output_file_rotate(struct output_file *ojf) {
     char outfile[MAX_FILENAME];
 
+    ojf->qs.rotations++;   /* counts the initial open as well */
+
     if (ojf->type == file_type_stdout) {
         ojf->file = stdout;
+        if (ojf->gzip && (ojf->gzfile == NULL)) {
+            /* the dup() lets gzclose() run without closing stdout itself */
+            ojf->gzfile = gzdopen(dup(fileno(stdout)), "w");
+            if (ojf->gzfile == NULL) {
+                fprintf(stderr, "error: could not attach gzip stream to stdout\n");
+                return status_err;
+            }
+        }
         return status_ok;
     }
 
-    if (ojf->file) {
+    if (ojf->gzip) {
+        if (ojf->gzfile) {
+            /* this flushes and finishes the gzip stream, so each
+             * rotated file is a complete, independently-readable one */
+            if (gzclose(ojf->gzfile) != Z_OK) {
+                fprintf(stderr, "error: could not close gzip output file\n");
+            }
+            ojf->gzfile = NULL;
+        }
+    } else if (ojf->file) {
         // printf("rotating output file\n");
 
+        if (ojf->index_file != NULL) {
+            /* finish this file's flow index before the file closes */
+            pcap_index_drain(ojf->index_file, ojf->index_table);
+            if (fclose(ojf->index_file) != 0) {
+                perror("could not close flow index file");
+            }
+            ojf->index_file = NULL;
+        }
         if (fclose(ojf->file) != 0) {
             perror("could not close json file");
         }
@@ -261,6 +788,27 @@ enum status output_file_rotate(struct output_file *ojf) {
         strncpy(outfile, ojf->outfile_name, MAX_FILENAME - 1);
     }
 
+    if (ojf->gzip) {
+        enum status status = filename_append(outfile, outfile, ".", "gz");
+        if (status) {
+            return status;
+        }
+        ojf->gzfile = gzopen(outfile, ojf->mode);
+        if (ojf->gzfile == NULL) {
+            perror("error: could not open gzip fingerprint output file");
+            return status_err;
+        }
+        if (ojf->type == file_type_pcap) {
+            /* the gzip stream is finished at each rotation, so every
+             * rotated file is a complete compressed pcap file */
+            if (gzwrite_pcap_file_header(ojf->gzfile) != status_ok) {
+                return status_err;
+            }
+        }
+        ojf->record_countdown = ojf->max_records;
+        return status_ok;
+    }
+
     ojf->file = fopen(outfile, ojf->mode);
     if (ojf->file == NULL) {
         perror("error: could not open fingerprint output file");
@@ -272,6 +820,38 @@ enum status output_file_rotate(struct output_file *ojf) {
             perror("error: could not write pcap file header");
             return status_err;
         }
+
+        /*
+         * with --pcap-index, each (rotated) pcap file gets its own
+         * flow index sidecar; on any failure the pcap file is still
+         * written, just without an index
+         */
+        if (global_vars.pcap_index) {
+            char index_name[MAX_FILENAME + 8];
+            snprintf(index_name, sizeof(index_name), "%s.idx", outfile);
+            ojf->index_file = fopen(index_name, "w");
+            if (ojf->index_file == NULL) {
+                fprintf(stderr, "%s: warning: could not open flow index file %s\n", strerror(errno), index_name);
+            } else {
+                struct pcap_index_hdr index_hdr = { PCAP_INDEX_MAGIC, PCAP_INDEX_VERSION };
+                if (fwrite(&index_hdr, sizeof(index_hdr), 1, ojf->index_file) == 0) {
+                    fprintf(stderr, "warning: could not write flow index file header for %s\n", index_name);
+                    fclose(ojf->index_file);
+                    ojf->index_file = NULL;
+                }
+            }
+            if (ojf->index_file != NULL && ojf->index_table == NULL) {
+                ojf->index_table = (struct pcap_index_extent *)calloc(PCAP_INDEX_TABLE_LENGTH, sizeof(struct pcap_index_extent));
+                if (ojf->index_table == NULL) {
+                    fprintf(stderr, "warning: could not malloc flow index table for %s\n", index_name);
+                    fclose(ojf->index_file);
+                    ojf->index_file = NULL;
+                }
+            }
+            if (ojf->index_file != NULL) {
+                ojf->index_offset = ftell(ojf->file);   /* records start after the pcap file header */
+            }
+        }
     }
 
     ojf->record_countdown = ojf->max_records;
@@ -283,20 +863,26 @@ void *output_thread_func(void *arg) {
 
     struct output_file *out_ctx = (struct output_file *)arg;
 
+    /* with --output-threads, a secondary shard shares the primary
+     * context's queues, start condition, and stop signal, and keeps
+     * only its own file state and statistics; without sharding,
+     * shared is the context itself and nothing changes */
+    struct output_file *shared = (out_ctx->shared != NULL) ? out_ctx->shared : out_ctx;
+
     int err;
-    err = pthread_mutex_lock(&(out_ctx->t_output_m));
+    err = pthread_mutex_lock(&(shared->t_output_m));
     if (err != 0) {
         fprintf(stderr, "%s: error locking output start mutex for stats thread\n", strerror(err));
         exit(255);
     }
-    while (out_ctx->t_output_p != 1) {
-        err = pthread_cond_wait(&(out_ctx->t_output_c), &(out_ctx->t_output_m));
+    while (shared->t_output_p != 1) {
+        err = pthread_cond_wait(&(shared->t_output_c), &(shared->t_output_m));
         if (err != 0) {
             fprintf(stderr, "%s: error waiting on output start condition for stats thread\n", strerror(err));
             exit(255);
         }
     }
-    err = pthread_mutex_unlock(&(out_ctx->t_output_m));
+    err = pthread_mutex_unlock(&(shared->t_output_m));
     if (err != 0) {
         fprintf(stderr, "%s: error unlocking output start mutex for stats thread\n", strerror(err));
         exit(255);
@@ -305,181 +891,303 @@ void *output_thread_func(void *arg) {
     // note: we wait until we get an output start condition before we
     // open any output files, so that drop_privileges() can be called
     // before file creation
-    enum status status = output_file_rotate(out_ctx);
-    if (status != status_ok) {
-        exit(EXIT_FAILURE);
+    int use_sink = 0;
+    struct sink_writer sw;
+    if (out_ctx->type == file_type_sink) {
+        if (sink_writer_init(&sw, out_ctx->outfile_name) != 0) {
+            exit(EXIT_FAILURE);
+        }
+        use_sink = 1;
+    } else {
+        enum status status = output_file_rotate(out_ctx);
+        if (status != status_ok) {
+            exit(EXIT_FAILURE);
+        }
     }
 
-    /* This output thread uses a "tournament tree" algorithm
-     * to perform a k-way merge of the lockless queues.
-     *
-     * https://en.wikipedia.org/wiki/Tournament_sort
-     * https://www.geeksforgeeks.org/tournament-tree-and-binary-heap/
-     * https://en.wikipedia.org/wiki/Priority_queue
-     *
-     * The actual algorithm is virtually identical to a priority queue
-     * with the caveat that instead of swapping elements in an array
-     * the priority queue just tracks a tree if of the "winning" queue
-     * index.  In this algorithm "winning" is the oldest message.
-     *
-     * This algorithm is very efficient because it leaves messages in
-     * the lockless queue until they are ready to be sent to output
-     * intsead of making copies of messages and throwing them in a
-     * priority queue.
-     *
-     * One "gotcha" about the usual k-way merge with a tournament tree
-     * is that we're reading messages out of the lockless queues in
-     * real-time as the queues are being filled.  This means not all
-     * queues will always have a message in them which means we can't
-     * really run the tournament properly because we don't know the
-     * timestamp of the next message that queue will have when a
-     * message finally arrives.
-     *
-     * To avoid things getting out-of-order the output thread won't
-     * run a tournament until either 1) all queues have a message in
-     * them, or 2) one of the queues has a message older than
-     * LLQ_MAX_AGE (5 seconds by default).
-     *
-     * This means that as long as no queue pauses for more than 5
-     * seconds the k-way merge will be perfectly in-order.  If a queue
-     * does pause for more than 5 seconds only messages older than 5
-     * seconds will be flushed.
+    /* Writes go through io_uring when the kernel supports it (and the
+     * output isn't stdout, which needs strict ordering on a pipe);
+     * otherwise they fall back to plain fwrite().
+     */
+#ifdef HAVE_IO_URING
+    int use_uring = 0;
+    struct uring_writer uw;
+    if ((out_ctx->type != file_type_stdout) && (out_ctx->type != file_type_sink) && (out_ctx->gzip == false)) {
+        if (uring_writer_init(&uw) == 0) {
+            use_uring = 1;
+            uring_writer_set_file(&uw, out_ctx->file);
+        } else {
+            uring_writer_free(&uw);
+        }
+    }
+#endif
+
+    /*
+     * The per-worker queues are merged with an epoch-batched loser
+     * tree; see the comments above struct loser_tree.  Each pass
+     * computes a watermark --output-max-age in the past, hides
+     * records newer than that, and merges everything older in one run
+     * of the tree, so an empty queue never forces a stall or a full
+     * rescan; a pass with a queue past its flush fraction merges
+     * without the watermark.
+     * Once the stop signal arrives the producers have already been
+     * joined, so the watermark is dropped and the queues are drained
+     * completely.
      *
-     * The other big assumption is that each lockless queue is in
-     * perfect order.  Testing shows that rarely, packets can be
-     * out-of-order by a few microseconds in a lockless queue.  This
-     * may be the fault of tiny clock abnormalities, could be machine
-     * dependant, or ethernet card dependant.  The exact situations
-     * where packets can be recieved out of cronological order aren't
-     * known (to me anyways).
+     * Each lockless queue is assumed to be in order.  Testing shows
+     * that rarely, packets can be out-of-order by a few microseconds
+     * within a queue.  This may be the fault of tiny clock
+     * abnormalities, could be machine dependant, or ethernet card
+     * dependant; such records pass through the merge unreordered.
      */
 
-    struct tourn_tree t_tree;
-    t_tree.qnum = out_ctx->qs.qnum;
-    t_tree.qp2 = 2; /* This is the smallest power of 2 >= the number of queues */
-    while (t_tree.qp2 < t_tree.qnum) {
-        t_tree.qp2 *= 2;
+    struct loser_tree lt;
+    lt.qnum = shared->qs.qnum;
+    lt.qp2 = 1; /* This is the smallest power of 2 >= the number of queues */
+    while (lt.qp2 < lt.qnum) {
+        lt.qp2 *= 2;
     }
-    t_tree.tree = (int *)calloc(t_tree.qp2 - 1, sizeof(int)); /* The tournament needs qp2 - 1 nodes */
-    if (t_tree.tree == NULL) {
-        fprintf(stderr, "Failed to allocate enough memory for the tournament tree\n");
+    lt.node = (int *)calloc(lt.qp2, sizeof(int));
+    lt.head = (struct llq_msg **)calloc(lt.qnum, sizeof(struct llq_msg *));
+    int *winner = (int *)calloc(2 * lt.qp2, sizeof(int));           /* lt_build() scratch space */
+    struct llq_msg **pending = (struct llq_msg **)calloc(lt.qnum, sizeof(struct llq_msg *));
+    if ((lt.node == NULL) || (lt.head == NULL) || (winner == NULL) || (pending == NULL)) {
+        fprintf(stderr, "Failed to allocate enough memory for the loser tree\n");
         exit(255);
     }
-    for (int i = 0; i < (t_tree.qp2 - 1); i++) {
-        t_tree.tree[i] = -1;
-    }
-
-    int all_output_flushed = 0;
-    while (all_output_flushed == 0) {
 
-        /* Bring the tree up-to-date */
-        t_tree.stalled = 0;
-        run_tourn_for_entire_tree(&t_tree, &out_ctx->qs);
-        //for (int q = 0; q < t_tree.qp2; q += 2) {
-        //run_tourn_for_queue(&t_tree, q, &out_ctx->qs);
-        //}
+    struct iovec iov[OUTPUT_WRITEV_IOVECS];
+    int iovcnt = 0;
 
-        /* This loop runs the tournament as long as the tree
-         * isn't "stalled".  A stalled tree means at least
-         * one of the lockless queues is currenty empty.
-         */
-
-        int wq; /* winning queue */
-        while (t_tree.stalled == 0) {
-            wq = t_tree.tree[0]; /* the root node is always the winning queue */
+    /* the merge watermark (--output-max-age), in nanoseconds */
+    uint64_t epoch_nsec = (uint64_t)global_vars.output_max_age_ms * 1000000;
 
-            struct llq_msg *wmsg = &(out_ctx->qs.queue[wq].msgs[out_ctx->qs.queue[wq].ridx]);
-            if (wmsg->used == 1) {
-                fwrite(wmsg->buf, wmsg->len, 1, out_ctx->file);
+    int all_output_flushed = 0;
+    while (all_output_flushed == 0) {
 
-                /* A full memory barrier prevents the following flag (un)set from happening too soon */
-                __sync_synchronize();
-                wmsg->used = 0;
+        /* records older than the watermark are merged in this pass;
+         * the pass time is also the write timestamp used for the
+         * latency histogram, which overstates each record's latency
+         * by at most the duration of the pass */
+        struct timespec cutoff, now;
+        if (clock_gettime(CLOCK_REALTIME, &cutoff) != 0) {
+            perror("Unable to get current time");
+        }
+        now = cutoff;
+        cutoff.tv_sec -= (time_t)(epoch_nsec / 1000000000);
+        cutoff.tv_nsec -= (long)(epoch_nsec % 1000000000);
+        if (cutoff.tv_nsec < 0) {
+            cutoff.tv_nsec += 1000000000;
+            cutoff.tv_sec -= 1;
+        }
 
-                /* Handle rotating file if needed */
-                if (output_file_needs_rotation(out_ctx)) {
-                    output_file_rotate(out_ctx);
-                }
+        /* once the stop signal is set the producers have exited, so
+         * everything left in the queues can be merged regardless of
+         * the watermark; a queue filling past its flush fraction has
+         * the same effect for one pass, so a burst is absorbed by
+         * writing sooner instead of by dropping at a full ring */
+        int drain_all = shared->sig_stop_output;
+        int merge_all = drain_all;
+        for (int q = 0; (merge_all == 0) && (q < lt.qnum); q++) {
+            if (shard_owns_queue(out_ctx, q)
+                && (llq_bytes_used(&shared->qs.queue[q]) > LLQ_BUF_SIZE / LLQ_FLUSH_FILL_FRACTION)) {
+                merge_all = 1;
+            }
+        }
 
-                out_ctx->qs.queue[wq].ridx = (out_ctx->qs.queue[wq].ridx + 1) % LLQ_DEPTH;
+        /* the timestamp of the oldest record hidden this pass, which
+         * determines how long the thread can sleep afterwards */
+        struct timespec next_hidden = { 0, 0 };
+        int have_hidden = 0;
 
-                run_tourn_for_queue(&t_tree, wq, &out_ctx->qs);
+        for (int q = 0; q < lt.qnum; q++) {
+            if (shard_owns_queue(out_ctx, q) == 0) {
+                lt.head[q] = NULL;   /* another shard's queue; never merged here */
+                continue;
             }
-            else {
-                break;
+            struct llq_msg *m = llq_peek(&shared->qs.queue[q]);
+            if ((m != NULL) && (merge_all == 0) && (time_less(&(m->ts), &cutoff) == 0)) {
+                if ((have_hidden == 0) || time_less(&(m->ts), &next_hidden)) {
+                    next_hidden = m->ts;
+                    have_hidden = 1;
+                }
+                m = NULL;   /* not yet eligible; hidden until a later pass */
             }
-
-        }
-
-        /* The tree is now stalled because a queue has been emptied
-         * Now we must remove messages as long as they are "too old"
-         */
-        struct timespec old_ts;
-        if (clock_gettime(CLOCK_REALTIME, &old_ts) != 0) {
-            perror("Unable to get current time");
+            lt.head[q] = m;
         }
+        lt_build(&lt, winner);
 
-        /* This is the time we compare against to flush */
-        old_ts.tv_sec -= LLQ_MAX_AGE;
-
-        /* This loop runs the tournament even though the tree is stalled
-         * but only pull messages out of queues that are older than
-         * LLQ_MAX_AGE (currently set to 5 seconds).
-         */
-
-        int old_done = 0;
-        while (old_done == 0) {
-            wq = t_tree.tree[0];
-
-            struct llq_msg *wmsg = &(out_ctx->qs.queue[wq].msgs[out_ctx->qs.queue[wq].ridx]);
-            if (wmsg->used == 0) {
-                /* Even the top queue has nothing so we can just stop now */
-                old_done = 1;
-
-                /* This is how we detect no more output is coming */
-                if (out_ctx->sig_stop_output != 0) {
-                    all_output_flushed = 1;
+        int wq; /* winning queue */
+        while (((wq = lt.node[0]) >= 0) && (lt.head[wq] != NULL)) {
+            struct llq_msg *wmsg = lt.head[wq];
+            mercury_probe2(merge_winner, wq, wmsg->len);
+
+            /* capture-to-write latency; a record timestamped after
+             * "now" (clock skew, or a replayed capture) counts as zero */
+            if (time_less(&(wmsg->ts), &now)) {
+                uint64_t latency_nsec = (uint64_t)(now.tv_sec - wmsg->ts.tv_sec) * 1000000000
+                    + now.tv_nsec - wmsg->ts.tv_nsec;
+                latency_histogram_add(&out_ctx->qs.latency, latency_nsec);
+            } else {
+                latency_histogram_add(&out_ctx->qs.latency, 0);
+            }
+            out_ctx->qs.records_written++;   /* every winner reaches its destination this pass */
+
+            if (out_ctx->index_file != NULL) {
+                /* each queued pcap message is one packet record: a
+                 * 16-byte record header, then the packet data */
+                if (wmsg->len > 16) {
+                    pcap_index_note(out_ctx->index_file, out_ctx->index_table,
+                                    (uint8_t *)llq_msg_buf(wmsg) + 16, wmsg->len - 16,
+                                    out_ctx->index_offset, wmsg->len);
                 }
+                out_ctx->index_offset += wmsg->len;
+            }
 
-                break;
-            } else if (time_less(&(wmsg->ts), &old_ts) == 1) {
-                //fprintf(stderr, "DEBUG: writing old message from queue %d\n", wq);
-                fwrite(wmsg->buf, wmsg->len, 1, out_ctx->file);
-
-                /* A full memory barrier prevents the following flag (un)set from happening too soon */
-                __sync_synchronize();
-                wmsg->used = 0;
+            if (use_sink) {
+                mercury_probe2(output_write, wmsg->len, 1);
+                sink_write(&sw, llq_msg_buf(wmsg), wmsg->len);
+                llq_consume(&shared->qs.queue[wq], wmsg);
+                lt.head[wq] = llq_peek(&shared->qs.queue[wq]);
+            } else if (out_ctx->gzip) {
+                mercury_probe2(output_write, wmsg->len, 1);
+                gzwrite(out_ctx->gzfile, llq_msg_buf(wmsg), wmsg->len);
+                llq_consume(&shared->qs.queue[wq], wmsg);
+                lt.head[wq] = llq_peek(&shared->qs.queue[wq]);
+            } else
+#ifdef HAVE_IO_URING
+            if (use_uring) {
+                mercury_probe2(output_write, wmsg->len, 1);
+                uring_write(&uw, llq_msg_buf(wmsg), wmsg->len);
+                llq_consume(&shared->qs.queue[wq], wmsg);
+                lt.head[wq] = llq_peek(&shared->qs.queue[wq]);
+            } else
+#endif
+            {
+                /* the record can't be retired until writev() has run,
+                 * so it joins the batch and its queue's pending
+                 * pointer advances instead */
+                iov[iovcnt].iov_base = llq_msg_buf(wmsg);
+                iov[iovcnt].iov_len = wmsg->len;
+                iovcnt++;
+                pending[wq] = wmsg;
+                lt.head[wq] = llq_peek_next(&shared->qs.queue[wq], wmsg);
+            }
+            if ((lt.head[wq] != NULL) && (merge_all == 0)
+                && (time_less(&(lt.head[wq]->ts), &cutoff) == 0)) {
+                if ((have_hidden == 0) || time_less(&(lt.head[wq]->ts), &next_hidden)) {
+                    next_hidden = lt.head[wq]->ts;
+                    have_hidden = 1;
+                }
+                lt.head[wq] = NULL;
+            }
 
-                /* Handle rotating file if needed */
-                if (output_file_needs_rotation(out_ctx)) {
-                    output_file_rotate(out_ctx);
+            /* Handle rotating file if needed (a sink has no fileset,
+             * and flushes itself when its buffer fills) */
+            if (use_sink) {
+                ;
+            } else if (output_file_needs_rotation(out_ctx)) {
+                flush_writev_pending(out_ctx, iov, &iovcnt, pending);
+#ifdef HAVE_IO_URING
+                if (use_uring) {
+                    uring_drain(&uw);  /* every write must land before the file closes */
+                }
+#endif
+                output_file_rotate(out_ctx);
+#ifdef HAVE_IO_URING
+                if (use_uring) {
+                    uring_writer_set_file(&uw, out_ctx->file);
                 }
+#endif
+            } else if (iovcnt == OUTPUT_WRITEV_IOVECS) {
+                flush_writev_pending(out_ctx, iov, &iovcnt, pending);
+            }
+
+            lt_replay(&lt, wq);
+        }
+        flush_writev_pending(out_ctx, iov, &iovcnt, pending);
+        if (use_sink) {
+            sink_flush(&sw);   /* push this pass's records to the wire */
+        }
 
-                out_ctx->qs.queue[wq].ridx = (out_ctx->qs.queue[wq].ridx + 1) % LLQ_DEPTH;
+        if (drain_all) {
+            all_output_flushed = 1;
+            continue;
+        }
 
-                run_tourn_for_queue(&t_tree, wq, &out_ctx->qs);
+#ifdef HAVE_IO_URING
+        if (use_uring) {
+            /* submit anything staged so it isn't held while we sleep,
+             * and collect completions that have already arrived */
+            uring_submit_cur(&uw);
+            uring_reap(&uw, 0);
+        }
+#endif
+        /* sleep until the oldest hidden record ages past the
+         * watermark.  With nothing hidden, no record enqueued from
+         * here on can become eligible sooner than (most of) one epoch
+         * from now, so a full epoch is slept; the sleep is capped so
+         * that the stop signal and a sudden burst are still noticed
+         * promptly when the configured age bound is large. */
+        uint64_t sleep_nsec = epoch_nsec;
+        if (have_hidden) {
+            struct timespec expiry = next_hidden;
+            expiry.tv_sec += (time_t)(epoch_nsec / 1000000000);
+            expiry.tv_nsec += (long)(epoch_nsec % 1000000000);
+            if (expiry.tv_nsec >= 1000000000) {
+                expiry.tv_nsec -= 1000000000;
+                expiry.tv_sec += 1;
+            }
+            if (time_less(&now, &expiry)) {
+                sleep_nsec = (uint64_t)(expiry.tv_sec - now.tv_sec) * 1000000000
+                    + expiry.tv_nsec - now.tv_nsec;
             } else {
-                old_done = 1;
+                sleep_nsec = 0;   /* already due; merge again immediately */
             }
         }
-
-        /* This sleep slows us down so we don't spin the CPU.
-         * We probably could afford to call fflush() here
-         * the first time instead of sleeping and only sleep
-         * if we really aren't recieving any messages on
-         * any queues.
-         */
-        struct timespec sleep_ts;
-        sleep_ts.tv_sec = 0;
-        sleep_ts.tv_nsec = 1000000;
-        nanosleep(&sleep_ts, NULL);
+        if (sleep_nsec > LLQ_SLEEP_MAX_NSEC) {
+            sleep_nsec = LLQ_SLEEP_MAX_NSEC;
+        }
+        if (sleep_nsec > 0) {
+            struct timespec sleep_ts;
+            sleep_ts.tv_sec = sleep_nsec / 1000000000;
+            sleep_ts.tv_nsec = sleep_nsec % 1000000000;
+            nanosleep(&sleep_ts, NULL);
+        }
     } /* End all_output_flushed == 0 meaning we got a signal to stop */
 
-    if (t_tree.tree) {
-        free(t_tree.tree);
+    free(lt.node);
+    free(lt.head);
+    free(winner);
+    free(pending);
+
+#ifdef HAVE_IO_URING
+    if (use_uring) {
+        uring_drain(&uw);
+        uring_writer_free(&uw);
     }
-    if (fclose(out_ctx->file) != 0) {
-        perror("could not close json file");
+#endif
+    if (use_sink) {
+        sink_writer_free(&sw);
+    } else if (out_ctx->gzip) {
+        if (gzclose(out_ctx->gzfile) != Z_OK) {
+            fprintf(stderr, "error: could not close gzip output file\n");
+        }
+    } else {
+        if (out_ctx->index_file != NULL) {
+            pcap_index_drain(out_ctx->index_file, out_ctx->index_table);
+            if (fclose(out_ctx->index_file) != 0) {
+                perror("could not close flow index file");
+            }
+            out_ctx->index_file = NULL;
+        }
+        if (out_ctx->index_table != NULL) {
+            free(out_ctx->index_table);
+            out_ctx->index_table = NULL;
+        }
+        if (fclose(out_ctx->file) != 0) {
+            perror("could not close json file");
+        }
     }
 
     return NULL;
@@ -488,8 +1196,33 @@ void *output_thread_func(void *arg) {
 
 int output_thread_init(pthread_t &output_thread, struct output_file &out_ctx, const struct mercury_config &cfg) {
 
-    /* make the thread queues */
-    thread_queues_init(&out_ctx.qs, cfg.num_threads);
+    if (cfg.separate_files || pkt_proc_uses_ring_pcap_writer(&cfg)) {
+        /* each worker writes records directly into its own file (see
+         * pkt_proc_json_writer), or appends to the shared capture
+         * file from the ring (see pkt_proc_pcap_writer_ring), so no
+         * queues are allocated and no output thread is started; the
+         * start condition is still initialized, because the capture
+         * code signals it once privileges have been dropped */
+        out_ctx.qs.qnum = 0;
+        out_ctx.qs.queue = NULL;
+        if (pthread_cond_init(&(out_ctx.t_output_c), NULL) != 0) {
+            perror("Unabe to initialize output condition");
+            return -1;
+        }
+        if (pthread_mutex_init(&(out_ctx.t_output_m), NULL) != 0) {
+            perror("Unabe to initialize output mutex");
+            return -1;
+        }
+        out_ctx.t_output_p = 0;
+        out_ctx.file = NULL;
+        return 0;
+    }
+
+    /* make the thread queues; in the two-stage pipeline the producers
+     * are the serializer threads, one queue each, rather than the
+     * capture workers */
+    int producers = cfg.serialize_threads > 0 ? cfg.serialize_threads : cfg.num_threads;
+    thread_queues_init(&out_ctx.qs, producers, "output", "lockless queues");
 
     /* init the output context */
     if (pthread_cond_init(&(out_ctx.t_output_c), NULL) != 0) {
@@ -503,9 +1236,13 @@ int output_thread_init(pthread_t &output_thread, struct output_file &out_ctx, co
     out_ctx.t_output_p = 0;
 
     out_ctx.file = NULL;
+    out_ctx.gzfile = NULL;
     out_ctx.max_records = cfg.rotate;
     out_ctx.record_countdown = 0;
-    if (cfg.fingerprint_filename) {
+    if (cfg.output_sink) {
+        out_ctx.outfile_name = cfg.output_sink;
+        out_ctx.type = file_type_sink;
+    } else if (cfg.fingerprint_filename) {
         out_ctx.outfile_name = cfg.fingerprint_filename;
         out_ctx.type = file_type_json;
     } else if (cfg.write_filename) {
@@ -514,23 +1251,105 @@ int output_thread_init(pthread_t &output_thread, struct output_file &out_ctx, co
     } else {
         out_ctx.type = file_type_stdout;  // default output type
     }
+    out_ctx.gzip = cfg.gzip_output;
+    if (out_ctx.gzip && (out_ctx.type == file_type_pcap) && global_vars.pcap_index) {
+        fprintf(stderr, "warning: --pcap-index applies only to uncompressed pcap; no flow index written\n");
+    }
+    if (out_ctx.gzip && (out_ctx.type == file_type_sink)) {
+        fprintf(stderr, "warning: --gzip does not apply to --output-sink; streaming uncompressed records\n");
+        out_ctx.gzip = false;
+    }
     out_ctx.file_num = 0;
     out_ctx.mode = cfg.mode;
 
     //fprintf(stderr, "DEBUG: fingerprint filename: %s\n", cfg.fingerprint_filename);
     //fprintf(stderr, "DEBUG: max records: %ld\n", out_ctx.out_jf.max_records);
 
+    /* --output-threads: shard the ordered merge across several output
+     * threads, each merging its own round-robin share of the queues
+     * (see shard_owns_queue()) into its own file, so that output
+     * bandwidth scales with the shard count while ordering holds
+     * within each file.  Every shard's file, including the primary's,
+     * gets the shard number appended, the way --separate-files names
+     * per-thread files. */
+    int nshards = cfg.output_threads > 1 ? cfg.output_threads : 1;
+    if (nshards > producers) {
+        fprintf(stderr, "warning: --output-threads %d exceeds the %d producer queues; using %d\n",
+                nshards, producers, producers);
+        nshards = producers;
+    }
+    out_ctx.shard_count = nshards;
+    if (nshards > 1) {
+        out_ctx.shard = (struct output_file *)calloc(nshards - 1, sizeof(struct output_file));
+        out_ctx.shard_thread = (pthread_t *)calloc(nshards - 1, sizeof(pthread_t));
+        if ((out_ctx.shard == NULL) || (out_ctx.shard_thread == NULL)) {
+            fprintf(stderr, "error: could not allocate output shard contexts\n");
+            return -1;
+        }
+        const char *base_name = out_ctx.outfile_name;
+        char num_str[MAX_HEX];
+        snprintf(num_str, MAX_HEX, "%d", 0);
+        if (filename_append(out_ctx.shard_name, base_name, "-", num_str) != status_ok) {
+            return -1;
+        }
+        out_ctx.outfile_name = out_ctx.shard_name;
+        for (int i = 1; i < nshards; i++) {
+            struct output_file *s = &out_ctx.shard[i - 1];
+            s->shard_num = i;
+            s->shard_count = nshards;
+            s->shared = &out_ctx;
+            s->max_records = out_ctx.max_records;
+            s->record_countdown = 0;
+            s->mode = out_ctx.mode;
+            s->type = out_ctx.type;
+            s->gzip = out_ctx.gzip;
+            snprintf(num_str, MAX_HEX, "%d", i);
+            if (filename_append(s->shard_name, base_name, "-", num_str) != status_ok) {
+                return -1;
+            }
+            s->outfile_name = s->shard_name;
+        }
+    }
+
     /* Start the output thread */
     int err = pthread_create(&output_thread, NULL, output_thread_func, &out_ctx);
     if (err != 0) {
         perror("error creating output thread");
         return -1;
     }
+    for (int i = 1; i < nshards; i++) {
+        err = pthread_create(&out_ctx.shard_thread[i - 1], NULL, output_thread_func, &out_ctx.shard[i - 1]);
+        if (err != 0) {
+            perror("error creating output shard thread");
+            return -1;
+        }
+    }
     return 0;
 }
 
 void output_thread_finalize(pthread_t output_thread, struct output_file *out_file) {
-    out_file->sig_stop_output = 1;
+    out_file->sig_stop_output = 1;   /* the shards watch the primary's stop signal */
     pthread_join(output_thread, NULL);
+    for (int i = 1; i < out_file->shard_count; i++) {
+        pthread_join(out_file->shard_thread[i - 1], NULL);
+    }
+
+    /* each shard keeps its own write statistics (race-free, like the
+     * single output thread); fold them into the primary's here so the
+     * numbers reported after shutdown cover every record written */
+    for (int i = 1; i < out_file->shard_count; i++) {
+        struct thread_queues *sqs = &out_file->shard[i - 1].qs;
+        out_file->qs.records_written += sqs->records_written;
+        out_file->qs.rotations += sqs->rotations;
+        for (int b = 0; b < LLQ_LAT_NUM_BUCKETS; b++) {
+            out_file->qs.latency.count[b] += sqs->latency.count[b];
+        }
+        out_file->qs.latency.total += sqs->latency.total;
+    }
+    free(out_file->shard);
+    out_file->shard = NULL;
+    free(out_file->shard_thread);
+    out_file->shard_thread = NULL;
+
     thread_queues_free(&out_file->qs);
 }
@@ -6,6 +6,7 @@
 #define OUTPUT_H
 
 #include <pthread.h>
+#include <zlib.h>
 #include "mercury.h"
 #include "llq.h"
 
@@ -13,11 +14,19 @@ enum file_type {
    file_type_unknown=0,
    file_type_json,
    file_type_pcap,
-   file_type_stdout
+   file_type_stdout,
+   file_type_sink    /* a TCP or UNIX-socket stream; outfile_name holds the sink spec */
 };
 
+struct pcap_index_extent;   /* defined in pcap_index.h */
+
 struct output_file {
     FILE *file;
+    gzFile gzfile = NULL;    /* used instead of file when gzip is set */
+    bool gzip = false;       /* compress output records with gzip     */
+    FILE *index_file = NULL; /* flow index sidecar (--pcap-index), or NULL */
+    struct pcap_index_extent *index_table = NULL; /* extents being accumulated */
+    uint64_t index_offset = 0; /* file offset of the next pcap record */
     int64_t record_countdown;
     int64_t max_records;
     uint32_t file_num;
@@ -29,8 +38,25 @@ struct output_file {
     pthread_mutex_t t_output_m;
     struct thread_queues qs;
     int sig_stop_output = 0;
+
+    /* sharded output (--output-threads): the primary context owns the
+     * queues, the start condition, and the stop signal; each secondary
+     * shard context carries only its own file state and statistics,
+     * and merges the queues whose index is congruent to its shard
+     * number modulo the shard count */
+    int shard_num = 0;                 /* this thread's index among the output shards */
+    int shard_count = 1;               /* number of output shards                     */
+    struct output_file *shared = NULL; /* in a secondary shard: the primary context   */
+    struct output_file *shard = NULL;  /* in the primary: shards 1..shard_count-1     */
+    pthread_t *shard_thread = NULL;    /* in the primary: their thread handles        */
+    char shard_name[MAX_FILENAME];     /* per-shard output filename, when sharded     */
 };
 
+void thread_queues_init(struct thread_queues *tqs, int n,
+                        const char *subsystem, const char *what);
+
+void thread_queues_free(struct thread_queues *tqs);
+
 void *output_thread_func(void *arg);
 
 int output_thread_init(pthread_t &output_thread, struct output_file &out_ctx, const struct mercury_config &cfg);
@@ -18,19 +18,24 @@
 #include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <time.h>
 #include <arpa/inet.h>
 #include <errno.h>
 
 #include "mercury.h"
 #include "pcap_file_io.h"
+#include "pcap_index.h"
 #include "pkt_proc.h"
 #include "signal_handling.h"
 #include "utils.h"
 #include "llq.h"
 #include "buffer_stream.h"
 
+extern struct global_variables global_vars; /* defined in config.c */
+
 /*
  * constants used in file format
  */
@@ -38,27 +43,24 @@ static uint32_t magic = 0xa1b2c3d4;
 static uint32_t cagim = 0xd4c3b2a1;
 
 /*
- * global pcap header (one per file, at beginning)
+ * pcapng (RFC draft-tuexen-opsawg-pcapng) block types and constants;
+ * note that the section header block type is a palindrome, so it is
+ * recognized regardless of the section's byte order
  */
-struct pcap_file_hdr {
-    uint32_t magic_number;   /* magic number */
-    uint16_t version_major;  /* major version number */
-    uint16_t version_minor;  /* minor version number */
-    int32_t  thiszone;       /* GMT to local correction */
-    uint32_t sigfigs;        /* accuracy of timestamps */
-    uint32_t snaplen;        /* max length of captured packets, in octets */
-    uint32_t network;        /* data link type */
-};
-
-/*
- * packet header (one per packet, right before it)
+#define PCAPNG_SHB        0x0a0d0d0a   /* section header block            */
+#define PCAPNG_IDB        0x00000001   /* interface description block     */
+#define PCAPNG_SPB        0x00000003   /* simple packet block             */
+#define PCAPNG_EPB        0x00000006   /* enhanced packet block           */
+#define PCAPNG_BOM        0x1a2b3c4d   /* byte-order magic, native        */
+#define PCAPNG_MOB        0x4d3c2b1a   /* byte-order magic, swapped       */
+#define PCAPNG_OPT_TSRESOL 9           /* if_tsresol option code          */
+#define LINKTYPE_ETHERNET  1
+
+/* struct pcap_file_hdr and struct pcap_packet_hdr, the two structures
+ * that make up the classic pcap file format, are defined in
+ * pcap_file_io.h, because the ring pcap writers (pkt_proc.h) compose
+ * packet record headers themselves
  */
-struct pcap_packet_hdr {
-    uint32_t ts_sec;         /* timestamp seconds */
-    uint32_t ts_usec;        /* timestamp microseconds */
-    uint32_t incl_len;       /* number of octets of packet saved in file */
-    uint32_t orig_len;       /* actual length of packet */
-};  // TBD: pack structure
 
 #define ONE_KB (1024)
 #define ONE_MB (1024 * ONE_KB)
@@ -68,6 +70,7 @@ struct pcap_packet_hdr {
    #define STREAM_BUFFER_SIZE FBUFSIZE
 #endif
 #define PRE_ALLOCATE_DISK_SPACE  (100 * ONE_MB)
+#define STAGE_BUFFER_SIZE (8 * ONE_MB)
 
 static inline void set_file_io_buffer(struct pcap_file *f, const char *fname) {
     f->buffer = (unsigned char *) malloc(STREAM_BUFFER_SIZE);
@@ -84,15 +87,19 @@ static inline void set_file_io_buffer(struct pcap_file *f, const char *fname) {
     }
 }
 
+static void pcap_file_hdr_init(struct pcap_file_hdr *file_header) {
+    file_header->magic_number = magic;
+    file_header->version_major = 2;
+    file_header->version_minor = 4;
+    file_header->thiszone = 0;     /* no GMT correction for now */
+    file_header->sigfigs = 0;      /* we don't claim sigfigs for now */
+    file_header->snaplen = 65535;
+    file_header->network = 1;      /* ethernet */
+}
+
 enum status write_pcap_file_header(FILE *f) {
     struct pcap_file_hdr file_header;
-    file_header.magic_number = magic;
-    file_header.version_major = 2;
-    file_header.version_minor = 4;
-    file_header.thiszone = 0;     /* no GMT correction for now */
-    file_header.sigfigs = 0;      /* we don't claim sigfigs for now */
-    file_header.snaplen = 65535;
-    file_header.network = 1;      /* ethernet */
+    pcap_file_hdr_init(&file_header);
 
     size_t items_written = fwrite(&file_header, sizeof(file_header), 1, f);
     if (items_written == 0) {
@@ -102,6 +109,28 @@ enum status write_pcap_file_header(FILE *f) {
     return status_ok;
 }
 
+enum status gzwrite_pcap_file_header(gzFile f) {
+    struct pcap_file_hdr file_header;
+    pcap_file_hdr_init(&file_header);
+
+    if (gzwrite(f, &file_header, sizeof(file_header)) != (int)sizeof(file_header)) {
+        fprintf(stderr, "error writing compressed pcap file header\n");
+        return status_err;
+    }
+    return status_ok;
+}
+
+enum status write_pcap_file_header_fd(int fd) {
+    struct pcap_file_hdr file_header;
+    pcap_file_hdr_init(&file_header);
+
+    if (write(fd, &file_header, sizeof(file_header)) != (ssize_t)sizeof(file_header)) {
+        perror("error writing pcap file header");
+        return status_err;
+    }
+    return status_ok;
+}
+
 enum status pcap_file_open(struct pcap_file *f,
                const char *fname,
                enum io_direction dir,
@@ -109,6 +138,16 @@ enum status pcap_file_open(struct pcap_file *f,
     struct pcap_file_hdr file_header;
     ssize_t items_read;
 
+    f->mmap_base = NULL;   /* only set for input files that could be mapped */
+    f->gzfile = NULL;      /* only set for compressed input files */
+    f->ng = 0;
+    f->if_count = 0;
+    f->stage = NULL;       /* only set for output files */
+    f->stage_len = 0;
+    f->stage_cap = 0;
+    f->index_file = NULL;  /* only set for output files, with --pcap-index */
+    f->index_table = NULL;
+
     switch(dir) {
     case io_direction_reader:
         f->flags = O_RDONLY;
@@ -168,6 +207,50 @@ enum status pcap_file_open(struct pcap_file *f,
         f->bytes_written = sizeof(file_header);
         f->packets_written = 0;
 
+        /*
+         * allocate the staging buffer for batched packet writes, and
+         * flush the stdio-written file header ahead of it; from here
+         * on, packet records are composed in the staging buffer and
+         * written with one write(2) per several megabytes, instead of
+         * paying an fwrite (and its lock) per packet.  If the
+         * allocation fails, packets go through stdio as before.
+         */
+        fflush(f->file_ptr);
+        f->stage = (unsigned char *)malloc(STAGE_BUFFER_SIZE);
+        if (f->stage != NULL) {
+            f->stage_cap = STAGE_BUFFER_SIZE;
+        } else {
+            printf("warning: could not malloc staging buffer for %s\n", fname);
+        }
+
+        /*
+         * with --pcap-index, open the flow index sidecar and allocate
+         * the table of extents being accumulated; on any failure the
+         * pcap file is still written, just without an index
+         */
+        if (global_vars.pcap_index) {
+            char index_name[MAX_FILENAME + 8];
+            snprintf(index_name, sizeof(index_name), "%s.idx", fname);
+            f->index_file = fopen(index_name, "w");
+            if (f->index_file == NULL) {
+                printf("%s: warning: could not open flow index file %s\n", strerror(errno), index_name);
+            } else {
+                struct pcap_index_hdr index_hdr = { PCAP_INDEX_MAGIC, PCAP_INDEX_VERSION };
+                if (fwrite(&index_hdr, sizeof(index_hdr), 1, f->index_file) == 0) {
+                    printf("warning: could not write flow index file header for %s\n", index_name);
+                    fclose(f->index_file);
+                    f->index_file = NULL;
+                } else {
+                    f->index_table = (struct pcap_index_extent *)calloc(PCAP_INDEX_TABLE_LENGTH, sizeof(struct pcap_index_extent));
+                    if (f->index_table == NULL) {
+                        printf("warning: could not malloc flow index table for %s\n", index_name);
+                        fclose(f->index_file);
+                        f->index_file = NULL;
+                    }
+                }
+            }
+        }
+
     } else { /* O_RDONLY */
 
 	/*  open existing file for reading */
@@ -201,18 +284,55 @@ enum status pcap_file_open(struct pcap_file *f,
 	    perror("could not read file header");
 	    return status_err; /* could not read packet header from file */
 	}
+	if (((uint8_t *)&file_header)[0] == 0x1f && ((uint8_t *)&file_header)[1] == 0x8b) {
+	    /*
+	     * gzip-compressed pcap; re-open the file through zlib, which
+	     * decompresses transparently, and re-read the file header
+	     * from the decompressed stream.  A compressed file is never
+	     * memory mapped, so its packets take the buffered read path.
+	     */
+	    fclose(f->file_ptr);
+	    f->file_ptr = NULL;
+	    f->fd = -1;
+	    if (f->buffer != NULL) {
+		free(f->buffer);
+		f->buffer = NULL;
+		f->buf_len = 0;
+	    }
+	    f->gzfile = gzopen(fname, "r");
+	    if (f->gzfile == NULL) {
+		printf("%s: error opening compressed read file %s\n", strerror(errno), fname);
+		return status_err;
+	    }
+	    gzbuffer(f->gzfile, STREAM_BUFFER_SIZE);
+	    if (gzread(f->gzfile, &file_header, sizeof(file_header)) != (int)sizeof(file_header)) {
+		printf("error: could not read file header of compressed file %s\n", fname);
+		return status_err;
+	    }
+	}
 	if (file_header.magic_number == magic) {
 	    f->byteswap = 0;
 	    // printf("file is in pcap format\nno byteswap needed\n");
 	} else if (file_header.magic_number == cagim) {
 	    f->byteswap = 1;
 	    // printf("file is in pcap format\nbyteswap is needed\n");
+	} else if (file_header.magic_number == PCAPNG_SHB) {
+	    /* pcapng; the byte-order magic sits where thiszone is in a
+	     * classic header, and the block walker re-parses the section
+	     * header, so nothing else is needed here */
+	    uint32_t bom = (uint32_t)file_header.thiszone;
+	    if (bom == PCAPNG_BOM) {
+		f->byteswap = 0;
+	    } else if (bom == PCAPNG_MOB) {
+		f->byteswap = 1;
+	    } else {
+		printf("error: file %s has an invalid pcapng byte-order magic (%08x)\n", fname, bom);
+		exit(255);
+	    }
+	    f->ng = 1;
 	} else {
 	    printf("error: file %s not in pcap format (file header: %08x)\n",
 		   fname, file_header.magic_number);
-	    if (file_header.magic_number == 0x0a0d0d0a) {
-		printf("error: pcap-ng format found; this format is currently unsupported\n");
-	    }
 	    exit(255);
 	}
 	if (f->byteswap) {
@@ -223,12 +343,67 @@ enum status pcap_file_open(struct pcap_file *f,
 	    file_header.snaplen = htonl(file_header.snaplen);
 	    file_header.network = htonl(file_header.network);
 	}
+
+	/*
+	 * map the file, so that packets are handed to the parsers as
+	 * windows over the mapping, with no copy and no per-packet
+	 * read(2); on any failure we quietly fall back to buffered
+	 * reads.  The mapping is private, so a (hypothetical) write
+	 * to packet data would hit a copy-on-write page, not the file.
+	 */
+	f->mmap_base = NULL;
+	struct stat statbuf;
+	if (f->gzfile == NULL
+	    && fstat(f->fd, &statbuf) == 0
+	    && S_ISREG(statbuf.st_mode)
+	    && statbuf.st_size > (off_t)sizeof(struct pcap_file_hdr)) {
+	    uint8_t *base = (uint8_t *)mmap(NULL, statbuf.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, f->fd, 0);
+	    if (base != MAP_FAILED) {
+		f->mmap_base = base;
+		f->mmap_length = statbuf.st_size;
+		f->mmap_offset = f->ng ? 0 : sizeof(struct pcap_file_hdr);
+		f->mmap_advised = 0;
+		if (madvise(base, statbuf.st_size, MADV_SEQUENTIAL) != 0) {
+		    printf("%s: could not set madvise for read file %s\n", strerror(errno), fname);
+		}
+	    }
+	}
+	if (f->ng && f->gzfile != NULL) {
+	    printf("error: compressed pcapng input file %s is not supported\n", fname);
+	    return status_err;
+	}
+	if (f->ng && f->mmap_base == NULL) {
+	    printf("error: pcapng input file %s could not be memory mapped\n", fname);
+	    return status_err;
+	}
     }
 
     return status_ok;
 }
 
 
+/*
+ * pcap_file_write_flush() writes the staged packet records with a
+ * single write(2), emptying the staging buffer
+ */
+enum status pcap_file_write_flush(struct pcap_file *f) {
+    size_t offset = 0;
+
+    while (offset < f->stage_len) {
+        ssize_t bytes = write(f->fd, f->stage + offset, f->stage_len - offset);
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("error: could not write staged packets to output file\n");
+            return status_err;
+        }
+        offset += bytes;
+    }
+    f->stage_len = 0;
+    return status_ok;
+}
+
 enum status pcap_file_write_packet_direct(struct pcap_file *f,
                       const void *packet,
                       size_t length,
@@ -242,6 +417,51 @@ enum status pcap_file_write_packet_direct(struct pcap_file *f,
 	return status_ok;
     }
 
+    size_t record_length = sizeof(struct pcap_packet_hdr) + length;
+    if (f->stage != NULL && record_length <= f->stage_cap) {
+
+        if (f->stage_len + record_length > f->stage_cap) {
+            if (pcap_file_write_flush(f) != status_ok) {
+                return status_err;
+            }
+        }
+
+        /* compose the record header in place, then append the packet */
+        struct pcap_packet_hdr *hdr = (struct pcap_packet_hdr *)(f->stage + f->stage_len);
+        hdr->ts_sec = sec;
+        hdr->ts_usec = usec;
+        hdr->incl_len = length;
+        hdr->orig_len = length;
+        memcpy(f->stage + f->stage_len + sizeof(struct pcap_packet_hdr), packet, length);
+        f->stage_len += record_length;
+
+        if (f->index_table != NULL) {
+            pcap_index_note(f->index_file, f->index_table, (const uint8_t *)packet, length, f->bytes_written, record_length);
+        }
+        f->bytes_written += record_length;
+        f->packets_written++;
+
+#ifdef FALLOC_FL_KEEP_SIZE
+        if ((f->allocated_size > 0) && (f->allocated_size - f->bytes_written) <= ONE_MB) {
+            // need to allocate more
+            if (fallocate(f->fd, FALLOC_FL_KEEP_SIZE, f->bytes_written, PRE_ALLOCATE_DISK_SPACE) != 0) {
+                perror("warning: could not increase write file allocation by 100 MB");
+            } else {
+                f->allocated_size = f->bytes_written + PRE_ALLOCATE_DISK_SPACE;  // increase allocation
+            }
+        }
+#endif
+        return status_ok;
+    }
+
+    /*
+     * oversized-record fallback: keep file order by flushing the
+     * staging buffer first, and the stdio buffer afterwards
+     */
+    if (f->stage_len > 0 && pcap_file_write_flush(f) != status_ok) {
+        return status_err;
+    }
+
     /* note: we never perform byteswap when writing */
     packet_hdr.ts_sec = sec;
     packet_hdr.ts_usec = usec;
@@ -261,7 +481,13 @@ enum status pcap_file_write_packet_direct(struct pcap_file *f,
         perror("error: could not write packet data to output file\n");
         return status_err;
     }
+    if (f->stage != NULL) {
+        fflush(f->file_ptr);   /* later staged writes must land after this record */
+    }
 
+    if (f->index_table != NULL) {
+        pcap_index_note(f->index_file, f->index_table, (const uint8_t *)packet, length, f->bytes_written, length + sizeof(struct pcap_packet_hdr));
+    }
     f->bytes_written += length + sizeof(struct pcap_packet_hdr);
     f->packets_written++;
 
@@ -282,6 +508,56 @@ enum status pcap_file_write_packet_direct(struct pcap_file *f,
 
 #define BUFLEN  16384
 
+/*
+ * pcap_file_read_packet_gz() reads one packet record from the
+ * decompressed stream of a gzip-compressed pcap file; it mirrors
+ * pcap_file_read_packet(), with zlib in place of stdio
+ */
+static enum status pcap_file_read_packet_gz(struct pcap_file *f,
+                                            struct pcap_pkthdr *pkthdr, /* output */
+                                            void *packet_data           /* output */
+                                            ) {
+    struct pcap_packet_hdr packet_hdr;
+
+    if (gzread(f->gzfile, &packet_hdr, sizeof(packet_hdr)) != (int)sizeof(packet_hdr)) {
+        return status_err_no_more_data; /* could not read packet header from file */
+    }
+
+    if (f->byteswap) {
+        pkthdr->ts.tv_sec = ntohl(packet_hdr.ts_sec);
+        pkthdr->ts.tv_usec = ntohl(packet_hdr.ts_usec);
+        pkthdr->caplen = ntohl(packet_hdr.incl_len);
+    } else {
+        pkthdr->ts.tv_sec = packet_hdr.ts_sec;
+        pkthdr->ts.tv_usec = packet_hdr.ts_usec;
+        pkthdr->caplen = packet_hdr.incl_len;
+    }
+
+    if (pkthdr->caplen <= BUFLEN) {
+        if (gzread(f->gzfile, packet_data, pkthdr->caplen) != (int)pkthdr->caplen) {
+            printf("could not read packet from compressed file, caplen: %u\n", pkthdr->caplen);
+            return status_err;          /* could not read packet from file */
+        }
+    } else {
+        /*
+         * as in the uncompressed path, read BUFLEN bytes of the large
+         * packet and skip over the rest
+         */
+        if (gzread(f->gzfile, packet_data, BUFLEN) != BUFLEN) {
+            printf("could not read %d bytes of the packet from compressed file\n", (int)BUFLEN);
+            return status_err;          /* could not read packet from file */
+        }
+        if (gzseek(f->gzfile, pkthdr->caplen - BUFLEN, SEEK_CUR) < 0) {
+            printf("error: could not advance compressed file position\n");
+            return status_err;
+        }
+        pkthdr->len = pkthdr->caplen;
+        pkthdr->caplen = BUFLEN;
+    }
+
+    return status_ok;
+}
+
 enum status pcap_file_read_packet(struct pcap_file *f,
                   struct pcap_pkthdr *pkthdr, /* output */
                   void *packet_data           /* output */
@@ -289,6 +565,9 @@ enum status pcap_file_read_packet(struct pcap_file *f,
     ssize_t items_read;
     struct pcap_packet_hdr packet_hdr;
 
+    if (f->gzfile != NULL) {
+        return pcap_file_read_packet_gz(f, pkthdr, packet_data);
+    }
     if (f->file_ptr == NULL) {
         printf("File not open\n");
         return status_err;
@@ -341,6 +620,264 @@ enum status pcap_file_read_packet(struct pcap_file *f,
 }
 
 
+#define MMAP_ADVISE_CHUNK (8 * ONE_MB)
+
+/*
+ * pcap_file_advise_ahead() requests readahead in large chunks as the
+ * read cursor advances, so the page cache stays ahead of the parsers
+ */
+static void pcap_file_advise_ahead(struct pcap_file *f) {
+    if (f->mmap_offset + MMAP_ADVISE_CHUNK / 2 > f->mmap_advised && f->mmap_advised < f->mmap_length) {
+        size_t chunk = f->mmap_length - f->mmap_advised;
+        if (chunk > MMAP_ADVISE_CHUNK) {
+            chunk = MMAP_ADVISE_CHUNK;
+        }
+        madvise(f->mmap_base + f->mmap_advised, chunk, MADV_WILLNEED);
+        f->mmap_advised += chunk;
+    }
+}
+
+static uint32_t pcapng_uint32(const struct pcap_file *f, const uint8_t *p) {
+    uint32_t x;
+    memcpy(&x, p, sizeof(x));
+    return f->byteswap ? ntohl(x) : x;
+}
+
+static uint16_t pcapng_uint16(const struct pcap_file *f, const uint8_t *p) {
+    uint16_t x;
+    memcpy(&x, p, sizeof(x));
+    return f->byteswap ? ntohs(x) : x;
+}
+
+/*
+ * pcapng_parse_idb() records the link type and timestamp resolution
+ * of an interface description block; interfaces are numbered in their
+ * order of appearance within a section
+ */
+static void pcapng_parse_idb(struct pcap_file *f, const uint8_t *body, uint32_t body_length) {
+    if (f->if_count >= PCAPNG_MAX_IF || body_length < 8) {
+        return;
+    }
+    uint16_t linktype = pcapng_uint16(f, body);
+    uint64_t ticks_per_sec = 1000000;    /* if_tsresol defaults to microseconds */
+
+    /* walk the options for if_tsresol; other options are skipped by length */
+    const uint8_t *opt = body + 8;
+    uint32_t remaining = body_length - 8;
+    while (remaining >= 4) {
+        uint16_t code = pcapng_uint16(f, opt);
+        uint32_t value_length = pcapng_uint16(f, opt + 2);
+        uint32_t padded = 4 + ((value_length + 3) & ~3u);
+        if (code == 0 || padded > remaining) {
+            break;      /* opt_endofopt, or a malformed option */
+        }
+        if (code == PCAPNG_OPT_TSRESOL && value_length >= 1) {
+            uint8_t resol = opt[4];
+            if (resol & 0x80) {
+                ticks_per_sec = 1ULL << (resol & 0x3f);
+            } else {
+                ticks_per_sec = 1;
+                for (uint8_t i = 0; i < resol && i < 19; i++) {
+                    ticks_per_sec *= 10;
+                }
+            }
+        }
+        opt += padded;
+        remaining -= padded;
+    }
+    f->if_linktype[f->if_count] = linktype;
+    f->if_ticks_per_sec[f->if_count] = ticks_per_sec;
+    f->if_count++;
+}
+
+/*
+ * pcapng_read_packet_ref() walks the blocks of a mapped pcapng file
+ * until it finds the next ethernet packet, which it hands out as a
+ * window over the mapping.  Unknown and option-heavy blocks are
+ * skipped by their total length without being examined; section
+ * header blocks reset the byte order and interface list, so
+ * multi-section files are handled; packets from non-ethernet
+ * interfaces are skipped.
+ */
+static enum status pcapng_read_packet_ref(struct pcap_file *f,
+                  struct pcap_pkthdr *pkthdr, /* output */
+                  uint8_t **packet_data       /* output; points into the mapping */
+                  ) {
+
+    while (f->mmap_length - f->mmap_offset >= 12) {
+        const uint8_t *block = f->mmap_base + f->mmap_offset;
+
+        uint32_t raw_type;
+        memcpy(&raw_type, block, sizeof(raw_type));
+        if (raw_type == PCAPNG_SHB) {
+            /* the byte-order magic governs the rest of the section */
+            uint32_t bom;
+            memcpy(&bom, block + 8, sizeof(bom));
+            if (bom == PCAPNG_BOM) {
+                f->byteswap = 0;
+            } else if (bom == PCAPNG_MOB) {
+                f->byteswap = 1;
+            } else {
+                return status_err;      /* invalid section header */
+            }
+            f->if_count = 0;
+        }
+
+        uint32_t block_type = pcapng_uint32(f, block);
+        uint32_t total_length = pcapng_uint32(f, block + 4);
+        if (total_length < 12 || (total_length & 3) || total_length > f->mmap_length - f->mmap_offset) {
+            return status_err_no_more_data;    /* truncated or corrupt block */
+        }
+
+        switch (block_type) {
+        case PCAPNG_IDB:
+            pcapng_parse_idb(f, block + 8, total_length - 12);
+            break;
+        case PCAPNG_EPB:
+            {
+                if (total_length < 32) {
+                    break;                     /* malformed; skip */
+                }
+                uint32_t iface  = pcapng_uint32(f, block + 8);
+                uint32_t caplen = pcapng_uint32(f, block + 20);
+                if (caplen > total_length - 32
+                    || iface >= f->if_count
+                    || f->if_linktype[iface] != LINKTYPE_ETHERNET) {
+                    break;                     /* malformed or non-ethernet; skip */
+                }
+                uint64_t ticks = f->if_ticks_per_sec[iface];
+                uint64_t ts = ((uint64_t)pcapng_uint32(f, block + 12) << 32) | pcapng_uint32(f, block + 16);
+                pkthdr->ts.tv_sec = ts / ticks;
+                pkthdr->ts.tv_usec = (ts % ticks) * 1000000 / ticks;
+                pkthdr->caplen = caplen;
+                *packet_data = (uint8_t *)block + 28;
+                f->mmap_offset += total_length;
+                if (pkthdr->caplen > BUFLEN) {
+                    pkthdr->len = pkthdr->caplen;
+                    pkthdr->caplen = BUFLEN;
+                }
+                pcap_file_advise_ahead(f);
+                return status_ok;
+            }
+        case PCAPNG_SPB:
+            {
+                if (total_length < 16 || f->if_count < 1 || f->if_linktype[0] != LINKTYPE_ETHERNET) {
+                    break;                     /* malformed or non-ethernet; skip */
+                }
+                uint32_t caplen = pcapng_uint32(f, block + 8);   /* original length */
+                if (caplen > total_length - 16) {
+                    caplen = total_length - 16;                  /* captured portion */
+                }
+                pkthdr->ts.tv_sec = 0;         /* simple packet blocks carry no timestamp */
+                pkthdr->ts.tv_usec = 0;
+                pkthdr->caplen = caplen;
+                *packet_data = (uint8_t *)block + 12;
+                f->mmap_offset += total_length;
+                if (pkthdr->caplen > BUFLEN) {
+                    pkthdr->len = pkthdr->caplen;
+                    pkthdr->caplen = BUFLEN;
+                }
+                pcap_file_advise_ahead(f);
+                return status_ok;
+            }
+        default:
+            break;                             /* unknown block; skip by length */
+        }
+        f->mmap_offset += total_length;
+    }
+    return status_err_no_more_data;
+}
+
+/*
+ * pcap_file_read_packet_ref() reads the next packet of a mapped input
+ * file, pointing *packet_data at the packet bytes within the mapping
+ * rather than copying them out; the window is valid until the file is
+ * closed.  Readahead is requested in large chunks as the cursor
+ * advances, so the page cache stays ahead of the parsers.
+ */
+enum status pcap_file_read_packet_ref(struct pcap_file *f,
+                  struct pcap_pkthdr *pkthdr, /* output */
+                  uint8_t **packet_data       /* output; points into the mapping */
+                  ) {
+    struct pcap_packet_hdr packet_hdr;
+
+    if (f->mmap_base == NULL) {
+        printf("File not mapped\n");
+        return status_err;
+    }
+
+    if (f->ng) {
+        return pcapng_read_packet_ref(f, pkthdr, packet_data);
+    }
+
+    if (f->mmap_length - f->mmap_offset < sizeof(packet_hdr)) {
+        return status_err_no_more_data; /* no more packet headers in file */
+    }
+    memcpy(&packet_hdr, f->mmap_base + f->mmap_offset, sizeof(packet_hdr));
+    f->mmap_offset += sizeof(packet_hdr);
+
+    if (f->byteswap) {
+        pkthdr->ts.tv_sec = ntohl(packet_hdr.ts_sec);
+        pkthdr->ts.tv_usec = ntohl(packet_hdr.ts_usec);
+        pkthdr->caplen = ntohl(packet_hdr.incl_len);
+    } else {
+        pkthdr->ts.tv_sec = packet_hdr.ts_sec;
+        pkthdr->ts.tv_usec = packet_hdr.ts_usec;
+        pkthdr->caplen = packet_hdr.incl_len;
+    }
+
+    if (pkthdr->caplen > f->mmap_length - f->mmap_offset) {
+        printf("could not read packet from file, caplen: %u\n", pkthdr->caplen);
+        return status_err;          /* packet extends past the end of the file */
+    }
+    *packet_data = f->mmap_base + f->mmap_offset;
+    f->mmap_offset += pkthdr->caplen;
+
+    if (pkthdr->caplen > BUFLEN) {
+        /* process only the first BUFLEN bytes, as the copying reader does */
+        pkthdr->len = pkthdr->caplen;
+        pkthdr->caplen = BUFLEN;
+    }
+
+    pcap_file_advise_ahead(f);
+
+    return status_ok;
+}
+
+/*
+ * pcap_file_partition() divides a mapped input file into up to n
+ * chunks of roughly equal size, each starting on a packet-record
+ * boundary, by walking the packet headers once; the packet bodies are
+ * not touched.  offsets[i] receives the file offset of chunk i's
+ * first record.  Returns the number of nonempty chunks, or 0 if the
+ * file is not mapped.
+ */
+int pcap_file_partition(struct pcap_file *f, size_t *offsets, int n) {
+    struct pcap_packet_hdr packet_hdr;
+
+    if (f->mmap_base == NULL || f->ng || n < 1) {
+        return 0;   /* pcapng files are not partitioned: packet blocks
+                     * depend on the interface blocks before them */
+    }
+    size_t data_length = f->mmap_length - sizeof(struct pcap_file_hdr);
+    size_t offset = sizeof(struct pcap_file_hdr);
+    offsets[0] = offset;
+    int chunks = 1;
+    while (chunks < n && f->mmap_length - offset >= sizeof(packet_hdr)) {
+        memcpy(&packet_hdr, f->mmap_base + offset, sizeof(packet_hdr));
+        uint32_t caplen = f->byteswap ? ntohl(packet_hdr.incl_len) : packet_hdr.incl_len;
+        if (caplen > f->mmap_length - offset - sizeof(packet_hdr)) {
+            break;                     /* truncated final record */
+        }
+        offset += sizeof(packet_hdr) + caplen;
+        if (offset >= sizeof(struct pcap_file_hdr) + (data_length * (size_t)chunks) / (size_t)n
+            && offset < f->mmap_length) {
+            offsets[chunks++] = offset;
+        }
+    }
+    return chunks;
+}
+
 void packet_info_init_from_pkthdr(struct packet_info *pi,
 				  struct pcap_pkthdr *pkthdr) {
     pi->len = pkthdr->caplen;
@@ -349,37 +886,139 @@ void packet_info_init_from_pkthdr(struct packet_info *pi,
     pi->ts.tv_nsec = pkthdr->ts.tv_usec * 1000;
 } 
 
+/*
+ * pcap_file_dispatch_pkt_processor_range() runs the packet processor
+ * over the records between the start and end offsets of a mapped
+ * input file; it is used by the parallel file reader, in which each
+ * worker thread owns one chunk of the file (see pcap_file_partition)
+ */
+enum status pcap_file_dispatch_pkt_processor_range(struct pcap_file *f,
+                                                   struct pkt_proc *pkt_processor,
+                                                   size_t start,
+                                                   size_t end) {
+    enum status status = status_ok;
+    struct pcap_pkthdr pkthdr;
+    unsigned long total_length = 0;
+    unsigned long num_packets = 0;
+    struct packet_info pi;
+    uint8_t *packet = NULL;
+
+    f->mmap_offset = start;
+    f->mmap_advised = start;
+    while (f->mmap_offset < end && sig_close_flag == 0) {
+        status = pcap_file_read_packet_ref(f, &pkthdr, &packet);
+        if (status != status_ok) {
+            break;
+        }
+        packet_info_init_from_pkthdr(&pi, &pkthdr);
+        pkt_processor->apply(&pi, packet);
+        num_packets++;
+        total_length += pkthdr.caplen + sizeof(struct pcap_packet_hdr);
+    }
+
+    pkt_processor->flush();   /* release anything held back for aggregation */
+
+    pkt_processor->bytes_written = total_length;
+    pkt_processor->packets_written = num_packets;
+
+    if (status == status_err_no_more_data) {
+        return status_ok;
+    }
+    return status;
+}
+
+/*
+ * replay pacing (--replay): the first packet's timestamp is pinned to
+ * the wall clock, and each later packet waits until its scaled offset
+ * from that timestamp has elapsed; a rate of 2.0 replays the file at
+ * twice its recorded speed, and a rate of 0 disables pacing entirely
+ */
+struct replay_clock {
+    struct timespec wall_start;  /* wall clock at the first packet      */
+    struct timeval pcap_start;   /* recorded time of the first packet   */
+    int started;
+    double rate;
+};
+
+static void replay_clock_init(struct replay_clock *rc, double rate) {
+    rc->started = 0;
+    rc->rate = rate;
+}
+
+static void replay_clock_wait(struct replay_clock *rc, const struct timeval *ts) {
+    if (rc->rate <= 0.0) {
+        return;              /* flat-out; no pacing */
+    }
+    if (!rc->started) {
+        clock_gettime(CLOCK_MONOTONIC, &rc->wall_start);
+        rc->pcap_start = *ts;
+        rc->started = 1;
+        return;
+    }
+    double offset = ((double)(ts->tv_sec - rc->pcap_start.tv_sec)
+                     + (double)(ts->tv_usec - rc->pcap_start.tv_usec) / 1e6) / rc->rate;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = (double)(now.tv_sec - rc->wall_start.tv_sec)
+                     + (double)(now.tv_nsec - rc->wall_start.tv_nsec) / 1e9;
+    double ahead = offset - elapsed;
+    if (ahead > 0.0) {
+        struct timespec sleep_ts;
+        sleep_ts.tv_sec = (time_t)ahead;
+        sleep_ts.tv_nsec = (long)((ahead - (double)sleep_ts.tv_sec) * 1e9);
+        nanosleep(&sleep_ts, NULL);
+    }
+}
+
 enum status pcap_file_dispatch_pkt_processor(struct pcap_file *f,
                                              struct pkt_proc *pkt_processor,
-                                             int loop_count) {
+                                             int loop_count,
+                                             double replay_rate) {
     enum status status = status_ok;
     struct pcap_pkthdr pkthdr;
     uint8_t packet_data[BUFLEN];
     unsigned long total_length = sizeof(struct pcap_file_hdr); // file header is already written
     unsigned long num_packets = 0;
     struct packet_info pi;
+    struct replay_clock rc;
 
     for (int i=0; i < loop_count && sig_close_flag == 0; i++) {
+        replay_clock_init(&rc, replay_rate);   /* each pass is paced from its first packet */
         do {
-            status = pcap_file_read_packet(f, &pkthdr, packet_data);
+            uint8_t *packet = packet_data;
+            if (f->mmap_base) {
+                status = pcap_file_read_packet_ref(f, &pkthdr, &packet);
+            } else {
+                status = pcap_file_read_packet(f, &pkthdr, packet_data);
+            }
             if (status == status_ok) {
+                replay_clock_wait(&rc, &pkthdr.ts);
                 packet_info_init_from_pkthdr(&pi, &pkthdr);
                 // process the packet that was read
-                pkt_processor->apply(&pi, packet_data);
+                pkt_processor->apply(&pi, packet);
                 num_packets++;
                 total_length += pkthdr.caplen + sizeof(struct pcap_packet_hdr);
             }
         } while (status == status_ok && sig_close_flag == 0);
-        
+
         if (i < loop_count - 1) {
             // Rewind the file to the first packet after skipping file header.
-            if (fseek(f->file_ptr, sizeof(struct pcap_file_hdr), SEEK_SET) != 0) {
+            if (f->mmap_base) {
+                f->mmap_offset = f->ng ? 0 : sizeof(struct pcap_file_hdr);
+            } else if (f->gzfile != NULL) {
+                if (gzseek(f->gzfile, sizeof(struct pcap_file_hdr), SEEK_SET) < 0) {
+                    printf("error: could not rewind compressed file position\n");
+                    status = status_err;
+                }
+            } else if (fseek(f->file_ptr, sizeof(struct pcap_file_hdr), SEEK_SET) != 0) {
                 perror("error: could not rewind file pointer\n");
                 status = status_err;
             }
         }
     }
 
+    pkt_processor->flush();   /* release anything held back for aggregation */
+
     pkt_processor->bytes_written = total_length;
     pkt_processor->packets_written = num_packets;
 
@@ -390,7 +1029,33 @@ enum status pcap_file_dispatch_pkt_processor(struct pcap_file *f,
 }
 
 enum status pcap_file_close(struct pcap_file *f) {
-    if (fclose(f->file_ptr) != 0) {
+    if (f->mmap_base) {
+	munmap(f->mmap_base, f->mmap_length);
+	f->mmap_base = NULL;
+    }
+    if (f->stage) {
+	pcap_file_write_flush(f);
+	free(f->stage);
+	f->stage = NULL;
+    }
+    if (f->index_table) {
+	pcap_index_drain(f->index_file, f->index_table);
+	free(f->index_table);
+	f->index_table = NULL;
+    }
+    if (f->index_file) {
+	if (fclose(f->index_file) != 0) {
+	    perror("could not close flow index file");
+	}
+	f->index_file = NULL;
+    }
+    if (f->gzfile) {
+	if (gzclose(f->gzfile) != Z_OK) {
+	    printf("error: could not close compressed input pcap file\n");
+	    return status_err;
+	}
+	f->gzfile = NULL;
+    } else if (fclose(f->file_ptr) != 0) {
 	perror("could not close input pcap file");
 	return status_err;
     }
@@ -413,24 +1078,26 @@ void pcap_queue_write(struct ll_queue *llq,
                       unsigned int nsec,
                       bool blocking) {
 
+    struct llq_msg *msg = llq_write_slot(llq);
     if (blocking) {
-        while (llq->msgs[llq->widx].used != 0) {
+        while (msg == NULL) {
             usleep(50); // sleep for fifty microseconds
+            llq->stall_usec += 50;
+            msg = llq_write_slot(llq);
         }
     }
 
-    if (llq->msgs[llq->widx].used == 0) {
+    if (msg != NULL) {
 
-        //char obuf[LLQ_MSG_SIZE];
         int olen = LLQ_MSG_SIZE;
         int ooff = 0;
         int trunc = 0;
 
-        llq->msgs[llq->widx].ts.tv_sec = sec;
-        llq->msgs[llq->widx].ts.tv_nsec = nsec;
+        msg->ts.tv_sec = sec;
+        msg->ts.tv_nsec = nsec;
 
-        //obuf[sizeof(struct timespec)] = '\0';
-        llq->msgs[llq->widx].buf[0] = '\0';
+        char *msg_buf = llq_msg_buf(msg);
+        msg_buf[0] = '\0';
 
         if (packet && !length) {
             fprintf(stderr, "warning: attempt to write an empty packet\n");
@@ -444,33 +1111,26 @@ void pcap_queue_write(struct ll_queue *llq,
         packet_hdr.orig_len = length;
 
         // write the packet header
-        int r = append_memcpy(llq->msgs[llq->widx].buf, &ooff, olen, &trunc, &packet_hdr, sizeof(packet_hdr));
+        int r = append_memcpy(msg_buf, &ooff, olen, &trunc, &packet_hdr, sizeof(packet_hdr));
 
         // write the packet
-        r += append_memcpy(llq->msgs[llq->widx].buf, &ooff, olen, &trunc, packet, length);
+        r += append_memcpy(msg_buf, &ooff, olen, &trunc, packet, length);
 
         // f->bytes_written += length + sizeof(struct pcap_packet_hdr);
         // f->packets_written++;
 
         if ((trunc == 0) && (r > 0)) {
 
-            llq->msgs[llq->widx].len = r;
+            msg->len = r;
 
             //fprintf(stderr, "DEBUG: sent a message!\n");
-            __sync_synchronize(); /* A full memory barrier prevents the following flag set from happening too soon */
-            llq->msgs[llq->widx].used = 1;
-
-            //llq->next_write();
-            llq->widx = (llq->widx + 1) % LLQ_DEPTH;
+            llq_publish(llq, msg);
+        } else if (trunc != 0) {
+            llq->truncated++;  /* the packet outgrew LLQ_MSG_SIZE; an involuntary loss */
         }
     }
     else {
-        //fprintf(stderr, "DEBUG: queue bucket used!\n");
-
-        // TODO: this is where we'd update an output drop counter
-        // but currently this spot in the code doesn't have access to
-        // any thread stats pointer or similar and I don't want
-        // to update a global variable in this location.
+        llq->enqueue_drops++;  /* reported by the stats thread alongside socket_drops */
     }
 
 }
@@ -13,6 +13,7 @@
 #include <sys/time.h>
 #include <stdio.h>
 #include <fcntl.h>
+#include <zlib.h>
 #include "mercury.h"
 
 /*
@@ -38,8 +39,34 @@ enum io_direction {
     io_direction_writer = 2
 };
 
+/*
+ * global pcap header (one per file, at beginning)
+ */
+struct pcap_file_hdr {
+    uint32_t magic_number;   /* magic number */
+    uint16_t version_major;  /* major version number */
+    uint16_t version_minor;  /* minor version number */
+    int32_t  thiszone;       /* GMT to local correction */
+    uint32_t sigfigs;        /* accuracy of timestamps */
+    uint32_t snaplen;        /* max length of captured packets, in octets */
+    uint32_t network;        /* data link type */
+};
+
+/*
+ * packet header (one per packet, right before it)
+ */
+struct pcap_packet_hdr {
+    uint32_t ts_sec;         /* timestamp seconds */
+    uint32_t ts_usec;        /* timestamp microseconds */
+    uint32_t incl_len;       /* number of octets of packet saved in file */
+    uint32_t orig_len;       /* actual length of packet */
+};  // TBD: pack structure
+
+struct pcap_index_extent;   /* defined in pcap_index.h */
+
 struct pcap_file {
     FILE *file_ptr;
+    gzFile gzfile;         /* used instead of file_ptr for compressed input */
     int fd;                /* file descriptor that is returned by fileno() */
     int flags;
     unsigned int byteswap; /* boolean, indicates if swap needed after read */
@@ -48,6 +75,20 @@ struct pcap_file {
     off_t  allocated_size; /* file size allocated using posix_fallocate    */
     uint64_t bytes_written; /* number of bytes written to this file       */
     uint64_t packets_written; /* number of packets written to this file   */
+    uint8_t *mmap_base;    /* mapping of an input file, or NULL            */
+    size_t mmap_length;    /* length of the mapping                        */
+    size_t mmap_offset;    /* read cursor within the mapping               */
+    size_t mmap_advised;   /* end of the region already advised ahead      */
+    unsigned char *stage;  /* staging buffer for batched packet writes     */
+    size_t stage_len;      /* bytes currently staged                       */
+    size_t stage_cap;      /* capacity of the staging buffer               */
+    FILE *index_file;      /* flow index sidecar (--pcap-index), or NULL   */
+    struct pcap_index_extent *index_table; /* extents being accumulated    */
+    unsigned int ng;       /* boolean, input is pcapng, not classic pcap   */
+#define PCAPNG_MAX_IF 32
+    unsigned int if_count; /* pcapng: interfaces seen in current section   */
+    uint16_t if_linktype[PCAPNG_MAX_IF];      /* pcapng: per-interface link type */
+    uint64_t if_ticks_per_sec[PCAPNG_MAX_IF]; /* pcapng: timestamp resolution    */
 };
 
 #define pcap_file_init() { NULL, 0, 0, 0, NULL, NULL, NULL }
@@ -63,6 +104,11 @@ enum status pcap_file_read_packet(struct pcap_file *f,
 				  void *packet_data           /* output */
 				  );
 
+enum status pcap_file_read_packet_ref(struct pcap_file *f,
+				      struct pcap_pkthdr *pkthdr, /* output */
+				      uint8_t **packet_data       /* output; points into the mapping */
+				      );
+
 enum status pcap_file_write_packet(struct pcap_file *f,
 				   const void *packet,
 				   size_t length);
@@ -73,11 +119,21 @@ enum status pcap_file_write_packet_direct(struct pcap_file *f,
 					  unsigned int sec,
 					  unsigned int usec);
 
+enum status pcap_file_write_flush(struct pcap_file *f);
+
 enum status pcap_file_close(struct pcap_file *f);
 
 enum status pcap_file_dispatch_pkt_processor(struct pcap_file *f,
                                              struct pkt_proc *pkt_processor,
-                                             int loop_count);
+                                             int loop_count,
+                                             double replay_rate);
+
+int pcap_file_partition(struct pcap_file *f, size_t *offsets, int n);
+
+enum status pcap_file_dispatch_pkt_processor_range(struct pcap_file *f,
+                                                   struct pkt_proc *pkt_processor,
+                                                   size_t start,
+                                                   size_t end);
 
 /*
  * start of serialized output code - first cut
@@ -92,4 +148,8 @@ void pcap_queue_write(struct ll_queue *llq,
 
 enum status write_pcap_file_header(FILE *f);
 
+enum status gzwrite_pcap_file_header(gzFile f);
+
+enum status write_pcap_file_header_fd(int fd);
+
 #endif /* PCAP_FILE_IO_H */
@@ -0,0 +1,183 @@
+/*
+ * pcap_index.h
+ *
+ * format of the flow index sidecar written alongside a pcap output
+ * file (--pcap-index), and the flow key extraction shared between the
+ * writer (pcap_file_io.c) and the lookup tool (pcap_lookup.cc)
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. All rights reserved.  License at
+ * https://github.com/cisco/mercury/blob/master/LICENSE
+ */
+
+#ifndef PCAP_INDEX_H
+#define PCAP_INDEX_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "tcp.h"    // struct key
+
+/*
+ * The sidecar ("<pcap>.idx") holds a fixed header followed by
+ * fixed-size entries.  Each entry describes one extent of the pcap
+ * file: the packet records from offset through offset+length include
+ * every record of the flow that was seen while the extent was open.
+ * Records of other flows are interleaved within an extent, so a
+ * reader seeks to the extent and re-filters its records by key,
+ * rather than scanning the whole file.  A flow that is displaced from
+ * the writer's extent table and later returns simply produces several
+ * extents.
+ */
+
+#define PCAP_INDEX_MAGIC   0x78697066   /* "fpix", little endian */
+#define PCAP_INDEX_VERSION 1
+
+struct pcap_index_hdr {
+    uint32_t magic;
+    uint32_t version;
+};
+
+struct pcap_index_entry {
+    struct key k;        /* flow key of the extent                  */
+    uint64_t offset;     /* file offset of the extent's first record */
+    uint64_t length;     /* bytes through the extent's last record   */
+};
+
+/* an extent being accumulated by the writer; ip_vers == 0 marks a
+ * free slot */
+struct pcap_index_extent {
+    struct key k;
+    uint64_t start;
+    uint64_t end;
+};
+
+#define PCAP_INDEX_TABLE_LENGTH 4096   /* must be a power of two */
+
+/*
+ * pcap_index_key_from_packet() extracts the flow key of an ethernet
+ * frame, handling one VLAN tag; addresses are kept in network byte
+ * order, ports in host byte order.  Returns false for frames that do
+ * not carry an IP/TCP/UDP flow key; those are not indexed.
+ */
+static inline bool pcap_index_key_from_packet(const uint8_t *packet, size_t length, struct key *k) {
+    size_t offset = 14;
+
+    if (length < offset) {
+        return false;
+    }
+    uint16_t ethertype = ((uint16_t)packet[12] << 8) | packet[13];
+    if (ethertype == 0x8100) {          /* 802.1Q VLAN tag */
+        offset = 18;
+        if (length < offset) {
+            return false;
+        }
+        ethertype = ((uint16_t)packet[16] << 8) | packet[17];
+    }
+
+    uint8_t protocol;
+    size_t l4_offset;
+    if (ethertype == 0x0800) {          /* IPv4 */
+        if (length < offset + 20) {
+            return false;
+        }
+        size_t ihl = (packet[offset] & 0x0f) * 4;
+        if (ihl < 20 || length < offset + ihl) {
+            return false;
+        }
+        protocol = packet[offset + 9];
+        l4_offset = offset + ihl;
+        if (protocol != 6 && protocol != 17) {
+            return false;
+        }
+        if (length < l4_offset + 4) {
+            return false;
+        }
+        uint32_t src, dst;
+        memcpy(&src, packet + offset + 12, sizeof(src));
+        memcpy(&dst, packet + offset + 16, sizeof(dst));
+        uint16_t src_port = ((uint16_t)packet[l4_offset] << 8) | packet[l4_offset + 1];
+        uint16_t dst_port = ((uint16_t)packet[l4_offset + 2] << 8) | packet[l4_offset + 3];
+        *k = key{src_port, dst_port, src, dst, protocol};
+        return true;
+
+    } else if (ethertype == 0x86dd) {   /* IPv6; extension headers are not walked */
+        if (length < offset + 40) {
+            return false;
+        }
+        protocol = packet[offset + 6];
+        l4_offset = offset + 40;
+        if (protocol != 6 && protocol != 17) {
+            return false;
+        }
+        if (length < l4_offset + 4) {
+            return false;
+        }
+        ipv6_addr src, dst;
+        memcpy(&src, packet + offset + 8, sizeof(src));
+        memcpy(&dst, packet + offset + 24, sizeof(dst));
+        uint16_t src_port = ((uint16_t)packet[l4_offset] << 8) | packet[l4_offset + 1];
+        uint16_t dst_port = ((uint16_t)packet[l4_offset + 2] << 8) | packet[l4_offset + 3];
+        *k = key{src_port, dst_port, src, dst, protocol};
+        return true;
+    }
+
+    return false;
+}
+
+/*
+ * pcap_index_emit() appends the extent to the flow index sidecar and
+ * frees its slot; entries reach the disk through stdio buffering, so
+ * they are flushed in batches
+ */
+static inline void pcap_index_emit(FILE *index_file, struct pcap_index_extent *e) {
+    struct pcap_index_entry entry{};
+
+    entry.k = e->k;
+    entry.offset = e->start;
+    entry.length = e->end - e->start;
+    if (fwrite(&entry, sizeof(entry), 1, index_file) == 0) {
+        printf("warning: could not write flow index entry\n");
+    }
+    e->k = key{};
+}
+
+/*
+ * pcap_index_note() folds one packet record into its flow's open
+ * extent, first emitting (and displacing) a colliding extent; packets
+ * without an IP/TCP/UDP flow key are not indexed
+ */
+static inline void pcap_index_note(FILE *index_file,
+                                   struct pcap_index_extent *table,
+                                   const uint8_t *packet,
+                                   size_t length,
+                                   uint64_t offset,
+                                   uint64_t record_length) {
+    struct key k;
+
+    if (pcap_index_key_from_packet(packet, length, &k) == false) {
+        return;
+    }
+    struct pcap_index_extent *e = &table[k.hash() & (PCAP_INDEX_TABLE_LENGTH - 1)];
+    if (e->k.ip_vers != 0 && !(e->k == k)) {
+        pcap_index_emit(index_file, e);
+    }
+    if (e->k.ip_vers == 0) {
+        e->k = k;
+        e->start = offset;
+    }
+    e->end = offset + record_length;
+}
+
+/*
+ * pcap_index_drain() emits every extent still open; called before the
+ * sidecar is closed
+ */
+static inline void pcap_index_drain(FILE *index_file, struct pcap_index_extent *table) {
+    for (int i = 0; i < PCAP_INDEX_TABLE_LENGTH; i++) {
+        if (table[i].k.ip_vers != 0) {
+            pcap_index_emit(index_file, &table[i]);
+        }
+    }
+}
+
+#endif /* PCAP_INDEX_H */
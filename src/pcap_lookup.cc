@@ -0,0 +1,261 @@
+/*
+ * pcap_lookup.cc
+ *
+ * offline tool that extracts one flow's packets from a pcap file
+ * written with --pcap-index, using the flow index sidecar
+ * ("<pcap file>.idx", format in pcap_index.h) to seek directly to the
+ * extents holding the flow instead of scanning the whole file; both
+ * directions of the flow are extracted
+ *
+ * usage: pcap_lookup input.pcap src_addr src_port dst_addr dst_port tcp|udp output.pcap
+ *
+ * build with "make pcap_lookup"
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <vector>
+#include <algorithm>
+
+#include "pcap_index.h"
+
+/* pcap file format structures, as in pcap_file_io.c */
+struct pcap_file_hdr {
+    uint32_t magic_number;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t  thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t network;
+};
+
+struct pcap_packet_hdr {
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t incl_len;
+    uint32_t orig_len;
+};
+
+#define PCAP_MAGIC 0xa1b2c3d4
+
+static int usage(const char *progname) {
+    fprintf(stderr, "usage: %s input.pcap src_addr src_port dst_addr dst_port tcp|udp output.pcap\n", progname);
+    return EXIT_FAILURE;
+}
+
+/*
+ * parse_flow_key() fills in the flow key described by the four
+ * address/port arguments and the protocol name; addresses may be IPv4
+ * or IPv6 (both must agree), and are kept in network byte order, as
+ * in pcap_index_key_from_packet()
+ */
+static bool parse_flow_key(struct key *k,
+                           const char *src_addr, const char *src_port,
+                           const char *dst_addr, const char *dst_port,
+                           const char *protocol) {
+    uint8_t proto;
+    if (strcmp(protocol, "tcp") == 0) {
+        proto = 6;
+    } else if (strcmp(protocol, "udp") == 0) {
+        proto = 17;
+    } else {
+        fprintf(stderr, "error: unknown protocol \"%s\" (expected tcp or udp)\n", protocol);
+        return false;
+    }
+    uint16_t sp = atoi(src_port);
+    uint16_t dp = atoi(dst_port);
+
+    uint32_t src4, dst4;
+    if (inet_pton(AF_INET, src_addr, &src4) == 1) {
+        if (inet_pton(AF_INET, dst_addr, &dst4) != 1) {
+            fprintf(stderr, "error: could not parse IPv4 address \"%s\"\n", dst_addr);
+            return false;
+        }
+        *k = key{sp, dp, src4, dst4, proto};
+        return true;
+    }
+
+    ipv6_addr src6, dst6;
+    if (inet_pton(AF_INET6, src_addr, &src6) != 1) {
+        fprintf(stderr, "error: could not parse address \"%s\"\n", src_addr);
+        return false;
+    }
+    if (inet_pton(AF_INET6, dst_addr, &dst6) != 1) {
+        fprintf(stderr, "error: could not parse IPv6 address \"%s\"\n", dst_addr);
+        return false;
+    }
+    *k = key{sp, dp, src6, dst6, proto};
+    return true;
+}
+
+/* reverse_flow_key() returns the key of the flow's other direction */
+static struct key reverse_flow_key(const struct key &k) {
+    struct key r;
+    r.src_port = k.dst_port;
+    r.dst_port = k.src_port;
+    r.protocol = k.protocol;
+    r.ip_vers = k.ip_vers;
+    if (k.ip_vers == 4) {
+        r.addr.ipv4.src = k.addr.ipv4.dst;
+        r.addr.ipv4.dst = k.addr.ipv4.src;
+    } else {
+        r.addr.ipv6.src = k.addr.ipv6.dst;
+        r.addr.ipv6.dst = k.addr.ipv6.src;
+    }
+    return r;
+}
+
+/* a half-open range of packet records within the input file */
+struct extent_range {
+    uint64_t start;
+    uint64_t end;
+};
+
+/*
+ * extract_range() seeks to one range of the input file, walks the
+ * packet records within it, and copies those whose flow key matches
+ * either direction of the query to the output file; records of other
+ * flows interleaved in the range are skipped.  Returns the number of
+ * packets copied, or -1 on a malformed record.
+ */
+static long extract_range(FILE *in, FILE *out,
+                          const struct extent_range &range,
+                          const struct key &k, const struct key &rk) {
+    static uint8_t packet[65536];
+    long packets_copied = 0;
+
+    if (fseek(in, range.start, SEEK_SET) != 0) {
+        perror("error: could not seek to extent");
+        return -1;
+    }
+    uint64_t remaining = range.end - range.start;
+    while (remaining >= sizeof(struct pcap_packet_hdr)) {
+        struct pcap_packet_hdr hdr;
+        if (fread(&hdr, sizeof(hdr), 1, in) == 0) {
+            fprintf(stderr, "error: could not read packet header within extent\n");
+            return -1;
+        }
+        if (hdr.incl_len > sizeof(packet) || sizeof(hdr) + hdr.incl_len > remaining) {
+            fprintf(stderr, "error: malformed packet record within extent\n");
+            return -1;
+        }
+        if (fread(packet, 1, hdr.incl_len, in) != hdr.incl_len) {
+            fprintf(stderr, "error: could not read packet data within extent\n");
+            return -1;
+        }
+        remaining -= sizeof(hdr) + hdr.incl_len;
+
+        struct key pkt_key;
+        if (pcap_index_key_from_packet(packet, hdr.incl_len, &pkt_key)
+            && (pkt_key == k || pkt_key == rk)) {
+            if (fwrite(&hdr, sizeof(hdr), 1, out) == 0
+                || fwrite(packet, 1, hdr.incl_len, out) != hdr.incl_len) {
+                perror("error: could not write packet to output file");
+                return -1;
+            }
+            packets_copied++;
+        }
+    }
+    return packets_copied;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 8) {
+        return usage(argv[0]);
+    }
+    const char *pcap_name = argv[1];
+    const char *out_name = argv[7];
+
+    struct key k;
+    if (parse_flow_key(&k, argv[2], argv[3], argv[4], argv[5], argv[6]) == false) {
+        return EXIT_FAILURE;
+    }
+    struct key rk = reverse_flow_key(k);
+
+    /* open the index sidecar and verify its header */
+    char index_name[4096];
+    snprintf(index_name, sizeof(index_name), "%s.idx", pcap_name);
+    FILE *index_file = fopen(index_name, "r");
+    if (index_file == NULL) {
+        fprintf(stderr, "error: could not open flow index file %s\n", index_name);
+        return EXIT_FAILURE;
+    }
+    struct pcap_index_hdr index_hdr;
+    if (fread(&index_hdr, sizeof(index_hdr), 1, index_file) == 0
+        || index_hdr.magic != PCAP_INDEX_MAGIC
+        || index_hdr.version != PCAP_INDEX_VERSION) {
+        fprintf(stderr, "error: %s is not a version %u flow index file\n", index_name, PCAP_INDEX_VERSION);
+        return EXIT_FAILURE;
+    }
+
+    /* open the pcap file and verify that it is native-endian classic
+     * pcap, which is the only format mercury writes */
+    FILE *in = fopen(pcap_name, "r");
+    if (in == NULL) {
+        fprintf(stderr, "error: could not open pcap file %s\n", pcap_name);
+        return EXIT_FAILURE;
+    }
+    struct pcap_file_hdr file_hdr;
+    if (fread(&file_hdr, sizeof(file_hdr), 1, in) == 0
+        || file_hdr.magic_number != PCAP_MAGIC) {
+        fprintf(stderr, "error: %s is not a native-endian pcap file\n", pcap_name);
+        return EXIT_FAILURE;
+    }
+
+    FILE *out = fopen(out_name, "w");
+    if (out == NULL) {
+        fprintf(stderr, "error: could not open output file %s\n", out_name);
+        return EXIT_FAILURE;
+    }
+    if (fwrite(&file_hdr, sizeof(file_hdr), 1, out) == 0) {
+        perror("error: could not write output file header");
+        return EXIT_FAILURE;
+    }
+
+    /*
+     * walk the index and collect the extents matching either
+     * direction of the flow; the two directions are indexed
+     * separately and usually overlap, so the extents are merged into
+     * disjoint ranges before extraction, and no record is copied
+     * twice
+     */
+    std::vector<extent_range> ranges;
+    struct pcap_index_entry entry;
+    while (fread(&entry, sizeof(entry), 1, index_file) == 1) {
+        if (entry.k == k || entry.k == rk) {
+            ranges.push_back({ entry.offset, entry.offset + entry.length });
+        }
+    }
+    fclose(index_file);
+    std::sort(ranges.begin(), ranges.end(),
+              [](const extent_range &a, const extent_range &b) { return a.start < b.start; });
+    std::vector<extent_range> merged;
+    for (const extent_range &r : ranges) {
+        if (!merged.empty() && r.start <= merged.back().end) {
+            merged.back().end = std::max(merged.back().end, r.end);
+        } else {
+            merged.push_back(r);
+        }
+    }
+
+    long packets_copied = 0;
+    for (const extent_range &r : merged) {
+        long count = extract_range(in, out, r, k, rk);
+        if (count < 0) {
+            return EXIT_FAILURE;
+        }
+        packets_copied += count;
+    }
+    fclose(in);
+    if (fclose(out) != 0) {
+        perror("error: could not close output file");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr, "%ld packet(s) copied from %zu extent(s) to %s\n", packets_copied, merged.size(), out_name);
+    return 0;
+}
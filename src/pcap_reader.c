@@ -7,6 +7,7 @@
 #include "output.h"
 #include "pkt_proc.h"
 #include "utils.h"
+#include "flow_snapshot.h"
 
 #define BILLION 1000000000L
 
@@ -17,6 +18,9 @@ enum status pcap_reader_thread_context_init_from_config(struct pcap_reader_threa
     char input_filename[MAX_FILENAME];
     tc->tnum = tnum;
 	tc->loop_count = cfg->loop_count;
+    tc->replay_rate = cfg->replay_rate;
+    tc->chunk_start = 0;
+    tc->chunk_end = 0;        /* process the whole file, unless a chunk is assigned */
     enum status status;
 
     tc->pkt_processor = pkt_proc_new_from_config(cfg, tnum, llq);
@@ -49,7 +53,11 @@ void *pcap_file_processing_thread_func(void *userdata) {
     struct pcap_reader_thread_context *tc = (struct pcap_reader_thread_context *)userdata;
     enum status status;
 
-    status = pcap_file_dispatch_pkt_processor(&tc->rf, tc->pkt_processor, tc->loop_count);
+    if (tc->chunk_end != 0) {
+        status = pcap_file_dispatch_pkt_processor_range(&tc->rf, tc->pkt_processor, tc->chunk_start, tc->chunk_end);
+    } else {
+        status = pcap_file_dispatch_pkt_processor(&tc->rf, tc->pkt_processor, tc->loop_count, tc->replay_rate);
+    }
     if (status) {
         printf("error in pcap file dispatch (code: %d)\n", (int)status);
         return NULL;
@@ -67,16 +75,65 @@ enum status open_and_dispatch(struct mercury_config *cfg, struct output_file *of
 
     timer_start(&t); // get timestamp before we start processing
 
-    struct pcap_reader_thread_context tc;
+    int max_readers = cfg->num_threads > 1 ? cfg->num_threads : 1;
+    struct pcap_reader_thread_context *tc = (struct pcap_reader_thread_context *)calloc(max_readers, sizeof(*tc));
+    if (tc == NULL) {
+        perror("could not allocate pcap reader thread contexts");
+        return status_err;
+    }
 
-    status = pcap_reader_thread_context_init_from_config(&tc, cfg, 0, &of->qs.queue[0]);
+    status = pcap_reader_thread_context_init_from_config(&tc[0], cfg, 0,
+                                                         cfg->separate_files ? NULL : &of->qs.queue[0]);
     if (status != status_ok) {
         if (errno) {
             perror("could not initialize pcap reader thread context");
         }
+        free(tc);
         return status;
     }
 
+    /*
+     * when several worker threads are configured and the file could
+     * be mapped, partition it into one chunk of packet records per
+     * thread; each chunk is processed by its own reader, and the
+     * per-thread output is merged (in timestamp order) by the usual
+     * output machinery.  Looping reads stay single threaded, as do
+     * paced replays, which follow the file's own timestamp order.
+     */
+    int num_readers = 1;
+    if (max_readers > 1 && cfg->loop_count == 1 && cfg->replay_rate <= 0.0 && tc[0].rf.mmap_base != NULL) {
+        size_t *offsets = (size_t *)calloc(max_readers, sizeof(size_t));
+        if (offsets != NULL) {
+            int nchunks = pcap_file_partition(&tc[0].rf, offsets, max_readers);
+            int i;
+            for (i = 1; i < nchunks; i++) {
+                status = pcap_reader_thread_context_init_from_config(&tc[i], cfg, i,
+                                                                     cfg->separate_files ? NULL : &of->qs.queue[i]);
+                if (status != status_ok || tc[i].rf.mmap_base == NULL) {
+                    if (status == status_ok) {
+                        pcap_reader_thread_context_finalize(&tc[i]);
+                    }
+                    break;   /* process the remaining chunks on the last reader */
+                }
+            }
+            num_readers = i;
+            for (i = 0; i < num_readers; i++) {
+                tc[i].chunk_start = offsets[i];
+                tc[i].chunk_end = (i + 1 < num_readers) ? offsets[i + 1] : tc[i].rf.mmap_length;
+            }
+            free(offsets);
+            if (cfg->verbosity && num_readers > 1) {
+                fprintf(stderr, "processing %s with %d reader thread(s)\n", cfg->read_filename, num_readers);
+            }
+        }
+    }
+
+    /* warm restart: re-seed each reader's TCP initial-message-filter
+     * table from the flow snapshot, if one was loaded */
+    for (int i = 0; i < num_readers; i++) {
+        flow_snapshot_restore_filter(tc[i].pkt_processor->filter());
+    }
+
     /* Wake up output thread so it's polling the queues waiting for data */
     of->t_output_p = 1;
     int err = pthread_cond_broadcast(&(of->t_output_c)); /* Wake up output */
@@ -86,23 +143,50 @@ enum status open_and_dispatch(struct mercury_config *cfg, struct output_file *of
     }
 
 #ifdef DONT_USE_THREADS
-    pcap_file_processing_thread_func(&tc);
+    for (int i = 0; i < num_readers; i++) {
+        pcap_file_processing_thread_func(&tc[i]);
+    }
 #else
-    err = pthread_create(&(tc.tid), NULL, pcap_file_processing_thread_func, &tc);
-    if (err) {
-        printf("%s: error creating file reader thread\n", strerror(err));
-        exit(255);
+    for (int i = 0; i < num_readers; i++) {
+        err = pthread_create(&(tc[i].tid), NULL, pcap_file_processing_thread_func, &tc[i]);
+        if (err) {
+            printf("%s: error creating file reader thread\n", strerror(err));
+            exit(255);
+        }
+    }
+    for (int i = 0; i < num_readers; i++) {
+        pthread_join(tc[i].tid, NULL);
     }
-    pthread_join(tc.tid, NULL);
 #endif
     //    struct pkt_proc_stats pkt_stats = tc.pkt_processor->get_stats();
-    bytes_written = tc.pkt_processor->bytes_written;
-    packets_written = tc.pkt_processor->packets_written;
-    pcap_reader_thread_context_finalize(&tc);
+    for (int i = 0; i < num_readers; i++) {
+        bytes_written += tc[i].pkt_processor->bytes_written;
+        packets_written += tc[i].pkt_processor->packets_written;
+        flow_snapshot_note_filter(tc[i].pkt_processor->filter());
+        pcap_reader_thread_context_finalize(&tc[i]);
+    }
+    free(tc);
 
     nano_seconds = timer_stop(&t);
     double byte_rate = ((double)bytes_written * BILLION) / (double)nano_seconds;
 
+    if (cfg->replay_rate >= 0.0) {
+        /*
+         * replay report: the achieved packet rate, and the records
+         * each worker dropped (or stalled on) at its output queue,
+         * which are the points where an overloaded configuration
+         * sheds load
+         */
+        double packet_rate = ((double)packets_written * BILLION) / (double)nano_seconds;
+        fprintf(stderr, "replay: %" PRIu64 " packets (%" PRIu64 " bytes) in %.3f seconds: %.0f packets/sec, %.4e bytes/sec\n",
+                packets_written, bytes_written, (double)nano_seconds / BILLION, packet_rate, byte_rate);
+        for (int i = 0; i < of->qs.qnum; i++) {
+            struct ll_queue *q = &of->qs.queue[i];
+            fprintf(stderr, "replay: queue %d: %" PRIu64 " records dropped at full ring, %" PRIu64 " usec stalled\n",
+                    i, q->enqueue_drops, q->stall_usec);
+        }
+    }
+
     if (cfg->write_filename && cfg->verbosity) {
         fprintf(stderr, "For all files, packets written: %" PRIu64 ", bytes written: %" PRIu64 ", nano sec: %" PRIu64 ", bytes per second: %.4e\n",
                packets_written, bytes_written, nano_seconds, byte_rate);
@@ -22,6 +22,9 @@ struct pcap_reader_thread_context {
     pthread_t tid;            /* Thread ID */
     struct pcap_file rf;
     int loop_count;           /* loop count */
+    double replay_rate;       /* replay speed multiple; <= 0 means no pacing */
+    size_t chunk_start;       /* chunk bounds within a mapped file; */
+    size_t chunk_end;         /* end == 0 means the whole file      */
 };
 
 enum status pcap_reader_thread_context_init_from_config(struct pcap_reader_thread_context *tc,
@@ -0,0 +1,371 @@
+/*
+ * pipeline_bench.cc
+ *
+ * whole-pipeline benchmark: runs capture-through-output in-process --
+ * worker threads parse and serialize a canned corpus into the
+ * lockless queues, and the regular output thread merges the queues
+ * and writes the records -- over a reference workload matrix, and
+ * emits one scorecard JSON record per cell: packets/sec, records/sec,
+ * per-packet processing latency percentiles, drops by cause, and peak
+ * RSS.  The pieces measured individually by "make benchmark" compose
+ * here, so queue sizing, output batching, and serialization costs are
+ * all inside the measurement.
+ *
+ * usage: pipeline_bench [--packets <num>] [<pcap file> ... ]
+ *
+ * The matrix crosses the workloads -- two built-in synthetic mixes
+ * (see traffic_gen.h), plus any pcap files given on the command line
+ * -- with one worker thread and one worker per CPU.  Each cell runs
+ * in a forked child, so its peak RSS and per-thread state are its
+ * own; the same workload measured twice runs the same packets in the
+ * same order.
+ *
+ * The latency percentiles come from the output thread's
+ * capture-to-write histogram (see llq.h): each record's latency spans
+ * from the moment its packet entered the pipeline to the merge pass
+ * that wrote it, so queueing and output batching are inside the
+ * number, not just parsing.
+ *
+ * build with "make pipeline_bench"; "make benchmark-pipeline" runs
+ * the reference matrix
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <string>
+#include <vector>
+
+#include "mercury.h"
+#include "output.h"
+#include "pkt_proc.h"
+#include "pcap_file_io.h"
+#include "traffic_gen.h"
+#include "llq.h"
+
+extern struct global_variables global_vars;  /* defined in config.c */
+
+static inline uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * a workload corpus: packets loaded from a pcap file or generated
+ * from a synthetic mix, held in one buffer and replayed in order
+ */
+struct corpus_packet {
+    size_t offset;
+    uint32_t length;
+};
+
+struct bench_corpus {
+    std::string label;
+    std::vector<uint8_t> data;
+    std::vector<struct corpus_packet> packets;
+    uint64_t bytes = 0;
+
+    void append(const uint8_t *pkt, size_t length) {
+        struct corpus_packet p;
+        p.offset = data.size();
+        p.length = length;
+        data.insert(data.end(), pkt, pkt + length);
+        packets.push_back(p);
+        bytes += length;
+    }
+};
+
+static void corpus_append_packet(void *userdata, uint8_t *pkt, size_t length) {
+    ((struct bench_corpus *)userdata)->append(pkt, length);
+}
+
+static int corpus_from_pcap(struct bench_corpus *corpus, const char *filename) {
+    struct pcap_file f;
+    if (pcap_file_open(&f, filename, io_direction_reader, 0) != status_ok) {
+        fprintf(stderr, "error: could not open pcap file %s\n", filename);
+        return -1;
+    }
+    uint8_t packet_data[65536];
+    struct pcap_pkthdr pkthdr;
+    while (pcap_file_read_packet(&f, &pkthdr, packet_data) == status_ok) {
+        corpus->append(packet_data, pkthdr.caplen);
+    }
+    pcap_file_close(&f);
+    corpus->label = filename;
+    return corpus->packets.empty() ? -1 : 0;
+}
+
+static int corpus_from_mix(struct bench_corpus *corpus, const char *label,
+                           const struct traffic_gen_config *gc) {
+    if (traffic_gen_generate(gc, corpus_append_packet, corpus) != status_ok) {
+        fprintf(stderr, "error: could not generate synthetic corpus %s\n", label);
+        return -1;
+    }
+    corpus->label = label;
+    return 0;
+}
+
+/*
+ * one worker thread of a matrix cell: replays the corpus through its
+ * own packet processor for the configured number of loops, exactly as
+ * a capture or file-reader thread would.  Each packet is stamped with
+ * the wall clock as it enters the pipeline (as the synthetic
+ * generator does), so the output thread's capture-to-write latency
+ * histogram (see llq.h) measures the whole pipeline per record.
+ */
+struct bench_worker {
+    pthread_t tid;
+    int tnum;
+    struct mercury_config *cfg;
+    struct ll_queue *llq;
+    const struct bench_corpus *corpus;
+    unsigned int loops;
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+};
+
+static void *bench_worker_func(void *arg) {
+    struct bench_worker *w = (struct bench_worker *)arg;
+
+    struct pkt_proc *processor = pkt_proc_new_from_config(w->cfg, w->tnum, w->llq);
+    if (processor == NULL) {
+        fprintf(stderr, "error: could not initialize packet processor\n");
+        return NULL;
+    }
+    const struct bench_corpus *c = w->corpus;
+    struct packet_info pi;
+    for (unsigned int loop = 0; loop < w->loops; loop++) {
+        for (size_t i = 0; i < c->packets.size(); i++) {
+            uint8_t *pkt = (uint8_t *)c->data.data() + c->packets[i].offset;
+            /* wait for ring space before parsing, as the blocking
+             * producers do (see pcap_queue_write()), so the scorecard
+             * measures sustainable throughput rather than how fast
+             * records can be dropped at a full ring; the wait shows
+             * up in the stall_usec counter */
+            while (llq_write_slot(w->llq) == NULL) {
+                usleep(50);
+                w->llq->stall_usec += 50;
+            }
+            clock_gettime(CLOCK_REALTIME, &pi.ts);
+            pi.caplen = c->packets[i].length;
+            pi.len = c->packets[i].length;
+            processor->apply(&pi, pkt);
+        }
+    }
+    processor->flush();
+    w->packets = (uint64_t)c->packets.size() * w->loops;
+    w->bytes = c->bytes * w->loops;
+    delete processor;
+    return NULL;
+}
+
+/*
+ * count the newline-terminated records the output thread wrote
+ */
+static uint64_t count_records(const char *filename) {
+    FILE *f = fopen(filename, "r");
+    if (f == NULL) {
+        return 0;
+    }
+    uint64_t records = 0;
+    char buf[65536];
+    size_t bytes;
+    while ((bytes = fread(buf, 1, sizeof(buf), f)) > 0) {
+        for (size_t i = 0; i < bytes; i++) {
+            if (buf[i] == '\n') {
+                records++;
+            }
+        }
+    }
+    fclose(f);
+    return records;
+}
+
+/*
+ * run_cell(corpus, threads, target_packets) runs one matrix cell --
+ * the full pipeline over the corpus, looped until roughly
+ * target_packets have been processed -- and prints its scorecard
+ * record; it runs in a forked child of main()
+ */
+static int run_cell(const struct bench_corpus *corpus, int threads, uint64_t target_packets) {
+
+    char outfile[MAX_FILENAME];
+    snprintf(outfile, sizeof(outfile), "/tmp/pipeline_bench.%d.json", getpid());
+    unlink(outfile);
+
+    struct mercury_config cfg = mercury_config_init();
+    cfg.fingerprint_filename = outfile;
+    cfg.num_threads = threads;
+    global_vars.metadata_output = true;   /* the reference workload carries metadata */
+
+    pthread_t output_thread;
+    struct output_file out_file;
+    if (output_thread_init(output_thread, out_file, cfg) != 0) {
+        fprintf(stderr, "error: unable to initialize output thread\n");
+        return -1;
+    }
+
+    uint64_t per_worker = target_packets / threads;
+    unsigned int loops = per_worker / corpus->packets.size();
+    if (loops == 0) {
+        loops = 1;
+    }
+    std::vector<struct bench_worker> workers(threads);
+    for (int i = 0; i < threads; i++) {
+        workers[i].tnum = i;
+        workers[i].cfg = &cfg;
+        workers[i].llq = &out_file.qs.queue[i];
+        workers[i].corpus = corpus;
+        workers[i].loops = loops;
+    }
+
+    /* wake the output thread, as open_and_dispatch() does */
+    out_file.t_output_p = 1;
+    int err = pthread_cond_broadcast(&out_file.t_output_c);
+    if (err != 0) {
+        fprintf(stderr, "%s: error broadcasting all clear on output start condition\n", strerror(err));
+        return -1;
+    }
+
+    uint64_t start_ns = monotonic_ns();
+    for (int i = 0; i < threads; i++) {
+        err = pthread_create(&workers[i].tid, NULL, bench_worker_func, &workers[i]);
+        if (err != 0) {
+            fprintf(stderr, "%s: error creating benchmark worker thread\n", strerror(err));
+            return -1;
+        }
+    }
+    uint64_t packets = 0, bytes = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i].tid, NULL);
+        packets += workers[i].packets;
+        bytes += workers[i].bytes;
+    }
+    uint64_t process_ns = monotonic_ns() - start_ns;
+
+    /* snapshot the drop counters before teardown frees the queues */
+    uint64_t ring_full = 0, truncated = 0, filtered = 0, stall_usec = 0;
+    for (int i = 0; i < out_file.qs.qnum; i++) {
+        ring_full += out_file.qs.queue[i].enqueue_drops;
+        truncated += out_file.qs.queue[i].truncated;
+        filtered += out_file.qs.queue[i].filtered;
+        stall_usec += out_file.qs.queue[i].stall_usec;
+    }
+
+    /* the capture-to-write latency histogram (out_file.qs.latency) is
+     * embedded in the output context, so it remains readable after
+     * the teardown frees the queue rings */
+    output_thread_finalize(output_thread, &out_file);
+    uint64_t total_ns = monotonic_ns() - start_ns;
+
+    uint64_t records = count_records(outfile);
+    unlink(outfile);
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+
+    fprintf(stdout,
+            "{\"pipeline_benchmark\":{\"workload\":\"%s\",\"threads\":%d,"
+            "\"packets\":%" PRIu64 ",\"bytes\":%" PRIu64 ",\"packets_per_sec\":%.0f,"
+            "\"records\":%" PRIu64 ",\"records_per_sec\":%.0f,"
+            "\"latency_ns\":{\"p50\":%" PRIu64 ",\"p99\":%" PRIu64 ",\"p999\":%" PRIu64 "},"
+            "\"drops\":{\"ring_full\":%" PRIu64 ",\"truncated\":%" PRIu64 "},"
+            "\"filtered\":%" PRIu64 ",\"stall_usec\":%" PRIu64 ",\"peak_rss_kb\":%ld}}\n",
+            corpus->label.c_str(),
+            threads,
+            packets,
+            bytes,
+            process_ns ? (double)packets * 1000000000 / process_ns : 0.0,
+            records,
+            total_ns ? (double)records * 1000000000 / total_ns : 0.0,
+            latency_histogram_percentile(&out_file.qs.latency, NULL, 0.50),
+            latency_histogram_percentile(&out_file.qs.latency, NULL, 0.99),
+            latency_histogram_percentile(&out_file.qs.latency, NULL, 0.999),
+            ring_full,
+            truncated,
+            filtered,
+            stall_usec,
+            ru.ru_maxrss);
+    fflush(stdout);
+    return 0;
+}
+
+#define PIPELINE_BENCH_TARGET_PACKETS 2000000
+#define PIPELINE_BENCH_CORPUS_PACKETS 65536
+
+int main(int argc, char *argv[]) {
+
+    uint64_t target_packets = PIPELINE_BENCH_TARGET_PACKETS;
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "--packets") == 0) {
+        if (arg + 1 >= argc) {
+            fprintf(stderr, "error: option 'packets' needs an argument\n");
+            return EXIT_FAILURE;
+        }
+        target_packets = strtoull(argv[arg+1], NULL, 10);
+        if (target_packets == 0) {
+            fprintf(stderr, "error: option 'packets' needs a positive argument\n");
+            return EXIT_FAILURE;
+        }
+        arg += 2;
+    }
+
+    /* the reference workloads: the default synthetic mix, a mix of
+     * nothing but distinct TLS ClientHellos (the most serialization
+     * work per packet), and any pcap files given on the command line */
+    std::vector<struct bench_corpus> corpora(2);
+    struct traffic_gen_config gc = traffic_gen_config_init();
+    gc.packets = PIPELINE_BENCH_CORPUS_PACKETS;
+    if (corpus_from_mix(&corpora[0], "synthetic-default", &gc) < 0) {
+        return EXIT_FAILURE;
+    }
+    gc.tls_weight = 100;
+    gc.http_weight = 0;
+    gc.dns_weight = 0;
+    gc.ssh_weight = 0;
+    gc.fingerprints = 64;
+    gc.snis = 256;
+    if (corpus_from_mix(&corpora[1], "synthetic-tls-heavy", &gc) < 0) {
+        return EXIT_FAILURE;
+    }
+    for (; arg < argc; arg++) {
+        corpora.emplace_back();
+        if (corpus_from_pcap(&corpora.back(), argv[arg]) < 0) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    int num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_cpus < 1) {
+        num_cpus = 1;
+    }
+
+    int thread_counts[2] = { 1, num_cpus };
+    int num_counts = (num_cpus > 1) ? 2 : 1;
+
+    int retval = EXIT_SUCCESS;
+    for (const auto &corpus : corpora) {
+        for (int t = 0; t < num_counts; t++) {
+            int threads = thread_counts[t];
+            fflush(stdout);             /* don't replicate buffered output into the child */
+            pid_t pid = fork();
+            if (pid == 0) {
+                exit(run_cell(&corpus, threads, target_packets) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+            int wstatus = 0;
+            if (pid < 0 || waitpid(pid, &wstatus, 0) < 0
+                || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != EXIT_SUCCESS) {
+                fprintf(stderr, "error: benchmark cell %s/%d failed\n", corpus.label.c_str(), threads);
+                retval = EXIT_FAILURE;
+            }
+        }
+    }
+    return retval;
+}
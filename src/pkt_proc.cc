@@ -6,6 +6,9 @@
  */
 
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "extractor.h"
 #include "pcap_file_io.h"
 #include "json_file_io.h"
@@ -15,12 +18,59 @@
 #include "utils.h"
 #include "llq.h"
 
+extern struct global_variables global_vars;  /* defined in config.c */
+
 /*
- * packet_filter_threshold is a (somewhat arbitrary) threshold used in
- * the packet metadata filter; it will probably get eliminated soon,
- * in favor of extractor::proto_state::state, but for now it remains
+ * the ring pcap writer threads all append to a single file
+ * descriptor, so that O_APPEND keeps their writev() calls from
+ * interleaving; the first thread to arrive creates the file and
+ * writes the pcap file header, and the descriptor is closed when the
+ * last writer is deleted
  */
-unsigned int packet_filter_threshold = 7;
+static pthread_mutex_t ring_pcap_file_lock = PTHREAD_MUTEX_INITIALIZER;
+static int ring_pcap_file_fd = -1;
+static unsigned int ring_pcap_file_refcount = 0;
+
+int ring_pcap_file_open(const char *fname) {
+    pthread_mutex_lock(&ring_pcap_file_lock);
+    if (ring_pcap_file_fd < 0) {
+        ring_pcap_file_fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+        if (ring_pcap_file_fd < 0) {
+            printf("%s: error opening pcap file %s\n", strerror(errno), fname);
+            pthread_mutex_unlock(&ring_pcap_file_lock);
+            return -1;
+        }
+        if (write_pcap_file_header_fd(ring_pcap_file_fd) != status_ok) {
+            close(ring_pcap_file_fd);
+            ring_pcap_file_fd = -1;
+            pthread_mutex_unlock(&ring_pcap_file_lock);
+            return -1;
+        }
+    }
+    ring_pcap_file_refcount++;
+    int fd = ring_pcap_file_fd;
+    pthread_mutex_unlock(&ring_pcap_file_lock);
+    return fd;
+}
+
+void ring_pcap_file_close(int fd) {
+    pthread_mutex_lock(&ring_pcap_file_lock);
+    if (fd == ring_pcap_file_fd && --ring_pcap_file_refcount == 0) {
+        close(ring_pcap_file_fd);
+        ring_pcap_file_fd = -1;
+    }
+    pthread_mutex_unlock(&ring_pcap_file_lock);
+}
+
+bool pkt_proc_uses_ring_pcap_writer(const struct mercury_config *cfg) {
+    return cfg->write_filename != NULL
+        && cfg->fingerprint_filename == NULL /* dual output needs the JSON queues (see below) */
+        && cfg->capture_interface != NULL
+        && cfg->use_xdp == false             /* XDP frames are recycled as soon as apply() returns   */
+        && cfg->rotate == 0                  /* file rotation is done by the output thread           */
+        && cfg->gzip_output == false         /* as is gzip framing                                   */
+        && global_vars.pcap_index == false;  /* O_APPEND writers do not know their record offsets    */
+}
 
 struct pkt_proc *pkt_proc_new_from_config(struct mercury_config *cfg,
                                           int tnum,
@@ -42,17 +92,47 @@ struct pkt_proc *pkt_proc_new_from_config(struct mercury_config *cfg,
                 fprintf(stderr, "initializing thread function %x with filename %s\n", pid, outfile);
             }
 
+            if (cfg->fingerprint_filename) {
+                /*
+                 * dual output (-f and -w): one datum-based parse feeds
+                 * the JSON record queue and decides the pcap write, in
+                 * place of the legacy second parse through
+                 * packet_filter_extract; the output thread writes the
+                 * JSON file, and the workers append matched packets to
+                 * the capture file themselves
+                 */
+                return new pkt_proc_block<pkt_proc_json_pcap_writer_llq>(llq, outfile, cfg->packet_filter_cfg,
+                                                         cfg->flow_budget_bytes, cfg->flow_budget_packets);
+            }
+
+            if (pkt_proc_uses_ring_pcap_writer(cfg)) {
+                /*
+                 * live capture appends matched packets to the file
+                 * straight from the ring, with writev() called from
+                 * block_boundary() before each block is returned to
+                 * the kernel; there is no output thread on this path
+                 */
+                if (cfg->filter) {
+                    return new pkt_proc_block<pkt_proc_filter_pcap_writer_ring>(outfile, cfg->packet_filter_cfg,
+                                                                cfg->flow_budget_bytes, cfg->flow_budget_packets);
+                }
+                return new pkt_proc_block<pkt_proc_pcap_writer_ring>(outfile,
+                                                     cfg->flow_budget_bytes, cfg->flow_budget_packets);
+            }
+
             if (cfg->filter) {
                 /*
                  * write only packet metadata (TLS clientHellos, TCP SYNs, ...) to capture file
                  */
-                return new pkt_proc_filter_pcap_writer_llq(llq, cfg->packet_filter_cfg, cfg->output_block);
+                return new pkt_proc_block<pkt_proc_filter_pcap_writer_llq>(llq, cfg->packet_filter_cfg, cfg->output_block,
+                                                           cfg->flow_budget_bytes, cfg->flow_budget_packets);
 
             } else {
                 /*
                  * write all packets to capture file
                  */
-                return new pkt_proc_pcap_writer_llq(llq, cfg->output_block);
+                return new pkt_proc_block<pkt_proc_pcap_writer_llq>(llq, cfg->output_block,
+                                                    cfg->flow_budget_bytes, cfg->flow_budget_packets);
 
             }
 
@@ -61,7 +141,21 @@ struct pkt_proc *pkt_proc_new_from_config(struct mercury_config *cfg,
              * write fingerprints into output file
              */
 
-            return new pkt_proc_json_writer_llq(llq, cfg->packet_filter_cfg);
+            if (cfg->separate_files) {
+                /*
+                 * each thread writes its own file, named by appending
+                 * the thread number, and there is no output thread
+                 */
+                char tnum_str[MAX_HEX];
+                snprintf(tnum_str, MAX_HEX, "%d", tnum);
+                status = filename_append(outfile, cfg->fingerprint_filename, "-", tnum_str);
+                if (status) {
+                    throw "error in filename";
+                }
+                return new pkt_proc_block<pkt_proc_json_writer>(outfile, cfg->mode, cfg->rotate, cfg->packet_filter_cfg);
+            }
+
+            return new pkt_proc_block<pkt_proc_json_writer_llq>(llq, cfg->packet_filter_cfg);
 
         }
         // note: we no longer have a 'packet dumper' option
@@ -10,9 +10,13 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <errno.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include "pcap_file_io.h"
+#include "pcap_index.h"    // for pcap_index_key_from_packet()
 #include "json_file_io.h"
+#include "llq.h"
 #include "extractor.h"
 #include "packet.h"
 #include "rnd_pkt_drop.h"
@@ -40,6 +44,37 @@ struct pkt_proc_stats {
 struct pkt_proc {
     virtual void apply(struct packet_info *pi, uint8_t *eth) = 0;
     virtual void flush() = 0;
+
+    /*
+     * apply_block() applies the processor to each of the count
+     * packets gathered from a ring block, in a single virtual call;
+     * the default implementation just loops over apply(), and the
+     * pkt_proc_block template below overrides it with a loop compiled
+     * against one concrete processor, so that the virtual dispatch is
+     * paid once per block instead of once per packet
+     */
+    virtual void apply_block(struct packet_info *pi, uint8_t **frames, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            apply(&pi[i], frames[i]);
+        }
+    }
+
+    /*
+     * block_boundary() is called by the packet capture code after all
+     * of the packets in a ring block have been applied, and before
+     * the block is returned to the kernel; a processor that holds
+     * references into the mapped block (see the ring pcap writers)
+     * must write them out here, while the frame data is still valid
+     */
+    virtual void block_boundary() { }
+
+    /*
+     * filter() exposes the processor's packet filter, if it has one,
+     * so that the flow-state snapshot (--flow-snapshot) can reach the
+     * per-worker flow tables from outside the processor
+     */
+    virtual struct packet_filter *filter() { return NULL; }
+
     virtual ~pkt_proc() {};
     size_t bytes_written = 0;
     size_t packets_written = 0;
@@ -54,7 +89,10 @@ struct pkt_proc {
 struct pkt_proc_json_writer_llq : public pkt_proc {
     struct ll_queue *llq;
     struct packet_filter pf;
-    // struct tcp_reassembler reassembler;
+
+    struct packet_filter *filter() override { return &pf; }
+    // tcp reassembly is handled by the per-thread tcp_reassembler in
+    // json_file_io.c, alongside the other per-worker packet state
 
     /*
      * pkt_proc_json_writer(outfile_name, mode, max_records)
@@ -66,7 +104,7 @@ struct pkt_proc_json_writer_llq : public pkt_proc {
      * records (lines) per file; after that limit is reached, file
      * rotation will take place.
      */
-    explicit pkt_proc_json_writer_llq(struct ll_queue *llq_ptr, const char *filter) { //: reassembler{} {
+    explicit pkt_proc_json_writer_llq(struct ll_queue *llq_ptr, const char *filter) {
         llq = llq_ptr;
         if (packet_filter_init(&pf, filter) == status_err) {
             throw "could not initialize packet filter";
@@ -78,7 +116,145 @@ struct pkt_proc_json_writer_llq : public pkt_proc {
     }
 
     void flush() override {
+        json_queue_flush(llq);   /* send any records held by flow aggregation */
+    }
+};
+
+/*
+ * struct pkt_proc_packet_forwarder_llq is the first stage of the
+ * two-stage pipeline (--serialize-threads): apply() copies the raw
+ * frame and its timestamp into this worker's parse queue, and a
+ * serializer thread (serializer.c) parses and serializes it from
+ * there, so that a serialization-heavy packet never stalls ring
+ * consumption.  A frame that does not fit in a queue slot is counted
+ * against the record size cap, and a frame arriving at a full queue
+ * is counted as an enqueue drop, just as on the serialization side.
+ */
+struct pkt_proc_packet_forwarder_llq : public pkt_proc {
+    struct ll_queue *llq;
+
+    explicit pkt_proc_packet_forwarder_llq(struct ll_queue *llq_ptr) {
+        llq = llq_ptr;
+    }
+
+    void apply(struct packet_info *pi, uint8_t *eth) override {
+        if (pi->caplen > LLQ_MSG_SIZE) {
+            llq->truncated++;    /* the frame outgrows a queue slot */
+            return;
+        }
+        struct llq_msg *msg = llq_write_slot(llq);
+        if (msg == NULL) {
+            llq->enqueue_drops++;
+            return;
+        }
+        msg->ts = pi->ts;
+        memcpy(llq_msg_buf(msg), eth, pi->caplen);
+        msg->len = pi->caplen;
+        llq_publish(llq, msg);
+    }
+
+    void flush() override {
+        /* flow aggregation state lives on the serializer threads */
+    }
+};
+
+/*
+ * struct pkt_proc_json_writer writes a JSON representation of
+ * fingerprints, metadata, flow keys, and event time directly into its
+ * own output file, with no queue and no output thread; each worker
+ * gets its own file (--separate-files), so the tournament merge is
+ * not a serialization point and threads scale independently.  The
+ * records within each file are in order, but cross-file ordering is
+ * left to downstream processing.
+ */
+struct pkt_proc_json_writer : public pkt_proc {
+    struct json_file jf;
+    struct packet_filter pf;
+
+    struct packet_filter *filter() override { return &pf; }
+
+    /*
+     * pkt_proc_json_writer(outfile_name, mode, max_records, filter)
+     * opens the file with the path outfile_name with the given mode;
+     * if max_records is nonzero it defines the number of records per
+     * file before rotation takes place
+     */
+    pkt_proc_json_writer(const char *outfile_name,
+                         const char *mode,
+                         uint64_t max_records,
+                         const char *filter) {
+        if (packet_filter_init(&pf, filter) == status_err) {
+            throw "could not initialize packet filter";
+        }
+        if (json_file_init(&jf, outfile_name, mode, max_records) == status_err) {
+            throw "could not initialize output file";
+        }
+    }
+
+    void apply(struct packet_info *pi, uint8_t *eth) override {
+        json_file_write(&jf, eth, pi->len, pi->ts.tv_sec, pi->ts.tv_nsec);
+    }
+
+    void flush() override {
+        json_file_flush(&jf);    /* write any records held by flow aggregation */
+        fflush(jf.file);
+    }
+
+    ~pkt_proc_json_writer() {
+        json_file_finalize(&jf);
+    }
+};
+
+/*
+ * struct flow_budget enforces the per-flow capture budgets
+ * (--flow-budget-bytes, --flow-budget-packets) on the pcap writer
+ * path: each flow direction's first packets pass until either budget
+ * is spent, and its later packets are suppressed.  The table is
+ * direct mapped and keyed by flow; a colliding flow displaces the
+ * previous one, which then starts over with a fresh budget if it
+ * returns, so collisions only ever cause extra packets to be written.
+ */
+struct flow_budget {
+    static const size_t table_length = 8192;   /* must be a power of two */
+    struct entry {
+        struct key k;
+        uint64_t packets;
+        uint64_t bytes;
+    };
+    struct entry *table;     // heap allocated; the table is large
+    uint64_t max_bytes;      /* bytes allowed per flow, or 0 (no limit)   */
+    uint64_t max_packets;    /* packets allowed per flow, or 0 (no limit) */
+
+    flow_budget(uint64_t byte_limit, uint64_t packet_limit) :
+        table{nullptr}, max_bytes{byte_limit}, max_packets{packet_limit} {
+        if (enabled()) {
+            table = new entry[table_length]();
+        }
+    }
+    ~flow_budget() { delete[] table; }
+
+    bool enabled() const { return max_bytes != 0 || max_packets != 0; }
 
+    /* returns true if the packet fits within its flow's budget, and
+     * charges the flow for it; packets without a flow key always pass */
+    bool pass(const uint8_t *packet, size_t length) {
+        struct key k;
+        if (pcap_index_key_from_packet(packet, length, &k) == false) {
+            return true;
+        }
+        struct entry *e = &table[k.hash() & (table_length - 1)];
+        if (e->k.ip_vers == 0 || !(e->k == k)) {
+            e->k = k;        /* new flow, or a collision displacing the old one */
+            e->packets = 0;
+            e->bytes = 0;
+        }
+        if ((max_packets && e->packets >= max_packets)
+            || (max_bytes && e->bytes >= max_bytes)) {
+            return false;    /* budget spent; suppress this packet */
+        }
+        e->packets++;
+        e->bytes += length;
+        return true;
     }
 };
 
@@ -89,16 +265,22 @@ struct pkt_proc_json_writer_llq : public pkt_proc {
 struct pkt_proc_pcap_writer_llq : public pkt_proc {
     struct ll_queue *llq;
     bool block;
+    struct flow_budget budget;
 
-    explicit pkt_proc_pcap_writer_llq(struct ll_queue *llq_ptr, bool blocking) : block{blocking} {
+    explicit pkt_proc_pcap_writer_llq(struct ll_queue *llq_ptr, bool blocking,
+                                      uint64_t budget_bytes, uint64_t budget_packets) :
+        block{blocking}, budget{budget_bytes, budget_packets} {
         llq = llq_ptr;
     }
 
     void apply(struct packet_info *pi, uint8_t *eth) override {
         extern int rnd_pkt_drop_percent_accept;  /* defined in rnd_pkt_drop.c */
 
-        if (rnd_pkt_drop_percent_accept && drop_this_packet()) {
-            return;  /* random packet drop configured, and this packet got selected to be discarded */
+        if (rnd_pkt_drop_percent_accept && drop_this_packet(eth, pi->len)) {
+            return;  /* adaptive packet drop configured, and this packet's flow is being shed */
+        }
+        if (budget.enabled() && budget.pass(eth, pi->len) == false) {
+            return;  /* this flow's capture budget is spent */
         }
         pcap_queue_write(llq, eth, pi->len, pi->ts.tv_sec, pi->ts.tv_nsec / 1000, block);
     }
@@ -132,13 +314,14 @@ struct pkt_proc_pcap_writer : public pkt_proc {
     void apply(struct packet_info *pi, uint8_t *eth) override {
         extern int rnd_pkt_drop_percent_accept;  /* defined in rnd_pkt_drop.c */
 
-        if (rnd_pkt_drop_percent_accept && drop_this_packet()) {
-            return;  /* random packet drop configured, and this packet got selected to be discarded */
+        if (rnd_pkt_drop_percent_accept && drop_this_packet(eth, pi->len)) {
+            return;  /* adaptive packet drop configured, and this packet's flow is being shed */
         }
         pcap_file_write_packet_direct(&pcap_file, eth, pi->len, pi->ts.tv_sec, pi->ts.tv_nsec / 1000);
     }
 
     void flush() override {
+        pcap_file_write_flush(&pcap_file);
         FILE *file_ptr = pcap_file.file_ptr;
         if (file_ptr != NULL) {
             if (fflush(file_ptr) != 0) {
@@ -147,6 +330,10 @@ struct pkt_proc_pcap_writer : public pkt_proc {
         }
     }
 
+    ~pkt_proc_pcap_writer() {
+        pcap_file_close(&pcap_file);   /* drains the staging buffer and the flow index */
+    }
+
 };
 
 /*
@@ -177,8 +364,8 @@ struct pkt_proc_filter_pcap_writer : public pkt_proc {
 
         extern int rnd_pkt_drop_percent_accept;  /* defined in rnd_pkt_drop.c */
 
-        if (rnd_pkt_drop_percent_accept && drop_this_packet()) {
-            return;  /* random packet drop configured, and this packet got selected to be discarded */
+        if (rnd_pkt_drop_percent_accept && drop_this_packet(eth, pi->len)) {
+            return;  /* adaptive packet drop configured, and this packet's flow is being shed */
         }
 
         struct packet_filter pf;
@@ -188,6 +375,7 @@ struct pkt_proc_filter_pcap_writer : public pkt_proc {
     }
 
     void flush() override {
+        pcap_file_write_flush(&pcap_file);
         FILE *file_ptr = pcap_file.file_ptr;
         if (file_ptr != NULL) {
             if (fflush(file_ptr) != 0) {
@@ -196,6 +384,10 @@ struct pkt_proc_filter_pcap_writer : public pkt_proc {
         }
     }
 
+    ~pkt_proc_filter_pcap_writer() {
+        pcap_file_close(&pcap_file);   /* drains the staging buffer and the flow index */
+    }
+
 };
 
 /*
@@ -206,8 +398,11 @@ struct pkt_proc_filter_pcap_writer : public pkt_proc {
 struct pkt_proc_filter_pcap_writer_llq : public pkt_proc {
     struct ll_queue *llq;
     struct packet_filter pf;
+
+    struct packet_filter *filter() override { return &pf; }
     bool block;
-    
+    struct flow_budget budget;
+
     /*
      * packet_filter_threshold is a (somewhat arbitrary) threshold used in
      * the packet metadata filter; it will probably get eliminated soon,
@@ -215,7 +410,9 @@ struct pkt_proc_filter_pcap_writer_llq : public pkt_proc {
      */
     unsigned int packet_filter_threshold = 8;
 
-    explicit pkt_proc_filter_pcap_writer_llq(struct ll_queue *llq_ptr, const char *filter, bool blocking) : block{blocking} {
+    explicit pkt_proc_filter_pcap_writer_llq(struct ll_queue *llq_ptr, const char *filter, bool blocking,
+                                             uint64_t budget_bytes, uint64_t budget_packets) :
+        block{blocking}, budget{budget_bytes, budget_packets} {
         llq = llq_ptr;
         if (packet_filter_init(&pf, filter) == status_err) {
             throw "could not initialize packet filter";
@@ -228,12 +425,19 @@ struct pkt_proc_filter_pcap_writer_llq : public pkt_proc {
 
         extern int rnd_pkt_drop_percent_accept;  /* defined in rnd_pkt_drop.c */
 
-        if (rnd_pkt_drop_percent_accept && drop_this_packet()) {
-            return;  /* random packet drop configured, and this packet got selected to be discarded */
+        if (rnd_pkt_drop_percent_accept && drop_this_packet(eth, pi->len)) {
+            llq->filtered++;  /* adaptive packet drop configured, and this packet's flow is being shed */
+            return;
         }
 
         if (packet_filter_apply(&pf, packet, length)) {
+            if (budget.enabled() && budget.pass(eth, pi->len) == false) {
+                llq->filtered++;  /* this flow's capture budget is spent; a policy decision */
+                return;
+            }
             pcap_queue_write(llq, eth, pi->len, pi->ts.tv_sec, pi->ts.tv_nsec / 1000, block);
+        } else {
+            llq->filtered++;   /* rejected by packet_filter_apply(); a policy decision */
         }
     }
 
@@ -242,6 +446,249 @@ struct pkt_proc_filter_pcap_writer_llq : public pkt_proc {
 
 };
 
+/*
+ * ring_pcap_file_open() and ring_pcap_file_close() manage the single
+ * file descriptor that all of the ring pcap writer threads append to;
+ * the first caller creates the file and writes the pcap file header,
+ * and the descriptor is closed when the last writer is deleted
+ */
+int ring_pcap_file_open(const char *fname);
+void ring_pcap_file_close(int fd);
+
+/*
+ * struct pkt_proc_json_pcap_writer_llq serves dual-output runs (-f
+ * together with -w) from a single parse: apply() runs the datum-based
+ * parse and JSON serialization, and appends the packet to the capture
+ * file exactly when that parse published a record, so the packets in
+ * the capture file are the ones the JSON output describes and nothing
+ * is parsed twice.  The capture file is the shared O_APPEND
+ * descriptor also used by the ring pcap writers, so each record lands
+ * atomically however many workers write; selected packets are a small
+ * fraction of the traffic, which keeps the per-record writev() cheap.
+ */
+struct pkt_proc_json_pcap_writer_llq : public pkt_proc {
+    struct ll_queue *llq;
+    int fd;
+    struct packet_filter pf;
+
+    struct packet_filter *filter() override { return &pf; }
+    struct flow_budget budget;
+
+    explicit pkt_proc_json_pcap_writer_llq(struct ll_queue *llq_ptr, const char *pcap_fname, const char *filter,
+                                           uint64_t budget_bytes, uint64_t budget_packets) :
+        llq{llq_ptr}, budget{budget_bytes, budget_packets} {
+        if (packet_filter_init(&pf, filter) == status_err) {
+            throw "could not initialize packet filter";
+        }
+        fd = ring_pcap_file_open(pcap_fname);
+        if (fd < 0) {
+            throw "could not open PCAP output file";
+        }
+    }
+
+    void apply(struct packet_info *pi, uint8_t *eth) override {
+        extern int rnd_pkt_drop_percent_accept;  /* defined in rnd_pkt_drop.c */
+
+        if (rnd_pkt_drop_percent_accept && drop_this_packet(eth, pi->len)) {
+            llq->filtered++;  /* adaptive packet drop configured, and this packet's flow is being shed */
+            return;
+        }
+        if (json_queue_write(llq, eth, pi->len, pi->ts.tv_sec, pi->ts.tv_nsec) == false) {
+            return;           /* the parse selected nothing; no record, and no packet */
+        }
+        if (budget.enabled() && budget.pass(eth, pi->len) == false) {
+            return;           /* this flow's capture budget is spent */
+        }
+
+        struct pcap_packet_hdr hdr;
+        hdr.ts_sec = pi->ts.tv_sec;
+        hdr.ts_usec = pi->ts.tv_nsec / 1000;
+        hdr.incl_len = pi->caplen;
+        hdr.orig_len = pi->len;
+        struct iovec iov[2];
+        iov[0].iov_base = &hdr;
+        iov[0].iov_len = sizeof(hdr);
+        iov[1].iov_base = eth;
+        iov[1].iov_len = pi->caplen;
+
+        struct iovec *v = iov;
+        int count = 2;
+        while (count > 0) {
+            ssize_t n = writev(fd, v, count);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                perror("error writing pcap packet record");
+                break;
+            }
+            size_t done = n;
+            while (count > 0 && done >= v->iov_len) {
+                done -= v->iov_len;
+                v++;
+                count--;
+            }
+            if (count > 0 && done > 0) {
+                /* a short write split the record; finish it before
+                 * another thread's writev() can land in the file */
+                v->iov_base = (uint8_t *)v->iov_base + done;
+                v->iov_len -= done;
+            }
+        }
+        bytes_written += sizeof(hdr) + pi->caplen;
+        packets_written++;
+    }
+
+    void flush() override {
+        json_queue_flush(llq);   /* send any records held by flow aggregation */
+    }
+
+    ~pkt_proc_json_pcap_writer_llq() {
+        ring_pcap_file_close(fd);
+    }
+};
+
+/*
+ * struct pkt_proc_pcap_writer_ring writes packets into the capture
+ * file straight from the TPACKET v3 ring, with zero userspace copies:
+ * apply() builds an iovec pair per packet (a pcap record header of
+ * its own, and the frame data in place in the mapped ring block), and
+ * block_boundary() hands the accumulated iovecs to writev() before
+ * the capture code returns the block to the kernel, while the frame
+ * data is still mapped.  Every worker appends to the same descriptor,
+ * opened with O_APPEND so that each writev() lands atomically as one
+ * contiguous run of whole records.
+ */
+struct pkt_proc_pcap_writer_ring : public pkt_proc {
+    static const size_t max_batch = 512;    /* records gathered between writev() calls */
+    int fd;
+    struct pcap_packet_hdr hdr[max_batch];
+    struct iovec iov[2 * max_batch];
+    size_t batch = 0;
+    struct flow_budget budget;
+
+    explicit pkt_proc_pcap_writer_ring(const char *fname,
+                                       uint64_t budget_bytes, uint64_t budget_packets) :
+        budget{budget_bytes, budget_packets} {
+        fd = ring_pcap_file_open(fname);
+        if (fd < 0) {
+            throw "could not open PCAP output file";
+        }
+    }
+
+    void enqueue(struct packet_info *pi, uint8_t *eth) {
+        if (batch == max_batch) {
+            write_batch();   /* mid-block flush; this block's frames are still mapped */
+        }
+        hdr[batch].ts_sec = pi->ts.tv_sec;
+        hdr[batch].ts_usec = pi->ts.tv_nsec / 1000;
+        hdr[batch].incl_len = pi->caplen;
+        hdr[batch].orig_len = pi->len;
+        iov[2 * batch].iov_base = &hdr[batch];
+        iov[2 * batch].iov_len = sizeof(struct pcap_packet_hdr);
+        iov[2 * batch + 1].iov_base = eth;
+        iov[2 * batch + 1].iov_len = pi->caplen;
+        batch++;
+        bytes_written += sizeof(struct pcap_packet_hdr) + pi->caplen;
+        packets_written++;
+    }
+
+    void write_batch() {
+        struct iovec *v = iov;
+        int count = 2 * batch;
+        while (count > 0) {
+            ssize_t n = writev(fd, v, count);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                perror("error writing pcap packet records");
+                break;
+            }
+            size_t done = n;
+            while (count > 0 && done >= v->iov_len) {
+                done -= v->iov_len;
+                v++;
+                count--;
+            }
+            if (count > 0 && done > 0) {
+                /* a short write split a record; finish it before
+                 * another thread's writev() can land in the file */
+                v->iov_base = (uint8_t *)v->iov_base + done;
+                v->iov_len -= done;
+            }
+        }
+        batch = 0;
+    }
+
+    void apply(struct packet_info *pi, uint8_t *eth) override {
+        extern int rnd_pkt_drop_percent_accept;  /* defined in rnd_pkt_drop.c */
+
+        if (rnd_pkt_drop_percent_accept && drop_this_packet(eth, pi->len)) {
+            return;  /* adaptive packet drop configured, and this packet's flow is being shed */
+        }
+        if (budget.enabled() && budget.pass(eth, pi->len) == false) {
+            return;  /* this flow's capture budget is spent */
+        }
+        enqueue(pi, eth);
+    }
+
+    void block_boundary() override {
+        if (batch) {
+            write_batch();
+        }
+    }
+
+    void flush() override {
+        if (batch) {
+            write_batch();
+        }
+    }
+
+    ~pkt_proc_pcap_writer_ring() {
+        if (batch) {
+            write_batch();
+        }
+        ring_pcap_file_close(fd);
+    }
+
+};
+
+/*
+ * struct pkt_proc_filter_pcap_writer_ring first filters packets, then
+ * writes the matches into the capture file straight from the TPACKET
+ * v3 ring, as pkt_proc_pcap_writer_ring does
+ */
+struct pkt_proc_filter_pcap_writer_ring : public pkt_proc_pcap_writer_ring {
+    struct packet_filter pf;
+
+    struct packet_filter *filter() override { return &pf; }
+
+    explicit pkt_proc_filter_pcap_writer_ring(const char *fname, const char *filter,
+                                              uint64_t budget_bytes, uint64_t budget_packets) :
+        pkt_proc_pcap_writer_ring{fname, budget_bytes, budget_packets} {
+        if (packet_filter_init(&pf, filter) == status_err) {
+            throw "could not initialize packet filter";
+        }
+    }
+
+    void apply(struct packet_info *pi, uint8_t *eth) override {
+        extern int rnd_pkt_drop_percent_accept;  /* defined in rnd_pkt_drop.c */
+
+        if (rnd_pkt_drop_percent_accept && drop_this_packet(eth, pi->len)) {
+            return;  /* adaptive packet drop configured, and this packet's flow is being shed */
+        }
+
+        if (packet_filter_apply(&pf, eth, pi->len)) {
+            if (budget.enabled() && budget.pass(eth, pi->len) == false) {
+                return;  /* this flow's capture budget is spent */
+            }
+            enqueue(pi, eth);
+        }
+    }
+
+};
+
 /*
  * pkt_proc_dumper writes a JSON object summarizing each packet to
  * stdout
@@ -258,6 +705,28 @@ struct pkt_proc_dumper : public pkt_proc {
     }
 };
 
+/*
+ * pkt_proc_block<proc> gives a concrete processor a devirtualized
+ * block entry point: its apply_block() override loops over the
+ * packets of a block with calls that name proc::apply() directly, so
+ * the compiler instantiates the loop once per processor type and can
+ * inline the per-packet work into it.  The factory wraps each
+ * processor it constructs in this template, and the capture code
+ * calls apply_block() once per ring block (typically hundreds of
+ * packets) rather than apply() once per packet.
+ */
+template <typename proc>
+struct pkt_proc_block : public proc {
+
+    using proc::proc;    /* the wrapped processor's constructors */
+
+    void apply_block(struct packet_info *pi, uint8_t **frames, size_t count) override {
+        for (size_t i = 0; i < count; i++) {
+            proc::apply(&pi[i], frames[i]);   /* non-virtual; inlined per processor type */
+        }
+    }
+};
+
 /*
  * the function pkt_proc_new_from_config() takes as input a
  * configuration structure, a thread number, and a pointer to a
@@ -269,4 +738,13 @@ struct pkt_proc *pkt_proc_new_from_config(struct mercury_config *cfg,
                                           int tnum,
                                           struct ll_queue *llq);
 
+/*
+ * pkt_proc_uses_ring_pcap_writer() returns true if the configuration
+ * calls for the zero-copy ring pcap writers, in which case the
+ * workers write the capture file themselves: no output queues are
+ * allocated and no output thread is started, just as with
+ * --separate-files
+ */
+bool pkt_proc_uses_ring_pcap_writer(const struct mercury_config *cfg);
+
 #endif /* PKT_PROC_H */
@@ -0,0 +1,52 @@
+/*
+ * probe.h
+ *
+ * USDT static tracepoints for the packet pipeline.  When sys/sdt.h is
+ * available (package systemtap-sdt-dev on Debian/Ubuntu, or
+ * systemtap-sdt-devel on Red Hat), each mercury_probe*() expands to a
+ * DTRACE_PROBE*() under the provider name "mercury": a single nop in
+ * the instruction stream that bpftrace, perf, and systemtap can
+ * attach to on a live sensor, with no rebuild and no restart.  When
+ * the header is absent the probes compile to nothing, so the hot path
+ * costs the same either way.
+ *
+ * The probes mark the stage boundaries of the pipeline:
+ *
+ *   block_retire(thread, packets, bytes)  a ring block has been parsed
+ *                                         and is returned to the kernel
+ *   pkt_apply_entry(count)                a batch of packets enters the
+ *                                         processor
+ *   pkt_apply_exit(count)                 ... and leaves it
+ *   llq_enqueue(queue, len)               a record enters an output queue
+ *   llq_dequeue(queue, len)               ... and is retired from it
+ *   merge_winner(queue, len)              the tournament merge selected
+ *                                         a record to write
+ *   output_write(bytes, records)          bytes handed to the output
+ *                                         file, socket, or ring
+ *
+ * e.g.: bpftrace -e 'usdt:./mercury:mercury:merge_winner { @[arg0] = count(); }'
+ */
+
+#ifndef PROBE_H
+#define PROBE_H
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define HAVE_SDT_PROBES 1
+#endif
+#endif
+
+#ifdef HAVE_SDT_PROBES
+#define mercury_probe(name)            DTRACE_PROBE(mercury, name)
+#define mercury_probe1(name, a)        DTRACE_PROBE1(mercury, name, a)
+#define mercury_probe2(name, a, b)     DTRACE_PROBE2(mercury, name, a, b)
+#define mercury_probe3(name, a, b, c)  DTRACE_PROBE3(mercury, name, a, b, c)
+#else
+#define mercury_probe(name)
+#define mercury_probe1(name, a)
+#define mercury_probe2(name, a, b)
+#define mercury_probe3(name, a, b, c)
+#endif
+
+#endif /* PROBE_H */
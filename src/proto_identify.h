@@ -30,7 +30,9 @@ enum msg_type {
     msg_type_dtls_client_hello,
     msg_type_dtls_server_hello,
     msg_type_dtls_certificate,
-    msg_type_wireguard
+    msg_type_wireguard,
+    msg_type_quic_init,
+    msg_type_http2
 };
 
 /* Values indicating direction of the flow */
@@ -50,6 +52,8 @@ enum msg_type {
 #define DTLS_PORT         99
 #define DNS_PORT          53
 #define WIREGUARD_PORT 51820
+#define QUIC_PORT       4433
+#define HTTP2_PORT      8080
 
 /**
  * \brief Protocol Inference container
@@ -68,4 +72,12 @@ const struct pi_container *proto_identify_tcp(const uint8_t *tcp_data,
 const struct pi_container *proto_identify_udp(const uint8_t *udp_data,
                                               unsigned int len);
 
+/*
+ * rebuilds the UDP pattern matcher from the current protocol masks
+ * and publishes it with an atomic pointer swap; used by
+ * proto_ident_reconfig() (extractor.c) to change the selected
+ * protocols at runtime
+ */
+void udp_matchers_rebuild(void);
+
 #endif /* PROTO_IDENTIFY_H */
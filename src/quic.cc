@@ -0,0 +1,475 @@
+/*
+ * quic.c
+ *
+ * QUIC Initial packet decryption (RFC 9001, Section 5)
+ *
+ * The keys protecting an Initial packet are derived from the
+ * destination connection ID and a salt published in the RFC, so the
+ * embedded TLS ClientHello can be recovered passively.  The
+ * primitives needed for that derivation (SHA-256, HMAC, HKDF, and the
+ * AES-128 block cipher) are implemented here directly, so that no
+ * cryptographic library dependency is introduced; they run only on
+ * Initial packets, not on bulk traffic.
+ */
+
+#include <string.h>
+#include "quic.h"
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/*
+ * SHA-256 (FIPS 180-4); used only for the HKDF computations below
+ */
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+struct sha256_ctx {
+    uint32_t state[8];
+    uint64_t bitlen;
+    uint8_t buf[64];
+    size_t buflen;
+};
+
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_compress(struct sha256_ctx *ctx, const uint8_t *block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[i*4] << 24) | ((uint32_t)block[i*4+1] << 16)
+             | ((uint32_t)block[i*4+2] << 8) | (uint32_t)block[i*4+3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR32(w[i-15], 7) ^ ROTR32(w[i-15], 18) ^ (w[i-15] >> 3);
+        uint32_t s1 = ROTR32(w[i-2], 17) ^ ROTR32(w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+    uint32_t a = ctx->state[0], b = ctx->state[1], c = ctx->state[2], d = ctx->state[3];
+    uint32_t e = ctx->state[4], f = ctx->state[5], g = ctx->state[6], h = ctx->state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+        uint32_t s0 = ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    ctx->state[0] += a; ctx->state[1] += b; ctx->state[2] += c; ctx->state[3] += d;
+    ctx->state[4] += e; ctx->state[5] += f; ctx->state[6] += g; ctx->state[7] += h;
+}
+
+static void sha256_init(struct sha256_ctx *ctx) {
+    ctx->state[0] = 0x6a09e667; ctx->state[1] = 0xbb67ae85;
+    ctx->state[2] = 0x3c6ef372; ctx->state[3] = 0xa54ff53a;
+    ctx->state[4] = 0x510e527f; ctx->state[5] = 0x9b05688c;
+    ctx->state[6] = 0x1f83d9ab; ctx->state[7] = 0x5be0cd19;
+    ctx->bitlen = 0;
+    ctx->buflen = 0;
+}
+
+static void sha256_update(struct sha256_ctx *ctx, const uint8_t *data, size_t len) {
+    ctx->bitlen += (uint64_t)len * 8;
+    while (len > 0) {
+        size_t n = 64 - ctx->buflen;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(ctx->buf + ctx->buflen, data, n);
+        ctx->buflen += n;
+        data += n;
+        len -= n;
+        if (ctx->buflen == 64) {
+            sha256_compress(ctx, ctx->buf);
+            ctx->buflen = 0;
+        }
+    }
+}
+
+static void sha256_final(struct sha256_ctx *ctx, uint8_t digest[32]) {
+    uint64_t bitlen = ctx->bitlen;
+    uint8_t pad = 0x80;
+    uint8_t zero = 0x00;
+    sha256_update(ctx, &pad, 1);
+    while (ctx->buflen != 56) {
+        sha256_update(ctx, &zero, 1);
+        ctx->bitlen = bitlen;    /* padding does not count */
+    }
+    uint8_t len_bytes[8];
+    for (int i = 0; i < 8; i++) {
+        len_bytes[i] = bitlen >> (56 - i * 8);
+    }
+    ctx->buflen = 56;
+    memcpy(ctx->buf + 56, len_bytes, 8);
+    sha256_compress(ctx, ctx->buf);
+    for (int i = 0; i < 8; i++) {
+        digest[i*4]   = ctx->state[i] >> 24;
+        digest[i*4+1] = ctx->state[i] >> 16;
+        digest[i*4+2] = ctx->state[i] >> 8;
+        digest[i*4+3] = ctx->state[i];
+    }
+}
+
+/*
+ * HMAC-SHA256 (RFC 2104); the message is passed as two segments so
+ * that HKDF-Expand can append its counter byte without copying
+ */
+static void hmac_sha256(const uint8_t *key, size_t key_len,
+                        const uint8_t *msg, size_t msg_len,
+                        const uint8_t *msg2, size_t msg2_len,
+                        uint8_t digest[32]) {
+    uint8_t k[64];
+    uint8_t pad[64];
+    struct sha256_ctx ctx;
+
+    memset(k, 0, sizeof(k));
+    if (key_len > 64) {
+        sha256_init(&ctx);
+        sha256_update(&ctx, key, key_len);
+        sha256_final(&ctx, k);
+    } else {
+        memcpy(k, key, key_len);
+    }
+    for (int i = 0; i < 64; i++) {
+        pad[i] = k[i] ^ 0x36;
+    }
+    sha256_init(&ctx);
+    sha256_update(&ctx, pad, 64);
+    sha256_update(&ctx, msg, msg_len);
+    if (msg2 != NULL) {
+        sha256_update(&ctx, msg2, msg2_len);
+    }
+    sha256_final(&ctx, digest);
+    for (int i = 0; i < 64; i++) {
+        pad[i] = k[i] ^ 0x5c;
+    }
+    sha256_init(&ctx);
+    sha256_update(&ctx, pad, 64);
+    sha256_update(&ctx, digest, 32);
+    sha256_final(&ctx, digest);
+}
+
+/*
+ * hkdf_expand_label() implements the TLS 1.3 HKDF-Expand-Label
+ * function (RFC 8446, Section 7.1) with an empty context, for output
+ * lengths of at most one hash block (all that QUIC key derivation
+ * needs, so only the first round of HKDF-Expand is computed)
+ */
+static void hkdf_expand_label(const uint8_t secret[32],
+                              const char *label,
+                              uint8_t *out, size_t out_len) {
+    uint8_t info[64];
+    size_t label_len = strlen(label);
+    size_t info_len = 0;
+
+    info[info_len++] = out_len >> 8;
+    info[info_len++] = out_len & 0xff;
+    info[info_len++] = 6 + label_len;
+    memcpy(info + info_len, "tls13 ", 6);
+    info_len += 6;
+    memcpy(info + info_len, label, label_len);
+    info_len += label_len;
+    info[info_len++] = 0x00;   /* empty context */
+    info[info_len++] = 0x01;   /* HKDF-Expand counter */
+
+    uint8_t digest[32];
+    hmac_sha256(secret, 32, info, info_len, NULL, 0, digest);
+    memcpy(out, digest, out_len);
+}
+
+/*
+ * AES-128 block encryption (FIPS 197); only encryption is needed,
+ * since both header protection and the AES-GCM payload decryption use
+ * the cipher in the forward direction
+ */
+
+static const uint8_t aes_sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+#define AES128_ROUND_KEY_LEN 176    /* eleven 16-byte round keys */
+
+static void aes128_expand_key(const uint8_t key[16], uint8_t rk[AES128_ROUND_KEY_LEN]) {
+    uint8_t rcon = 0x01;
+
+    memcpy(rk, key, 16);
+    for (int i = 16; i < AES128_ROUND_KEY_LEN; i += 4) {
+        uint8_t t[4];
+        memcpy(t, rk + i - 4, 4);
+        if (i % 16 == 0) {
+            uint8_t tmp = t[0];
+            t[0] = aes_sbox[t[1]] ^ rcon;
+            t[1] = aes_sbox[t[2]];
+            t[2] = aes_sbox[t[3]];
+            t[3] = aes_sbox[tmp];
+            rcon = (rcon << 1) ^ ((rcon & 0x80) ? 0x1b : 0x00);
+        }
+        for (int j = 0; j < 4; j++) {
+            rk[i + j] = rk[i - 16 + j] ^ t[j];
+        }
+    }
+}
+
+static inline uint8_t xtime(uint8_t x) {
+    return (x << 1) ^ ((x >> 7) * 0x1b);
+}
+
+static void aes128_encrypt_block_scalar(const uint8_t rk[AES128_ROUND_KEY_LEN],
+                                        const uint8_t in[16], uint8_t out[16]) {
+    /* ShiftRows as a byte permutation of the column-major state */
+    static const uint8_t shift_row[16] = {
+        0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12, 1, 6, 11
+    };
+    uint8_t s[16], t[16];
+
+    for (int i = 0; i < 16; i++) {
+        s[i] = in[i] ^ rk[i];
+    }
+    for (int round = 1; round <= 10; round++) {
+        for (int i = 0; i < 16; i++) {
+            t[i] = aes_sbox[s[shift_row[i]]];       /* SubBytes + ShiftRows */
+        }
+        if (round < 10) {
+            for (int c = 0; c < 16; c += 4) {       /* MixColumns */
+                uint8_t a0 = t[c], a1 = t[c+1], a2 = t[c+2], a3 = t[c+3];
+                uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+                s[c]   = a0 ^ all ^ xtime(a0 ^ a1);
+                s[c+1] = a1 ^ all ^ xtime(a1 ^ a2);
+                s[c+2] = a2 ^ all ^ xtime(a2 ^ a3);
+                s[c+3] = a3 ^ all ^ xtime(a3 ^ a0);
+            }
+        } else {
+            memcpy(s, t, 16);
+        }
+        for (int i = 0; i < 16; i++) {
+            s[i] ^= rk[round * 16 + i];
+        }
+    }
+    memcpy(out, s, 16);
+}
+
+#if defined(__x86_64__)
+
+/*
+ * AES-NI block encryption; the expanded round keys are in the byte
+ * order that aesenc expects, so the scalar key schedule is shared.
+ * The instruction set is probed once, following the convention used
+ * by the other runtime-dispatched kernels in this codebase.
+ */
+
+static inline bool aes_ni_is_supported() {
+    static int level = -1;
+    if (level < 0) {
+        level = __builtin_cpu_supports("aes") ? 1 : 0;
+    }
+    return level == 1;
+}
+
+__attribute__((target("aes,sse2")))
+static void aes128_encrypt_block_aesni(const uint8_t rk[AES128_ROUND_KEY_LEN],
+                                       const uint8_t in[16], uint8_t out[16]) {
+    __m128i b = _mm_loadu_si128((const __m128i *)in);
+    b = _mm_xor_si128(b, _mm_loadu_si128((const __m128i *)rk));
+    for (int round = 1; round < 10; round++) {
+        b = _mm_aesenc_si128(b, _mm_loadu_si128((const __m128i *)(rk + round * 16)));
+    }
+    b = _mm_aesenclast_si128(b, _mm_loadu_si128((const __m128i *)(rk + 160)));
+    _mm_storeu_si128((__m128i *)out, b);
+}
+
+static void aes128_encrypt_block(const uint8_t rk[AES128_ROUND_KEY_LEN],
+                                 const uint8_t in[16], uint8_t out[16]) {
+    if (aes_ni_is_supported()) {
+        aes128_encrypt_block_aesni(rk, in, out);
+        return;
+    }
+    aes128_encrypt_block_scalar(rk, in, out);
+}
+
+#else /* __x86_64__ */
+
+static void aes128_encrypt_block(const uint8_t rk[AES128_ROUND_KEY_LEN],
+                                 const uint8_t in[16], uint8_t out[16]) {
+    aes128_encrypt_block_scalar(rk, in, out);
+}
+
+#endif /* __x86_64__ */
+
+/*
+ * aes128_ctr_decrypt() recovers the confidentiality part of AES-GCM;
+ * the counter blocks for the payload start at two (block one is
+ * reserved for the authentication tag), and the authenticity check is
+ * deliberately omitted, since a passive observer has nothing to gain
+ * from verifying the tag
+ */
+static void aes128_ctr_decrypt(const uint8_t rk[AES128_ROUND_KEY_LEN],
+                               const uint8_t nonce[12],
+                               const uint8_t *ciphertext, size_t len,
+                               uint8_t *plaintext) {
+    uint8_t counter_block[16];
+    uint8_t keystream[16];
+    uint32_t counter = 2;
+
+    memcpy(counter_block, nonce, 12);
+    for (size_t i = 0; i < len; i += 16) {
+        counter_block[12] = counter >> 24;
+        counter_block[13] = counter >> 16;
+        counter_block[14] = counter >> 8;
+        counter_block[15] = counter;
+        counter++;
+        aes128_encrypt_block(rk, counter_block, keystream);
+        size_t n = (len - i < 16) ? len - i : 16;
+        for (size_t j = 0; j < n; j++) {
+            plaintext[i + j] = ciphertext[i + j] ^ keystream[j];
+        }
+    }
+}
+
+/* the salt for QUIC v1 Initial secrets (RFC 9001, Section 5.2) */
+static const uint8_t quic_v1_initial_salt[20] = {
+    0x38, 0x76, 0x2c, 0xf7, 0xf5, 0x59, 0x34, 0xb3, 0x4d, 0x17,
+    0x9a, 0xe6, 0xa4, 0xc8, 0x0c, 0xad, 0xcc, 0xbb, 0x7f, 0x0a
+};
+
+#define QUIC_SAMPLE_LEN  16
+#define QUIC_AEAD_TAG_LEN 16
+#define QUIC_MAX_PAYLOAD_LEN 4096
+
+bool quic_decrypt_initial(const struct quic_initial_packet &quic_pkt,
+                          uint8_t *crypto_buf,
+                          size_t crypto_buf_len,
+                          struct datum &crypto_data) {
+
+    if (!quic_pkt.valid) {
+        return false;
+    }
+
+    /*
+     * derive the client Initial key, iv, and header protection key
+     * from the destination connection ID (RFC 9001, Section 5.2)
+     */
+    uint8_t initial_secret[32];
+    uint8_t client_secret[32];
+    uint8_t key[16];
+    uint8_t iv[12];
+    uint8_t hp_key[16];
+
+    hmac_sha256(quic_v1_initial_salt, sizeof(quic_v1_initial_salt),
+                quic_pkt.dcid.data, quic_pkt.dcid.length(), NULL, 0,
+                initial_secret);                      /* HKDF-Extract */
+    hkdf_expand_label(initial_secret, "client in", client_secret, sizeof(client_secret));
+    hkdf_expand_label(client_secret, "quic key", key, sizeof(key));
+    hkdf_expand_label(client_secret, "quic iv", iv, sizeof(iv));
+    hkdf_expand_label(client_secret, "quic hp", hp_key, sizeof(hp_key));
+
+    /*
+     * remove header protection (RFC 9001, Section 5.4); the sample is
+     * taken assuming the longest possible packet number encoding
+     */
+    if (quic_pkt.payload.length() < 4 + QUIC_SAMPLE_LEN) {
+        return false;
+    }
+    uint8_t rk[AES128_ROUND_KEY_LEN];
+    uint8_t mask[16];
+    aes128_expand_key(hp_key, rk);
+    aes128_encrypt_block(rk, quic_pkt.payload.data + 4, mask);
+
+    uint8_t first_byte = quic_pkt.first_byte ^ (mask[0] & 0x0f);
+    size_t pn_len = (first_byte & 0x03) + 1;
+    uint8_t pn_bytes[4];
+    for (size_t i = 0; i < pn_len; i++) {
+        pn_bytes[i] = quic_pkt.payload.data[i] ^ mask[1 + i];
+    }
+
+    /* the nonce is the iv xored with the padded packet number */
+    uint8_t nonce[12];
+    memcpy(nonce, iv, sizeof(nonce));
+    for (size_t i = 0; i < pn_len; i++) {
+        nonce[12 - pn_len + i] ^= pn_bytes[i];
+    }
+
+    /*
+     * decrypt the payload; packets larger than the temporary buffer
+     * are truncated, which at worst truncates the crypto stream
+     */
+    if (quic_pkt.payload.length() < (ssize_t)(pn_len + QUIC_AEAD_TAG_LEN)) {
+        return false;
+    }
+    size_t ciphertext_len = quic_pkt.payload.length() - pn_len - QUIC_AEAD_TAG_LEN;
+    if (ciphertext_len > QUIC_MAX_PAYLOAD_LEN) {
+        ciphertext_len = QUIC_MAX_PAYLOAD_LEN;
+    }
+    uint8_t plaintext[QUIC_MAX_PAYLOAD_LEN];
+    aes128_expand_key(key, rk);
+    aes128_ctr_decrypt(rk, nonce, quic_pkt.payload.data + pn_len, ciphertext_len, plaintext);
+
+    /*
+     * reassemble the CRYPTO frames (RFC 9000, Section 19.6); PADDING
+     * and PING frames are skipped, and any other frame type ends the
+     * walk, since the ClientHello is sent before the peer can be
+     * acknowledged
+     */
+    struct datum frames{plaintext, plaintext + ciphertext_len};
+    size_t crypto_len = 0;
+    memset(crypto_buf, 0, crypto_buf_len);   /* holes between frames parse as zeros */
+    while (frames.is_not_empty()) {
+        size_t frame_type = 0;
+        if (quic_initial_packet::parse_var_int(frames, &frame_type) == false) {
+            break;
+        }
+        if (frame_type == 0x00 || frame_type == 0x01) {
+            continue;                  /* PADDING or PING */
+        }
+        if (frame_type != 0x06) {
+            break;                     /* not a CRYPTO frame */
+        }
+        size_t offset = 0;
+        size_t length = 0;
+        if (quic_initial_packet::parse_var_int(frames, &offset) == false
+            || quic_initial_packet::parse_var_int(frames, &length) == false) {
+            break;
+        }
+        if (length > (size_t)frames.length()) {
+            break;
+        }
+        if (offset + length <= crypto_buf_len) {
+            memcpy(crypto_buf + offset, frames.data, length);
+            if (offset + length > crypto_len) {
+                crypto_len = offset + length;
+            }
+        }
+        frames.skip(length);
+    }
+
+    if (crypto_len == 0) {
+        return false;
+    }
+    crypto_data.data = crypto_buf;
+    crypto_data.data_end = crypto_buf + crypto_len;
+    return true;
+}
@@ -0,0 +1,137 @@
+/*
+ * quic.h
+ *
+ * QUIC Initial packet processing
+ */
+
+#ifndef QUIC_H
+#define QUIC_H
+
+#include "datum.h"
+
+/*
+ * From RFC 9000 (QUIC v1):
+ *
+ *    Initial Packet {
+ *      Header Form (1) = 1,
+ *      Fixed Bit (1) = 1,
+ *      Long Packet Type (2) = 0,
+ *      Reserved Bits (2),
+ *      Packet Number Length (2),
+ *      Version (32),
+ *      Destination Connection ID Length (8),
+ *      Destination Connection ID (0..160),
+ *      Source Connection ID Length (8),
+ *      Source Connection ID (0..160),
+ *      Token Length (i),
+ *      Token (..),
+ *      Length (i),
+ *      Packet Number (8..32),
+ *      Packet Payload (8..),
+ *    }
+ *
+ * The Reserved Bits, Packet Number Length, and Packet Number fields
+ * are header protected, and the payload is AEAD protected, but the
+ * keys for an Initial packet are derived entirely from the
+ * Destination Connection ID and a version-specific salt (RFC 9001,
+ * Section 5.2), so a passive observer can remove both protections.
+ * The payload carries CRYPTO frames holding the TLS ClientHello.
+ */
+
+struct quic_initial_packet {
+    uint8_t first_byte;
+    uint32_t version;
+    struct datum dcid;
+    struct datum scid;
+    struct datum token;
+    struct datum payload;   /* protected packet number and payload */
+    bool valid;
+
+    quic_initial_packet() : first_byte{0}, version{0}, dcid{NULL, NULL}, scid{NULL, NULL}, token{NULL, NULL}, payload{NULL, NULL}, valid{false} {}
+
+    quic_initial_packet(struct datum &d) : first_byte{0}, version{0}, dcid{NULL, NULL}, scid{NULL, NULL}, token{NULL, NULL}, payload{NULL, NULL}, valid{false} {
+        parse(d);
+    }
+
+    /*
+     * parse_var_int() reads a QUIC variable-length integer (RFC 9000,
+     * Section 16); the two most significant bits of the first byte
+     * encode the length of the encoding
+     */
+    static bool parse_var_int(struct datum &d, size_t *value) {
+        uint8_t first = 0;
+        if (d.read_uint8(&first) == false) {
+            return false;
+        }
+        size_t more_bytes = (1 << (first >> 6)) - 1;
+        size_t tmp = first & 0x3f;
+        for (size_t i = 0; i < more_bytes; i++) {
+            uint8_t b = 0;
+            if (d.read_uint8(&b) == false) {
+                return false;
+            }
+            tmp = (tmp << 8) | b;
+        }
+        *value = tmp;
+        return true;
+    }
+
+    void parse(struct datum &d) {
+        if (d.read_uint8(&first_byte) == false) {
+            return;
+        }
+        if ((first_byte & 0xf0) != 0xc0) {
+            return;   /* not a long header Initial packet */
+        }
+        size_t tmp = 0;
+        if (d.read_uint<4>(&tmp) == false) {
+            return;
+        }
+        version = tmp;
+        if (version != 0x00000001) {
+            return;   /* only QUIC v1 is supported */
+        }
+        uint8_t dcid_length = 0;
+        if (d.read_uint8(&dcid_length) == false || dcid_length > 20) {
+            return;
+        }
+        dcid.parse(d, dcid_length);
+        uint8_t scid_length = 0;
+        if (d.read_uint8(&scid_length) == false || scid_length > 20) {
+            return;
+        }
+        scid.parse(d, scid_length);
+        size_t token_length = 0;
+        if (parse_var_int(d, &token_length) == false) {
+            return;
+        }
+        token.parse(d, token_length);
+        size_t length = 0;
+        if (parse_var_int(d, &length) == false) {
+            return;
+        }
+        payload.parse(d, length);
+        if (payload.is_not_empty() && dcid.is_not_empty()) {
+            valid = true;
+        }
+    }
+
+    bool is_not_empty() const { return valid; }
+};
+
+/* enough for the CRYPTO content of a full-sized Initial packet */
+#define QUIC_CRYPTO_BUF_LEN 4096
+
+/*
+ * quic_decrypt_initial() derives the Initial secrets from the
+ * destination connection ID, removes header protection, decrypts the
+ * packet payload, and reassembles the CRYPTO frames it carries into
+ * crypto_buf; on success, crypto_data is set to the reassembled
+ * stream, which holds the start of the embedded TLS handshake
+ */
+bool quic_decrypt_initial(const struct quic_initial_packet &quic_pkt,
+                          uint8_t *crypto_buf,
+                          size_t crypto_buf_len,
+                          struct datum &crypto_data);
+
+#endif /* QUIC_H */
@@ -0,0 +1,247 @@
+/*
+ * reanalyze.cc
+ *
+ * batch tool that reprocesses stored mercury JSON output through the
+ * analysis engine, so that previously captured flows can be rescored
+ * against a newer fingerprint database without replaying packets
+ *
+ * usage: reanalyze mercury.json [resource-dir]
+ *
+ * The input file is mapped into memory and split into batches at
+ * newline boundaries; the batches are dispatched across one worker
+ * thread per core, and each record is scored by the same
+ * perform_analysis() path that the live capture path uses (see
+ * analysis.cc).  Records that do not carry a TLS fingerprint are
+ * passed over.  Output records appear on stdout in input order.
+ *
+ * build with "make reanalyze"
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "analysis.h"
+#include "datum.h"
+
+/* maximum sizes of the fields copied out of a record */
+#define REANALYZE_MAX_FP_LEN   4096
+#define REANALYZE_MAX_SNI_LEN  257
+#define REANALYZE_MAX_ADDR_LEN 48
+
+/*
+ * struct mercury_record represents the analysis-relevant fields of a
+ * mercury JSON output record.  It is constructed by parsing a string
+ * containing such a record, with these caveats:
+ *      * the order of the fields must match those used by mercury
+ *      * there must be no whitespace
+ * No JSON validation is performed; a record that does not match the
+ * expected shape parses to an empty tls_fingerprint and is skipped.
+ */
+struct mercury_record {
+    struct datum tls_fingerprint{NULL, NULL};
+    struct datum server_name{NULL, NULL};
+    struct datum dst_ip{NULL, NULL};
+    struct datum dst_port{NULL, NULL};
+
+    mercury_record(struct datum &d) {
+        parse(d);
+    };
+
+    void parse(struct datum &d) {
+
+        uint8_t next_byte;
+        if (d.accept('{')) return;
+        if (d.accept_byte((const uint8_t *)"\"}", &next_byte)) return;
+        struct datum key{NULL, NULL};
+        if (next_byte == '\"') {
+            key.parse_up_to_delim(d, '\"'); // "fingerprints"
+            if (d.accept_byte((const uint8_t *)"\"", &next_byte)) return;
+        }
+        if (key.length() != (ssize_t)(sizeof("fingerprints")-1)
+            || memcmp(key.data, "fingerprints", sizeof("fingerprints")-1) != 0) return;
+        if (d.accept(':')) return;
+        if (d.accept('{')) return;
+        if (d.accept('\"')) return;
+        key = {NULL, NULL};
+        key.parse_up_to_delim(d, '\"');  // fingerprint type
+        if (d.accept('\"')) return;
+        if (key.length() != 3 || memcmp(key.data, "tls", 3) != 0) return;
+
+        if (d.accept(':')) return;
+        if (d.accept('\"')) return;
+        tls_fingerprint.parse_up_to_delim(d, '\"');
+        if (d.accept('\"')) return;
+        if (d.accept('}')) return;
+
+        if (parser_skip_upto_delim(&d, (const unsigned char *)"server_name", sizeof("server_name")-1)) return;
+        if (d.accept('\"')) return;
+        if (d.accept(':')) return;
+        if (d.accept('\"')) return;
+        server_name.parse_up_to_delim(d, '\"');
+        if (d.accept('\"')) return;
+
+        if (parser_skip_upto_delim(&d, (const unsigned char *)"dst_ip", sizeof("dst_ip")-1)) return;
+        if (d.accept('\"')) return;
+        if (d.accept(':')) return;
+        if (d.accept('\"')) return;
+        dst_ip.parse_up_to_delim(d, '\"');
+        if (d.accept('\"')) return;
+
+        if (parser_skip_upto_delim(&d, (const unsigned char *)"dst_port", sizeof("dst_port")-1)) return;
+        if (d.accept('\"')) return;
+        if (d.accept(':')) return;
+        dst_port.parse_up_to_delim(d, ',');
+
+    }
+
+    bool is_valid() {
+        return tls_fingerprint.is_not_empty()
+            && dst_ip.is_not_empty()
+            && dst_port.is_not_empty();
+    }
+};
+
+/*
+ * reanalyze_lines(data, data_end, out) parses and scores every
+ * newline-terminated record in [data, data_end), appending the
+ * results to the string out; it is the worker-thread function
+ */
+static void reanalyze_lines(const uint8_t *data, const uint8_t *data_end, std::string *out) {
+
+    while (data < data_end) {
+        const uint8_t *eol = (const uint8_t *)memchr(data, '\n', data_end - data);
+        if (eol == NULL) {
+            eol = data_end;
+        }
+        struct datum line{data, eol};
+        data = eol + 1;
+
+        struct mercury_record record{line};
+        if (!record.is_valid()
+            || record.tls_fingerprint.length() + 1 > REANALYZE_MAX_FP_LEN
+            || record.server_name.length() + 1 > REANALYZE_MAX_SNI_LEN
+            || record.dst_ip.length() + 1 > REANALYZE_MAX_ADDR_LEN) {
+            continue;
+        }
+
+        /* the analysis interface takes NUL-terminated strings */
+        char fp_str[REANALYZE_MAX_FP_LEN];
+        char sn_str[REANALYZE_MAX_SNI_LEN] = { 0 };
+        char dst_ip_str[REANALYZE_MAX_ADDR_LEN];
+        record.tls_fingerprint.strncpy(fp_str, sizeof(fp_str));
+        if (record.server_name.is_not_empty()) {
+            record.server_name.strncpy(sn_str, sizeof(sn_str));
+        }
+        record.dst_ip.strncpy(dst_ip_str, sizeof(dst_ip_str));
+        char port_str[8] = { 0 };
+        record.dst_port.strncpy(port_str, sizeof(port_str));
+        uint16_t dst_port = strtoul(port_str, NULL, 10);
+
+        char *result = NULL;
+        if (perform_analysis_from_strings(&result, REANALYZE_MAX_FP_LEN, fp_str, sn_str, dst_ip_str, dst_port) == -1) {
+            continue;
+        }
+        char obuf[2 * REANALYZE_MAX_FP_LEN];
+        int olen = snprintf(obuf, sizeof(obuf),
+                            "{\"fingerprints\":{\"tls\":\"%s\"},\"server_name\":\"%s\",\"dst_ip\":\"%s\",\"dst_port\":%u,%s}\n",
+                            fp_str, sn_str, dst_ip_str, dst_port, result);
+        free(result);
+        if (olen > 0 && (size_t)olen < sizeof(obuf)) {
+            out->append(obuf, olen);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s mercury.json [resource-dir]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *infile = argv[1];
+    const char *resource_dir = (argc == 3) ? argv[2] : NULL;
+
+    if (analysis_init(0, resource_dir) == -1) {
+        fprintf(stderr, "error: could not initialize analysis engine\n");
+        return EXIT_FAILURE;
+    }
+
+    int fd = open(infile, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "error: could not open file %s\n", infile);
+        analysis_finalize();
+        return EXIT_FAILURE;
+    }
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) != 0) {
+        fprintf(stderr, "error: could not stat file %s\n", infile);
+        close(fd);
+        analysis_finalize();
+        return EXIT_FAILURE;
+    }
+    size_t file_size = statbuf.st_size;
+    const uint8_t *file_base = NULL;
+    if (file_size > 0) {
+        file_base = (const uint8_t *)mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (file_base == MAP_FAILED) {
+            fprintf(stderr, "error: could not map file %s\n", infile);
+            close(fd);
+            analysis_finalize();
+            return EXIT_FAILURE;
+        }
+    }
+    close(fd);
+
+    unsigned int num_workers = std::thread::hardware_concurrency();
+    if (num_workers == 0) {
+        num_workers = 1;
+    }
+
+    /*
+     * divide the mapping into one span per worker, moving each
+     * boundary forward to the next newline so that no record is
+     * split; the vectorized memchr() in the worker then carries the
+     * line scan.  Each worker accumulates its output privately, and
+     * the spans are written out in order, so the output is
+     * deterministic regardless of scheduling.
+     */
+    const uint8_t *file_end = file_base + file_size;
+    std::vector<std::thread> workers;
+    std::vector<std::string> output(num_workers);
+    const uint8_t *start = file_base;
+    for (unsigned int w = 0; w < num_workers; w++) {
+        const uint8_t *stop = file_base + (file_size * (w + 1)) / num_workers;
+        if (w == num_workers - 1 || stop >= file_end) {
+            stop = file_end;
+        } else if (stop > start) {
+            const uint8_t *eol = (const uint8_t *)memchr(stop - 1, '\n', file_end - (stop - 1));
+            stop = eol ? eol + 1 : file_end;
+        }
+        if (stop < start) {
+            stop = start;
+        }
+        workers.push_back(std::thread(reanalyze_lines, start, stop, &output[w]));
+        start = stop;
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    for (auto &span : output) {
+        fwrite(span.data(), 1, span.size(), stdout);
+    }
+
+    if (file_base) {
+        munmap((void *)file_base, file_size);
+    }
+    analysis_finalize();
+
+    return 0;
+}
@@ -1,11 +1,16 @@
 /**
  * rand_pkt_drop.c
  *
- * random packet drops, to enable testing that adaptively finds the
- * maximum packet throughput
+ * flow-consistent packet drops, to enable testing that adaptively
+ * finds the maximum packet throughput; load is shed by whole flows
+ * (selected deterministically by hashing the 5-tuple) rather than by
+ * random packets, so that every flow that is kept yields complete
+ * fingerprints instead of half-parsed handshakes.  The accepted
+ * fraction adapts to the socket drop counters; see
+ * check_socket_drops() in af_packet_v3.c.
  */
 
-#include <stdlib.h>
+#include <stdint.h>
 
 int rnd_pkt_drop_percent_accept = 0; /* default */
 
@@ -30,28 +35,66 @@ int increment_percent_accept(int incr) {
     }
 }
 
-int select_random(int percent) {
-    /* get random number in the range of 1 to 101 */
-    int random_num = rand() % 101 + 1;
+/*
+ * maps the packet's 5-tuple to a number in the range 0 to 99, or
+ * returns -1 for packets that have no 5-tuple (non-IP, or truncated).
+ * Source and destination are folded together with XOR so that both
+ * directions of a flow land in the same bucket, and the bucket is
+ * the same for every packet of the flow, so a flow is either kept in
+ * its entirety or shed in its entirety.
+ */
+static int flow_hash_bucket(const unsigned char *packet, unsigned int length) {
+    uint32_t hash = 0;
+    const unsigned char *l3, *l4;
+    unsigned int proto;
+
+    if (length < 14 + 20) {
+        return -1;
+    }
+    unsigned int ethertype = (packet[12] << 8) | packet[13];
+    l3 = packet + 14;
+    length -= 14;
 
-    /**
-     * from the random_num, determine if we want to select this packet
-     * depending on the accept_percentage (defined and set in configure.c)
-     */
-    if (random_num < percent) {
-        return 1;
+    if (ethertype == 0x0800) {          /* IPv4 */
+        unsigned int ihl = (l3[0] & 0x0f) * 4;
+        if (ihl < 20 || length < ihl + 4) {
+            return -1;
+        }
+        proto = l3[9];
+        for (int i = 0; i < 4; i++) {
+            hash = hash * 33 + (l3[12 + i] ^ l3[16 + i]);
+        }
+        l4 = l3 + ihl;
+    } else if (ethertype == 0x86dd) {   /* IPv6 */
+        if (length < 40 + 4) {
+            return -1;
+        }
+        proto = l3[6];
+        for (int i = 0; i < 16; i++) {
+            hash = hash * 33 + (l3[8 + i] ^ l3[24 + i]);
+        }
+        l4 = l3 + 40;
     } else {
-        return 0;
+        return -1;
     }
-}
 
+    if (proto == 6 || proto == 17) {    /* fold in the TCP or UDP ports */
+        hash = hash * 33 + (l4[0] ^ l4[2]);
+        hash = hash * 33 + (l4[1] ^ l4[3]);
+    }
+    hash = (hash + proto) * 0x61C88647; /* Fibonacci scramble of the folded tuple */
+
+    return (hash >> 17) % 100;
+}
 
-unsigned int drop_this_packet(void) {
+unsigned int drop_this_packet(const unsigned char *packet, unsigned int length) {
     int percent = get_percent_accept();
     if (percent > 0) {
-        if (select_random(percent) == 0) {
+        int bucket = flow_hash_bucket(packet, length);
+        if (bucket >= percent) {
             return 1;
         }
+        /* packets without a 5-tuple (bucket -1) are never shed */
     }
     return 0;
 }
@@ -11,8 +11,6 @@ void set_percent_accept(unsigned int p);
 
 int increment_percent_accept(int incr);
 
-int select_random(int percent);
-
-unsigned int drop_this_packet(void);
+unsigned int drop_this_packet(const unsigned char *packet, unsigned int length);
 
 #endif /* RND_PKT_DROP_H */
@@ -0,0 +1,97 @@
+/*
+ * serializer.c
+ *
+ * the serializer pool of the two-stage parse/serialize pipeline; see
+ * serializer.h for the design
+ *
+ * Copyright (c) 2019 Cisco Systems, Inc. All rights reserved.  License at
+ * https://github.com/cisco/mercury/blob/master/LICENSE
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mercury.h"
+#include "llq.h"
+#include "output.h"
+#include "json_file_io.h"
+#include "serializer.h"
+
+static void *serializer_thread_func(void *arg) {
+    struct serializer_thread *st = (struct serializer_thread *)arg;
+    struct serializer_pool *pool = st->pool;
+
+    for (;;) {
+        int did_work = 0;
+
+        /* each parse queue has exactly one consumer: queue q belongs
+         * to serializer (q mod num_serializers), so the rings stay
+         * single-producer, single-consumer */
+        for (int q = st->snum; q < pool->num_parse_queues; q += pool->num_serializers) {
+            struct ll_queue *pq = &pool->parse_queues.queue[q];
+            struct llq_msg *msg;
+            while ((msg = llq_peek(pq)) != NULL) {
+                json_queue_write(st->out_llq, (uint8_t *)llq_msg_buf(msg), msg->len,
+                                 msg->ts.tv_sec, msg->ts.tv_nsec);
+                llq_consume(pq, msg);
+                did_work = 1;
+            }
+        }
+        if (did_work == 0) {
+            if (pool->stop) {
+                break;       /* the workers are gone and the queues are drained */
+            }
+            usleep(50);      /* idle; parse queues are empty */
+        }
+    }
+    json_queue_flush(st->out_llq);   /* send any records held by flow aggregation */
+    return NULL;
+}
+
+enum status serializer_pool_init(struct serializer_pool *pool,
+                                 int num_serializers,
+                                 int num_parse_queues,
+                                 struct thread_queues *output_queues) {
+
+    if (output_queues->qnum < num_serializers) {
+        fprintf(stderr, "error: %d output queues for %d serializer threads\n",
+                output_queues->qnum, num_serializers);
+        return status_err;
+    }
+    pool->num_serializers = num_serializers;
+    pool->num_parse_queues = num_parse_queues;
+    pool->stop = 0;
+    thread_queues_init(&pool->parse_queues, num_parse_queues,
+                       "serializer", "parse queues (two-stage pipeline)");
+
+    pool->threads = (struct serializer_thread *)calloc(num_serializers, sizeof(struct serializer_thread));
+    if (pool->threads == NULL) {
+        fprintf(stderr, "error: could not allocate serializer thread array\n");
+        return status_err;
+    }
+    for (int i = 0; i < num_serializers; i++) {
+        pool->threads[i].snum = i;
+        pool->threads[i].out_llq = &output_queues->queue[i];
+        pool->threads[i].pool = pool;
+        if (pthread_create(&pool->threads[i].tid, NULL, serializer_thread_func, &pool->threads[i]) != 0) {
+            perror("error creating serializer thread");
+            return status_err;
+        }
+    }
+    return status_ok;
+}
+
+void serializer_pool_stop(struct serializer_pool *pool) {
+    pool->stop = 1;
+    for (int i = 0; i < pool->num_serializers; i++) {
+        pthread_join(pool->threads[i].tid, NULL);
+    }
+}
+
+void serializer_pool_free(struct serializer_pool *pool) {
+    thread_queues_free(&pool->parse_queues);
+    free(pool->threads);
+    pool->threads = NULL;
+}
@@ -0,0 +1,75 @@
+/*
+ * serializer.h
+ *
+ * two-stage parse/serialize pipeline (--serialize-threads)
+ *
+ * Copyright (c) 2019 Cisco Systems, Inc. All rights reserved.  License at
+ * https://github.com/cisco/mercury/blob/master/LICENSE
+ */
+
+#ifndef SERIALIZER_H
+#define SERIALIZER_H
+
+#include <pthread.h>
+#include "mercury.h"
+#include "llq.h"
+
+/*
+ * In the two-stage pipeline, each capture worker forwards raw frames
+ * into its own parse queue instead of parsing and serializing them in
+ * place, and a separately sized pool of serializer threads turns the
+ * queued frames into JSON records on the ordinary output queues.  A
+ * serialization-heavy packet (a certificate chain, say) then costs a
+ * serializer thread time, not ring consumption, and the two pools are
+ * sized to their own bottlenecks: capture threads for peak packet
+ * rate, serializer threads for record volume.
+ *
+ * The parse queues are the same single-producer, single-consumer
+ * rings used for output: one per capture worker, each consumed by
+ * exactly one serializer (the queues are dealt to the serializers
+ * round-robin), and each serializer publishes into its own output
+ * queue, which the output thread merges as usual.  Per-thread state
+ * in the serialization path (the flow aggregator, tcp reassembly) is
+ * thread local, so it moves to the serializer threads unchanged.
+ */
+
+struct serializer_pool;
+
+struct serializer_thread {
+    pthread_t tid;
+    int snum;                      /* this serializer's index in the pool */
+    struct ll_queue *out_llq;      /* this serializer's output queue      */
+    struct serializer_pool *pool;
+};
+
+struct serializer_pool {
+    int num_serializers;
+    int num_parse_queues;          /* one parse queue per capture worker  */
+    struct thread_queues parse_queues;
+    struct serializer_thread *threads;
+    volatile int stop;             /* set once the capture workers have exited */
+};
+
+/*
+ * serializer_pool_init() allocates the parse queues and starts the
+ * serializer threads; output_queues must hold at least one queue per
+ * serializer, since each serializer publishes into its own
+ */
+enum status serializer_pool_init(struct serializer_pool *pool,
+                                 int num_serializers,
+                                 int num_parse_queues,
+                                 struct thread_queues *output_queues);
+
+/*
+ * serializer_pool_stop() is called after the capture workers have
+ * been joined; the serializers drain whatever remains in the parse
+ * queues, flush any records held by flow aggregation, and exit.  The
+ * parse queues and their counters remain valid until
+ * serializer_pool_free(), so the caller can fold them into the final
+ * summary first.
+ */
+void serializer_pool_stop(struct serializer_pool *pool);
+
+void serializer_pool_free(struct serializer_pool *pool);
+
+#endif /* SERIALIZER_H */
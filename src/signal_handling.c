@@ -14,6 +14,8 @@
 #include "signal_handling.h"
 
 int sig_close_flag = 0; /* Watched by the threads while processing packets */
+int sig_reload_flag = 0; /* Watched by the analysis reload thread */
+int sig_memory_report_flag = 0; /* Watched by the stats thread */
 
 /*
  * sig_close() causes a graceful shutdown of the program after recieving
@@ -24,6 +26,26 @@ void sig_close (int signal_arg) {
     sig_close_flag = 1; /* tell all threads to shutdown gracefully */
 }
 
+/*
+ * sig_reload() requests a reload of the analysis resources; the
+ * reload itself runs on a dedicated thread (see analysis.cc), not in
+ * signal context
+ */
+void sig_reload (int signal_arg) {
+    (void)signal_arg;
+    sig_reload_flag = 1;
+}
+
+/*
+ * sig_memory_report() requests a memory accounting report; the report
+ * itself is printed by the stats thread (see af_packet_v3.c), not in
+ * signal context
+ */
+void sig_memory_report (int signal_arg) {
+    (void)signal_arg;
+    sig_memory_report_flag = 1;
+}
+
 /*
  * set up signal handlers, so that output is flushed upon close
  *
@@ -39,6 +61,16 @@ enum status setup_signal_handler(void) {
         return status_err;
     }
 
+    /* kill -HUP causes the analysis resources to be reloaded */
+    if (signal(SIGHUP, sig_reload) == SIG_ERR) {
+        return status_err;
+    }
+
+    /* kill -USR1 causes a memory accounting report to be printed */
+    if (signal(SIGUSR1, sig_memory_report) == SIG_ERR) {
+        return status_err;
+    }
+
     return status_ok;
 }
 
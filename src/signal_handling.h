@@ -14,9 +14,15 @@
 #include "mercury.h"
 
 extern int sig_close_flag; /* Watched by the threads while processing packets */
+extern int sig_reload_flag; /* Watched by the analysis reload thread */
+extern int sig_memory_report_flag; /* Watched by the stats thread */
 
 void sig_close (int signal_arg);
 
+void sig_reload (int signal_arg);
+
+void sig_memory_report (int signal_arg);
+
 enum status setup_signal_handler(void);
 
 void enable_all_signals(void);
@@ -10,7 +10,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <arpa/inet.h>
-#include <unordered_map>
+#include <functional>
 #include "mercury.h"
 
 
@@ -111,30 +111,225 @@ struct key {
             return 0;
         }
     }
+
+    uint64_t hash() const;   // defined below, after the per-ISA helpers
 };
 
+/*
+ * key::hash() maps a flow key onto a table slot, using the hardware
+ * CRC32-C instruction when the processor provides it and a
+ * multiplicative mix otherwise; it is the hash for every table a key
+ * sits in.  Only the fields that are valid for the key's IP version
+ * are hashed, so that the uninitialized part of the address union
+ * cannot affect the result.
+ */
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static inline uint64_t flow_key_hash_crc32c(const struct key &k) {
+    uint64_t h = __builtin_ia32_crc32di(0xffffffff,
+                                        (uint64_t) k.src_port
+                                        | ((uint64_t) k.dst_port << 16)
+                                        | ((uint64_t) k.ip_vers  << 32)
+                                        | ((uint64_t) k.protocol << 40));
+    if (k.ip_vers == 6) {
+        h = __builtin_ia32_crc32di(h, (uint64_t) k.addr.ipv6.src.a | ((uint64_t) k.addr.ipv6.src.b << 32));
+        h = __builtin_ia32_crc32di(h, (uint64_t) k.addr.ipv6.src.c | ((uint64_t) k.addr.ipv6.src.d << 32));
+        h = __builtin_ia32_crc32di(h, (uint64_t) k.addr.ipv6.dst.a | ((uint64_t) k.addr.ipv6.dst.b << 32));
+        h = __builtin_ia32_crc32di(h, (uint64_t) k.addr.ipv6.dst.c | ((uint64_t) k.addr.ipv6.dst.d << 32));
+    } else {
+        h = __builtin_ia32_crc32di(h, (uint64_t) k.addr.ipv4.src | ((uint64_t) k.addr.ipv4.dst << 32));
+    }
+    return h;
+}
+#endif
+
+static inline uint64_t flow_key_hash_mix(const struct key &k) {
+    uint64_t h = (uint64_t) k.src_port
+        | ((uint64_t) k.dst_port << 16)
+        | ((uint64_t) k.ip_vers  << 32)
+        | ((uint64_t) k.protocol << 40);
+    if (k.ip_vers == 6) {
+        h ^= (uint64_t) k.addr.ipv6.src.a | ((uint64_t) k.addr.ipv6.src.b << 32);
+        h *= 0x9e3779b97f4a7c15;
+        h ^= (uint64_t) k.addr.ipv6.src.c | ((uint64_t) k.addr.ipv6.src.d << 32);
+        h *= 0x9e3779b97f4a7c15;
+        h ^= (uint64_t) k.addr.ipv6.dst.a | ((uint64_t) k.addr.ipv6.dst.b << 32);
+        h *= 0x9e3779b97f4a7c15;
+        h ^= (uint64_t) k.addr.ipv6.dst.c | ((uint64_t) k.addr.ipv6.dst.d << 32);
+    } else {
+        h ^= (uint64_t) k.addr.ipv4.src | ((uint64_t) k.addr.ipv4.dst << 32);
+    }
+    h *= 0x9e3779b97f4a7c15;
+    h ^= h >> 32;
+    return h;
+}
+
+inline uint64_t key::hash() const {
+#if defined(__x86_64__)
+    static const bool have_crc32c = __builtin_cpu_supports("sse4.2");
+    if (have_crc32c) {
+        return flow_key_hash_crc32c(*this);
+    }
+#endif
+    return flow_key_hash_mix(*this);
+}
 
 namespace std {
 
     template <>  struct hash<struct key>  {
-        std::size_t operator()(const struct key& k) const    {
-
-            /* assume sizeof(size_t) == 8 for now */
-            size_t x = (size_t) k.src_port | ((size_t) k.dst_port << 16) | ((size_t) k.ip_vers) << 32 | ((size_t) k.protocol) << 40;
-            x ^= (size_t) k.addr.ipv6.src.a;
-            x ^= (size_t) k.addr.ipv6.src.b;
-            x ^= (size_t) k.addr.ipv6.src.c;
-            x ^= (size_t) k.addr.ipv6.src.d;
-            x ^= (size_t) k.addr.ipv6.dst.a;
-            x ^= (size_t) k.addr.ipv6.dst.b;
-            x ^= (size_t) k.addr.ipv6.dst.c;
-            x ^= (size_t) k.addr.ipv6.dst.d;
-
-            return x;
+        std::size_t operator()(const struct key& k) const {
+            return k.hash();
         }
     };
 }
 
+/*
+ * The per-flow state of the initial message filter is kept in a
+ * preallocated open-addressing hash table rather than a node-based
+ * container: a flow lookup happens for every tcp packet, and linear
+ * probing over a flat array avoids both the allocation per flow
+ * insert and the pointer chasing per packet lookup that
+ * unordered_map costs.  The table length is a power of two, so a
+ * hash maps onto a slot with a mask; the table doubles when it
+ * becomes half full, which keeps probe sequences short.  Erasing an
+ * entry shifts the remainder of its probe cluster backward, so no
+ * tombstones accumulate.
+ *
+ * Flows that go silent without a FIN or RST would otherwise linger
+ * forever, so every entry carries a generation stamp from a clock
+ * that advances once per lookup, and each lookup also sweeps one
+ * slot, erasing it if its flow has not been seen for expiry_age
+ * lookups.  The table stops doubling at max_table_length; at that
+ * hard cap an insert reclaims the least recently used entry of the
+ * incoming key's own probe cluster instead of growing, so memory
+ * stays flat and probes stay short even under a SYN flood.
+ */
+struct tcp_flow_table {
+    static const size_t default_table_length = 65536;   // slots; must be a power of two
+    static const size_t max_table_length = 1 << 20;     // hard cap on slots
+    static const uint64_t expiry_age = 1 << 18;         // lookups without traffic before a flow expires
+
+    struct entry {
+        struct key k;            // ip_vers == 0 marks an empty slot
+        struct tcp_state state;
+        uint64_t last_used;      // clock value at the flow's most recent packet
+    };
+
+    struct entry *table;
+    size_t table_length;
+    size_t entry_count;
+    uint64_t clock;              // advances once per lookup
+    size_t sweep_cursor;
+
+    explicit tcp_flow_table(size_t length=default_table_length) :
+        table{new entry[length]()}, table_length{length}, entry_count{0}, clock{0}, sweep_cursor{0} {}
+
+    ~tcp_flow_table() { delete[] table; }
+
+    size_t slot_of(const struct key &k) const {
+        return k.hash() & (table_length - 1);
+    }
+
+    struct tcp_state *find(const struct key &k) {
+        clock++;
+        sweep();
+        for (size_t i = slot_of(k); table[i].k.ip_vers != 0; i = (i + 1) & (table_length - 1)) {
+            if (table[i].k == k) {
+                table[i].last_used = clock;
+                return &table[i].state;
+            }
+        }
+        return NULL;
+    }
+
+    /*
+     * sweep() examines the slot under the cursor and erases it if its
+     * flow has not been seen for expiry_age lookups; one slot per
+     * lookup is enough to visit the whole table well within the
+     * expiry window
+     */
+    void sweep() {
+        struct entry *e = &table[sweep_cursor];
+        if (e->k.ip_vers != 0 && clock - e->last_used > expiry_age) {
+            erase(e->k);
+        }
+        sweep_cursor = (sweep_cursor + 1) & (table_length - 1);
+    }
+
+    struct tcp_state *insert(const struct key &k, const struct tcp_state &state) {
+        if ((entry_count + 1) * 2 > table_length && table_length < max_table_length) {
+            grow();
+        }
+        size_t i = slot_of(k);
+        size_t victim = SIZE_MAX;
+        while (table[i].k.ip_vers != 0) {
+            if (victim == SIZE_MAX || table[i].last_used < table[victim].last_used) {
+                victim = i;
+            }
+            i = (i + 1) & (table_length - 1);
+        }
+        if ((entry_count + 1) * 2 > table_length && victim != SIZE_MAX) {
+            i = victim;     /* at the hard cap; reclaim the cluster's least recently used flow */
+        } else {
+            entry_count++;
+        }
+        table[i].k = k;
+        table[i].state = state;
+        table[i].last_used = clock;
+        return &table[i].state;
+    }
+
+    void erase(const struct key &k) {
+        size_t i = slot_of(k);
+        while (table[i].k.ip_vers != 0 && !(table[i].k == k)) {
+            i = (i + 1) & (table_length - 1);
+        }
+        if (table[i].k.ip_vers == 0) {
+            return;          /* not present */
+        }
+        /*
+         * shift the following entries of the probe cluster backward
+         * to fill the hole, skipping any whose home slot lies between
+         * the hole and their current slot in cyclic probe order
+         */
+        size_t hole = i;
+        for (i = (i + 1) & (table_length - 1); table[i].k.ip_vers != 0; i = (i + 1) & (table_length - 1)) {
+            size_t home = slot_of(table[i].k);
+            if (((i - home) & (table_length - 1)) >= ((i - hole) & (table_length - 1))) {
+                table[hole] = table[i];
+                hole = i;
+            }
+        }
+        table[hole].k = key{};
+        entry_count--;
+    }
+
+    void grow() {
+        struct entry *old_table = table;
+        size_t old_length = table_length;
+        table_length *= 2;
+        table = new entry[table_length]();
+        for (size_t i = 0; i < old_length; i++) {
+            if (old_table[i].k.ip_vers != 0) {
+                size_t j = slot_of(old_table[i].k);
+                while (table[j].k.ip_vers != 0) {
+                    j = (j + 1) & (table_length - 1);
+                }
+                table[j] = old_table[i];
+            }
+        }
+        delete[] old_table;
+    }
+
+    void clear() {
+        for (size_t i = 0; i < table_length; i++) {
+            table[i].k = key{};
+        }
+        entry_count = 0;
+    }
+};
+
 
 #define BYTE_BINARY_FORMAT "%c%c%c%c%c%c%c%c"
 #define UINT8_BINARY(x)                         \
@@ -203,10 +398,10 @@ void fprintf_tcp_hdr_info(FILE *f, const struct key *k, const struct tcp_header
 #define DROP_PACKET     0
 
 struct tcp_initial_message_filter {
-    std::unordered_map<struct key, struct tcp_state> tcp_flow_table;
+    struct tcp_flow_table tcp_flow_table;
 
     void tcp_initial_message_filter_init(void) {
-        tcp_flow_table = {};
+        tcp_flow_table.clear();
     }
 
     // A TCP message is defined as the set of TCP/IP packets for which
@@ -232,63 +427,60 @@ struct tcp_initial_message_filter {
         k.dst_port = tcp->dst_port;
         size_t data_length = length - tcp_offrsv_get_header_length(tcp->offrsv);
 
-        auto it = tcp_flow_table.find(k);
-        if (it == tcp_flow_table.end()) {
+        struct tcp_state *state = tcp_flow_table.find(k);
+        if (state == NULL) {
 
             uint32_t tmp_seq = tcp->seq;
             if (TCP_IS_SYN(tcp->flags)) {
                 tmp_seq = htonl(ntohl(tcp->seq) + 1);
             }
-            struct tcp_state state = { tmp_seq,  // .seq
-                                       tcp->ack, // .ack
-                                       0,        // .msg_num
-                                       tmp_seq,  // .init_seq
-                                       tcp->ack, // .init_ack
-                                       listening // .disposition
+            struct tcp_state new_state = { tmp_seq,  // .seq
+                                           tcp->ack, // .ack
+                                           0,        // .msg_num
+                                           tmp_seq,  // .init_seq
+                                           tcp->ack, // .init_ack
+                                           listening // .disposition
             };
-            tcp_flow_table[k] = state;
+            tcp_flow_table.insert(k, new_state);
             retval = ACCEPT_PACKET;
 
-            fprintf_tcp_hdr_info(stderr, &k, tcp, &state, length, retval);
+            fprintf_tcp_hdr_info(stderr, &k, tcp, &new_state, length, retval);
 
         } else {
 
-            struct tcp_state state = it->second;
-
             // initialize acknowledgement number, if it has not yet been set
-            if (state.ack == 0) {
-                state.ack = tcp->ack;
-                state.init_ack = tcp->ack;
+            if (state->ack == 0) {
+                state->ack = tcp->ack;
+                state->init_ack = tcp->ack;
             }
 
             // update disposition and message number if appropriate
             if (data_length > 0) {
-                if (ntohl(tcp->ack) > ntohl(state.ack) || state.disposition == listening) {
-                    state.msg_num++;
+                if (ntohl(tcp->ack) > ntohl(state->ack) || state->disposition == listening) {
+                    state->msg_num++;
                 }
-                state.disposition = talking;
+                state->disposition = talking;
             } else {
-                if (ntohl(tcp->ack) > ntohl(state.ack)) {
-                    state.disposition = listening;
+                if (ntohl(tcp->ack) > ntohl(state->ack)) {
+                    state->disposition = listening;
                 }
             }
-            if (state.disposition == talking && state.msg_num < 2) {
+            if (state->disposition == talking && state->msg_num < 2) {
                 retval = ACCEPT_PACKET;
             }
 
             // update state
-            if (ntohl(tcp->seq) > ntohl(state.seq)) {
-                state.seq = tcp->seq;
+            if (ntohl(tcp->seq) > ntohl(state->seq)) {
+                state->seq = tcp->seq;
             }
-            if (ntohl(tcp->ack) > ntohl(state.ack)) {
-                state.ack = tcp->ack;
+            if (ntohl(tcp->ack) > ntohl(state->ack)) {
+                state->ack = tcp->ack;
             }
-            tcp_flow_table[k] = state;
 
-            fprintf_tcp_hdr_info(stderr, &k, tcp, &state, length, retval);
+            fprintf_tcp_hdr_info(stderr, &k, tcp, state, length, retval);
 
             if (TCP_IS_FIN(tcp->flags) || TCP_IS_RST(tcp->flags)) {
-                tcp_flow_table.erase(it);
+                tcp_flow_table.erase(k);
             }
         }
 
@@ -300,60 +492,112 @@ struct tcp_initial_message_filter {
 /*
  * partial tcp reassembly
  *
- * strategy:
+ * A fingerprintable message that extends past the segment carrying
+ * its start (a ClientHello with post-quantum key shares, a large
+ * certificate chain) is assembled by a bounded, fingerprint-focused
+ * reassembler before being handed to the normal processing path.
+ * The strategy:
  *
- *    - pre-allocated storage array to hold reassembled packets
- *    - maximum length 4096 bytes
- *    - flow key maps to array entry
+ *    - a pre-allocated array of fixed-size buffers, large enough for
+ *      one maximum-length TLS record; the flow key hashes to an array
+ *      entry (direct mapped), so insertion, lookup, and eviction are
+ *      all O(1) and memory use is strictly bounded
+ *    - only messages identified by get_message_type() on their first
+ *      segment are buffered, and only in-order continuation segments
+ *      are accepted; packet loss, reordering, or a colliding flow
+ *      just abandons the message, leaving behavior no worse than
+ *      having no reassembler
  *
- *    - copy_packet(packet, packet_length, additional_bytes_needed)
- *    - check_packet(packet, packet_length)
+ *    - start_message(k, seq_next, data, length, bytes_needed)
+ *    - continue_message(k, seq, data, length)
  */
 
 struct tcp_buffer {
-    tcp_buffer() : k{}, seq_end{}, data{} { };
-    struct key k;
-    uint32_t seq_end;
-    uint8_t data[8192 - sizeof(struct key) - sizeof(seq_end)];
-    static const size_t array_length = 8192;
-};
+    static const size_t data_length = 16384 + 5;  // one maximum-length TLS record
 
-struct tcp_reassembler {
-    struct tcp_buffer buffer[8192];
+    struct key k;            // flow key; ip_vers == 0 marks the entry unused
+    uint32_t seq_next;       // sequence number expected of the next segment
+    uint32_t bytes_needed;   // total length of the message being assembled
+    uint32_t bytes_present;  // length assembled so far
+    uint8_t data[data_length];
 
-    tcp_reassembler() : buffer{} {  }
+    tcp_buffer() : k{}, seq_next{0}, bytes_needed{0}, bytes_present{0}, data{} { };
 
-    void copy_packet(struct key &k, const struct tcp_header *tcp, size_t length, size_t bytes_needed) {
+    bool is_in_use() const { return k.ip_vers != 0; }
 
-        k.src_port = tcp->src_port;
-        k.dst_port = tcp->dst_port;
-        size_t data_length = length - tcp_offrsv_get_header_length(tcp->offrsv);
-        (void)data_length;
+    void clear() {
+        k = key{};
+        seq_next = 0;
+        bytes_needed = 0;
+        bytes_present = 0;
+    }
+};
 
-        std::hash<struct key> hasher;
-        size_t h = hasher(k) % tcp_buffer::array_length;
-        buffer[h].k = k;
-        buffer[h].seq_end = tcp->seq + bytes_needed;
-        fprintf(stderr, "inserted flow key\n");
+struct tcp_reassembler {
+    static const size_t table_length = 512;  // about 8.4MB per thread
 
-    }
+    struct tcp_buffer *buffer;  // heap allocated; too large for thread-local storage
 
-    bool check_packet(struct key &k, const struct tcp_header *tcp, size_t length) {
+    tcp_reassembler() : buffer{new tcp_buffer[table_length]} {  }
 
-        k.src_port = tcp->src_port;
-        k.dst_port = tcp->dst_port;
-        size_t data_length = length - tcp_offrsv_get_header_length(tcp->offrsv);
-        (void)data_length;
+    ~tcp_reassembler() { delete[] buffer; }
 
-        std::hash<struct key> hasher;
-        size_t h = hasher(k) % tcp_buffer::array_length;
-        if (k == buffer[h].k) {
-            fprintf(stderr, "found flow key\n");
-        } else {
-            ;
+    struct tcp_buffer *slot(const struct key &k) {
+        return &buffer[k.hash() % table_length];
+    }
+
+    /*
+     * start_message() copies the first length bytes of a message that
+     * will total bytes_needed bytes; seq_next is the sequence number
+     * that the following segment will carry.  A message too large for
+     * one buffer is not started, and a colliding in-progress message
+     * is simply evicted.
+     */
+    void start_message(const struct key &k, uint32_t seq_next, const uint8_t *data, size_t length, size_t bytes_needed) {
+        if (bytes_needed > tcp_buffer::data_length || length >= bytes_needed) {
+            return;
         }
+        struct tcp_buffer *b = slot(k);
+        b->k = k;
+        b->seq_next = seq_next;
+        b->bytes_needed = bytes_needed;
+        b->bytes_present = length;
+        memcpy(b->data, data, length);
+    }
 
-        return true;
+    /*
+     * continue_message() appends a segment to the message being
+     * assembled for flow k, if there is one and the segment is the
+     * in-order successor; it returns the buffer holding the complete
+     * message, or NULL if the message is still incomplete.  The
+     * returned entry is freed for reuse, but its data and lengths
+     * remain intact until this thread's reassembler starts another
+     * message in the same slot, so the caller can process it in place.
+     */
+    struct tcp_buffer *continue_message(const struct key &k, uint32_t seq, const uint8_t *data, size_t length) {
+        struct tcp_buffer *b = slot(k);
+        if (!b->is_in_use() || !(b->k == k)) {
+            return NULL;
+        }
+        if (LT(seq, b->seq_next)) {
+            return NULL;             /* retransmission; nothing new */
+        }
+        if (GT(seq, b->seq_next)) {
+            b->clear();              /* loss or reordering; abandon the message */
+            return NULL;
+        }
+        size_t copy_length = b->bytes_needed - b->bytes_present;
+        if (copy_length > length) {
+            copy_length = length;    /* note: anything past the message is ignored */
+        }
+        memcpy(b->data + b->bytes_present, data, copy_length);
+        b->bytes_present += copy_length;
+        b->seq_next = seq + length;
+        if (b->bytes_present == b->bytes_needed) {
+            b->k = key{};   /* free the slot; data and lengths stay valid for the caller */
+            return b;
+        }
+        return NULL;
     }
 
 };
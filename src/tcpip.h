@@ -67,6 +67,8 @@
 #define TCP_OPT_NOP     1
 #define TCP_OPT_MSS     2
 #define TCP_OPT_WS      3
+#define TCP_OPT_SACK    4
+#define TCP_OPT_TS      8
 
 #define TCP_FIN      0x01
 #define TCP_SYN      0x02
@@ -177,6 +179,35 @@ struct tcp_packet {
             struct json_object json_tcp{o, "tcp"};
             //json_tcp.print_key_value("fingerprint", *this);
             json_tcp.print_key_uint("seq", htonl(header->seq));
+
+            // walk the options in place, reporting the values that
+            // correlate with the sender's OS; the kind ordering is
+            // already captured by the fingerprint string
+            struct datum tmp = tcp_options;
+            while (tmp.length() > 0) {
+                struct tcp_option opt;
+                opt.parse(tmp);
+                switch (opt.kind) {
+                case TCP_OPT_MSS:
+                    if (opt.length() == 2) {
+                        json_tcp.print_key_uint("mss", (opt.data[0] << 8) | opt.data[1]);
+                    }
+                    break;
+                case TCP_OPT_WS:
+                    if (opt.length() == 1) {
+                        json_tcp.print_key_uint("window_scale", opt.data[0]);
+                    }
+                    break;
+                case TCP_OPT_SACK:
+                    json_tcp.print_key_bool("sack", true);
+                    break;
+                case TCP_OPT_TS:
+                    json_tcp.print_key_bool("timestamps", true);
+                    break;
+                default:
+                    ;
+                }
+            }
             json_tcp.close();
         }
     }
@@ -5,6 +5,7 @@
 #include "extractor.h"
 #include "json_object.h"
 #include "tls.h"
+#include "tcp.h"     // for struct key (resumption attribution)
 #include "match.h"
 #include "asn1/x509.h"
 
@@ -47,6 +48,7 @@
 #define type_supported_groups   0x000a
 #define type_supported_versions 0x002b
 #define type_session_ticket     0x0023
+#define type_pre_shared_key     0x0029
 
 static uint16_t static_extension_types[num_static_extension_types] = {
         1,         /* max fragment length                    */
@@ -93,14 +95,25 @@ void raw_as_hex_degrease(struct buffer_stream &buf, const void *data, size_t len
     if (len % 2) {
         return;  // error: len MUST be a multiple of two
     }
-    uint16_t *x = (uint16_t *)data;
-    uint16_t *x_end = x + (len/2);
 
-    while (x < x_end) {
-        uint16_t tmp = degrease_uint16(*x++);
-        buf.raw_as_hex((const uint8_t *)&tmp, sizeof(tmp));
+    /*
+     * copy the values into a stack buffer, normalize the whole array
+     * with degrease_octet_string() (which tests eight values at a
+     * time on x86-64), and write the hex in one pass, instead of
+     * degreasing and serializing two bytes per call; this is the
+     * normalization that runs for every TLS and QUIC handshake on
+     * the wire
+     */
+    const uint8_t *x = (const uint8_t *)data;
+    uint8_t tmp[256];   /* any multiple of sixteen works; chunking covers longer vectors */
+    while (len > 0) {
+        size_t chunk = len < sizeof(tmp) ? len : sizeof(tmp);
+        memcpy(tmp, x, chunk);
+        degrease_octet_string(tmp, chunk);
+        buf.raw_as_hex(tmp, chunk);
+        x += chunk;
+        len -= chunk;
     }
-
 }
 
 void tls_security_assessment::print(struct json_object &o, const char *key) {
@@ -215,8 +228,9 @@ struct tls_extension {
 
     tls_extension(struct datum &p) : type{0}, length{0}, value{NULL, NULL} {
 
-        if (p.read_uint16(&type) == false) { return; }
-        if (p.read_uint16(&length) == false) { return; }
+        type = p.gather_uint16();
+        length = p.gather_uint16();
+        if (p.gather_ok() == false) { return; }
         if (length <= p.length()) {
             value.data = p.data;
             value.data_end = value.data + length;
@@ -349,6 +363,38 @@ void tls_client_hello::parse(struct datum &p) {
 
 }
 
+/*
+ * a hello that carries a nonempty session ticket or a TLS 1.3
+ * pre-shared key offers to resume an earlier session.  The legacy
+ * session id is not used as a signal: TLS 1.3 clients fill it with
+ * random bytes for middlebox compatibility, and an empty session
+ * ticket extension only advertises support (RFC 5077, section 3.1).
+ */
+bool tls_extensions::includes_resumption_state() const {
+
+    struct datum ext_parser{this->data, this->data_end};
+
+    while (parser_get_data_length(&ext_parser) > 0) {
+        size_t tmp_len = 0;
+        size_t tmp_type;
+
+        if (parser_read_and_skip_uint(&ext_parser, L_ExtensionType, &tmp_type) == status_err) {
+            break;
+        }
+        if (parser_read_and_skip_uint(&ext_parser, L_ExtensionLength, &tmp_len) == status_err) {
+            break;
+        }
+        if (parser_skip(&ext_parser, tmp_len) == status_err) {
+            break;
+        }
+        if ((tmp_type == type_session_ticket && tmp_len > 0)
+            || (tmp_type == type_pre_shared_key)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void tls_client_hello::write_json(struct json_object &record, bool output_metadata) const {
     if (ciphersuite_vector.is_not_readable()) {
         return;
@@ -359,6 +405,18 @@ void tls_client_hello::write_json(struct json_object &record, bool output_metada
     }
     struct json_object tls{record, label};
     struct json_object tls_client{tls, "client"};
+    write_json_members(tls_client, output_metadata);
+    tls_client.close();
+    tls.close();
+}
+
+/*
+ * write_json_members() writes the members of the "client" object
+ * without the enclosing "tls"/"client" wrappers, so that a caller can
+ * place them inside an object of its own, as flow aggregation does
+ * when it merges the client and server halves of a session
+ */
+void tls_client_hello::write_json_members(struct json_object &tls_client, bool output_metadata) const {
     if (output_metadata) {
         tls_client.print_key_hex("version", protocol_version);
         tls_client.print_key_hex("random", random);
@@ -372,8 +430,6 @@ void tls_client_hello::write_json(struct json_object &record, bool output_metada
     if (output_metadata) {
         extensions.print_session_ticket(tls_client, "session_ticket");
     }
-    tls_client.close();
-    tls.close();
 }
 
 // static function
@@ -388,6 +444,60 @@ void tls_client_hello::write_json(struct datum &data, struct json_object &record
     hello.write_json(record, output_metadata);
 }
 
+/*
+ * Most of the ClientHellos on a given link come from a small number
+ * of distinct client stacks, so the normalized fingerprint string is
+ * memoized in a small per-thread cache.  The cache key is a 64-bit
+ * FNV-1a hash over exactly the bytes that write_fingerprint()
+ * consumes: the protocol version, the ciphersuite vector, and each
+ * extension's type (plus its value, for the static extension types).
+ * The random, session id, server name, and session ticket fields are
+ * not hashed, so hellos that differ only in those fields share an
+ * entry.  The cache is direct mapped; when two client stacks land in
+ * the same slot, the more recent one overwrites the other.
+ */
+
+#define FP_CACHE_NUM_ENTRIES 256   /* must be a power of two */
+#define FP_CACHE_MAX_FP_LEN  2048
+
+struct fp_cache_entry {
+    uint64_t hash;
+    uint16_t fp_len;               /* zero means 'empty' */
+    char fp[FP_CACHE_MAX_FP_LEN];
+};
+
+static thread_local struct fp_cache_entry fp_cache[FP_CACHE_NUM_ENTRIES];
+
+static uint64_t fnv1a_64(uint64_t h, const uint8_t *data, ssize_t len) {
+    for (ssize_t i = 0; i < len; i++) {
+        h ^= data[i];
+        h *= 0x00000100000001b3;   /* FNV prime */
+    }
+    return h;
+}
+
+static uint64_t client_hello_fp_hash(const struct tls_client_hello &hello) {
+    uint64_t h = 0xcbf29ce484222325;   /* FNV offset basis */
+
+    h = fnv1a_64(h, hello.protocol_version.data, hello.protocol_version.length());
+    h = fnv1a_64(h, hello.ciphersuite_vector.data, hello.ciphersuite_vector.length());
+
+    struct datum ext_parser{hello.extensions.data, hello.extensions.data_end};
+    while (parser_get_data_length(&ext_parser) > 0) {
+        const uint8_t *start_of_extension = ext_parser.data;
+        tls_extension x{ext_parser};
+        if (x.value.data == NULL) {
+            break;
+        }
+        if (uint16_match(x.type, static_extension_types, num_static_extension_types) == true) {
+            h = fnv1a_64(h, start_of_extension, ext_parser.data - start_of_extension);
+        } else {
+            h = fnv1a_64(h, start_of_extension, L_ExtensionType);
+        }
+    }
+    return h;
+}
+
 void tls_client_hello::write_fingerprint(struct buffer_stream &buf) const {
     /*
      * copy clientHello.ProtocolVersion
@@ -411,7 +521,23 @@ void tls_client_hello::write_fingerprint(struct buffer_stream &buf) const {
 
 void tls_client_hello::operator()(struct buffer_stream &buf) const {
     buf.write_char('\"');
+
+    uint64_t h = client_hello_fp_hash(*this);
+    struct fp_cache_entry *e = &fp_cache[h & (FP_CACHE_NUM_ENTRIES - 1)];
+    if (e->fp_len != 0 && e->hash == h) {
+        buf.memcpy(e->fp, e->fp_len);     /* cache hit; skip normalization */
+        buf.write_char('\"');
+        return;
+    }
+
+    size_t start = buf.length();
     write_fingerprint(buf);
+    size_t fp_len = buf.length() - start;
+    if (buf.trunc == 0 && fp_len <= FP_CACHE_MAX_FP_LEN) {
+        e->hash = h;
+        e->fp_len = fp_len;
+        memcpy(e->fp, buf.dstr + start, fp_len);
+    }
     buf.write_char('\"');
 }
 
@@ -493,6 +619,134 @@ void tls_server_hello::write_json(struct json_object &o) const {
     o.print_key_value("fingerprint", *this); 
 }
 
+/*
+ * struct cert_output_cache maps a hash of the raw certificate bytes
+ * to the certificate's serialized output: the "cert" JSON object in
+ * detailed mode, or the base64 member otherwise.  The same few
+ * thousand certificates appear in millions of handshakes, so each
+ * worker keeps one of these caches, and a repeated certificate costs
+ * one hash and one memcpy instead of being re-parsed and
+ * re-serialized.  The table is direct mapped; the raw bytes are kept
+ * and compared on each lookup, so a hash collision can never emit
+ * the wrong certificate, it just displaces the previous occupant.
+ *
+ * Note that the cached fragment includes the violations array, whose
+ * "invalid" entry depends on the current time; a certificate that
+ * expires while cached keeps its verdict until it is displaced.
+ */
+struct cert_output_cache {
+    static const size_t table_length = 1024;    /* must be a power of two */
+    static const size_t max_fragment_len = 8192*8;
+    struct entry {
+        uint64_t hash;
+        std::string raw;        /* DER certificate bytes; empty in an unused slot */
+        std::string fragment;   /* serialized output for this certificate        */
+    };
+    struct entry table[table_length];
+
+    static uint64_t hash(const uint8_t *data, size_t length) {
+        uint64_t h = 0xcbf29ce484222325;         /* FNV-1a */
+        for (size_t i = 0; i < length; i++) {
+            h ^= data[i];
+            h *= 0x00000100000001b3;
+        }
+        return h;
+    }
+
+    const std::string *get(uint64_t h, const uint8_t *data, size_t length) {
+        struct entry *e = &table[h & (table_length - 1)];
+        if (e->hash == h && e->raw.length() == length && memcmp(e->raw.data(), data, length) == 0) {
+            return &e->fragment;
+        }
+        return NULL;
+    }
+
+    void put(uint64_t h, const uint8_t *data, size_t length, const char *fragment, size_t fragment_length) {
+        struct entry *e = &table[h & (table_length - 1)];
+        e->hash = h;
+        e->raw.assign((const char *)data, length);
+        e->fragment.assign(fragment, fragment_length);
+    }
+};
+
+/* one certificate output cache per worker thread */
+thread_local struct cert_output_cache cert_cache;
+
+/*
+ * struct resumption_cache maps (client address, server name) -- or
+ * (client address, session id), when the hello carries no server
+ * name -- to the fingerprint of the last full handshake this worker
+ * saw for that pair.  A resumed session's hello has a degenerate
+ * fingerprint and its handshake carries no certificate, so on its
+ * own the record says little about the client; the annotation
+ * written by tls_resumption_note() attributes it to the full
+ * handshake it resumes, replacing the join that downstream jobs
+ * would otherwise run against the original record.  The table is
+ * direct mapped, like the other per-worker caches here: a colliding
+ * pair displaces the previous occupant, so an attribution can be
+ * missing, never stale for the wrong client (the 64-bit pair hash is
+ * compared on lookup).
+ */
+struct resumption_cache {
+    static const size_t table_length = 4096;    /* must be a power of two */
+    struct entry {
+        uint64_t hash;          /* of (client address, server name or session id); zero means empty */
+        std::string fp;         /* the pair's last full-handshake fingerprint */
+    };
+    struct entry table[table_length];
+
+    static uint64_t hash(const struct tls_client_hello &hello, const struct key &k) {
+        uint64_t h = 0xcbf29ce484222325;
+        if (k.ip_vers == 6) {
+            h = fnv1a_64(h, (const uint8_t *)&k.addr.ipv6.src, sizeof(k.addr.ipv6.src));
+        } else {
+            h = fnv1a_64(h, (const uint8_t *)&k.addr.ipv4.src, sizeof(k.addr.ipv4.src));
+        }
+        struct datum server_name{NULL, NULL};
+        hello.extensions.set_server_name(server_name);
+        if (server_name.is_not_empty()) {
+            h = fnv1a_64(h, server_name.data, server_name.length());
+        } else {
+            h = fnv1a_64(h, hello.session_id.data, hello.session_id.length());
+        }
+        if (h == 0) {
+            h = 1;     /* 0 marks an empty slot */
+        }
+        return h;
+    }
+};
+
+/* one resumption attribution cache per worker thread */
+thread_local struct resumption_cache resumption;
+
+void tls_resumption_note(const struct tls_client_hello &hello,
+                         const struct key &k,
+                         struct json_object &record) {
+
+    uint64_t h = resumption_cache::hash(hello, k);
+    struct resumption_cache::entry *e = &resumption.table[h & (resumption_cache::table_length - 1)];
+
+    if (hello.extensions.includes_resumption_state()) {
+        /* a resumption offer; annotate, and leave the cached full
+         * fingerprint in place for later resumptions of the pair */
+        if (e->hash == h && !e->fp.empty()) {
+            struct json_object resumed{record, "resumption"};
+            resumed.print_key_string("origin", e->fp.c_str());
+            resumed.close();
+        }
+        return;
+    }
+
+    /* a full handshake; remember its fingerprint for the pair */
+    char fp_str[FP_CACHE_MAX_FP_LEN];
+    struct buffer_stream fp_buf{fp_str, sizeof(fp_str)};
+    hello.write_fingerprint(fp_buf);
+    if (fp_buf.trunc == 0) {
+        e->hash = h;
+        e->fp.assign(fp_str, fp_buf.length());
+    }
+}
+
 void tls_server_certificate::write_json(struct json_array &a, bool json_output) const {
 
     struct datum tmp_cert_list = certificate_list;
@@ -500,7 +754,7 @@ void tls_server_certificate::write_json(struct json_array &a, bool json_output)
 
         /* get certificate length */
         size_t tmp_len;
-        if (tmp_cert_list.read_uint(&tmp_len, L_CertificateLength) == false) {
+        if (tmp_cert_list.read_uint<L_CertificateLength>(&tmp_len) == false) {
             return;
         }
 
@@ -513,15 +767,37 @@ void tls_server_certificate::write_json(struct json_array &a, bool json_output)
         }
 
         struct json_object o{a};
-        if (json_output) {
-            struct json_object_asn1 cert{o, "cert"};
-            struct x509_cert c;
-            c.parse(tmp_cert_list.data, tmp_len);
-            c.print_as_json(cert, {}, NULL);
-            cert.close();
+        uint64_t h = cert_output_cache::hash(tmp_cert_list.data, tmp_len);
+        const std::string *cached = cert_cache.get(h, tmp_cert_list.data, tmp_len);
+        if (cached != NULL) {
+            o.print_raw_members(cached->data(), cached->length());
+
         } else {
-            struct datum cert_parser{tmp_cert_list.data, tmp_cert_list.data + tmp_len};
-            o.print_key_base64("base64", cert_parser);
+            /* serialize into a side buffer, so the result can be
+             * cached as well as written into this record */
+            char fragment[cert_output_cache::max_fragment_len];
+            struct buffer_stream frag_buf(fragment, sizeof(fragment));
+            if (json_output) {
+                struct json_object_asn1 cert{&frag_buf, "cert"};
+                struct x509_cert c;
+                c.parse(tmp_cert_list.data, tmp_len, true);  // lazy; fields are decoded as they are written
+                c.print_as_json(cert, {}, NULL);
+                cert.close();
+            } else {
+#ifndef USE_CBOR_OBJECT
+                frag_buf.puts("\"base64\":");
+                frag_buf.raw_as_base64(tmp_cert_list.data, tmp_len);
+#else
+                /* as in print_key_base64(): CBOR carries the raw
+                 * certificate as a byte string, with no expansion */
+                cbor_write_key(&frag_buf, "base64");
+                cbor_write_bytes(&frag_buf, tmp_cert_list.data, tmp_len);
+#endif
+            }
+            o.print_raw_members(fragment, frag_buf.length());
+            if (frag_buf.trunc == 0) {
+                cert_cache.put(h, tmp_cert_list.data, tmp_len, fragment, frag_buf.length());
+            }
         }
         o.close();
 
@@ -117,12 +117,12 @@ struct tls_record {
     tls_record() : content_type{0}, protocol_version{0}, length{0}, fragment{NULL, NULL} {}
 
     void parse(struct datum &d) {
-        if (d.length() < (int)(sizeof(content_type) + sizeof(protocol_version) + sizeof(length))) {
+        content_type = d.gather_uint8();
+        protocol_version = d.gather_uint16();
+        length = d.gather_uint16();
+        if (d.gather_ok() == false) {
             return;
         }
-        d.read_uint8(&content_type);
-        d.read_uint16(&protocol_version);
-        d.read_uint16(&length);
         fragment.init_from_outer_parser(&d, length);
     }
 
@@ -156,13 +156,11 @@ struct tls_handshake {
     }
 
     void parse(struct datum &d) {
-        if (d.length() < (int)(4)) {
+        msg_type = (handshake_type)d.gather_uint8();
+        length = d.gather_uint(L_HandshakeLength);
+        if (d.gather_ok() == false) {
             return;
         }
-        d.read_uint8((uint8_t *)&msg_type);
-        size_t tmp;
-        d.read_uint(&tmp, L_HandshakeLength);
-        length = tmp;
         body.init_from_outer_parser(&d, length);
     }
 };
@@ -186,7 +184,7 @@ struct tls_server_certificate {
 
     void parse(struct datum &d) {
         size_t tmp = 0;
-        if (d.read_uint(&tmp, L_CertificateListLength) == false) {
+        if (d.read_uint<L_CertificateListLength>(&tmp) == false) {
             return;
         }
         length = tmp;
@@ -225,6 +223,8 @@ struct tls_extensions : public datum {
 
     void print_session_ticket(struct json_object &o, const char *key) const;
 
+    bool includes_resumption_state() const;
+
     void fingerprint(struct buffer_stream &b) const;
 };
 
@@ -253,6 +253,8 @@ struct tls_client_hello {
 
     void write_json(struct json_object &record, bool output_metadata) const;
 
+    void write_json_members(struct json_object &tls_client, bool output_metadata) const;
+
     struct tls_security_assessment security_assesment();
 };
 
@@ -297,7 +299,7 @@ struct dtls_record {
         d.read_uint8(&content_type);
         d.read_uint16(&protocol_version);
         d.read_uint16(&epoch);
-        d.read_uint(&sequence_number, 6);   // 6 bytes == 48 bits
+        d.read_uint<6>(&sequence_number);   // 6 bytes == 48 bits
         d.read_uint16(&length);
         fragment.init_from_outer_parser(&d, length);
     }
@@ -323,17 +325,30 @@ struct dtls_handshake {
         }
         d.read_uint8((uint8_t *)&msg_type);
         size_t tmp;
-        d.read_uint(&tmp, L_HandshakeLength);
+        d.read_uint<L_HandshakeLength>(&tmp);
         length = tmp;
         d.read_uint16(&message_seq);
-        d.read_uint(&tmp, 3);  // 24 bits on wire
+        d.read_uint<3>(&tmp);  // 24 bits on wire
         fragment_offset = tmp;
-        d.read_uint(&tmp, 3);  // 24 bits on wire
+        d.read_uint<3>(&tmp);  // 24 bits on wire
         fragment_length = tmp;
         body.init_from_outer_parser(&d, length);
     }
 
 };
 
+/*
+ * tls_resumption_note(hello, k, record) maintains this thread's
+ * resumption attribution cache (see tls.cc): a full handshake's
+ * fingerprint is remembered under (client address, server name), and
+ * a hello that offers to resume an earlier session gets a
+ * "resumption" object written into record holding the fingerprint of
+ * the attributed full handshake
+ */
+struct key;
+
+void tls_resumption_note(const struct tls_client_hello &hello,
+                         const struct key &k,
+                         struct json_object &record);
 
 #endif /* TLS_H */
@@ -0,0 +1,496 @@
+/*
+ * traffic_gen.c
+ *
+ * synthetic handshake traffic generator: builds parameterized mixes
+ * of TLS, HTTP, DNS, and SSH handshake packets and drives them
+ * through the pkt_proc pipeline in-process, so that a performance
+ * problem can be reproduced from a small config file instead of a
+ * capture file that cannot be shared.  The generator is deterministic
+ * for a given config: the same seed produces the same packet
+ * sequence, byte for byte.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "traffic_gen.h"
+#include "output.h"
+#include "pkt_proc.h"
+#include "utils.h"
+
+#define BILLION 1000000000L
+
+/*
+ * deterministic generator state (xorshift64*); rand() is not used, so
+ * that a run is reproducible from its config file alone
+ */
+struct tg_prng {
+    uint64_t state;
+};
+
+static uint64_t tg_random(struct tg_prng *g) {
+    uint64_t x = g->state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    g->state = x;
+    return x * 0x2545f4914f6cdd1dULL;
+}
+
+/*
+ * config file reading; one key=value per line, '#' for comments (see
+ * traffic_gen.h for the key list)
+ */
+
+static enum status tg_parse_uint64(const char *arg, uint64_t *value) {
+    char *endptr = NULL;
+    uint64_t tmp = strtoul(arg, &endptr, 10);
+    if (*endptr != '\0' && *endptr != '\n') {
+        return status_err;
+    }
+    *value = tmp;
+    return status_ok;
+}
+
+static enum status tg_parse_uint(const char *arg, unsigned int *value) {
+    uint64_t tmp;
+    if (tg_parse_uint64(arg, &tmp) != status_ok) {
+        return status_err;
+    }
+    *value = tmp;
+    return status_ok;
+}
+
+static enum status traffic_gen_parse_line(struct traffic_gen_config *gc, char *line) {
+
+    struct { const char *key; unsigned int *uint_value; uint64_t *uint64_value; } keys[] = {
+        { "packets=",      NULL,              &gc->packets },
+        { "seed=",         NULL,              &gc->seed },
+        { "tls=",          &gc->tls_weight,   NULL },
+        { "http=",         &gc->http_weight,  NULL },
+        { "dns=",          &gc->dns_weight,   NULL },
+        { "ssh=",          &gc->ssh_weight,   NULL },
+        { "fingerprints=", &gc->fingerprints, NULL },
+        { "snis=",         &gc->snis,         NULL },
+        { "padding=",      &gc->padding,      NULL },
+    };
+
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        size_t key_len = strlen(keys[i].key);
+        if (strncmp(keys[i].key, line, key_len) == 0) {
+            if (keys[i].uint64_value != NULL) {
+                return tg_parse_uint64(line + key_len, keys[i].uint64_value);
+            }
+            return tg_parse_uint(line + key_len, keys[i].uint_value);
+        }
+    }
+    return status_err;
+}
+
+enum status traffic_gen_config_read(struct traffic_gen_config *gc, const char *filename) {
+
+    FILE *config_file = fopen(filename, "r");
+    if (config_file == NULL) {
+        fprintf(stderr, "error: could not open synthesis config file %s (%s)\n",
+                filename, strerror(errno));
+        return status_err;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), config_file) != NULL) {
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\0') {
+            continue;
+        }
+        if (traffic_gen_parse_line(gc, line) != status_ok) {
+            fprintf(stderr, "error: could not parse synthesis config line \"%s\"\n", line);
+            fclose(config_file);
+            return status_err;
+        }
+    }
+    fclose(config_file);
+
+    if (gc->tls_weight + gc->http_weight + gc->dns_weight + gc->ssh_weight == 0) {
+        fprintf(stderr, "error: synthesis config selects no protocols\n");
+        return status_err;
+    }
+    if (gc->fingerprints == 0 || gc->snis == 0) {
+        fprintf(stderr, "error: fingerprints and snis must be nonzero\n");
+        return status_err;
+    }
+    if (gc->seed == 0) {
+        gc->seed = 1;   /* an all-zero xorshift state never leaves zero */
+    }
+    return status_ok;
+}
+
+/*
+ * server names; the index is drawn as the minimum of two uniform
+ * draws, a cheap skew that makes low-numbered names common and
+ * high-numbered names rare, like production SNI traffic
+ */
+static unsigned int tg_sni_index(struct tg_prng *g, unsigned int snis) {
+    uint64_t r = tg_random(g);
+    unsigned int a = (uint32_t)r % snis;
+    unsigned int b = (uint32_t)(r >> 32) % snis;
+    return a < b ? a : b;
+}
+
+static size_t tg_sni_name(char *name, size_t capacity, unsigned int index) {
+    return snprintf(name, capacity, "svc%u.synthetic.example", index);
+}
+
+/*
+ * frame headers; the addresses and ports are drawn from the
+ * generator, and the IPv4 header checksum is computed so the packets
+ * are valid if written out with -w
+ */
+
+#define TG_ETH_LEN 14
+#define TG_IP_LEN  20
+#define TG_TCP_LEN 20
+#define TG_UDP_LEN 8
+#define TG_TCP_PAYLOAD (TG_ETH_LEN + TG_IP_LEN + TG_TCP_LEN)
+#define TG_UDP_PAYLOAD (TG_ETH_LEN + TG_IP_LEN + TG_UDP_LEN)
+
+static void tg_put16(uint8_t *data, uint16_t value) {
+    data[0] = value >> 8;
+    data[1] = value & 0xff;
+}
+
+static void tg_put32(uint8_t *data, uint32_t value) {
+    data[0] = value >> 24;
+    data[1] = (value >> 16) & 0xff;
+    data[2] = (value >> 8) & 0xff;
+    data[3] = value & 0xff;
+}
+
+static uint16_t tg_ip_checksum(const uint8_t *header, size_t length) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i + 1 < length; i += 2) {
+        sum += ((uint16_t)header[i] << 8) | header[i + 1];
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return ~sum;
+}
+
+static void tg_build_ip_frame(uint8_t *pkt, struct tg_prng *g, uint8_t protocol, size_t ip_payload_len) {
+
+    /* ethernet */
+    static const uint8_t eth_header[TG_ETH_LEN] = {
+        0x02, 0x00, 0x00, 0x00, 0x00, 0x02,   /* destination (locally administered) */
+        0x02, 0x00, 0x00, 0x00, 0x00, 0x01,   /* source */
+        0x08, 0x00                            /* ethertype IPv4 */
+    };
+    memcpy(pkt, eth_header, TG_ETH_LEN);
+
+    /* IPv4 */
+    uint8_t *ip = pkt + TG_ETH_LEN;
+    uint64_t r = tg_random(g);
+    ip[0] = 0x45;                             /* version 4, header length 20 */
+    ip[1] = 0x00;
+    tg_put16(ip + 2, TG_IP_LEN + ip_payload_len);
+    tg_put16(ip + 4, (uint16_t)r);            /* identification */
+    tg_put16(ip + 6, 0x4000);                 /* don't fragment */
+    ip[8] = 64;                               /* ttl */
+    ip[9] = protocol;
+    tg_put16(ip + 10, 0);                     /* checksum; filled in below */
+    tg_put32(ip + 12, 0x0a000000 | ((r >> 16) & 0xffff));   /* source, in 10/8 */
+    tg_put32(ip + 16, 0xc0a80000 | ((r >> 32) & 0xffff));   /* destination, in 192.168/16 */
+    tg_put16(ip + 10, tg_ip_checksum(ip, TG_IP_LEN));
+}
+
+static void tg_build_tcp_frame(uint8_t *pkt, struct tg_prng *g, uint16_t dst_port, size_t payload_len) {
+    tg_build_ip_frame(pkt, g, 6, TG_TCP_LEN + payload_len);
+
+    uint8_t *tcp = pkt + TG_ETH_LEN + TG_IP_LEN;
+    uint64_t r = tg_random(g);
+    tg_put16(tcp, 0xc000 | (r & 0x3fff));     /* ephemeral source port */
+    tg_put16(tcp + 2, dst_port);
+    tg_put32(tcp + 4, r >> 16);               /* sequence number */
+    tg_put32(tcp + 8, r >> 32);               /* acknowledgment number */
+    tcp[12] = (TG_TCP_LEN / 4) << 4;          /* data offset */
+    tcp[13] = 0x18;                           /* PSH, ACK */
+    tg_put16(tcp + 14, 0xffff);               /* window */
+    tg_put16(tcp + 16, 0);                    /* checksum (not computed) */
+    tg_put16(tcp + 18, 0);                    /* urgent pointer */
+}
+
+static void tg_build_udp_frame(uint8_t *pkt, struct tg_prng *g, uint16_t src_port, uint16_t dst_port, size_t payload_len) {
+    tg_build_ip_frame(pkt, g, 17, TG_UDP_LEN + payload_len);
+
+    uint8_t *udp = pkt + TG_ETH_LEN + TG_IP_LEN;
+    uint64_t r = tg_random(g);
+    tg_put16(udp, src_port ? src_port : (0xc000 | (r & 0x3fff)));
+    tg_put16(udp + 2, dst_port ? dst_port : (0xc000 | ((r >> 16) & 0x3fff)));
+    tg_put16(udp + 4, TG_UDP_LEN + payload_len);
+    tg_put16(udp + 6, 0);                     /* checksum (not computed) */
+}
+
+/*
+ * TLS ClientHello.  Each fingerprint variant selects its cipher suite
+ * list and optional extensions deterministically from the variant
+ * number, so a config asking for N fingerprints produces exactly N
+ * distinct TLS fingerprint strings; the SNI and the random field vary
+ * per packet within a variant, as they do in real traffic.
+ */
+
+static const uint16_t tg_suite_pool[] = {
+    0x1301, 0x1302, 0x1303, 0xc02b, 0xc02f, 0xc02c, 0xc030, 0xcca9,
+    0xcca8, 0xc013, 0xc014, 0x009c, 0x009d, 0x002f, 0x0035, 0x000a,
+    0xc009, 0xc00a, 0xc023, 0xc027, 0x003c, 0x009e, 0x009f, 0x0033
+};
+#define TG_SUITE_POOL_LEN (sizeof(tg_suite_pool) / sizeof(tg_suite_pool[0]))
+
+static size_t tg_build_tls(uint8_t *pkt, struct tg_prng *g, const struct traffic_gen_config *gc) {
+    uint8_t *hello = pkt + TG_TCP_PAYLOAD;
+    unsigned int variant = (uint32_t)tg_random(g) % gc->fingerprints;
+
+    /* the variant's own generator, so its suite list doesn't depend
+     * on where in the packet sequence it is drawn */
+    struct tg_prng vg = { gc->seed ^ ((uint64_t)(variant + 1) * 0x9e3779b97f4a7c15ULL) };
+    tg_random(&vg);
+
+    size_t off = 5;                     /* record header, patched below */
+    hello[off++] = 0x01;                /* handshake type: client_hello */
+    off += 3;                           /* handshake length, patched below */
+    tg_put16(hello + off, 0x0303);      /* client_version */
+    off += 2;
+    for (int i = 0; i < 32; i += 8) {   /* random */
+        uint64_t r = tg_random(g);
+        memcpy(hello + off + i, &r, 8);
+    }
+    off += 32;
+    hello[off++] = 0;                   /* session_id length */
+
+    unsigned int num_suites = 6 + ((uint32_t)tg_random(&vg) % 10);
+    tg_put16(hello + off, 2 * num_suites);
+    off += 2;
+    unsigned int stride = 1 + ((uint32_t)tg_random(&vg) % (TG_SUITE_POOL_LEN - 1));
+    unsigned int suite = (uint32_t)tg_random(&vg) % TG_SUITE_POOL_LEN;
+    for (unsigned int i = 0; i < num_suites; i++) {
+        tg_put16(hello + off, tg_suite_pool[suite]);
+        off += 2;
+        suite = (suite + stride) % TG_SUITE_POOL_LEN;
+    }
+    hello[off++] = 1;                   /* compression methods: null only */
+    hello[off++] = 0;
+
+    size_t ext_len_off = off;           /* extensions length, patched below */
+    off += 2;
+
+    /* server_name */
+    char name[64];
+    size_t name_len = tg_sni_name(name, sizeof(name), tg_sni_index(g, gc->snis));
+    tg_put16(hello + off, 0x0000);
+    tg_put16(hello + off + 2, name_len + 5);
+    tg_put16(hello + off + 4, name_len + 3);
+    hello[off + 6] = 0;                 /* name type: host_name */
+    tg_put16(hello + off + 7, name_len);
+    memcpy(hello + off + 9, name, name_len);
+    off += 9 + name_len;
+
+    if (variant & 1) {                  /* supported_groups */
+        static const uint8_t groups[] = { 0x00, 0x0a, 0x00, 0x06, 0x00, 0x04,
+                                          0x00, 0x1d, 0x00, 0x17 };
+        memcpy(hello + off, groups, sizeof(groups));
+        off += sizeof(groups);
+    }
+    if (variant & 2) {                  /* ec_point_formats */
+        static const uint8_t formats[] = { 0x00, 0x0b, 0x00, 0x02, 0x01, 0x00 };
+        memcpy(hello + off, formats, sizeof(formats));
+        off += sizeof(formats);
+    }
+    if (variant & 4) {                  /* signature_algorithms */
+        static const uint8_t sigalgs[] = { 0x00, 0x0d, 0x00, 0x06, 0x00, 0x04,
+                                           0x04, 0x03, 0x08, 0x04 };
+        memcpy(hello + off, sigalgs, sizeof(sigalgs));
+        off += sizeof(sigalgs);
+    }
+    if (gc->padding > 0) {              /* padding, for the size distribution */
+        size_t pad = (uint32_t)tg_random(g) % (gc->padding + 1);
+        tg_put16(hello + off, 0x0015);
+        tg_put16(hello + off + 2, pad);
+        memset(hello + off + 4, 0, pad);
+        off += 4 + pad;
+    }
+
+    tg_put16(hello + ext_len_off, off - ext_len_off - 2);
+
+    /* record and handshake headers */
+    hello[0] = 0x16;                    /* content type: handshake */
+    tg_put16(hello + 1, 0x0301);
+    tg_put16(hello + 3, off - 5);
+    hello[6] = 0;
+    tg_put16(hello + 7, off - 9);
+
+    tg_build_tcp_frame(pkt, g, 443, off);
+    return TG_TCP_PAYLOAD + off;
+}
+
+static size_t tg_build_http(uint8_t *pkt, struct tg_prng *g, const struct traffic_gen_config *gc) {
+    char *request = (char *)pkt + TG_TCP_PAYLOAD;
+    unsigned int variant = (uint32_t)tg_random(g) % gc->fingerprints;
+
+    char name[64];
+    tg_sni_name(name, sizeof(name), tg_sni_index(g, gc->snis));
+    size_t len = snprintf(request, 1024,
+                          "GET /object/%u HTTP/1.1\r\n"
+                          "Host: %s\r\n"
+                          "User-Agent: synthetic/1.%u\r\n"
+                          "Accept: */*\r\n",
+                          (uint32_t)tg_random(g) % 10000, name, variant);
+    if (gc->padding > 0) {
+        size_t pad = (uint32_t)tg_random(g) % (gc->padding + 1);
+        len += snprintf(request + len, 16, "X-Padding: ");
+        memset(request + len, 'a', pad);
+        len += pad;
+        len += snprintf(request + len, 3, "\r\n");
+    }
+    len += snprintf(request + len, 3, "\r\n");
+
+    tg_build_tcp_frame(pkt, g, 80, len);
+    return TG_TCP_PAYLOAD + len;
+}
+
+static size_t tg_build_dns(uint8_t *pkt, struct tg_prng *g, const struct traffic_gen_config *gc) {
+    uint8_t *dns = pkt + TG_UDP_PAYLOAD;
+
+    char name[64];
+    size_t name_len = tg_sni_name(name, sizeof(name), tg_sni_index(g, gc->snis));
+
+    size_t off = 0;
+    tg_put16(dns + off, (uint16_t)tg_random(g));   /* transaction id */
+    tg_put16(dns + off + 2, 0x8180);    /* response, recursion desired/available */
+    tg_put16(dns + off + 4, 1);         /* questions */
+    tg_put16(dns + off + 6, 1);         /* answers */
+    tg_put16(dns + off + 8, 0);         /* authority */
+    tg_put16(dns + off + 10, 0);        /* additional */
+    off += 12;
+
+    /* question name, as dot-separated labels */
+    size_t label_start = off++;
+    for (size_t i = 0; i < name_len; i++) {
+        if (name[i] == '.') {
+            dns[label_start] = off - label_start - 1;
+            label_start = off++;
+        } else {
+            dns[off++] = name[i];
+        }
+    }
+    dns[label_start] = off - label_start - 1;
+    dns[off++] = 0;                     /* root label */
+    tg_put16(dns + off, 1);             /* type A */
+    tg_put16(dns + off + 2, 1);         /* class IN */
+    off += 4;
+
+    /* answer: a compression pointer back to the question name */
+    tg_put16(dns + off, 0xc00c);
+    tg_put16(dns + off + 2, 1);         /* type A */
+    tg_put16(dns + off + 4, 1);         /* class IN */
+    tg_put32(dns + off + 6, 300);       /* ttl */
+    tg_put16(dns + off + 10, 4);        /* rdlength */
+    tg_put32(dns + off + 12, 0xc0000200 | ((uint32_t)tg_random(g) & 0xff));
+    off += 16;
+
+    tg_build_udp_frame(pkt, g, 53, 0, off);
+    return TG_UDP_PAYLOAD + off;
+}
+
+static size_t tg_build_ssh(uint8_t *pkt, struct tg_prng *g, const struct traffic_gen_config *gc) {
+    char *banner = (char *)pkt + TG_TCP_PAYLOAD;
+    unsigned int variant = (uint32_t)tg_random(g) % gc->fingerprints;
+
+    size_t len = snprintf(banner, 128, "SSH-2.0-synthetic_%u.%u\r\n",
+                          variant, (uint32_t)tg_random(g) % 10);
+
+    tg_build_tcp_frame(pkt, g, 22, len);
+    return TG_TCP_PAYLOAD + len;
+}
+
+enum status traffic_gen_generate(const struct traffic_gen_config *gc,
+                                 void (*handler)(void *userdata, uint8_t *pkt, size_t length),
+                                 void *userdata) {
+
+    unsigned int weight_sum = gc->tls_weight + gc->http_weight + gc->dns_weight + gc->ssh_weight;
+    if (weight_sum == 0) {
+        return status_err;
+    }
+    struct tg_prng g = { gc->seed };
+    uint8_t pkt[4096];
+    for (uint64_t i = 0; i < gc->packets; i++) {
+        unsigned int draw = (uint32_t)tg_random(&g) % weight_sum;
+        size_t length;
+        if (draw < gc->tls_weight) {
+            length = tg_build_tls(pkt, &g, gc);
+        } else if (draw < gc->tls_weight + gc->http_weight) {
+            length = tg_build_http(pkt, &g, gc);
+        } else if (draw < gc->tls_weight + gc->http_weight + gc->dns_weight) {
+            length = tg_build_dns(pkt, &g, gc);
+        } else {
+            length = tg_build_ssh(pkt, &g, gc);
+        }
+        handler(userdata, pkt, length);
+    }
+    return status_ok;
+}
+
+/* the per-packet state of a synthesize_and_dispatch() run */
+struct synth_dispatch_context {
+    struct pkt_proc *pkt_processor;
+    uint64_t bytes_generated;
+};
+
+static void synth_dispatch_packet(void *userdata, uint8_t *pkt, size_t length) {
+    struct synth_dispatch_context *sc = (struct synth_dispatch_context *)userdata;
+    struct packet_info pi;
+    clock_gettime(CLOCK_REALTIME, &pi.ts);
+    pi.caplen = length;
+    pi.len = length;
+    sc->bytes_generated += length;
+    sc->pkt_processor->apply(&pi, pkt);
+}
+
+enum status synthesize_and_dispatch(struct mercury_config *cfg, struct output_file *of) {
+
+    struct traffic_gen_config gc = traffic_gen_config_init();
+    if (traffic_gen_config_read(&gc, cfg->synth_config) != status_ok) {
+        return status_err;
+    }
+
+    struct pkt_proc *pkt_processor = pkt_proc_new_from_config(cfg, 0,
+                                                              cfg->separate_files ? NULL : &of->qs.queue[0]);
+    if (pkt_processor == NULL) {
+        printf("error: could not initialize frame handler\n");
+        return status_err;
+    }
+
+    /* Wake up output thread so it's polling the queues waiting for data */
+    of->t_output_p = 1;
+    int err = pthread_cond_broadcast(&(of->t_output_c));
+    if (err != 0) {
+        printf("%s: error broadcasting all clear on output start condition\n", strerror(err));
+        exit(255);
+    }
+
+    struct timer t;
+    timer_start(&t);
+
+    struct synth_dispatch_context sc = { pkt_processor, 0 };
+    if (traffic_gen_generate(&gc, synth_dispatch_packet, &sc) != status_ok) {
+        delete pkt_processor;
+        return status_err;
+    }
+    pkt_processor->flush();
+
+    uint64_t nano_seconds = timer_stop(&t);
+    double packet_rate = ((double)gc.packets * BILLION) / (double)nano_seconds;
+    double byte_rate = ((double)sc.bytes_generated * BILLION) / (double)nano_seconds;
+    fprintf(stderr, "synthesized %" PRIu64 " packets (%" PRIu64 " bytes) in %.3f seconds: %.0f packets/sec, %.4e bytes/sec\n",
+            gc.packets, sc.bytes_generated, (double)nano_seconds / BILLION, packet_rate, byte_rate);
+
+    delete pkt_processor;
+    return status_ok;
+}
@@ -0,0 +1,69 @@
+/*
+ * traffic_gen.h
+ *
+ * synthetic handshake traffic generator (--synthesize)
+ */
+
+#ifndef TRAFFIC_GEN_H
+#define TRAFFIC_GEN_H
+
+#include <stdint.h>
+#include "mercury.h"
+#include "output.h"
+
+/*
+ * struct traffic_gen_config holds the parameters of a synthetic
+ * traffic run, read from a key=value config file with
+ * traffic_gen_config_read().  The keys (all optional) are:
+ *
+ *    packets=N        packets to generate (default 1000000)
+ *    seed=N           generator seed; same seed, same packets (default 1)
+ *    tls=W            weight of TLS ClientHello packets  (default 60)
+ *    http=W           weight of HTTP GET request packets (default 20)
+ *    dns=W            weight of DNS response packets     (default 15)
+ *    ssh=W            weight of SSH banner packets       (default 5)
+ *    fingerprints=N   distinct TLS fingerprint variants  (default 16)
+ *    snis=N           distinct server names              (default 64)
+ *    padding=N        maximum random padding bytes per packet (default 0)
+ *
+ * and '#' starts a comment line
+ */
+struct traffic_gen_config {
+    uint64_t packets;
+    uint64_t seed;
+    unsigned int tls_weight;
+    unsigned int http_weight;
+    unsigned int dns_weight;
+    unsigned int ssh_weight;
+    unsigned int fingerprints;
+    unsigned int snis;
+    unsigned int padding;
+};
+
+#define traffic_gen_config_init() { 1000000, 1, 60, 20, 15, 5, 16, 64, 0 }
+
+enum status traffic_gen_config_read(struct traffic_gen_config *gc,
+                                    const char *filename);
+
+/*
+ * traffic_gen_generate(gc, handler, userdata) generates the traffic
+ * mix described by gc and hands each packet, in a scratch buffer that
+ * the next packet reuses, to handler.  It is the generator behind
+ * synthesize_and_dispatch(), exposed so that the pipeline benchmark
+ * (pipeline_bench.cc) can build an in-memory corpus from a mix.
+ * Returns status_err when every weight in gc is zero.
+ */
+enum status traffic_gen_generate(const struct traffic_gen_config *gc,
+                                 void (*handler)(void *userdata, uint8_t *pkt, size_t length),
+                                 void *userdata);
+
+/*
+ * synthesize_and_dispatch(cfg, of) generates the traffic mix
+ * described by the config file named in cfg->synth_config, and drives
+ * each packet through the same packet processor that file reads use;
+ * it is a sister to open_and_dispatch() in pcap_reader.c
+ */
+enum status synthesize_and_dispatch(struct mercury_config *cfg,
+                                    struct output_file *of);
+
+#endif /* TRAFFIC_GEN_H */
@@ -5,7 +5,10 @@
  */
 
 
+#include <string.h>   /* for memset() */
+#include <atomic>     /* for the live matcher pointer below */
 #include "extractor.h"
+#include "udp.h"
 #include "proto_identify.h"
 #include "match.h"
 #include "utils.h"
@@ -34,6 +37,80 @@ unsigned int packet_filter_process_vxlan(struct packet_filter *pf, struct key *k
     return packet_filter_process_packet(pf, k);
 }
 
+/*
+ *  GTPv1-U Header (3GPP TS 29.281):
+ *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *  | Ver |P|R|E|S|N| Message Type  |            Length             |
+ *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *  |                  Tunnel Endpoint Identifier                   |
+ *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *  | Sequence Number (opt.)        | N-PDU (opt.)  | Next Ext (opt)|
+ *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *
+ *  the optional fields are present if any of the E, S, or N flags are
+ *  set; extension headers follow if the E flag is set
+ */
+
+#define GTP_HDR_LEN       8
+#define GTP_VERSION_MASK  0xe0
+#define GTP_VERSION_ONE   0x20
+#define GTP_FLAG_EXT_HDR  0x04
+#define GTP_FLAG_OPT      0x07
+#define GTP_MSG_G_PDU     0xff
+
+enum status parser_skip_gtp_header(struct datum *p) {
+    size_t flags = 0;
+    size_t message_type = 0;
+
+    if (parser_read_and_skip_uint(p, sizeof(uint8_t), &flags) == status_err) {
+        return status_err;
+    }
+    if ((flags & GTP_VERSION_MASK) != GTP_VERSION_ONE) {
+        return status_err;   /* only GTPv1 carries user plane traffic */
+    }
+    if (parser_read_and_skip_uint(p, sizeof(uint8_t), &message_type) == status_err) {
+        return status_err;
+    }
+    if (message_type != GTP_MSG_G_PDU) {
+        return status_err;   /* signaling message; no encapsulated packet */
+    }
+    if (parser_skip(p, sizeof(uint16_t) + sizeof(uint32_t)) == status_err) { // length, TEID
+        return status_err;
+    }
+    if (flags & GTP_FLAG_OPT) {
+        size_t next_ext = 0;
+        if (parser_skip(p, 3) == status_err) {  // sequence number, N-PDU number
+            return status_err;
+        }
+        if (parser_read_and_skip_uint(p, sizeof(uint8_t), &next_ext) == status_err) {
+            return status_err;
+        }
+        while (next_ext != 0) {
+            size_t ext_len = 0;
+            if (parser_read_and_skip_uint(p, sizeof(uint8_t), &ext_len) == status_err) {
+                return status_err;
+            }
+            if (ext_len == 0) {
+                return status_err;   /* malformed extension header */
+            }
+            if (parser_skip(p, ext_len * 4 - 2) == status_err) { // contents
+                return status_err;
+            }
+            if (parser_read_and_skip_uint(p, sizeof(uint8_t), &next_ext) == status_err) {
+                return status_err;
+            }
+        }
+    }
+    return status_ok;
+}
+
+unsigned int packet_filter_process_gtp(struct packet_filter *pf, struct key *k) {
+    if (parser_skip_gtp_header(&pf->p) != status_ok) {
+        return 0;
+    }
+    return packet_filter_process_ip(pf, k);
+}
+
 
 /* DTLS Client */
 unsigned char dtls_client_hello_mask[] = {
@@ -58,7 +135,7 @@ struct pi_container dtls_client = {
 /* DTLS Server */
 unsigned char dtls_server_hello_mask[] = {
     0xff, 0xff, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+    0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00
 };
 
 unsigned char dtls_server_hello_value[] = {
@@ -114,6 +191,120 @@ struct pi_container wireguard = {
     WIREGUARD_PORT
 };
 
+/*
+ * quic initial packet (long header, fixed bit, type initial, version 1)
+ */
+unsigned char quic_initial_mask[] = {
+    0xf0, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00
+};
+unsigned char quic_initial_value[] = {
+    0xc0, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00
+};
+struct pi_container quic_initial = {
+    DIR_CLIENT,
+    QUIC_PORT
+};
+
+/*
+ * udp_matchers packs the mask/value pairs above into a single
+ * masked_matcher, so that the first sixteen bytes of UDP data are
+ * loaded once and compared against every pattern in one pass; the pi,
+ * msg and parser arrays map the index of the matching pattern back to
+ * the per-pattern results, so that one table probe yields the port
+ * hint, the message type, and the parser to dispatch to, with no
+ * per-protocol trial chain and no second switch on the identified
+ * protocol.  Each pattern is registered with the eight bytes that the
+ * corresponding u32/u64 comparison actually examines, so the two
+ * paths accept exactly the same packets.  The matcher is built on
+ * first use, which is after proto_ident_config() has had a chance to
+ * zero out the masks of deselected protocols; such dead patterns are
+ * omitted from the matcher outright, so a sensor that selects only
+ * one protocol spends no per-packet work on the others.  The scalar
+ * chains are retained for payloads shorter than sixteen bytes.
+ */
+
+unsigned int parser_extractor_process_dtls(struct datum *p, struct extractor *x);
+unsigned int parser_extractor_process_dtls_server(struct datum *p, struct extractor *x);
+unsigned int parser_extractor_process_dhcp(struct datum *p, struct extractor *x);
+unsigned int parser_extractor_process_dns(struct datum *p, struct extractor *x);
+unsigned int parser_extractor_process_wireguard(struct datum *p, struct extractor *x);
+
+typedef unsigned int (*udp_parser_func)(struct datum *p, struct extractor *x);
+
+struct udp_matchers {
+    struct masked_matcher m;
+    const struct pi_container *pi[MASKED_MATCHER_MAX_PATTERNS];
+    enum msg_type msg[MASKED_MATCHER_MAX_PATTERNS];
+    udp_parser_func parser[MASKED_MATCHER_MAX_PATTERNS];
+};
+
+static void udp_matchers_add(struct udp_matchers *u,
+                             const unsigned char *mask,
+                             const unsigned char *value,
+                             size_t len,
+                             const struct pi_container *pi,
+                             enum msg_type msg,
+                             udp_parser_func parser) {
+    if (mask_is_zero(mask, len)) {
+        return;  /* protocol deselected; pattern can never match */
+    }
+    u->pi[u->m.count] = pi;
+    u->msg[u->m.count] = msg;
+    u->parser[u->m.count] = parser;
+    masked_matcher_add(&u->m, mask, value, len);
+}
+
+static struct udp_matchers build_udp_matchers() {
+    struct udp_matchers u;
+    memset(&u, 0, sizeof(u));
+    udp_matchers_add(&u, dhcp_client_mask, dhcp_client_value, 8,
+                     &dhcp_client, msg_type_dhcp, parser_extractor_process_dhcp);
+    /* the DTLS client and server patterns agree on their first eight
+     * bytes (record type and version); the handshake type byte that
+     * tells them apart sits at offset 13, so these two matchers need
+     * their full sixteen-byte patterns */
+    udp_matchers_add(&u, dtls_client_hello_mask, dtls_client_hello_value, 16,
+                     &dtls_client, msg_type_dtls_client_hello, parser_extractor_process_dtls);
+    udp_matchers_add(&u, dtls_server_hello_mask, dtls_server_hello_value, 16,
+                     &dtls_server, msg_type_dtls_server_hello, parser_extractor_process_dtls_server);
+    udp_matchers_add(&u, dns_server_mask, dns_server_value, 8,
+                     &dns_server, msg_type_dns, parser_extractor_process_dns);
+    udp_matchers_add(&u, wireguard_mask, wireguard_value, 8,
+                     &wireguard, msg_type_wireguard, parser_extractor_process_wireguard);
+    udp_matchers_add(&u, quic_initial_mask, quic_initial_value, 8,
+                     &quic_initial, msg_type_quic_init, NULL);   /* identified and typed, but not parsed */
+    return u;
+}
+
+static std::atomic<const struct udp_matchers *> udp_matchers_live{NULL};
+static const struct udp_matchers *udp_matchers_retired = NULL;
+
+/*
+ * udp_matchers_rebuild() builds a replacement matcher from the
+ * current masks and publishes it with a single pointer swap, so that
+ * proto_ident_reconfig() (extractor.c) can change the selected
+ * protocols while packets are flowing.  As with database_reload()
+ * (analysis.cc), the generation displaced by the previous rebuild is
+ * freed one full rebuild later, by which time any reader that loaded
+ * its pointer has long since classified its packet.
+ */
+void udp_matchers_rebuild() {
+    const struct udp_matchers *fresh = new udp_matchers(build_udp_matchers());
+    const struct udp_matchers *old = udp_matchers_live.exchange(fresh, std::memory_order_acq_rel);
+    delete udp_matchers_retired;
+    udp_matchers_retired = old;
+}
+
+static const struct udp_matchers &get_udp_matchers() {
+    const struct udp_matchers *u = udp_matchers_live.load(std::memory_order_acquire);
+    if (u == NULL) {
+        static const bool built = (udp_matchers_rebuild(), true);  /* first use; initialization is thread-safe */
+        (void)built;
+        u = udp_matchers_live.load(std::memory_order_acquire);
+    }
+    return *u;
+}
+
 const struct pi_container *proto_identify_udp(const uint8_t *udp_data,
                                               unsigned int len) {
 
@@ -128,6 +319,15 @@ const struct pi_container *proto_identify_udp(const uint8_t *udp_data,
     extractor_debug("%s: udp data: %02x%02x%02x%02x%02x%02x%02x%02x\n", __func__,
                     udp_data[0], udp_data[1], udp_data[2], udp_data[3], udp_data[4], udp_data[5], udp_data[6], udp_data[7]);
 
+    if (len >= MASKED_PATTERN_LEN) {
+        const struct udp_matchers &u = get_udp_matchers();
+        int idx = masked_matcher_match(&u.m, udp_data);
+        if (idx < 0) {
+            return NULL;
+        }
+        return u.pi[idx];
+    }
+
     if (u32_compare_masked_data_to_value(udp_data,
                                          dhcp_client_mask,
                                          dhcp_client_value)) {
@@ -159,6 +359,11 @@ const struct pi_container *proto_identify_udp(const uint8_t *udp_data,
                                          wireguard_value)) {
         return &wireguard;
     }
+    if (u64_compare_masked_data_to_value(udp_data,
+                                         quic_initial_mask,
+                                         quic_initial_value)) {
+        return &quic_initial;
+    }
 
     return NULL;
 }
@@ -175,6 +380,15 @@ enum msg_type udp_get_message_type(const uint8_t *udp_data,
     extractor_debug("%s: udp data: %02x%02x%02x%02x%02x%02x%02x%02x\n", __func__,
                     udp_data[0], udp_data[1], udp_data[2], udp_data[3], udp_data[4], udp_data[5], udp_data[6], udp_data[7]);
 
+    if (len >= MASKED_PATTERN_LEN) {
+        const struct udp_matchers &u = get_udp_matchers();
+        int idx = masked_matcher_match(&u.m, udp_data);
+        if (idx < 0) {
+            return msg_type_unknown;
+        }
+        return u.msg[idx];
+    }
+
     if (u32_compare_masked_data_to_value(udp_data,
                                          dhcp_client_mask,
                                          dhcp_client_value)) {
@@ -201,6 +415,11 @@ enum msg_type udp_get_message_type(const uint8_t *udp_data,
                                          wireguard_value)) {
         return msg_type_wireguard;
     }
+    if (u64_compare_masked_data_to_value(udp_data,
+                                         quic_initial_mask,
+                                         quic_initial_value)) {
+        return msg_type_quic_init;
+    }
 
     return msg_type_unknown;
 }
@@ -287,6 +506,9 @@ unsigned int packet_filter_process_udp(struct packet_filter *pf, struct key *k)
     if (dst_port == VXLAN_PORT) {
         return packet_filter_process_vxlan(pf, k);
     }
+    if (dst_port == GTP_PORT) {
+        return packet_filter_process_gtp(pf, k);
+    }
     /*
      * process the UDP Data payload
      */
@@ -295,21 +517,32 @@ unsigned int packet_filter_process_udp(struct packet_filter *pf, struct key *k)
 }
 
 
-unsigned int parser_extractor_process_dtls(struct datum *p, struct extractor *x);
-unsigned int parser_extractor_process_dtls_server(struct datum *p, struct extractor *x);
-unsigned int parser_extractor_process_dhcp(struct datum *p, struct extractor *x);
-unsigned int parser_extractor_process_dns(struct datum *p, struct extractor *x);
-unsigned int parser_extractor_process_wireguard(struct datum *p, struct extractor *x);
-
 unsigned int parser_extractor_process_udp_data(struct datum *p, struct extractor *x) {
     const struct pi_container *pi;
     struct pi_container dummy = { 0, 0 };
+    unsigned int len = parser_get_data_length(p);
 
     extractor_debug("%s: parser has %td bytes\n", __func__, p->data_end - p->data);
 
     x->transport_data = *p;
 
-    pi = proto_identify_udp(p->data, parser_get_data_length(p));
+    /* one probe of the shared matcher table yields the message type
+     * and the parser; the port-hint switch below remains only for
+     * payloads too short for the sixteen-byte matcher load */
+    if (len >= MASKED_PATTERN_LEN) {
+        const struct udp_matchers &u = get_udp_matchers();
+        int idx = masked_matcher_match(&u.m, p->data);
+        if (idx < 0) {
+            return 0;
+        }
+        x->msg_type = u.msg[idx];
+        if (u.parser[idx] == NULL) {
+            return 0;   /* identified (QUIC initial), but nothing to extract */
+        }
+        return u.parser[idx](p, x);
+    }
+
+    pi = proto_identify_udp(p->data, len);
 
     if (pi == NULL) {
         pi = &dummy;
@@ -343,6 +576,9 @@ unsigned int parser_extractor_process_udp_data(struct datum *p, struct extractor
         x->msg_type = msg_type_wireguard;
         return parser_extractor_process_wireguard(p, x);
         break;
+    case QUIC_PORT:
+        x->msg_type = msg_type_quic_init;
+        break;
     default:
         ;
     }
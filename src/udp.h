@@ -11,6 +11,10 @@
 
 unsigned int packet_filter_process_udp(struct packet_filter *pf, struct key *k);
 
+#define GTP_PORT 2152
+
+enum status parser_skip_gtp_header(struct datum *p);
+
 struct udp_header {
     uint16_t src_port;
     uint16_t dst_port;
@@ -12,6 +12,8 @@
 #include <string.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 #include <pwd.h>
 #include <grp.h>
 #include <stdlib.h>
@@ -204,6 +206,41 @@ enum status drop_root_privileges(const char *username, const char *directory) {
     return status_ok;
 }
 
+/*
+ * lock_process_memory() locks the whole process into RAM with
+ * mlockall(), so that no page of the rings, the flow tables, or the
+ * analysis databases can be reclaimed and demand-paged back in during
+ * capture.  MCL_FUTURE covers the large subsystem allocations that
+ * follow this call, and locking a page faults it in, so those
+ * allocations are also prefaulted at startup instead of page by page
+ * under traffic.  RLIMIT_MEMLOCK is raised to unlimited first (this
+ * runs while we are still root, and the raised limit survives the
+ * privilege drop, so pages mapped after it count against the raised
+ * limit rather than the default of a few MB).
+ *
+ * returns 0 on success and -1 on failure
+ */
+enum status lock_process_memory(void) {
+
+    struct rlimit memlock_limit;
+    if (getrlimit(RLIMIT_MEMLOCK, &memlock_limit) == 0
+        && memlock_limit.rlim_cur != RLIM_INFINITY) {
+        memlock_limit.rlim_cur = RLIM_INFINITY;
+        memlock_limit.rlim_max = RLIM_INFINITY;
+        if (setrlimit(RLIMIT_MEMLOCK, &memlock_limit) != 0) {
+            fprintf(stderr, "warning: could not raise RLIMIT_MEMLOCK (%s); locking may fail\n",
+                    strerror(errno));
+        }
+    }
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        perror("error locking process memory with mlockall");
+        return status_err;
+    }
+
+    return status_ok;
+}
+
 /*
  * copy_string_into_buffer(dst, dst_len, src, src_len)
  *
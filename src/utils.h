@@ -54,6 +54,8 @@ void fprintf_json_string(FILE *f, const char *key, const uint8_t *data, unsigned
 
 enum status drop_root_privileges(const char *username, const char *directory);
 
+enum status lock_process_memory(void);
+
 int copy_string_into_buffer(char *dst, size_t dst_len, const char *src, size_t max_src_len);
 
 void fprintf_json_base64_string(FILE *file, const unsigned char *data, size_t input_length);
@@ -1,58 +1,168 @@
 #!/bin/sh
 
-# echo "testing performance of filesystem and storage devices"
-
-# set target directory and tmpfile in that directory
+# performance regression harness for the pcap-driven pipeline
 #
-DIR=$PWD
-TMPFILE=$DIR/tmpfile
-
-# determine the device associated with the target filesystem
+# runs mercury over one or more reference captures, records
+# packets/sec, drops, maximum RSS, and output bytes as JSON records
+# (one per capture, in perf-results.json), and compares them against a
+# stored baseline, failing when a metric regresses beyond the
+# threshold
+#
+# usage:
+#   sys-perf-test.sh            run captures and compare against baseline.json
+#   sys-perf-test.sh --baseline run captures and store the result as baseline.json
+#
+# additional arguments name the capture files to run (default: the
+# reference captures under ../data); the MERCURY and PERF_THRESHOLD
+# (percent, default 20) environment variables override the mercury
+# path and the regression threshold
 #
-DEV=$(df ${DIR} | egrep -o "/dev/[a-z]*")
-DEVBASE=$(basename ${DEV})
+# invoke as "make perf" or "make perf-baseline" in mercury/test
 
-# get system description
-UNAME=$(uname -svrm)
-FS=$(df --output=fstype . | tail -n 1)
+MERCURY=${MERCURY:-../../src/mercury}
+RESULTS=perf-results.json
+BASELINE=baseline.json
+PERF_THRESHOLD=${PERF_THRESHOLD:-20}
 
-FNAME=$(echo ${UNAME}-${FS}-${DEV}.txt | tr " " "-" | tr -d "/")
+MODE=compare
+if [ "$1" = "--baseline" ]; then
+    MODE=baseline
+    shift
+fi
 
-# clear OS and drive caches
-#
-# hdparm -F ${DEV}
-sync
-echo 3 > /proc/sys/vm/drop_caches
+if [ $# -gt 0 ]; then
+    CAPTURES="$@"
+else
+    CAPTURES="../data/top-https.pcap ../data/top_100_fingerprints.pcap"
+fi
 
-# the following command turns off the device's page cache - only use this if you know how to turn it back on!
-# hdparm -W0 ${DEV}
+if [ ! -x "${MERCURY}" ]; then
+    echo "error: ${MERCURY} not found; build mercury first" >&2
+    exit 1
+fi
 
-# run performance tests
+# run each capture through the pipeline in its own measurement
+# process, so that the RSS high-water mark of one run cannot mask a
+# later one
 #
-WRITEPERF=$(dd if=/dev/zero of=${TMPFILE} oflag=direct conv=fdatasync bs=1M count=10K 2>&1 | egrep -o "[0-9.]* [KMG]*B/s")
+> ${RESULTS}
+for CAPTURE in ${CAPTURES}; do
+    if [ ! -f "${CAPTURE}" ]; then
+        echo "error: capture file ${CAPTURE} not found" >&2
+        exit 1
+    fi
+    python3 - "${MERCURY}" "${CAPTURE}" >> ${RESULTS} <<'EOF'
+import json, os, resource, struct, subprocess, sys, tempfile, time
 
-# clear OS and drive caches again
-#
-# hdparm -F ${DEV}
-sync
-echo 3 > /proc/sys/vm/drop_caches
+mercury, capture = sys.argv[1], sys.argv[2]
 
-READPERF=$(dd if=${TMPFILE} of=/dev/null conv=fdatasync bs=1M count=10K 2>&1 | egrep -o "[0-9.]* [KMG]*B/s")
+# count the packet records in the capture
+packets = 0
+with open(capture, 'rb') as f:
+    hdr = f.read(24)
+    magic = struct.unpack('<I', hdr[:4])[0]
+    endian = '<' if magic in (0xa1b2c3d4, 0xa1b23c4d) else '>'
+    while True:
+        rec = f.read(16)
+        if len(rec) < 16:
+            break
+        incl_len = struct.unpack(endian + 'I', rec[8:12])[0]
+        f.seek(incl_len, os.SEEK_CUR)
+        packets += 1
 
-# remove temporary file
-rm -f ${TMPFILE}
+outfile = tempfile.NamedTemporaryFile(suffix='.json', delete=False)
+outfile.close()
+start = time.monotonic()
+proc = subprocess.run([mercury, '-r', capture, '-f', outfile.name],
+                      stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+seconds = time.monotonic() - start
+if proc.returncode != 0:
+    sys.stderr.write('error: mercury exited with status %d on %s\n'
+                     % (proc.returncode, capture))
+    os.unlink(outfile.name)
+    sys.exit(1)
 
-# report results
-#
-> ${FNAME}
-echo ${UNAME} >> ${FNAME}
-echo ${FS} >> ${FNAME}
-echo ${DEV} >> ${FNAME}
-echo "write throughput for "$DIR ":" ${WRITEPERF} >> ${FNAME}
-echo "read throughput for "$DIR ": " ${READPERF} >> ${FNAME}
-
-# change file owner/group to non-root
+rss_kbytes = resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss
+output_bytes = os.path.getsize(outfile.name)
+os.unlink(outfile.name)
+
+# a file read delivers every packet; drops can only occur on the
+# capture and replay paths
+drops = 0
+
+print(json.dumps({'perf': {
+    'capture': os.path.basename(capture),
+    'packets': packets,
+    'seconds': round(seconds, 6),
+    'packets_per_sec': round(packets / seconds) if seconds > 0 else 0,
+    'drops': drops,
+    'rss_kbytes': rss_kbytes,
+    'output_bytes': output_bytes,
+}}))
+EOF
+    if [ $? -ne 0 ]; then
+        exit 1
+    fi
+done
+
+cat ${RESULTS}
+
+if [ "${MODE}" = "baseline" ]; then
+    cp ${RESULTS} ${BASELINE}
+    echo "stored baseline in ${BASELINE}"
+    exit 0
+fi
+
+if [ ! -f "${BASELINE}" ]; then
+    echo "error: no stored baseline; run 'make perf-baseline' first" >&2
+    exit 1
+fi
+
+# compare against the baseline: packets/sec may not drop, and RSS,
+# output bytes, and drops may not grow, by more than the threshold
 #
-chown ${SUDO_USER}:${SUDO_USER} ${FNAME}
+python3 - "${RESULTS}" "${BASELINE}" "${PERF_THRESHOLD}" <<'EOF'
+import json, sys
+
+results_file, baseline_file, threshold = sys.argv[1], sys.argv[2], float(sys.argv[3])
+
+def load(fname):
+    records = {}
+    with open(fname) as f:
+        for line in f:
+            r = json.loads(line)['perf']
+            records[r['capture']] = r
+    return records
+
+results = load(results_file)
+baseline = load(baseline_file)
 
+failed = False
+for capture, r in results.items():
+    if capture not in baseline:
+        sys.stderr.write('warning: no baseline for %s; skipping\n' % capture)
+        continue
+    b = baseline[capture]
+    checks = [
+        ('packets_per_sec', r['packets_per_sec'], b['packets_per_sec'], 'lower'),
+        ('rss_kbytes',      r['rss_kbytes'],      b['rss_kbytes'],      'higher'),
+        ('output_bytes',    r['output_bytes'],    b['output_bytes'],    'higher'),
+        ('drops',           r['drops'],           b['drops'],           'higher'),
+    ]
+    for metric, value, base, direction in checks:
+        if base == 0:
+            regressed = (value > 0) if direction == 'higher' else False
+        elif direction == 'lower':
+            regressed = value < base * (1 - threshold / 100)
+        else:
+            regressed = value > base * (1 + threshold / 100)
+        if regressed:
+            sys.stderr.write('FAIL: %s %s regressed %s -> %s (threshold %g%%)\n'
+                             % (capture, metric, base, value, threshold))
+            failed = True
 
+if failed:
+    sys.exit(1)
+print('passed performance regression tests')
+EOF
+exit $?